@@ -0,0 +1,875 @@
+#include "@/public/assembler.h"
+
+#include "@/public/opcode.h"
+#include "@/public/verify.h"
+
+#include <errno.h>
+#include <github.com/apronchenkov/error/public/error.h>
+#include <github.com/apronchenkov/vm/public/state.h>
+#include <inttypes.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+enum u7_vm0_asm_symbol_kind {
+  U7_VM0_ASM_SYMBOL_LOCAL,
+  U7_VM0_ASM_SYMBOL_LABEL,
+};
+
+struct u7_vm0_asm_symbol {
+  const char* name;  // Points into the text.
+  size_t name_size;
+  enum u7_vm0_asm_symbol_kind kind;
+  enum u7_vm0_arg_kind arg_kind;  // For locals.
+  int64_t value;  // Offset of a local; index of a label, or -1 if undefined.
+  int64_t count;  // Number of elements of a local.
+  size_t line;    // Where the symbol was first mentioned.
+};
+
+// A reference to a label that was not defined yet.
+struct u7_vm0_asm_fixup {
+  size_t instruction_index;
+  size_t symbol_index;
+};
+
+struct u7_vm0_asm {
+  const char* it;        // The current position within the line.
+  const char* line_end;  // The end of the line, without the comment.
+  size_t line;
+
+  struct u7_vm0_asm_symbol* symbols;
+  size_t symbols_size;
+  size_t symbols_capacity;
+
+  // Open addressing hash table; holds indices of the symbols plus 1, and 0
+  // for an empty slot.
+  uint32_t* table;
+  size_t table_capacity;
+
+  struct u7_vm0_instruction* instructions;
+  size_t instructions_size;
+  size_t instructions_capacity;
+
+  struct u7_vm0_asm_fixup* fixups;
+  size_t fixups_size;
+  size_t fixups_capacity;
+
+  size_t locals_size;
+};
+
+#define U7_VM0_ASM_ERROR(self, format, ...)                             \
+  u7_errnof(EINVAL, "u7_vm0_assemble: line %zu: " format, (self)->line, \
+            ##__VA_ARGS__)
+
+// Makes sure that there is space for one more element.
+static bool u7_vm0_asm_reserve(void** data, size_t* capacity, size_t size,
+                               size_t element_size) {
+  if (size < *capacity) {
+    return true;
+  }
+  const size_t new_capacity = (*capacity == 0 ? 64 : 2 * *capacity);
+  void* new_data = realloc(*data, new_capacity * element_size);
+  if (new_data == NULL) {
+    return false;
+  }
+  *data = new_data;
+  *capacity = new_capacity;
+  return true;
+}
+
+static uint64_t u7_vm0_asm_hash(const char* name, size_t name_size) {
+  uint64_t result = UINT64_C(14695981039346656037);  // FNV-1a
+  for (size_t i = 0; i < name_size; ++i) {
+    result = (result ^ (uint8_t)name[i]) * UINT64_C(1099511628211);
+  }
+  return result;
+}
+
+// Returns the slot of the symbol, or the empty slot where it belongs.
+static size_t u7_vm0_asm_slot(struct u7_vm0_asm const* self, const char* name,
+                              size_t name_size) {
+  const size_t mask = self->table_capacity - 1;
+  size_t slot = (size_t)u7_vm0_asm_hash(name, name_size) & mask;
+  while (self->table[slot] != 0) {
+    struct u7_vm0_asm_symbol const* symbol =
+        &self->symbols[self->table[slot] - 1];
+    if (symbol->name_size == name_size &&
+        memcmp(symbol->name, name, name_size) == 0) {
+      break;
+    }
+    slot = (slot + 1) & mask;
+  }
+  return slot;
+}
+
+// Returns the index of the symbol, or SIZE_MAX.
+static size_t u7_vm0_asm_find(struct u7_vm0_asm const* self, const char* name,
+                              size_t name_size) {
+  if (self->table_capacity == 0) {
+    return SIZE_MAX;
+  }
+  const uint32_t entry = self->table[u7_vm0_asm_slot(self, name, name_size)];
+  return (entry != 0 ? entry - 1 : SIZE_MAX);
+}
+
+// Adds a symbol that is known to be absent; returns its index, or SIZE_MAX
+// if out of memory.
+static size_t u7_vm0_asm_add(struct u7_vm0_asm* self,
+                             struct u7_vm0_asm_symbol symbol) {
+  if (!u7_vm0_asm_reserve((void**)&self->symbols, &self->symbols_capacity,
+                          self->symbols_size, sizeof(*self->symbols)) ||
+      self->symbols_size >= UINT32_MAX) {
+    return SIZE_MAX;
+  }
+  if (2 * (self->symbols_size + 1) > self->table_capacity) {
+    const size_t new_capacity =
+        (self->table_capacity == 0 ? 256 : 2 * self->table_capacity);
+    uint32_t* new_table = calloc(new_capacity, sizeof(uint32_t));
+    if (new_table == NULL) {
+      return SIZE_MAX;
+    }
+    free(self->table);
+    self->table = new_table;
+    self->table_capacity = new_capacity;
+    for (size_t i = 0; i < self->symbols_size; ++i) {
+      self->table[u7_vm0_asm_slot(self, self->symbols[i].name,
+                                  self->symbols[i].name_size)] =
+          (uint32_t)i + 1;
+    }
+  }
+  const size_t index = self->symbols_size++;
+  self->symbols[index] = symbol;
+  self->table[u7_vm0_asm_slot(self, symbol.name, symbol.name_size)] =
+      (uint32_t)index + 1;
+  return index;
+}
+
+static void u7_vm0_asm_skip_spaces(struct u7_vm0_asm* self) {
+  while (self->it < self->line_end &&
+         (*self->it == ' ' || *self->it == '\t' || *self->it == '\r')) {
+    ++self->it;
+  }
+}
+
+static bool u7_vm0_asm_at_end(struct u7_vm0_asm* self) {
+  u7_vm0_asm_skip_spaces(self);
+  return self->it == self->line_end;
+}
+
+static bool u7_vm0_asm_consume(struct u7_vm0_asm* self, const char* token) {
+  u7_vm0_asm_skip_spaces(self);
+  const size_t token_size = strlen(token);
+  if ((size_t)(self->line_end - self->it) >= token_size &&
+      memcmp(self->it, token, token_size) == 0) {
+    self->it += token_size;
+    return true;
+  }
+  return false;
+}
+
+static bool u7_vm0_asm_is_identifier_char(char c, bool first) {
+  return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || c == '_' ||
+         (!first && c >= '0' && c <= '9');
+}
+
+static bool u7_vm0_asm_identifier(struct u7_vm0_asm* self, const char** name,
+                                  size_t* name_size) {
+  u7_vm0_asm_skip_spaces(self);
+  if (self->it == self->line_end ||
+      !u7_vm0_asm_is_identifier_char(*self->it, true)) {
+    return false;
+  }
+  *name = self->it;
+  while (self->it < self->line_end &&
+         u7_vm0_asm_is_identifier_char(*self->it, false)) {
+    ++self->it;
+  }
+  *name_size = (size_t)(self->it - *name);
+  return true;
+}
+
+static bool u7_vm0_asm_equals(const char* name, size_t name_size,
+                              const char* keyword) {
+  return strlen(keyword) == name_size && memcmp(name, keyword, name_size) == 0;
+}
+
+// Returns the variable kind for a type keyword, or -1.
+static int u7_vm0_asm_type(const char* name, size_t name_size) {
+  if (u7_vm0_asm_equals(name, name_size, "i32")) {
+    return U7_VM0_ARG_KIND_I32_VARIABLE;
+  } else if (u7_vm0_asm_equals(name, name_size, "i64")) {
+    return U7_VM0_ARG_KIND_I64_VARIABLE;
+  } else if (u7_vm0_asm_equals(name, name_size, "f32")) {
+    return U7_VM0_ARG_KIND_F32_VARIABLE;
+  } else if (u7_vm0_asm_equals(name, name_size, "f64")) {
+    return U7_VM0_ARG_KIND_F64_VARIABLE;
+  }
+  return -1;
+}
+
+static bool u7_vm0_asm_is_keyword(const char* name, size_t name_size) {
+  static const char* const keywords[] = {
+      "read", "write", "jz", "jnz", "jmp", "switch", "if", "goto", "yield",
+      "ret"};
+  for (size_t i = 0; i < sizeof(keywords) / sizeof(keywords[0]); ++i) {
+    if (u7_vm0_asm_equals(name, name_size, keywords[i])) {
+      return true;
+    }
+  }
+  return u7_vm0_asm_type(name, name_size) >= 0;
+}
+
+static int64_t u7_vm0_asm_variable_size(enum u7_vm0_arg_kind kind) {
+  return (kind == U7_VM0_ARG_KIND_I32_VARIABLE ||
+                  kind == U7_VM0_ARG_KIND_F32_VARIABLE
+              ? 4
+              : 8);
+}
+
+// Parses a numeric literal. Integers are returned in value->i64, and
+// numbers with a fraction or an exponent in value->f64.
+static u7_error u7_vm0_asm_number(struct u7_vm0_asm* self,
+                                  union u7_vm0_value* value, bool* is_float) {
+  u7_vm0_asm_skip_spaces(self);
+  const char* begin = self->it;
+  const char* it = begin;
+  if (it < self->line_end && (*it == '-' || *it == '+')) {
+    ++it;
+  }
+  const bool is_hex = (self->line_end - it >= 2 && it[0] == '0' &&
+                       (it[1] == 'x' || it[1] == 'X'));
+  *is_float = false;
+  while (it < self->line_end) {
+    const char c = *it;
+    if (c == '.' || (!is_hex && (c == 'e' || c == 'E'))) {
+      *is_float = true;
+    }
+    if ((c >= '0' && c <= '9') || u7_vm0_asm_is_identifier_char(c, true) ||
+        c == '.') {
+      ++it;
+    } else if ((c == '-' || c == '+') && !is_hex && it > begin &&
+               (it[-1] == 'e' || it[-1] == 'E')) {
+      ++it;
+    } else {
+      break;
+    }
+  }
+  char buffer[64];
+  const size_t size = (size_t)(it - begin);
+  if (size == 0 || size >= sizeof(buffer)) {
+    return U7_VM0_ASM_ERROR(self, "expected a number");
+  }
+  memcpy(buffer, begin, size);
+  buffer[size] = '\0';
+  char* parsed_end;
+  errno = 0;
+  if (*is_float) {
+    value->f64 = strtod(buffer, &parsed_end);
+  } else {
+    value->i64 = strtoll(buffer, &parsed_end, is_hex ? 16 : 10);
+  }
+  if (parsed_end != buffer + size) {
+    return U7_VM0_ASM_ERROR(self, "bad number: %s", buffer);
+  }
+  if (errno == ERANGE && !*is_float) {
+    return U7_VM0_ASM_ERROR(self, "number is out of range: %s", buffer);
+  }
+  self->it = it;
+  return u7_ok();
+}
+
+// Parses a constant of the type of `variable_kind`.
+static u7_error u7_vm0_asm_constant(struct u7_vm0_asm* self,
+                                    enum u7_vm0_arg_kind variable_kind,
+                                    struct u7_vm0_arg* arg) {
+  union u7_vm0_value value;
+  bool is_float;
+  u7_error error = u7_vm0_asm_number(self, &value, &is_float);
+  if (error.error_code != 0) {
+    return error;
+  }
+  switch (variable_kind) {
+    case U7_VM0_ARG_KIND_I32_VARIABLE:
+      if (is_float || value.i64 < INT32_MIN || value.i64 > INT32_MAX) {
+        return U7_VM0_ASM_ERROR(self, "expected an i32 constant");
+      }
+      arg->kind = U7_VM0_ARG_KIND_I32_CONSTANT;
+      arg->value.i64 = value.i64;
+      return u7_ok();
+    case U7_VM0_ARG_KIND_I64_VARIABLE:
+      if (is_float) {
+        return U7_VM0_ASM_ERROR(self, "expected an i64 constant");
+      }
+      arg->kind = U7_VM0_ARG_KIND_I64_CONSTANT;
+      arg->value = value;
+      return u7_ok();
+    case U7_VM0_ARG_KIND_F32_VARIABLE:
+      arg->kind = U7_VM0_ARG_KIND_F32_CONSTANT;
+      arg->value.i64 = 0;
+      arg->value.f32 = (is_float ? (float)value.f64 : (float)value.i64);
+      return u7_ok();
+    default:
+      arg->kind = U7_VM0_ARG_KIND_F64_CONSTANT;
+      arg->value.f64 = (is_float ? value.f64 : (double)value.i64);
+      return u7_ok();
+  }
+}
+
+// Resolves a local variable, with an optional constant index.
+static u7_error u7_vm0_asm_variable(struct u7_vm0_asm* self, const char* name,
+                                    size_t name_size, struct u7_vm0_arg* arg) {
+  const size_t index = u7_vm0_asm_find(self, name, name_size);
+  if (index == SIZE_MAX ||
+      self->symbols[index].kind != U7_VM0_ASM_SYMBOL_LOCAL) {
+    return U7_VM0_ASM_ERROR(self, "unknown variable: %.*s", (int)name_size,
+                            name);
+  }
+  struct u7_vm0_asm_symbol const* symbol = &self->symbols[index];
+  arg->kind = symbol->arg_kind;
+  arg->value.i64 = symbol->value;
+  if (u7_vm0_asm_consume(self, "[")) {
+    union u7_vm0_value element;
+    bool is_float;
+    u7_error error = u7_vm0_asm_number(self, &element, &is_float);
+    if (error.error_code != 0) {
+      return error;
+    }
+    if (is_float || element.i64 < 0 || element.i64 >= symbol->count) {
+      return U7_VM0_ASM_ERROR(self, "bad index of %.*s", (int)name_size,
+                              name);
+    }
+    if (!u7_vm0_asm_consume(self, "]")) {
+      return U7_VM0_ASM_ERROR(self, "expected ']'");
+    }
+    arg->value.i64 += element.i64 * u7_vm0_asm_variable_size(symbol->arg_kind);
+  }
+  return u7_ok();
+}
+
+// Parses a variable or a constant. Constants take the type of
+// `variable_kind`; if it is negative, the type follows the spelling.
+static u7_error u7_vm0_asm_operand(struct u7_vm0_asm* self, int variable_kind,
+                                   struct u7_vm0_arg* arg) {
+  const char* name;
+  size_t name_size;
+  if (u7_vm0_asm_identifier(self, &name, &name_size)) {
+    return u7_vm0_asm_variable(self, name, name_size, arg);
+  }
+  if (variable_kind >= 0) {
+    return u7_vm0_asm_constant(self, (enum u7_vm0_arg_kind)variable_kind, arg);
+  }
+  const char* begin = self->it;
+  union u7_vm0_value value;
+  bool is_float;
+  u7_error error = u7_vm0_asm_number(self, &value, &is_float);
+  if (error.error_code != 0) {
+    return error;
+  }
+  self->it = begin;
+  return u7_vm0_asm_constant(self,
+                             is_float ? U7_VM0_ARG_KIND_F64_VARIABLE
+                                      : U7_VM0_ARG_KIND_I64_VARIABLE,
+                             arg);
+}
+
+// Appends an instruction made by a constructor.
+static u7_error u7_vm0_asm_emit(struct u7_vm0_asm* self,
+                                struct u7_vm0_instruction instruction,
+                                u7_error error) {
+  if (error.error_code != 0) {
+    u7_error result =
+        u7_errnof(error.error_code, "u7_vm0_assemble: line %zu: %s",
+                  self->line, error.message);
+    u7_error_release(error);
+    return result;
+  }
+  if (!u7_vm0_asm_reserve((void**)&self->instructions,
+                          &self->instructions_capacity,
+                          self->instructions_size,
+                          sizeof(*self->instructions))) {
+    return u7_errnof(ENOMEM, "u7_vm0_assemble: out of memory");
+  }
+  self->instructions[self->instructions_size++] = instruction;
+  return u7_ok();
+}
+
+static u7_error u7_vm0_asm_declaration(struct u7_vm0_asm* self,
+                                       enum u7_vm0_arg_kind kind) {
+  const int64_t size = u7_vm0_asm_variable_size(kind);
+  do {
+    const char* name;
+    size_t name_size;
+    if (!u7_vm0_asm_identifier(self, &name, &name_size)) {
+      return U7_VM0_ASM_ERROR(self, "expected a variable name");
+    }
+    if (u7_vm0_asm_is_keyword(name, name_size)) {
+      return U7_VM0_ASM_ERROR(self, "reserved name: %.*s", (int)name_size,
+                              name);
+    }
+    if (u7_vm0_asm_find(self, name, name_size) != SIZE_MAX) {
+      return U7_VM0_ASM_ERROR(self, "duplicate name: %.*s", (int)name_size,
+                              name);
+    }
+    int64_t count = 1;
+    if (u7_vm0_asm_consume(self, "[")) {
+      union u7_vm0_value value;
+      bool is_float;
+      u7_error error = u7_vm0_asm_number(self, &value, &is_float);
+      if (error.error_code != 0) {
+        return error;
+      }
+      if (is_float || value.i64 <= 0 || value.i64 > INT32_MAX / size) {
+        return U7_VM0_ASM_ERROR(self, "bad array size of %.*s",
+                                (int)name_size, name);
+      }
+      if (!u7_vm0_asm_consume(self, "]")) {
+        return U7_VM0_ASM_ERROR(self, "expected ']'");
+      }
+      count = value.i64;
+    }
+    const size_t offset = u7_vm_align_size(self->locals_size, (size_t)size);
+    if (offset + (size_t)(size * count) > INT32_MAX) {
+      return U7_VM0_ASM_ERROR(self, "too many locals");
+    }
+    struct u7_vm0_asm_symbol symbol = {
+        .name = name,
+        .name_size = name_size,
+        .kind = U7_VM0_ASM_SYMBOL_LOCAL,
+        .arg_kind = kind,
+        .value = (int64_t)offset,
+        .count = count,
+        .line = self->line,
+    };
+    if (u7_vm0_asm_add(self, symbol) == SIZE_MAX) {
+      return u7_errnof(ENOMEM, "u7_vm0_assemble: out of memory");
+    }
+    self->locals_size = offset + (size_t)(size * count);
+  } while (u7_vm0_asm_consume(self, ","));
+  return u7_ok();
+}
+
+static u7_error u7_vm0_asm_label_definition(struct u7_vm0_asm* self,
+                                            const char* name,
+                                            size_t name_size) {
+  if (u7_vm0_asm_is_keyword(name, name_size)) {
+    return U7_VM0_ASM_ERROR(self, "reserved name: %.*s", (int)name_size, name);
+  }
+  const size_t index = u7_vm0_asm_find(self, name, name_size);
+  if (index == SIZE_MAX) {
+    struct u7_vm0_asm_symbol symbol = {
+        .name = name,
+        .name_size = name_size,
+        .kind = U7_VM0_ASM_SYMBOL_LABEL,
+        .value = (int64_t)self->instructions_size,
+        .line = self->line,
+    };
+    if (u7_vm0_asm_add(self, symbol) == SIZE_MAX) {
+      return u7_errnof(ENOMEM, "u7_vm0_assemble: out of memory");
+    }
+    return u7_ok();
+  }
+  struct u7_vm0_asm_symbol* symbol = &self->symbols[index];
+  if (symbol->kind != U7_VM0_ASM_SYMBOL_LABEL || symbol->value >= 0) {
+    return U7_VM0_ASM_ERROR(self, "duplicate name: %.*s", (int)name_size,
+                            name);
+  }
+  symbol->value = (int64_t)self->instructions_size;
+  return u7_ok();
+}
+
+// Parses a label reference; labels that are not defined yet produce a
+// fixup for the next instruction.
+static u7_error u7_vm0_asm_label(struct u7_vm0_asm* self,
+                                 struct u7_vm0_arg* arg) {
+  const char* name;
+  size_t name_size;
+  if (!u7_vm0_asm_identifier(self, &name, &name_size)) {
+    return U7_VM0_ASM_ERROR(self, "expected a label");
+  }
+  size_t index = u7_vm0_asm_find(self, name, name_size);
+  if (index == SIZE_MAX) {
+    struct u7_vm0_asm_symbol symbol = {
+        .name = name,
+        .name_size = name_size,
+        .kind = U7_VM0_ASM_SYMBOL_LABEL,
+        .value = -1,
+        .line = self->line,
+    };
+    index = u7_vm0_asm_add(self, symbol);
+    if (index == SIZE_MAX) {
+      return u7_errnof(ENOMEM, "u7_vm0_assemble: out of memory");
+    }
+  } else if (self->symbols[index].kind != U7_VM0_ASM_SYMBOL_LABEL) {
+    return U7_VM0_ASM_ERROR(self, "not a label: %.*s", (int)name_size, name);
+  }
+  arg->kind = U7_VM0_ARG_KIND_I64_LABEL;
+  arg->value.i64 = self->symbols[index].value;
+  if (arg->value.i64 < 0) {
+    if (!u7_vm0_asm_reserve((void**)&self->fixups, &self->fixups_capacity,
+                            self->fixups_size, sizeof(*self->fixups))) {
+      return u7_errnof(ENOMEM, "u7_vm0_assemble: out of memory");
+    }
+    self->fixups[self->fixups_size++] = (struct u7_vm0_asm_fixup){
+        .instruction_index = self->instructions_size,
+        .symbol_index = index,
+    };
+    arg->value.i64 = 0;
+  }
+  return u7_ok();
+}
+
+// Parses `read x`, `read x, n`, `write x` and `write x, n`.
+static u7_error u7_vm0_asm_input_output(struct u7_vm0_asm* self, bool input) {
+  struct u7_vm0_arg arg;
+  u7_error error = u7_vm0_asm_operand(self, -1, &arg);
+  if (error.error_code != 0) {
+    return error;
+  }
+  u7_error emit_error = u7_ok();
+  if (!u7_vm0_asm_consume(self, ",")) {
+    const struct u7_vm0_instruction instruction =
+        (input ? u7_vm0_input(&emit_error, arg)
+               : u7_vm0_output(&emit_error, arg));
+    return u7_vm0_asm_emit(self, instruction, emit_error);
+  }
+  union u7_vm0_value count;
+  bool is_float;
+  error = u7_vm0_asm_number(self, &count, &is_float);
+  if (error.error_code != 0) {
+    return error;
+  }
+  if (is_float) {
+    return U7_VM0_ASM_ERROR(self, "expected an integer count");
+  }
+  const struct u7_vm0_instruction instruction =
+      (input ? u7_vm0_input_n(&emit_error, arg, count.i64)
+             : u7_vm0_output_n(&emit_error, arg, count.i64));
+  return u7_vm0_asm_emit(self, instruction, emit_error);
+}
+
+static u7_error u7_vm0_asm_jump(struct u7_vm0_asm* self, bool if_zero) {
+  struct u7_vm0_arg src, label;
+  u7_error error = u7_vm0_asm_operand(self, -1, &src);
+  if (error.error_code != 0) {
+    return error;
+  }
+  if (!u7_vm0_asm_consume(self, ",")) {
+    return U7_VM0_ASM_ERROR(self, "expected ','");
+  }
+  error = u7_vm0_asm_label(self, &label);
+  if (error.error_code != 0) {
+    return error;
+  }
+  u7_error emit_error = u7_ok();
+  const struct u7_vm0_instruction instruction =
+      (if_zero ? u7_vm0_jump_if_zero(&emit_error, src, label)
+               : u7_vm0_jump_if_not_zero(&emit_error, src, label));
+  return u7_vm0_asm_emit(self, instruction, emit_error);
+}
+
+// Parses `if lhs op rhs goto label`, after `if`; a constant rhs takes the
+// type of lhs.
+static u7_error u7_vm0_asm_if(struct u7_vm0_asm* self) {
+  struct u7_vm0_arg lhs, rhs, label;
+  const char* name;
+  size_t name_size;
+  if (!u7_vm0_asm_identifier(self, &name, &name_size)) {
+    return U7_VM0_ASM_ERROR(self, "expected a variable");
+  }
+  u7_error error = u7_vm0_asm_variable(self, name, name_size, &lhs);
+  if (error.error_code != 0) {
+    return error;
+  }
+  static const char* const ops[] = {"==", "!=", "<=", ">=", "<", ">"};
+  size_t op = 0;
+  while (op < sizeof(ops) / sizeof(ops[0]) &&
+         !u7_vm0_asm_consume(self, ops[op])) {
+    ++op;
+  }
+  if (op == sizeof(ops) / sizeof(ops[0])) {
+    return U7_VM0_ASM_ERROR(self, "expected a comparison");
+  }
+  error = u7_vm0_asm_operand(self, (int)lhs.kind, &rhs);
+  if (error.error_code != 0) {
+    return error;
+  }
+  if (!u7_vm0_asm_identifier(self, &name, &name_size) ||
+      !u7_vm0_asm_equals(name, name_size, "goto")) {
+    return U7_VM0_ASM_ERROR(self, "expected 'goto'");
+  }
+  error = u7_vm0_asm_label(self, &label);
+  if (error.error_code != 0) {
+    return error;
+  }
+  u7_error emit_error = u7_ok();
+  struct u7_vm0_instruction instruction;
+  switch (op) {
+    case 0:
+      instruction = u7_vm0_jump_if_equal(&emit_error, lhs, rhs, label);
+      break;
+    case 1:
+      instruction = u7_vm0_jump_if_not_equal(&emit_error, lhs, rhs, label);
+      break;
+    case 2:
+      instruction =
+          u7_vm0_jump_if_less_or_equal(&emit_error, lhs, rhs, label);
+      break;
+    case 3:
+      instruction =
+          u7_vm0_jump_if_greater_or_equal(&emit_error, lhs, rhs, label);
+      break;
+    case 4:
+      instruction = u7_vm0_jump_if_less(&emit_error, lhs, rhs, label);
+      break;
+    default:
+      instruction = u7_vm0_jump_if_greater(&emit_error, lhs, rhs, label);
+      break;
+  }
+  return u7_vm0_asm_emit(self, instruction, emit_error);
+}
+
+// Parses `switch src, label, entry0, entry1, ...`: a jump table followed by
+// its entries.
+static u7_error u7_vm0_asm_switch(struct u7_vm0_asm* self) {
+  struct u7_vm0_arg src, label;
+  u7_error error = u7_vm0_asm_operand(self, -1, &src);
+  if (error.error_code != 0) {
+    return error;
+  }
+  if (!u7_vm0_asm_consume(self, ",")) {
+    return U7_VM0_ASM_ERROR(self, "expected ','");
+  }
+  error = u7_vm0_asm_label(self, &label);
+  if (error.error_code != 0) {
+    return error;
+  }
+  u7_error emit_error = u7_ok();
+  const size_t table_index = self->instructions_size;
+  error = u7_vm0_asm_emit(self, u7_vm0_jump_table(&emit_error, src, 0, label),
+                          emit_error);
+  int64_t count = 0;
+  while (error.error_code == 0 && u7_vm0_asm_consume(self, ",")) {
+    struct u7_vm0_arg entry;
+    error = u7_vm0_asm_label(self, &entry);
+    if (error.error_code == 0) {
+      error = u7_vm0_asm_emit(self, u7_vm0_jump(&emit_error, entry),
+                              emit_error);
+      count += 1;
+    }
+  }
+  if (error.error_code != 0) {
+    return error;
+  }
+  self->instructions[table_index].arg2.i64 = count;
+  return u7_ok();
+}
+
+// Parses `dst = src` and `dst = lhs op rhs`, after the name of `dst`.
+static u7_error u7_vm0_asm_assignment(struct u7_vm0_asm* self,
+                                      const char* name, size_t name_size) {
+  struct u7_vm0_arg dst, lhs, rhs;
+  u7_error error = u7_vm0_asm_variable(self, name, name_size, &dst);
+  if (error.error_code != 0) {
+    return error;
+  }
+  if (!u7_vm0_asm_consume(self, "=")) {
+    return U7_VM0_ASM_ERROR(self, "expected '='");
+  }
+  error = u7_vm0_asm_operand(self, (int)dst.kind, &lhs);
+  if (error.error_code != 0) {
+    return error;
+  }
+  u7_error emit_error = u7_ok();
+  if (u7_vm0_asm_at_end(self)) {
+    return u7_vm0_asm_emit(self, u7_vm0_copy(&emit_error, dst, lhs),
+                           emit_error);
+  }
+  char op = *self->it;
+  if (u7_vm0_asm_consume(self, "<<")) {
+    op = '<';
+  } else if (u7_vm0_asm_consume(self, ">>")) {
+    op = '>';
+  } else if (op == '+' || op == '*' || op == '&') {
+    ++self->it;
+  } else {
+    return U7_VM0_ASM_ERROR(self, "expected an operator");
+  }
+  error = u7_vm0_asm_operand(self, (int)dst.kind, &rhs);
+  if (error.error_code != 0) {
+    return error;
+  }
+  struct u7_vm0_instruction instruction;
+  switch (op) {
+    case '+':
+      instruction = u7_vm0_math_add(&emit_error, dst, lhs, rhs);
+      break;
+    case '*':
+      instruction = u7_vm0_math_multiply(&emit_error, dst, lhs, rhs);
+      break;
+    case '&':
+      instruction = u7_vm0_bitwise_and(&emit_error, dst, lhs, rhs);
+      break;
+    case '<':
+      instruction = u7_vm0_bitwise_left_shift(&emit_error, dst, lhs, rhs);
+      break;
+    default:
+      // A right shift is a left shift by a negative constant.
+      if (rhs.kind == U7_VM0_ARG_KIND_I32_CONSTANT ||
+          rhs.kind == U7_VM0_ARG_KIND_I64_CONSTANT) {
+        if (rhs.value.i64 == INT64_MIN) {
+          return U7_VM0_ASM_ERROR(self, "shift is out of range");
+        }
+        rhs.value.i64 = -rhs.value.i64;
+      } else {
+        return U7_VM0_ASM_ERROR(self, "right shift by a variable");
+      }
+      instruction = u7_vm0_bitwise_left_shift(&emit_error, dst, lhs, rhs);
+      break;
+  }
+  return u7_vm0_asm_emit(self, instruction, emit_error);
+}
+
+static u7_error u7_vm0_asm_statement(struct u7_vm0_asm* self) {
+  const char* name;
+  size_t name_size;
+  // Any number of labels may precede the statement.
+  for (;;) {
+    if (u7_vm0_asm_at_end(self)) {
+      return u7_ok();
+    }
+    if (!u7_vm0_asm_identifier(self, &name, &name_size)) {
+      return U7_VM0_ASM_ERROR(self, "expected a statement");
+    }
+    if (!u7_vm0_asm_consume(self, ":")) {
+      break;
+    }
+    u7_error error = u7_vm0_asm_label_definition(self, name, name_size);
+    if (error.error_code != 0) {
+      return error;
+    }
+  }
+  const int type = u7_vm0_asm_type(name, name_size);
+  if (type >= 0) {
+    return u7_vm0_asm_declaration(self, (enum u7_vm0_arg_kind)type);
+  }
+  u7_error emit_error = u7_ok();
+  if (u7_vm0_asm_equals(name, name_size, "read")) {
+    return u7_vm0_asm_input_output(self, true);
+  } else if (u7_vm0_asm_equals(name, name_size, "write")) {
+    return u7_vm0_asm_input_output(self, false);
+  } else if (u7_vm0_asm_equals(name, name_size, "jz")) {
+    return u7_vm0_asm_jump(self, true);
+  } else if (u7_vm0_asm_equals(name, name_size, "jnz")) {
+    return u7_vm0_asm_jump(self, false);
+  } else if (u7_vm0_asm_equals(name, name_size, "jmp")) {
+    struct u7_vm0_arg label;
+    u7_error error = u7_vm0_asm_label(self, &label);
+    if (error.error_code != 0) {
+      return error;
+    }
+    return u7_vm0_asm_emit(self, u7_vm0_jump(&emit_error, label), emit_error);
+  } else if (u7_vm0_asm_equals(name, name_size, "switch")) {
+    return u7_vm0_asm_switch(self);
+  } else if (u7_vm0_asm_equals(name, name_size, "if")) {
+    return u7_vm0_asm_if(self);
+  } else if (u7_vm0_asm_equals(name, name_size, "yield")) {
+    return u7_vm0_asm_emit(self, u7_vm0_yield(), emit_error);
+  } else if (u7_vm0_asm_equals(name, name_size, "ret")) {
+    return u7_vm0_asm_emit(self, u7_vm0_ret(), emit_error);
+  }
+  return u7_vm0_asm_assignment(self, name, name_size);
+}
+
+static u7_error u7_vm0_asm_run(struct u7_vm0_asm* self, const char* text,
+                               size_t text_size) {
+  const char* const end = text + text_size;
+  for (const char* line = text; line < end;) {
+    const char* line_end = memchr(line, '\n', (size_t)(end - line));
+    if (line_end == NULL) {
+      line_end = end;
+    }
+    ++self->line;
+    self->it = line;
+    self->line_end = line_end;
+    for (const char* it = line; it < line_end; ++it) {
+      if (*it == '#' || (*it == '/' && it + 1 < line_end && it[1] == '/')) {
+        self->line_end = it;
+        break;
+      }
+    }
+    u7_error error = u7_vm0_asm_statement(self);
+    if (error.error_code != 0) {
+      return error;
+    }
+    if (!u7_vm0_asm_at_end(self)) {
+      return U7_VM0_ASM_ERROR(self, "unexpected text: %.*s",
+                              (int)(self->line_end - self->it), self->it);
+    }
+    line = line_end + 1;
+  }
+  for (size_t i = 0; i < self->fixups_size; ++i) {
+    struct u7_vm0_asm_symbol const* symbol =
+        &self->symbols[self->fixups[i].symbol_index];
+    if (symbol->value < 0) {
+      self->line = symbol->line;
+      return U7_VM0_ASM_ERROR(self, "undefined label: %.*s",
+                              (int)symbol->name_size, symbol->name);
+    }
+    // An instruction has at most one label.
+    struct u7_vm0_instruction* instruction =
+        &self->instructions[self->fixups[i].instruction_index];
+    struct u7_vm0_opcode_info const* info =
+        u7_vm0_opcode_info(u7_vm0_instruction_opcode(instruction));
+    union u7_vm0_value* args[3] = {&instruction->arg1, &instruction->arg2,
+                                   &instruction->arg3};
+    for (int j = 0; j < 3; ++j) {
+      if (info->operand_kinds[j] == U7_VM0_OPERAND_LABEL) {
+        args[j]->i64 = symbol->value;
+      }
+    }
+  }
+  return u7_ok();
+}
+
+u7_error u7_vm0_assemble(struct u7_vm0_program* program, const char* text,
+                         size_t text_size) {
+  struct u7_vm0_asm self = {0};
+  u7_error error = u7_vm0_asm_run(&self, text, text_size);
+  *program = (struct u7_vm0_program){0};
+  program->locals_frame_layout = (struct u7_vm_stack_frame_layout){
+      .locals_size =
+          u7_vm_align_size(self.locals_size, U7_VM_DEFAULT_ALIGNMENT),
+      .deinit_fn = NULL,
+      .extra_capacity = 0,
+      .description = "u7_vm0_assemble",
+  };
+  if (error.error_code == 0) {
+    error = u7_vm0_verify(self.instructions, self.instructions_size,
+                          &program->locals_frame_layout);
+  }
+  if (error.error_code == 0) {
+    const size_t n = self.instructions_size;
+    char* memory = malloc(n * (sizeof(struct u7_vm0_instruction) +
+                               sizeof(struct u7_vm_instruction const*)));
+    if (memory == NULL) {
+      error = u7_errnof(ENOMEM, "u7_vm0_assemble: out of memory");
+    } else {
+      program->memory = memory;
+      program->instructions = (struct u7_vm0_instruction*)memory;
+      program->js = (struct u7_vm_instruction const**)(
+          memory + n * sizeof(struct u7_vm0_instruction));
+      program->instructions_size = n;
+      memcpy(program->instructions, self.instructions,
+             n * sizeof(struct u7_vm0_instruction));
+      for (size_t i = 0; i < n; ++i) {
+        program->js[i] = &program->instructions[i].base;
+      }
+    }
+  }
+  free(self.symbols);
+  free(self.table);
+  free(self.instructions);
+  free(self.fixups);
+  return error;
+}
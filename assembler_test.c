@@ -0,0 +1,210 @@
+#include "@/public/assembler.h"
+
+#include "@/public/program.h"
+#include "@/testing.h"
+
+#include <errno.h>
+#include <github.com/apronchenkov/error/public/error.h>
+#include <inttypes.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+// Tests for u7_vm0_assemble(): the statements of the language produce the
+// expected outputs, and malformed text is rejected with EINVAL and a message
+// that names the offending line.
+
+// Assembles the text and checks that it writes `expected` for the input.
+static u7_error check_program(const char* name, const char* text,
+                              int64_t const* input, size_t input_size,
+                              int64_t const* expected, size_t expected_size) {
+  struct u7_vm0_program program;
+  u7_error error = u7_vm0_assemble(&program, text, strlen(text));
+  if (error.error_code != 0) {
+    return u7_errnof(error.error_code, "%s: %" U7_ERROR_FMT, name,
+                     U7_ERROR_FMT_PARAMS(error));
+  }
+  int64_t output[16];
+  size_t output_size = sizeof(output) / sizeof(output[0]);
+  error = u7_vm0_test_run(&program, program.js, input, input_size, output,
+                          &output_size);
+  u7_vm0_program_destroy(&program);
+  if (error.error_code != 0) {
+    return error;
+  }
+  if (output_size != expected_size) {
+    return u7_errnof(EINVAL, "%s: expected %zu values written, got %zu", name,
+                     expected_size, output_size);
+  }
+  for (size_t i = 0; i < output_size; ++i) {
+    if (output[i] != expected[i]) {
+      return u7_errnof(EINVAL,
+                       "%s: value %zu: expected %" PRId64 ", got %" PRId64,
+                       name, i, expected[i], output[i]);
+    }
+  }
+  return u7_ok();
+}
+
+static u7_error test_arithmetic() {
+  static const char text[] =
+      "# Comments are ignored.\n"
+      "i64 a, b, c\n"
+      "\n"
+      "read a  // as are the trailing ones\n"
+      "b = a * 3\n"
+      "c = b + -4\n"
+      "write c\n"
+      "c = a << 4\n"
+      "write c\n"
+      "c = c >> 2\n"
+      "write c\n"
+      "c = c & 6\n"
+      "write c\n"
+      "write 17\n"
+      "ret\n";
+  int64_t const input[] = {5};
+  int64_t const expected[] = {11, 80, 20, 4, 17};
+  return check_program("arithmetic", text, input, 1, expected,
+                       sizeof(expected) / sizeof(expected[0]));
+}
+
+// Several labels may be defined on one line, and labels may be used before
+// they are defined.
+static u7_error test_labels() {
+  static const char text[] =
+      "i64 n\n"
+      "read n\n"
+      "jmp start\n"
+      "write -1\n"
+      "start: first: second: jz n, zero\n"
+      "write 1\n"
+      "jmp end\n"
+      "zero:\n"
+      "write 0\n"
+      "end: ret\n";
+  int64_t const inputs[] = {0, 3};
+  int64_t const expected[] = {0, 1};
+  for (size_t i = 0; i < 2; ++i) {
+    u7_error error =
+        check_program("labels", text, &inputs[i], 1, &expected[i], 1);
+    if (error.error_code != 0) {
+      return error;
+    }
+  }
+  return u7_ok();
+}
+
+// `v` is `v[0]`; `read v, 3` fills v[0], v[1] and v[2].
+static u7_error test_arrays() {
+  static const char text[] =
+      "i64 v[3], s\n"
+      "read v, 3\n"
+      "s = v + v[1]\n"
+      "s = s + v[2]\n"
+      "write s\n"
+      "write v[1], 2\n"
+      "ret\n";
+  int64_t const input[] = {1, 20, 300};
+  int64_t const expected[] = {321, 20, 300};
+  return check_program("arrays", text, input, 3, expected,
+                       sizeof(expected) / sizeof(expected[0]));
+}
+
+// Checks that the text is rejected with EINVAL and a message that contains
+// `fragment`.
+static u7_error expect_syntax_error(const char* name, const char* text,
+                                   const char* fragment) {
+  struct u7_vm0_program program;
+  u7_error error = u7_vm0_assemble(&program, text, strlen(text));
+  if (error.error_code == 0) {
+    u7_vm0_program_destroy(&program);
+    return u7_errnof(EINVAL, "%s: expected error %d, got success", name,
+                     EINVAL);
+  }
+  char message[256];
+  snprintf(message, sizeof(message), "%" U7_ERROR_FMT,
+           U7_ERROR_FMT_PARAMS(error));
+  if (error.error_code == EINVAL && strstr(message, fragment) == NULL) {
+    u7_error_release(error);
+    return u7_errnof(EINVAL, "%s: expected '%s' in the message, got '%s'",
+                     name, fragment, message);
+  }
+  return u7_vm0_test_expect_error(name, error, EINVAL);
+}
+
+static u7_error test_syntax_errors() {
+  static const struct {
+    const char* name;
+    const char* text;
+    const char* fragment;
+  } cases[] = {
+      {"unknown statement", "i64 a\nfoo bar\nret\n",
+       "line 2: unknown variable: foo"},
+      {"missing operand", "i64 a\na = a +\nret\n",
+       "line 2: expected a number"},
+      {"unknown operator", "i64 a\na = a - 1\nret\n",
+       "line 2: expected an operator"},
+      {"trailing text", "i64 a\nread a a\nret\n", "line 2: unexpected text"},
+      {"bad number", "i64 a\na = 12x\nret\n", "line 2: bad number"},
+      {"i32 out of range", "i32 a\na = 3000000000\nret\n",
+       "line 2: expected an i32 constant"},
+      {"undeclared variable", "i64 a\nread b\nret\n",
+       "line 2: unknown variable: b"},
+      {"duplicate local", "i64 a\nf64 a\nret\n", "line 2: duplicate name: a"},
+      {"duplicate label", "x: ret\nx: ret\n", "line 2: duplicate name: x"},
+      {"label is a local", "i64 a\njmp a\nret\n", "line 2: not a label: a"},
+      {"reserved name", "i64 ret\nret\n", "line 1: reserved name: ret"},
+      {"index out of the array", "i64 v[2]\nread v[2]\nret\n",
+       "line 2: bad index of v"},
+      {"missing goto", "i64 a\nif a < 1 loop\nret\n",
+       "line 2: expected 'goto'"},
+      {"missing comparison", "i64 a\nif a 1 goto x\nx: ret\n",
+       "line 2: expected a comparison"},
+      {"right shift by a variable", "i64 a\na = a >> a\nret\n",
+       "line 2: right shift by a variable"},
+      // The errors of the instruction constructors carry the line as well.
+      {"shift out of range", "i64 a\nread a\na = a >> 64\nret\n",
+       "line 3: u7_vm0_bitwise_left_shift"},
+      {"statement after a label", "x: 1\nret\n",
+       "line 1: expected a statement"},
+  };
+  for (size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); ++i) {
+    u7_error error = expect_syntax_error(cases[i].name, cases[i].text,
+                                         cases[i].fragment);
+    if (error.error_code != 0) {
+      return error;
+    }
+  }
+  return u7_ok();
+}
+
+// An undefined label is reported at the line of its first use.
+static u7_error test_undefined_label() {
+  static const char text[] =
+      "i64 n\n"
+      "read n\n"
+      "loop: jz n, done\n"
+      "n = n + -1\n"
+      "jnz n, loop\n"
+      "jmp finish\n"
+      "done: ret\n";
+  return expect_syntax_error("undefined label", text,
+                             "line 6: undefined label: finish");
+}
+
+// The program falls off its end without `ret`; the verifier rejects it.
+static u7_error test_unverified() {
+  static const char text[] = "i64 a\nread a\n";
+  struct u7_vm0_program program;
+  return u7_vm0_test_expect_error(
+      "unverified", u7_vm0_assemble(&program, text, strlen(text)), EINVAL);
+}
+
+int main() {
+  u7_error (*const tests[])() = {
+      &test_arithmetic,    &test_labels,          &test_arrays,
+      &test_syntax_errors, &test_undefined_label, &test_unverified,
+  };
+  return u7_vm0_test_main(tests, sizeof(tests) / sizeof(tests[0]));
+}
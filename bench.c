@@ -0,0 +1,960 @@
+#include "@/public/vm0.h"
+
+#include "@/public/compact.h"
+#include "@/public/fuse.h"
+#include "@/public/jit.h"
+#include "@/public/opcode.h"
+#include "@/public/pool.h"
+#include "@/public/threaded.h"
+#include "@/public/verify.h"
+
+#include <errno.h>
+#include <github.com/apronchenkov/error/public/error.h>
+#include <github.com/apronchenkov/vm/public/stack_push_pop.h>
+#include <github.com/apronchenkov/vm/public/state.h>
+#include <github.com/apronchenkov/yalog/public/basic.h>
+#include <github.com/apronchenkov/yalog/public/logging_printf.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+// Input that always reads the same number.
+struct bench_input {
+  struct u7_vm0_input base;
+  int64_t value;
+};
+
+static u7_error bench_read_i64(struct u7_vm0_input* self, int64_t* result) {
+  *result = ((struct bench_input*)self)->value;
+  return u7_ok();
+}
+
+// Output that remembers the last written number.
+struct bench_output {
+  struct u7_vm0_output base;
+  double last;
+};
+
+static u7_error bench_write_i64(struct u7_vm0_output* self, int64_t value) {
+  ((struct bench_output*)self)->last = (double)value;
+  return u7_ok();
+}
+
+static u7_error bench_write_f64(struct u7_vm0_output* self, double value) {
+  ((struct bench_output*)self)->last = value;
+  return u7_ok();
+}
+
+static double now_ns() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+struct fibonacci_locals {
+  int64_t n;
+  int64_t t;
+  double x00, x01, x10, x11;
+  double m00, m01, m10, m11;
+  double s0, s1, s2, s3, s4, s5, s6, s7;
+};
+
+static struct u7_vm_stack_frame_layout fibonacci_frame_layout = {
+    .locals_size = sizeof(struct fibonacci_locals),
+    .description = "fibonacci_locals",
+};
+
+#define FIBONACCI_VAR(type, field)                                      \
+  ((struct u7_vm0_arg){                                                 \
+      .kind = U7_VM0_ARG_KIND_##type##_VARIABLE,                        \
+      .value = {.i64 = u7_vm_offsetof(struct fibonacci_locals, field)}, \
+  })
+
+enum { FIBONACCI_PROGRAM_SIZE = 39 };
+
+// The program from test.c: computes the Fibonacci number by 2x2 matrix
+// exponentiation.
+static u7_error fibonacci_program(struct u7_vm0_instruction* is,
+                                  size_t* isn) {
+  struct u7_vm0_arg f64_0 = {.kind = U7_VM0_ARG_KIND_F64_CONSTANT,
+                             .value = {.f64 = 0.0}};
+  struct u7_vm0_arg f64_1 = {.kind = U7_VM0_ARG_KIND_F64_CONSTANT,
+                             .value = {.f64 = 1.0}};
+  struct u7_vm0_arg i64_1 = {.kind = U7_VM0_ARG_KIND_I64_CONSTANT,
+                             .value = {.i64 = 1}};
+  struct u7_vm0_arg i64_neg_1 = {.kind = U7_VM0_ARG_KIND_I64_CONSTANT,
+                                 .value = {.i64 = -1}};
+  struct u7_vm0_arg label_loop = {.kind = U7_VM0_ARG_KIND_I64_LABEL,
+                                  .value = {.i64 = 9}};
+  struct u7_vm0_arg label_next = {.kind = U7_VM0_ARG_KIND_I64_LABEL,
+                                  .value = {.i64 = 23}};
+  u7_error error = u7_ok();
+  const struct u7_vm0_instruction program[FIBONACCI_PROGRAM_SIZE] = {
+      u7_vm0_input(&error, FIBONACCI_VAR(I64, n)),
+      u7_vm0_copy(&error, FIBONACCI_VAR(F64, x00), f64_1),
+      u7_vm0_copy(&error, FIBONACCI_VAR(F64, x01), f64_0),
+      u7_vm0_copy(&error, FIBONACCI_VAR(F64, x10), f64_0),
+      u7_vm0_copy(&error, FIBONACCI_VAR(F64, x11), f64_1),
+      u7_vm0_copy(&error, FIBONACCI_VAR(F64, m00), f64_0),
+      u7_vm0_copy(&error, FIBONACCI_VAR(F64, m01), f64_1),
+      u7_vm0_copy(&error, FIBONACCI_VAR(F64, m10), f64_1),
+      u7_vm0_copy(&error, FIBONACCI_VAR(F64, m11), f64_1),
+      // loop:
+      u7_vm0_bitwise_and(&error, FIBONACCI_VAR(I64, t), FIBONACCI_VAR(I64, n),
+                         i64_1),
+      u7_vm0_jump_if_zero(&error, FIBONACCI_VAR(I64, t), label_next),
+      u7_vm0_math_multiply(&error, FIBONACCI_VAR(F64, s0),
+                           FIBONACCI_VAR(F64, x00), FIBONACCI_VAR(F64, m00)),
+      u7_vm0_math_multiply(&error, FIBONACCI_VAR(F64, s1),
+                           FIBONACCI_VAR(F64, x01), FIBONACCI_VAR(F64, m10)),
+      u7_vm0_math_multiply(&error, FIBONACCI_VAR(F64, s2),
+                           FIBONACCI_VAR(F64, x00), FIBONACCI_VAR(F64, m01)),
+      u7_vm0_math_multiply(&error, FIBONACCI_VAR(F64, s3),
+                           FIBONACCI_VAR(F64, x01), FIBONACCI_VAR(F64, m11)),
+      u7_vm0_math_multiply(&error, FIBONACCI_VAR(F64, s4),
+                           FIBONACCI_VAR(F64, x10), FIBONACCI_VAR(F64, m00)),
+      u7_vm0_math_multiply(&error, FIBONACCI_VAR(F64, s5),
+                           FIBONACCI_VAR(F64, x11), FIBONACCI_VAR(F64, m10)),
+      u7_vm0_math_multiply(&error, FIBONACCI_VAR(F64, s6),
+                           FIBONACCI_VAR(F64, x10), FIBONACCI_VAR(F64, m01)),
+      u7_vm0_math_multiply(&error, FIBONACCI_VAR(F64, s7),
+                           FIBONACCI_VAR(F64, x11), FIBONACCI_VAR(F64, m11)),
+      u7_vm0_math_add(&error, FIBONACCI_VAR(F64, x00), FIBONACCI_VAR(F64, s0),
+                      FIBONACCI_VAR(F64, s1)),
+      u7_vm0_math_add(&error, FIBONACCI_VAR(F64, x01), FIBONACCI_VAR(F64, s2),
+                      FIBONACCI_VAR(F64, s3)),
+      u7_vm0_math_add(&error, FIBONACCI_VAR(F64, x10), FIBONACCI_VAR(F64, s4),
+                      FIBONACCI_VAR(F64, s5)),
+      u7_vm0_math_add(&error, FIBONACCI_VAR(F64, x11), FIBONACCI_VAR(F64, s6),
+                      FIBONACCI_VAR(F64, s7)),
+      // next:
+      u7_vm0_math_multiply(&error, FIBONACCI_VAR(F64, s0),
+                           FIBONACCI_VAR(F64, m00), FIBONACCI_VAR(F64, m00)),
+      u7_vm0_math_multiply(&error, FIBONACCI_VAR(F64, s1),
+                           FIBONACCI_VAR(F64, m01), FIBONACCI_VAR(F64, m10)),
+      u7_vm0_math_multiply(&error, FIBONACCI_VAR(F64, s2),
+                           FIBONACCI_VAR(F64, m00), FIBONACCI_VAR(F64, m01)),
+      u7_vm0_math_multiply(&error, FIBONACCI_VAR(F64, s3),
+                           FIBONACCI_VAR(F64, m01), FIBONACCI_VAR(F64, m11)),
+      u7_vm0_math_multiply(&error, FIBONACCI_VAR(F64, s4),
+                           FIBONACCI_VAR(F64, m10), FIBONACCI_VAR(F64, m00)),
+      u7_vm0_math_multiply(&error, FIBONACCI_VAR(F64, s5),
+                           FIBONACCI_VAR(F64, m11), FIBONACCI_VAR(F64, m10)),
+      u7_vm0_math_multiply(&error, FIBONACCI_VAR(F64, s6),
+                           FIBONACCI_VAR(F64, m10), FIBONACCI_VAR(F64, m01)),
+      u7_vm0_math_multiply(&error, FIBONACCI_VAR(F64, s7),
+                           FIBONACCI_VAR(F64, m11), FIBONACCI_VAR(F64, m11)),
+      u7_vm0_math_add(&error, FIBONACCI_VAR(F64, m00), FIBONACCI_VAR(F64, s0),
+                      FIBONACCI_VAR(F64, s1)),
+      u7_vm0_math_add(&error, FIBONACCI_VAR(F64, m01), FIBONACCI_VAR(F64, s2),
+                      FIBONACCI_VAR(F64, s3)),
+      u7_vm0_math_add(&error, FIBONACCI_VAR(F64, m10), FIBONACCI_VAR(F64, s4),
+                      FIBONACCI_VAR(F64, s5)),
+      u7_vm0_math_add(&error, FIBONACCI_VAR(F64, m11), FIBONACCI_VAR(F64, s6),
+                      FIBONACCI_VAR(F64, s7)),
+      u7_vm0_bitwise_left_shift(&error, FIBONACCI_VAR(I64, n),
+                                FIBONACCI_VAR(I64, n), i64_neg_1),
+      u7_vm0_jump_if_not_zero(&error, FIBONACCI_VAR(I64, n), label_loop),
+      u7_vm0_output(&error, FIBONACCI_VAR(F64, x01)),
+      u7_vm0_ret(),
+  };
+  if (error.error_code != 0) {
+    return error;
+  }
+  for (int i = 0; i < FIBONACCI_PROGRAM_SIZE; ++i) {
+    is[i] = program[i];
+  }
+  *isn = FIBONACCI_PROGRAM_SIZE;
+  return u7_vm0_verify(is, FIBONACCI_PROGRAM_SIZE, &fibonacci_frame_layout);
+}
+
+enum { FIBONACCI_MATRIX_PROGRAM_SIZE = 17 };
+
+// The same program, with the 2x2 matrix products done by
+// u7_vm0_matrix_multiply(); x and m are stored row-major.
+static u7_error fibonacci_matrix_program(struct u7_vm0_instruction* is,
+                                         size_t* isn) {
+  struct u7_vm0_arg f64_0 = {.kind = U7_VM0_ARG_KIND_F64_CONSTANT,
+                             .value = {.f64 = 0.0}};
+  struct u7_vm0_arg f64_1 = {.kind = U7_VM0_ARG_KIND_F64_CONSTANT,
+                             .value = {.f64 = 1.0}};
+  struct u7_vm0_arg i64_1 = {.kind = U7_VM0_ARG_KIND_I64_CONSTANT,
+                             .value = {.i64 = 1}};
+  struct u7_vm0_arg i64_neg_1 = {.kind = U7_VM0_ARG_KIND_I64_CONSTANT,
+                                 .value = {.i64 = -1}};
+  struct u7_vm0_arg label_loop = {.kind = U7_VM0_ARG_KIND_I64_LABEL,
+                                  .value = {.i64 = 9}};
+  struct u7_vm0_arg label_next = {.kind = U7_VM0_ARG_KIND_I64_LABEL,
+                                  .value = {.i64 = 12}};
+  u7_error error = u7_ok();
+  const struct u7_vm0_instruction program[FIBONACCI_MATRIX_PROGRAM_SIZE] = {
+      u7_vm0_input(&error, FIBONACCI_VAR(I64, n)),
+      u7_vm0_copy(&error, FIBONACCI_VAR(F64, x00), f64_1),
+      u7_vm0_copy(&error, FIBONACCI_VAR(F64, x01), f64_0),
+      u7_vm0_copy(&error, FIBONACCI_VAR(F64, x10), f64_0),
+      u7_vm0_copy(&error, FIBONACCI_VAR(F64, x11), f64_1),
+      u7_vm0_copy(&error, FIBONACCI_VAR(F64, m00), f64_0),
+      u7_vm0_copy(&error, FIBONACCI_VAR(F64, m01), f64_1),
+      u7_vm0_copy(&error, FIBONACCI_VAR(F64, m10), f64_1),
+      u7_vm0_copy(&error, FIBONACCI_VAR(F64, m11), f64_1),
+      // loop:
+      u7_vm0_bitwise_and(&error, FIBONACCI_VAR(I64, t), FIBONACCI_VAR(I64, n),
+                         i64_1),
+      u7_vm0_jump_if_zero(&error, FIBONACCI_VAR(I64, t), label_next),
+      u7_vm0_matrix_multiply(&error, FIBONACCI_VAR(F64, x00),
+                             FIBONACCI_VAR(F64, x00), FIBONACCI_VAR(F64, m00),
+                             2),
+      // next:
+      u7_vm0_matrix_multiply(&error, FIBONACCI_VAR(F64, m00),
+                             FIBONACCI_VAR(F64, m00), FIBONACCI_VAR(F64, m00),
+                             2),
+      u7_vm0_bitwise_left_shift(&error, FIBONACCI_VAR(I64, n),
+                                FIBONACCI_VAR(I64, n), i64_neg_1),
+      u7_vm0_jump_if_not_zero(&error, FIBONACCI_VAR(I64, n), label_loop),
+      u7_vm0_output(&error, FIBONACCI_VAR(F64, x01)),
+      u7_vm0_ret(),
+  };
+  if (error.error_code != 0) {
+    return error;
+  }
+  for (int i = 0; i < FIBONACCI_MATRIX_PROGRAM_SIZE; ++i) {
+    is[i] = program[i];
+  }
+  *isn = FIBONACCI_MATRIX_PROGRAM_SIZE;
+  return u7_vm0_verify(is, FIBONACCI_MATRIX_PROGRAM_SIZE,
+                       &fibonacci_frame_layout);
+}
+
+struct countdown_locals {
+  int64_t n;
+  int64_t count;
+};
+
+static struct u7_vm_stack_frame_layout countdown_frame_layout = {
+    .locals_size = sizeof(struct countdown_locals),
+    .description = "countdown_locals",
+};
+
+#define COUNTDOWN_VAR(field)                                            \
+  ((struct u7_vm0_arg){                                                 \
+      .kind = U7_VM0_ARG_KIND_I64_VARIABLE,                             \
+      .value = {.i64 = u7_vm_offsetof(struct countdown_locals, field)}, \
+  })
+
+enum { COUNTDOWN_PROGRAM_SIZE = 7 };
+
+// A tight integer loop: counts the iterations down from n.
+static u7_error countdown_program(struct u7_vm0_instruction* is,
+                                  size_t* isn) {
+  struct u7_vm0_arg i64_0 = {.kind = U7_VM0_ARG_KIND_I64_CONSTANT,
+                             .value = {.i64 = 0}};
+  struct u7_vm0_arg i64_1 = {.kind = U7_VM0_ARG_KIND_I64_CONSTANT,
+                             .value = {.i64 = 1}};
+  struct u7_vm0_arg i64_neg_1 = {.kind = U7_VM0_ARG_KIND_I64_CONSTANT,
+                                 .value = {.i64 = -1}};
+  struct u7_vm0_arg label_loop = {.kind = U7_VM0_ARG_KIND_I64_LABEL,
+                                  .value = {.i64 = 2}};
+  u7_error error = u7_ok();
+  const struct u7_vm0_instruction program[COUNTDOWN_PROGRAM_SIZE] = {
+      u7_vm0_input(&error, COUNTDOWN_VAR(n)),
+      u7_vm0_copy(&error, COUNTDOWN_VAR(count), i64_0),
+      // loop:
+      u7_vm0_math_add(&error, COUNTDOWN_VAR(count), COUNTDOWN_VAR(count),
+                      i64_1),
+      u7_vm0_math_add(&error, COUNTDOWN_VAR(n), COUNTDOWN_VAR(n), i64_neg_1),
+      u7_vm0_jump_if_not_zero(&error, COUNTDOWN_VAR(n), label_loop),
+      u7_vm0_output(&error, COUNTDOWN_VAR(count)),
+      u7_vm0_ret(),
+  };
+  if (error.error_code != 0) {
+    return error;
+  }
+  for (int i = 0; i < COUNTDOWN_PROGRAM_SIZE; ++i) {
+    is[i] = program[i];
+  }
+  *isn = COUNTDOWN_PROGRAM_SIZE;
+  return u7_vm0_verify(is, COUNTDOWN_PROGRAM_SIZE, &countdown_frame_layout);
+}
+
+enum { COUNTDOWN_COMPARE_PROGRAM_SIZE = 6 };
+
+// Same as countdown_program(), but counts up to n with a single
+// compare-and-branch per iteration.
+static u7_error countdown_compare_program(struct u7_vm0_instruction* is,
+                                          size_t* isn) {
+  struct u7_vm0_arg i64_0 = {.kind = U7_VM0_ARG_KIND_I64_CONSTANT,
+                             .value = {.i64 = 0}};
+  struct u7_vm0_arg i64_1 = {.kind = U7_VM0_ARG_KIND_I64_CONSTANT,
+                             .value = {.i64 = 1}};
+  struct u7_vm0_arg label_loop = {.kind = U7_VM0_ARG_KIND_I64_LABEL,
+                                  .value = {.i64 = 2}};
+  u7_error error = u7_ok();
+  const struct u7_vm0_instruction program[COUNTDOWN_COMPARE_PROGRAM_SIZE] = {
+      u7_vm0_input(&error, COUNTDOWN_VAR(n)),
+      u7_vm0_copy(&error, COUNTDOWN_VAR(count), i64_0),
+      // loop:
+      u7_vm0_math_add(&error, COUNTDOWN_VAR(count), COUNTDOWN_VAR(count),
+                      i64_1),
+      u7_vm0_jump_if_less(&error, COUNTDOWN_VAR(count), COUNTDOWN_VAR(n),
+                          label_loop),
+      u7_vm0_output(&error, COUNTDOWN_VAR(count)),
+      u7_vm0_ret(),
+  };
+  if (error.error_code != 0) {
+    return error;
+  }
+  for (int i = 0; i < COUNTDOWN_COMPARE_PROGRAM_SIZE; ++i) {
+    is[i] = program[i];
+  }
+  *isn = COUNTDOWN_COMPARE_PROGRAM_SIZE;
+  return u7_vm0_verify(is, COUNTDOWN_COMPARE_PROGRAM_SIZE,
+                       &countdown_frame_layout);
+}
+
+enum { COUNTDOWN_CALL_PROGRAM_SIZE = 10 };
+
+// Same as countdown_program(), but the loop is a self-recursive function,
+// which reuses its frame for the tail calls.
+static u7_error countdown_call_program(struct u7_vm0_instruction* is,
+                                       size_t* isn) {
+  struct u7_vm0_arg i64_0 = {.kind = U7_VM0_ARG_KIND_I64_CONSTANT,
+                             .value = {.i64 = 0}};
+  struct u7_vm0_arg i64_1 = {.kind = U7_VM0_ARG_KIND_I64_CONSTANT,
+                             .value = {.i64 = 1}};
+  struct u7_vm0_arg i64_neg_1 = {.kind = U7_VM0_ARG_KIND_I64_CONSTANT,
+                                 .value = {.i64 = -1}};
+  struct u7_vm0_arg label_function = {.kind = U7_VM0_ARG_KIND_I64_LABEL,
+                                      .value = {.i64 = 5}};
+  struct u7_vm0_arg label_return = {.kind = U7_VM0_ARG_KIND_I64_LABEL,
+                                    .value = {.i64 = 9}};
+  u7_error error = u7_ok();
+  const struct u7_vm0_instruction program[COUNTDOWN_CALL_PROGRAM_SIZE] = {
+      u7_vm0_input(&error, COUNTDOWN_VAR(n)),
+      u7_vm0_copy(&error, COUNTDOWN_VAR(count), i64_0),
+      // n = countdown(n, count)
+      u7_vm0_call(&error, label_function, &countdown_frame_layout,
+                  COUNTDOWN_VAR(n), 2),
+      u7_vm0_output(&error, COUNTDOWN_VAR(n)),
+      u7_vm0_ret(),
+      // countdown(n, count):
+      u7_vm0_jump_if_zero(&error, COUNTDOWN_VAR(n), label_return),
+      u7_vm0_math_add(&error, COUNTDOWN_VAR(count), COUNTDOWN_VAR(count),
+                      i64_1),
+      u7_vm0_math_add(&error, COUNTDOWN_VAR(n), COUNTDOWN_VAR(n), i64_neg_1),
+      u7_vm0_tail_call(&error, label_function, &countdown_frame_layout,
+                       COUNTDOWN_VAR(n), 2),
+      u7_vm0_ret_value(&error, COUNTDOWN_VAR(count)),
+  };
+  if (error.error_code != 0) {
+    return error;
+  }
+  for (int i = 0; i < COUNTDOWN_CALL_PROGRAM_SIZE; ++i) {
+    is[i] = program[i];
+  }
+  *isn = COUNTDOWN_CALL_PROGRAM_SIZE;
+  return u7_vm0_verify(is, COUNTDOWN_CALL_PROGRAM_SIZE,
+                       &countdown_frame_layout);
+}
+
+struct state_machine_locals {
+  int64_t n;
+  int64_t count;
+  int64_t state;
+};
+
+static struct u7_vm_stack_frame_layout state_machine_frame_layout = {
+    .locals_size = sizeof(struct state_machine_locals),
+    .description = "state_machine_locals",
+};
+
+#define STATE_MACHINE_VAR(field)                                            \
+  ((struct u7_vm0_arg){                                                     \
+      .kind = U7_VM0_ARG_KIND_I64_VARIABLE,                                 \
+      .value = {.i64 = u7_vm_offsetof(struct state_machine_locals, field)}, \
+  })
+
+#define STATE_MACHINE_LABEL(index)                        \
+  ((struct u7_vm0_arg){.kind = U7_VM0_ARG_KIND_I64_LABEL, \
+                       .value = {.i64 = (index)}})
+
+enum { STATE_MACHINE_PROGRAM_SIZE = 23 };
+
+// Makes n steps through four states that follow each other in a cycle; each
+// state adds its number to the count. The dispatch on the state is a jump
+// table.
+static u7_error state_machine_program(struct u7_vm0_instruction* is,
+                                      size_t* isn) {
+  struct u7_vm0_arg i64_0 = {.kind = U7_VM0_ARG_KIND_I64_CONSTANT,
+                             .value = {.i64 = 0}};
+  struct u7_vm0_arg i64_1 = {.kind = U7_VM0_ARG_KIND_I64_CONSTANT,
+                             .value = {.i64 = 1}};
+  struct u7_vm0_arg i64_2 = {.kind = U7_VM0_ARG_KIND_I64_CONSTANT,
+                             .value = {.i64 = 2}};
+  struct u7_vm0_arg i64_3 = {.kind = U7_VM0_ARG_KIND_I64_CONSTANT,
+                             .value = {.i64 = 3}};
+  struct u7_vm0_arg i64_4 = {.kind = U7_VM0_ARG_KIND_I64_CONSTANT,
+                             .value = {.i64 = 4}};
+  struct u7_vm0_arg i64_neg_1 = {.kind = U7_VM0_ARG_KIND_I64_CONSTANT,
+                                 .value = {.i64 = -1}};
+  u7_error error = u7_ok();
+  const struct u7_vm0_instruction program[STATE_MACHINE_PROGRAM_SIZE] = {
+      u7_vm0_input(&error, STATE_MACHINE_VAR(n)),
+      u7_vm0_copy(&error, STATE_MACHINE_VAR(count), i64_0),
+      u7_vm0_copy(&error, STATE_MACHINE_VAR(state), i64_0),
+      // loop:
+      u7_vm0_jump_table(&error, STATE_MACHINE_VAR(state), 4,
+                        STATE_MACHINE_LABEL(21)),
+      u7_vm0_jump(&error, STATE_MACHINE_LABEL(8)),
+      u7_vm0_jump(&error, STATE_MACHINE_LABEL(11)),
+      u7_vm0_jump(&error, STATE_MACHINE_LABEL(14)),
+      u7_vm0_jump(&error, STATE_MACHINE_LABEL(17)),
+      // state 0:
+      u7_vm0_math_add(&error, STATE_MACHINE_VAR(count),
+                      STATE_MACHINE_VAR(count), i64_1),
+      u7_vm0_copy(&error, STATE_MACHINE_VAR(state), i64_1),
+      u7_vm0_jump(&error, STATE_MACHINE_LABEL(19)),
+      // state 1:
+      u7_vm0_math_add(&error, STATE_MACHINE_VAR(count),
+                      STATE_MACHINE_VAR(count), i64_2),
+      u7_vm0_copy(&error, STATE_MACHINE_VAR(state), i64_2),
+      u7_vm0_jump(&error, STATE_MACHINE_LABEL(19)),
+      // state 2:
+      u7_vm0_math_add(&error, STATE_MACHINE_VAR(count),
+                      STATE_MACHINE_VAR(count), i64_3),
+      u7_vm0_copy(&error, STATE_MACHINE_VAR(state), i64_3),
+      u7_vm0_jump(&error, STATE_MACHINE_LABEL(19)),
+      // state 3:
+      u7_vm0_math_add(&error, STATE_MACHINE_VAR(count),
+                      STATE_MACHINE_VAR(count), i64_4),
+      u7_vm0_copy(&error, STATE_MACHINE_VAR(state), i64_0),
+      // next:
+      u7_vm0_math_add(&error, STATE_MACHINE_VAR(n), STATE_MACHINE_VAR(n),
+                      i64_neg_1),
+      u7_vm0_jump_if_not_zero(&error, STATE_MACHINE_VAR(n),
+                              STATE_MACHINE_LABEL(3)),
+      // end:
+      u7_vm0_output(&error, STATE_MACHINE_VAR(count)),
+      u7_vm0_ret(),
+  };
+  if (error.error_code != 0) {
+    return error;
+  }
+  for (int i = 0; i < STATE_MACHINE_PROGRAM_SIZE; ++i) {
+    is[i] = program[i];
+  }
+  *isn = STATE_MACHINE_PROGRAM_SIZE;
+  return u7_vm0_verify(is, STATE_MACHINE_PROGRAM_SIZE,
+                       &state_machine_frame_layout);
+}
+
+enum { BENCH_MAX_PROGRAM_SIZE = 64 };
+
+struct bench_kernel {
+  u7_error (*program_fn)(struct u7_vm0_instruction* is, size_t* isn);
+  struct u7_vm_stack_frame_layout const* frame_layout;
+  int64_t input;
+};
+
+static const struct bench_kernel fibonacci_kernel = {
+    .program_fn = &fibonacci_program,
+    .frame_layout = &fibonacci_frame_layout,
+    .input = 1023,  // 10 iterations, all branches taken.
+};
+
+static const struct bench_kernel fibonacci_matrix_kernel = {
+    .program_fn = &fibonacci_matrix_program,
+    .frame_layout = &fibonacci_frame_layout,
+    .input = 1023,
+};
+
+static const struct bench_kernel countdown_kernel = {
+    .program_fn = &countdown_program,
+    .frame_layout = &countdown_frame_layout,
+    .input = 1000,
+};
+
+static const struct bench_kernel countdown_compare_kernel = {
+    .program_fn = &countdown_compare_program,
+    .frame_layout = &countdown_frame_layout,
+    .input = 1000,
+};
+
+static const struct bench_kernel countdown_call_kernel = {
+    .program_fn = &countdown_call_program,
+    .frame_layout = &countdown_frame_layout,
+    .input = 1000,
+};
+
+static const struct bench_kernel state_machine_kernel = {
+    .program_fn = &state_machine_program,
+    .frame_layout = &state_machine_frame_layout,
+    .input = 1000,
+};
+
+enum bench_engine {
+  BENCH_ENGINE_LOOP,
+  BENCH_ENGINE_THREADED,
+  BENCH_ENGINE_COMPACT,
+  BENCH_ENGINE_JIT,
+};
+
+static u7_error bench_kernel(struct bench_kernel const* kernel,
+                             enum bench_engine engine, bool fuse,
+                             const char* name, int64_t runs) {
+  struct u7_vm0_instruction is[BENCH_MAX_PROGRAM_SIZE];
+  size_t isn = 0;
+  u7_error error = kernel->program_fn(is, &isn);
+  if (error.error_code == 0 && fuse) {
+    error = u7_vm0_fuse(is, &isn);
+  }
+  if (error.error_code != 0) {
+    return error;
+  }
+  struct u7_vm_instruction const* js[BENCH_MAX_PROGRAM_SIZE];
+  for (size_t i = 0; i < isn; ++i) {
+    js[i] = &is[i].base;
+  }
+  struct u7_vm0_threaded_program threaded;
+  error = u7_vm0_threaded_program_init(&threaded, is, isn);
+  if (error.error_code != 0) {
+    return error;
+  }
+  struct u7_vm0_compact_program compact;
+  error = u7_vm0_compact_program_init(&compact, is, isn);
+  if (error.error_code != 0) {
+    u7_vm0_threaded_program_destroy(&threaded);
+    return error;
+  }
+  struct u7_vm0_jit_program jit;
+  error = u7_vm0_jit_program_init(&jit, is, isn);
+  if (error.error_code != 0) {
+    u7_vm0_compact_program_destroy(&compact);
+    u7_vm0_threaded_program_destroy(&threaded);
+    return error;
+  }
+  struct u7_vm_state state;
+  error = u7_vm_state_init(&state, u7_vm0_globals_frame_layout, &js[0], isn);
+  if (error.error_code != 0) {
+    u7_vm0_jit_program_destroy(&jit);
+    u7_vm0_compact_program_destroy(&compact);
+    u7_vm0_threaded_program_destroy(&threaded);
+    return error;
+  }
+  error = u7_vm_stack_push_frame(&state.stack, kernel->frame_layout);
+  if (error.error_code != 0) {
+    u7_vm_state_destroy(&state);
+    u7_vm0_jit_program_destroy(&jit);
+    u7_vm0_compact_program_destroy(&compact);
+    u7_vm0_threaded_program_destroy(&threaded);
+    return error;
+  }
+  struct bench_input input = {
+      .base = {.read_i64_fn = &bench_read_i64},
+      .value = kernel->input,
+  };
+  struct bench_output output = {
+      .base = {.write_i64_fn = &bench_write_i64,
+               .write_f64_fn = &bench_write_f64},
+  };
+  u7_vm0_state_globals(&state)->input = &input.base;
+  u7_vm0_state_globals(&state)->output = &output.base;
+
+  const double start_ns = now_ns();
+  for (int64_t i = 0; i < runs && error.error_code == 0; ++i) {
+    if (engine == BENCH_ENGINE_THREADED) {
+      u7_vm0_threaded_run(&threaded, &state);
+    } else if (engine == BENCH_ENGINE_COMPACT) {
+      u7_vm0_compact_run(&compact, &state);
+    } else if (engine == BENCH_ENGINE_JIT) {
+      u7_vm0_jit_run(&jit, &state);
+    } else {
+      u7_vm_state_run(&state);
+    }
+    error = u7_vm0_state_take_error(&state);
+  }
+  const double elapsed_ns = now_ns() - start_ns;
+  u7_vm_state_destroy(&state);
+  u7_vm0_jit_program_destroy(&jit);
+  u7_vm0_compact_program_destroy(&compact);
+  u7_vm0_threaded_program_destroy(&threaded);
+  if (error.error_code != 0) {
+    return error;
+  }
+  printf("%-48s %10.1f ns/run  (result=%g)\n", name, elapsed_ns / runs,
+         output.last);
+  return u7_ok();
+}
+
+// Measures the cost of a short execution with a fresh state per run: either
+// initialized and destroyed every time, or acquired from a state pool.
+static u7_error bench_state(bool pooled, const char* name, int64_t runs) {
+  struct u7_vm0_instruction is[BENCH_MAX_PROGRAM_SIZE];
+  size_t isn = 0;
+  u7_error error = countdown_program(is, &isn);
+  if (error.error_code != 0) {
+    return error;
+  }
+  struct u7_vm_instruction const* js[BENCH_MAX_PROGRAM_SIZE];
+  for (size_t i = 0; i < isn; ++i) {
+    js[i] = &is[i].base;
+  }
+  struct bench_input input = {
+      .base = {.read_i64_fn = &bench_read_i64},
+      .value = 1,
+  };
+  struct bench_output output = {
+      .base = {.write_i64_fn = &bench_write_i64},
+  };
+  struct u7_vm0_state_pool pool;
+  error = u7_vm0_state_pool_init(&pool, js, isn, &countdown_frame_layout,
+                                 NULL);
+  if (error.error_code != 0) {
+    return error;
+  }
+  pool.input = &input.base;
+  pool.output = &output.base;
+
+  const double start_ns = now_ns();
+  for (int64_t i = 0; i < runs && error.error_code == 0; ++i) {
+    struct u7_vm_state* state;
+    struct u7_vm_state fresh;
+    if (pooled) {
+      error = u7_vm0_state_pool_acquire(&pool, &state);
+    } else {
+      state = &fresh;
+      error = u7_vm_state_init(state, u7_vm0_globals_frame_layout, js, isn);
+      if (error.error_code == 0) {
+        error = u7_vm_stack_push_frame(&state->stack, &countdown_frame_layout);
+        if (error.error_code != 0) {
+          u7_vm_state_destroy(state);
+        }
+      }
+      if (error.error_code == 0) {
+        u7_vm0_state_globals(state)->input = &input.base;
+        u7_vm0_state_globals(state)->output = &output.base;
+      }
+    }
+    if (error.error_code != 0) {
+      break;
+    }
+    u7_vm_state_run(state);
+    error = u7_vm0_state_take_error(state);
+    if (pooled) {
+      u7_vm0_state_pool_release(&pool, state);
+    } else {
+      u7_vm_state_destroy(state);
+    }
+  }
+  const double elapsed_ns = now_ns() - start_ns;
+  u7_vm0_state_pool_destroy(&pool);
+  if (error.error_code != 0) {
+    return error;
+  }
+  printf("%-48s %10.1f ns/run  (result=%g)\n", name, elapsed_ns / runs,
+         output.last);
+  return u7_ok();
+}
+
+// Local variables of the instruction benchmarks: a 32-byte region for the
+// sources and one for the destinations of every type, so that pairs and
+// arrays of up to four elements fit, and the sources keep their values.
+enum {
+  BENCH_OPCODE_SRC_OFFSET = 0,
+  BENCH_OPCODE_DST_OFFSET = 512,
+  BENCH_OPCODE_REGION_SIZE = 128,  // Up to a 4x4 matrix.
+  BENCH_OPCODE_COUNT = 4,
+  BENCH_OPCODE_REPEAT = 62,
+};
+
+static struct u7_vm_stack_frame_layout bench_opcode_frame_layout = {
+    .locals_size = 1024,
+    .description = "bench_opcode_locals",
+};
+
+// Returns the offset of the variable region for an operand kind.
+static int64_t bench_opcode_region(enum u7_vm0_operand_kind kind, bool dst) {
+  const int64_t size = u7_vm0_operand_kind_variable_size(kind);
+  const bool is_float = (kind == U7_VM0_OPERAND_F32_SRC ||
+                         kind == U7_VM0_OPERAND_F32_DST ||
+                         kind == U7_VM0_OPERAND_F32_SRC_ARRAY ||
+                         kind == U7_VM0_OPERAND_F32_DST_ARRAY ||
+                         kind == U7_VM0_OPERAND_F32_DST_SRC_ARRAY ||
+                         kind == U7_VM0_OPERAND_F32_SRC_ARRAY_PAIR ||
+                         kind == U7_VM0_OPERAND_F64_SRC ||
+                         kind == U7_VM0_OPERAND_F64_DST ||
+                         kind == U7_VM0_OPERAND_F64_SRC_PAIR ||
+                         kind == U7_VM0_OPERAND_F64_DST_PAIR ||
+                         kind == U7_VM0_OPERAND_F64_SRC_ARRAY ||
+                         kind == U7_VM0_OPERAND_F64_DST_ARRAY ||
+                         kind == U7_VM0_OPERAND_F64_DST_SRC_ARRAY ||
+                         kind == U7_VM0_OPERAND_F64_SRC_ARRAY_PAIR);
+  const int64_t region = (is_float ? 2 : 0) + (size == 8 ? 1 : 0);
+  return (dst ? BENCH_OPCODE_DST_OFFSET : BENCH_OPCODE_SRC_OFFSET) +
+         region * BENCH_OPCODE_REGION_SIZE;
+}
+
+// Returns an operand of the given kind for the instruction at `index`;
+// constants are 1, and labels point to the next instruction.
+static union u7_vm0_value bench_opcode_operand(enum u7_vm0_operand_kind kind,
+                                               size_t index) {
+  union u7_vm0_value result = {.i64 = 0};
+  switch (kind) {
+    case U7_VM0_OPERAND_NONE:
+      break;
+    case U7_VM0_OPERAND_I32_CONSTANT:
+      result.i32 = 1;
+      break;
+    case U7_VM0_OPERAND_I64_CONSTANT:
+      result.i64 = 1;
+      break;
+    case U7_VM0_OPERAND_F32_CONSTANT:
+      result.f32 = 1.0f;
+      break;
+    case U7_VM0_OPERAND_F64_CONSTANT:
+      result.f64 = 1.0;
+      break;
+    case U7_VM0_OPERAND_LABEL:
+      result.i64 = (int64_t)index + 1;
+      break;
+    case U7_VM0_OPERAND_COUNT:
+      result.i64 = BENCH_OPCODE_COUNT;
+      break;
+    case U7_VM0_OPERAND_I32_DST_SRC_PAIR:
+    case U7_VM0_OPERAND_I64_DST_SRC_PAIR:
+      result.i64 =
+          u7_vm0_operand_pair((int32_t)bench_opcode_region(kind, true),
+                              (int32_t)bench_opcode_region(kind, false));
+      break;
+    case U7_VM0_OPERAND_F64_SRC_PAIR:
+    case U7_VM0_OPERAND_F64_DST_PAIR: {
+      const int64_t region =
+          bench_opcode_region(kind, kind == U7_VM0_OPERAND_F64_DST_PAIR);
+      result.i64 =
+          u7_vm0_operand_pair((int32_t)region, (int32_t)(region + 8));
+      break;
+    }
+    case U7_VM0_OPERAND_FRAME_LAYOUT:
+      result.i64 = (int64_t)(intptr_t)&bench_opcode_frame_layout;
+      break;
+    case U7_VM0_OPERAND_SLOTS:
+      result.i64 = u7_vm0_operand_pair(
+          (int32_t)bench_opcode_region(U7_VM0_OPERAND_I64_DST, true),
+          BENCH_OPCODE_COUNT);
+      break;
+    case U7_VM0_OPERAND_I64_SRC_ARRAY_PAIR:
+    case U7_VM0_OPERAND_F32_SRC_ARRAY_PAIR:
+    case U7_VM0_OPERAND_F64_SRC_ARRAY_PAIR: {
+      const int64_t region = bench_opcode_region(kind, false);
+      result.i64 = u7_vm0_operand_pair((int32_t)region, (int32_t)region);
+      break;
+    }
+    case U7_VM0_OPERAND_I32_DST:
+    case U7_VM0_OPERAND_I64_DST:
+    case U7_VM0_OPERAND_F32_DST:
+    case U7_VM0_OPERAND_F64_DST:
+    case U7_VM0_OPERAND_I32_DST_ARRAY:
+    case U7_VM0_OPERAND_I64_DST_ARRAY:
+    case U7_VM0_OPERAND_F32_DST_ARRAY:
+    case U7_VM0_OPERAND_F64_DST_ARRAY:
+    case U7_VM0_OPERAND_F32_DST_SRC_ARRAY:
+    case U7_VM0_OPERAND_F64_DST_SRC_ARRAY:
+      result.i64 = bench_opcode_region(kind, true);
+      break;
+    default:
+      result.i64 = bench_opcode_region(kind, false);
+      break;
+  }
+  return result;
+}
+
+// Measures a single instruction variant: runs a program with the
+// instruction repeated BENCH_OPCODE_REPEAT times, followed by `ret`. The
+// I/O instructions use the in-memory backends. `yield` and `ret` stop the
+// run, so they are measured once per run and include the dispatch loop
+// entry. So are the calls, which would nest: a call jumps to the final
+// `ret`, and the time includes both returns.
+static u7_error bench_opcode(enum u7_vm0_opcode opcode, const char* name,
+                             int64_t runs) {
+  struct u7_vm0_opcode_info const* info = u7_vm0_opcode_info(opcode);
+  const bool alone = (opcode == U7_VM0_OPCODE_YIELD ||
+                      u7_vm0_opcode_is_return(opcode) ||
+                      u7_vm0_opcode_is_call(opcode));
+  const size_t repeat = (alone ? 1 : BENCH_OPCODE_REPEAT);
+  struct u7_vm0_instruction is[BENCH_OPCODE_REPEAT + 1];
+  struct u7_vm_instruction const* js[BENCH_OPCODE_REPEAT + 1];
+  size_t isn = 0;
+  for (; isn < repeat; ++isn) {
+    is[isn].base = info->base;
+    is[isn].arg1 = bench_opcode_operand(info->operand_kinds[0], isn);
+    is[isn].arg2 = bench_opcode_operand(info->operand_kinds[1], isn);
+    is[isn].arg3 = bench_opcode_operand(info->operand_kinds[2], isn);
+    const int64_t matrix_size = u7_vm0_opcode_matrix_size(opcode);
+    if (matrix_size > 0) {
+      is[isn].arg2.i64 = matrix_size * matrix_size;
+    }
+    if (u7_vm0_opcode_is_jump_table(opcode)) {
+      is[isn].arg2.i64 = 0;  // No entries: always jumps to the label.
+    }
+  }
+  if (!u7_vm0_opcode_is_return(opcode)) {
+    is[isn++] = u7_vm0_ret();
+  }
+  // The program is run as constructed, so that the variants replaced by the
+  // verifier are measured too; the verifier only checks a copy.
+  struct u7_vm0_instruction verified[BENCH_OPCODE_REPEAT + 1];
+  memcpy(verified, is, isn * sizeof(is[0]));
+  u7_error error = u7_vm0_verify(verified, isn, &bench_opcode_frame_layout);
+  if (error.error_code != 0) {
+    return error;
+  }
+  for (size_t i = 0; i < isn; ++i) {
+    js[i] = &is[i].base;
+  }
+  struct u7_vm_state state;
+  error = u7_vm_state_init(&state, u7_vm0_globals_frame_layout, &js[0], isn);
+  if (error.error_code != 0) {
+    return error;
+  }
+  error = u7_vm_stack_push_frame(&state.stack, &bench_opcode_frame_layout);
+  if (error.error_code != 0) {
+    u7_vm_state_destroy(&state);
+    return error;
+  }
+  for (int i = 0; i < BENCH_OPCODE_REGION_SIZE / 8; ++i) {
+    *u7_vm0_state_local_i32(
+        &state, bench_opcode_region(U7_VM0_OPERAND_I32_SRC, false) + 4 * i) =
+        1;
+    *u7_vm0_state_local_i64(
+        &state, bench_opcode_region(U7_VM0_OPERAND_I64_SRC, false) + 8 * i) =
+        1;
+    *u7_vm0_state_local_f32(
+        &state, bench_opcode_region(U7_VM0_OPERAND_F32_SRC, false) + 4 * i) =
+        1.0f;
+    *u7_vm0_state_local_f64(
+        &state, bench_opcode_region(U7_VM0_OPERAND_F64_SRC, false) + 8 * i) =
+        1.0;
+  }
+  static char data[BENCH_OPCODE_REPEAT * BENCH_OPCODE_COUNT * 8];
+  struct u7_vm0_memory_input input;
+  struct u7_vm0_memory_output output;
+  u7_vm0_state_globals(&state)->input = &input.base;
+  u7_vm0_state_globals(&state)->output = &output.base;
+
+  double elapsed_ns = 0.0;
+  for (int64_t i = -1; i < runs && error.error_code == 0; ++i) {
+    u7_vm0_memory_input_init(&input, data, sizeof(data));
+    u7_vm0_memory_output_init(&output, data, sizeof(data));
+    state.ip = 0;
+    const double start_ns = now_ns();
+    u7_vm_state_run(&state);
+    if (i >= 0) {  // The first run warms up.
+      elapsed_ns += now_ns() - start_ns;
+    }
+    error = u7_vm0_state_take_error(&state);
+  }
+  u7_vm_state_destroy(&state);
+  if (error.error_code != 0) {
+    return error;
+  }
+  printf("%-48s %10.2f ns/op\n", name, elapsed_ns / runs / repeat);
+  return u7_ok();
+}
+
+static bool bench_selected(const char* filter, const char* name) {
+  return filter == NULL || strstr(name, filter) != NULL;
+}
+
+// Runs the benchmarks whose names contain `filter` (all, if it is NULL).
+// The output has one line per benchmark, in a fixed order.
+static u7_error Main(const char* filter) {
+  static const struct {
+    struct bench_kernel const* kernel;
+    enum bench_engine engine;
+    bool fuse;
+    const char* name;
+  } kernels[] = {
+      {&fibonacci_kernel, BENCH_ENGINE_LOOP, false, "fibonacci/loop"},
+      {&fibonacci_kernel, BENCH_ENGINE_THREADED, false, "fibonacci/threaded"},
+      {&fibonacci_kernel, BENCH_ENGINE_COMPACT, false, "fibonacci/compact"},
+      {&fibonacci_kernel, BENCH_ENGINE_LOOP, true, "fibonacci/fused/loop"},
+      {&fibonacci_kernel, BENCH_ENGINE_THREADED, true,
+       "fibonacci/fused/threaded"},
+      {&fibonacci_kernel, BENCH_ENGINE_COMPACT, true,
+       "fibonacci/fused/compact"},
+      {&fibonacci_kernel, BENCH_ENGINE_JIT, false, "fibonacci/jit"},
+      {&fibonacci_kernel, BENCH_ENGINE_JIT, true, "fibonacci/fused/jit"},
+      {&fibonacci_matrix_kernel, BENCH_ENGINE_LOOP, false,
+       "fibonacci/matrix/loop"},
+      {&fibonacci_matrix_kernel, BENCH_ENGINE_THREADED, false,
+       "fibonacci/matrix/threaded"},
+      {&fibonacci_matrix_kernel, BENCH_ENGINE_COMPACT, false,
+       "fibonacci/matrix/compact"},
+      {&fibonacci_matrix_kernel, BENCH_ENGINE_JIT, false,
+       "fibonacci/matrix/jit"},
+      {&countdown_kernel, BENCH_ENGINE_LOOP, false, "countdown/loop"},
+      {&countdown_kernel, BENCH_ENGINE_THREADED, false, "countdown/threaded"},
+      {&countdown_kernel, BENCH_ENGINE_COMPACT, false, "countdown/compact"},
+      {&countdown_kernel, BENCH_ENGINE_JIT, false, "countdown/jit"},
+      {&countdown_compare_kernel, BENCH_ENGINE_LOOP, false,
+       "countdown/compare/loop"},
+      {&countdown_compare_kernel, BENCH_ENGINE_THREADED, false,
+       "countdown/compare/threaded"},
+      {&countdown_compare_kernel, BENCH_ENGINE_COMPACT, false,
+       "countdown/compare/compact"},
+      {&countdown_compare_kernel, BENCH_ENGINE_JIT, false,
+       "countdown/compare/jit"},
+      {&countdown_call_kernel, BENCH_ENGINE_LOOP, false,
+       "countdown/call/loop"},
+      {&countdown_call_kernel, BENCH_ENGINE_THREADED, false,
+       "countdown/call/threaded"},
+      {&countdown_call_kernel, BENCH_ENGINE_COMPACT, false,
+       "countdown/call/compact"},
+      {&countdown_call_kernel, BENCH_ENGINE_JIT, false,
+       "countdown/call/jit"},
+      {&state_machine_kernel, BENCH_ENGINE_LOOP, false,
+       "state_machine/loop"},
+      {&state_machine_kernel, BENCH_ENGINE_THREADED, false,
+       "state_machine/threaded"},
+      {&state_machine_kernel, BENCH_ENGINE_COMPACT, false,
+       "state_machine/compact"},
+      {&state_machine_kernel, BENCH_ENGINE_JIT, false,
+       "state_machine/jit"},
+  };
+  u7_error error = u7_ok();
+  for (size_t i = 0; i < sizeof(kernels) / sizeof(kernels[0]) &&
+                     error.error_code == 0;
+       ++i) {
+    if (bench_selected(filter, kernels[i].name)) {
+      error = bench_kernel(kernels[i].kernel, kernels[i].engine,
+                           kernels[i].fuse, kernels[i].name, 200000);
+    }
+  }
+  if (error.error_code == 0 && bench_selected(filter, "state/init")) {
+    error = bench_state(false, "state/init", 200000);
+  }
+  if (error.error_code == 0 && bench_selected(filter, "state/pool")) {
+    error = bench_state(true, "state/pool", 200000);
+  }
+  for (int i = 0; i < U7_VM0_OPCODE_COUNT && error.error_code == 0; ++i) {
+    char name[64];
+    snprintf(name, sizeof(name), "op/%s", u7_vm0_opcode_info(i)->name);
+    if (bench_selected(filter, name)) {
+      error = bench_opcode((enum u7_vm0_opcode)i, name, 20000);
+    }
+  }
+  return error;
+}
+
+// Usage: bench [filter]
+int main(int argc, char** argv) {
+  YalogSetConfig(YalogCreatePlainConfig(YalogCreateStderrSink(YALOG_INFO)));
+  u7_error error = Main(argc > 1 ? argv[1] : NULL);
+  if (error.error_code) {
+    YALOG_PRINTF(ERROR, "Main: %" U7_ERROR_FMT "\n",
+                 U7_ERROR_FMT_PARAMS(error));
+    u7_error_release(error);
+    return -1;
+  }
+  return 0;
+}
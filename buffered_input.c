@@ -0,0 +1,309 @@
+#include "@/public/input.h"
+
+#include <errno.h>
+#include <github.com/apronchenkov/error/public/error.h>
+#include <math.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+enum { U7_VM0_BUFFERED_INPUT_MIN_CAPACITY = 64 };
+
+static bool u7_vm0_is_space(char c) {
+  return c == ' ' || c == '\n' || c == '\t' || c == '\r' || c == '\v' ||
+         c == '\f';
+}
+
+// Moves the unread bytes to the beginning of the buffer and reads more.
+static u7_error u7_vm0_buffered_input_refill(
+    struct u7_vm0_buffered_input* self) {
+  if (self->begin > 0) {
+    memmove(self->buffer, self->buffer + self->begin, self->end - self->begin);
+    self->end -= self->begin;
+    self->begin = 0;
+  }
+  while (self->end < self->capacity && !self->eof) {
+    const ssize_t n =
+        read(self->fd, self->buffer + self->end, self->capacity - self->end);
+    if (n > 0) {
+      self->end += (size_t)n;
+      return u7_ok();
+    } else if (n == 0) {
+      self->eof = true;
+    } else if (errno != EINTR) {
+      return u7_errnof(errno, "u7_vm0_buffered_input: read failed");
+    }
+  }
+  return u7_ok();
+}
+
+// Finds the next whitespace-separated token; the token is NUL-terminated
+// in place (the buffer has an extra byte for that).
+static u7_error u7_vm0_buffered_input_next_token(
+    struct u7_vm0_buffered_input* self, const char* fn_name, char** begin,
+    char** end) {
+  for (;;) {
+    while (self->begin < self->end &&
+           u7_vm0_is_space(self->buffer[self->begin])) {
+      ++self->begin;
+    }
+    if (self->begin < self->end) {
+      break;
+    }
+    if (self->eof) {
+      return u7_errnof(ENODATA, "%s: eof", fn_name);
+    }
+    u7_error error = u7_vm0_buffered_input_refill(self);
+    if (error.error_code != 0) {
+      return error;
+    }
+  }
+  size_t i = self->begin;
+  for (;;) {
+    while (i < self->end && !u7_vm0_is_space(self->buffer[i])) {
+      ++i;
+    }
+    if (i < self->end || self->eof) {
+      break;
+    }
+    if (self->begin == 0 && self->end == self->capacity) {
+      return u7_errnof(EINVAL, "%s: token is too long", fn_name);
+    }
+    i -= self->begin;
+    u7_error error = u7_vm0_buffered_input_refill(self);
+    if (error.error_code != 0) {
+      return error;
+    }
+  }
+  *begin = self->buffer + self->begin;
+  *end = self->buffer + i;
+  **end = '\0';
+  self->begin = (i < self->end ? i + 1 : i);
+  return u7_ok();
+}
+
+// Parses a decimal integer in [min, max].
+static bool u7_vm0_parse_integer(const char* p, const char* end, int64_t min,
+                                 int64_t max, int64_t* result) {
+  const bool negative = (*p == '-');
+  if (*p == '-' || *p == '+') {
+    ++p;
+  }
+  if (p == end) {
+    return false;
+  }
+  // Accumulate the magnitude as unsigned to handle INT64_MIN.
+  const uint64_t limit =
+      (negative ? (uint64_t)(-(min + 1)) + 1 : (uint64_t)max);
+  uint64_t value = 0;
+  for (; p != end; ++p) {
+    const unsigned digit = (unsigned)(*p - '0');
+    if (digit > 9) {
+      return false;
+    }
+    if (value > (limit - digit) / 10) {
+      errno = ERANGE;
+      return false;
+    }
+    value = value * 10 + digit;
+  }
+  *result = (negative ? (int64_t)(0 - value) : (int64_t)value);
+  return true;
+}
+
+// Exact fast path for decimals like "123.25" or "1e-7": the mantissa is
+// exactly representable and so is the power of ten, so a single
+// multiplication or division rounds correctly. Returns false if the input
+// needs the general algorithm.
+static bool u7_vm0_parse_double_fast(const char* p, const char* end,
+                                     uint64_t max_mantissa, int max_exponent,
+                                     bool* negative, uint64_t* mantissa,
+                                     int* exponent) {
+  *negative = (*p == '-');
+  if (*p == '-' || *p == '+') {
+    ++p;
+  }
+  uint64_t m = 0;
+  int e = 0;
+  int digits = 0;
+  for (; p != end && (unsigned)(*p - '0') <= 9; ++p, ++digits) {
+    m = m * 10 + (unsigned)(*p - '0');
+    if (digits >= 18) {
+      return false;
+    }
+  }
+  if (p != end && *p == '.') {
+    for (++p; p != end && (unsigned)(*p - '0') <= 9; ++p, ++digits) {
+      m = m * 10 + (unsigned)(*p - '0');
+      e -= 1;
+      if (digits >= 18) {
+        return false;
+      }
+    }
+  }
+  if (digits == 0) {
+    return false;
+  }
+  if (p != end && (*p == 'e' || *p == 'E')) {
+    ++p;
+    int64_t exp_value;
+    if (!u7_vm0_parse_integer(p, end, -1000, 1000, &exp_value)) {
+      return false;
+    }
+    e += (int)exp_value;
+    p = end;
+  }
+  if (p != end || m > max_mantissa || e < -max_exponent ||
+      e > max_exponent) {
+    return false;
+  }
+  *mantissa = m;
+  *exponent = e;
+  return true;
+}
+
+static const double u7_vm0_powers_of_ten[] = {
+    1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22,
+};
+
+static u7_error read_i32(struct u7_vm0_input* self, int32_t* result) {
+  char *begin, *end;
+  u7_error error = u7_vm0_buffered_input_next_token(
+      (struct u7_vm0_buffered_input*)self, "read_i32", &begin, &end);
+  if (error.error_code != 0) {
+    return error;
+  }
+  int64_t value;
+  errno = 0;
+  if (!u7_vm0_parse_integer(begin, end, INT32_MIN, INT32_MAX, &value)) {
+    if (errno == ERANGE) {
+      return u7_errnof(ERANGE, "read_i32: out of range");
+    }
+    return u7_errnof(EINVAL, "read_i32: incompatible input");
+  }
+  *result = (int32_t)value;
+  return u7_ok();
+}
+
+static u7_error read_i64(struct u7_vm0_input* self, int64_t* result) {
+  char *begin, *end;
+  u7_error error = u7_vm0_buffered_input_next_token(
+      (struct u7_vm0_buffered_input*)self, "read_i64", &begin, &end);
+  if (error.error_code != 0) {
+    return error;
+  }
+  errno = 0;
+  if (!u7_vm0_parse_integer(begin, end, INT64_MIN, INT64_MAX, result)) {
+    if (errno == ERANGE) {
+      return u7_errnof(ERANGE, "read_i64: out of range");
+    }
+    return u7_errnof(EINVAL, "read_i64: incompatible input");
+  }
+  return u7_ok();
+}
+
+static u7_error read_f32(struct u7_vm0_input* self, float* result) {
+  char *begin, *end;
+  u7_error error = u7_vm0_buffered_input_next_token(
+      (struct u7_vm0_buffered_input*)self, "read_f32", &begin, &end);
+  if (error.error_code != 0) {
+    return error;
+  }
+  bool negative;
+  uint64_t mantissa;
+  int exponent;
+  if (u7_vm0_parse_double_fast(begin, end, UINT64_C(1) << 24, 10, &negative,
+                               &mantissa, &exponent)) {
+    const float power = (float)u7_vm0_powers_of_ten[abs(exponent)];
+    const float value =
+        (exponent < 0 ? (float)mantissa / power : (float)mantissa * power);
+    *result = (negative ? -value : value);
+    return u7_ok();
+  }
+  char* parsed_end;
+  *result = strtof(begin, &parsed_end);
+  if (parsed_end != end) {
+    return u7_errnof(EINVAL, "read_f32: incompatible input");
+  }
+  return u7_ok();
+}
+
+static u7_error read_f64(struct u7_vm0_input* self, double* result) {
+  char *begin, *end;
+  u7_error error = u7_vm0_buffered_input_next_token(
+      (struct u7_vm0_buffered_input*)self, "read_f64", &begin, &end);
+  if (error.error_code != 0) {
+    return error;
+  }
+  bool negative;
+  uint64_t mantissa;
+  int exponent;
+  if (u7_vm0_parse_double_fast(begin, end, UINT64_C(1) << 53, 22, &negative,
+                               &mantissa, &exponent)) {
+    const double power = u7_vm0_powers_of_ten[abs(exponent)];
+    const double value =
+        (exponent < 0 ? (double)mantissa / power : (double)mantissa * power);
+    *result = (negative ? -value : value);
+    return u7_ok();
+  }
+  char* parsed_end;
+  *result = strtod(begin, &parsed_end);
+  if (parsed_end != end) {
+    return u7_errnof(EINVAL, "read_f64: incompatible input");
+  }
+  return u7_ok();
+}
+
+// The batch functions call the scalar ones directly, saving an indirect call
+// per value.
+#define U7_VM0_DEFINE_BUFFERED_READ_N(fn_name, scalar_fn_name, type) \
+  static u7_error fn_name(struct u7_vm0_input* self, type* result,   \
+                          size_t count, size_t* done) {              \
+    for (*done = 0; *done < count; ++*done) {                        \
+      u7_error error = scalar_fn_name(self, &result[*done]);         \
+      if (error.error_code != 0) {                                   \
+        return error;                                                \
+      }                                                              \
+    }                                                                \
+    return u7_ok();                                                  \
+  }
+
+U7_VM0_DEFINE_BUFFERED_READ_N(read_i32_n, read_i32, int32_t)
+U7_VM0_DEFINE_BUFFERED_READ_N(read_i64_n, read_i64, int64_t)
+U7_VM0_DEFINE_BUFFERED_READ_N(read_f32_n, read_f32, float)
+U7_VM0_DEFINE_BUFFERED_READ_N(read_f64_n, read_f64, double)
+
+u7_error u7_vm0_buffered_input_init(struct u7_vm0_buffered_input* self,
+                                    int fd, size_t capacity) {
+  if (capacity < U7_VM0_BUFFERED_INPUT_MIN_CAPACITY) {
+    capacity = U7_VM0_BUFFERED_INPUT_MIN_CAPACITY;
+  }
+  // One extra byte for the NUL after the last token.
+  char* buffer = malloc(capacity + 1);
+  if (buffer == NULL) {
+    return u7_errnof(ENOMEM, "u7_vm0_buffered_input_init: out of memory");
+  }
+  self->base.read_i32_fn = &read_i32;
+  self->base.read_i64_fn = &read_i64;
+  self->base.read_f32_fn = &read_f32;
+  self->base.read_f64_fn = &read_f64;
+  self->base.read_i32_n_fn = &read_i32_n;
+  self->base.read_i64_n_fn = &read_i64_n;
+  self->base.read_f32_n_fn = &read_f32_n;
+  self->base.read_f64_n_fn = &read_f64_n;
+  self->fd = fd;
+  self->buffer = buffer;
+  self->capacity = capacity;
+  self->begin = 0;
+  self->end = 0;
+  self->eof = false;
+  return u7_ok();
+}
+
+void u7_vm0_buffered_input_destroy(struct u7_vm0_buffered_input* self) {
+  free(self->buffer);
+  self->buffer = NULL;
+}
@@ -0,0 +1,231 @@
+#include "@/public/output.h"
+
+#include <errno.h>
+#include <github.com/apronchenkov/error/public/error.h>
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+// Enough for any formatted value and the separator.
+enum { U7_VM0_BUFFERED_OUTPUT_MAX_VALUE_SIZE = 40 };
+
+static const char u7_vm0_digit_pairs[201] =
+    "00010203040506070809"
+    "10111213141516171819"
+    "20212223242526272829"
+    "30313233343536373839"
+    "40414243444546474849"
+    "50515253545556575859"
+    "60616263646566676869"
+    "70717273747576777879"
+    "80818283848586878889"
+    "90919293949596979899";
+
+// Writes the decimal representation of the value; returns the end.
+static char* u7_vm0_format_u64(char* p, uint64_t value) {
+  char digits[20];
+  char* q = digits + sizeof(digits);
+  while (value >= 100) {
+    const unsigned pair = (unsigned)(value % 100) * 2;
+    value /= 100;
+    *--q = u7_vm0_digit_pairs[pair + 1];
+    *--q = u7_vm0_digit_pairs[pair];
+  }
+  if (value >= 10) {
+    const unsigned pair = (unsigned)value * 2;
+    *--q = u7_vm0_digit_pairs[pair + 1];
+    *--q = u7_vm0_digit_pairs[pair];
+  } else {
+    *--q = (char)('0' + value);
+  }
+  const size_t n = (size_t)(digits + sizeof(digits) - q);
+  memcpy(p, q, n);
+  return p + n;
+}
+
+static char* u7_vm0_format_i64(char* p, int64_t value) {
+  if (value < 0) {
+    *p++ = '-';
+    return u7_vm0_format_u64(p, 0 - (uint64_t)value);
+  }
+  return u7_vm0_format_u64(p, (uint64_t)value);
+}
+
+// Writes the shortest representation that reads back to the same double.
+static char* u7_vm0_format_f64(char* p, double value) {
+  if (fabs(value) < 0x1p53 && value == (double)(int64_t)value) {
+    if (value == 0 && signbit(value)) {
+      *p++ = '-';
+    }
+    return u7_vm0_format_i64(p, (int64_t)value);
+  }
+  if (!isfinite(value)) {
+    return p + snprintf(p, U7_VM0_BUFFERED_OUTPUT_MAX_VALUE_SIZE, "%g", value);
+  }
+  int n = 0;
+  for (int precision = 15; precision <= 17; ++precision) {
+    n = snprintf(p, U7_VM0_BUFFERED_OUTPUT_MAX_VALUE_SIZE, "%.*g", precision,
+                 value);
+    if (strtod(p, NULL) == value) {
+      break;
+    }
+  }
+  return p + n;
+}
+
+static char* u7_vm0_format_f32(char* p, float value) {
+  if (fabsf(value) < 0x1p24f && value == (float)(int32_t)value) {
+    if (value == 0 && signbit(value)) {
+      *p++ = '-';
+    }
+    return u7_vm0_format_i64(p, (int32_t)value);
+  }
+  if (!isfinite(value)) {
+    return p + snprintf(p, U7_VM0_BUFFERED_OUTPUT_MAX_VALUE_SIZE, "%g",
+                        (double)value);
+  }
+  int n = 0;
+  for (int precision = 6; precision <= 9; ++precision) {
+    n = snprintf(p, U7_VM0_BUFFERED_OUTPUT_MAX_VALUE_SIZE, "%.*g", precision,
+                 (double)value);
+    if (strtof(p, NULL) == value) {
+      break;
+    }
+  }
+  return p + n;
+}
+
+// Returns a pointer to at least U7_VM0_BUFFERED_OUTPUT_MAX_VALUE_SIZE free
+// bytes, flushing the buffer if needed.
+static u7_error u7_vm0_buffered_output_reserve(
+    struct u7_vm0_buffered_output* self, char** result) {
+  if (self->capacity - self->size < U7_VM0_BUFFERED_OUTPUT_MAX_VALUE_SIZE) {
+    u7_error error = u7_vm0_buffered_output_flush(self);
+    if (error.error_code != 0) {
+      return error;
+    }
+  }
+  *result = self->buffer + self->size;
+  return u7_ok();
+}
+
+static u7_error write_i32(struct u7_vm0_output* self, int32_t value) {
+  struct u7_vm0_buffered_output* output = (struct u7_vm0_buffered_output*)self;
+  char* p;
+  u7_error error = u7_vm0_buffered_output_reserve(output, &p);
+  if (error.error_code != 0) {
+    return error;
+  }
+  p = u7_vm0_format_i64(p, value);
+  *p++ = ' ';
+  output->size = (size_t)(p - output->buffer);
+  return u7_ok();
+}
+
+static u7_error write_i64(struct u7_vm0_output* self, int64_t value) {
+  struct u7_vm0_buffered_output* output = (struct u7_vm0_buffered_output*)self;
+  char* p;
+  u7_error error = u7_vm0_buffered_output_reserve(output, &p);
+  if (error.error_code != 0) {
+    return error;
+  }
+  p = u7_vm0_format_i64(p, value);
+  *p++ = ' ';
+  output->size = (size_t)(p - output->buffer);
+  return u7_ok();
+}
+
+static u7_error write_f32(struct u7_vm0_output* self, float value) {
+  struct u7_vm0_buffered_output* output = (struct u7_vm0_buffered_output*)self;
+  char* p;
+  u7_error error = u7_vm0_buffered_output_reserve(output, &p);
+  if (error.error_code != 0) {
+    return error;
+  }
+  p = u7_vm0_format_f32(p, value);
+  *p++ = ' ';
+  output->size = (size_t)(p - output->buffer);
+  return u7_ok();
+}
+
+static u7_error write_f64(struct u7_vm0_output* self, double value) {
+  struct u7_vm0_buffered_output* output = (struct u7_vm0_buffered_output*)self;
+  char* p;
+  u7_error error = u7_vm0_buffered_output_reserve(output, &p);
+  if (error.error_code != 0) {
+    return error;
+  }
+  p = u7_vm0_format_f64(p, value);
+  *p++ = ' ';
+  output->size = (size_t)(p - output->buffer);
+  return u7_ok();
+}
+
+// The batch functions call the scalar ones directly, saving an indirect call
+// per value.
+#define U7_VM0_DEFINE_BUFFERED_WRITE_N(fn_name, scalar_fn_name, type)     \
+  static u7_error fn_name(struct u7_vm0_output* self, type const* values, \
+                          size_t count, size_t* done) {                   \
+    for (*done = 0; *done < count; ++*done) {                             \
+      u7_error error = scalar_fn_name(self, values[*done]);               \
+      if (error.error_code != 0) {                                        \
+        return error;                                                     \
+      }                                                                   \
+    }                                                                     \
+    return u7_ok();                                                       \
+  }
+
+U7_VM0_DEFINE_BUFFERED_WRITE_N(write_i32_n, write_i32, int32_t)
+U7_VM0_DEFINE_BUFFERED_WRITE_N(write_i64_n, write_i64, int64_t)
+U7_VM0_DEFINE_BUFFERED_WRITE_N(write_f32_n, write_f32, float)
+U7_VM0_DEFINE_BUFFERED_WRITE_N(write_f64_n, write_f64, double)
+
+u7_error u7_vm0_buffered_output_init(struct u7_vm0_buffered_output* self,
+                                     int fd, size_t capacity) {
+  if (capacity < 2 * U7_VM0_BUFFERED_OUTPUT_MAX_VALUE_SIZE) {
+    capacity = 2 * U7_VM0_BUFFERED_OUTPUT_MAX_VALUE_SIZE;
+  }
+  char* buffer = malloc(capacity);
+  if (buffer == NULL) {
+    return u7_errnof(ENOMEM, "u7_vm0_buffered_output_init: out of memory");
+  }
+  self->base.write_i32_fn = &write_i32;
+  self->base.write_i64_fn = &write_i64;
+  self->base.write_f32_fn = &write_f32;
+  self->base.write_f64_fn = &write_f64;
+  self->base.write_i32_n_fn = &write_i32_n;
+  self->base.write_i64_n_fn = &write_i64_n;
+  self->base.write_f32_n_fn = &write_f32_n;
+  self->base.write_f64_n_fn = &write_f64_n;
+  self->fd = fd;
+  self->buffer = buffer;
+  self->capacity = capacity;
+  self->size = 0;
+  return u7_ok();
+}
+
+u7_error u7_vm0_buffered_output_flush(struct u7_vm0_buffered_output* self) {
+  size_t offset = 0;
+  while (offset < self->size) {
+    const ssize_t n =
+        write(self->fd, self->buffer + offset, self->size - offset);
+    if (n >= 0) {
+      offset += (size_t)n;
+    } else if (errno != EINTR) {
+      const int error_code = errno;
+      memmove(self->buffer, self->buffer + offset, self->size - offset);
+      self->size -= offset;
+      return u7_errnof(error_code, "u7_vm0_buffered_output_flush: failed");
+    }
+  }
+  self->size = 0;
+  return u7_ok();
+}
+
+void u7_vm0_buffered_output_destroy(struct u7_vm0_buffered_output* self) {
+  free(self->buffer);
+  self->buffer = NULL;
+}
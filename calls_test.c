@@ -0,0 +1,362 @@
+#include "@/public/vm0.h"
+
+#include "@/public/program.h"
+#include "@/testing.h"
+
+#include <errno.h>
+#include <github.com/apronchenkov/error/public/error.h>
+#include <github.com/apronchenkov/vm/public/state.h>
+#include <inttypes.h>
+#include <stdint.h>
+#include <string.h>
+
+// Tests for the functions: `call` passes the argument slots and `ret_value`
+// writes the result back for every type, nested calls keep a frame each, a
+// self-recursive tail call reuses the frame, and `ret` outside of a call ends
+// the program.
+
+// Locals of every function: four slots.
+static const struct u7_vm_stack_frame_layout frame_layout = {
+    .locals_size = 4 * sizeof(int64_t),
+    .description = "calls_test",
+};
+
+static struct u7_vm0_arg variable(enum u7_vm0_arg_kind kind, int64_t index) {
+  return (struct u7_vm0_arg){.kind = kind,
+                             .value.i64 = index * (int64_t)sizeof(int64_t)};
+}
+
+static struct u7_vm0_arg i64_variable(int64_t index) {
+  return variable(U7_VM0_ARG_KIND_I64_VARIABLE, index);
+}
+
+static struct u7_vm0_arg i64_constant(int64_t value) {
+  return (struct u7_vm0_arg){.kind = U7_VM0_ARG_KIND_I64_CONSTANT,
+                             .value.i64 = value};
+}
+
+static struct u7_vm0_arg label(int64_t index) {
+  return (struct u7_vm0_arg){.kind = U7_VM0_ARG_KIND_I64_LABEL,
+                             .value.i64 = index};
+}
+
+static u7_error program_init(struct u7_vm0_program* program,
+                             struct u7_vm0_instruction const* instructions,
+                             size_t instructions_size) {
+  return u7_vm0_test_program_init(program, instructions, instructions_size,
+                                  &frame_layout);
+}
+
+// Calls add(x) = x + delta with the argument in slot 1, and checks that the
+// result is at the beginning of the slot, and that the caller's slot 2 is
+// kept.
+static u7_error check_ret_value(const char* name, enum u7_vm0_arg_kind kind,
+                                struct u7_vm0_arg x, struct u7_vm0_arg delta,
+                                void const* expected, size_t expected_size) {
+  const struct u7_vm0_arg arg = variable(kind, 1);
+  u7_error error = u7_ok();
+  const struct u7_vm0_instruction instructions[] = {
+      u7_vm0_copy(&error, arg, x),
+      u7_vm0_copy(&error, i64_variable(2), i64_constant(-1)),
+      u7_vm0_call(&error, label(4), &frame_layout, arg, 1),
+      u7_vm0_ret(),
+      // add(x):
+      u7_vm0_math_add(&error, variable(kind, 0), variable(kind, 0), delta),
+      u7_vm0_copy(&error, i64_variable(2), i64_constant(7)),
+      u7_vm0_ret_value(&error, variable(kind, 0)),
+  };
+  if (error.error_code != 0) {
+    return error;
+  }
+  struct u7_vm0_program program;
+  error = program_init(&program, instructions,
+                       sizeof(instructions) / sizeof(instructions[0]));
+  if (error.error_code != 0) {
+    return error;
+  }
+  struct u7_vm0_test_state test_state;
+  error = u7_vm0_test_state_init(&test_state, &program, program.js, NULL, 0,
+                                 NULL, 0);
+  if (error.error_code == 0) {
+    u7_vm_state_run(&test_state.state);
+    error = u7_vm0_state_take_error(&test_state.state);
+    int64_t const* locals =
+        (int64_t const*)u7_vm_state_locals(&test_state.state);
+    if (error.error_code == 0 &&
+        (memcmp(&locals[1], expected, expected_size) != 0 ||
+         locals[2] != -1)) {
+      error = u7_errnof(EINVAL, "%s: unexpected locals", name);
+    }
+    if (error.error_code == 0 &&
+        (test_state.state.ip != 0 ||
+         u7_vm0_state_globals(&test_state.state)->call_depth != 0)) {
+      error = u7_errnof(EINVAL, "%s: the program has not ended", name);
+    }
+    u7_vm0_test_state_destroy(&test_state);
+  }
+  u7_vm0_program_destroy(&program);
+  return error;
+}
+
+static u7_error test_ret_value() {
+  const int32_t i32_expected = 42;
+  u7_error error = check_ret_value(
+      "i32", U7_VM0_ARG_KIND_I32_VARIABLE,
+      (struct u7_vm0_arg){.kind = U7_VM0_ARG_KIND_I32_CONSTANT,
+                          .value.i32 = 40},
+      (struct u7_vm0_arg){.kind = U7_VM0_ARG_KIND_I32_CONSTANT,
+                          .value.i32 = 2},
+      &i32_expected, sizeof(i32_expected));
+  if (error.error_code != 0) {
+    return error;
+  }
+  const int64_t i64_expected = (INT64_C(1) << 40) + 2;
+  error = check_ret_value("i64", U7_VM0_ARG_KIND_I64_VARIABLE,
+                          i64_constant(INT64_C(1) << 40), i64_constant(2),
+                          &i64_expected, sizeof(i64_expected));
+  if (error.error_code != 0) {
+    return error;
+  }
+  const float f32_expected = 1.75f;
+  error = check_ret_value(
+      "f32", U7_VM0_ARG_KIND_F32_VARIABLE,
+      (struct u7_vm0_arg){.kind = U7_VM0_ARG_KIND_F32_CONSTANT,
+                          .value.f32 = 1.5f},
+      (struct u7_vm0_arg){.kind = U7_VM0_ARG_KIND_F32_CONSTANT,
+                          .value.f32 = 0.25f},
+      &f32_expected, sizeof(f32_expected));
+  if (error.error_code != 0) {
+    return error;
+  }
+  const double f64_expected = -2.75;
+  return check_ret_value(
+      "f64", U7_VM0_ARG_KIND_F64_VARIABLE,
+      (struct u7_vm0_arg){.kind = U7_VM0_ARG_KIND_F64_CONSTANT,
+                          .value.f64 = -3.0},
+      (struct u7_vm0_arg){.kind = U7_VM0_ARG_KIND_F64_CONSTANT,
+                          .value.f64 = 0.25},
+      &f64_expected, sizeof(f64_expected));
+}
+
+// sum(n) = n + sum(n - 1) yields on entry, so every level of the recursion
+// can be observed: each call adds a frame above the caller's, and the
+// returns unwind them back to the locals frame.
+static u7_error test_nested() {
+  const struct u7_vm0_arg n = i64_variable(0);
+  const struct u7_vm0_arg a = i64_variable(1);
+  u7_error error = u7_ok();
+  const struct u7_vm0_instruction instructions[] = {
+      u7_vm0_input(&error, n),
+      u7_vm0_call(&error, label(4), &frame_layout, n, 1),
+      u7_vm0_output(&error, n),
+      u7_vm0_ret(),
+      // sum(n):
+      u7_vm0_yield(),
+      u7_vm0_jump_if_less_or_equal(&error, n, i64_constant(0), label(9)),
+      u7_vm0_math_add(&error, a, n, i64_constant(-1)),
+      u7_vm0_call(&error, label(4), &frame_layout, a, 1),
+      u7_vm0_math_add(&error, n, n, a),
+      u7_vm0_ret_value(&error, n),
+  };
+  if (error.error_code != 0) {
+    return error;
+  }
+  struct u7_vm0_program program;
+  error = program_init(&program, instructions,
+                       sizeof(instructions) / sizeof(instructions[0]));
+  if (error.error_code != 0) {
+    return error;
+  }
+  const int64_t input = 5;
+  int64_t output = 0;
+  struct u7_vm0_test_state test_state;
+  error = u7_vm0_test_state_init(&test_state, &program, program.js, &input, 1,
+                                 &output, 1);
+  if (error.error_code == 0) {
+    struct u7_vm_state* state = &test_state.state;
+    const size_t locals_base_offset = state->stack.base_offset;
+    size_t base_offset = locals_base_offset;
+    for (int64_t depth = 1; depth <= input + 1 && error.error_code == 0;
+         ++depth) {
+      u7_vm_state_run(state);
+      error = u7_vm0_state_take_error(state);
+      if (error.error_code == 0 &&
+          (state->ip != 5 ||
+           u7_vm0_state_globals(state)->call_depth != (size_t)depth ||
+           state->stack.base_offset <= base_offset ||
+           *(int64_t const*)u7_vm_state_locals(state) != input + 1 - depth)) {
+        error = u7_errnof(EINVAL, "nested: unexpected frame at depth %" PRId64,
+                          depth);
+      }
+      base_offset = state->stack.base_offset;
+    }
+    if (error.error_code == 0) {
+      u7_vm_state_run(state);
+      error = u7_vm0_state_take_error(state);
+    }
+    if (error.error_code == 0 &&
+        (state->ip != 0 || u7_vm0_state_globals(state)->call_depth != 0 ||
+         state->stack.base_offset != locals_base_offset ||
+         u7_vm0_test_state_output_size(&test_state) != 1 || output != 15)) {
+      error = u7_errnof(EINVAL, "nested: expected 15 written after the calls");
+    }
+    u7_vm0_test_state_destroy(&test_state);
+  }
+  u7_vm0_program_destroy(&program);
+  return error;
+}
+
+// count(n) increments a variable that is not an argument, and tail-calls
+// itself while n > 0: the reused frame keeps the variable, so count(n)
+// returns the number of the calls. Outside of a call, the tail call is a
+// regular one, and the caller continues after it.
+static u7_error test_tail_call() {
+  const struct u7_vm0_arg n = i64_variable(0);
+  const struct u7_vm0_arg a = i64_variable(1);
+  u7_error error = u7_ok();
+  const struct u7_vm0_instruction instructions[] = {
+      u7_vm0_input(&error, n),
+      u7_vm0_tail_call(&error, label(4), &frame_layout, n, 1),
+      u7_vm0_output(&error, n),
+      u7_vm0_ret(),
+      // count(n):
+      u7_vm0_math_add(&error, a, a, i64_constant(1)),
+      u7_vm0_math_add(&error, n, n, i64_constant(-1)),
+      u7_vm0_jump_if_less_or_equal(&error, n, i64_constant(0), label(8)),
+      u7_vm0_tail_call(&error, label(4), &frame_layout, n, 1),
+      u7_vm0_ret_value(&error, a),
+  };
+  if (error.error_code != 0) {
+    return error;
+  }
+  struct u7_vm0_program program;
+  error = program_init(&program, instructions,
+                       sizeof(instructions) / sizeof(instructions[0]));
+  if (error.error_code != 0) {
+    return error;
+  }
+  struct {
+    int64_t input;
+    int64_t output;
+  } const cases[] = {{-3, 1}, {1, 1}, {2, 2}, {1000, 1000}};
+  for (size_t i = 0;
+       i < sizeof(cases) / sizeof(cases[0]) && error.error_code == 0; ++i) {
+    int64_t output = 0;
+    error = u7_vm0_test_run_single(&program, program.js, cases[i].input,
+                                   &output);
+    if (error.error_code == 0 && output != cases[i].output) {
+      error = u7_errnof(EINVAL,
+                        "tail_call: count(%" PRId64 ") = %" PRId64
+                        ", expected %" PRId64,
+                        cases[i].input, output, cases[i].output);
+    }
+  }
+  u7_vm0_program_destroy(&program);
+  return error;
+}
+
+// Outside of a call, `ret_value` ends the program without writing anything,
+// and the next run starts from the beginning.
+static u7_error test_ret_outside_call() {
+  const struct u7_vm0_arg n = i64_variable(0);
+  u7_error error = u7_ok();
+  const struct u7_vm0_instruction instructions[] = {
+      u7_vm0_math_add(&error, n, n, i64_constant(1)),
+      u7_vm0_ret_value(&error, i64_variable(1)),
+      u7_vm0_output(&error, n),
+      u7_vm0_ret(),
+  };
+  if (error.error_code != 0) {
+    return error;
+  }
+  struct u7_vm0_program program;
+  error = program_init(&program, instructions,
+                       sizeof(instructions) / sizeof(instructions[0]));
+  if (error.error_code != 0) {
+    return error;
+  }
+  int64_t output = 0;
+  struct u7_vm0_test_state test_state;
+  error = u7_vm0_test_state_init(&test_state, &program, program.js, NULL, 0,
+                                 &output, 1);
+  if (error.error_code == 0) {
+    struct u7_vm_state* state = &test_state.state;
+    for (int64_t run = 1; run <= 2 && error.error_code == 0; ++run) {
+      u7_vm_state_run(state);
+      error = u7_vm0_state_take_error(state);
+      int64_t const* locals = (int64_t const*)u7_vm_state_locals(state);
+      if (error.error_code == 0 &&
+          (state->ip != 0 || locals[0] != run || locals[1] != 0 ||
+           u7_vm0_test_state_output_size(&test_state) != 0)) {
+        error = u7_errnof(EINVAL, "ret_outside_call: run %" PRId64
+                                  ": expected the program to end",
+                          run);
+      }
+    }
+    u7_vm0_test_state_destroy(&test_state);
+  }
+  u7_vm0_program_destroy(&program);
+  return error;
+}
+
+static u7_error test_invalid_arguments() {
+  static const struct u7_vm_stack_frame_layout wide_frame_layout = {
+      .locals_size = 2 * U7_VM0_TAIL_CALL_MAX_COUNT * sizeof(int64_t),
+      .description = "calls_test/wide",
+  };
+  const struct u7_vm0_arg args = i64_variable(0);
+  struct {
+    const char* name;
+    struct u7_vm0_instruction (*fn)(
+        u7_error*, struct u7_vm0_arg,
+        struct u7_vm_stack_frame_layout const*, struct u7_vm0_arg, int64_t);
+    struct u7_vm0_arg label;
+    struct u7_vm_stack_frame_layout const* frame_layout;
+    struct u7_vm0_arg args;
+    int64_t count;
+    int error_code;
+  } const cases[] = {
+      {"call", &u7_vm0_call, label(0), &frame_layout, args, 4, 0},
+      {"call: no frame layout", &u7_vm0_call, label(0), NULL, args, 0,
+       EINVAL},
+      {"call: count > slots", &u7_vm0_call, label(0), &frame_layout, args, 5,
+       EINVAL},
+      {"call: negative count", &u7_vm0_call, label(0), &frame_layout, args,
+       -1, EINVAL},
+      {"call: not a label", &u7_vm0_call, i64_constant(0), &frame_layout,
+       args, 1, EINVAL},
+      {"call: args not a variable", &u7_vm0_call, label(0), &frame_layout,
+       i64_constant(0), 1, EINVAL},
+      {"call: args not a slot", &u7_vm0_call, label(0), &frame_layout,
+       (struct u7_vm0_arg){.kind = U7_VM0_ARG_KIND_I32_VARIABLE,
+                           .value.i64 = 4},
+       1, EINVAL},
+      {"tail_call: max count", &u7_vm0_tail_call, label(0),
+       &wide_frame_layout, args, U7_VM0_TAIL_CALL_MAX_COUNT, 0},
+      {"tail_call: too many arguments", &u7_vm0_tail_call, label(0),
+       &wide_frame_layout, args, U7_VM0_TAIL_CALL_MAX_COUNT + 1, EINVAL},
+  };
+  for (size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); ++i) {
+    u7_error error = u7_ok();
+    cases[i].fn(&error, cases[i].label, cases[i].frame_layout, cases[i].args,
+                cases[i].count);
+    error = u7_vm0_test_expect_error(cases[i].name, error, cases[i].error_code);
+    if (error.error_code != 0) {
+      return error;
+    }
+  }
+  u7_error error = u7_ok();
+  u7_vm0_ret_value(&error, i64_constant(0));
+  return u7_vm0_test_expect_error("ret_value: constant", error, EINVAL);
+}
+
+int main() {
+  u7_error (*const tests[])() = {
+      &test_ret_value,
+      &test_nested,
+      &test_tail_call,
+      &test_ret_outside_call,
+      &test_invalid_arguments,
+  };
+  return u7_vm0_test_main(tests, sizeof(tests) / sizeof(tests[0]));
+}
@@ -0,0 +1,711 @@
+#include "@/public/compact.h"
+
+#include "@/public/opcode.h"
+
+#include <errno.h>
+#include <github.com/apronchenkov/error/public/error.h>
+#include <github.com/apronchenkov/vm/public/state.h>
+#include <inttypes.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Returns true if the operand is stored in the constant pool.
+static bool u7_vm0_compact_operand_is_pooled(enum u7_vm0_operand_kind kind) {
+  switch (kind) {
+    case U7_VM0_OPERAND_I32_CONSTANT:
+    case U7_VM0_OPERAND_I64_CONSTANT:
+    case U7_VM0_OPERAND_F32_CONSTANT:
+    case U7_VM0_OPERAND_F64_CONSTANT:
+    case U7_VM0_OPERAND_FRAME_LAYOUT:
+    case U7_VM0_OPERAND_SLOTS:
+      return true;
+    default:
+      return u7_vm0_operand_kind_is_pair(kind) ||
+             u7_vm0_operand_kind_is_array_pair(kind);
+  }
+}
+
+u7_error u7_vm0_compact_program_init(
+    struct u7_vm0_compact_program* self,
+    struct u7_vm0_instruction const* instructions, size_t instructions_size) {
+  if (instructions_size > (size_t)UINT16_MAX + 1) {
+    return u7_errnof(E2BIG,
+                     "u7_vm0_compact_program_init: too many instructions: %zu",
+                     instructions_size);
+  }
+  size_t constants_size = 0;
+  for (size_t i = 0; i < instructions_size; ++i) {
+    const enum u7_vm0_opcode opcode =
+        u7_vm0_instruction_opcode(&instructions[i]);
+    if (opcode == U7_VM0_OPCODE_UNKNOWN) {
+      return u7_errnof(EINVAL,
+                       "u7_vm0_compact_program_init: instruction %zu: unknown",
+                       i);
+    }
+    struct u7_vm0_opcode_info const* info = u7_vm0_opcode_info(opcode);
+    for (int j = 0; j < 3; ++j) {
+      constants_size +=
+          u7_vm0_compact_operand_is_pooled(info->operand_kinds[j]);
+    }
+  }
+  if (constants_size > (size_t)UINT16_MAX + 1) {
+    return u7_errnof(E2BIG,
+                     "u7_vm0_compact_program_init: too many constants: %zu",
+                     constants_size);
+  }
+  self->instructions =
+      malloc(instructions_size * sizeof(struct u7_vm0_compact_instruction));
+  self->constants = malloc(constants_size * sizeof(union u7_vm0_value));
+  if ((self->instructions == NULL && instructions_size > 0) ||
+      (self->constants == NULL && constants_size > 0)) {
+    free(self->instructions);
+    free(self->constants);
+    return u7_errnof(ENOMEM, "u7_vm0_compact_program_init: out of memory");
+  }
+  self->instructions_size = instructions_size;
+  self->constants_size = 0;
+  for (size_t i = 0; i < instructions_size; ++i) {
+    const enum u7_vm0_opcode opcode =
+        u7_vm0_instruction_opcode(&instructions[i]);
+    struct u7_vm0_opcode_info const* info = u7_vm0_opcode_info(opcode);
+    const union u7_vm0_value args[3] = {
+        instructions[i].arg1,
+        instructions[i].arg2,
+        instructions[i].arg3,
+    };
+    struct u7_vm0_compact_instruction* compact = &self->instructions[i];
+    compact->opcode = (uint16_t)opcode;
+    for (int j = 0; j < 3; ++j) {
+      const enum u7_vm0_operand_kind kind = info->operand_kinds[j];
+      if (kind == U7_VM0_OPERAND_NONE) {
+        compact->args[j] = 0;
+      } else if (u7_vm0_compact_operand_is_pooled(kind)) {
+        compact->args[j] = (uint16_t)self->constants_size;
+        self->constants[self->constants_size++] = args[j];
+      } else if (args[j].i64 >= 0 && args[j].i64 <= UINT16_MAX) {
+        compact->args[j] = (uint16_t)args[j].i64;
+      } else {
+        u7_vm0_compact_program_destroy(self);
+        return u7_errnof(ERANGE,
+                         "u7_vm0_compact_program_init: instruction %zu: %s: "
+                         "arg%d: does not fit into 16 bits: %" PRId64,
+                         i, info->name, j + 1, args[j].i64);
+      }
+    }
+  }
+  return u7_ok();
+}
+
+void u7_vm0_compact_program_destroy(struct u7_vm0_compact_program* self) {
+  free(self->instructions);
+  free(self->constants);
+  self->instructions = NULL;
+  self->instructions_size = 0;
+  self->constants = NULL;
+  self->constants_size = 0;
+}
+
+struct u7_vm0_instruction u7_vm0_compact_program_decode(
+    struct u7_vm0_compact_program const* self, size_t index) {
+  assert(index < self->instructions_size);
+  struct u7_vm0_compact_instruction const* compact =
+      &self->instructions[index];
+  struct u7_vm0_opcode_info const* info =
+      u7_vm0_opcode_info((enum u7_vm0_opcode)compact->opcode);
+  union u7_vm0_value args[3];
+  for (int j = 0; j < 3; ++j) {
+    const enum u7_vm0_operand_kind kind = info->operand_kinds[j];
+    if (u7_vm0_compact_operand_is_pooled(kind)) {
+      args[j] = self->constants[compact->args[j]];
+    } else {
+      args[j].i64 = (kind == U7_VM0_OPERAND_NONE ? 0 : compact->args[j]);
+    }
+  }
+  struct u7_vm0_instruction result = {
+      .base = info->base,
+      .arg1 = args[0],
+      .arg2 = args[1],
+      .arg3 = args[2],
+  };
+  return result;
+}
+
+// Locals are addressed as in threaded.c.
+#define U7_VM0_COMPACT_LOCAL(type, n)                       \
+  (*u7_vm0_cached_local_##type(state, locals, it->args[n]))
+
+#define U7_VM0_COMPACT_CONSTANT(type, n) (program->constants[it->args[n]].type)
+
+#define U7_VM0_COMPACT_PAIR_LOCAL(type, n, half)                    \
+  (*u7_vm0_cached_local_##type(                                     \
+      state, locals,                                                \
+      u7_vm0_operand_pair_##half(U7_VM0_COMPACT_CONSTANT(i64, n))))
+
+// The handler is looked up by the opcode; opcodes without a dedicated
+// handler go to the generic one.
+#define U7_VM0_COMPACT_DISPATCH()                    \
+  do {                                               \
+    void const* handler = handler_table[it->opcode]; \
+    goto* (handler != NULL ? handler : &&generic);   \
+  } while (0)
+
+#define U7_VM0_COMPACT_NEXT()  \
+  do {                         \
+    ++it;                      \
+    U7_VM0_COMPACT_DISPATCH(); \
+  } while (0)
+
+#define U7_VM0_COMPACT_JUMP_IF(condition, n)                           \
+  do {                                                                 \
+    it = ((condition) ? program->instructions + it->args[n] : it + 1); \
+    U7_VM0_COMPACT_DISPATCH();                                         \
+  } while (0)
+
+#define U7_VM0_COMPACT_JUMP_IF_COMPARE(type, op, rhs)              \
+  U7_VM0_COMPACT_JUMP_IF(U7_VM0_COMPACT_LOCAL(type, 0) op(rhs), 2)
+
+// The entries of the table follow the instruction; each is a `jump`.
+#define U7_VM0_COMPACT_JUMP_TABLE(type)                                      \
+  do {                                                                       \
+    const uint64_t index = (uint64_t)(int64_t)U7_VM0_COMPACT_LOCAL(type, 0); \
+    it = program->instructions +                                             \
+         (index < it->args[1] ? it[1 + index].args[0] : it->args[2]);        \
+    U7_VM0_COMPACT_DISPATCH();                                               \
+  } while (0)
+
+// On overflow, lets the original instruction report the error.
+#define U7_VM0_COMPACT_CHECKED_BINARY(type, c_type, builtin, rhs) \
+  do {                                                            \
+    c_type result;                                                \
+    if (builtin(U7_VM0_COMPACT_LOCAL(type, 1), rhs, &result)) {   \
+      goto generic;                                               \
+    }                                                             \
+    U7_VM0_COMPACT_LOCAL(type, 0) = result;                       \
+    U7_VM0_COMPACT_NEXT();                                        \
+  } while (0)
+
+// Same as the regular matrix_multiply instructions: the product is computed
+// into a temporary, as `dst` may coincide with a source. On overflow, lets
+// the original instruction report the error.
+#define U7_VM0_COMPACT_MATRIX_MULTIPLY_I64(n)                        \
+  do {                                                               \
+    int64_t const* lhs = &U7_VM0_COMPACT_PAIR_LOCAL(i64, 2, first);  \
+    int64_t const* rhs = &U7_VM0_COMPACT_PAIR_LOCAL(i64, 2, second); \
+    int64_t result[n * n];                                           \
+    for (int i = 0; i < n; ++i) {                                    \
+      for (int j = 0; j < n; ++j) {                                  \
+        int64_t sum = 0;                                             \
+        for (int k = 0; k < n; ++k) {                                \
+          int64_t product;                                           \
+          if (__builtin_mul_overflow(lhs[i * n + k], rhs[k * n + j], \
+                                     &product) ||                    \
+              __builtin_add_overflow(sum, product, &sum)) {          \
+            goto generic;                                            \
+          }                                                          \
+        }                                                            \
+        result[i * n + j] = sum;                                     \
+      }                                                              \
+    }                                                                \
+    memcpy(&U7_VM0_COMPACT_LOCAL(i64, 0), result, sizeof(result));   \
+    U7_VM0_COMPACT_NEXT();                                           \
+  } while (0)
+
+#define U7_VM0_COMPACT_MATRIX_MULTIPLY_F64(n)                       \
+  do {                                                              \
+    double const* lhs = &U7_VM0_COMPACT_PAIR_LOCAL(f64, 2, first);  \
+    double const* rhs = &U7_VM0_COMPACT_PAIR_LOCAL(f64, 2, second); \
+    double result[n * n];                                           \
+    for (int i = 0; i < n; ++i) {                                   \
+      for (int j = 0; j < n; ++j) {                                 \
+        double sum = lhs[i * n] * rhs[j];                           \
+        for (int k = 1; k < n; ++k) {                               \
+          sum += lhs[i * n + k] * rhs[k * n + j];                   \
+        }                                                           \
+        result[i * n + j] = sum;                                    \
+      }                                                             \
+    }                                                               \
+    memcpy(&U7_VM0_COMPACT_LOCAL(f64, 0), result, sizeof(result));  \
+    U7_VM0_COMPACT_NEXT();                                          \
+  } while (0)
+
+// Returns from a call, or ends the program outside of one.
+#define U7_VM0_COMPACT_LEAVE_CALL(result, result_size)          \
+  do {                                                          \
+    state->ip = (size_t)(it - program->instructions) + 1;       \
+    if (!u7_vm0_state_leave_call(state, result, result_size)) { \
+      return;                                                   \
+    }                                                           \
+    it = program->instructions + state->ip;                     \
+    locals = u7_vm_state_locals(state);                         \
+    U7_VM0_COMPACT_DISPATCH();                                  \
+  } while (0)
+
+#define U7_VM0_COMPACT_RET_VALUE(type)                                         \
+  do {                                                                         \
+    const union u7_vm0_value result = {.type = U7_VM0_COMPACT_LOCAL(type, 0)}; \
+    U7_VM0_COMPACT_LEAVE_CALL(&result, sizeof(result.type));                   \
+  } while (0)
+
+void u7_vm0_compact_run(struct u7_vm0_compact_program const* program,
+                        struct u7_vm_state* state) {
+  static void const* const handler_table[U7_VM0_OPCODE_COUNT] = {
+      [U7_VM0_OPCODE_YIELD] = &&yield,
+      [U7_VM0_OPCODE_RET] = &&ret,
+      [U7_VM0_OPCODE_RET_I32V] = &&ret_i32v,
+      [U7_VM0_OPCODE_RET_I64V] = &&ret_i64v,
+      [U7_VM0_OPCODE_RET_F32V] = &&ret_f32v,
+      [U7_VM0_OPCODE_RET_F64V] = &&ret_f64v,
+      [U7_VM0_OPCODE_CALL] = &&call,
+      [U7_VM0_OPCODE_TAIL_CALL] = &&tail_call,
+      [U7_VM0_OPCODE_COPY_I32C] = &&copy_i32c,
+      [U7_VM0_OPCODE_COPY_I64C] = &&copy_i64c,
+      [U7_VM0_OPCODE_COPY_F32C] = &&copy_f32c,
+      [U7_VM0_OPCODE_COPY_F64C] = &&copy_f64c,
+      [U7_VM0_OPCODE_COPY_I32V] = &&copy_i32v,
+      [U7_VM0_OPCODE_COPY_I64V] = &&copy_i64v,
+      [U7_VM0_OPCODE_COPY_F32V] = &&copy_f32v,
+      [U7_VM0_OPCODE_COPY_F64V] = &&copy_f64v,
+      [U7_VM0_OPCODE_BITWISE_AND_I32VC] = &&bitwise_and_i32vc,
+      [U7_VM0_OPCODE_BITWISE_AND_I64VC] = &&bitwise_and_i64vc,
+      [U7_VM0_OPCODE_BITWISE_RIGHT_SHIFT_I64VC] = &&bitwise_right_shift_i64vc,
+      [U7_VM0_OPCODE_MATH_ADD_I64VC] = &&math_add_i64vc,
+      [U7_VM0_OPCODE_MATH_ADD_I64VV] = &&math_add_i64vv,
+      [U7_VM0_OPCODE_MATH_ADD_F64VC] = &&math_add_f64vc,
+      [U7_VM0_OPCODE_MATH_ADD_F64VV] = &&math_add_f64vv,
+      [U7_VM0_OPCODE_MATH_MULTIPLY_I64VC] = &&math_multiply_i64vc,
+      [U7_VM0_OPCODE_MATH_MULTIPLY_I64VV] = &&math_multiply_i64vv,
+      [U7_VM0_OPCODE_MATH_MULTIPLY_F64VC] = &&math_multiply_f64vc,
+      [U7_VM0_OPCODE_MATH_MULTIPLY_F64VV] = &&math_multiply_f64vv,
+      [U7_VM0_OPCODE_JUMP_IF_ZERO_I32_UNCHECKED] = &&jump_if_zero_i32_unchecked,
+      [U7_VM0_OPCODE_JUMP_IF_ZERO_I64_UNCHECKED] = &&jump_if_zero_i64_unchecked,
+      [U7_VM0_OPCODE_JUMP_IF_ZERO_F64_UNCHECKED] = &&jump_if_zero_f64_unchecked,
+      [U7_VM0_OPCODE_JUMP_IF_NOT_ZERO_I32_UNCHECKED] =
+          &&jump_if_not_zero_i32_unchecked,
+      [U7_VM0_OPCODE_JUMP_IF_NOT_ZERO_I64_UNCHECKED] =
+          &&jump_if_not_zero_i64_unchecked,
+      [U7_VM0_OPCODE_JUMP_IF_NOT_ZERO_F64_UNCHECKED] =
+          &&jump_if_not_zero_f64_unchecked,
+      [U7_VM0_OPCODE_JUMP_UNCHECKED] = &&jump_unchecked,
+      [U7_VM0_OPCODE_JUMP_TABLE_I32_UNCHECKED] = &&jump_table_i32_unchecked,
+      [U7_VM0_OPCODE_JUMP_TABLE_I64_UNCHECKED] = &&jump_table_i64_unchecked,
+      [U7_VM0_OPCODE_JUMP_IF_EQUAL_I32VC_UNCHECKED] =
+          &&jump_if_equal_i32vc_unchecked,
+      [U7_VM0_OPCODE_JUMP_IF_EQUAL_I32VV_UNCHECKED] =
+          &&jump_if_equal_i32vv_unchecked,
+      [U7_VM0_OPCODE_JUMP_IF_EQUAL_I64VC_UNCHECKED] =
+          &&jump_if_equal_i64vc_unchecked,
+      [U7_VM0_OPCODE_JUMP_IF_EQUAL_I64VV_UNCHECKED] =
+          &&jump_if_equal_i64vv_unchecked,
+      [U7_VM0_OPCODE_JUMP_IF_EQUAL_F64VC_UNCHECKED] =
+          &&jump_if_equal_f64vc_unchecked,
+      [U7_VM0_OPCODE_JUMP_IF_EQUAL_F64VV_UNCHECKED] =
+          &&jump_if_equal_f64vv_unchecked,
+      [U7_VM0_OPCODE_JUMP_IF_NOT_EQUAL_I32VC_UNCHECKED] =
+          &&jump_if_not_equal_i32vc_unchecked,
+      [U7_VM0_OPCODE_JUMP_IF_NOT_EQUAL_I32VV_UNCHECKED] =
+          &&jump_if_not_equal_i32vv_unchecked,
+      [U7_VM0_OPCODE_JUMP_IF_NOT_EQUAL_I64VC_UNCHECKED] =
+          &&jump_if_not_equal_i64vc_unchecked,
+      [U7_VM0_OPCODE_JUMP_IF_NOT_EQUAL_I64VV_UNCHECKED] =
+          &&jump_if_not_equal_i64vv_unchecked,
+      [U7_VM0_OPCODE_JUMP_IF_NOT_EQUAL_F64VC_UNCHECKED] =
+          &&jump_if_not_equal_f64vc_unchecked,
+      [U7_VM0_OPCODE_JUMP_IF_NOT_EQUAL_F64VV_UNCHECKED] =
+          &&jump_if_not_equal_f64vv_unchecked,
+      [U7_VM0_OPCODE_JUMP_IF_LESS_I32VC_UNCHECKED] =
+          &&jump_if_less_i32vc_unchecked,
+      [U7_VM0_OPCODE_JUMP_IF_LESS_I32VV_UNCHECKED] =
+          &&jump_if_less_i32vv_unchecked,
+      [U7_VM0_OPCODE_JUMP_IF_LESS_I64VC_UNCHECKED] =
+          &&jump_if_less_i64vc_unchecked,
+      [U7_VM0_OPCODE_JUMP_IF_LESS_I64VV_UNCHECKED] =
+          &&jump_if_less_i64vv_unchecked,
+      [U7_VM0_OPCODE_JUMP_IF_LESS_F64VC_UNCHECKED] =
+          &&jump_if_less_f64vc_unchecked,
+      [U7_VM0_OPCODE_JUMP_IF_LESS_F64VV_UNCHECKED] =
+          &&jump_if_less_f64vv_unchecked,
+      [U7_VM0_OPCODE_JUMP_IF_LESS_OR_EQUAL_I32VC_UNCHECKED] =
+          &&jump_if_less_or_equal_i32vc_unchecked,
+      [U7_VM0_OPCODE_JUMP_IF_LESS_OR_EQUAL_I32VV_UNCHECKED] =
+          &&jump_if_less_or_equal_i32vv_unchecked,
+      [U7_VM0_OPCODE_JUMP_IF_LESS_OR_EQUAL_I64VC_UNCHECKED] =
+          &&jump_if_less_or_equal_i64vc_unchecked,
+      [U7_VM0_OPCODE_JUMP_IF_LESS_OR_EQUAL_I64VV_UNCHECKED] =
+          &&jump_if_less_or_equal_i64vv_unchecked,
+      [U7_VM0_OPCODE_JUMP_IF_LESS_OR_EQUAL_F64VC_UNCHECKED] =
+          &&jump_if_less_or_equal_f64vc_unchecked,
+      [U7_VM0_OPCODE_JUMP_IF_LESS_OR_EQUAL_F64VV_UNCHECKED] =
+          &&jump_if_less_or_equal_f64vv_unchecked,
+      [U7_VM0_OPCODE_JUMP_IF_GREATER_I32VC_UNCHECKED] =
+          &&jump_if_greater_i32vc_unchecked,
+      [U7_VM0_OPCODE_JUMP_IF_GREATER_I64VC_UNCHECKED] =
+          &&jump_if_greater_i64vc_unchecked,
+      [U7_VM0_OPCODE_JUMP_IF_GREATER_F64VC_UNCHECKED] =
+          &&jump_if_greater_f64vc_unchecked,
+      [U7_VM0_OPCODE_JUMP_IF_GREATER_OR_EQUAL_I32VC_UNCHECKED] =
+          &&jump_if_greater_or_equal_i32vc_unchecked,
+      [U7_VM0_OPCODE_JUMP_IF_GREATER_OR_EQUAL_I64VC_UNCHECKED] =
+          &&jump_if_greater_or_equal_i64vc_unchecked,
+      [U7_VM0_OPCODE_JUMP_IF_GREATER_OR_EQUAL_F64VC_UNCHECKED] =
+          &&jump_if_greater_or_equal_f64vc_unchecked,
+      [U7_VM0_OPCODE_BITWISE_AND_JUMP_IF_ZERO_I64VC] =
+          &&bitwise_and_jump_if_zero_i64vc,
+      [U7_VM0_OPCODE_BITWISE_AND_JUMP_IF_NOT_ZERO_I64VC] =
+          &&bitwise_and_jump_if_not_zero_i64vc,
+      [U7_VM0_OPCODE_BITWISE_RIGHT_SHIFT_JUMP_IF_NOT_ZERO_I64VC] =
+          &&bitwise_right_shift_jump_if_not_zero_i64vc,
+      [U7_VM0_OPCODE_MATH_ADD_2_F64VV] = &&math_add_2_f64vv,
+      [U7_VM0_OPCODE_MATH_MULTIPLY_2_F64VV] = &&math_multiply_2_f64vv,
+      [U7_VM0_OPCODE_MATH_MULTIPLY_ADD_F64VVV] = &&math_multiply_add_f64vvv,
+      [U7_VM0_OPCODE_MATRIX_MULTIPLY_2X2_I64] = &&matrix_multiply_2x2_i64,
+      [U7_VM0_OPCODE_MATRIX_MULTIPLY_2X2_F64] = &&matrix_multiply_2x2_f64,
+      [U7_VM0_OPCODE_MATRIX_MULTIPLY_3X3_I64] = &&matrix_multiply_3x3_i64,
+      [U7_VM0_OPCODE_MATRIX_MULTIPLY_3X3_F64] = &&matrix_multiply_3x3_f64,
+      [U7_VM0_OPCODE_MATRIX_MULTIPLY_4X4_I64] = &&matrix_multiply_4x4_i64,
+      [U7_VM0_OPCODE_MATRIX_MULTIPLY_4X4_F64] = &&matrix_multiply_4x4_f64,
+  };
+  assert(state->instructions_size == program->instructions_size);
+  assert(state->ip < program->instructions_size);
+  struct u7_vm0_compact_instruction const* it =
+      program->instructions + state->ip;
+  void* locals = u7_vm_state_locals(state);
+  U7_VM0_COMPACT_DISPATCH();
+
+yield:
+  state->ip = (size_t)(it - program->instructions) + 1;
+  return;
+
+ret:
+  U7_VM0_COMPACT_LEAVE_CALL(NULL, 0);
+
+ret_i32v:
+  U7_VM0_COMPACT_RET_VALUE(i32);
+
+ret_i64v:
+  U7_VM0_COMPACT_RET_VALUE(i64);
+
+ret_f32v:
+  U7_VM0_COMPACT_RET_VALUE(f32);
+
+ret_f64v:
+  U7_VM0_COMPACT_RET_VALUE(f64);
+
+call:
+  if (it->args[0] >= program->instructions_size) {
+    goto generic;  // Reports the fault.
+  }
+  state->ip = (size_t)(it - program->instructions) + 1;
+  if (!u7_vm0_state_enter_call(
+          state, it->args[0],
+          u7_vm0_operand_frame_layout(U7_VM0_COMPACT_CONSTANT(i64, 1)),
+          U7_VM0_COMPACT_CONSTANT(i64, 2))) {
+    return;
+  }
+  it = program->instructions + state->ip;
+  locals = u7_vm_state_locals(state);
+  U7_VM0_COMPACT_DISPATCH();
+
+tail_call:
+  // Only the reuse of the current frame is handled here; see
+  // u7_vm0_tail_call().
+  {
+    const int64_t slots = U7_VM0_COMPACT_CONSTANT(i64, 2);
+    if (it->args[0] >= program->instructions_size ||
+        u7_vm0_state_globals(state)->call_depth == 0 ||
+        u7_vm_stack_current_frame_layout(&state->stack) !=
+            u7_vm0_operand_frame_layout(U7_VM0_COMPACT_CONSTANT(i64, 1))) {
+      goto generic;
+    }
+    memmove(locals,
+            u7_vm_memory_add_offset(locals, u7_vm0_operand_pair_first(slots)),
+            sizeof(int64_t) * (size_t)u7_vm0_operand_pair_second(slots));
+    it = program->instructions + it->args[0];
+  }
+  U7_VM0_COMPACT_DISPATCH();
+
+generic:
+  // Instructions without a dedicated handler (and the slow paths of the
+  // ones with it) are decoded and executed through their regular
+  // execute_fn.
+  {
+    const size_t index = (size_t)(it - program->instructions);
+    const struct u7_vm0_instruction instruction =
+        u7_vm0_compact_program_decode(program, index);
+    state->ip = index + 1;
+    if (!instruction.base.execute_fn(state, &instruction.base)) {
+      return;
+    }
+    it = program->instructions + state->ip;
+    locals = u7_vm_state_locals(state);
+  }
+  U7_VM0_COMPACT_DISPATCH();
+
+copy_i32c:
+  U7_VM0_COMPACT_LOCAL(i32, 0) = U7_VM0_COMPACT_CONSTANT(i32, 1);
+  U7_VM0_COMPACT_NEXT();
+
+copy_i64c:
+  U7_VM0_COMPACT_LOCAL(i64, 0) = U7_VM0_COMPACT_CONSTANT(i64, 1);
+  U7_VM0_COMPACT_NEXT();
+
+copy_f32c:
+  U7_VM0_COMPACT_LOCAL(f32, 0) = U7_VM0_COMPACT_CONSTANT(f32, 1);
+  U7_VM0_COMPACT_NEXT();
+
+copy_f64c:
+  U7_VM0_COMPACT_LOCAL(f64, 0) = U7_VM0_COMPACT_CONSTANT(f64, 1);
+  U7_VM0_COMPACT_NEXT();
+
+copy_i32v:
+  U7_VM0_COMPACT_LOCAL(i32, 0) = U7_VM0_COMPACT_LOCAL(i32, 1);
+  U7_VM0_COMPACT_NEXT();
+
+copy_i64v:
+  U7_VM0_COMPACT_LOCAL(i64, 0) = U7_VM0_COMPACT_LOCAL(i64, 1);
+  U7_VM0_COMPACT_NEXT();
+
+copy_f32v:
+  U7_VM0_COMPACT_LOCAL(f32, 0) = U7_VM0_COMPACT_LOCAL(f32, 1);
+  U7_VM0_COMPACT_NEXT();
+
+copy_f64v:
+  U7_VM0_COMPACT_LOCAL(f64, 0) = U7_VM0_COMPACT_LOCAL(f64, 1);
+  U7_VM0_COMPACT_NEXT();
+
+bitwise_and_i32vc:
+  U7_VM0_COMPACT_LOCAL(i32, 0) =
+      U7_VM0_COMPACT_LOCAL(i32, 1) & U7_VM0_COMPACT_CONSTANT(i32, 2);
+  U7_VM0_COMPACT_NEXT();
+
+bitwise_and_i64vc:
+  U7_VM0_COMPACT_LOCAL(i64, 0) =
+      U7_VM0_COMPACT_LOCAL(i64, 1) & U7_VM0_COMPACT_CONSTANT(i64, 2);
+  U7_VM0_COMPACT_NEXT();
+
+bitwise_right_shift_i64vc:
+  U7_VM0_COMPACT_LOCAL(i64, 0) =
+      U7_VM0_COMPACT_LOCAL(i64, 1) >> U7_VM0_COMPACT_CONSTANT(i64, 2);
+  U7_VM0_COMPACT_NEXT();
+
+math_add_i64vc:
+  U7_VM0_COMPACT_CHECKED_BINARY(i64, int64_t, __builtin_add_overflow,
+                                U7_VM0_COMPACT_CONSTANT(i64, 2));
+
+math_add_i64vv:
+  U7_VM0_COMPACT_CHECKED_BINARY(i64, int64_t, __builtin_add_overflow,
+                                U7_VM0_COMPACT_LOCAL(i64, 2));
+
+math_add_f64vc:
+  U7_VM0_COMPACT_LOCAL(f64, 0) =
+      U7_VM0_COMPACT_LOCAL(f64, 1) + U7_VM0_COMPACT_CONSTANT(f64, 2);
+  U7_VM0_COMPACT_NEXT();
+
+math_add_f64vv:
+  U7_VM0_COMPACT_LOCAL(f64, 0) =
+      U7_VM0_COMPACT_LOCAL(f64, 1) + U7_VM0_COMPACT_LOCAL(f64, 2);
+  U7_VM0_COMPACT_NEXT();
+
+math_multiply_i64vc:
+  U7_VM0_COMPACT_CHECKED_BINARY(i64, int64_t, __builtin_mul_overflow,
+                                U7_VM0_COMPACT_CONSTANT(i64, 2));
+
+math_multiply_i64vv:
+  U7_VM0_COMPACT_CHECKED_BINARY(i64, int64_t, __builtin_mul_overflow,
+                                U7_VM0_COMPACT_LOCAL(i64, 2));
+
+math_multiply_f64vc:
+  U7_VM0_COMPACT_LOCAL(f64, 0) =
+      U7_VM0_COMPACT_LOCAL(f64, 1) * U7_VM0_COMPACT_CONSTANT(f64, 2);
+  U7_VM0_COMPACT_NEXT();
+
+math_multiply_f64vv:
+  U7_VM0_COMPACT_LOCAL(f64, 0) =
+      U7_VM0_COMPACT_LOCAL(f64, 1) * U7_VM0_COMPACT_LOCAL(f64, 2);
+  U7_VM0_COMPACT_NEXT();
+
+jump_if_zero_i32_unchecked:
+  U7_VM0_COMPACT_JUMP_IF(U7_VM0_COMPACT_LOCAL(i32, 0) == 0, 1);
+
+jump_if_zero_i64_unchecked:
+  U7_VM0_COMPACT_JUMP_IF(U7_VM0_COMPACT_LOCAL(i64, 0) == 0, 1);
+
+jump_if_zero_f64_unchecked:
+  U7_VM0_COMPACT_JUMP_IF(U7_VM0_COMPACT_LOCAL(f64, 0) == 0, 1);
+
+jump_if_not_zero_i32_unchecked:
+  U7_VM0_COMPACT_JUMP_IF(U7_VM0_COMPACT_LOCAL(i32, 0) != 0, 1);
+
+jump_if_not_zero_i64_unchecked:
+  U7_VM0_COMPACT_JUMP_IF(U7_VM0_COMPACT_LOCAL(i64, 0) != 0, 1);
+
+jump_if_not_zero_f64_unchecked:
+  U7_VM0_COMPACT_JUMP_IF(U7_VM0_COMPACT_LOCAL(f64, 0) != 0, 1);
+
+jump_unchecked:
+  U7_VM0_COMPACT_JUMP_IF(true, 0);
+
+jump_table_i32_unchecked:
+  U7_VM0_COMPACT_JUMP_TABLE(i32);
+
+jump_table_i64_unchecked:
+  U7_VM0_COMPACT_JUMP_TABLE(i64);
+
+jump_if_equal_i32vc_unchecked:
+  U7_VM0_COMPACT_JUMP_IF_COMPARE(i32, ==, U7_VM0_COMPACT_CONSTANT(i32, 1));
+
+jump_if_equal_i32vv_unchecked:
+  U7_VM0_COMPACT_JUMP_IF_COMPARE(i32, ==, U7_VM0_COMPACT_LOCAL(i32, 1));
+
+jump_if_equal_i64vc_unchecked:
+  U7_VM0_COMPACT_JUMP_IF_COMPARE(i64, ==, U7_VM0_COMPACT_CONSTANT(i64, 1));
+
+jump_if_equal_i64vv_unchecked:
+  U7_VM0_COMPACT_JUMP_IF_COMPARE(i64, ==, U7_VM0_COMPACT_LOCAL(i64, 1));
+
+jump_if_equal_f64vc_unchecked:
+  U7_VM0_COMPACT_JUMP_IF_COMPARE(f64, ==, U7_VM0_COMPACT_CONSTANT(f64, 1));
+
+jump_if_equal_f64vv_unchecked:
+  U7_VM0_COMPACT_JUMP_IF_COMPARE(f64, ==, U7_VM0_COMPACT_LOCAL(f64, 1));
+
+jump_if_not_equal_i32vc_unchecked:
+  U7_VM0_COMPACT_JUMP_IF_COMPARE(i32, !=, U7_VM0_COMPACT_CONSTANT(i32, 1));
+
+jump_if_not_equal_i32vv_unchecked:
+  U7_VM0_COMPACT_JUMP_IF_COMPARE(i32, !=, U7_VM0_COMPACT_LOCAL(i32, 1));
+
+jump_if_not_equal_i64vc_unchecked:
+  U7_VM0_COMPACT_JUMP_IF_COMPARE(i64, !=, U7_VM0_COMPACT_CONSTANT(i64, 1));
+
+jump_if_not_equal_i64vv_unchecked:
+  U7_VM0_COMPACT_JUMP_IF_COMPARE(i64, !=, U7_VM0_COMPACT_LOCAL(i64, 1));
+
+jump_if_not_equal_f64vc_unchecked:
+  U7_VM0_COMPACT_JUMP_IF_COMPARE(f64, !=, U7_VM0_COMPACT_CONSTANT(f64, 1));
+
+jump_if_not_equal_f64vv_unchecked:
+  U7_VM0_COMPACT_JUMP_IF_COMPARE(f64, !=, U7_VM0_COMPACT_LOCAL(f64, 1));
+
+jump_if_less_i32vc_unchecked:
+  U7_VM0_COMPACT_JUMP_IF_COMPARE(i32, <, U7_VM0_COMPACT_CONSTANT(i32, 1));
+
+jump_if_less_i32vv_unchecked:
+  U7_VM0_COMPACT_JUMP_IF_COMPARE(i32, <, U7_VM0_COMPACT_LOCAL(i32, 1));
+
+jump_if_less_i64vc_unchecked:
+  U7_VM0_COMPACT_JUMP_IF_COMPARE(i64, <, U7_VM0_COMPACT_CONSTANT(i64, 1));
+
+jump_if_less_i64vv_unchecked:
+  U7_VM0_COMPACT_JUMP_IF_COMPARE(i64, <, U7_VM0_COMPACT_LOCAL(i64, 1));
+
+jump_if_less_f64vc_unchecked:
+  U7_VM0_COMPACT_JUMP_IF_COMPARE(f64, <, U7_VM0_COMPACT_CONSTANT(f64, 1));
+
+jump_if_less_f64vv_unchecked:
+  U7_VM0_COMPACT_JUMP_IF_COMPARE(f64, <, U7_VM0_COMPACT_LOCAL(f64, 1));
+
+jump_if_less_or_equal_i32vc_unchecked:
+  U7_VM0_COMPACT_JUMP_IF_COMPARE(i32, <=, U7_VM0_COMPACT_CONSTANT(i32, 1));
+
+jump_if_less_or_equal_i32vv_unchecked:
+  U7_VM0_COMPACT_JUMP_IF_COMPARE(i32, <=, U7_VM0_COMPACT_LOCAL(i32, 1));
+
+jump_if_less_or_equal_i64vc_unchecked:
+  U7_VM0_COMPACT_JUMP_IF_COMPARE(i64, <=, U7_VM0_COMPACT_CONSTANT(i64, 1));
+
+jump_if_less_or_equal_i64vv_unchecked:
+  U7_VM0_COMPACT_JUMP_IF_COMPARE(i64, <=, U7_VM0_COMPACT_LOCAL(i64, 1));
+
+jump_if_less_or_equal_f64vc_unchecked:
+  U7_VM0_COMPACT_JUMP_IF_COMPARE(f64, <=, U7_VM0_COMPACT_CONSTANT(f64, 1));
+
+jump_if_less_or_equal_f64vv_unchecked:
+  U7_VM0_COMPACT_JUMP_IF_COMPARE(f64, <=, U7_VM0_COMPACT_LOCAL(f64, 1));
+
+jump_if_greater_i32vc_unchecked:
+  U7_VM0_COMPACT_JUMP_IF_COMPARE(i32, >, U7_VM0_COMPACT_CONSTANT(i32, 1));
+
+jump_if_greater_i64vc_unchecked:
+  U7_VM0_COMPACT_JUMP_IF_COMPARE(i64, >, U7_VM0_COMPACT_CONSTANT(i64, 1));
+
+jump_if_greater_f64vc_unchecked:
+  U7_VM0_COMPACT_JUMP_IF_COMPARE(f64, >, U7_VM0_COMPACT_CONSTANT(f64, 1));
+
+jump_if_greater_or_equal_i32vc_unchecked:
+  U7_VM0_COMPACT_JUMP_IF_COMPARE(i32, >=, U7_VM0_COMPACT_CONSTANT(i32, 1));
+
+jump_if_greater_or_equal_i64vc_unchecked:
+  U7_VM0_COMPACT_JUMP_IF_COMPARE(i64, >=, U7_VM0_COMPACT_CONSTANT(i64, 1));
+
+jump_if_greater_or_equal_f64vc_unchecked:
+  U7_VM0_COMPACT_JUMP_IF_COMPARE(f64, >=, U7_VM0_COMPACT_CONSTANT(f64, 1));
+
+bitwise_and_jump_if_zero_i64vc:
+  {
+    const int64_t result = U7_VM0_COMPACT_PAIR_LOCAL(i64, 0, second) &
+                           U7_VM0_COMPACT_CONSTANT(i64, 1);
+    U7_VM0_COMPACT_PAIR_LOCAL(i64, 0, first) = result;
+    U7_VM0_COMPACT_JUMP_IF(result == 0, 2);
+  }
+
+bitwise_and_jump_if_not_zero_i64vc:
+  {
+    const int64_t result = U7_VM0_COMPACT_PAIR_LOCAL(i64, 0, second) &
+                           U7_VM0_COMPACT_CONSTANT(i64, 1);
+    U7_VM0_COMPACT_PAIR_LOCAL(i64, 0, first) = result;
+    U7_VM0_COMPACT_JUMP_IF(result != 0, 2);
+  }
+
+bitwise_right_shift_jump_if_not_zero_i64vc:
+  {
+    const int64_t result = U7_VM0_COMPACT_PAIR_LOCAL(i64, 0, second) >>
+                           U7_VM0_COMPACT_CONSTANT(i64, 1);
+    U7_VM0_COMPACT_PAIR_LOCAL(i64, 0, first) = result;
+    U7_VM0_COMPACT_JUMP_IF(result != 0, 2);
+  }
+
+math_add_2_f64vv:
+  U7_VM0_COMPACT_PAIR_LOCAL(f64, 0, first) =
+      U7_VM0_COMPACT_PAIR_LOCAL(f64, 1, first) +
+      U7_VM0_COMPACT_PAIR_LOCAL(f64, 1, second);
+  U7_VM0_COMPACT_PAIR_LOCAL(f64, 0, second) =
+      U7_VM0_COMPACT_PAIR_LOCAL(f64, 2, first) +
+      U7_VM0_COMPACT_PAIR_LOCAL(f64, 2, second);
+  U7_VM0_COMPACT_NEXT();
+
+math_multiply_2_f64vv:
+  U7_VM0_COMPACT_PAIR_LOCAL(f64, 0, first) =
+      U7_VM0_COMPACT_PAIR_LOCAL(f64, 1, first) *
+      U7_VM0_COMPACT_PAIR_LOCAL(f64, 1, second);
+  U7_VM0_COMPACT_PAIR_LOCAL(f64, 0, second) =
+      U7_VM0_COMPACT_PAIR_LOCAL(f64, 2, first) *
+      U7_VM0_COMPACT_PAIR_LOCAL(f64, 2, second);
+  U7_VM0_COMPACT_NEXT();
+
+math_multiply_add_f64vvv:
+  U7_VM0_COMPACT_PAIR_LOCAL(f64, 0, first) =
+      U7_VM0_COMPACT_PAIR_LOCAL(f64, 1, first) *
+      U7_VM0_COMPACT_PAIR_LOCAL(f64, 1, second);
+  U7_VM0_COMPACT_PAIR_LOCAL(f64, 0, second) =
+      U7_VM0_COMPACT_PAIR_LOCAL(f64, 0, first) +
+      U7_VM0_COMPACT_LOCAL(f64, 2);
+  U7_VM0_COMPACT_NEXT();
+
+matrix_multiply_2x2_i64:
+  U7_VM0_COMPACT_MATRIX_MULTIPLY_I64(2);
+
+matrix_multiply_2x2_f64:
+  U7_VM0_COMPACT_MATRIX_MULTIPLY_F64(2);
+
+matrix_multiply_3x3_i64:
+  U7_VM0_COMPACT_MATRIX_MULTIPLY_I64(3);
+
+matrix_multiply_3x3_f64:
+  U7_VM0_COMPACT_MATRIX_MULTIPLY_F64(3);
+
+matrix_multiply_4x4_i64:
+  U7_VM0_COMPACT_MATRIX_MULTIPLY_I64(4);
+
+matrix_multiply_4x4_f64:
+  U7_VM0_COMPACT_MATRIX_MULTIPLY_F64(4);
+}
@@ -0,0 +1,352 @@
+#include "@/public/compact.h"
+
+#include "@/public/assembler.h"
+#include "@/public/program.h"
+#include "@/public/vm0.h"
+#include "@/testing.h"
+
+#include <errno.h>
+#include <github.com/apronchenkov/error/public/error.h>
+#include <github.com/apronchenkov/vm/public/state.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Tests for the compact form of a program: the encoding round-trips, the
+// operands that do not fit are rejected, and u7_vm0_compact_run() writes the
+// same values and fails in the same way as the regular dispatch loop,
+// including across calls.
+
+static void run_compact(void const* engine, struct u7_vm_state* state) {
+  u7_vm0_compact_run((struct u7_vm0_compact_program const*)engine, state);
+}
+
+// Encodes the program, checks that every instruction decodes back to
+// itself, and runs the program for every input.
+static u7_error check_compact(const char* name,
+                              struct u7_vm0_program const* program,
+                              int64_t const* inputs, size_t inputs_size) {
+  struct u7_vm0_compact_program compact;
+  u7_error error = u7_vm0_compact_program_init(
+      &compact, program->instructions, program->instructions_size);
+  if (error.error_code != 0) {
+    return error;
+  }
+  for (size_t i = 0; i < program->instructions_size; ++i) {
+    const struct u7_vm0_instruction decoded =
+        u7_vm0_compact_program_decode(&compact, i);
+    const struct u7_vm0_instruction* original = &program->instructions[i];
+    if (decoded.base.execute_fn != original->base.execute_fn ||
+        decoded.arg1.i64 != original->arg1.i64 ||
+        decoded.arg2.i64 != original->arg2.i64 ||
+        decoded.arg3.i64 != original->arg3.i64) {
+      error = u7_errnof(EINVAL, "%s: instruction %zu does not round-trip",
+                        name, i);
+      break;
+    }
+  }
+  for (size_t i = 0; i < inputs_size && error.error_code == 0; ++i) {
+    error = u7_vm0_test_check_engine(name, program, &run_compact, &compact,
+                                     &inputs[i], 1);
+  }
+  u7_vm0_compact_program_destroy(&compact);
+  return error;
+}
+
+static u7_error check_compact_text(const char* name, const char* text,
+                                   int64_t const* inputs,
+                                   size_t inputs_size) {
+  struct u7_vm0_program program;
+  u7_error error = u7_vm0_assemble(&program, text, strlen(text));
+  if (error.error_code != 0) {
+    return error;
+  }
+  error = check_compact(name, &program, inputs, inputs_size);
+  u7_vm0_program_destroy(&program);
+  return error;
+}
+
+static u7_error test_loop() {
+  static const char text[] =
+      "i64 n, i, s\n"
+      "read n\n"
+      "i = 0\n"
+      "s = 0\n"
+      "jz n, done\n"
+      "loop: i = i + 1\n"
+      "s = s + i\n"
+      "if i < n goto loop\n"
+      "done: write s\n"
+      "ret\n";
+  int64_t const inputs[] = {0, 1, 10, 1000};
+  return check_compact_text("loop", text, inputs,
+                            sizeof(inputs) / sizeof(inputs[0]));
+}
+
+// The constants that do not fit into an operand go to the pool; the pool
+// is shared by equal constants.
+static u7_error test_constants() {
+  static const char text[] =
+      "i64 n, a\n"
+      "f64 x, y\n"
+      "read n\n"
+      "a = n * 1099511627776\n"
+      "a = a + 1099511627776\n"
+      "write a\n"
+      "x = 0.5\n"
+      "y = 0\n"
+      "loop: x = x * 1.5\n"
+      "y = y + x\n"
+      "n = n + -1\n"
+      "if n > 0 goto loop\n"
+      "write y\n"
+      "if y >= 1e300 goto huge\n"
+      "write 1\n"
+      "ret\n"
+      "huge: write 2\n"
+      "ret\n";
+  int64_t const inputs[] = {0, 3, 100};
+  return check_compact_text("constants", text, inputs,
+                            sizeof(inputs) / sizeof(inputs[0]));
+}
+
+static u7_error test_jump_table_and_yield() {
+  static const char text[] =
+      "i64 s, r\n"
+      "read s\n"
+      "yield\n"
+      "switch s, other, zero, one\n"
+      "other: r = -1\n"
+      "jmp done\n"
+      "zero: r = 10\n"
+      "jmp done\n"
+      "one: r = 11\n"
+      "yield\n"
+      "done: write r\n"
+      "ret\n";
+  int64_t const inputs[] = {0, 1, 2, -1};
+  return check_compact_text("jump_table_and_yield", text, inputs,
+                            sizeof(inputs) / sizeof(inputs[0]));
+}
+
+// The failures stop the program after the values written before them.
+static u7_error test_failures() {
+  static const char text[] =
+      "i64 n\n"
+      "read n\n"
+      "write n\n"
+      "n = n * n\n"
+      "write n\n"
+      "read n\n"
+      "ret\n";
+  int64_t const inputs[] = {3, INT64_C(1) << 40};
+  return check_compact_text("failures", text, inputs,
+                            sizeof(inputs) / sizeof(inputs[0]));
+}
+
+// Locals of the functions below: `n`, `a` and `b` first; a call passes the
+// slot of its first variable. The verifier checks every function against
+// the locals frame, so the other layout is the smaller one.
+static const struct u7_vm_stack_frame_layout call_frame_layout = {
+    .locals_size = 4 * sizeof(int64_t),
+    .description = "compact_test",
+};
+
+static const struct u7_vm_stack_frame_layout other_frame_layout = {
+    .locals_size = 3 * sizeof(int64_t),
+    .description = "compact_test/other",
+};
+
+static struct u7_vm0_arg i64_variable(int64_t index) {
+  return (struct u7_vm0_arg){.kind = U7_VM0_ARG_KIND_I64_VARIABLE,
+                             .value.i64 = index * (int64_t)sizeof(int64_t)};
+}
+
+static struct u7_vm0_arg i64_constant(int64_t value) {
+  return (struct u7_vm0_arg){.kind = U7_VM0_ARG_KIND_I64_CONSTANT,
+                             .value.i64 = value};
+}
+
+static struct u7_vm0_arg label(int64_t index) {
+  return (struct u7_vm0_arg){.kind = U7_VM0_ARG_KIND_I64_LABEL,
+                             .value.i64 = index};
+}
+
+static u7_error check_compact_instructions(
+    const char* name, struct u7_vm0_instruction const* instructions,
+    size_t instructions_size, int64_t const* inputs, size_t inputs_size) {
+  struct u7_vm0_program program;
+  u7_error error = u7_vm0_test_program_init(
+      &program, instructions, instructions_size, &call_frame_layout);
+  if (error.error_code != 0) {
+    return error;
+  }
+  error = check_compact(name, &program, inputs, inputs_size);
+  u7_vm0_program_destroy(&program);
+  return error;
+}
+
+// fib(n) with two nested calls per level: call, ret_value, and the
+// returns to the different call sites.
+static u7_error test_recursive_call() {
+  const struct u7_vm0_arg n = i64_variable(0);
+  const struct u7_vm0_arg a = i64_variable(1);
+  const struct u7_vm0_arg b = i64_variable(2);
+  u7_error error = u7_ok();
+  const struct u7_vm0_instruction instructions[] = {
+      u7_vm0_input(&error, n),
+      u7_vm0_call(&error, label(4), &call_frame_layout, n, 1),
+      u7_vm0_output(&error, n),
+      u7_vm0_ret(),
+      // fib(n):
+      u7_vm0_jump_if_less(&error, n, i64_constant(2), label(11)),
+      u7_vm0_math_add(&error, a, n, i64_constant(-1)),
+      u7_vm0_call(&error, label(4), &call_frame_layout, a, 1),
+      u7_vm0_math_add(&error, b, n, i64_constant(-2)),
+      u7_vm0_call(&error, label(4), &call_frame_layout, b, 1),
+      u7_vm0_math_add(&error, a, a, b),
+      u7_vm0_ret_value(&error, a),
+      u7_vm0_ret_value(&error, n),
+  };
+  if (error.error_code != 0) {
+    return error;
+  }
+  int64_t const inputs[] = {0, 1, 2, 10, 20};
+  return check_compact_instructions(
+      "recursive_call", instructions,
+      sizeof(instructions) / sizeof(instructions[0]), inputs,
+      sizeof(inputs) / sizeof(inputs[0]));
+}
+
+// A self-recursive tail call reuses the frame; a tail call to a function
+// with another layout swaps the frames, and its `ret` (without a value)
+// returns to the original caller.
+static u7_error test_tail_call() {
+  const struct u7_vm0_arg n = i64_variable(0);
+  const struct u7_vm0_arg a = i64_variable(1);
+  u7_error error = u7_ok();
+  const struct u7_vm0_instruction instructions[] = {
+      u7_vm0_input(&error, n),
+      u7_vm0_copy(&error, a, i64_constant(7)),
+      u7_vm0_call(&error, label(7), &call_frame_layout, n, 2),
+      u7_vm0_output(&error, n),
+      u7_vm0_call(&error, label(12), &call_frame_layout, n, 2),
+      u7_vm0_output(&error, n),
+      u7_vm0_ret(),
+      // count(n, a): a += n while n > 0, returns a.
+      u7_vm0_jump_if_less_or_equal(&error, n, i64_constant(0), label(11)),
+      u7_vm0_math_add(&error, a, a, n),
+      u7_vm0_math_add(&error, n, n, i64_constant(-1)),
+      u7_vm0_tail_call(&error, label(7), &call_frame_layout, n, 2),
+      u7_vm0_ret_value(&error, a),
+      // forward(n, a): returns other(a, n), which writes and returns nothing.
+      u7_vm0_copy(&error, i64_variable(2), n),
+      u7_vm0_tail_call(&error, label(14), &other_frame_layout, a, 2),
+      // other(a, n):
+      u7_vm0_output(&error, i64_variable(1)),
+      u7_vm0_math_add(&error, i64_variable(2), i64_variable(0),
+                      i64_variable(1)),
+      u7_vm0_output(&error, i64_variable(2)),
+      u7_vm0_ret(),
+  };
+  if (error.error_code != 0) {
+    return error;
+  }
+  int64_t const inputs[] = {0, 1, 100};
+  return check_compact_instructions(
+      "tail_call", instructions,
+      sizeof(instructions) / sizeof(instructions[0]), inputs,
+      sizeof(inputs) / sizeof(inputs[0]));
+}
+
+// A failure inside a call stops the program; so does a `ret` from the
+// outermost function.
+static u7_error test_call_failure() {
+  const struct u7_vm0_arg n = i64_variable(0);
+  u7_error error = u7_ok();
+  const struct u7_vm0_instruction instructions[] = {
+      u7_vm0_input(&error, n),
+      u7_vm0_call(&error, label(4), &call_frame_layout, n, 1),
+      u7_vm0_output(&error, n),
+      u7_vm0_ret(),
+      // square(n):
+      u7_vm0_math_multiply(&error, n, n, n),
+      u7_vm0_ret_value(&error, n),
+  };
+  if (error.error_code != 0) {
+    return error;
+  }
+  int64_t const inputs[] = {-7, INT64_C(1) << 33};
+  return check_compact_instructions(
+      "call_failure", instructions,
+      sizeof(instructions) / sizeof(instructions[0]), inputs,
+      sizeof(inputs) / sizeof(inputs[0]));
+}
+
+// A variable offset must fit into 16 bits.
+static u7_error test_operand_out_of_range() {
+  static const char text[] =
+      "i64 v[9000]\n"
+      "v[8999] = 1\n"
+      "ret\n";
+  struct u7_vm0_program program;
+  u7_error error = u7_vm0_assemble(&program, text, strlen(text));
+  if (error.error_code != 0) {
+    return error;
+  }
+  struct u7_vm0_compact_program compact;
+  error = u7_vm0_test_expect_error(
+      "operand_out_of_range",
+      u7_vm0_compact_program_init(&compact, program.instructions,
+                                  program.instructions_size),
+      ERANGE);
+  u7_vm0_program_destroy(&program);
+  return error;
+}
+
+// The labels of a longer program would not fit into an operand.
+static u7_error test_too_many_instructions() {
+  static const char statement[] = "n = n + 1\n";
+  enum { kStatements = 70000 };
+  const size_t statement_size = sizeof(statement) - 1;
+  char* text = malloc(kStatements * statement_size + 32);
+  if (text == NULL) {
+    return u7_errnof(ENOMEM, "too_many_instructions: out of memory");
+  }
+  char* p = text;
+  p += sprintf(p, "i64 n\n");
+  for (int i = 0; i < kStatements; ++i) {
+    memcpy(p, statement, statement_size);
+    p += statement_size;
+  }
+  p += sprintf(p, "ret\n");
+  struct u7_vm0_program program;
+  u7_error error = u7_vm0_assemble(&program, text, (size_t)(p - text));
+  free(text);
+  if (error.error_code != 0) {
+    return error;
+  }
+  struct u7_vm0_compact_program compact;
+  error = u7_vm0_test_expect_error(
+      "too_many_instructions",
+      u7_vm0_compact_program_init(&compact, program.instructions,
+                                  program.instructions_size),
+      E2BIG);
+  u7_vm0_program_destroy(&program);
+  return error;
+}
+
+int main() {
+  u7_error (*const tests[])() = {
+      &test_loop,
+      &test_constants,
+      &test_jump_table_and_yield,
+      &test_failures,
+      &test_recursive_call,
+      &test_tail_call,
+      &test_call_failure,
+      &test_operand_out_of_range,
+      &test_too_many_instructions,
+  };
+  return u7_vm0_test_main(tests, sizeof(tests) / sizeof(tests[0]));
+}
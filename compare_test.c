@@ -0,0 +1,160 @@
+#include "@/public/vm0.h"
+
+#include "@/public/assembler.h"
+#include "@/public/program.h"
+#include "@/testing.h"
+
+#include <errno.h>
+#include <github.com/apronchenkov/error/public/error.h>
+#include <inttypes.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+
+// Tests for the compare-and-branch instructions: every comparison, of every
+// type, against a constant and against a variable, takes the branch exactly
+// when the comparison holds.
+
+static const char* const kTypes[] = {"i32", "i64", "f32", "f64"};
+
+struct comparison {
+  const char* op;
+  bool expected[3];  // For lhs < rhs, lhs == rhs and lhs > rhs.
+};
+
+static const struct comparison kComparisons[] = {
+    {"==", {false, true, false}}, {"!=", {true, false, true}},
+    {"<", {true, false, false}},  {"<=", {true, true, false}},
+    {">", {false, false, true}},  {">=", {false, true, true}},
+};
+
+// Writes 1 if `a <op> b` holds, and 0 otherwise; `b` is either a variable or
+// the constant itself.
+static u7_error check_comparison(const char* type, const char* op,
+                                 bool constant, int lhs, int rhs,
+                                 bool expected) {
+  char text[256];
+  if (constant) {
+    snprintf(text, sizeof(text),
+             "%s a\n"
+             "a = %d\n"
+             "if a %s %d goto taken\n"
+             "write 0\n"
+             "ret\n"
+             "taken: write 1\n"
+             "ret\n",
+             type, lhs, op, rhs);
+  } else {
+    snprintf(text, sizeof(text),
+             "%s a, b\n"
+             "a = %d\n"
+             "b = %d\n"
+             "if a %s b goto taken\n"
+             "write 0\n"
+             "ret\n"
+             "taken: write 1\n"
+             "ret\n",
+             type, lhs, rhs, op);
+  }
+  struct u7_vm0_program program;
+  u7_error error = u7_vm0_assemble(&program, text, strlen(text));
+  if (error.error_code != 0) {
+    return error;
+  }
+  int64_t output = -1;
+  error = u7_vm0_test_run_single(&program, program.js, 0, &output);
+  u7_vm0_program_destroy(&program);
+  if (error.error_code == 0 && output != expected) {
+    error = u7_errnof(EINVAL,
+                      "%s: %d %s %d (%s): expected %d written, got %" PRId64,
+                      type, lhs, op, rhs, (constant ? "vc" : "vv"),
+                      (int)expected, output);
+  }
+  return error;
+}
+
+static u7_error check_comparisons(bool constant) {
+  // Pairs of the operands with lhs < rhs, lhs == rhs and lhs > rhs.
+  static const int kOperands[3][2] = {{-3, 2}, {7, 7}, {5, -1}};
+  for (size_t t = 0; t < sizeof(kTypes) / sizeof(kTypes[0]); ++t) {
+    for (size_t c = 0; c < sizeof(kComparisons) / sizeof(kComparisons[0]);
+         ++c) {
+      for (int k = 0; k < 3; ++k) {
+        u7_error error = check_comparison(
+            kTypes[t], kComparisons[c].op, constant, kOperands[k][0],
+            kOperands[k][1], kComparisons[c].expected[k]);
+        if (error.error_code != 0) {
+          return error;
+        }
+      }
+    }
+  }
+  return u7_ok();
+}
+
+static u7_error test_variable_constant() { return check_comparisons(true); }
+
+static u7_error test_variable_variable() { return check_comparisons(false); }
+
+// `a > b` of two variables is emitted as `b < a`.
+static u7_error test_swapped_operands() {
+  const struct u7_vm0_arg a = {.kind = U7_VM0_ARG_KIND_I64_VARIABLE,
+                               .value.i64 = 0};
+  const struct u7_vm0_arg b = {.kind = U7_VM0_ARG_KIND_I64_VARIABLE,
+                               .value.i64 = 8};
+  const struct u7_vm0_arg label = {.kind = U7_VM0_ARG_KIND_I64_LABEL,
+                                   .value.i64 = 0};
+  u7_error error = u7_ok();
+  const struct u7_vm0_instruction greater =
+      u7_vm0_jump_if_greater(&error, a, b, label);
+  const struct u7_vm0_instruction less =
+      u7_vm0_jump_if_less(&error, a, b, label);
+  if (error.error_code != 0) {
+    return error;
+  }
+  if (greater.base.execute_fn != less.base.execute_fn ||
+      greater.arg1.i64 != 8 || greater.arg2.i64 != 0) {
+    return u7_errnof(EINVAL, "swapped_operands: `a > b` is not `b < a`");
+  }
+  return u7_ok();
+}
+
+static u7_error test_mismatched_kinds() {
+  const struct u7_vm0_arg i32_variable = {
+      .kind = U7_VM0_ARG_KIND_I32_VARIABLE, .value.i64 = 0};
+  const struct u7_vm0_arg i64_variable = {
+      .kind = U7_VM0_ARG_KIND_I64_VARIABLE, .value.i64 = 8};
+  const struct u7_vm0_arg f64_constant = {
+      .kind = U7_VM0_ARG_KIND_F64_CONSTANT, .value.f64 = 1.0};
+  const struct u7_vm0_arg label = {.kind = U7_VM0_ARG_KIND_I64_LABEL,
+                                   .value.i64 = 0};
+  u7_error error = u7_ok();
+  u7_vm0_jump_if_less(&error, i32_variable, i64_variable, label);
+  error = u7_vm0_test_expect_error("mismatched_kinds: rhs", error, EINVAL);
+  if (error.error_code != 0) {
+    return error;
+  }
+  u7_vm0_jump_if_greater(&error, i64_variable, f64_constant, label);
+  error = u7_vm0_test_expect_error("mismatched_kinds: constant", error,
+                                   EINVAL);
+  if (error.error_code != 0) {
+    return error;
+  }
+  u7_vm0_jump_if_equal(&error, f64_constant, i64_variable, label);
+  error = u7_vm0_test_expect_error("mismatched_kinds: lhs", error, EINVAL);
+  if (error.error_code != 0) {
+    return error;
+  }
+  u7_vm0_jump_if_not_equal(&error, i64_variable, i64_variable, i64_variable);
+  return u7_vm0_test_expect_error("mismatched_kinds: label", error, EINVAL);
+}
+
+int main() {
+  u7_error (*const tests[])() = {
+      &test_variable_constant,
+      &test_variable_variable,
+      &test_swapped_operands,
+      &test_mismatched_kinds,
+  };
+  return u7_vm0_test_main(tests, sizeof(tests) / sizeof(tests[0]));
+}
@@ -0,0 +1,208 @@
+#include "@/public/fuse.h"
+
+#include "@/public/opcode.h"
+
+#include <errno.h>
+#include <github.com/apronchenkov/error/public/error.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+static bool u7_vm0_fuse_offsets(int64_t first, int64_t second,
+                                int64_t* result) {
+  if (first < 0 || first > INT32_MAX || second < 0 || second > INT32_MAX) {
+    return false;
+  }
+  *result = u7_vm0_operand_pair((int32_t)first, (int32_t)second);
+  return true;
+}
+
+static struct u7_vm0_instruction u7_vm0_fuse_make(
+    enum u7_vm0_opcode opcode, int64_t arg1, union u7_vm0_value arg2,
+    union u7_vm0_value arg3) {
+  struct u7_vm0_instruction result = {
+      .base = u7_vm0_opcode_info(opcode)->base,
+      .arg1 = {.i64 = arg1},
+      .arg2 = arg2,
+      .arg3 = arg3,
+  };
+  return result;
+}
+
+// t = n op c; jz/jnz t, L
+static bool u7_vm0_fuse_jump(struct u7_vm0_instruction const* a,
+                                   struct u7_vm0_instruction const* b,
+                                   enum u7_vm0_opcode fused_opcode,
+                                   struct u7_vm0_instruction* result) {
+  int64_t arg1;
+  if (b->arg1.i64 != a->arg1.i64 ||
+      !u7_vm0_fuse_offsets(a->arg1.i64, a->arg2.i64, &arg1)) {
+    return false;
+  }
+  *result = u7_vm0_fuse_make(fused_opcode, arg1, a->arg3, b->arg2);
+  return true;
+}
+
+static bool u7_vm0_fuse_pair(struct u7_vm0_instruction const* a,
+                             struct u7_vm0_instruction const* b,
+                             struct u7_vm0_instruction* result) {
+  const enum u7_vm0_opcode a_opcode = u7_vm0_instruction_opcode(a);
+  const enum u7_vm0_opcode b_opcode = u7_vm0_instruction_opcode(b);
+  switch (a_opcode) {
+    case U7_VM0_OPCODE_BITWISE_AND_I32VC:
+      if (b_opcode == U7_VM0_OPCODE_JUMP_IF_ZERO_I32_UNCHECKED) {
+        return u7_vm0_fuse_jump(
+            a, b, U7_VM0_OPCODE_BITWISE_AND_JUMP_IF_ZERO_I32VC, result);
+      } else if (b_opcode == U7_VM0_OPCODE_JUMP_IF_NOT_ZERO_I32_UNCHECKED) {
+        return u7_vm0_fuse_jump(
+            a, b, U7_VM0_OPCODE_BITWISE_AND_JUMP_IF_NOT_ZERO_I32VC, result);
+      }
+      return false;
+    case U7_VM0_OPCODE_BITWISE_AND_I64VC:
+      if (b_opcode == U7_VM0_OPCODE_JUMP_IF_ZERO_I64_UNCHECKED) {
+        return u7_vm0_fuse_jump(
+            a, b, U7_VM0_OPCODE_BITWISE_AND_JUMP_IF_ZERO_I64VC, result);
+      } else if (b_opcode == U7_VM0_OPCODE_JUMP_IF_NOT_ZERO_I64_UNCHECKED) {
+        return u7_vm0_fuse_jump(
+            a, b, U7_VM0_OPCODE_BITWISE_AND_JUMP_IF_NOT_ZERO_I64VC, result);
+      }
+      return false;
+    case U7_VM0_OPCODE_BITWISE_LEFT_SHIFT_I32VC:
+      return b_opcode == U7_VM0_OPCODE_JUMP_IF_NOT_ZERO_I32_UNCHECKED &&
+             u7_vm0_fuse_jump(
+                 a, b, U7_VM0_OPCODE_BITWISE_LEFT_SHIFT_JUMP_IF_NOT_ZERO_I32VC,
+                 result);
+    case U7_VM0_OPCODE_BITWISE_LEFT_SHIFT_I64VC:
+      return b_opcode == U7_VM0_OPCODE_JUMP_IF_NOT_ZERO_I64_UNCHECKED &&
+             u7_vm0_fuse_jump(
+                 a, b, U7_VM0_OPCODE_BITWISE_LEFT_SHIFT_JUMP_IF_NOT_ZERO_I64VC,
+                 result);
+    case U7_VM0_OPCODE_BITWISE_RIGHT_SHIFT_I32VC:
+      return b_opcode == U7_VM0_OPCODE_JUMP_IF_NOT_ZERO_I32_UNCHECKED &&
+             u7_vm0_fuse_jump(
+                 a, b, U7_VM0_OPCODE_BITWISE_RIGHT_SHIFT_JUMP_IF_NOT_ZERO_I32VC,
+                 result);
+    case U7_VM0_OPCODE_BITWISE_RIGHT_SHIFT_I64VC:
+      return b_opcode == U7_VM0_OPCODE_JUMP_IF_NOT_ZERO_I64_UNCHECKED &&
+             u7_vm0_fuse_jump(
+                 a, b, U7_VM0_OPCODE_BITWISE_RIGHT_SHIFT_JUMP_IF_NOT_ZERO_I64VC,
+                 result);
+    case U7_VM0_OPCODE_MATH_MULTIPLY_F64VV:
+      if (b_opcode == U7_VM0_OPCODE_MATH_ADD_F64VV &&
+          (b->arg2.i64 == a->arg1.i64 || b->arg3.i64 == a->arg1.i64)) {
+        // s = a * b; x = s + c
+        int64_t arg1, arg2;
+        if (!u7_vm0_fuse_offsets(a->arg1.i64, b->arg1.i64, &arg1) ||
+            !u7_vm0_fuse_offsets(a->arg2.i64, a->arg3.i64, &arg2)) {
+          return false;
+        }
+        const union u7_vm0_value c =
+            (b->arg2.i64 == a->arg1.i64 ? b->arg3 : b->arg2);
+        *result = u7_vm0_fuse_make(U7_VM0_OPCODE_MATH_MULTIPLY_ADD_F64VVV,
+                                   arg1, (union u7_vm0_value){.i64 = arg2}, c);
+        return true;
+      }
+      if (b_opcode == U7_VM0_OPCODE_MATH_MULTIPLY_F64VV) {
+        int64_t arg1, arg2, arg3;
+        if (!u7_vm0_fuse_offsets(a->arg1.i64, b->arg1.i64, &arg1) ||
+            !u7_vm0_fuse_offsets(a->arg2.i64, a->arg3.i64, &arg2) ||
+            !u7_vm0_fuse_offsets(b->arg2.i64, b->arg3.i64, &arg3)) {
+          return false;
+        }
+        *result = u7_vm0_fuse_make(U7_VM0_OPCODE_MATH_MULTIPLY_2_F64VV, arg1,
+                                   (union u7_vm0_value){.i64 = arg2},
+                                   (union u7_vm0_value){.i64 = arg3});
+        return true;
+      }
+      return false;
+    case U7_VM0_OPCODE_MATH_ADD_F64VV:
+      if (b_opcode == U7_VM0_OPCODE_MATH_ADD_F64VV) {
+        int64_t arg1, arg2, arg3;
+        if (!u7_vm0_fuse_offsets(a->arg1.i64, b->arg1.i64, &arg1) ||
+            !u7_vm0_fuse_offsets(a->arg2.i64, a->arg3.i64, &arg2) ||
+            !u7_vm0_fuse_offsets(b->arg2.i64, b->arg3.i64, &arg3)) {
+          return false;
+        }
+        *result = u7_vm0_fuse_make(U7_VM0_OPCODE_MATH_ADD_2_F64VV, arg1,
+                                   (union u7_vm0_value){.i64 = arg2},
+                                   (union u7_vm0_value){.i64 = arg3});
+        return true;
+      }
+      return false;
+    default:
+      return false;
+  }
+}
+
+u7_error u7_vm0_fuse(struct u7_vm0_instruction* instructions,
+                     size_t* instructions_size) {
+  const size_t n = *instructions_size;
+  bool* is_target = calloc(n, sizeof(bool));
+  size_t* new_index = malloc(n * sizeof(size_t));
+  if (is_target == NULL || new_index == NULL) {
+    free(is_target);
+    free(new_index);
+    return u7_errnof(ENOMEM, "u7_vm0_fuse: out of memory");
+  }
+  for (size_t i = 0; i < n; ++i) {
+    const enum u7_vm0_opcode opcode =
+        u7_vm0_instruction_opcode(&instructions[i]);
+    if (opcode == U7_VM0_OPCODE_UNKNOWN) {
+      free(is_target);
+      free(new_index);
+      return u7_errnof(EINVAL, "u7_vm0_fuse: instruction %zu: unknown", i);
+    }
+    struct u7_vm0_opcode_info const* info = u7_vm0_opcode_info(opcode);
+    const union u7_vm0_value args[3] = {
+        instructions[i].arg1,
+        instructions[i].arg2,
+        instructions[i].arg3,
+    };
+    for (int j = 0; j < 3; ++j) {
+      if (info->operand_kinds[j] == U7_VM0_OPERAND_LABEL) {
+        if (args[j].i64 < 0 || (uint64_t)args[j].i64 >= n) {
+          free(is_target);
+          free(new_index);
+          return u7_errnof(ERANGE,
+                           "u7_vm0_fuse: instruction %zu: label is out of "
+                           "range; the program is not verified",
+                           i);
+        }
+        is_target[args[j].i64] = true;
+      }
+    }
+  }
+  // Compact in place: the output position never overtakes the input one.
+  size_t m = 0;
+  for (size_t i = 0; i < n;) {
+    new_index[i] = m;
+    struct u7_vm0_instruction fused;
+    if (i + 1 < n && !is_target[i + 1] &&
+        u7_vm0_fuse_pair(&instructions[i], &instructions[i + 1], &fused)) {
+      new_index[i + 1] = m;
+      instructions[m++] = fused;
+      i += 2;
+    } else {
+      instructions[m++] = instructions[i];
+      i += 1;
+    }
+  }
+  for (size_t i = 0; i < m; ++i) {
+    struct u7_vm0_opcode_info const* info =
+        u7_vm0_opcode_info(u7_vm0_instruction_opcode(&instructions[i]));
+    union u7_vm0_value* args[3] = {
+        &instructions[i].arg1,
+        &instructions[i].arg2,
+        &instructions[i].arg3,
+    };
+    for (int j = 0; j < 3; ++j) {
+      if (info->operand_kinds[j] == U7_VM0_OPERAND_LABEL) {
+        args[j]->i64 = (int64_t)new_index[args[j]->i64];
+      }
+    }
+  }
+  free(is_target);
+  free(new_index);
+  *instructions_size = m;
+  return u7_ok();
+}
@@ -0,0 +1,692 @@
+#include "@/public/input.h"
+#include "@/public/output.h"
+
+#include "@/public/assembler.h"
+#include "@/public/program.h"
+#include "@/public/vm0.h"
+#include "@/testing.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <github.com/apronchenkov/error/public/error.h>
+#include <github.com/apronchenkov/vm/public/state.h>
+#include <inttypes.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+// Tests for the I/O backends and for the I/O instructions that use them.
+
+enum { TEST_MAX_VALUES = 16 };
+
+// Input and output of i64 values that would block after every `quota`
+// values: a call fails with EAGAIN once it has transferred `quota` values,
+// or at once, if the previous call has already done so.
+struct trickle_io {
+  struct u7_vm0_input input;
+  struct u7_vm0_output output;
+  int64_t values[TEST_MAX_VALUES];
+  size_t size;
+  size_t cursor;
+  size_t quota;
+  size_t left;  // Values before the next EAGAIN.
+  size_t blocks;
+};
+
+static u7_error trickle_io_step(struct trickle_io* self) {
+  if (self->left == 0) {
+    self->left = self->quota;
+    self->blocks += 1;
+    return u7_errnof(EAGAIN, "trickle_io: would block");
+  }
+  self->left -= 1;
+  return u7_ok();
+}
+
+static u7_error trickle_read_i64(struct u7_vm0_input* input, int64_t* result) {
+  struct trickle_io* self =
+      (struct trickle_io*)((char*)input - offsetof(struct trickle_io, input));
+  if (self->cursor == self->size) {
+    return u7_errnof(ENODATA, "trickle_read_i64: eof");
+  }
+  u7_error error = trickle_io_step(self);
+  if (error.error_code == 0) {
+    *result = self->values[self->cursor++];
+  }
+  return error;
+}
+
+static u7_error trickle_read_i64_n(struct u7_vm0_input* input,
+                                   int64_t* result, size_t count,
+                                   size_t* done) {
+  for (*done = 0; *done < count; ++*done) {
+    u7_error error = trickle_read_i64(input, &result[*done]);
+    if (error.error_code != 0) {
+      return error;
+    }
+  }
+  return u7_ok();
+}
+
+static u7_error trickle_write_i64(struct u7_vm0_output* output,
+                                  int64_t value) {
+  struct trickle_io* self =
+      (struct trickle_io*)((char*)output - offsetof(struct trickle_io, output));
+  if (self->cursor == TEST_MAX_VALUES) {
+    return u7_errnof(ENOSPC, "trickle_write_i64: no space left");
+  }
+  u7_error error = trickle_io_step(self);
+  if (error.error_code == 0) {
+    self->values[self->cursor++] = value;
+    self->size = self->cursor;
+  }
+  return error;
+}
+
+static u7_error trickle_write_i64_n(struct u7_vm0_output* output,
+                                    int64_t const* values, size_t count,
+                                    size_t* done) {
+  for (*done = 0; *done < count; ++*done) {
+    u7_error error = trickle_write_i64(output, values[*done]);
+    if (error.error_code != 0) {
+      return error;
+    }
+  }
+  return u7_ok();
+}
+
+// Only the i64 functions are set; `batch` selects whether the instructions
+// go through the batch functions or through the scalar fallback.
+static void trickle_io_init(struct trickle_io* self, int64_t const* values,
+                            size_t size, size_t quota, bool batch) {
+  memset(self, 0, sizeof(*self));
+  self->input.read_i64_fn = &trickle_read_i64;
+  self->output.write_i64_fn = &trickle_write_i64;
+  if (batch) {
+    self->input.read_i64_n_fn = &trickle_read_i64_n;
+    self->output.write_i64_n_fn = &trickle_write_i64_n;
+  }
+  if (size > 0) {
+    memcpy(self->values, values, size * sizeof(int64_t));
+  }
+  self->size = size;
+  self->quota = quota;
+  self->left = quota;
+}
+
+// Runs the program until `ret`, resuming it every time it blocks, and
+// returns the number of the resumptions in *resumed.
+static u7_error run_to_completion(struct u7_vm_state* state,
+                                  size_t* resumed) {
+  struct u7_vm0_globals* globals = u7_vm0_state_globals(state);
+  *resumed = 0;
+  u7_vm_state_run(state);
+  while (globals->blocked) {
+    globals->blocked = false;
+    *resumed += 1;
+    u7_vm_state_run(state);
+  }
+  return u7_vm0_state_take_error(state);
+}
+
+// Reads 5 values with a single instruction and writes them back with
+// another; one side blocks after every 2 values. The resumed batches must
+// neither lose nor repeat a value.
+static u7_error check_batch_resume(const char* name, bool blocking_input,
+                                   bool batch) {
+  static const char text[] =
+      "i64 v[5]\n"
+      "read v, 5\n"
+      "write v, 5\n"
+      "ret\n";
+  int64_t const values[] = {1, -2, 3, -4, 5};
+  const size_t size = sizeof(values) / sizeof(values[0]);
+  struct u7_vm0_program program;
+  u7_error error = u7_vm0_assemble(&program, text, strlen(text));
+  if (error.error_code != 0) {
+    return error;
+  }
+  int64_t output[TEST_MAX_VALUES];
+  struct u7_vm0_test_state test_state;
+  error = u7_vm0_test_state_init(&test_state, &program, program.js, values,
+                                 size, output, TEST_MAX_VALUES);
+  if (error.error_code != 0) {
+    u7_vm0_program_destroy(&program);
+    return error;
+  }
+  struct trickle_io trickle;
+  struct u7_vm0_globals* globals = u7_vm0_state_globals(&test_state.state);
+  if (blocking_input) {
+    trickle_io_init(&trickle, values, size, 2, batch);
+    globals->input = &trickle.input;
+  } else {
+    trickle_io_init(&trickle, NULL, 0, 2, batch);
+    globals->output = &trickle.output;
+  }
+  size_t resumed = 0;
+  error = run_to_completion(&test_state.state, &resumed);
+  if (error.error_code == 0) {
+    int64_t const* written = (blocking_input ? output : trickle.values);
+    const size_t written_size =
+        (blocking_input ? u7_vm0_test_state_output_size(&test_state)
+                        : trickle.size);
+    if (written_size != size ||
+        memcmp(written, values, size * sizeof(int64_t)) != 0) {
+      error = u7_errnof(EINVAL, "%s: %zu values written, expected %zu", name,
+                        written_size, size);
+    } else if (resumed != 2 || globals->io_done != 0) {
+      error = u7_errnof(EINVAL, "%s: resumed %zu times, io_done=%zu", name,
+                        resumed, globals->io_done);
+    }
+  }
+  u7_vm0_test_state_destroy(&test_state);
+  u7_vm0_program_destroy(&program);
+  return error;
+}
+
+static u7_error test_batch_read_resume() {
+  return check_batch_resume("batch_read_resume", true, true);
+}
+
+static u7_error test_batch_write_resume() {
+  return check_batch_resume("batch_write_resume", false, true);
+}
+
+static u7_error test_fallback_read_resume() {
+  return check_batch_resume("fallback_read_resume", true, false);
+}
+
+static u7_error test_fallback_write_resume() {
+  return check_batch_resume("fallback_write_resume", false, false);
+}
+
+// Buffered text input and output.
+
+// Creates a pipe with `text` in it. The write end is closed if `close_writer`,
+// and is left open, in *writer, otherwise; the read end is non-blocking then.
+static u7_error open_pipe(const char* text, bool close_writer, int* reader,
+                          int* writer) {
+  int fds[2];
+  if (pipe(fds) != 0) {
+    return u7_errnof(errno, "open_pipe: pipe failed");
+  }
+  const size_t size = strlen(text);
+  if (write(fds[1], text, size) != (ssize_t)size) {
+    close(fds[0]);
+    close(fds[1]);
+    return u7_errnof(EIO, "open_pipe: write failed");
+  }
+  if (close_writer) {
+    close(fds[1]);
+    fds[1] = -1;
+  } else {
+    fcntl(fds[0], F_SETFL, fcntl(fds[0], F_GETFL) | O_NONBLOCK);
+  }
+  *reader = fds[0];
+  *writer = fds[1];
+  return u7_ok();
+}
+
+// Reads an i64 with the input, and checks the result against `expected` if
+// `error_code` is 0, or checks that the read fails with `error_code`.
+static u7_error expect_read_i64(const char* name, struct u7_vm0_input* input,
+                                int error_code, int64_t expected) {
+  int64_t value = 0;
+  u7_error error = input->read_i64_fn(input, &value);
+  if (error_code != 0) {
+    return u7_vm0_test_expect_error(name, error, error_code);
+  }
+  if (error.error_code == 0 && value != expected) {
+    error = u7_errnof(EINVAL, "%s: expected %" PRId64 ", got %" PRId64, name,
+                      expected, value);
+  }
+  return error;
+}
+
+static u7_error test_buffered_input_values() {
+  int reader, writer;
+  u7_error error = open_pipe(
+      "12 -7\n\t+3 1.5 -0.25 1e-7 0.1 x 99999999999999999999 2147483648",
+      true, &reader, &writer);
+  if (error.error_code != 0) {
+    return error;
+  }
+  struct u7_vm0_buffered_input input;
+  error = u7_vm0_buffered_input_init(&input, reader, 0);
+  if (error.error_code != 0) {
+    close(reader);
+    return error;
+  }
+  int64_t const integers[] = {12, -7, 3};
+  for (size_t i = 0; i < 3 && error.error_code == 0; ++i) {
+    error = expect_read_i64("buffered_input_values", &input.base, 0,
+                            integers[i]);
+  }
+  const double reals[] = {1.5, -0.25, 1e-7};
+  for (size_t i = 0; i < 3 && error.error_code == 0; ++i) {
+    double value;
+    error = input.base.read_f64_fn(&input.base, &value);
+    if (error.error_code == 0 && value != reals[i]) {
+      error = u7_errnof(EINVAL, "buffered_input_values: expected %g, got %g",
+                        reals[i], value);
+    }
+  }
+  float single = 0;
+  if (error.error_code == 0) {
+    error = input.base.read_f32_fn(&input.base, &single);
+  }
+  if (error.error_code == 0 && single != 0.1f) {
+    error = u7_errnof(EINVAL, "buffered_input_values: expected 0.1f, got %g",
+                      (double)single);
+  }
+  if (error.error_code == 0) {
+    error = expect_read_i64("buffered_input_values: not a number",
+                            &input.base, EINVAL, 0);
+  }
+  if (error.error_code == 0) {
+    error = expect_read_i64("buffered_input_values: i64 out of range",
+                            &input.base, ERANGE, 0);
+  }
+  if (error.error_code == 0) {
+    int32_t value;
+    error = u7_vm0_test_expect_error(
+        "buffered_input_values: i32 out of range",
+        input.base.read_i32_fn(&input.base, &value), ERANGE);
+  }
+  if (error.error_code == 0) {
+    error = expect_read_i64("buffered_input_values: eof", &input.base,
+                            ENODATA, 0);
+  }
+  u7_vm0_buffered_input_destroy(&input);
+  close(reader);
+  return error;
+}
+
+// The tokens straddle the refills of a 64-byte buffer; a token that does not
+// fit into the buffer is rejected.
+static u7_error test_buffered_input_long_tokens() {
+  char text[512] = "";
+  for (int i = 0; i < 20; ++i) {
+    strcat(text, "1234567890123 ");
+  }
+  for (int i = 0; i < 80; ++i) {
+    strcat(text, "7");
+  }
+  int reader, writer;
+  u7_error error = open_pipe(text, true, &reader, &writer);
+  if (error.error_code != 0) {
+    return error;
+  }
+  struct u7_vm0_buffered_input input;
+  error = u7_vm0_buffered_input_init(&input, reader, 64);
+  if (error.error_code != 0) {
+    close(reader);
+    return error;
+  }
+  for (int i = 0; i < 20 && error.error_code == 0; ++i) {
+    error = expect_read_i64("buffered_input_long_tokens", &input.base, 0,
+                            INT64_C(1234567890123));
+  }
+  if (error.error_code == 0) {
+    error = expect_read_i64("buffered_input_long_tokens: too long",
+                            &input.base, EINVAL, 0);
+  }
+  u7_vm0_buffered_input_destroy(&input);
+  close(reader);
+  return error;
+}
+
+// A read from an empty non-blocking pipe fails with EAGAIN, also in the
+// middle of a token, and a retry after more data arrives reads the token
+// whole.
+static u7_error test_buffered_input_resume() {
+  int reader, writer;
+  u7_error error = open_pipe("12 3", false, &reader, &writer);
+  if (error.error_code != 0) {
+    return error;
+  }
+  struct u7_vm0_buffered_input input;
+  error = u7_vm0_buffered_input_init(&input, reader, 0);
+  if (error.error_code != 0) {
+    close(reader);
+    close(writer);
+    return error;
+  }
+  error = expect_read_i64("buffered_input_resume", &input.base, 0, 12);
+  if (error.error_code == 0) {
+    error = expect_read_i64("buffered_input_resume: blocked", &input.base,
+                            EAGAIN, 0);
+  }
+  if (error.error_code == 0 && write(writer, "4 5", 3) != 3) {
+    error = u7_errnof(EIO, "buffered_input_resume: write failed");
+  }
+  if (error.error_code == 0) {
+    error = expect_read_i64("buffered_input_resume", &input.base, 0, 34);
+  }
+  close(writer);
+  if (error.error_code == 0) {
+    error = expect_read_i64("buffered_input_resume", &input.base, 0, 5);
+  }
+  if (error.error_code == 0) {
+    error = expect_read_i64("buffered_input_resume: eof", &input.base,
+                            ENODATA, 0);
+  }
+  u7_vm0_buffered_input_destroy(&input);
+  close(reader);
+  return error;
+}
+
+// Reads everything from the pipe into `text`, which has room for `capacity`
+// bytes and the NUL.
+static u7_error read_pipe(int fd, char* text, size_t capacity,
+                          size_t* size) {
+  *size = 0;
+  for (;;) {
+    const ssize_t n = read(fd, text + *size, capacity - *size);
+    if (n > 0) {
+      *size += (size_t)n;
+    } else if (n == 0 || errno == EAGAIN) {
+      break;
+    } else {
+      return u7_errnof(errno, "read_pipe: read failed");
+    }
+  }
+  text[*size] = '\0';
+  return u7_ok();
+}
+
+static u7_error test_buffered_output_values() {
+  int fds[2];
+  if (pipe(fds) != 0) {
+    return u7_errnof(errno, "buffered_output_values: pipe failed");
+  }
+  struct u7_vm0_buffered_output output;
+  u7_error error = u7_vm0_buffered_output_init(&output, fds[1], 0);
+  if (error.error_code != 0) {
+    close(fds[0]);
+    close(fds[1]);
+    return error;
+  }
+  // More than the minimum capacity, so that the buffer is flushed on the way.
+  int64_t values[200];
+  for (size_t i = 0; i < 200; ++i) {
+    values[i] = (int64_t)(i * i) - 1000;
+  }
+  size_t done = 0;
+  error = u7_vm0_output_write_i64_n(&output.base, values, 200, &done);
+  if (error.error_code == 0) {
+    error = output.base.write_i32_fn(&output.base, INT32_MIN);
+  }
+  if (error.error_code == 0) {
+    error = output.base.write_i64_fn(&output.base, INT64_MIN);
+  }
+  if (error.error_code == 0) {
+    error = output.base.write_f64_fn(&output.base, 0.1);
+  }
+  if (error.error_code == 0) {
+    error = output.base.write_f32_fn(&output.base, 0.1f);
+  }
+  if (error.error_code == 0) {
+    error = u7_vm0_buffered_output_flush(&output);
+  }
+  u7_vm0_buffered_output_destroy(&output);
+  close(fds[1]);
+  static char text[8192];
+  size_t size = 0;
+  if (error.error_code == 0) {
+    error = read_pipe(fds[0], text, sizeof(text) - 1, &size);
+  }
+  close(fds[0]);
+  if (error.error_code != 0) {
+    return error;
+  }
+  char* p = text;
+  for (size_t i = 0; i < 200; ++i) {
+    char* end;
+    const long long value = strtoll(p, &end, 10);
+    if (end == p || *end != ' ' || value != values[i]) {
+      return u7_errnof(EINVAL,
+                       "buffered_output_values: value %zu: expected %" PRId64
+                       ", got '%.20s'",
+                       i, values[i], p);
+    }
+    p = end + 1;
+  }
+  static const char tail[] = "-2147483648 -9223372036854775808 0.1 0.1 ";
+  if (strcmp(p, tail) != 0) {
+    return u7_errnof(EINVAL, "buffered_output_values: expected '%s', got '%s'",
+                     tail, p);
+  }
+  return u7_ok();
+}
+
+// A flush into a full non-blocking pipe fails with EAGAIN and keeps the
+// bytes that were not written; no byte is lost or repeated once the pipe is
+// drained and the flush is retried.
+static u7_error test_buffered_output_resume() {
+  int fds[2];
+  if (pipe(fds) != 0) {
+    return u7_errnof(errno, "buffered_output_resume: pipe failed");
+  }
+  fcntl(fds[0], F_SETFL, fcntl(fds[0], F_GETFL) | O_NONBLOCK);
+  fcntl(fds[1], F_SETFL, fcntl(fds[1], F_GETFL) | O_NONBLOCK);
+  struct u7_vm0_buffered_output output;
+  u7_error error = u7_vm0_buffered_output_init(&output, fds[1], 1 << 16);
+  if (error.error_code != 0) {
+    close(fds[0]);
+    close(fds[1]);
+    return error;
+  }
+  // "1000000 " x 16384 is twice as much as the default capacity of a pipe.
+  enum { kCount = 16384 };
+  static char text[kCount * 8 + 1];
+  size_t size = 0;
+  size_t blocks = 0;
+  for (size_t i = 0; i < kCount && error.error_code == 0;) {
+    error = output.base.write_i64_fn(&output.base, 1000000 + (int64_t)i % 10);
+    if (error.error_code == 0) {
+      ++i;
+      continue;
+    }
+    if (error.error_code == EAGAIN) {
+      u7_error_release(error);
+      ++blocks;
+      size_t n;
+      error = read_pipe(fds[0], text + size, sizeof(text) - 1 - size, &n);
+      size += n;
+    }
+  }
+  while (error.error_code == 0) {
+    error = u7_vm0_buffered_output_flush(&output);
+    if (error.error_code != EAGAIN) {
+      break;
+    }
+    u7_error_release(error);
+    ++blocks;
+    size_t n;
+    error = read_pipe(fds[0], text + size, sizeof(text) - 1 - size, &n);
+    size += n;
+  }
+  size_t n = 0;
+  if (error.error_code == 0) {
+    error = read_pipe(fds[0], text + size, sizeof(text) - 1 - size, &n);
+  }
+  size += n;
+  u7_vm0_buffered_output_destroy(&output);
+  close(fds[0]);
+  close(fds[1]);
+  if (error.error_code != 0) {
+    return error;
+  }
+  if (blocks == 0 || size != kCount * 8) {
+    return u7_errnof(EINVAL,
+                     "buffered_output_resume: %zu bytes after %zu blocks, "
+                     "expected %d",
+                     size, blocks, kCount * 8);
+  }
+  for (size_t i = 0; i < kCount; ++i) {
+    if (text[i * 8 + 6] != (char)('0' + i % 10)) {
+      return u7_errnof(EINVAL, "buffered_output_resume: value %zu: '%.8s'",
+                       i, &text[i * 8]);
+    }
+  }
+  return u7_ok();
+}
+
+// Memory and file-mapped input and output.
+
+static u7_error test_memory_input() {
+  unsigned char data[16];
+  const int32_t i32 = -5;
+  const double f64 = 0.375;
+  const int64_t i64 = INT64_MIN;
+  memcpy(data, &i32, 4);  // The test assumes a little-endian host.
+  memcpy(data + 4, &i64, 8);
+  memcpy(data + 12, &f64, 4);  // The first half only.
+  struct u7_vm0_memory_input input;
+  u7_vm0_memory_input_init(&input, data, 12);
+  int32_t i32_value;
+  int64_t i64_values[2] = {0, 0};
+  size_t done = 1;
+  u7_error error = input.base.read_i32_fn(&input.base, &i32_value);
+  if (error.error_code == 0) {
+    // Only one of the two values is there: nothing is read.
+    error = u7_vm0_test_expect_error(
+        "memory_input: batch eof",
+        u7_vm0_input_read_i64_n(&input.base, i64_values, 2, &done), ENODATA);
+  }
+  if (error.error_code == 0) {
+    error = u7_vm0_input_read_i64_n(&input.base, i64_values, 1, &done);
+  }
+  if (error.error_code == 0 &&
+      (i32_value != i32 || i64_values[0] != i64 || done != 1)) {
+    error = u7_errnof(EINVAL, "memory_input: read %d and %" PRId64,
+                      i32_value, i64_values[0]);
+  }
+  if (error.error_code == 0) {
+    error = expect_read_i64("memory_input: eof", &input.base, ENODATA, 0);
+  }
+  u7_vm0_memory_input_destroy(&input);
+  if (error.error_code != 0) {
+    return error;
+  }
+  // A partial value at the end is not read either.
+  u7_vm0_memory_input_init(&input, data + 12, 4);
+  double f64_value;
+  error = u7_vm0_test_expect_error(
+      "memory_input: partial value",
+      input.base.read_f64_fn(&input.base, &f64_value), ENODATA);
+  u7_vm0_memory_input_destroy(&input);
+  return error;
+}
+
+// Writing past the end of the span fails with ENOSPC, and writes nothing.
+static u7_error test_memory_output() {
+  int64_t data[3] = {0, 0, 0};
+  struct u7_vm0_memory_output output;
+  u7_vm0_memory_output_init(&output, data, 2 * sizeof(int64_t));
+  int64_t const values[] = {7, -8};
+  size_t done = 0;
+  u7_error error = output.base.write_i64_fn(&output.base, 6);
+  if (error.error_code == 0) {
+    error = u7_vm0_test_expect_error(
+        "memory_output: batch overflow",
+        u7_vm0_output_write_i64_n(&output.base, values, 2, &done), ENOSPC);
+  }
+  if (error.error_code == 0) {
+    error = u7_vm0_output_write_i64_n(&output.base, values, 1, &done);
+  }
+  if (error.error_code == 0) {
+    error = u7_vm0_test_expect_error(
+        "memory_output: overflow", output.base.write_f64_fn(&output.base, 1),
+        ENOSPC);
+  }
+  if (error.error_code == 0 &&
+      (u7_vm0_memory_output_size(&output) != 2 * sizeof(int64_t) ||
+       data[0] != 6 || data[1] != 7 || data[2] != 0)) {
+    error = u7_errnof(EINVAL,
+                      "memory_output: wrote %zu bytes: %" PRId64 " %" PRId64
+                      " %" PRId64,
+                      u7_vm0_memory_output_size(&output), data[0], data[1],
+                      data[2]);
+  }
+  u7_error_release(u7_vm0_memory_output_destroy(&output));
+  return error;
+}
+
+// A file written through a mapping is truncated to the written size, and
+// reads back through a mapping; so does an empty file.
+static u7_error test_memory_file() {
+  char path[] = "/tmp/u7_vm0_io_test_XXXXXX";
+  const int fd = mkstemp(path);
+  if (fd < 0) {
+    return u7_errnof(errno, "memory_file: mkstemp failed");
+  }
+  close(fd);
+  struct u7_vm0_memory_output output;
+  u7_error error = u7_vm0_memory_output_init_file(&output, path, 4096);
+  if (error.error_code != 0) {
+    unlink(path);
+    return error;
+  }
+  int64_t const values[] = {1, -2, INT64_MAX};
+  size_t done = 0;
+  error = u7_vm0_output_write_i64_n(&output.base, values, 3, &done);
+  u7_error destroy_error = u7_vm0_memory_output_destroy(&output);
+  if (error.error_code == 0) {
+    error = destroy_error;
+  } else {
+    u7_error_release(destroy_error);
+  }
+  for (int pass = 0; pass < 2 && error.error_code == 0; ++pass) {
+    struct u7_vm0_memory_input input;
+    error = u7_vm0_memory_input_init_file(&input, path);
+    if (error.error_code != 0) {
+      break;
+    }
+    const size_t size = (pass == 0 ? 3 : 0);
+    if ((size_t)(input.end - input.cursor) != size * sizeof(int64_t)) {
+      error = u7_errnof(EINVAL, "memory_file: %zu bytes mapped, expected %zu",
+                        (size_t)(input.end - input.cursor),
+                        size * sizeof(int64_t));
+    }
+    for (size_t i = 0; i < size && error.error_code == 0; ++i) {
+      error = expect_read_i64("memory_file", &input.base, 0, values[i]);
+    }
+    if (error.error_code == 0) {
+      error = expect_read_i64("memory_file: eof", &input.base, ENODATA, 0);
+    }
+    u7_vm0_memory_input_destroy(&input);
+    if (error.error_code == 0 && pass == 0 && truncate(path, 0) != 0) {
+      error = u7_errnof(errno, "memory_file: truncate failed");
+    }
+  }
+  unlink(path);
+  if (error.error_code == 0) {
+    struct u7_vm0_memory_input input;
+    error = u7_vm0_test_expect_error(
+        "memory_file: missing file",
+        u7_vm0_memory_input_init_file(&input, path), ENOENT);
+  }
+  return error;
+}
+
+int main() {
+  u7_error (*const tests[])() = {
+      &test_batch_read_resume,
+      &test_batch_write_resume,
+      &test_fallback_read_resume,
+      &test_fallback_write_resume,
+      &test_buffered_input_values,
+      &test_buffered_input_long_tokens,
+      &test_buffered_input_resume,
+      &test_buffered_output_values,
+      &test_buffered_output_resume,
+      &test_memory_input,
+      &test_memory_output,
+      &test_memory_file,
+  };
+  return u7_vm0_test_main(tests, sizeof(tests) / sizeof(tests[0]));
+}
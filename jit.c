@@ -0,0 +1,916 @@
+#include "@/public/jit.h"
+
+#include "@/public/opcode.h"
+
+#include <errno.h>
+#include <github.com/apronchenkov/error/public/error.h>
+#include <github.com/apronchenkov/vm/public/state.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__x86_64__)
+
+#include <sys/mman.h>
+
+// Registers, as encoded in ModRM.
+enum {
+  U7_VM0_JIT_RAX = 0,
+  U7_VM0_JIT_RCX = 1,
+  U7_VM0_JIT_XMM0 = 0,
+  U7_VM0_JIT_XMM1 = 1,
+};
+
+// A reference to a native address that is not known yet: a rel32 field at
+// `position`, relative to the end of the field.
+struct u7_vm0_jit_patch {
+  size_t position;
+  size_t target;  // Index of an instruction.
+};
+
+struct u7_vm0_jit_buffer {
+  uint8_t* data;
+  size_t size;
+  size_t capacity;
+  struct u7_vm0_jit_patch* patches;
+  size_t patches_size;
+  size_t patches_capacity;
+  bool failed;  // Out of memory.
+};
+
+static void u7_vm0_jit_emit(struct u7_vm0_jit_buffer* self, void const* bytes,
+                            size_t size) {
+  if (self->size + size > self->capacity) {
+    size_t new_capacity = (self->capacity == 0 ? 4096 : 2 * self->capacity);
+    while (new_capacity < self->size + size) {
+      new_capacity *= 2;
+    }
+    uint8_t* new_data = realloc(self->data, new_capacity);
+    if (new_data == NULL) {
+      self->failed = true;
+      return;
+    }
+    self->data = new_data;
+    self->capacity = new_capacity;
+  }
+  memcpy(self->data + self->size, bytes, size);
+  self->size += size;
+}
+
+#define U7_VM0_JIT_EMIT(buffer, ...)                         \
+  do {                                                       \
+    static const uint8_t u7_vm0_jit_bytes[] = {__VA_ARGS__}; \
+    u7_vm0_jit_emit((buffer), u7_vm0_jit_bytes,              \
+                    sizeof(u7_vm0_jit_bytes));               \
+  } while (0)
+
+static void u7_vm0_jit_emit_u8(struct u7_vm0_jit_buffer* self,
+                               uint8_t value) {
+  u7_vm0_jit_emit(self, &value, 1);
+}
+
+// The code is generated for x86-64, which is little-endian.
+static void u7_vm0_jit_emit_u32(struct u7_vm0_jit_buffer* self,
+                                uint32_t value) {
+  u7_vm0_jit_emit(self, &value, 4);
+}
+
+static void u7_vm0_jit_emit_u64(struct u7_vm0_jit_buffer* self,
+                                uint64_t value) {
+  u7_vm0_jit_emit(self, &value, 8);
+}
+
+static void u7_vm0_jit_emit_pointer(struct u7_vm0_jit_buffer* self,
+                                    void const* value) {
+  u7_vm0_jit_emit_u64(self, (uint64_t)(uintptr_t)value);
+}
+
+// Emits `[prefix] REX opcode ModRM SIB disp32` for the operand
+// [r12 + offset]; r12 holds the locals base. `prefix` is 0 if there is none.
+static void u7_vm0_jit_emit_local(struct u7_vm0_jit_buffer* self,
+                                  uint8_t prefix, bool wide,
+                                  uint16_t opcode, int reg, int64_t offset) {
+  if (prefix != 0) {
+    u7_vm0_jit_emit_u8(self, prefix);
+  }
+  u7_vm0_jit_emit_u8(self, (uint8_t)(0x41 | (wide ? 0x08 : 0)));
+  if (opcode > 0xFF) {
+    u7_vm0_jit_emit_u8(self, (uint8_t)(opcode >> 8));
+  }
+  u7_vm0_jit_emit_u8(self, (uint8_t)opcode);
+  u7_vm0_jit_emit_u8(self, (uint8_t)(0x84 | (reg << 3)));
+  u7_vm0_jit_emit_u8(self, 0x24);
+  u7_vm0_jit_emit_u32(self, (uint32_t)offset);
+}
+
+// Emits a rel32 field that refers to the native code of an instruction.
+static void u7_vm0_jit_emit_label(struct u7_vm0_jit_buffer* self,
+                                  size_t target) {
+  if (self->patches_size == self->patches_capacity) {
+    const size_t new_capacity =
+        (self->patches_capacity == 0 ? 64 : 2 * self->patches_capacity);
+    struct u7_vm0_jit_patch* new_patches =
+        realloc(self->patches, new_capacity * sizeof(*new_patches));
+    if (new_patches == NULL) {
+      self->failed = true;
+      return;
+    }
+    self->patches = new_patches;
+    self->patches_capacity = new_capacity;
+  }
+  self->patches[self->patches_size++] = (struct u7_vm0_jit_patch){
+      .position = self->size,
+      .target = target,
+  };
+  u7_vm0_jit_emit_u32(self, 0);
+}
+
+// Emits a rel32 field that refers to a position in the buffer.
+static void u7_vm0_jit_emit_rel32(struct u7_vm0_jit_buffer* self,
+                                  size_t target) {
+  u7_vm0_jit_emit_u32(self, (uint32_t)(target - (self->size + 4)));
+}
+
+static void u7_vm0_jit_fix_rel32(struct u7_vm0_jit_buffer* self,
+                                 size_t position) {
+  if (!self->failed) {
+    const uint32_t rel32 = (uint32_t)(self->size - (position + 4));
+    memcpy(self->data + position, &rel32, 4);
+  }
+}
+
+// Shared sequences at the beginning of the code.
+struct u7_vm0_jit_stubs {
+  size_t resume;    // Reloads the locals base and jumps to state->ip.
+  size_t dispatch;  // Jumps to state->ip.
+  size_t epilogue;  // Returns from the generated function.
+  size_t instructions_size;
+};
+
+static void* u7_vm0_jit_locals(struct u7_vm_state* state) {
+  return u7_vm_state_locals(state);
+}
+
+// mov qword [rbx + ip], value
+static void u7_vm0_jit_emit_set_ip(struct u7_vm0_jit_buffer* self,
+                                   size_t value) {
+  U7_VM0_JIT_EMIT(self, 0x48, 0xC7, 0x83);
+  u7_vm0_jit_emit_u32(self, (uint32_t)offsetof(struct u7_vm_state, ip));
+  u7_vm0_jit_emit_u32(self, (uint32_t)value);
+}
+
+// Emits `mov rdi, rbx; call u7_vm0_jit_locals; mov r12, rax`.
+static void u7_vm0_jit_emit_reload_locals(struct u7_vm0_jit_buffer* self) {
+  U7_VM0_JIT_EMIT(self, 0x48, 0x89, 0xDF, 0x48, 0xB8);  // mov rdi, rbx
+  u7_vm0_jit_emit_pointer(self, (void const*)(uintptr_t)&u7_vm0_jit_locals);
+  U7_VM0_JIT_EMIT(self, 0xFF, 0xD0,   // call rax
+                  0x49, 0x89, 0xC4);  // mov r12, rax
+}
+
+static struct u7_vm0_jit_stubs u7_vm0_jit_emit_stubs(
+    struct u7_vm0_jit_buffer* self, void const** entries,
+    size_t instructions_size) {
+  struct u7_vm0_jit_stubs result;
+  result.instructions_size = instructions_size;
+  // Prologue: void fn(struct u7_vm_state* state); the state lives in rbx.
+  U7_VM0_JIT_EMIT(self, 0x53,                   // push rbx
+                  0x41, 0x54,                   // push r12
+                  0x48, 0x83, 0xEC, 0x08,       // sub rsp, 8
+                  0x48, 0x89, 0xFB);            // mov rbx, rdi
+  result.resume = self->size;
+  u7_vm0_jit_emit_reload_locals(self);
+  result.dispatch = self->size;
+  U7_VM0_JIT_EMIT(self, 0x48, 0x8B, 0x83);  // mov rax, [rbx + ip]
+  u7_vm0_jit_emit_u32(self, (uint32_t)offsetof(struct u7_vm_state, ip));
+  U7_VM0_JIT_EMIT(self, 0x48, 0xB9);        // mov rcx, entries
+  u7_vm0_jit_emit_pointer(self, entries);
+  U7_VM0_JIT_EMIT(self, 0xFF, 0x24, 0xC1);  // jmp [rcx + rax * 8]
+  result.epilogue = self->size;
+  U7_VM0_JIT_EMIT(self, 0x48, 0x83, 0xC4, 0x08,  // add rsp, 8
+                  0x41, 0x5C,                    // pop r12
+                  0x5B,                          // pop rbx
+                  0xC3);                         // ret
+  return result;
+}
+
+// Executes the instruction through its execute_fn, then either returns or
+// resumes at state->ip; the next instruction is reached by a direct jump.
+static void u7_vm0_jit_emit_fallback(
+    struct u7_vm0_jit_buffer* self, struct u7_vm0_jit_stubs const* stubs,
+    struct u7_vm0_instruction const* instruction, size_t index) {
+  u7_vm0_jit_emit_set_ip(self, index + 1);
+  U7_VM0_JIT_EMIT(self, 0x48, 0x89, 0xDF, 0x48, 0xBE);  // mov rdi, rbx
+  u7_vm0_jit_emit_pointer(self, instruction);            // mov rsi, ...
+  U7_VM0_JIT_EMIT(self, 0x48, 0xB8);                     // mov rax, ...
+  u7_vm0_jit_emit_pointer(
+      self, (void const*)(uintptr_t)instruction->base.execute_fn);
+  U7_VM0_JIT_EMIT(self, 0xFF, 0xD0,         // call rax
+                  0x84, 0xC0,               // test al, al
+                  0x0F, 0x84);              // jz epilogue
+  u7_vm0_jit_emit_rel32(self, stubs->epilogue);
+  u7_vm0_jit_emit_reload_locals(self);
+  if (index + 1 < stubs->instructions_size) {
+    U7_VM0_JIT_EMIT(self, 0x48, 0x81, 0xBB);  // cmp qword [rbx + ip], imm32
+    u7_vm0_jit_emit_u32(self, (uint32_t)offsetof(struct u7_vm_state, ip));
+    u7_vm0_jit_emit_u32(self, (uint32_t)(index + 1));
+    U7_VM0_JIT_EMIT(self, 0x0F, 0x84);  // je next
+    u7_vm0_jit_emit_label(self, index + 1);
+  }
+  u7_vm0_jit_emit_u8(self, 0xE9);  // jmp dispatch
+  u7_vm0_jit_emit_rel32(self, stubs->dispatch);
+}
+
+enum u7_vm0_jit_type {
+  U7_VM0_JIT_I32,
+  U7_VM0_JIT_I64,
+  U7_VM0_JIT_F32,
+  U7_VM0_JIT_F64,
+};
+
+// Loads a local into eax/rax for the integer types, or xmm0.
+static void u7_vm0_jit_emit_load(struct u7_vm0_jit_buffer* self,
+                                 enum u7_vm0_jit_type type, int64_t offset) {
+  switch (type) {
+    case U7_VM0_JIT_I32:
+    case U7_VM0_JIT_I64:
+      u7_vm0_jit_emit_local(self, 0, type == U7_VM0_JIT_I64, 0x8B,
+                            U7_VM0_JIT_RAX, offset);
+      break;
+    case U7_VM0_JIT_F32:
+    case U7_VM0_JIT_F64:
+      u7_vm0_jit_emit_local(self, type == U7_VM0_JIT_F32 ? 0xF3 : 0xF2, false,
+                            0x0F10, U7_VM0_JIT_XMM0, offset);
+      break;
+  }
+}
+
+static void u7_vm0_jit_emit_store(struct u7_vm0_jit_buffer* self,
+                                  enum u7_vm0_jit_type type, int64_t offset) {
+  switch (type) {
+    case U7_VM0_JIT_I32:
+    case U7_VM0_JIT_I64:
+      u7_vm0_jit_emit_local(self, 0, type == U7_VM0_JIT_I64, 0x89,
+                            U7_VM0_JIT_RAX, offset);
+      break;
+    case U7_VM0_JIT_F32:
+    case U7_VM0_JIT_F64:
+      u7_vm0_jit_emit_local(self, type == U7_VM0_JIT_F32 ? 0xF3 : 0xF2, false,
+                            0x0F11, U7_VM0_JIT_XMM0, offset);
+      break;
+  }
+}
+
+// Loads a constant into rcx (integers) or xmm1 (floats).
+static void u7_vm0_jit_emit_constant(struct u7_vm0_jit_buffer* self,
+                                     enum u7_vm0_jit_type type,
+                                     union u7_vm0_value value) {
+  switch (type) {
+    case U7_VM0_JIT_I32:
+      u7_vm0_jit_emit_u8(self, 0xB9);  // mov ecx, imm32
+      u7_vm0_jit_emit_u32(self, (uint32_t)value.i32);
+      break;
+    case U7_VM0_JIT_I64:
+      U7_VM0_JIT_EMIT(self, 0x48, 0xB9);  // mov rcx, imm64
+      u7_vm0_jit_emit_u64(self, (uint64_t)value.i64);
+      break;
+    case U7_VM0_JIT_F32: {
+      uint32_t bits;
+      memcpy(&bits, &value.f32, sizeof(bits));
+      u7_vm0_jit_emit_u8(self, 0xB9);  // mov ecx, imm32
+      u7_vm0_jit_emit_u32(self, bits);
+      U7_VM0_JIT_EMIT(self, 0x66, 0x0F, 0x6E, 0xC9);  // movd xmm1, ecx
+      break;
+    }
+    case U7_VM0_JIT_F64: {
+      uint64_t bits;
+      memcpy(&bits, &value.f64, sizeof(bits));
+      U7_VM0_JIT_EMIT(self, 0x48, 0xB9);  // mov rcx, imm64
+      u7_vm0_jit_emit_u64(self, bits);
+      U7_VM0_JIT_EMIT(self, 0x66, 0x48, 0x0F, 0x6E, 0xC9);  // movq xmm1, rcx
+      break;
+    }
+  }
+}
+
+enum u7_vm0_jit_operation {
+  U7_VM0_JIT_AND,
+  U7_VM0_JIT_ADD,
+  U7_VM0_JIT_MULTIPLY,
+};
+
+// dst = lhs op rhs, where rhs is a local (`rhs_is_local`) or a constant.
+// Integer add and multiply jump to the fallback on overflow.
+static void u7_vm0_jit_emit_binary(
+    struct u7_vm0_jit_buffer* self, struct u7_vm0_jit_stubs const* stubs,
+    struct u7_vm0_instruction const* instruction, size_t index,
+    enum u7_vm0_jit_type type, enum u7_vm0_jit_operation operation,
+    bool rhs_is_local) {
+  const bool is_float = (type == U7_VM0_JIT_F32 || type == U7_VM0_JIT_F64);
+  const bool wide = (type == U7_VM0_JIT_I64);
+  u7_vm0_jit_emit_load(self, type, instruction->arg2.i64);
+  if (!rhs_is_local) {
+    u7_vm0_jit_emit_constant(self, type, instruction->arg3);
+  }
+  if (is_float) {
+    const uint8_t prefix = (type == U7_VM0_JIT_F32 ? 0xF3 : 0xF2);
+    const uint8_t opcode = (operation == U7_VM0_JIT_ADD ? 0x58 : 0x59);
+    if (rhs_is_local) {
+      u7_vm0_jit_emit_local(self, prefix, false, (uint16_t)(0x0F00 | opcode),
+                            U7_VM0_JIT_XMM0, instruction->arg3.i64);
+    } else {
+      // addss/mulss (addsd/mulsd) xmm0, xmm1
+      const uint8_t bytes[] = {prefix, 0x0F, opcode, 0xC1};
+      u7_vm0_jit_emit(self, bytes, sizeof(bytes));
+    }
+  } else {
+    static const uint16_t local_opcodes[] = {0x23, 0x03, 0x0FAF};
+    if (rhs_is_local) {
+      u7_vm0_jit_emit_local(self, 0, wide, local_opcodes[operation],
+                            U7_VM0_JIT_RAX, instruction->arg3.i64);
+    } else {
+      if (wide) {
+        u7_vm0_jit_emit_u8(self, 0x48);
+      }
+      switch (operation) {
+        case U7_VM0_JIT_AND:
+          U7_VM0_JIT_EMIT(self, 0x21, 0xC8);  // and eax, ecx
+          break;
+        case U7_VM0_JIT_ADD:
+          U7_VM0_JIT_EMIT(self, 0x01, 0xC8);  // add eax, ecx
+          break;
+        case U7_VM0_JIT_MULTIPLY:
+          U7_VM0_JIT_EMIT(self, 0x0F, 0xAF, 0xC1);  // imul eax, ecx
+          break;
+      }
+    }
+  }
+  if (!is_float && operation != U7_VM0_JIT_AND) {
+    U7_VM0_JIT_EMIT(self, 0x0F, 0x81);  // jno store
+    const size_t position = self->size;
+    u7_vm0_jit_emit_u32(self, 0);
+    u7_vm0_jit_emit_fallback(self, stubs, instruction, index);
+    u7_vm0_jit_fix_rel32(self, position);
+  }
+  u7_vm0_jit_emit_store(self, type, instruction->arg1.i64);
+}
+
+// Jumps to `label` if the local is (not) zero.
+static void u7_vm0_jit_emit_jump_if(struct u7_vm0_jit_buffer* self,
+                                    enum u7_vm0_jit_type type, int64_t offset,
+                                    bool if_zero, size_t label) {
+  switch (type) {
+    case U7_VM0_JIT_I32:
+    case U7_VM0_JIT_I64:
+      // cmp [local], 0
+      u7_vm0_jit_emit_local(self, 0, type == U7_VM0_JIT_I64, 0x83, 7, offset);
+      u7_vm0_jit_emit_u8(self, 0);
+      u7_vm0_jit_emit_u8(self, 0x0F);
+      u7_vm0_jit_emit_u8(self, if_zero ? 0x84 : 0x85);  // je/jne label
+      u7_vm0_jit_emit_label(self, label);
+      break;
+    case U7_VM0_JIT_F32:
+    case U7_VM0_JIT_F64:
+      U7_VM0_JIT_EMIT(self, 0x0F, 0x57, 0xC9);  // xorps xmm1, xmm1
+      // ucomiss/ucomisd xmm1, [local]; NaN sets PF, and compares unequal.
+      u7_vm0_jit_emit_local(self, type == U7_VM0_JIT_F64 ? 0x66 : 0, false,
+                            0x0F2E, U7_VM0_JIT_XMM1, offset);
+      if (if_zero) {
+        U7_VM0_JIT_EMIT(self, 0x7A, 0x06, 0x0F, 0x84);  // jp +6; je label
+        u7_vm0_jit_emit_label(self, label);
+      } else {
+        U7_VM0_JIT_EMIT(self, 0x0F, 0x8A);  // jp label
+        u7_vm0_jit_emit_label(self, label);
+        U7_VM0_JIT_EMIT(self, 0x0F, 0x85);  // jne label
+        u7_vm0_jit_emit_label(self, label);
+      }
+      break;
+  }
+}
+
+enum u7_vm0_jit_condition {
+  U7_VM0_JIT_EQUAL,
+  U7_VM0_JIT_NOT_EQUAL,
+  U7_VM0_JIT_LESS,
+  U7_VM0_JIT_LESS_OR_EQUAL,
+  U7_VM0_JIT_GREATER,
+  U7_VM0_JIT_GREATER_OR_EQUAL,
+};
+
+// Jumps to the label (arg3) if `arg1 condition arg2`, where arg2 is a local
+// (`rhs_is_local`) or a constant.
+static void u7_vm0_jit_emit_jump_if_compare(
+    struct u7_vm0_jit_buffer* self,
+    struct u7_vm0_instruction const* instruction, enum u7_vm0_jit_type type,
+    enum u7_vm0_jit_condition condition, bool rhs_is_local) {
+  const size_t label = (size_t)instruction->arg3.i64;
+  if (type == U7_VM0_JIT_I32 || type == U7_VM0_JIT_I64) {
+    // je, jne, jl, jle, jg, jge
+    static const uint8_t jcc[] = {0x84, 0x85, 0x8C, 0x8E, 0x8F, 0x8D};
+    const bool wide = (type == U7_VM0_JIT_I64);
+    u7_vm0_jit_emit_load(self, type, instruction->arg1.i64);
+    if (rhs_is_local) {
+      // cmp eax, [local]
+      u7_vm0_jit_emit_local(self, 0, wide, 0x3B, U7_VM0_JIT_RAX,
+                            instruction->arg2.i64);
+    } else {
+      u7_vm0_jit_emit_constant(self, type, instruction->arg2);
+      if (wide) {
+        u7_vm0_jit_emit_u8(self, 0x48);
+      }
+      U7_VM0_JIT_EMIT(self, 0x39, 0xC8);  // cmp eax, ecx
+    }
+    u7_vm0_jit_emit_u8(self, 0x0F);
+    u7_vm0_jit_emit_u8(self, jcc[condition]);
+    u7_vm0_jit_emit_label(self, label);
+    return;
+  }
+  // ucomiss/ucomisd sets CF for "below", and ZF, PF and CF for NaN; so
+  // "less" is tested as "above" with the operands swapped, and NaN does not
+  // jump.
+  const bool swap = (condition == U7_VM0_JIT_LESS ||
+                     condition == U7_VM0_JIT_LESS_OR_EQUAL);
+  const uint8_t prefix = (type == U7_VM0_JIT_F64 ? 0x66 : 0);
+  if (rhs_is_local) {
+    u7_vm0_jit_emit_load(
+        self, type, (swap ? instruction->arg2 : instruction->arg1).i64);
+    // ucomiss/ucomisd xmm0, [local]
+    u7_vm0_jit_emit_local(self, prefix, false, 0x0F2E, U7_VM0_JIT_XMM0,
+                          (swap ? instruction->arg1 : instruction->arg2).i64);
+  } else {
+    u7_vm0_jit_emit_load(self, type, instruction->arg1.i64);
+    u7_vm0_jit_emit_constant(self, type, instruction->arg2);
+    if (prefix != 0) {
+      u7_vm0_jit_emit_u8(self, prefix);
+    }
+    U7_VM0_JIT_EMIT(self, 0x0F, 0x2E);  // ucomiss/ucomisd
+    u7_vm0_jit_emit_u8(self, swap ? 0xC8 : 0xC1);  // xmm1, xmm0 (xmm0, xmm1)
+  }
+  switch (condition) {
+    case U7_VM0_JIT_EQUAL:
+      U7_VM0_JIT_EMIT(self, 0x7A, 0x06, 0x0F, 0x84);  // jp +6; je label
+      u7_vm0_jit_emit_label(self, label);
+      break;
+    case U7_VM0_JIT_NOT_EQUAL:
+      U7_VM0_JIT_EMIT(self, 0x0F, 0x8A);  // jp label
+      u7_vm0_jit_emit_label(self, label);
+      U7_VM0_JIT_EMIT(self, 0x0F, 0x85);  // jne label
+      u7_vm0_jit_emit_label(self, label);
+      break;
+    case U7_VM0_JIT_LESS:
+    case U7_VM0_JIT_GREATER:
+      U7_VM0_JIT_EMIT(self, 0x0F, 0x87);  // ja label
+      u7_vm0_jit_emit_label(self, label);
+      break;
+    case U7_VM0_JIT_LESS_OR_EQUAL:
+    case U7_VM0_JIT_GREATER_OR_EQUAL:
+      U7_VM0_JIT_EMIT(self, 0x0F, 0x83);  // jae label
+      u7_vm0_jit_emit_label(self, label);
+      break;
+  }
+}
+
+enum u7_vm0_jit_fused_operation {
+  U7_VM0_JIT_FUSED_AND,
+  U7_VM0_JIT_FUSED_LEFT_SHIFT,
+  U7_VM0_JIT_FUSED_RIGHT_SHIFT,
+};
+
+// dst = src op arg2, then jumps to the label (arg3) if the result is (not)
+// zero; dst and src are packed into arg1 (see u7_vm0_fuse()).
+static void u7_vm0_jit_emit_fused_jump_if(
+    struct u7_vm0_jit_buffer* self,
+    struct u7_vm0_instruction const* instruction, enum u7_vm0_jit_type type,
+    enum u7_vm0_jit_fused_operation operation, bool if_zero) {
+  const bool wide = (type == U7_VM0_JIT_I64);
+  u7_vm0_jit_emit_load(self, type,
+                       u7_vm0_operand_pair_second(instruction->arg1.i64));
+  if (operation == U7_VM0_JIT_FUSED_AND) {
+    u7_vm0_jit_emit_constant(self, type, instruction->arg2);
+    if (wide) {
+      u7_vm0_jit_emit_u8(self, 0x48);
+    }
+    U7_VM0_JIT_EMIT(self, 0x21, 0xC8);  // and eax, ecx
+  } else {
+    if (wide) {
+      u7_vm0_jit_emit_u8(self, 0x48);
+    }
+    // shl/sar eax, imm8; the verifier keeps the count in range.
+    u7_vm0_jit_emit_u8(self, 0xC1);
+    u7_vm0_jit_emit_u8(self,
+                       operation == U7_VM0_JIT_FUSED_LEFT_SHIFT ? 0xE0 : 0xF8);
+    u7_vm0_jit_emit_u8(self, (uint8_t)instruction->arg2.i32);
+  }
+  u7_vm0_jit_emit_store(self, type,
+                        u7_vm0_operand_pair_first(instruction->arg1.i64));
+  if (wide) {
+    u7_vm0_jit_emit_u8(self, 0x48);
+  }
+  U7_VM0_JIT_EMIT(self, 0x85, 0xC0);  // test eax, eax
+  u7_vm0_jit_emit_u8(self, 0x0F);
+  u7_vm0_jit_emit_u8(self, if_zero ? 0x84 : 0x85);  // je/jne label
+  u7_vm0_jit_emit_label(self, (size_t)instruction->arg3.i64);
+}
+
+// dst = lhs op rhs for f64 locals; `opcode` is 0x58 (addsd) or 0x59
+// (mulsd).
+static void u7_vm0_jit_emit_f64_operation(struct u7_vm0_jit_buffer* self,
+                                          uint8_t opcode, int64_t dst,
+                                          int64_t lhs, int64_t rhs) {
+  u7_vm0_jit_emit_load(self, U7_VM0_JIT_F64, lhs);
+  u7_vm0_jit_emit_local(self, 0xF2, false, (uint16_t)(0x0F00 | opcode),
+                        U7_VM0_JIT_XMM0, rhs);
+  u7_vm0_jit_emit_store(self, U7_VM0_JIT_F64, dst);
+}
+
+// Returns true if all the local operands of the instruction can be
+// addressed with a disp32.
+static bool u7_vm0_jit_operands_fit(
+    struct u7_vm0_instruction const* instruction,
+    struct u7_vm0_opcode_info const* info) {
+  const union u7_vm0_value args[3] = {instruction->arg1, instruction->arg2,
+                                      instruction->arg3};
+  for (int i = 0; i < 3; ++i) {
+    if (u7_vm0_operand_kind_variable_size(info->operand_kinds[i]) > 0 &&
+        !u7_vm0_operand_kind_is_pair(info->operand_kinds[i]) &&
+        !u7_vm0_operand_kind_is_array_pair(info->operand_kinds[i]) &&
+        (args[i].i64 < 0 || args[i].i64 > INT32_MAX)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// Emits the native code of an instruction; returns false if there is none.
+static bool u7_vm0_jit_emit_instruction(
+    struct u7_vm0_jit_buffer* self, struct u7_vm0_jit_stubs const* stubs,
+    struct u7_vm0_instruction const* instruction, size_t index,
+    size_t instructions_size) {
+  const enum u7_vm0_opcode opcode = u7_vm0_instruction_opcode(instruction);
+  if (opcode == U7_VM0_OPCODE_UNKNOWN ||
+      !u7_vm0_jit_operands_fit(instruction, u7_vm0_opcode_info(opcode))) {
+    return false;
+  }
+  const int64_t dst = instruction->arg1.i64;
+  const size_t label = (size_t)instruction->arg2.i64;
+  switch (opcode) {
+    case U7_VM0_OPCODE_YIELD:
+      u7_vm0_jit_emit_set_ip(self, index + 1);
+      u7_vm0_jit_emit_u8(self, 0xE9);  // jmp epilogue
+      u7_vm0_jit_emit_rel32(self, stubs->epilogue);
+      return true;
+    // Constants are copied as bits, and so are variables of any type.
+    case U7_VM0_OPCODE_COPY_I32C:
+    case U7_VM0_OPCODE_COPY_F32C:
+      u7_vm0_jit_emit_constant(self, U7_VM0_JIT_I32, instruction->arg2);
+      u7_vm0_jit_emit_local(self, 0, false, 0x89, U7_VM0_JIT_RCX, dst);
+      return true;
+    case U7_VM0_OPCODE_COPY_I64C:
+    case U7_VM0_OPCODE_COPY_F64C:
+      u7_vm0_jit_emit_constant(self, U7_VM0_JIT_I64, instruction->arg2);
+      u7_vm0_jit_emit_local(self, 0, true, 0x89, U7_VM0_JIT_RCX, dst);
+      return true;
+
+    case U7_VM0_OPCODE_COPY_I32V:
+    case U7_VM0_OPCODE_COPY_F32V:
+      u7_vm0_jit_emit_load(self, U7_VM0_JIT_I32, instruction->arg2.i64);
+      u7_vm0_jit_emit_store(self, U7_VM0_JIT_I32, dst);
+      return true;
+    case U7_VM0_OPCODE_COPY_I64V:
+    case U7_VM0_OPCODE_COPY_F64V:
+      u7_vm0_jit_emit_load(self, U7_VM0_JIT_I64, instruction->arg2.i64);
+      u7_vm0_jit_emit_store(self, U7_VM0_JIT_I64, dst);
+      return true;
+
+    case U7_VM0_OPCODE_BITWISE_LEFT_SHIFT_I32VC:
+    case U7_VM0_OPCODE_BITWISE_RIGHT_SHIFT_I32VC:
+    case U7_VM0_OPCODE_BITWISE_LEFT_SHIFT_I64VC:
+    case U7_VM0_OPCODE_BITWISE_RIGHT_SHIFT_I64VC: {
+      const bool wide = (opcode == U7_VM0_OPCODE_BITWISE_LEFT_SHIFT_I64VC ||
+                         opcode == U7_VM0_OPCODE_BITWISE_RIGHT_SHIFT_I64VC);
+      const bool left = (opcode == U7_VM0_OPCODE_BITWISE_LEFT_SHIFT_I32VC ||
+                         opcode == U7_VM0_OPCODE_BITWISE_LEFT_SHIFT_I64VC);
+      const enum u7_vm0_jit_type type =
+          (wide ? U7_VM0_JIT_I64 : U7_VM0_JIT_I32);
+      u7_vm0_jit_emit_load(self, type, instruction->arg2.i64);
+      if (wide) {
+        u7_vm0_jit_emit_u8(self, 0x48);
+      }
+      // shl/sar eax, imm8; the verifier keeps the count in range.
+      u7_vm0_jit_emit_u8(self, 0xC1);
+      u7_vm0_jit_emit_u8(self, left ? 0xE0 : 0xF8);
+      u7_vm0_jit_emit_u8(self, (uint8_t)instruction->arg3.i32);
+      u7_vm0_jit_emit_store(self, type, dst);
+      return true;
+    }
+
+#define U7_VM0_JIT_CASE_BINARY(OPCODE, type, operation, rhs_is_local) \
+  case U7_VM0_OPCODE_##OPCODE:                                        \
+    u7_vm0_jit_emit_binary(self, stubs, instruction, index,           \
+                           U7_VM0_JIT_##type, U7_VM0_JIT_##operation, \
+                           rhs_is_local);                             \
+    return true;
+      U7_VM0_JIT_CASE_BINARY(BITWISE_AND_I32VC, I32, AND, false)
+      U7_VM0_JIT_CASE_BINARY(BITWISE_AND_I32VV, I32, AND, true)
+      U7_VM0_JIT_CASE_BINARY(BITWISE_AND_I64VC, I64, AND, false)
+      U7_VM0_JIT_CASE_BINARY(BITWISE_AND_I64VV, I64, AND, true)
+      U7_VM0_JIT_CASE_BINARY(MATH_ADD_I32VC, I32, ADD, false)
+      U7_VM0_JIT_CASE_BINARY(MATH_ADD_I32VV, I32, ADD, true)
+      U7_VM0_JIT_CASE_BINARY(MATH_ADD_I64VC, I64, ADD, false)
+      U7_VM0_JIT_CASE_BINARY(MATH_ADD_I64VV, I64, ADD, true)
+      U7_VM0_JIT_CASE_BINARY(MATH_ADD_F32VC, F32, ADD, false)
+      U7_VM0_JIT_CASE_BINARY(MATH_ADD_F32VV, F32, ADD, true)
+      U7_VM0_JIT_CASE_BINARY(MATH_ADD_F64VC, F64, ADD, false)
+      U7_VM0_JIT_CASE_BINARY(MATH_ADD_F64VV, F64, ADD, true)
+      U7_VM0_JIT_CASE_BINARY(MATH_MULTIPLY_I32VC, I32, MULTIPLY, false)
+      U7_VM0_JIT_CASE_BINARY(MATH_MULTIPLY_I32VV, I32, MULTIPLY, true)
+      U7_VM0_JIT_CASE_BINARY(MATH_MULTIPLY_I64VC, I64, MULTIPLY, false)
+      U7_VM0_JIT_CASE_BINARY(MATH_MULTIPLY_I64VV, I64, MULTIPLY, true)
+      U7_VM0_JIT_CASE_BINARY(MATH_MULTIPLY_F32VC, F32, MULTIPLY, false)
+      U7_VM0_JIT_CASE_BINARY(MATH_MULTIPLY_F32VV, F32, MULTIPLY, true)
+      U7_VM0_JIT_CASE_BINARY(MATH_MULTIPLY_F64VC, F64, MULTIPLY, false)
+      U7_VM0_JIT_CASE_BINARY(MATH_MULTIPLY_F64VV, F64, MULTIPLY, true)
+#undef U7_VM0_JIT_CASE_BINARY
+
+// The checked variants are compiled natively if their label is in range;
+// otherwise the fallback reports the error.
+#define U7_VM0_JIT_CASE_JUMP(OPCODE, type, if_zero)                \
+  case U7_VM0_OPCODE_##OPCODE:                                     \
+  case U7_VM0_OPCODE_##OPCODE##_UNCHECKED:                         \
+    if (label >= instructions_size) {                              \
+      return false;                                                \
+    }                                                              \
+    u7_vm0_jit_emit_jump_if(self, U7_VM0_JIT_##type, dst, if_zero, \
+                            label);                                \
+    return true;
+      U7_VM0_JIT_CASE_JUMP(JUMP_IF_ZERO_I32, I32, true)
+      U7_VM0_JIT_CASE_JUMP(JUMP_IF_ZERO_I64, I64, true)
+      U7_VM0_JIT_CASE_JUMP(JUMP_IF_ZERO_F32, F32, true)
+      U7_VM0_JIT_CASE_JUMP(JUMP_IF_ZERO_F64, F64, true)
+      U7_VM0_JIT_CASE_JUMP(JUMP_IF_NOT_ZERO_I32, I32, false)
+      U7_VM0_JIT_CASE_JUMP(JUMP_IF_NOT_ZERO_I64, I64, false)
+      U7_VM0_JIT_CASE_JUMP(JUMP_IF_NOT_ZERO_F32, F32, false)
+      U7_VM0_JIT_CASE_JUMP(JUMP_IF_NOT_ZERO_F64, F64, false)
+#undef U7_VM0_JIT_CASE_JUMP
+
+#define U7_VM0_JIT_CASE_JUMP_IF_COMPARE(condition, type, form, rhs_is_local) \
+  case U7_VM0_OPCODE_JUMP_IF_##condition##_##type##form:                     \
+  case U7_VM0_OPCODE_JUMP_IF_##condition##_##type##form##_UNCHECKED:         \
+    if ((size_t)instruction->arg3.i64 >= instructions_size) {                \
+      return false;                                                          \
+    }                                                                        \
+    u7_vm0_jit_emit_jump_if_compare(self, instruction, U7_VM0_JIT_##type,    \
+                                    U7_VM0_JIT_##condition, rhs_is_local);   \
+    return true;
+      U7_VM0_JIT_CASE_JUMP_IF_COMPARE(EQUAL, I32, VC, false)
+      U7_VM0_JIT_CASE_JUMP_IF_COMPARE(EQUAL, I32, VV, true)
+      U7_VM0_JIT_CASE_JUMP_IF_COMPARE(EQUAL, I64, VC, false)
+      U7_VM0_JIT_CASE_JUMP_IF_COMPARE(EQUAL, I64, VV, true)
+      U7_VM0_JIT_CASE_JUMP_IF_COMPARE(EQUAL, F32, VC, false)
+      U7_VM0_JIT_CASE_JUMP_IF_COMPARE(EQUAL, F32, VV, true)
+      U7_VM0_JIT_CASE_JUMP_IF_COMPARE(EQUAL, F64, VC, false)
+      U7_VM0_JIT_CASE_JUMP_IF_COMPARE(EQUAL, F64, VV, true)
+      U7_VM0_JIT_CASE_JUMP_IF_COMPARE(NOT_EQUAL, I32, VC, false)
+      U7_VM0_JIT_CASE_JUMP_IF_COMPARE(NOT_EQUAL, I32, VV, true)
+      U7_VM0_JIT_CASE_JUMP_IF_COMPARE(NOT_EQUAL, I64, VC, false)
+      U7_VM0_JIT_CASE_JUMP_IF_COMPARE(NOT_EQUAL, I64, VV, true)
+      U7_VM0_JIT_CASE_JUMP_IF_COMPARE(NOT_EQUAL, F32, VC, false)
+      U7_VM0_JIT_CASE_JUMP_IF_COMPARE(NOT_EQUAL, F32, VV, true)
+      U7_VM0_JIT_CASE_JUMP_IF_COMPARE(NOT_EQUAL, F64, VC, false)
+      U7_VM0_JIT_CASE_JUMP_IF_COMPARE(NOT_EQUAL, F64, VV, true)
+      U7_VM0_JIT_CASE_JUMP_IF_COMPARE(LESS, I32, VC, false)
+      U7_VM0_JIT_CASE_JUMP_IF_COMPARE(LESS, I32, VV, true)
+      U7_VM0_JIT_CASE_JUMP_IF_COMPARE(LESS, I64, VC, false)
+      U7_VM0_JIT_CASE_JUMP_IF_COMPARE(LESS, I64, VV, true)
+      U7_VM0_JIT_CASE_JUMP_IF_COMPARE(LESS, F32, VC, false)
+      U7_VM0_JIT_CASE_JUMP_IF_COMPARE(LESS, F32, VV, true)
+      U7_VM0_JIT_CASE_JUMP_IF_COMPARE(LESS, F64, VC, false)
+      U7_VM0_JIT_CASE_JUMP_IF_COMPARE(LESS, F64, VV, true)
+      U7_VM0_JIT_CASE_JUMP_IF_COMPARE(LESS_OR_EQUAL, I32, VC, false)
+      U7_VM0_JIT_CASE_JUMP_IF_COMPARE(LESS_OR_EQUAL, I32, VV, true)
+      U7_VM0_JIT_CASE_JUMP_IF_COMPARE(LESS_OR_EQUAL, I64, VC, false)
+      U7_VM0_JIT_CASE_JUMP_IF_COMPARE(LESS_OR_EQUAL, I64, VV, true)
+      U7_VM0_JIT_CASE_JUMP_IF_COMPARE(LESS_OR_EQUAL, F32, VC, false)
+      U7_VM0_JIT_CASE_JUMP_IF_COMPARE(LESS_OR_EQUAL, F32, VV, true)
+      U7_VM0_JIT_CASE_JUMP_IF_COMPARE(LESS_OR_EQUAL, F64, VC, false)
+      U7_VM0_JIT_CASE_JUMP_IF_COMPARE(LESS_OR_EQUAL, F64, VV, true)
+      U7_VM0_JIT_CASE_JUMP_IF_COMPARE(GREATER, I32, VC, false)
+      U7_VM0_JIT_CASE_JUMP_IF_COMPARE(GREATER, I64, VC, false)
+      U7_VM0_JIT_CASE_JUMP_IF_COMPARE(GREATER, F32, VC, false)
+      U7_VM0_JIT_CASE_JUMP_IF_COMPARE(GREATER, F64, VC, false)
+      U7_VM0_JIT_CASE_JUMP_IF_COMPARE(GREATER_OR_EQUAL, I32, VC, false)
+      U7_VM0_JIT_CASE_JUMP_IF_COMPARE(GREATER_OR_EQUAL, I64, VC, false)
+      U7_VM0_JIT_CASE_JUMP_IF_COMPARE(GREATER_OR_EQUAL, F32, VC, false)
+      U7_VM0_JIT_CASE_JUMP_IF_COMPARE(GREATER_OR_EQUAL, F64, VC, false)
+#undef U7_VM0_JIT_CASE_JUMP_IF_COMPARE
+
+#define U7_VM0_JIT_CASE_FUSED_JUMP_IF(OPCODE, type, operation, if_zero)   \
+  case U7_VM0_OPCODE_##OPCODE:                                            \
+    if ((size_t)instruction->arg3.i64 >= instructions_size) {             \
+      return false;                                                       \
+    }                                                                     \
+    u7_vm0_jit_emit_fused_jump_if(self, instruction, U7_VM0_JIT_##type,   \
+                                  U7_VM0_JIT_FUSED_##operation, if_zero); \
+    return true;
+      U7_VM0_JIT_CASE_FUSED_JUMP_IF(BITWISE_AND_JUMP_IF_ZERO_I32VC, I32, AND,
+                                    true)
+      U7_VM0_JIT_CASE_FUSED_JUMP_IF(BITWISE_AND_JUMP_IF_ZERO_I64VC, I64, AND,
+                                    true)
+      U7_VM0_JIT_CASE_FUSED_JUMP_IF(BITWISE_AND_JUMP_IF_NOT_ZERO_I32VC, I32,
+                                    AND, false)
+      U7_VM0_JIT_CASE_FUSED_JUMP_IF(BITWISE_AND_JUMP_IF_NOT_ZERO_I64VC, I64,
+                                    AND, false)
+      U7_VM0_JIT_CASE_FUSED_JUMP_IF(BITWISE_LEFT_SHIFT_JUMP_IF_NOT_ZERO_I32VC,
+                                    I32, LEFT_SHIFT, false)
+      U7_VM0_JIT_CASE_FUSED_JUMP_IF(BITWISE_LEFT_SHIFT_JUMP_IF_NOT_ZERO_I64VC,
+                                    I64, LEFT_SHIFT, false)
+      U7_VM0_JIT_CASE_FUSED_JUMP_IF(BITWISE_RIGHT_SHIFT_JUMP_IF_NOT_ZERO_I32VC,
+                                    I32, RIGHT_SHIFT, false)
+      U7_VM0_JIT_CASE_FUSED_JUMP_IF(BITWISE_RIGHT_SHIFT_JUMP_IF_NOT_ZERO_I64VC,
+                                    I64, RIGHT_SHIFT, false)
+#undef U7_VM0_JIT_CASE_FUSED_JUMP_IF
+
+    // The pairs are computed in order, as by the regular execute_fn.
+    case U7_VM0_OPCODE_MATH_ADD_2_F64VV:
+    case U7_VM0_OPCODE_MATH_MULTIPLY_2_F64VV: {
+      const uint8_t operation =
+          (opcode == U7_VM0_OPCODE_MATH_ADD_2_F64VV ? 0x58 : 0x59);
+      u7_vm0_jit_emit_f64_operation(
+          self, operation, u7_vm0_operand_pair_first(dst),
+          u7_vm0_operand_pair_first(instruction->arg2.i64),
+          u7_vm0_operand_pair_second(instruction->arg2.i64));
+      u7_vm0_jit_emit_f64_operation(
+          self, operation, u7_vm0_operand_pair_second(dst),
+          u7_vm0_operand_pair_first(instruction->arg3.i64),
+          u7_vm0_operand_pair_second(instruction->arg3.i64));
+      return true;
+    }
+    case U7_VM0_OPCODE_MATH_MULTIPLY_ADD_F64VVV:
+      u7_vm0_jit_emit_f64_operation(
+          self, 0x59, u7_vm0_operand_pair_first(dst),
+          u7_vm0_operand_pair_first(instruction->arg2.i64),
+          u7_vm0_operand_pair_second(instruction->arg2.i64));
+      u7_vm0_jit_emit_f64_operation(self, 0x58,
+                                    u7_vm0_operand_pair_second(dst),
+                                    u7_vm0_operand_pair_first(dst),
+                                    instruction->arg3.i64);
+      return true;
+
+    case U7_VM0_OPCODE_JUMP:
+    case U7_VM0_OPCODE_JUMP_UNCHECKED:
+      if ((size_t)dst >= instructions_size) {
+        return false;
+      }
+      u7_vm0_jit_emit_u8(self, 0xE9);  // jmp label
+      u7_vm0_jit_emit_label(self, (size_t)dst);
+      return true;
+
+    // Goes through the dispatch table to the entry, which is native code too.
+    // A negative index is sign-extended, so it compares above the count.
+    case U7_VM0_OPCODE_JUMP_TABLE_I32:
+    case U7_VM0_OPCODE_JUMP_TABLE_I64:
+    case U7_VM0_OPCODE_JUMP_TABLE_I32_UNCHECKED:
+    case U7_VM0_OPCODE_JUMP_TABLE_I64_UNCHECKED: {
+      const int64_t count = instruction->arg2.i64;
+      const size_t default_label = (size_t)instruction->arg3.i64;
+      if (default_label >= instructions_size || count < 0 ||
+          (uint64_t)count >= instructions_size - index) {
+        return false;
+      }
+      const bool wide = (opcode == U7_VM0_OPCODE_JUMP_TABLE_I64 ||
+                         opcode == U7_VM0_OPCODE_JUMP_TABLE_I64_UNCHECKED);
+      // mov rax, [local] (movsxd for i32)
+      u7_vm0_jit_emit_local(self, 0, true, wide ? 0x8B : 0x63,
+                            U7_VM0_JIT_RAX, dst);
+      U7_VM0_JIT_EMIT(self, 0x48, 0x3D);  // cmp rax, imm32
+      u7_vm0_jit_emit_u32(self, (uint32_t)count);
+      U7_VM0_JIT_EMIT(self, 0x0F, 0x83);  // jae label
+      u7_vm0_jit_emit_label(self, default_label);
+      U7_VM0_JIT_EMIT(self, 0x48, 0x05);  // add rax, imm32
+      u7_vm0_jit_emit_u32(self, (uint32_t)(index + 1));
+      U7_VM0_JIT_EMIT(self, 0x48, 0x89, 0x83);  // mov [rbx + ip], rax
+      u7_vm0_jit_emit_u32(self, (uint32_t)offsetof(struct u7_vm_state, ip));
+      u7_vm0_jit_emit_u8(self, 0xE9);  // jmp dispatch
+      u7_vm0_jit_emit_rel32(self, stubs->dispatch);
+      return true;
+    }
+
+    default:
+      return false;
+  }
+}
+
+u7_error u7_vm0_jit_program_init(struct u7_vm0_jit_program* self,
+                                 struct u7_vm0_instruction const* instructions,
+                                 size_t instructions_size) {
+  const size_t n = instructions_size;
+  if (n > INT32_MAX) {
+    return u7_errnof(E2BIG,
+                     "u7_vm0_jit_program_init: too many instructions: %zu", n);
+  }
+  char* memory = malloc(n * (sizeof(void const*) +
+                             sizeof(struct u7_vm0_instruction)) +
+                        1);
+  size_t* offsets = malloc(n * sizeof(size_t) + 1);
+  if (memory == NULL || offsets == NULL) {
+    free(memory);
+    free(offsets);
+    return u7_errnof(ENOMEM, "u7_vm0_jit_program_init: out of memory");
+  }
+  self->entries = (void const**)memory;
+  self->instructions =
+      (struct u7_vm0_instruction*)(memory + n * sizeof(void const*));
+  self->instructions_size = n;
+  memcpy(self->instructions, instructions,
+         n * sizeof(struct u7_vm0_instruction));
+
+  struct u7_vm0_jit_buffer buffer = {0};
+  const struct u7_vm0_jit_stubs stubs =
+      u7_vm0_jit_emit_stubs(&buffer, self->entries, n);
+  for (size_t i = 0; i < n; ++i) {
+    offsets[i] = buffer.size;
+    if (!u7_vm0_jit_emit_instruction(&buffer, &stubs, &self->instructions[i],
+                                     i, n)) {
+      u7_vm0_jit_emit_fallback(&buffer, &stubs, &self->instructions[i], i);
+    }
+  }
+  for (size_t i = 0; i < buffer.patches_size && !buffer.failed; ++i) {
+    struct u7_vm0_jit_patch const* patch = &buffer.patches[i];
+    const uint32_t rel32 =
+        (uint32_t)(offsets[patch->target] - (patch->position + 4));
+    memcpy(buffer.data + patch->position, &rel32, 4);
+  }
+  u7_error error = u7_ok();
+  void* code = MAP_FAILED;
+  if (buffer.failed) {
+    error = u7_errnof(ENOMEM, "u7_vm0_jit_program_init: out of memory");
+  } else {
+    code = mmap(NULL, buffer.size, PROT_READ | PROT_WRITE,
+                MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (code == MAP_FAILED) {
+      error = u7_errnof(errno, "u7_vm0_jit_program_init: mmap failed");
+    } else {
+      memcpy(code, buffer.data, buffer.size);
+      if (mprotect(code, buffer.size, PROT_READ | PROT_EXEC) != 0) {
+        error = u7_errnof(errno, "u7_vm0_jit_program_init: mprotect failed");
+        munmap(code, buffer.size);
+      }
+    }
+  }
+  if (error.error_code == 0) {
+    self->code = code;
+    self->code_size = buffer.size;
+    for (size_t i = 0; i < n; ++i) {
+      self->entries[i] = (char const*)code + offsets[i];
+    }
+  } else {
+    free(memory);
+  }
+  free(offsets);
+  free(buffer.data);
+  free(buffer.patches);
+  return error;
+}
+
+void u7_vm0_jit_program_destroy(struct u7_vm0_jit_program* self) {
+  munmap(self->code, self->code_size);
+  free(self->entries);  // Also holds the instructions.
+  self->code = NULL;
+  self->code_size = 0;
+  self->entries = NULL;
+  self->instructions = NULL;
+  self->instructions_size = 0;
+}
+
+void u7_vm0_jit_run(struct u7_vm0_jit_program const* program,
+                    struct u7_vm_state* state) {
+  assert(state->instructions_size == program->instructions_size);
+  assert(state->ip < program->instructions_size);
+  void (*const fn)(struct u7_vm_state*) =
+      (void (*)(struct u7_vm_state*))program->code;
+  fn(state);
+}
+
+#else  // defined(__x86_64__)
+
+u7_error u7_vm0_jit_program_init(struct u7_vm0_jit_program* self,
+                                 struct u7_vm0_instruction const* instructions,
+                                 size_t instructions_size) {
+  (void)self;
+  (void)instructions;
+  (void)instructions_size;
+  return u7_errnof(ENOTSUP, "u7_vm0_jit_program_init: unsupported platform");
+}
+
+void u7_vm0_jit_program_destroy(struct u7_vm0_jit_program* self) {
+  (void)self;
+}
+
+void u7_vm0_jit_run(struct u7_vm0_jit_program const* program,
+                    struct u7_vm_state* state) {
+  (void)program;
+  (void)state;
+  assert(false);
+}
+
+#endif  // defined(__x86_64__)
@@ -0,0 +1,219 @@
+#include "@/public/vm0.h"
+
+#include "@/public/program.h"
+#include "@/testing.h"
+
+#include <errno.h>
+#include <github.com/apronchenkov/error/public/error.h>
+#include <github.com/apronchenkov/vm/public/state.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+// Tests for u7_vm0_matrix_multiply(): the products of every size and type
+// match a reference, also when `dst` coincides with a source, and an i64
+// overflow leaves `dst` as it was.
+
+enum { TEST_MAX_ELEMENTS = 16 };
+
+// The locals: lhs, rhs and dst, of 16 slots each.
+static const struct u7_vm_stack_frame_layout frame_layout = {
+    .locals_size = 3 * TEST_MAX_ELEMENTS * sizeof(int64_t),
+    .description = "matrix_test",
+};
+
+static struct u7_vm0_arg variable(bool f64, int64_t index) {
+  return (struct u7_vm0_arg){
+      .kind = (f64 ? U7_VM0_ARG_KIND_F64_VARIABLE
+                   : U7_VM0_ARG_KIND_I64_VARIABLE),
+      .value.i64 = index * (int64_t)sizeof(int64_t)};
+}
+
+// Which of the matrices is the destination.
+enum destination { TEST_DST, TEST_LHS, TEST_RHS };
+
+// Builds a program that reads lhs, rhs and dst, multiplies lhs by rhs into
+// the destination, and writes the destination.
+static u7_error program_init(struct u7_vm0_program* program, bool f64,
+                             int64_t n, enum destination destination) {
+  const struct u7_vm0_arg lhs = variable(f64, 0);
+  const struct u7_vm0_arg rhs = variable(f64, TEST_MAX_ELEMENTS);
+  const struct u7_vm0_arg dst = variable(f64, 2 * TEST_MAX_ELEMENTS);
+  const struct u7_vm0_arg target =
+      (destination == TEST_LHS ? lhs : destination == TEST_RHS ? rhs : dst);
+  u7_error error = u7_ok();
+  const struct u7_vm0_instruction instructions[] = {
+      u7_vm0_input_n(&error, lhs, n * n),
+      u7_vm0_input_n(&error, rhs, n * n),
+      u7_vm0_input_n(&error, dst, n * n),
+      u7_vm0_matrix_multiply(&error, target, lhs, rhs, n),
+      u7_vm0_output_n(&error, target, n * n),
+      u7_vm0_ret(),
+  };
+  if (error.error_code != 0) {
+    return error;
+  }
+  return u7_vm0_test_program_init(
+      program, instructions, sizeof(instructions) / sizeof(instructions[0]),
+      &frame_layout);
+}
+
+// Small integers, so that the f64 products are exact in any order of the
+// additions.
+static void fill(int64_t* values, size_t size, int64_t seed) {
+  for (size_t i = 0; i < size; ++i) {
+    values[i] = (int64_t)((i * 7 + (size_t)seed * 13) % 19) - 9;
+  }
+}
+
+static void reference_multiply(int64_t* dst, int64_t const* lhs,
+                               int64_t const* rhs, int64_t n) {
+  for (int64_t i = 0; i < n; ++i) {
+    for (int64_t j = 0; j < n; ++j) {
+      int64_t sum = 0;
+      for (int64_t k = 0; k < n; ++k) {
+        sum += lhs[i * n + k] * rhs[k * n + j];
+      }
+      dst[i * n + j] = sum;
+    }
+  }
+}
+
+// Stores the values as the raw bits of i64 or f64 variables.
+static void encode(int64_t* dst, int64_t const* values, size_t size,
+                   bool f64) {
+  for (size_t i = 0; i < size; ++i) {
+    if (f64) {
+      const double value = (double)values[i];
+      memcpy(&dst[i], &value, sizeof(value));
+    } else {
+      dst[i] = values[i];
+    }
+  }
+}
+
+static u7_error check_multiply(bool f64, int64_t n,
+                               enum destination destination) {
+  struct u7_vm0_program program;
+  u7_error error = program_init(&program, f64, n, destination);
+  if (error.error_code != 0) {
+    return error;
+  }
+  const size_t size = (size_t)(n * n);
+  int64_t values[3 * TEST_MAX_ELEMENTS];
+  fill(values, size, n);
+  fill(values + size, size, n + 1);
+  fill(values + 2 * size, size, n + 2);
+  int64_t expected[TEST_MAX_ELEMENTS];
+  reference_multiply(expected, values, values + size, n);
+  int64_t input[3 * TEST_MAX_ELEMENTS];
+  encode(input, values, 3 * size, f64);
+  int64_t encoded[TEST_MAX_ELEMENTS];
+  encode(encoded, expected, size, f64);
+  int64_t output[TEST_MAX_ELEMENTS];
+  size_t output_size = TEST_MAX_ELEMENTS;
+  error = u7_vm0_test_run(&program, program.js, input, 3 * size, output,
+                          &output_size);
+  u7_vm0_program_destroy(&program);
+  if (error.error_code == 0 &&
+      (output_size != size ||
+       memcmp(output, encoded, size * sizeof(int64_t)) != 0)) {
+    error = u7_errnof(EINVAL,
+                      "multiply: %s %dx%d into %s: unexpected product",
+                      (f64 ? "f64" : "i64"), (int)n, (int)n,
+                      (destination == TEST_LHS   ? "lhs"
+                       : destination == TEST_RHS ? "rhs"
+                                                 : "dst"));
+  }
+  return error;
+}
+
+static u7_error test_multiply() {
+  for (int64_t n = 2; n <= 4; ++n) {
+    for (int f64 = 0; f64 < 2; ++f64) {
+      for (int destination = TEST_DST; destination <= TEST_RHS;
+           ++destination) {
+        u7_error error =
+            check_multiply(f64, n, (enum destination)destination);
+        if (error.error_code != 0) {
+          return error;
+        }
+      }
+    }
+  }
+  return u7_ok();
+}
+
+// An overflow in the last row fails with ERANGE, and no element of dst is
+// written, not even those of the rows before it.
+static u7_error test_overflow() {
+  struct u7_vm0_program program;
+  u7_error error = program_init(&program, false, 3, TEST_DST);
+  if (error.error_code != 0) {
+    return error;
+  }
+  int64_t input[27];
+  fill(input, 27, 5);
+  input[8] = INT64_MAX / 2;  // lhs[2][2]
+  input[17] = 3;             // rhs[2][2]
+  struct u7_vm0_test_state test_state;
+  error = u7_vm0_test_state_init(&test_state, &program, program.js, input, 27,
+                                 NULL, 0);
+  if (error.error_code == 0) {
+    u7_vm_state_run(&test_state.state);
+    error = u7_vm0_test_expect_error(
+        "overflow", u7_vm0_state_take_error(&test_state.state), ERANGE);
+    int64_t const* dst =
+        (int64_t const*)u7_vm_state_locals(&test_state.state) +
+        2 * TEST_MAX_ELEMENTS;
+    if (error.error_code == 0 &&
+        memcmp(dst, input + 18, 9 * sizeof(int64_t)) != 0) {
+      error = u7_errnof(EINVAL, "overflow: dst is modified");
+    }
+    u7_vm0_test_state_destroy(&test_state);
+  }
+  u7_vm0_program_destroy(&program);
+  return error;
+}
+
+static u7_error test_invalid_arguments() {
+  const struct u7_vm0_arg i32_variable = {
+      .kind = U7_VM0_ARG_KIND_I32_VARIABLE, .value.i64 = 0};
+  struct {
+    const char* name;
+    struct u7_vm0_arg dst;
+    struct u7_vm0_arg lhs;
+    struct u7_vm0_arg rhs;
+    int64_t size;
+  } const cases[] = {
+      {"size 1", variable(true, 0), variable(true, 16), variable(true, 32),
+       1},
+      {"size 5", variable(true, 0), variable(true, 32), variable(true, 64),
+       5},
+      // dst[0..9) and rhs[4..13) partially overlap.
+      {"partial overlap", variable(false, 0), variable(false, 16),
+       variable(false, 4), 3},
+      {"i32 dst", i32_variable, i32_variable, i32_variable, 2},
+      {"mixed types", variable(true, 0), variable(false, 16),
+       variable(true, 32), 2},
+  };
+  for (size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); ++i) {
+    u7_error error = u7_ok();
+    u7_vm0_matrix_multiply(&error, cases[i].dst, cases[i].lhs, cases[i].rhs,
+                           cases[i].size);
+    error = u7_vm0_test_expect_error(cases[i].name, error, EINVAL);
+    if (error.error_code != 0) {
+      return error;
+    }
+  }
+  return u7_ok();
+}
+
+int main() {
+  u7_error (*const tests[])() = {
+      &test_multiply,
+      &test_overflow,
+      &test_invalid_arguments,
+  };
+  return u7_vm0_test_main(tests, sizeof(tests) / sizeof(tests[0]));
+}
@@ -0,0 +1,113 @@
+#include "@/public/input.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <github.com/apronchenkov/error/public/error.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define U7_VM0_DEFINE_MEMORY_READ(fn_name, type, uint_type, bswap)         \
+  static u7_error fn_name(struct u7_vm0_input* self, type* result) {       \
+    struct u7_vm0_memory_input* input = (struct u7_vm0_memory_input*)self; \
+    if ((size_t)(input->end - input->cursor) < sizeof(type)) {             \
+      return u7_errnof(ENODATA, #fn_name ": eof");                         \
+    }                                                                      \
+    uint_type bits;                                                        \
+    memcpy(&bits, input->cursor, sizeof(bits));                            \
+    if (__BYTE_ORDER__ == __ORDER_BIG_ENDIAN__) {                          \
+      bits = bswap(bits);                                                  \
+    }                                                                      \
+    memcpy(result, &bits, sizeof(bits));                                   \
+    input->cursor += sizeof(type);                                         \
+    return u7_ok();                                                        \
+  }
+
+U7_VM0_DEFINE_MEMORY_READ(read_i32, int32_t, uint32_t, __builtin_bswap32)
+U7_VM0_DEFINE_MEMORY_READ(read_i64, int64_t, uint64_t, __builtin_bswap64)
+U7_VM0_DEFINE_MEMORY_READ(read_f32, float, uint32_t, __builtin_bswap32)
+U7_VM0_DEFINE_MEMORY_READ(read_f64, double, uint64_t, __builtin_bswap64)
+
+#define U7_VM0_DEFINE_MEMORY_READ_N(fn_name, type, uint_type, bswap)       \
+  static u7_error fn_name(struct u7_vm0_input* self, type* result,         \
+                          size_t count, size_t* done) {                    \
+    struct u7_vm0_memory_input* input = (struct u7_vm0_memory_input*)self; \
+    if ((size_t)(input->end - input->cursor) / sizeof(type) < count) {     \
+      *done = 0;                                                           \
+      return u7_errnof(ENODATA, #fn_name ": eof");                         \
+    }                                                                      \
+    memcpy(result, input->cursor, count * sizeof(type));                   \
+    if (__BYTE_ORDER__ == __ORDER_BIG_ENDIAN__) {                          \
+      for (size_t i = 0; i < count; ++i) {                                 \
+        uint_type bits;                                                    \
+        memcpy(&bits, &result[i], sizeof(bits));                           \
+        bits = bswap(bits);                                                \
+        memcpy(&result[i], &bits, sizeof(bits));                           \
+      }                                                                    \
+    }                                                                      \
+    input->cursor += count * sizeof(type);                                 \
+    *done = count;                                                         \
+    return u7_ok();                                                        \
+  }
+
+U7_VM0_DEFINE_MEMORY_READ_N(read_i32_n, int32_t, uint32_t, __builtin_bswap32)
+U7_VM0_DEFINE_MEMORY_READ_N(read_i64_n, int64_t, uint64_t, __builtin_bswap64)
+U7_VM0_DEFINE_MEMORY_READ_N(read_f32_n, float, uint32_t, __builtin_bswap32)
+U7_VM0_DEFINE_MEMORY_READ_N(read_f64_n, double, uint64_t, __builtin_bswap64)
+
+void u7_vm0_memory_input_init(struct u7_vm0_memory_input* self,
+                              void const* data, size_t size) {
+  self->base.read_i32_fn = &read_i32;
+  self->base.read_i64_fn = &read_i64;
+  self->base.read_f32_fn = &read_f32;
+  self->base.read_f64_fn = &read_f64;
+  self->base.read_i32_n_fn = &read_i32_n;
+  self->base.read_i64_n_fn = &read_i64_n;
+  self->base.read_f32_n_fn = &read_f32_n;
+  self->base.read_f64_n_fn = &read_f64_n;
+  self->cursor = (char const*)data;
+  self->end = (char const*)data + size;
+  self->mapping = NULL;
+  self->mapping_size = 0;
+}
+
+u7_error u7_vm0_memory_input_init_file(struct u7_vm0_memory_input* self,
+                                       const char* path) {
+  const int fd = open(path, O_RDONLY | O_CLOEXEC);
+  if (fd < 0) {
+    return u7_errnof(errno, "u7_vm0_memory_input_init_file: open failed: %s",
+                     path);
+  }
+  struct stat st;
+  if (fstat(fd, &st) != 0) {
+    const int error_code = errno;
+    close(fd);
+    return u7_errnof(error_code,
+                     "u7_vm0_memory_input_init_file: fstat failed: %s", path);
+  }
+  void* mapping = NULL;
+  const size_t size = (size_t)st.st_size;
+  if (size > 0) {
+    mapping = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (mapping == MAP_FAILED) {
+      const int error_code = errno;
+      close(fd);
+      return u7_errnof(error_code,
+                       "u7_vm0_memory_input_init_file: mmap failed: %s", path);
+    }
+    madvise(mapping, size, MADV_SEQUENTIAL);
+  }
+  close(fd);
+  u7_vm0_memory_input_init(self, mapping, size);
+  self->mapping = mapping;
+  self->mapping_size = size;
+  return u7_ok();
+}
+
+void u7_vm0_memory_input_destroy(struct u7_vm0_memory_input* self) {
+  if (self->mapping != NULL) {
+    munmap(self->mapping, self->mapping_size);
+    self->mapping = NULL;
+  }
+}
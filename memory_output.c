@@ -0,0 +1,123 @@
+#include "@/public/output.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <github.com/apronchenkov/error/public/error.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#define U7_VM0_DEFINE_MEMORY_WRITE(fn_name, type, uint_type, bswap)           \
+  static u7_error fn_name(struct u7_vm0_output* self, type value) {           \
+    struct u7_vm0_memory_output* output = (struct u7_vm0_memory_output*)self; \
+    if ((size_t)(output->end - output->cursor) < sizeof(type)) {              \
+      return u7_errnof(ENOSPC, #fn_name ": no space left");                   \
+    }                                                                         \
+    uint_type bits;                                                           \
+    memcpy(&bits, &value, sizeof(bits));                                      \
+    if (__BYTE_ORDER__ == __ORDER_BIG_ENDIAN__) {                             \
+      bits = bswap(bits);                                                     \
+    }                                                                         \
+    memcpy(output->cursor, &bits, sizeof(bits));                              \
+    output->cursor += sizeof(type);                                           \
+    return u7_ok();                                                           \
+  }
+
+U7_VM0_DEFINE_MEMORY_WRITE(write_i32, int32_t, uint32_t, __builtin_bswap32)
+U7_VM0_DEFINE_MEMORY_WRITE(write_i64, int64_t, uint64_t, __builtin_bswap64)
+U7_VM0_DEFINE_MEMORY_WRITE(write_f32, float, uint32_t, __builtin_bswap32)
+U7_VM0_DEFINE_MEMORY_WRITE(write_f64, double, uint64_t, __builtin_bswap64)
+
+#define U7_VM0_DEFINE_MEMORY_WRITE_N(fn_name, type, uint_type, bswap)         \
+  static u7_error fn_name(struct u7_vm0_output* self, type const* values,     \
+                          size_t count, size_t* done) {                       \
+    struct u7_vm0_memory_output* output = (struct u7_vm0_memory_output*)self; \
+    if ((size_t)(output->end - output->cursor) / sizeof(type) < count) {      \
+      *done = 0;                                                              \
+      return u7_errnof(ENOSPC, #fn_name ": no space left");                   \
+    }                                                                         \
+    if (__BYTE_ORDER__ == __ORDER_BIG_ENDIAN__) {                             \
+      for (size_t i = 0; i < count; ++i) {                                    \
+        uint_type bits;                                                       \
+        memcpy(&bits, &values[i], sizeof(bits));                              \
+        bits = bswap(bits);                                                   \
+        memcpy(output->cursor + i * sizeof(type), &bits, sizeof(bits));       \
+      }                                                                       \
+    } else {                                                                  \
+      memcpy(output->cursor, values, count * sizeof(type));                   \
+    }                                                                         \
+    output->cursor += count * sizeof(type);                                   \
+    *done = count;                                                            \
+    return u7_ok();                                                           \
+  }
+
+U7_VM0_DEFINE_MEMORY_WRITE_N(write_i32_n, int32_t, uint32_t, __builtin_bswap32)
+U7_VM0_DEFINE_MEMORY_WRITE_N(write_i64_n, int64_t, uint64_t, __builtin_bswap64)
+U7_VM0_DEFINE_MEMORY_WRITE_N(write_f32_n, float, uint32_t, __builtin_bswap32)
+U7_VM0_DEFINE_MEMORY_WRITE_N(write_f64_n, double, uint64_t, __builtin_bswap64)
+
+void u7_vm0_memory_output_init(struct u7_vm0_memory_output* self, void* data,
+                               size_t capacity) {
+  self->base.write_i32_fn = &write_i32;
+  self->base.write_i64_fn = &write_i64;
+  self->base.write_f32_fn = &write_f32;
+  self->base.write_f64_fn = &write_f64;
+  self->base.write_i32_n_fn = &write_i32_n;
+  self->base.write_i64_n_fn = &write_i64_n;
+  self->base.write_f32_n_fn = &write_f32_n;
+  self->base.write_f64_n_fn = &write_f64_n;
+  self->begin = (char*)data;
+  self->cursor = (char*)data;
+  self->end = (char*)data + capacity;
+  self->fd = -1;
+}
+
+u7_error u7_vm0_memory_output_init_file(struct u7_vm0_memory_output* self,
+                                        const char* path, size_t capacity) {
+  const int fd = open(path, O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+  if (fd < 0) {
+    return u7_errnof(errno, "u7_vm0_memory_output_init_file: open failed: %s",
+                     path);
+  }
+  void* mapping = NULL;
+  if (capacity > 0) {
+    if (ftruncate(fd, (off_t)capacity) != 0) {
+      const int error_code = errno;
+      close(fd);
+      return u7_errnof(error_code,
+                       "u7_vm0_memory_output_init_file: ftruncate failed: %s",
+                       path);
+    }
+    mapping = mmap(NULL, capacity, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (mapping == MAP_FAILED) {
+      const int error_code = errno;
+      close(fd);
+      return u7_errnof(error_code,
+                       "u7_vm0_memory_output_init_file: mmap failed: %s",
+                       path);
+    }
+  }
+  u7_vm0_memory_output_init(self, mapping, capacity);
+  self->fd = fd;
+  return u7_ok();
+}
+
+u7_error u7_vm0_memory_output_destroy(struct u7_vm0_memory_output* self) {
+  if (self->fd < 0) {
+    return u7_ok();
+  }
+  u7_error error = u7_ok();
+  const size_t size = (size_t)(self->cursor - self->begin);
+  if (self->begin != NULL) {
+    munmap(self->begin, (size_t)(self->end - self->begin));
+  }
+  if (ftruncate(self->fd, (off_t)size) != 0) {
+    error =
+        u7_errnof(errno, "u7_vm0_memory_output_destroy: ftruncate failed");
+  }
+  if (close(self->fd) != 0 && error.error_code == 0) {
+    error = u7_errnof(errno, "u7_vm0_memory_output_destroy: close failed");
+  }
+  self->fd = -1;
+  return error;
+}
@@ -0,0 +1,1402 @@
+#include "@/public/optimize.h"
+
+#include "@/public/opcode.h"
+#include "@/public/verify.h"
+
+#include <errno.h>
+#include <github.com/apronchenkov/error/public/error.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+enum u7_vm0_optimize_type {
+  U7_VM0_OPTIMIZE_I32,
+  U7_VM0_OPTIMIZE_I64,
+  U7_VM0_OPTIMIZE_F32,
+  U7_VM0_OPTIMIZE_F64,
+};
+
+enum u7_vm0_optimize_operation {
+  U7_VM0_OPTIMIZE_AND,
+  U7_VM0_OPTIMIZE_LEFT_SHIFT,  // A negative rhs shifts to the right.
+  U7_VM0_OPTIMIZE_RIGHT_SHIFT,
+  U7_VM0_OPTIMIZE_ADD,
+  U7_VM0_OPTIMIZE_MULTIPLY,
+};
+
+// Variants of a binary operation; U7_VM0_OPCODE_UNKNOWN if there is none.
+struct u7_vm0_optimize_binary {
+  enum u7_vm0_optimize_operation operation;
+  enum u7_vm0_opcode vv;
+  enum u7_vm0_opcode vc;
+  enum u7_vm0_opcode cv;
+};
+
+#define U7_VM0_OPTIMIZE_BINARY(operation, vv, vc, cv)                   \
+  {U7_VM0_OPTIMIZE_##operation, U7_VM0_OPCODE_##vv, U7_VM0_OPCODE_##vc, \
+   U7_VM0_OPCODE_##cv}
+
+static const struct u7_vm0_optimize_binary u7_vm0_optimize_binaries[] = {
+    U7_VM0_OPTIMIZE_BINARY(AND, BITWISE_AND_I32VV, BITWISE_AND_I32VC, UNKNOWN),
+    U7_VM0_OPTIMIZE_BINARY(AND, BITWISE_AND_I64VV, BITWISE_AND_I64VC, UNKNOWN),
+    U7_VM0_OPTIMIZE_BINARY(LEFT_SHIFT, BITWISE_LEFT_SHIFT_I32VV,
+                           BITWISE_LEFT_SHIFT_I32VC, BITWISE_LEFT_SHIFT_I32CV),
+    U7_VM0_OPTIMIZE_BINARY(LEFT_SHIFT, BITWISE_LEFT_SHIFT_I64VV,
+                           BITWISE_LEFT_SHIFT_I64VC, BITWISE_LEFT_SHIFT_I64CV),
+    U7_VM0_OPTIMIZE_BINARY(RIGHT_SHIFT, UNKNOWN, BITWISE_RIGHT_SHIFT_I32VC,
+                           UNKNOWN),
+    U7_VM0_OPTIMIZE_BINARY(RIGHT_SHIFT, UNKNOWN, BITWISE_RIGHT_SHIFT_I64VC,
+                           UNKNOWN),
+    U7_VM0_OPTIMIZE_BINARY(ADD, MATH_ADD_I32VV, MATH_ADD_I32VC, UNKNOWN),
+    U7_VM0_OPTIMIZE_BINARY(ADD, MATH_ADD_I64VV, MATH_ADD_I64VC, UNKNOWN),
+    U7_VM0_OPTIMIZE_BINARY(ADD, MATH_ADD_F32VV, MATH_ADD_F32VC, UNKNOWN),
+    U7_VM0_OPTIMIZE_BINARY(ADD, MATH_ADD_F64VV, MATH_ADD_F64VC, UNKNOWN),
+    U7_VM0_OPTIMIZE_BINARY(MULTIPLY, MATH_MULTIPLY_I32VV, MATH_MULTIPLY_I32VC,
+                           UNKNOWN),
+    U7_VM0_OPTIMIZE_BINARY(MULTIPLY, MATH_MULTIPLY_I64VV, MATH_MULTIPLY_I64VC,
+                           UNKNOWN),
+    U7_VM0_OPTIMIZE_BINARY(MULTIPLY, MATH_MULTIPLY_F32VV, MATH_MULTIPLY_F32VC,
+                           UNKNOWN),
+    U7_VM0_OPTIMIZE_BINARY(MULTIPLY, MATH_MULTIPLY_F64VV, MATH_MULTIPLY_F64VC,
+                           UNKNOWN),
+};
+
+#undef U7_VM0_OPTIMIZE_BINARY
+
+enum u7_vm0_optimize_condition {
+  U7_VM0_OPTIMIZE_EQUAL,
+  U7_VM0_OPTIMIZE_NOT_EQUAL,
+  U7_VM0_OPTIMIZE_LESS,
+  U7_VM0_OPTIMIZE_LESS_OR_EQUAL,
+  U7_VM0_OPTIMIZE_GREATER,
+  U7_VM0_OPTIMIZE_GREATER_OR_EQUAL,
+};
+
+// Variants of a compare-and-branch, checked and unchecked;
+// U7_VM0_OPCODE_UNKNOWN if there is none.
+struct u7_vm0_optimize_compare {
+  enum u7_vm0_optimize_condition condition;
+  enum u7_vm0_opcode vv;
+  enum u7_vm0_opcode vc;
+  enum u7_vm0_opcode vv_unchecked;
+  enum u7_vm0_opcode vc_unchecked;
+};
+
+#define U7_VM0_OPTIMIZE_COMPARE(condition, type)             \
+  {U7_VM0_OPTIMIZE_##condition,                              \
+   U7_VM0_OPCODE_JUMP_IF_##condition##_##type##VV,           \
+   U7_VM0_OPCODE_JUMP_IF_##condition##_##type##VC,           \
+   U7_VM0_OPCODE_JUMP_IF_##condition##_##type##VV_UNCHECKED, \
+   U7_VM0_OPCODE_JUMP_IF_##condition##_##type##VC_UNCHECKED}
+
+// `a > b` and `a >= b` have no `*vv` variants; see u7_vm0_jump_if_greater().
+#define U7_VM0_OPTIMIZE_COMPARE_VC(condition, type)          \
+  {U7_VM0_OPTIMIZE_##condition, U7_VM0_OPCODE_UNKNOWN,       \
+   U7_VM0_OPCODE_JUMP_IF_##condition##_##type##VC,           \
+   U7_VM0_OPCODE_UNKNOWN,                                    \
+   U7_VM0_OPCODE_JUMP_IF_##condition##_##type##VC_UNCHECKED}
+
+static const struct u7_vm0_optimize_compare u7_vm0_optimize_compares[] = {
+    U7_VM0_OPTIMIZE_COMPARE(EQUAL, I32),
+    U7_VM0_OPTIMIZE_COMPARE(EQUAL, I64),
+    U7_VM0_OPTIMIZE_COMPARE(EQUAL, F32),
+    U7_VM0_OPTIMIZE_COMPARE(EQUAL, F64),
+    U7_VM0_OPTIMIZE_COMPARE(NOT_EQUAL, I32),
+    U7_VM0_OPTIMIZE_COMPARE(NOT_EQUAL, I64),
+    U7_VM0_OPTIMIZE_COMPARE(NOT_EQUAL, F32),
+    U7_VM0_OPTIMIZE_COMPARE(NOT_EQUAL, F64),
+    U7_VM0_OPTIMIZE_COMPARE(LESS, I32),
+    U7_VM0_OPTIMIZE_COMPARE(LESS, I64),
+    U7_VM0_OPTIMIZE_COMPARE(LESS, F32),
+    U7_VM0_OPTIMIZE_COMPARE(LESS, F64),
+    U7_VM0_OPTIMIZE_COMPARE(LESS_OR_EQUAL, I32),
+    U7_VM0_OPTIMIZE_COMPARE(LESS_OR_EQUAL, I64),
+    U7_VM0_OPTIMIZE_COMPARE(LESS_OR_EQUAL, F32),
+    U7_VM0_OPTIMIZE_COMPARE(LESS_OR_EQUAL, F64),
+    U7_VM0_OPTIMIZE_COMPARE_VC(GREATER, I32),
+    U7_VM0_OPTIMIZE_COMPARE_VC(GREATER, I64),
+    U7_VM0_OPTIMIZE_COMPARE_VC(GREATER, F32),
+    U7_VM0_OPTIMIZE_COMPARE_VC(GREATER, F64),
+    U7_VM0_OPTIMIZE_COMPARE_VC(GREATER_OR_EQUAL, I32),
+    U7_VM0_OPTIMIZE_COMPARE_VC(GREATER_OR_EQUAL, I64),
+    U7_VM0_OPTIMIZE_COMPARE_VC(GREATER_OR_EQUAL, F32),
+    U7_VM0_OPTIMIZE_COMPARE_VC(GREATER_OR_EQUAL, F64),
+};
+
+#undef U7_VM0_OPTIMIZE_COMPARE_VC
+#undef U7_VM0_OPTIMIZE_COMPARE
+
+static const enum u7_vm0_opcode u7_vm0_optimize_copy_c[] = {
+    U7_VM0_OPCODE_COPY_I32C,
+    U7_VM0_OPCODE_COPY_I64C,
+    U7_VM0_OPCODE_COPY_F32C,
+    U7_VM0_OPCODE_COPY_F64C,
+};
+
+static const enum u7_vm0_opcode u7_vm0_optimize_copy_v[] = {
+    U7_VM0_OPCODE_COPY_I32V,
+    U7_VM0_OPCODE_COPY_I64V,
+    U7_VM0_OPCODE_COPY_F32V,
+    U7_VM0_OPCODE_COPY_F64V,
+};
+
+static const enum u7_vm0_opcode u7_vm0_optimize_output_c[] = {
+    U7_VM0_OPCODE_OUTPUT_I32C,
+    U7_VM0_OPCODE_OUTPUT_I64C,
+    U7_VM0_OPCODE_OUTPUT_F32C,
+    U7_VM0_OPCODE_OUTPUT_F64C,
+};
+
+// A range of bytes of the locals frame.
+struct u7_vm0_optimize_range {
+  int64_t offset;
+  int64_t size;
+};
+
+struct u7_vm0_optimize_accesses {
+  struct u7_vm0_optimize_range reads[4];
+  struct u7_vm0_optimize_range writes[2];
+  int reads_size;
+  int writes_size;
+};
+
+// Values of the variables at a point of the program; a variable is tracked
+// as the raw bits of its bytes.
+struct u7_vm0_optimize_facts {
+  bool* known;     // [slots_size]
+  uint64_t* bits;  // [slots_size]
+};
+
+struct u7_vm0_optimizer {
+  struct u7_vm0_instruction* instructions;
+  enum u7_vm0_opcode* opcodes;
+  size_t instructions_size;
+  size_t locals_size;
+  // Distinct scalar variables, ordered by (offset, size).
+  struct u7_vm0_optimize_range* slots;
+  size_t slots_size;
+  // Basic blocks: [blocks[b], blocks[b + 1]).
+  size_t* blocks;
+  size_t blocks_size;
+  size_t* block_of;
+  bool* reachable;  // [blocks_size]
+  bool* removed;    // [instructions_size]
+  // Facts at the beginning of each reachable block.
+  struct u7_vm0_optimize_facts entries;
+  struct u7_vm0_optimize_facts current;
+  // Liveness of the bytes at the beginning of each block.
+  uint64_t* live_in;  // [blocks_size * live_words]
+  uint64_t* live;     // [live_words]
+  size_t live_words;
+  size_t* worklist;
+  bool* queued;
+};
+
+static enum u7_vm0_optimize_type u7_vm0_optimize_type_of(
+    enum u7_vm0_operand_kind kind) {
+  switch (kind) {
+    case U7_VM0_OPERAND_I32_CONSTANT:
+    case U7_VM0_OPERAND_I32_SRC:
+    case U7_VM0_OPERAND_I32_DST:
+      return U7_VM0_OPTIMIZE_I32;
+    case U7_VM0_OPERAND_I64_CONSTANT:
+    case U7_VM0_OPERAND_I64_SRC:
+    case U7_VM0_OPERAND_I64_DST:
+      return U7_VM0_OPTIMIZE_I64;
+    case U7_VM0_OPERAND_F32_CONSTANT:
+    case U7_VM0_OPERAND_F32_SRC:
+    case U7_VM0_OPERAND_F32_DST:
+      return U7_VM0_OPTIMIZE_F32;
+    default:
+      return U7_VM0_OPTIMIZE_F64;
+  }
+}
+
+static bool u7_vm0_optimize_is_scalar(enum u7_vm0_operand_kind kind) {
+  return kind >= U7_VM0_OPERAND_I32_SRC && kind <= U7_VM0_OPERAND_F64_DST;
+}
+
+static bool u7_vm0_optimize_is_written(enum u7_vm0_operand_kind kind) {
+  return (kind >= U7_VM0_OPERAND_I32_DST && kind <= U7_VM0_OPERAND_F64_DST) ||
+         (kind >= U7_VM0_OPERAND_I32_DST_ARRAY &&
+          kind <= U7_VM0_OPERAND_F64_DST_SRC_ARRAY);
+}
+
+static uint64_t u7_vm0_optimize_constant_bits(enum u7_vm0_operand_kind kind,
+                                              union u7_vm0_value value) {
+  switch (u7_vm0_optimize_type_of(kind)) {
+    case U7_VM0_OPTIMIZE_I32:
+      return (uint32_t)value.i32;
+    case U7_VM0_OPTIMIZE_F32: {
+      uint32_t bits;
+      memcpy(&bits, &value.f32, sizeof(bits));
+      return bits;
+    }
+    default:
+      return (uint64_t)value.i64;
+  }
+}
+
+static union u7_vm0_value u7_vm0_optimize_constant(
+    enum u7_vm0_optimize_type type, uint64_t bits) {
+  union u7_vm0_value result = {.i64 = 0};
+  switch (type) {
+    case U7_VM0_OPTIMIZE_I32:
+      result.i64 = (int32_t)(uint32_t)bits;
+      break;
+    case U7_VM0_OPTIMIZE_F32: {
+      const uint32_t f32_bits = (uint32_t)bits;
+      memcpy(&result.f32, &f32_bits, sizeof(f32_bits));
+      break;
+    }
+    default:
+      result.i64 = (int64_t)bits;
+      break;
+  }
+  return result;
+}
+
+static bool u7_vm0_optimize_is_zero(enum u7_vm0_optimize_type type,
+                                    uint64_t bits) {
+  const union u7_vm0_value value = u7_vm0_optimize_constant(type, bits);
+  switch (type) {
+    case U7_VM0_OPTIMIZE_F32:
+      return value.f32 == 0;
+    case U7_VM0_OPTIMIZE_F64:
+      return value.f64 == 0;
+    default:
+      return bits == 0;
+  }
+}
+
+static struct u7_vm0_instruction u7_vm0_optimize_make(
+    enum u7_vm0_opcode opcode, union u7_vm0_value arg1,
+    union u7_vm0_value arg2, union u7_vm0_value arg3) {
+  struct u7_vm0_instruction result = {
+      .base = u7_vm0_opcode_info(opcode)->base,
+      .arg1 = arg1,
+      .arg2 = arg2,
+      .arg3 = arg3,
+  };
+  return result;
+}
+
+static void u7_vm0_optimize_replace(struct u7_vm0_optimizer* self, size_t i,
+                                    enum u7_vm0_opcode opcode,
+                                    union u7_vm0_value arg1,
+                                    union u7_vm0_value arg2,
+                                    union u7_vm0_value arg3) {
+  self->instructions[i] = u7_vm0_optimize_make(opcode, arg1, arg2, arg3);
+  self->opcodes[i] = opcode;
+}
+
+static struct u7_vm0_optimize_binary const* u7_vm0_optimize_find_binary(
+    enum u7_vm0_opcode opcode) {
+  const size_t n =
+      sizeof(u7_vm0_optimize_binaries) / sizeof(u7_vm0_optimize_binaries[0]);
+  for (size_t i = 0; i < n; ++i) {
+    struct u7_vm0_optimize_binary const* binary = &u7_vm0_optimize_binaries[i];
+    if (opcode == binary->vv || opcode == binary->vc || opcode == binary->cv) {
+      return binary;
+    }
+  }
+  return NULL;
+}
+
+static struct u7_vm0_optimize_compare const* u7_vm0_optimize_find_compare(
+    enum u7_vm0_opcode opcode) {
+  const size_t n =
+      sizeof(u7_vm0_optimize_compares) / sizeof(u7_vm0_optimize_compares[0]);
+  for (size_t i = 0; i < n; ++i) {
+    struct u7_vm0_optimize_compare const* compare =
+        &u7_vm0_optimize_compares[i];
+    if (opcode != U7_VM0_OPCODE_UNKNOWN &&
+        (opcode == compare->vv || opcode == compare->vc ||
+         opcode == compare->vv_unchecked || opcode == compare->vc_unchecked)) {
+      return compare;
+    }
+  }
+  return NULL;
+}
+
+// Returns the variants of the condition with the operands swapped, e.g.
+// `a < b` for `b > a`, for the same type as `compare`.
+static struct u7_vm0_optimize_compare const* u7_vm0_optimize_swap_compare(
+    struct u7_vm0_optimize_compare const* compare) {
+  static const enum u7_vm0_optimize_condition swapped[] = {
+      U7_VM0_OPTIMIZE_EQUAL,   U7_VM0_OPTIMIZE_NOT_EQUAL,
+      U7_VM0_OPTIMIZE_GREATER, U7_VM0_OPTIMIZE_GREATER_OR_EQUAL,
+      U7_VM0_OPTIMIZE_LESS,    U7_VM0_OPTIMIZE_LESS_OR_EQUAL,
+  };
+  const enum u7_vm0_operand_kind kind =
+      u7_vm0_opcode_info(compare->vc)->operand_kinds[0];
+  const size_t n =
+      sizeof(u7_vm0_optimize_compares) / sizeof(u7_vm0_optimize_compares[0]);
+  for (size_t i = 0; i < n; ++i) {
+    struct u7_vm0_optimize_compare const* result =
+        &u7_vm0_optimize_compares[i];
+    if (result->condition == swapped[compare->condition] &&
+        u7_vm0_opcode_info(result->vc)->operand_kinds[0] == kind) {
+      return result;
+    }
+  }
+  return NULL;
+}
+
+static bool u7_vm0_optimize_evaluate_compare(
+    enum u7_vm0_optimize_condition condition, enum u7_vm0_optimize_type type,
+    uint64_t lhs_bits, uint64_t rhs_bits) {
+  const union u7_vm0_value lhs = u7_vm0_optimize_constant(type, lhs_bits);
+  const union u7_vm0_value rhs = u7_vm0_optimize_constant(type, rhs_bits);
+  bool less, equal, greater;  // All false if a NaN is compared.
+  switch (type) {
+    case U7_VM0_OPTIMIZE_F32:
+      less = lhs.f32 < rhs.f32;
+      equal = lhs.f32 == rhs.f32;
+      greater = lhs.f32 > rhs.f32;
+      break;
+    case U7_VM0_OPTIMIZE_F64:
+      less = lhs.f64 < rhs.f64;
+      equal = lhs.f64 == rhs.f64;
+      greater = lhs.f64 > rhs.f64;
+      break;
+    default:
+      less = lhs.i64 < rhs.i64;
+      equal = lhs.i64 == rhs.i64;
+      greater = lhs.i64 > rhs.i64;
+      break;
+  }
+  switch (condition) {
+    case U7_VM0_OPTIMIZE_EQUAL:
+      return equal;
+    case U7_VM0_OPTIMIZE_NOT_EQUAL:
+      return !equal;
+    case U7_VM0_OPTIMIZE_LESS:
+      return less;
+    case U7_VM0_OPTIMIZE_LESS_OR_EQUAL:
+      return less || equal;
+    case U7_VM0_OPTIMIZE_GREATER:
+      return greater;
+    default:
+      return greater || equal;
+  }
+}
+
+// Returns the index of the label operand, or -1.
+static int u7_vm0_optimize_label(struct u7_vm0_opcode_info const* info) {
+  for (int j = 0; j < 3; ++j) {
+    if (info->operand_kinds[j] == U7_VM0_OPERAND_LABEL) {
+      return j;
+    }
+  }
+  return -1;
+}
+
+// Returns the label of instruction i, or -1 if it has none.
+static int64_t u7_vm0_optimize_target(struct u7_vm0_optimizer const* self,
+                                      size_t i) {
+  const int label =
+      u7_vm0_optimize_label(u7_vm0_opcode_info(self->opcodes[i]));
+  const union u7_vm0_value args[3] = {
+      self->instructions[i].arg1,
+      self->instructions[i].arg2,
+      self->instructions[i].arg3,
+  };
+  return (label >= 0 ? args[label].i64 : -1);
+}
+
+// Returns the entry of a jump table chosen by a known index, or the count
+// for the default label.
+static int64_t u7_vm0_optimize_table_entry(enum u7_vm0_operand_kind kind,
+                                           uint64_t bits, int64_t count) {
+  const int64_t index =
+      u7_vm0_optimize_constant(u7_vm0_optimize_type_of(kind), bits).i64;
+  return (index >= 0 && index < count ? index : count);
+}
+
+// Returns true for `jump_if_[not_]zero`; *if_zero tells which one.
+static bool u7_vm0_optimize_is_jump(enum u7_vm0_opcode opcode, bool* if_zero) {
+  switch (opcode) {
+    case U7_VM0_OPCODE_JUMP_IF_ZERO_I32:
+    case U7_VM0_OPCODE_JUMP_IF_ZERO_I64:
+    case U7_VM0_OPCODE_JUMP_IF_ZERO_F32:
+    case U7_VM0_OPCODE_JUMP_IF_ZERO_F64:
+    case U7_VM0_OPCODE_JUMP_IF_ZERO_I32_UNCHECKED:
+    case U7_VM0_OPCODE_JUMP_IF_ZERO_I64_UNCHECKED:
+    case U7_VM0_OPCODE_JUMP_IF_ZERO_F32_UNCHECKED:
+    case U7_VM0_OPCODE_JUMP_IF_ZERO_F64_UNCHECKED:
+      *if_zero = true;
+      return true;
+    case U7_VM0_OPCODE_JUMP_IF_NOT_ZERO_I32:
+    case U7_VM0_OPCODE_JUMP_IF_NOT_ZERO_I64:
+    case U7_VM0_OPCODE_JUMP_IF_NOT_ZERO_F32:
+    case U7_VM0_OPCODE_JUMP_IF_NOT_ZERO_F64:
+    case U7_VM0_OPCODE_JUMP_IF_NOT_ZERO_I32_UNCHECKED:
+    case U7_VM0_OPCODE_JUMP_IF_NOT_ZERO_I64_UNCHECKED:
+    case U7_VM0_OPCODE_JUMP_IF_NOT_ZERO_F32_UNCHECKED:
+    case U7_VM0_OPCODE_JUMP_IF_NOT_ZERO_F64_UNCHECKED:
+      *if_zero = false;
+      return true;
+    default:
+      return false;
+  }
+}
+
+// Returns true if the instruction cannot fail, block, or jump, so it can be
+// removed when its results are not used.
+static bool u7_vm0_optimize_is_pure(enum u7_vm0_opcode opcode) {
+  switch (opcode) {
+    case U7_VM0_OPCODE_COPY_I32C:
+    case U7_VM0_OPCODE_COPY_I64C:
+    case U7_VM0_OPCODE_COPY_F32C:
+    case U7_VM0_OPCODE_COPY_F64C:
+    case U7_VM0_OPCODE_COPY_I32V:
+    case U7_VM0_OPCODE_COPY_I64V:
+    case U7_VM0_OPCODE_COPY_F32V:
+    case U7_VM0_OPCODE_COPY_F64V:
+    case U7_VM0_OPCODE_BITWISE_AND_I32VC:
+    case U7_VM0_OPCODE_BITWISE_AND_I64VC:
+    case U7_VM0_OPCODE_BITWISE_AND_I32VV:
+    case U7_VM0_OPCODE_BITWISE_AND_I64VV:
+    case U7_VM0_OPCODE_BITWISE_LEFT_SHIFT_I32VC:
+    case U7_VM0_OPCODE_BITWISE_RIGHT_SHIFT_I32VC:
+    case U7_VM0_OPCODE_BITWISE_LEFT_SHIFT_I64VC:
+    case U7_VM0_OPCODE_BITWISE_RIGHT_SHIFT_I64VC:
+    case U7_VM0_OPCODE_MATH_ADD_F32VC:
+    case U7_VM0_OPCODE_MATH_ADD_F32VV:
+    case U7_VM0_OPCODE_MATH_ADD_F64VC:
+    case U7_VM0_OPCODE_MATH_ADD_F64VV:
+    case U7_VM0_OPCODE_MATH_MULTIPLY_F32VC:
+    case U7_VM0_OPCODE_MATH_MULTIPLY_F32VV:
+    case U7_VM0_OPCODE_MATH_MULTIPLY_F64VC:
+    case U7_VM0_OPCODE_MATH_MULTIPLY_F64VV:
+    case U7_VM0_OPCODE_MATH_ADD_2_F64VV:
+    case U7_VM0_OPCODE_MATH_MULTIPLY_2_F64VV:
+    case U7_VM0_OPCODE_MATH_MULTIPLY_ADD_F64VVV:
+    case U7_VM0_OPCODE_VECTOR_ADD_F32:
+    case U7_VM0_OPCODE_VECTOR_ADD_F64:
+    case U7_VM0_OPCODE_VECTOR_MULTIPLY_F32:
+    case U7_VM0_OPCODE_VECTOR_MULTIPLY_F64:
+    case U7_VM0_OPCODE_VECTOR_MULTIPLY_ADD_F32:
+    case U7_VM0_OPCODE_VECTOR_MULTIPLY_ADD_F64:
+    case U7_VM0_OPCODE_VECTOR_DOT_F32:
+    case U7_VM0_OPCODE_VECTOR_DOT_F64:
+    case U7_VM0_OPCODE_VECTOR_SUM_F32:
+    case U7_VM0_OPCODE_VECTOR_SUM_F64:
+    case U7_VM0_OPCODE_VECTOR_BROADCAST_F32:
+    case U7_VM0_OPCODE_VECTOR_BROADCAST_F64:
+    case U7_VM0_OPCODE_MATRIX_MULTIPLY_2X2_F64:
+    case U7_VM0_OPCODE_MATRIX_MULTIPLY_3X3_F64:
+    case U7_VM0_OPCODE_MATRIX_MULTIPLY_4X4_F64:
+      return true;
+    default:
+      return false;
+  }
+}
+
+static void u7_vm0_optimize_accesses(
+    struct u7_vm0_instruction const* instruction,
+    struct u7_vm0_opcode_info const* info,
+    struct u7_vm0_optimize_accesses* result) {
+  const union u7_vm0_value args[3] = {
+      instruction->arg1,
+      instruction->arg2,
+      instruction->arg3,
+  };
+  result->reads_size = 0;
+  result->writes_size = 0;
+  for (int j = 0; j < 3; ++j) {
+    const enum u7_vm0_operand_kind kind = info->operand_kinds[j];
+    const int64_t size = u7_vm0_operand_kind_variable_size(kind);
+    if (size == 0) {
+      continue;
+    }
+    if (u7_vm0_operand_kind_is_pair(kind)) {
+      const struct u7_vm0_optimize_range first = {
+          u7_vm0_operand_pair_first(args[j].i64), size};
+      const struct u7_vm0_optimize_range second = {
+          u7_vm0_operand_pair_second(args[j].i64), size};
+      if (kind == U7_VM0_OPERAND_F64_SRC_PAIR) {
+        result->reads[result->reads_size++] = first;
+      } else {
+        result->writes[result->writes_size++] = first;
+      }
+      if (kind == U7_VM0_OPERAND_F64_DST_PAIR) {
+        result->writes[result->writes_size++] = second;
+      } else {
+        result->reads[result->reads_size++] = second;
+      }
+      continue;
+    }
+    if (u7_vm0_operand_kind_is_array_pair(kind)) {
+      const int64_t count = args[u7_vm0_opcode_info_count_index(info)].i64;
+      result->reads[result->reads_size++] = (struct u7_vm0_optimize_range){
+          u7_vm0_operand_pair_first(args[j].i64), size * count};
+      result->reads[result->reads_size++] = (struct u7_vm0_optimize_range){
+          u7_vm0_operand_pair_second(args[j].i64), size * count};
+      continue;
+    }
+    const struct u7_vm0_optimize_range range = {
+        args[j].i64,
+        (u7_vm0_operand_kind_is_array(kind) ? size * args[j + 1].i64 : size)};
+    if (u7_vm0_optimize_is_written(kind)) {
+      result->writes[result->writes_size++] = range;
+    }
+    if (!u7_vm0_optimize_is_written(kind) ||
+        kind == U7_VM0_OPERAND_F32_DST_SRC_ARRAY ||
+        kind == U7_VM0_OPERAND_F64_DST_SRC_ARRAY) {
+      result->reads[result->reads_size++] = range;
+    }
+  }
+}
+
+static bool u7_vm0_optimize_range_less(struct u7_vm0_optimize_range a,
+                                       struct u7_vm0_optimize_range b) {
+  return a.offset < b.offset || (a.offset == b.offset && a.size < b.size);
+}
+
+static int u7_vm0_optimize_range_compare(void const* a, void const* b) {
+  struct u7_vm0_optimize_range const* lhs = a;
+  struct u7_vm0_optimize_range const* rhs = b;
+  return (u7_vm0_optimize_range_less(*rhs, *lhs) -
+          u7_vm0_optimize_range_less(*lhs, *rhs));
+}
+
+// Returns the index of the scalar variable, or SIZE_MAX.
+static size_t u7_vm0_optimize_slot(struct u7_vm0_optimizer const* self,
+                                   int64_t offset, int64_t size) {
+  const struct u7_vm0_optimize_range key = {offset, size};
+  size_t begin = 0;
+  size_t end = self->slots_size;
+  while (begin < end) {
+    const size_t middle = begin + (end - begin) / 2;
+    if (u7_vm0_optimize_range_less(self->slots[middle], key)) {
+      begin = middle + 1;
+    } else {
+      end = middle;
+    }
+  }
+  if (begin < self->slots_size && self->slots[begin].offset == offset &&
+      self->slots[begin].size == size) {
+    return begin;
+  }
+  return SIZE_MAX;
+}
+
+// Returns true if the value of the operand is known.
+static bool u7_vm0_optimize_operand(
+    struct u7_vm0_optimizer const* self,
+    struct u7_vm0_instruction const* instruction,
+    struct u7_vm0_opcode_info const* info, int j, uint64_t* result) {
+  const enum u7_vm0_operand_kind kind = info->operand_kinds[j];
+  const union u7_vm0_value arg =
+      (j == 0 ? instruction->arg1
+              : (j == 1 ? instruction->arg2 : instruction->arg3));
+  if (kind >= U7_VM0_OPERAND_I32_CONSTANT &&
+      kind <= U7_VM0_OPERAND_F64_CONSTANT) {
+    *result = u7_vm0_optimize_constant_bits(kind, arg);
+    return true;
+  }
+  if (!u7_vm0_optimize_is_scalar(kind)) {
+    return false;
+  }
+  const size_t slot = u7_vm0_optimize_slot(
+      self, arg.i64, u7_vm0_operand_kind_variable_size(kind));
+  if (slot == SIZE_MAX || !self->current.known[slot]) {
+    return false;
+  }
+  *result = self->current.bits[slot];
+  return true;
+}
+
+// Returns true if the outcome of the conditional jump at i follows from the
+// current facts; *taken receives it.
+static bool u7_vm0_optimize_branch(struct u7_vm0_optimizer const* self,
+                                   size_t i, bool* taken) {
+  struct u7_vm0_instruction const* instruction = &self->instructions[i];
+  const enum u7_vm0_opcode opcode = self->opcodes[i];
+  struct u7_vm0_opcode_info const* info = u7_vm0_opcode_info(opcode);
+  const enum u7_vm0_optimize_type type =
+      u7_vm0_optimize_type_of(info->operand_kinds[0]);
+  uint64_t lhs, rhs;
+  bool if_zero;
+  if (u7_vm0_optimize_is_jump(opcode, &if_zero)) {
+    if (!u7_vm0_optimize_operand(self, instruction, info, 0, &lhs)) {
+      return false;
+    }
+    *taken = (u7_vm0_optimize_is_zero(type, lhs) == if_zero);
+    return true;
+  }
+  struct u7_vm0_optimize_compare const* compare =
+      u7_vm0_optimize_find_compare(opcode);
+  if (compare == NULL ||
+      !u7_vm0_optimize_operand(self, instruction, info, 0, &lhs) ||
+      !u7_vm0_optimize_operand(self, instruction, info, 1, &rhs)) {
+    return false;
+  }
+  *taken =
+      u7_vm0_optimize_evaluate_compare(compare->condition, type, lhs, rhs);
+  return true;
+}
+
+static bool u7_vm0_optimize_evaluate(enum u7_vm0_optimize_operation operation,
+                                     enum u7_vm0_optimize_type type,
+                                     uint64_t lhs_bits, uint64_t rhs_bits,
+                                     uint64_t* result) {
+  const union u7_vm0_value lhs = u7_vm0_optimize_constant(type, lhs_bits);
+  const union u7_vm0_value rhs = u7_vm0_optimize_constant(type, rhs_bits);
+  union u7_vm0_value value = {.i64 = 0};
+  switch (type) {
+    case U7_VM0_OPTIMIZE_I32:
+      switch (operation) {
+        case U7_VM0_OPTIMIZE_AND:
+          value.i32 = lhs.i32 & rhs.i32;
+          break;
+        case U7_VM0_OPTIMIZE_LEFT_SHIFT:
+          if (rhs.i32 < -31 || rhs.i32 > 31) {
+            return false;
+          }
+          value.i32 = (rhs.i32 < 0 ? (lhs.i32 >> -rhs.i32)
+                                   : (int32_t)((uint32_t)lhs.i32 << rhs.i32));
+          break;
+        case U7_VM0_OPTIMIZE_RIGHT_SHIFT:
+          if (rhs.i32 < 0 || rhs.i32 > 31) {
+            return false;
+          }
+          value.i32 = lhs.i32 >> rhs.i32;
+          break;
+        case U7_VM0_OPTIMIZE_ADD:
+          if (__builtin_add_overflow(lhs.i32, rhs.i32, &value.i32)) {
+            return false;
+          }
+          break;
+        case U7_VM0_OPTIMIZE_MULTIPLY:
+          if (__builtin_mul_overflow(lhs.i32, rhs.i32, &value.i32)) {
+            return false;
+          }
+          break;
+      }
+      *result = (uint32_t)value.i32;
+      return true;
+    case U7_VM0_OPTIMIZE_I64:
+      switch (operation) {
+        case U7_VM0_OPTIMIZE_AND:
+          value.i64 = lhs.i64 & rhs.i64;
+          break;
+        case U7_VM0_OPTIMIZE_LEFT_SHIFT:
+          if (rhs.i64 < -63 || rhs.i64 > 63) {
+            return false;
+          }
+          value.i64 = (rhs.i64 < 0 ? (lhs.i64 >> -rhs.i64)
+                                   : (int64_t)((uint64_t)lhs.i64 << rhs.i64));
+          break;
+        case U7_VM0_OPTIMIZE_RIGHT_SHIFT:
+          if (rhs.i64 < 0 || rhs.i64 > 63) {
+            return false;
+          }
+          value.i64 = lhs.i64 >> rhs.i64;
+          break;
+        case U7_VM0_OPTIMIZE_ADD:
+          if (__builtin_add_overflow(lhs.i64, rhs.i64, &value.i64)) {
+            return false;
+          }
+          break;
+        case U7_VM0_OPTIMIZE_MULTIPLY:
+          if (__builtin_mul_overflow(lhs.i64, rhs.i64, &value.i64)) {
+            return false;
+          }
+          break;
+      }
+      *result = (uint64_t)value.i64;
+      return true;
+    case U7_VM0_OPTIMIZE_F32:
+      if (operation == U7_VM0_OPTIMIZE_ADD) {
+        value.f32 = lhs.f32 + rhs.f32;
+      } else if (operation == U7_VM0_OPTIMIZE_MULTIPLY) {
+        value.f32 = lhs.f32 * rhs.f32;
+      } else {
+        return false;
+      }
+      *result = u7_vm0_optimize_constant_bits(U7_VM0_OPERAND_F32_CONSTANT,
+                                              value);
+      return true;
+    case U7_VM0_OPTIMIZE_F64:
+      if (operation == U7_VM0_OPTIMIZE_ADD) {
+        value.f64 = lhs.f64 + rhs.f64;
+      } else if (operation == U7_VM0_OPTIMIZE_MULTIPLY) {
+        value.f64 = lhs.f64 * rhs.f64;
+      } else {
+        return false;
+      }
+      *result = (uint64_t)value.i64;
+      return true;
+  }
+  return false;
+}
+
+// Replaces `dst = src op c` with a copy, if the result is trivial.
+static void u7_vm0_optimize_identity(
+    struct u7_vm0_optimizer* self, size_t i,
+    struct u7_vm0_optimize_binary const* binary,
+    enum u7_vm0_optimize_type type) {
+  struct u7_vm0_instruction const instruction = self->instructions[i];
+  if (self->opcodes[i] != binary->vc || type == U7_VM0_OPTIMIZE_F32 ||
+      type == U7_VM0_OPTIMIZE_F64) {
+    return;
+  }
+  const int64_t c = (type == U7_VM0_OPTIMIZE_I32 ? instruction.arg3.i32
+                                                 : instruction.arg3.i64);
+  const int64_t all_ones = -1;
+  const union u7_vm0_value none = {.i64 = 0};
+  if ((binary->operation == U7_VM0_OPTIMIZE_ADD && c == 0) ||
+      (binary->operation == U7_VM0_OPTIMIZE_MULTIPLY && c == 1) ||
+      (binary->operation == U7_VM0_OPTIMIZE_AND && c == all_ones)) {
+    u7_vm0_optimize_replace(self, i, u7_vm0_optimize_copy_v[type],
+                            instruction.arg1, instruction.arg2, none);
+  } else if ((binary->operation == U7_VM0_OPTIMIZE_MULTIPLY ||
+              binary->operation == U7_VM0_OPTIMIZE_AND) &&
+             c == 0) {
+    u7_vm0_optimize_replace(self, i, u7_vm0_optimize_copy_c[type],
+                            instruction.arg1, none, none);
+  }
+}
+
+// Rewrites a binary operation using the known values of its operands.
+static void u7_vm0_optimize_rewrite_binary(
+    struct u7_vm0_optimizer* self, size_t i,
+    struct u7_vm0_optimize_binary const* binary) {
+  struct u7_vm0_instruction const instruction = self->instructions[i];
+  const enum u7_vm0_opcode opcode = self->opcodes[i];
+  struct u7_vm0_opcode_info const* info = u7_vm0_opcode_info(opcode);
+  const enum u7_vm0_optimize_type type =
+      u7_vm0_optimize_type_of(info->operand_kinds[0]);
+  const union u7_vm0_value none = {.i64 = 0};
+  uint64_t lhs, rhs, value;
+  const bool lhs_known =
+      u7_vm0_optimize_operand(self, &instruction, info, 1, &lhs);
+  const bool rhs_known =
+      u7_vm0_optimize_operand(self, &instruction, info, 2, &rhs);
+  if (lhs_known && rhs_known) {
+    if (u7_vm0_optimize_evaluate(binary->operation, type, lhs, rhs, &value)) {
+      u7_vm0_optimize_replace(self, i, u7_vm0_optimize_copy_c[type],
+                              instruction.arg1,
+                              u7_vm0_optimize_constant(type, value), none);
+    }
+    return;
+  }
+  if (opcode != binary->vv) {
+    u7_vm0_optimize_identity(self, i, binary, type);
+    return;
+  }
+  if (rhs_known && binary->operation == U7_VM0_OPTIMIZE_LEFT_SHIFT) {
+    // The `*vc` shifts take a positive count and cannot fail.
+    const int64_t max = (type == U7_VM0_OPTIMIZE_I32 ? 31 : 63);
+    const int64_t count = u7_vm0_optimize_constant(type, rhs).i64;
+    if (count == 0) {
+      u7_vm0_optimize_replace(self, i, u7_vm0_optimize_copy_v[type],
+                              instruction.arg1, instruction.arg2, none);
+    } else if (count > 0 && count <= max) {
+      u7_vm0_optimize_replace(self, i, binary->vc, instruction.arg1,
+                              instruction.arg2,
+                              u7_vm0_optimize_constant(type, (uint64_t)count));
+    } else if (count < 0 && count >= -max) {
+      const enum u7_vm0_opcode right_shift =
+          (type == U7_VM0_OPTIMIZE_I32
+               ? U7_VM0_OPCODE_BITWISE_RIGHT_SHIFT_I32VC
+               : U7_VM0_OPCODE_BITWISE_RIGHT_SHIFT_I64VC);
+      u7_vm0_optimize_replace(
+          self, i, right_shift, instruction.arg1, instruction.arg2,
+          u7_vm0_optimize_constant(type, (uint64_t)-count));
+    }
+    return;
+  }
+  if (rhs_known) {
+    u7_vm0_optimize_replace(self, i, binary->vc, instruction.arg1,
+                            instruction.arg2,
+                            u7_vm0_optimize_constant(type, rhs));
+  } else if (lhs_known && binary->cv != U7_VM0_OPCODE_UNKNOWN) {
+    u7_vm0_optimize_replace(self, i, binary->cv, instruction.arg1,
+                            u7_vm0_optimize_constant(type, lhs),
+                            instruction.arg3);
+  } else if (lhs_known && binary->operation != U7_VM0_OPTIMIZE_LEFT_SHIFT) {
+    // The other operations are commutative.
+    u7_vm0_optimize_replace(self, i, binary->vc, instruction.arg1,
+                            instruction.arg3,
+                            u7_vm0_optimize_constant(type, lhs));
+  } else {
+    return;
+  }
+  u7_vm0_optimize_identity(self, i, binary, type);
+}
+
+// Compares a variable with a constant, if one of the two variables of a
+// compare-and-branch is known.
+static void u7_vm0_optimize_rewrite_compare(
+    struct u7_vm0_optimizer* self, size_t i,
+    struct u7_vm0_optimize_compare const* compare) {
+  struct u7_vm0_instruction const instruction = self->instructions[i];
+  const enum u7_vm0_opcode opcode = self->opcodes[i];
+  if (opcode != compare->vv && opcode != compare->vv_unchecked) {
+    return;
+  }
+  struct u7_vm0_opcode_info const* info = u7_vm0_opcode_info(opcode);
+  const enum u7_vm0_optimize_type type =
+      u7_vm0_optimize_type_of(info->operand_kinds[0]);
+  uint64_t value;
+  if (u7_vm0_optimize_operand(self, &instruction, info, 1, &value)) {
+    u7_vm0_optimize_replace(self, i, compare->vc, instruction.arg1,
+                            u7_vm0_optimize_constant(type, value),
+                            instruction.arg3);
+  } else if (u7_vm0_optimize_operand(self, &instruction, info, 0, &value)) {
+    u7_vm0_optimize_replace(self, i, u7_vm0_optimize_swap_compare(compare)->vc,
+                            instruction.arg2,
+                            u7_vm0_optimize_constant(type, value),
+                            instruction.arg3);
+  }
+}
+
+// Rewrites the instruction using the current facts.
+static void u7_vm0_optimize_rewrite(struct u7_vm0_optimizer* self, size_t i) {
+  struct u7_vm0_instruction const instruction = self->instructions[i];
+  const enum u7_vm0_opcode opcode = self->opcodes[i];
+  struct u7_vm0_opcode_info const* info = u7_vm0_opcode_info(opcode);
+  const union u7_vm0_value none = {.i64 = 0};
+  uint64_t value;
+  bool taken;
+  switch (opcode) {
+    case U7_VM0_OPCODE_COPY_I32V:
+    case U7_VM0_OPCODE_COPY_I64V:
+    case U7_VM0_OPCODE_COPY_F32V:
+    case U7_VM0_OPCODE_COPY_F64V:
+      if (u7_vm0_optimize_operand(self, &instruction, info, 1, &value)) {
+        const enum u7_vm0_optimize_type type =
+            u7_vm0_optimize_type_of(info->operand_kinds[0]);
+        u7_vm0_optimize_replace(self, i, u7_vm0_optimize_copy_c[type],
+                                instruction.arg1,
+                                u7_vm0_optimize_constant(type, value), none);
+      }
+      return;
+    case U7_VM0_OPCODE_OUTPUT_I32V:
+    case U7_VM0_OPCODE_OUTPUT_I64V:
+    case U7_VM0_OPCODE_OUTPUT_F32V:
+    case U7_VM0_OPCODE_OUTPUT_F64V:
+      if (u7_vm0_optimize_operand(self, &instruction, info, 0, &value)) {
+        const enum u7_vm0_optimize_type type =
+            u7_vm0_optimize_type_of(info->operand_kinds[0]);
+        u7_vm0_optimize_replace(self, i, u7_vm0_optimize_output_c[type],
+                                u7_vm0_optimize_constant(type, value), none,
+                                none);
+      }
+      return;
+    default:
+      break;
+  }
+  if (u7_vm0_optimize_branch(self, i, &taken)) {
+    // A jump that is never taken is removed; the one that is always taken
+    // becomes unconditional.
+    if (taken) {
+      const union u7_vm0_value label = {
+          .i64 = u7_vm0_optimize_target(self, i)};
+      u7_vm0_optimize_replace(self, i, U7_VM0_OPCODE_JUMP, label, none, none);
+    } else {
+      self->removed[i] = true;
+    }
+    return;
+  }
+  if (u7_vm0_opcode_is_jump_table(opcode)) {
+    // With a known index, the jump goes straight to the label of the entry.
+    if (u7_vm0_optimize_operand(self, &instruction, info, 0, &value)) {
+      const int64_t entry = u7_vm0_optimize_table_entry(
+          info->operand_kinds[0], value, instruction.arg2.i64);
+      u7_vm0_optimize_replace(
+          self, i, U7_VM0_OPCODE_JUMP,
+          (entry < instruction.arg2.i64
+               ? self->instructions[i + 1 + (size_t)entry].arg1
+               : instruction.arg3),
+          none, none);
+    }
+    return;
+  }
+  struct u7_vm0_optimize_compare const* compare =
+      u7_vm0_optimize_find_compare(opcode);
+  if (compare != NULL) {
+    u7_vm0_optimize_rewrite_compare(self, i, compare);
+    return;
+  }
+  struct u7_vm0_optimize_binary const* binary =
+      u7_vm0_optimize_find_binary(opcode);
+  if (binary != NULL) {
+    u7_vm0_optimize_rewrite_binary(self, i, binary);
+  }
+}
+
+// Forgets the values of the variables that overlap the range.
+static void u7_vm0_optimize_kill(struct u7_vm0_optimizer* self,
+                                 struct u7_vm0_optimize_range range) {
+  for (size_t s = 0; s < self->slots_size; ++s) {
+    if (self->slots[s].offset < range.offset + range.size &&
+        range.offset < self->slots[s].offset + self->slots[s].size) {
+      self->current.known[s] = false;
+    }
+  }
+}
+
+// Applies the instruction to the current facts.
+static void u7_vm0_optimize_transfer(struct u7_vm0_optimizer* self,
+                                     size_t i) {
+  if (self->removed[i]) {
+    return;
+  }
+  struct u7_vm0_instruction const* instruction = &self->instructions[i];
+  const enum u7_vm0_opcode opcode = self->opcodes[i];
+  struct u7_vm0_opcode_info const* info = u7_vm0_opcode_info(opcode);
+  struct u7_vm0_optimize_binary const* binary =
+      u7_vm0_optimize_find_binary(opcode);
+  uint64_t value = 0;
+  bool value_known = false;
+  if (binary != NULL) {
+    const enum u7_vm0_optimize_type type =
+        u7_vm0_optimize_type_of(info->operand_kinds[0]);
+    uint64_t lhs, rhs;
+    value_known =
+        u7_vm0_optimize_operand(self, instruction, info, 1, &lhs) &&
+        u7_vm0_optimize_operand(self, instruction, info, 2, &rhs) &&
+        u7_vm0_optimize_evaluate(binary->operation, type, lhs, rhs, &value);
+  } else if (opcode >= U7_VM0_OPCODE_COPY_I32C &&
+             opcode <= U7_VM0_OPCODE_COPY_F64V) {
+    value_known = u7_vm0_optimize_operand(self, instruction, info, 1, &value);
+  }
+  if (opcode == U7_VM0_OPCODE_YIELD) {
+    // The host may access the variables while the program is paused.
+    memset(self->current.known, 0, self->slots_size * sizeof(bool));
+    return;
+  }
+  struct u7_vm0_optimize_accesses accesses;
+  u7_vm0_optimize_accesses(instruction, info, &accesses);
+  for (int k = 0; k < accesses.writes_size; ++k) {
+    u7_vm0_optimize_kill(self, accesses.writes[k]);
+  }
+  if (value_known) {
+    const size_t slot = u7_vm0_optimize_slot(
+        self, instruction->arg1.i64,
+        u7_vm0_operand_kind_variable_size(info->operand_kinds[0]));
+    self->current.known[slot] = true;
+    self->current.bits[slot] = value;
+  }
+}
+
+static void u7_vm0_optimize_push(struct u7_vm0_optimizer* self, size_t* size,
+                                 size_t b) {
+  if (!self->queued[b]) {
+    self->queued[b] = true;
+    self->worklist[(*size)++] = b;
+  }
+}
+
+// Merges the current facts into the entry of block b.
+static void u7_vm0_optimize_merge(struct u7_vm0_optimizer* self,
+                                  size_t* worklist_size, size_t b) {
+  bool* known = self->entries.known + b * self->slots_size;
+  uint64_t* bits = self->entries.bits + b * self->slots_size;
+  if (!self->reachable[b]) {
+    self->reachable[b] = true;
+    memcpy(known, self->current.known, self->slots_size * sizeof(bool));
+    memcpy(bits, self->current.bits, self->slots_size * sizeof(uint64_t));
+    u7_vm0_optimize_push(self, worklist_size, b);
+    return;
+  }
+  bool changed = false;
+  for (size_t s = 0; s < self->slots_size; ++s) {
+    if (known[s] &&
+        (!self->current.known[s] || bits[s] != self->current.bits[s])) {
+      known[s] = false;
+      changed = true;
+    }
+  }
+  if (changed) {
+    u7_vm0_optimize_push(self, worklist_size, b);
+  }
+}
+
+// Propagates the current facts from the end of block b to its successors.
+static void u7_vm0_optimize_flow(struct u7_vm0_optimizer* self,
+                                 size_t* worklist_size, size_t b) {
+  const size_t last = self->blocks[b + 1] - 1;
+  const enum u7_vm0_opcode opcode = self->opcodes[last];
+  if (opcode == U7_VM0_OPCODE_RET) {
+    return;
+  }
+  struct u7_vm0_opcode_info const* info = u7_vm0_opcode_info(opcode);
+  const int64_t target = u7_vm0_optimize_target(self, last);
+  bool taken = (target >= 0);
+  bool not_taken = !u7_vm0_opcode_is_jump(opcode);
+  uint64_t value;
+  if (u7_vm0_optimize_branch(self, last, &taken)) {
+    not_taken = !taken;
+  }
+  if (u7_vm0_opcode_is_jump_table(opcode)) {
+    // Every entry is a block of its own.
+    const int64_t count = self->instructions[last].arg2.i64;
+    int64_t first = 0;
+    int64_t end = count;
+    if (u7_vm0_optimize_operand(self, &self->instructions[last], info, 0,
+                                &value)) {
+      first = u7_vm0_optimize_table_entry(info->operand_kinds[0], value,
+                                          count);
+      end = (first < count ? first + 1 : first);
+      taken = (first == count);
+    }
+    for (int64_t k = first; k < end; ++k) {
+      u7_vm0_optimize_merge(self, worklist_size,
+                            self->block_of[last + 1 + (size_t)k]);
+    }
+    not_taken = false;
+  }
+  if (taken) {
+    u7_vm0_optimize_merge(self, worklist_size, self->block_of[target]);
+  }
+  if (not_taken && last + 1 < self->instructions_size) {
+    u7_vm0_optimize_merge(self, worklist_size, b + 1);
+  }
+}
+
+static void u7_vm0_optimize_propagate(struct u7_vm0_optimizer* self) {
+  size_t worklist_size = 0;
+  memset(self->current.known, 0, self->slots_size * sizeof(bool));
+  u7_vm0_optimize_merge(self, &worklist_size, 0);
+  while (worklist_size > 0) {
+    const size_t b = self->worklist[--worklist_size];
+    self->queued[b] = false;
+    memcpy(self->current.known, self->entries.known + b * self->slots_size,
+           self->slots_size * sizeof(bool));
+    memcpy(self->current.bits, self->entries.bits + b * self->slots_size,
+           self->slots_size * sizeof(uint64_t));
+    for (size_t i = self->blocks[b]; i < self->blocks[b + 1]; ++i) {
+      u7_vm0_optimize_transfer(self, i);
+    }
+    u7_vm0_optimize_flow(self, &worklist_size, b);
+  }
+  // Rewrite with the fixed point facts.
+  for (size_t b = 0; b < self->blocks_size; ++b) {
+    if (!self->reachable[b]) {
+      continue;
+    }
+    memcpy(self->current.known, self->entries.known + b * self->slots_size,
+           self->slots_size * sizeof(bool));
+    memcpy(self->current.bits, self->entries.bits + b * self->slots_size,
+           self->slots_size * sizeof(uint64_t));
+    for (size_t i = self->blocks[b]; i < self->blocks[b + 1]; ++i) {
+      u7_vm0_optimize_rewrite(self, i);
+      u7_vm0_optimize_transfer(self, i);
+    }
+  }
+}
+
+static void u7_vm0_optimize_live_set(uint64_t* live,
+                                     struct u7_vm0_optimize_range range) {
+  for (int64_t k = range.offset; k < range.offset + range.size; ++k) {
+    live[k / 64] |= (uint64_t)1 << (k % 64);
+  }
+}
+
+static void u7_vm0_optimize_live_clear(uint64_t* live,
+                                       struct u7_vm0_optimize_range range) {
+  for (int64_t k = range.offset; k < range.offset + range.size; ++k) {
+    live[k / 64] &= ~((uint64_t)1 << (k % 64));
+  }
+}
+
+static bool u7_vm0_optimize_live_any(uint64_t const* live,
+                                     struct u7_vm0_optimize_range range) {
+  for (int64_t k = range.offset; k < range.offset + range.size; ++k) {
+    if ((live[k / 64] >> (k % 64)) & 1) {
+      return true;
+    }
+  }
+  return false;
+}
+
+// Computes the live bytes before instruction i from the ones after it. If
+// `eliminate`, removes the instruction when it is a dead store; returns true
+// in that case.
+static bool u7_vm0_optimize_live_step(struct u7_vm0_optimizer* self,
+                                      size_t i, bool eliminate) {
+  if (self->removed[i]) {
+    return false;
+  }
+  const enum u7_vm0_opcode opcode = self->opcodes[i];
+  struct u7_vm0_opcode_info const* info = u7_vm0_opcode_info(opcode);
+  const bool pure = u7_vm0_optimize_is_pure(opcode);
+  if (opcode == U7_VM0_OPCODE_YIELD || opcode == U7_VM0_OPCODE_RET) {
+    // The host observes all the variables.
+    u7_vm0_optimize_live_set(
+        self->live,
+        (struct u7_vm0_optimize_range){0, (int64_t)self->locals_size});
+    return false;
+  }
+  struct u7_vm0_optimize_accesses accesses;
+  u7_vm0_optimize_accesses(&self->instructions[i], info, &accesses);
+  if (eliminate && pure) {
+    bool dead = true;
+    for (int k = 0; k < accesses.writes_size; ++k) {
+      dead = dead && !u7_vm0_optimize_live_any(self->live, accesses.writes[k]);
+    }
+    if (dead) {
+      self->removed[i] = true;
+      return true;
+    }
+  }
+  for (int k = 0; k < accesses.writes_size; ++k) {
+    u7_vm0_optimize_live_clear(self->live, accesses.writes[k]);
+  }
+  for (int k = 0; k < accesses.reads_size; ++k) {
+    u7_vm0_optimize_live_set(self->live, accesses.reads[k]);
+  }
+  if (!pure && u7_vm0_optimize_label(info) < 0) {
+    // May fail, and then the next run starts from the beginning.
+    for (size_t w = 0; w < self->live_words; ++w) {
+      self->live[w] |= self->live_in[w];
+    }
+  }
+  return false;
+}
+
+// Adds the live bytes at the beginning of block b to the current ones.
+static void u7_vm0_optimize_live_merge(struct u7_vm0_optimizer* self,
+                                       size_t b) {
+  uint64_t const* live_in = self->live_in + b * self->live_words;
+  for (size_t w = 0; w < self->live_words; ++w) {
+    self->live[w] |= live_in[w];
+  }
+}
+
+// Computes the live bytes at the end of block b.
+static void u7_vm0_optimize_live_out(struct u7_vm0_optimizer* self,
+                                     size_t b) {
+  memset(self->live, 0, self->live_words * sizeof(uint64_t));
+  const size_t last = self->blocks[b + 1] - 1;
+  bool fall_through = (last + 1 < self->instructions_size);
+  if (!self->removed[last]) {
+    const enum u7_vm0_opcode opcode = self->opcodes[last];
+    const int64_t target = u7_vm0_optimize_target(self, last);
+    if (target >= 0) {
+      u7_vm0_optimize_live_merge(self, self->block_of[target]);
+    }
+    if (u7_vm0_opcode_is_jump_table(opcode)) {
+      for (int64_t k = 0; k < self->instructions[last].arg2.i64; ++k) {
+        u7_vm0_optimize_live_merge(self,
+                                   self->block_of[last + 1 + (size_t)k]);
+      }
+    }
+    fall_through = fall_through && opcode != U7_VM0_OPCODE_RET &&
+                   !u7_vm0_opcode_is_jump(opcode) &&
+                   !u7_vm0_opcode_is_jump_table(opcode);
+  }
+  if (fall_through) {
+    u7_vm0_optimize_live_merge(self, b + 1);
+  }
+}
+
+// Removes the dead stores; returns true if any was removed.
+static bool u7_vm0_optimize_eliminate(struct u7_vm0_optimizer* self) {
+  memset(self->live_in, 0,
+         self->blocks_size * self->live_words * sizeof(uint64_t));
+  bool changed = true;
+  while (changed) {
+    changed = false;
+    for (size_t b = self->blocks_size; b-- > 0;) {
+      if (!self->reachable[b]) {
+        continue;
+      }
+      u7_vm0_optimize_live_out(self, b);
+      for (size_t i = self->blocks[b + 1]; i-- > self->blocks[b];) {
+        u7_vm0_optimize_live_step(self, i, false);
+      }
+      uint64_t* live_in = self->live_in + b * self->live_words;
+      if (memcmp(live_in, self->live, self->live_words * sizeof(uint64_t)) !=
+          0) {
+        memcpy(live_in, self->live, self->live_words * sizeof(uint64_t));
+        changed = true;
+      }
+    }
+  }
+  bool removed = false;
+  for (size_t b = 0; b < self->blocks_size; ++b) {
+    if (!self->reachable[b]) {
+      continue;
+    }
+    u7_vm0_optimize_live_out(self, b);
+    for (size_t i = self->blocks[b + 1]; i-- > self->blocks[b];) {
+      removed = u7_vm0_optimize_live_step(self, i, true) || removed;
+    }
+  }
+  return removed;
+}
+
+static void u7_vm0_optimizer_destroy(struct u7_vm0_optimizer* self) {
+  free(self->opcodes);
+  free(self->slots);
+  free(self->blocks);
+  free(self->block_of);
+  free(self->reachable);
+  free(self->removed);
+  free(self->entries.known);
+  free(self->entries.bits);
+  free(self->current.known);
+  free(self->current.bits);
+  free(self->live_in);
+  free(self->live);
+  free(self->worklist);
+  free(self->queued);
+}
+
+// Finds the variables and the basic blocks.
+static u7_error u7_vm0_optimizer_init(struct u7_vm0_optimizer* self) {
+  const size_t n = self->instructions_size;
+  self->opcodes = malloc(n * sizeof(enum u7_vm0_opcode));
+  self->slots = malloc(6 * n * sizeof(struct u7_vm0_optimize_range));
+  self->blocks = malloc((n + 1) * sizeof(size_t));
+  self->block_of = malloc(n * sizeof(size_t));
+  self->removed = calloc(n, sizeof(bool));
+  if (self->opcodes == NULL || self->slots == NULL || self->blocks == NULL ||
+      self->block_of == NULL || self->removed == NULL) {
+    return u7_errnof(ENOMEM, "u7_vm0_optimize: out of memory");
+  }
+  // The leaders are marked in block_of first.
+  memset(self->block_of, 0, n * sizeof(size_t));
+  self->block_of[0] = 1;
+  for (size_t i = 0; i < n; ++i) {
+    self->opcodes[i] = u7_vm0_instruction_opcode(&self->instructions[i]);
+    struct u7_vm0_opcode_info const* info =
+        u7_vm0_opcode_info(self->opcodes[i]);
+    const int64_t target = u7_vm0_optimize_target(self, i);
+    if (target >= 0) {
+      self->block_of[target] = 1;
+    }
+    if ((target >= 0 || self->opcodes[i] == U7_VM0_OPCODE_RET) && i + 1 < n) {
+      self->block_of[i + 1] = 1;
+    }
+    const union u7_vm0_value args[3] = {
+        self->instructions[i].arg1,
+        self->instructions[i].arg2,
+        self->instructions[i].arg3,
+    };
+    for (int j = 0; j < 3; ++j) {
+      const enum u7_vm0_operand_kind kind = info->operand_kinds[j];
+      if (u7_vm0_optimize_is_scalar(kind)) {
+        self->slots[self->slots_size++] = (struct u7_vm0_optimize_range){
+            args[j].i64, u7_vm0_operand_kind_variable_size(kind)};
+      } else if (u7_vm0_operand_kind_is_pair(kind)) {
+        const int64_t size = u7_vm0_operand_kind_variable_size(kind);
+        self->slots[self->slots_size++] = (struct u7_vm0_optimize_range){
+            u7_vm0_operand_pair_first(args[j].i64), size};
+        self->slots[self->slots_size++] = (struct u7_vm0_optimize_range){
+            u7_vm0_operand_pair_second(args[j].i64), size};
+      }
+    }
+  }
+  for (size_t i = 0; i < n; ++i) {
+    if (self->block_of[i] != 0) {
+      self->blocks[self->blocks_size++] = i;
+    }
+    self->block_of[i] = self->blocks_size - 1;
+  }
+  self->blocks[self->blocks_size] = n;
+  qsort(self->slots, self->slots_size, sizeof(struct u7_vm0_optimize_range),
+        u7_vm0_optimize_range_compare);
+  size_t unique = 0;
+  for (size_t s = 0; s < self->slots_size; ++s) {
+    if (unique == 0 ||
+        u7_vm0_optimize_range_less(self->slots[unique - 1], self->slots[s])) {
+      self->slots[unique++] = self->slots[s];
+    }
+  }
+  self->slots_size = unique;
+  const size_t slots_size = (unique > 0 ? unique : 1);
+  const size_t blocks_size = self->blocks_size;
+  self->live_words = (self->locals_size + 63) / 64 + 1;
+  self->reachable = calloc(blocks_size, sizeof(bool));
+  self->entries.known = malloc(blocks_size * slots_size * sizeof(bool));
+  self->entries.bits = malloc(blocks_size * slots_size * sizeof(uint64_t));
+  self->current.known = malloc(slots_size * sizeof(bool));
+  self->current.bits = malloc(slots_size * sizeof(uint64_t));
+  self->live_in = malloc(blocks_size * self->live_words * sizeof(uint64_t));
+  self->live = malloc(self->live_words * sizeof(uint64_t));
+  self->worklist = malloc(blocks_size * sizeof(size_t));
+  self->queued = calloc(blocks_size, sizeof(bool));
+  if (self->reachable == NULL || self->entries.known == NULL ||
+      self->entries.bits == NULL || self->current.known == NULL ||
+      self->current.bits == NULL || self->live_in == NULL ||
+      self->live == NULL || self->worklist == NULL || self->queued == NULL) {
+    return u7_errnof(ENOMEM, "u7_vm0_optimize: out of memory");
+  }
+  return u7_ok();
+}
+
+u7_error u7_vm0_optimize(
+    struct u7_vm0_instruction* instructions, size_t* instructions_size,
+    struct u7_vm_stack_frame_layout const* locals_frame_layout) {
+  u7_error error =
+      u7_vm0_verify(instructions, *instructions_size, locals_frame_layout);
+  if (error.error_code != 0) {
+    return error;
+  }
+  // The pass analyzes a single frame.
+  for (size_t i = 0; i < *instructions_size; ++i) {
+    const enum u7_vm0_opcode opcode =
+        u7_vm0_instruction_opcode(&instructions[i]);
+    if (u7_vm0_opcode_is_call(opcode) ||
+        (u7_vm0_opcode_is_return(opcode) && opcode != U7_VM0_OPCODE_RET)) {
+      return u7_errnof(EINVAL,
+                       "u7_vm0_optimize: instruction %zu: %s: functions "
+                       "are not supported",
+                       i, u7_vm0_opcode_info(opcode)->name);
+    }
+  }
+  struct u7_vm0_optimizer self = {
+      .instructions = instructions,
+      .instructions_size = *instructions_size,
+      .locals_size = locals_frame_layout->locals_size,
+  };
+  error = u7_vm0_optimizer_init(&self);
+  if (error.error_code != 0) {
+    u7_vm0_optimizer_destroy(&self);
+    return error;
+  }
+  const size_t n = self.instructions_size;
+  u7_vm0_optimize_propagate(&self);
+  for (size_t i = 0; i + 1 < n; ++i) {
+    // The final `ret` stays, so the program still cannot run past its end.
+    self.removed[i] = self.removed[i] || !self.reachable[self.block_of[i]];
+  }
+  while (u7_vm0_optimize_eliminate(&self)) {
+  }
+  // Compact in place; a label of a removed instruction moves to the next
+  // remaining one.
+  size_t* new_index = self.block_of;
+  size_t m = 0;
+  for (size_t i = 0; i < n; ++i) {
+    new_index[i] = m;
+    if (!self.removed[i]) {
+      instructions[m++] = instructions[i];
+    }
+  }
+  for (size_t i = 0; i < m; ++i) {
+    struct u7_vm0_opcode_info const* info =
+        u7_vm0_opcode_info(u7_vm0_instruction_opcode(&instructions[i]));
+    union u7_vm0_value* args[3] = {
+        &instructions[i].arg1,
+        &instructions[i].arg2,
+        &instructions[i].arg3,
+    };
+    for (int j = 0; j < 3; ++j) {
+      if (info->operand_kinds[j] == U7_VM0_OPERAND_LABEL) {
+        args[j]->i64 = (int64_t)new_index[args[j]->i64];
+      }
+    }
+  }
+  u7_vm0_optimizer_destroy(&self);
+  *instructions_size = m;
+  return u7_vm0_verify(instructions, m, locals_frame_layout);
+}
@@ -0,0 +1,171 @@
+#include "@/public/optimize.h"
+
+#include "@/public/assembler.h"
+#include "@/public/opcode.h"
+#include "@/public/program.h"
+#include "@/testing.h"
+
+#include <errno.h>
+#include <github.com/apronchenkov/error/public/error.h>
+#include <github.com/apronchenkov/yalog/public/basic.h>
+#include <github.com/apronchenkov/yalog/public/logging_printf.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <string.h>
+
+// Tests for u7_vm0_optimize(): every transform changes the program, and the
+// optimized program writes the same output as the original one.
+
+// Returns the number of instructions whose opcode name starts with `prefix`.
+static size_t count_opcodes(struct u7_vm0_program const* program,
+                            const char* prefix) {
+  size_t result = 0;
+  for (size_t i = 0; i < program->instructions_size; ++i) {
+    const char* name =
+        u7_vm0_opcode_info(
+            u7_vm0_instruction_opcode(&program->instructions[i]))
+            ->name;
+    result += (strncmp(name, prefix, strlen(prefix)) == 0);
+  }
+  return result;
+}
+
+// Assembles `text` twice, optimizes one of the copies, and checks that the
+// optimizer has reduced the number of `opcode_prefix` instructions to
+// `expected_count`, and that both programs write `expected` for every input.
+static u7_error check_optimize(const char* name, const char* text,
+                               const char* opcode_prefix,
+                               size_t expected_count,
+                               int64_t const* inputs,
+                               int64_t const* expected, size_t size) {
+  struct u7_vm0_program original;
+  u7_error error = u7_vm0_assemble(&original, text, strlen(text));
+  if (error.error_code != 0) {
+    return error;
+  }
+  struct u7_vm0_program optimized;
+  error = u7_vm0_assemble(&optimized, text, strlen(text));
+  if (error.error_code != 0) {
+    u7_vm0_program_destroy(&original);
+    return error;
+  }
+  error = u7_vm0_optimize(optimized.instructions,
+                          &optimized.instructions_size,
+                          &optimized.locals_frame_layout);
+  if (error.error_code != 0) {
+    goto cleanup;
+  }
+  size_t count = count_opcodes(&optimized, opcode_prefix);
+  if (count_opcodes(&original, opcode_prefix) <= expected_count ||
+      count != expected_count) {
+    error = u7_errnof(EINVAL, "%s: %zu `%s` instructions left, expected %zu",
+                      name, count, opcode_prefix, expected_count);
+    goto cleanup;
+  }
+  for (size_t i = 0; i < size; ++i) {
+    int64_t lhs, rhs;
+    error = u7_vm0_test_run_single(&original, original.js, inputs[i], &lhs);
+    if (error.error_code != 0) {
+      goto cleanup;
+    }
+    error =
+        u7_vm0_test_run_single(&optimized, optimized.js, inputs[i], &rhs);
+    if (error.error_code != 0) {
+      goto cleanup;
+    }
+    if (lhs != expected[i] || rhs != expected[i]) {
+      error = u7_errnof(EINVAL,
+                        "%s: input %" PRId64 ": expected %" PRId64
+                        ", got %" PRId64 " (original) and %" PRId64
+                        " (optimized)",
+                        name, inputs[i], expected[i], lhs, rhs);
+      goto cleanup;
+    }
+  }
+  YALOG_PRINTF(INFO, "%s: %zu -> %zu instructions\n", name,
+               original.instructions_size, optimized.instructions_size);
+cleanup:
+  u7_vm0_program_destroy(&optimized);
+  u7_vm0_program_destroy(&original);
+  return error;
+}
+
+static u7_error test_constant_folding() {
+  static const char text[] =
+      "i64 n, a, b, c\n"
+      "read n\n"
+      "a = 6\n"
+      "b = 7\n"
+      "c = a * b\n"
+      "c = c & n\n"
+      "write c\n"
+      "ret\n";
+  int64_t const inputs[] = {-1, 0, 10};
+  int64_t const expected[] = {42, 0, 10};
+  return check_optimize("constant_folding", text, "math_multiply", 0, inputs,
+                        expected, sizeof(inputs) / sizeof(inputs[0]));
+}
+
+static u7_error test_dead_store() {
+  static const char text[] =
+      "i64 n, a\n"
+      "read n\n"
+      "a = n & 3\n"
+      "a = n & 5\n"
+      "write a\n"
+      "ret\n";
+  int64_t const inputs[] = {0, 3, 7};
+  int64_t const expected[] = {0, 1, 5};
+  return check_optimize("dead_store", text, "bitwise_and", 1, inputs,
+                        expected, sizeof(inputs) / sizeof(inputs[0]));
+}
+
+// The loop variables are not constant, so only the constants before the loop
+// are propagated; the result must not change.
+static u7_error test_loop() {
+  static const char text[] =
+      "i64 n, s, k\n"
+      "read n\n"
+      "k = 3\n"
+      "s = 0\n"
+      "jz n, done\n"
+      "loop: s = s + n\n"
+      "s = s + k\n"
+      "n = n + -1\n"
+      "jnz n, loop\n"
+      "done: write s\n"
+      "ret\n";
+  int64_t const inputs[] = {0, 1, 10};
+  int64_t const expected[] = {0, 4, 85};
+  return check_optimize("loop", text, "math_add_i64vv", 1, inputs, expected,
+                        sizeof(inputs) / sizeof(inputs[0]));
+}
+
+static u7_error test_jump_table_folding() {
+  static const char text[] =
+      "i64 n, s, r\n"
+      "read n\n"
+      "s = 1\n"
+      "switch s, other, zero, one\n"
+      "other: r = 0\n"
+      "jmp done\n"
+      "zero: r = 10\n"
+      "jmp done\n"
+      "one: r = n\n"
+      "done: write r\n"
+      "ret\n";
+  int64_t const inputs[] = {-5, 11};
+  int64_t const expected[] = {-5, 11};
+  return check_optimize("jump_table_folding", text, "jump_table", 0, inputs,
+                        expected, sizeof(inputs) / sizeof(inputs[0]));
+}
+
+int main() {
+  u7_error (*const tests[])() = {
+      &test_constant_folding,
+      &test_dead_store,
+      &test_loop,
+      &test_jump_table_folding,
+  };
+  return u7_vm0_test_main(tests, sizeof(tests) / sizeof(tests[0]));
+}
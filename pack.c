@@ -0,0 +1,631 @@
+#include "@/public/pack.h"
+
+#include "@/public/opcode.h"
+#include "@/public/verify.h"
+
+#include <errno.h>
+#include <github.com/apronchenkov/error/public/error.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+enum {
+  U7_VM0_PACK_MAX_ACCESSES = 6,  // E.g. math_add_2: two pairs of operands.
+  U7_VM0_PACK_LOOP_WEIGHT = 16,
+};
+
+// A variable referenced by an operand; an array is a single access.
+struct u7_vm0_pack_access {
+  int64_t offset;
+  int64_t size;
+  int64_t alignment;  // The size of an element.
+  bool written;
+};
+
+// Overlapping variables of the original frame; they are moved together.
+struct u7_vm0_pack_group {
+  int64_t offset;
+  int64_t size;
+  int64_t alignment;
+  uint64_t accesses;  // Weighted number of the accesses.
+  size_t slot;
+  size_t next_member;  // Next group that shares the slot, or SIZE_MAX.
+};
+
+struct u7_vm0_pack_slot {
+  int64_t offset;
+  int64_t size;
+  int64_t alignment;
+  bool pinned;  // Holds a variable that lives between the runs.
+  size_t first_member;
+};
+
+struct u7_vm0_pack_order {
+  uint64_t accesses;
+  int64_t offset;
+  size_t group;
+};
+
+struct u7_vm0_packer {
+  struct u7_vm0_instruction* instructions;
+  size_t instructions_size;
+  struct u7_vm0_pack_group* groups;
+  size_t groups_size;
+  size_t group_words;  // Size of a set of groups, in uint64_t.
+  // Basic blocks: [blocks[b], blocks[b + 1]).
+  size_t* blocks;
+  size_t blocks_size;
+  size_t* block_of;
+  uint64_t* live_in;       // [blocks_size * group_words]
+  uint64_t* live;          // [group_words]
+  uint64_t* observed;      // [group_words]
+  uint64_t* interference;  // [groups_size * group_words]
+  struct u7_vm0_pack_slot* slots;
+  size_t slots_size;
+  struct u7_vm0_pack_order* order;
+};
+
+static bool u7_vm0_pack_is_written(enum u7_vm0_operand_kind kind) {
+  return (kind >= U7_VM0_OPERAND_I32_DST && kind <= U7_VM0_OPERAND_F64_DST) ||
+         (kind >= U7_VM0_OPERAND_I32_DST_ARRAY &&
+          kind <= U7_VM0_OPERAND_F64_DST_SRC_ARRAY);
+}
+
+// Returns the label operand of the instruction, or NULL.
+static union u7_vm0_value const* u7_vm0_pack_label(
+    struct u7_vm0_instruction const* instruction,
+    struct u7_vm0_opcode_info const* info) {
+  if (info->operand_kinds[0] == U7_VM0_OPERAND_LABEL) {
+    return &instruction->arg1;
+  }
+  if (info->operand_kinds[1] == U7_VM0_OPERAND_LABEL) {
+    return &instruction->arg2;
+  }
+  if (info->operand_kinds[2] == U7_VM0_OPERAND_LABEL) {
+    return &instruction->arg3;
+  }
+  return NULL;
+}
+
+static int u7_vm0_pack_accesses(
+    struct u7_vm0_instruction const* instruction,
+    struct u7_vm0_pack_access result[U7_VM0_PACK_MAX_ACCESSES]) {
+  struct u7_vm0_opcode_info const* info =
+      u7_vm0_opcode_info(u7_vm0_instruction_opcode(instruction));
+  const union u7_vm0_value args[3] = {
+      instruction->arg1,
+      instruction->arg2,
+      instruction->arg3,
+  };
+  int size = 0;
+  for (int j = 0; j < 3; ++j) {
+    const enum u7_vm0_operand_kind kind = info->operand_kinds[j];
+    const int64_t element_size = u7_vm0_operand_kind_variable_size(kind);
+    if (element_size == 0) {
+      continue;
+    }
+    if (u7_vm0_operand_kind_is_pair(kind)) {
+      result[size++] = (struct u7_vm0_pack_access){
+          u7_vm0_operand_pair_first(args[j].i64), element_size, element_size,
+          kind != U7_VM0_OPERAND_F64_SRC_PAIR};
+      result[size++] = (struct u7_vm0_pack_access){
+          u7_vm0_operand_pair_second(args[j].i64), element_size, element_size,
+          kind == U7_VM0_OPERAND_F64_DST_PAIR};
+    } else if (u7_vm0_operand_kind_is_array_pair(kind)) {
+      const int64_t count = args[u7_vm0_opcode_info_count_index(info)].i64;
+      result[size++] = (struct u7_vm0_pack_access){
+          u7_vm0_operand_pair_first(args[j].i64), element_size * count,
+          element_size, false};
+      result[size++] = (struct u7_vm0_pack_access){
+          u7_vm0_operand_pair_second(args[j].i64), element_size * count,
+          element_size, false};
+    } else if (u7_vm0_operand_kind_is_array(kind)) {
+      result[size++] = (struct u7_vm0_pack_access){
+          args[j].i64, element_size * args[j + 1].i64, element_size,
+          u7_vm0_pack_is_written(kind)};
+      if (kind == U7_VM0_OPERAND_F32_DST_SRC_ARRAY ||
+          kind == U7_VM0_OPERAND_F64_DST_SRC_ARRAY) {
+        result[size] = result[size - 1];
+        result[size++].written = false;
+      }
+    } else {
+      result[size++] = (struct u7_vm0_pack_access){
+          args[j].i64, element_size, element_size,
+          u7_vm0_pack_is_written(kind)};
+    }
+  }
+  return size;
+}
+
+static int u7_vm0_pack_access_compare(void const* a, void const* b) {
+  struct u7_vm0_pack_access const* lhs = a;
+  struct u7_vm0_pack_access const* rhs = b;
+  return (lhs->offset > rhs->offset) - (lhs->offset < rhs->offset);
+}
+
+static int u7_vm0_pack_order_compare(void const* a, void const* b) {
+  struct u7_vm0_pack_order const* lhs = a;
+  struct u7_vm0_pack_order const* rhs = b;
+  if (lhs->accesses != rhs->accesses) {
+    return (lhs->accesses < rhs->accesses ? 1 : -1);
+  }
+  return (lhs->offset > rhs->offset) - (lhs->offset < rhs->offset);
+}
+
+// Returns the group that contains the offset.
+static size_t u7_vm0_pack_group_of(struct u7_vm0_packer const* self,
+                                   int64_t offset) {
+  size_t begin = 0;
+  size_t end = self->groups_size;
+  while (end - begin > 1) {
+    const size_t middle = begin + (end - begin) / 2;
+    if (self->groups[middle].offset <= offset) {
+      begin = middle;
+    } else {
+      end = middle;
+    }
+  }
+  return begin;
+}
+
+static int64_t u7_vm0_pack_align(int64_t offset, int64_t alignment) {
+  return (offset + alignment - 1) / alignment * alignment;
+}
+
+static bool u7_vm0_pack_test(uint64_t const* set, size_t k) {
+  return (set[k / 64] >> (k % 64)) & 1;
+}
+
+static void u7_vm0_pack_set(uint64_t* set, size_t k) {
+  set[k / 64] |= (uint64_t)1 << (k % 64);
+}
+
+static void u7_vm0_pack_interfere(struct u7_vm0_packer* self, size_t a,
+                                  size_t b) {
+  if (a != b) {
+    u7_vm0_pack_set(self->interference + a * self->group_words, b);
+    u7_vm0_pack_set(self->interference + b * self->group_words, a);
+  }
+}
+
+// Finds the groups of overlapping variables and weighs their accesses.
+static u7_error u7_vm0_pack_find_groups(struct u7_vm0_packer* self) {
+  const size_t n = self->instructions_size;
+  struct u7_vm0_pack_access* accesses =
+      malloc(U7_VM0_PACK_MAX_ACCESSES * n * sizeof(struct u7_vm0_pack_access));
+  int64_t* loop_depth = calloc(n + 1, sizeof(int64_t));
+  self->groups =
+      malloc(U7_VM0_PACK_MAX_ACCESSES * n * sizeof(struct u7_vm0_pack_group));
+  if (accesses == NULL || loop_depth == NULL || self->groups == NULL) {
+    free(accesses);
+    free(loop_depth);
+    return u7_errnof(ENOMEM, "u7_vm0_pack_locals: out of memory");
+  }
+  size_t accesses_size = 0;
+  for (size_t i = 0; i < n; ++i) {
+    accesses_size +=
+        u7_vm0_pack_accesses(&self->instructions[i], accesses + accesses_size);
+    // A backward jump closes a loop.
+    union u7_vm0_value const* label = u7_vm0_pack_label(
+        &self->instructions[i],
+        u7_vm0_opcode_info(u7_vm0_instruction_opcode(&self->instructions[i])));
+    if (label != NULL && (uint64_t)label->i64 <= i) {
+      loop_depth[label->i64] += 1;
+      loop_depth[i + 1] -= 1;
+    }
+  }
+  qsort(accesses, accesses_size, sizeof(struct u7_vm0_pack_access),
+        u7_vm0_pack_access_compare);
+  for (size_t k = 0; k < accesses_size; ++k) {
+    struct u7_vm0_pack_access const* access = &accesses[k];
+    struct u7_vm0_pack_group* last =
+        (self->groups_size > 0 ? &self->groups[self->groups_size - 1] : NULL);
+    if (last != NULL && access->offset < last->offset + last->size) {
+      const int64_t end = access->offset + access->size;
+      if (end > last->offset + last->size) {
+        last->size = end - last->offset;
+      }
+      if (access->alignment > last->alignment) {
+        last->alignment = access->alignment;
+      }
+    } else if (access->size > 0) {
+      self->groups[self->groups_size++] = (struct u7_vm0_pack_group){
+          .offset = access->offset,
+          .size = access->size,
+          .alignment = access->alignment,
+          .next_member = SIZE_MAX,
+      };
+    }
+  }
+  // The groups start and end at multiples of their alignment, so the relative
+  // offsets are preserved by an aligned slot.
+  size_t groups_size = 0;
+  for (size_t g = 0; g < self->groups_size; ++g) {
+    struct u7_vm0_pack_group group = self->groups[g];
+    const int64_t end = group.offset + group.size;
+    group.offset -= group.offset % group.alignment;
+    while (groups_size > 0) {
+      struct u7_vm0_pack_group const* previous =
+          &self->groups[groups_size - 1];
+      if (group.offset >= previous->offset + previous->size) {
+        break;
+      }
+      groups_size -= 1;
+      if (previous->alignment > group.alignment) {
+        group.alignment = previous->alignment;
+      }
+      group.offset = previous->offset - previous->offset % group.alignment;
+    }
+    group.size = u7_vm0_pack_align(end, group.alignment) - group.offset;
+    self->groups[groups_size++] = group;
+  }
+  self->groups_size = groups_size;
+  int64_t depth = 0;
+  for (size_t i = 0; i < n; ++i) {
+    depth += loop_depth[i];
+    const uint64_t weight = (depth > 0 ? U7_VM0_PACK_LOOP_WEIGHT : 1);
+    struct u7_vm0_pack_access instruction_accesses[U7_VM0_PACK_MAX_ACCESSES];
+    const int size =
+        u7_vm0_pack_accesses(&self->instructions[i], instruction_accesses);
+    for (int k = 0; k < size; ++k) {
+      if (instruction_accesses[k].size > 0) {
+        self->groups[u7_vm0_pack_group_of(self,
+                                          instruction_accesses[k].offset)]
+            .accesses += weight;
+      }
+    }
+  }
+  free(accesses);
+  free(loop_depth);
+  return u7_ok();
+}
+
+// Finds the basic blocks.
+static void u7_vm0_pack_find_blocks(struct u7_vm0_packer* self) {
+  const size_t n = self->instructions_size;
+  // The leaders are marked in block_of first.
+  memset(self->block_of, 0, n * sizeof(size_t));
+  self->block_of[0] = 1;
+  for (size_t i = 0; i < n; ++i) {
+    const enum u7_vm0_opcode opcode =
+        u7_vm0_instruction_opcode(&self->instructions[i]);
+    union u7_vm0_value const* label = u7_vm0_pack_label(
+        &self->instructions[i], u7_vm0_opcode_info(opcode));
+    if (label != NULL) {
+      self->block_of[label->i64] = 1;
+    }
+    if ((label != NULL || opcode == U7_VM0_OPCODE_RET) && i + 1 < n) {
+      self->block_of[i + 1] = 1;
+    }
+  }
+  for (size_t i = 0; i < n; ++i) {
+    if (self->block_of[i] != 0) {
+      self->blocks[self->blocks_size++] = i;
+    }
+    self->block_of[i] = self->blocks_size - 1;
+  }
+  self->blocks[self->blocks_size] = n;
+}
+
+// Computes the live groups at the end of block b. At `ret` the host observes
+// the variables, and then the program starts over.
+static void u7_vm0_pack_live_out(struct u7_vm0_packer* self, size_t b) {
+  const size_t words = self->group_words;
+  const size_t last = self->blocks[b + 1] - 1;
+  struct u7_vm0_instruction const* instruction = &self->instructions[last];
+  const enum u7_vm0_opcode opcode = u7_vm0_instruction_opcode(instruction);
+  memset(self->live, 0, words * sizeof(uint64_t));
+  uint64_t const* successors[2] = {NULL, NULL};
+  union u7_vm0_value const* label =
+      u7_vm0_pack_label(instruction, u7_vm0_opcode_info(opcode));
+  if (opcode == U7_VM0_OPCODE_RET) {
+    successors[0] = self->live_in;
+    successors[1] = self->observed;
+  } else if (last + 1 < self->instructions_size &&
+             !u7_vm0_opcode_is_jump(opcode) &&
+             !u7_vm0_opcode_is_jump_table(opcode)) {
+    successors[0] = self->live_in + (b + 1) * words;
+  }
+  if (label != NULL) {
+    successors[1] = self->live_in + self->block_of[label->i64] * words;
+  }
+  for (int k = 0; k < 2; ++k) {
+    for (size_t w = 0; successors[k] != NULL && w < words; ++w) {
+      self->live[w] |= successors[k][w];
+    }
+  }
+  if (u7_vm0_opcode_is_jump_table(opcode)) {
+    // Every entry is a block of its own.
+    for (int64_t k = 0; k < instruction->arg2.i64; ++k) {
+      uint64_t const* entry =
+          self->live_in + self->block_of[last + 1 + (size_t)k] * words;
+      for (size_t w = 0; w < words; ++w) {
+        self->live[w] |= entry[w];
+      }
+    }
+  }
+}
+
+// Computes the live groups before instruction i from the ones after it. If
+// `interfere`, records that the groups written by the instruction interfere
+// with the live ones and with the other operands.
+static void u7_vm0_pack_live_step(struct u7_vm0_packer* self, size_t i,
+                                  bool interfere) {
+  struct u7_vm0_pack_access accesses[U7_VM0_PACK_MAX_ACCESSES];
+  size_t groups[U7_VM0_PACK_MAX_ACCESSES];
+  int size = u7_vm0_pack_accesses(&self->instructions[i], accesses);
+  int used_size = 0;
+  for (int k = 0; k < size; ++k) {
+    if (accesses[k].size > 0) {  // Skips the empty arrays.
+      accesses[used_size] = accesses[k];
+      groups[used_size++] = u7_vm0_pack_group_of(self, accesses[k].offset);
+    }
+  }
+  size = used_size;
+  // At `yield` the host observes the variables, as at `ret`.
+  if (u7_vm0_instruction_opcode(&self->instructions[i]) ==
+      U7_VM0_OPCODE_YIELD) {
+    for (size_t w = 0; w < self->group_words; ++w) {
+      self->live[w] |= self->observed[w];
+    }
+  }
+  for (int k = 0; interfere && k < size; ++k) {
+    if (!accesses[k].written) {
+      continue;
+    }
+    for (size_t g = 0; g < self->groups_size; ++g) {
+      if (u7_vm0_pack_test(self->live, g)) {
+        u7_vm0_pack_interfere(self, groups[k], g);
+      }
+    }
+    for (int l = 0; l < size; ++l) {
+      u7_vm0_pack_interfere(self, groups[k], groups[l]);
+    }
+  }
+  for (int k = 0; k < size; ++k) {
+    struct u7_vm0_pack_group const* group = &self->groups[groups[k]];
+    if (accesses[k].written && accesses[k].offset == group->offset &&
+        accesses[k].size == group->size) {
+      self->live[groups[k] / 64] &= ~((uint64_t)1 << (groups[k] % 64));
+    }
+  }
+  for (int k = 0; k < size; ++k) {
+    if (!accesses[k].written) {
+      u7_vm0_pack_set(self->live, groups[k]);
+    }
+  }
+}
+
+static void u7_vm0_pack_find_interference(struct u7_vm0_packer* self) {
+  const size_t words = self->group_words;
+  memset(self->live_in, 0, self->blocks_size * words * sizeof(uint64_t));
+  bool changed = true;
+  while (changed) {
+    changed = false;
+    for (size_t b = self->blocks_size; b-- > 0;) {
+      u7_vm0_pack_live_out(self, b);
+      for (size_t i = self->blocks[b + 1]; i-- > self->blocks[b];) {
+        u7_vm0_pack_live_step(self, i, false);
+      }
+      uint64_t* live_in = self->live_in + b * words;
+      if (memcmp(live_in, self->live, words * sizeof(uint64_t)) != 0) {
+        memcpy(live_in, self->live, words * sizeof(uint64_t));
+        changed = true;
+      }
+    }
+  }
+  memset(self->interference, 0,
+         self->groups_size * words * sizeof(uint64_t));
+  for (size_t b = 0; b < self->blocks_size; ++b) {
+    u7_vm0_pack_live_out(self, b);
+    for (size_t i = self->blocks[b + 1]; i-- > self->blocks[b];) {
+      u7_vm0_pack_live_step(self, i, true);
+    }
+  }
+}
+
+// Assigns the groups to slots, the hottest first, and lays out the slots.
+static int64_t u7_vm0_pack_assign(struct u7_vm0_packer* self) {
+  for (size_t g = 0; g < self->groups_size; ++g) {
+    self->order[g] = (struct u7_vm0_pack_order){
+        self->groups[g].accesses, self->groups[g].offset, g};
+  }
+  qsort(self->order, self->groups_size, sizeof(struct u7_vm0_pack_order),
+        u7_vm0_pack_order_compare);
+  for (size_t k = 0; k < self->groups_size; ++k) {
+    const size_t g = self->order[k].group;
+    struct u7_vm0_pack_group* group = &self->groups[g];
+    // A group live at the beginning of the program is live between the runs.
+    const bool pinned = u7_vm0_pack_test(self->live_in, g);
+    size_t s = 0;
+    for (; !pinned && s < self->slots_size; ++s) {
+      struct u7_vm0_pack_slot const* slot = &self->slots[s];
+      if (slot->pinned || slot->size != group->size ||
+          slot->alignment != group->alignment) {
+        continue;
+      }
+      uint64_t const* conflicts = self->interference + g * self->group_words;
+      size_t member = slot->first_member;
+      while (member != SIZE_MAX && !u7_vm0_pack_test(conflicts, member)) {
+        member = self->groups[member].next_member;
+      }
+      if (member == SIZE_MAX) {
+        break;
+      }
+    }
+    if (pinned || s == self->slots_size) {
+      s = self->slots_size++;
+      self->slots[s] = (struct u7_vm0_pack_slot){
+          .size = group->size,
+          .alignment = group->alignment,
+          .pinned = pinned,
+          .first_member = SIZE_MAX,
+      };
+    }
+    group->slot = s;
+    group->next_member = self->slots[s].first_member;
+    self->slots[s].first_member = g;
+  }
+  // The padding before an aligned slot is reused by a later smaller one.
+  int64_t end = 0;
+  int64_t hole = 0;
+  int64_t hole_size = 0;
+  for (size_t s = 0; s < self->slots_size; ++s) {
+    struct u7_vm0_pack_slot* slot = &self->slots[s];
+    if (slot->size <= hole_size && hole % slot->alignment == 0) {
+      slot->offset = hole;
+      hole += slot->size;
+      hole_size -= slot->size;
+      continue;
+    }
+    slot->offset = u7_vm0_pack_align(end, slot->alignment);
+    if (slot->offset > end) {
+      hole = end;
+      hole_size = slot->offset - end;
+    }
+    end = slot->offset + slot->size;
+  }
+  return u7_vm0_pack_align(end, (int64_t)sizeof(int64_t));
+}
+
+static int64_t u7_vm0_pack_new_offset(struct u7_vm0_packer const* self,
+                                      int64_t offset) {
+  struct u7_vm0_pack_group const* group =
+      &self->groups[u7_vm0_pack_group_of(self, offset)];
+  return self->slots[group->slot].offset + (offset - group->offset);
+}
+
+static void u7_vm0_pack_rewrite(struct u7_vm0_packer const* self,
+                                struct u7_vm0_instruction* instruction) {
+  struct u7_vm0_opcode_info const* info =
+      u7_vm0_opcode_info(u7_vm0_instruction_opcode(instruction));
+  union u7_vm0_value* args[3] = {
+      &instruction->arg1,
+      &instruction->arg2,
+      &instruction->arg3,
+  };
+  for (int j = 0; j < 3; ++j) {
+    const enum u7_vm0_operand_kind kind = info->operand_kinds[j];
+    if (u7_vm0_operand_kind_variable_size(kind) == 0) {
+      continue;
+    }
+    if (u7_vm0_operand_kind_is_array(kind) && args[j + 1]->i64 == 0) {
+      args[j]->i64 = 0;  // An empty array is not in any group.
+      continue;
+    }
+    if (u7_vm0_operand_kind_is_array_pair(kind) &&
+        args[u7_vm0_opcode_info_count_index(info)]->i64 == 0) {
+      args[j]->i64 = u7_vm0_operand_pair(0, 0);
+      continue;
+    }
+    if (u7_vm0_operand_kind_is_pair(kind) ||
+        u7_vm0_operand_kind_is_array_pair(kind)) {
+      const int64_t first = u7_vm0_pack_new_offset(
+          self, u7_vm0_operand_pair_first(args[j]->i64));
+      const int64_t second = u7_vm0_pack_new_offset(
+          self, u7_vm0_operand_pair_second(args[j]->i64));
+      args[j]->i64 = u7_vm0_operand_pair((int32_t)first, (int32_t)second);
+    } else {
+      args[j]->i64 = u7_vm0_pack_new_offset(self, args[j]->i64);
+    }
+  }
+}
+
+static void u7_vm0_packer_destroy(struct u7_vm0_packer* self) {
+  free(self->groups);
+  free(self->blocks);
+  free(self->block_of);
+  free(self->live_in);
+  free(self->live);
+  free(self->observed);
+  free(self->interference);
+  free(self->slots);
+  free(self->order);
+}
+
+u7_error u7_vm0_pack_locals(
+    struct u7_vm0_instruction* instructions, size_t instructions_size,
+    struct u7_vm_stack_frame_layout* locals_frame_layout,
+    bool const* observed, int64_t* offsets) {
+  u7_error error =
+      u7_vm0_verify(instructions, instructions_size, locals_frame_layout);
+  if (error.error_code != 0) {
+    return error;
+  }
+  // The pass analyzes a single frame.
+  for (size_t i = 0; i < instructions_size; ++i) {
+    const enum u7_vm0_opcode opcode =
+        u7_vm0_instruction_opcode(&instructions[i]);
+    if (u7_vm0_opcode_is_call(opcode) ||
+        (u7_vm0_opcode_is_return(opcode) && opcode != U7_VM0_OPCODE_RET)) {
+      return u7_errnof(EINVAL,
+                       "u7_vm0_pack_locals: instruction %zu: %s: functions "
+                       "are not supported",
+                       i, u7_vm0_opcode_info(opcode)->name);
+    }
+  }
+  struct u7_vm0_packer self = {
+      .instructions = instructions,
+      .instructions_size = instructions_size,
+  };
+  error = u7_vm0_pack_find_groups(&self);
+  if (error.error_code != 0) {
+    u7_vm0_packer_destroy(&self);
+    return error;
+  }
+  const size_t n = instructions_size;
+  const size_t groups_size = (self.groups_size > 0 ? self.groups_size : 1);
+  self.group_words = (groups_size + 63) / 64;
+  self.blocks = malloc((n + 1) * sizeof(size_t));
+  self.block_of = malloc(n * sizeof(size_t));
+  self.live_in = malloc(n * self.group_words * sizeof(uint64_t));
+  self.live = malloc(self.group_words * sizeof(uint64_t));
+  self.observed = calloc(self.group_words, sizeof(uint64_t));
+  self.interference =
+      malloc(groups_size * self.group_words * sizeof(uint64_t));
+  self.slots = malloc(groups_size * sizeof(struct u7_vm0_pack_slot));
+  self.order = malloc(groups_size * sizeof(struct u7_vm0_pack_order));
+  if (self.blocks == NULL || self.block_of == NULL || self.live_in == NULL ||
+      self.live == NULL || self.observed == NULL ||
+      self.interference == NULL || self.slots == NULL || self.order == NULL) {
+    u7_vm0_packer_destroy(&self);
+    return u7_errnof(ENOMEM, "u7_vm0_pack_locals: out of memory");
+  }
+  for (size_t g = 0; g < self.groups_size; ++g) {
+    struct u7_vm0_pack_group const* group = &self.groups[g];
+    bool group_observed = (observed == NULL);
+    for (int64_t k = 0; !group_observed && k < group->size &&
+                        (uint64_t)(group->offset + k) <
+                            locals_frame_layout->locals_size;
+         ++k) {
+      group_observed = observed[group->offset + k];
+    }
+    if (group_observed) {
+      u7_vm0_pack_set(self.observed, g);
+    }
+  }
+  u7_vm0_pack_find_blocks(&self);
+  u7_vm0_pack_find_interference(&self);
+  const int64_t locals_size = u7_vm0_pack_assign(&self);
+  for (size_t i = 0; i < n; ++i) {
+    u7_vm0_pack_rewrite(&self, &instructions[i]);
+  }
+  if (offsets != NULL) {
+    for (size_t k = 0; k < locals_frame_layout->locals_size; ++k) {
+      offsets[k] = -1;
+    }
+    for (size_t g = 0; g < self.groups_size; ++g) {
+      struct u7_vm0_pack_group const* group = &self.groups[g];
+      for (int64_t k = 0; k < group->size &&
+                          (uint64_t)(group->offset + k) <
+                              locals_frame_layout->locals_size;
+           ++k) {
+        offsets[group->offset + k] = self.slots[group->slot].offset + k;
+      }
+    }
+  }
+  u7_vm0_packer_destroy(&self);
+  locals_frame_layout->locals_size = (size_t)locals_size;
+  return u7_vm0_verify(instructions, n, locals_frame_layout);
+}
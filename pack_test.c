@@ -0,0 +1,163 @@
+#include "@/public/pack.h"
+
+#include "@/public/assembler.h"
+#include "@/public/program.h"
+#include "@/public/vm0.h"
+#include "@/testing.h"
+
+#include <errno.h>
+#include <github.com/apronchenkov/error/public/error.h>
+#include <github.com/apronchenkov/vm/public/state.h>
+#include <github.com/apronchenkov/yalog/public/basic.h>
+#include <github.com/apronchenkov/yalog/public/logging_printf.h>
+#include <inttypes.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+
+// Tests for u7_vm0_pack_locals(): the packed programs write the same output
+// as the original ones, and the variables observed by the host keep their
+// values at `ret`.
+
+enum { TEST_MAX_LOCALS_SIZE = 64 };
+
+// Runs the program once, until `ret`. Returns the written value in *output
+// and the i64 variable at `result_offset` in *result.
+static u7_error run(struct u7_vm0_program const* program, int64_t input,
+                    int64_t result_offset, int64_t* output,
+                    int64_t* result) {
+  struct u7_vm0_test_state test_state;
+  u7_error error = u7_vm0_test_state_init(&test_state, program, program->js,
+                                          &input, 1, output, 1);
+  if (error.error_code != 0) {
+    return error;
+  }
+  u7_vm_state_run(&test_state.state);
+  error = u7_vm0_state_take_error(&test_state.state);
+  *result = *u7_vm0_state_local_i64(&test_state.state, result_offset);
+  if (error.error_code == 0 &&
+      u7_vm0_test_state_output_size(&test_state) != 1) {
+    error = u7_errnof(EINVAL, "run: expected a single value written");
+  }
+  u7_vm0_test_state_destroy(&test_state);
+  return error;
+}
+
+// Packs the program; the host observes the i64 variables at
+// `observed_offsets` (all the variables if NULL). Checks that both programs
+// write `expected` and agree on the values of the observed variables, and
+// that the packed frame is at most `max_locals_size` bytes.
+static u7_error check_pack(const char* name, const char* text,
+                           int64_t const* observed_offsets,
+                           size_t observed_size, size_t max_locals_size,
+                           int64_t input, int64_t expected) {
+  struct u7_vm0_program original;
+  u7_error error = u7_vm0_assemble(&original, text, strlen(text));
+  if (error.error_code != 0) {
+    return error;
+  }
+  struct u7_vm0_program packed;
+  error = u7_vm0_assemble(&packed, text, strlen(text));
+  if (error.error_code != 0) {
+    u7_vm0_program_destroy(&original);
+    return error;
+  }
+  const size_t locals_size = original.locals_frame_layout.locals_size;
+  bool observed[TEST_MAX_LOCALS_SIZE] = {false};
+  int64_t offsets[TEST_MAX_LOCALS_SIZE];
+  for (size_t k = 0; k < observed_size; ++k) {
+    memset(&observed[observed_offsets[k]], true, sizeof(int64_t));
+  }
+  error = u7_vm0_pack_locals(
+      packed.instructions, packed.instructions_size,
+      &packed.locals_frame_layout,
+      (observed_offsets != NULL ? observed : NULL), offsets);
+  if (error.error_code != 0) {
+    goto cleanup;
+  }
+  if (packed.locals_frame_layout.locals_size > max_locals_size) {
+    error = u7_errnof(EINVAL, "%s: packed to %zu bytes, expected at most %zu",
+                      name, packed.locals_frame_layout.locals_size,
+                      max_locals_size);
+    goto cleanup;
+  }
+  for (int64_t offset = 0; (size_t)offset < locals_size;
+       offset += sizeof(int64_t)) {
+    if (observed_offsets != NULL && !observed[offset]) {
+      continue;
+    }
+    int64_t lhs_output, rhs_output, lhs, rhs;
+    error = run(&original, input, offset, &lhs_output, &lhs);
+    if (error.error_code != 0) {
+      goto cleanup;
+    }
+    error = run(&packed, input, offsets[offset], &rhs_output, &rhs);
+    if (error.error_code != 0) {
+      goto cleanup;
+    }
+    if (lhs_output != expected || rhs_output != expected || lhs != rhs) {
+      error = u7_errnof(
+          EINVAL,
+          "%s: offset %" PRId64 " -> %" PRId64 ": expected %" PRId64
+          " written, got %" PRId64 " and %" PRId64 "; variable %" PRId64
+          " (original) and %" PRId64 " (packed)",
+          name, offset, offsets[offset], expected, lhs_output, rhs_output,
+          lhs, rhs);
+      goto cleanup;
+    }
+  }
+  YALOG_PRINTF(INFO, "%s: %zu -> %zu bytes\n", name, locals_size,
+               packed.locals_frame_layout.locals_size);
+cleanup:
+  u7_vm0_program_destroy(&packed);
+  u7_vm0_program_destroy(&original);
+  return error;
+}
+
+static const char straight_text[] =
+    "i64 a, r, t, c\n"
+    "read a\n"
+    "r = a + 1\n"
+    "t = 5\n"
+    "c = t + t\n"
+    "write c\n"
+    "ret\n";
+
+// The host reads `r` after `ret`, so it must not share a slot with `c`.
+static u7_error test_observe_all() {
+  return check_pack("observe_all", straight_text, NULL, 0, 32, 41, 10);
+}
+
+static u7_error test_observe_result() {
+  int64_t const observed_offsets[] = {24};  // c
+  return check_pack("observe_result", straight_text, observed_offsets, 1, 16,
+                    41, 10);
+}
+
+static u7_error test_loop() {
+  static const char text[] =
+      "i64 n, i, s, t, u\n"
+      "read n\n"
+      "i = 0\n"
+      "s = 0\n"
+      "loop: t = i * i\n"
+      "s = s + t\n"
+      "u = i & 1\n"
+      "s = s + u\n"
+      "i = i + 1\n"
+      "n = n + -1\n"
+      "jnz n, loop\n"
+      "write s\n"
+      "ret\n";
+  int64_t const observed_offsets[] = {16};  // s
+  return check_pack("loop", text, observed_offsets, 1, 32, 10, 290);
+}
+
+int main() {
+  u7_error (*const tests[])() = {
+      &test_observe_all,
+      &test_observe_result,
+      &test_loop,
+  };
+  return u7_vm0_test_main(tests, sizeof(tests) / sizeof(tests[0]));
+}
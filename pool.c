@@ -0,0 +1,128 @@
+#include "@/public/pool.h"
+
+#include <errno.h>
+#include <github.com/apronchenkov/error/public/error.h>
+#include <github.com/apronchenkov/vm/public/stack_push_pop.h>
+#include <github.com/apronchenkov/vm/public/state.h>
+#include <stdlib.h>
+#include <string.h>
+
+struct u7_vm0_pooled_state {
+  struct u7_vm_state state;  // Must be the first member.
+  struct u7_vm0_pooled_state* next;
+};
+
+static u7_error u7_vm0_state_pool_create(struct u7_vm0_state_pool* self,
+                                         struct u7_vm0_pooled_state** result) {
+  struct u7_vm0_pooled_state* pooled = malloc(sizeof(*pooled));
+  if (pooled == NULL) {
+    return u7_errnof(ENOMEM, "u7_vm0_state_pool: out of memory");
+  }
+  u7_error error =
+      u7_vm_state_init(&pooled->state, u7_vm0_globals_frame_layout, self->js,
+                       self->instructions_size);
+  if (error.error_code != 0) {
+    free(pooled);
+    return error;
+  }
+  error = u7_vm_stack_push_frame(&pooled->state.stack,
+                                 self->locals_frame_layout);
+  if (error.error_code != 0) {
+    u7_vm_state_destroy(&pooled->state);
+    free(pooled);
+    return error;
+  }
+  pooled->next = NULL;
+  *result = pooled;
+  return u7_ok();
+}
+
+u7_error u7_vm0_state_pool_init(
+    struct u7_vm0_state_pool* self, struct u7_vm_instruction const* const* js,
+    size_t instructions_size,
+    struct u7_vm_stack_frame_layout const* locals_frame_layout,
+    void const* locals_template) {
+  *self = (struct u7_vm0_state_pool){
+      .js = js,
+      .instructions_size = instructions_size,
+      .locals_frame_layout = locals_frame_layout,
+  };
+  if (locals_template != NULL) {
+    self->locals_template = malloc(locals_frame_layout->locals_size + 1);
+    if (self->locals_template == NULL) {
+      return u7_errnof(ENOMEM, "u7_vm0_state_pool_init: out of memory");
+    }
+    memcpy(self->locals_template, locals_template,
+           locals_frame_layout->locals_size);
+  }
+  // The first state is created eagerly, to learn the offset of the locals
+  // frame, which is the same for all the states.
+  struct u7_vm0_pooled_state* pooled;
+  u7_error error = u7_vm0_state_pool_create(self, &pooled);
+  if (error.error_code != 0) {
+    free(self->locals_template);
+    self->locals_template = NULL;
+    return error;
+  }
+  self->locals_base_offset = pooled->state.stack.base_offset;
+  self->free_states = pooled;
+  return u7_ok();
+}
+
+void u7_vm0_state_pool_destroy(struct u7_vm0_state_pool* self) {
+  while (self->free_states != NULL) {
+    struct u7_vm0_pooled_state* pooled = self->free_states;
+    self->free_states = pooled->next;
+    u7_vm_state_destroy(&pooled->state);
+    free(pooled);
+  }
+  free(self->locals_template);
+  self->locals_template = NULL;
+}
+
+void u7_vm0_state_pool_reset(struct u7_vm0_state_pool const* self,
+                             struct u7_vm_state* state) {
+  while (state->stack.base_offset > self->locals_base_offset) {
+    u7_vm_stack_pop_frame(&state->stack);
+  }
+  assert(state->stack.base_offset == self->locals_base_offset);
+  const size_t locals_size = self->locals_frame_layout->locals_size;
+  state->stack.top_offset = state->stack.base_offset +
+                            U7_VM_STACK_FRAME_HEADER_SIZE + locals_size;
+  state->ip = 0;
+  struct u7_vm0_globals* globals = u7_vm0_state_globals(state);
+  u7_vm0_state_clear_error(state);
+  globals->blocked = false;
+  globals->io_done = 0;
+  globals->call_depth = 0;
+  globals->input = self->input;
+  globals->output = self->output;
+  if (self->locals_template != NULL) {
+    memcpy(u7_vm_state_locals(state), self->locals_template, locals_size);
+  } else {
+    memset(u7_vm_state_locals(state), 0, locals_size);
+  }
+}
+
+u7_error u7_vm0_state_pool_acquire(struct u7_vm0_state_pool* self,
+                                   struct u7_vm_state** result) {
+  struct u7_vm0_pooled_state* pooled = self->free_states;
+  if (pooled != NULL) {
+    self->free_states = pooled->next;
+  } else {
+    u7_error error = u7_vm0_state_pool_create(self, &pooled);
+    if (error.error_code != 0) {
+      return error;
+    }
+  }
+  u7_vm0_state_pool_reset(self, &pooled->state);
+  *result = &pooled->state;
+  return u7_ok();
+}
+
+void u7_vm0_state_pool_release(struct u7_vm0_state_pool* self,
+                               struct u7_vm_state* state) {
+  struct u7_vm0_pooled_state* pooled = (struct u7_vm0_pooled_state*)state;
+  pooled->next = self->free_states;
+  self->free_states = pooled;
+}
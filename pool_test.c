@@ -0,0 +1,303 @@
+#include "@/public/pool.h"
+
+#include "@/public/program.h"
+#include "@/public/vm0.h"
+#include "@/testing.h"
+
+#include <errno.h>
+#include <github.com/apronchenkov/error/public/error.h>
+#include <github.com/apronchenkov/vm/public/state.h>
+#include <inttypes.h>
+#include <stdint.h>
+#include <string.h>
+
+// Tests for u7_vm0_state_pool: an acquired state, whether new or reused, and
+// a reset one, whatever its condition, runs the program from the beginning
+// with the initial locals.
+
+// Locals of both functions: `n` and three scratch slots.
+static const struct u7_vm_stack_frame_layout frame_layout = {
+    .locals_size = 4 * sizeof(int64_t),
+    .description = "pool_test",
+};
+
+static struct u7_vm0_arg i64_variable(int64_t index) {
+  return (struct u7_vm0_arg){.kind = U7_VM0_ARG_KIND_I64_VARIABLE,
+                             .value.i64 = index * (int64_t)sizeof(int64_t)};
+}
+
+static struct u7_vm0_arg label(int64_t index) {
+  return (struct u7_vm0_arg){.kind = U7_VM0_ARG_KIND_I64_LABEL,
+                             .value.i64 = index};
+}
+
+// Writes square(n), where square yields before it multiplies: a state that
+// has yielded is inside the call.
+static u7_error square_program_init(struct u7_vm0_program* program) {
+  const struct u7_vm0_arg n = i64_variable(0);
+  u7_error error = u7_ok();
+  const struct u7_vm0_instruction instructions[] = {
+      u7_vm0_call(&error, label(3), &frame_layout, n, 1),
+      u7_vm0_output(&error, n),
+      u7_vm0_ret(),
+      // square(n):
+      u7_vm0_yield(),
+      u7_vm0_math_multiply(&error, n, n, n),
+      u7_vm0_ret_value(&error, n),
+  };
+  if (error.error_code != 0) {
+    return error;
+  }
+  return u7_vm0_test_program_init(
+      program, instructions, sizeof(instructions) / sizeof(instructions[0]),
+      &frame_layout);
+}
+
+// A pool of the square program, with `n` = 3 initially, that writes into
+// `output`.
+struct fixture {
+  struct u7_vm0_program program;
+  struct u7_vm0_state_pool pool;
+  struct u7_vm0_memory_output output;
+  int64_t values[8];
+};
+
+static u7_error fixture_init(struct fixture* self) {
+  u7_error error = square_program_init(&self->program);
+  if (error.error_code != 0) {
+    return error;
+  }
+  int64_t const locals_template[4] = {3, 0, 0, 0};
+  error = u7_vm0_state_pool_init(&self->pool, self->program.js,
+                                 self->program.instructions_size,
+                                 &frame_layout, locals_template);
+  if (error.error_code != 0) {
+    u7_vm0_program_destroy(&self->program);
+    return error;
+  }
+  u7_vm0_memory_output_init(&self->output, self->values,
+                            sizeof(self->values));
+  self->pool.output = &self->output.base;
+  return u7_ok();
+}
+
+static void fixture_destroy(struct fixture* self) {
+  u7_error_release(u7_vm0_memory_output_destroy(&self->output));
+  u7_vm0_state_pool_destroy(&self->pool);
+  u7_vm0_program_destroy(&self->program);
+}
+
+// Checks that the state is at the beginning of the program, in the locals
+// frame, without a failure, and with `n` = 3.
+static u7_error expect_initial(const char* name, struct fixture* self,
+                               struct u7_vm_state* state) {
+  struct u7_vm0_globals const* globals = u7_vm0_state_globals(state);
+  int64_t const* locals = (int64_t const*)u7_vm_state_locals(state);
+  if (state->ip != 0 ||
+      state->stack.base_offset != self->pool.locals_base_offset ||
+      u7_vm0_state_failed(state) || globals->blocked ||
+      globals->call_depth != 0 || globals->output != &self->output.base) {
+    return u7_errnof(EINVAL, "%s: the state is not reset", name);
+  }
+  if (locals[0] != 3 || locals[1] != 0 || locals[2] != 0 || locals[3] != 0) {
+    return u7_errnof(EINVAL, "%s: the locals are not restored", name);
+  }
+  return u7_ok();
+}
+
+// Runs the state to `ret`, resuming it after `yield`, and checks that it
+// writes 9.
+static u7_error expect_square(const char* name, struct fixture* self,
+                              struct u7_vm_state* state) {
+  const size_t size =
+      u7_vm0_memory_output_size(&self->output) / sizeof(int64_t);
+  do {
+    u7_vm_state_run(state);
+  } while (state->ip != 0 && !u7_vm0_state_failed(state));
+  u7_error error = u7_vm0_state_take_error(state);
+  if (error.error_code != 0) {
+    return error;
+  }
+  if (u7_vm0_memory_output_size(&self->output) / sizeof(int64_t) !=
+          size + 1 ||
+      self->values[size] != 9) {
+    return u7_errnof(EINVAL, "%s: expected 9 written", name);
+  }
+  return u7_ok();
+}
+
+// A released state is reused, with the initial locals; a state that is
+// still acquired is not.
+static u7_error test_reuse() {
+  static struct fixture fixture;
+  u7_error error = fixture_init(&fixture);
+  if (error.error_code != 0) {
+    return error;
+  }
+  struct u7_vm_state* first;
+  struct u7_vm_state* second;
+  error = u7_vm0_state_pool_acquire(&fixture.pool, &first);
+  if (error.error_code != 0) {
+    fixture_destroy(&fixture);
+    return error;
+  }
+  error = u7_vm0_state_pool_acquire(&fixture.pool, &second);
+  if (error.error_code != 0) {
+    u7_vm0_state_pool_release(&fixture.pool, first);
+    fixture_destroy(&fixture);
+    return error;
+  }
+  if (first == second) {
+    error = u7_errnof(EINVAL, "reuse: a state is acquired twice");
+  }
+  if (error.error_code == 0) {
+    error = expect_square("reuse: first", &fixture, first);
+  }
+  u7_vm0_state_pool_release(&fixture.pool, first);
+  struct u7_vm_state* third;
+  if (error.error_code == 0) {
+    error = u7_vm0_state_pool_acquire(&fixture.pool, &third);
+    if (error.error_code == 0) {
+      if (third != first) {
+        error = u7_errnof(EINVAL, "reuse: the released state is not reused");
+      }
+      if (error.error_code == 0) {
+        error = expect_initial("reuse: third", &fixture, third);
+      }
+      if (error.error_code == 0) {
+        error = expect_square("reuse: third", &fixture, third);
+      }
+      u7_vm0_state_pool_release(&fixture.pool, third);
+    }
+  }
+  if (error.error_code == 0) {
+    error = expect_square("reuse: second", &fixture, second);
+  }
+  u7_vm0_state_pool_release(&fixture.pool, second);
+  fixture_destroy(&fixture);
+  return error;
+}
+
+// A state that has yielded inside the call is reset to the locals frame.
+static u7_error test_reset_in_call() {
+  static struct fixture fixture;
+  u7_error error = fixture_init(&fixture);
+  if (error.error_code != 0) {
+    return error;
+  }
+  struct u7_vm_state* state;
+  error = u7_vm0_state_pool_acquire(&fixture.pool, &state);
+  if (error.error_code != 0) {
+    fixture_destroy(&fixture);
+    return error;
+  }
+  u7_vm_state_run(state);
+  if (state->ip != 4 || u7_vm0_state_globals(state)->call_depth != 1) {
+    error = u7_errnof(EINVAL, "reset_in_call: expected to yield in the call");
+  }
+  if (error.error_code == 0) {
+    u7_vm0_state_pool_reset(&fixture.pool, state);
+    error = expect_initial("reset_in_call", &fixture, state);
+  }
+  if (error.error_code == 0) {
+    error = expect_square("reset_in_call", &fixture, state);
+  }
+  u7_vm0_state_pool_release(&fixture.pool, state);
+  fixture_destroy(&fixture);
+  return error;
+}
+
+// A state that has failed inside the call is reset without the failure, and
+// runs again; so does a released failed state.
+static u7_error test_reset_after_fault() {
+  static struct fixture fixture;
+  u7_error error = fixture_init(&fixture);
+  if (error.error_code != 0) {
+    return error;
+  }
+  struct u7_vm_state* state;
+  error = u7_vm0_state_pool_acquire(&fixture.pool, &state);
+  if (error.error_code != 0) {
+    fixture_destroy(&fixture);
+    return error;
+  }
+  for (int round = 0; round < 2 && error.error_code == 0; ++round) {
+    int64_t* locals = (int64_t*)u7_vm_state_locals(state);
+    locals[0] = INT64_C(1) << 40;
+    locals[3] = -1;
+    // Yields in the call, then overflows.
+    u7_vm_state_run(state);
+    u7_vm_state_run(state);
+    struct u7_vm0_globals const* globals = u7_vm0_state_globals(state);
+    if (globals->fault.error_code != ERANGE) {
+      error = u7_errnof(EINVAL,
+                        "reset_after_fault: expected an overflow in the call");
+    }
+    if (error.error_code == 0 && round == 0) {
+      u7_vm0_state_pool_reset(&fixture.pool, state);
+    } else if (error.error_code == 0) {
+      struct u7_vm_state* failed = state;
+      u7_vm0_state_pool_release(&fixture.pool, failed);
+      error = u7_vm0_state_pool_acquire(&fixture.pool, &state);
+      if (error.error_code != 0) {
+        state = NULL;
+      } else if (state != failed) {
+        error = u7_errnof(EINVAL, "reset_after_fault: not reused");
+      }
+    }
+    if (error.error_code == 0) {
+      error = expect_initial("reset_after_fault", &fixture, state);
+    }
+    if (error.error_code == 0) {
+      error = expect_square("reset_after_fault", &fixture, state);
+    }
+  }
+  if (state != NULL) {
+    u7_vm0_state_pool_release(&fixture.pool, state);
+  }
+  fixture_destroy(&fixture);
+  return error;
+}
+
+// Without a template, the locals are zeroed.
+static u7_error test_zero_locals() {
+  struct u7_vm0_program program;
+  u7_error error = square_program_init(&program);
+  if (error.error_code != 0) {
+    return error;
+  }
+  struct u7_vm0_state_pool pool;
+  error = u7_vm0_state_pool_init(&pool, program.js, program.instructions_size,
+                                 &frame_layout, NULL);
+  if (error.error_code != 0) {
+    u7_vm0_program_destroy(&program);
+    return error;
+  }
+  struct u7_vm_state* state;
+  error = u7_vm0_state_pool_acquire(&pool, &state);
+  if (error.error_code == 0) {
+    int64_t* locals = (int64_t*)u7_vm_state_locals(state);
+    memset(locals, 0xAB, frame_layout.locals_size);
+    u7_vm0_state_pool_reset(&pool, state);
+    for (size_t i = 0; i < 4 && error.error_code == 0; ++i) {
+      if (locals[i] != 0) {
+        error = u7_errnof(EINVAL, "zero_locals: local %zu: %" PRId64, i,
+                          locals[i]);
+      }
+    }
+    u7_vm0_state_pool_release(&pool, state);
+  }
+  u7_vm0_state_pool_destroy(&pool);
+  u7_vm0_program_destroy(&program);
+  return error;
+}
+
+int main() {
+  u7_error (*const tests[])() = {
+      &test_reuse,
+      &test_reset_in_call,
+      &test_reset_after_fault,
+      &test_zero_locals,
+  };
+  return u7_vm0_test_main(tests, sizeof(tests) / sizeof(tests[0]));
+}
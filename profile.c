@@ -0,0 +1,255 @@
+#include "@/public/profile.h"
+
+#include <errno.h>
+#include <github.com/apronchenkov/error/public/error.h>
+#include <github.com/apronchenkov/vm/public/instruction.h>
+#include <github.com/apronchenkov/vm/public/state.h>
+#include <inttypes.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#else
+#include <time.h>
+#endif
+
+struct u7_vm0_profile_trampoline {
+  struct u7_vm_instruction base;
+  struct u7_vm_instruction const* target;
+  struct u7_vm0_profile_entry* entry;
+};
+
+static inline uint64_t u7_vm0_profile_clock(void) {
+#if defined(__x86_64__) || defined(__i386__)
+  return __rdtsc();
+#else
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000 + (uint64_t)ts.tv_nsec;
+#endif
+}
+
+U7_VM_DEFINE_INSTRUCTION_EXEC(u7_vm0_profile_count_exec,
+                              struct u7_vm0_profile_trampoline) {
+  self->entry->count += 1;
+  return self->target->execute_fn(state, self->target);
+}
+
+U7_VM_DEFINE_INSTRUCTION_EXEC(u7_vm0_profile_count_cycles_exec,
+                              struct u7_vm0_profile_trampoline) {
+  const uint64_t start = u7_vm0_profile_clock();
+  const bool result = self->target->execute_fn(state, self->target);
+  self->entry->count += 1;
+  self->entry->cycles += u7_vm0_profile_clock() - start;
+  return result;
+}
+
+u7_error u7_vm0_profile_init(struct u7_vm0_profile* self,
+                             struct u7_vm0_instruction const* instructions,
+                             size_t instructions_size, bool measure_cycles) {
+  const size_t n = instructions_size;
+  char* memory = malloc(n * (sizeof(struct u7_vm0_profile_trampoline) +
+                             sizeof(struct u7_vm_instruction const*) +
+                             sizeof(struct u7_vm0_profile_entry)) +
+                        1);
+  if (memory == NULL) {
+    return u7_errnof(ENOMEM, "u7_vm0_profile_init: out of memory");
+  }
+  struct u7_vm0_profile_trampoline* trampolines =
+      (struct u7_vm0_profile_trampoline*)memory;
+  self->instructions = instructions;
+  self->instructions_size = n;
+  self->js = (struct u7_vm_instruction const**)(trampolines + n);
+  self->entries = (struct u7_vm0_profile_entry*)(self->js + n);
+  self->measure_cycles = measure_cycles;
+  self->memory = memory;
+  for (size_t i = 0; i < n; ++i) {
+    trampolines[i].base.execute_fn =
+        (measure_cycles ? u7_vm0_profile_count_cycles_exec
+                        : u7_vm0_profile_count_exec);
+    trampolines[i].target = &instructions[i].base;
+    trampolines[i].entry = &self->entries[i];
+    self->js[i] = &trampolines[i].base;
+  }
+  u7_vm0_profile_reset(self);
+  return u7_ok();
+}
+
+void u7_vm0_profile_destroy(struct u7_vm0_profile* self) {
+  free(self->memory);
+  self->memory = NULL;
+  self->js = NULL;
+  self->entries = NULL;
+  self->instructions = NULL;
+  self->instructions_size = 0;
+}
+
+void u7_vm0_profile_reset(struct u7_vm0_profile* self) {
+  memset(self->entries, 0,
+         self->instructions_size * sizeof(struct u7_vm0_profile_entry));
+}
+
+void u7_vm0_profile_opcode_entries(
+    struct u7_vm0_profile const* self,
+    struct u7_vm0_profile_entry result[U7_VM0_OPCODE_COUNT]) {
+  memset(result, 0, U7_VM0_OPCODE_COUNT * sizeof(struct u7_vm0_profile_entry));
+  for (size_t i = 0; i < self->instructions_size; ++i) {
+    const enum u7_vm0_opcode opcode =
+        u7_vm0_instruction_opcode(&self->instructions[i]);
+    if (opcode != U7_VM0_OPCODE_UNKNOWN) {
+      result[opcode].count += self->entries[i].count;
+      result[opcode].cycles += self->entries[i].cycles;
+    }
+  }
+}
+
+// Returns the label operand of the instruction, or -1.
+static int64_t u7_vm0_profile_label(
+    struct u7_vm0_instruction const* instruction) {
+  const enum u7_vm0_opcode opcode = u7_vm0_instruction_opcode(instruction);
+  if (opcode == U7_VM0_OPCODE_UNKNOWN) {
+    return -1;
+  }
+  union u7_vm0_value const args[3] = {instruction->arg1, instruction->arg2,
+                                      instruction->arg3};
+  for (int i = 0; i < 3; ++i) {
+    if (u7_vm0_opcode_info(opcode)->operand_kinds[i] ==
+        U7_VM0_OPERAND_LABEL) {
+      return args[i].i64;
+    }
+  }
+  return -1;
+}
+
+struct u7_vm0_profile_row {
+  uint64_t key;
+  size_t first;
+  size_t last;
+  struct u7_vm0_profile_entry entry;
+};
+
+// Orders rows by decreasing key, then by position.
+static int u7_vm0_profile_row_compare(void const* lhs, void const* rhs) {
+  struct u7_vm0_profile_row const* a = lhs;
+  struct u7_vm0_profile_row const* b = rhs;
+  if (a->key != b->key) {
+    return (a->key > b->key ? -1 : 1);
+  }
+  if (a->first != b->first) {
+    return (a->first < b->first ? -1 : 1);
+  }
+  return (a->last < b->last ? -1 : (a->last > b->last ? 1 : 0));
+}
+
+static double u7_vm0_profile_percent(uint64_t value, uint64_t total) {
+  return (total == 0 ? 0.0 : 100.0 * (double)value / (double)total);
+}
+
+static void u7_vm0_profile_print_entry(struct u7_vm0_profile const* self,
+                                       struct u7_vm0_profile_entry entry,
+                                       struct u7_vm0_profile_entry total,
+                                       FILE* file) {
+  fprintf(file, " %14" PRIu64 " %6.2f%%", entry.count,
+          u7_vm0_profile_percent(entry.count, total.count));
+  if (self->measure_cycles) {
+    fprintf(file, " %16" PRIu64 " %6.2f%% %10.1f", entry.cycles,
+            u7_vm0_profile_percent(entry.cycles, total.cycles),
+            (entry.count == 0 ? 0.0
+                              : (double)entry.cycles / (double)entry.count));
+  }
+}
+
+void u7_vm0_profile_report(struct u7_vm0_profile const* self, FILE* file) {
+  const size_t n = self->instructions_size;
+  struct u7_vm0_profile_entry total = {0, 0};
+  for (size_t i = 0; i < n; ++i) {
+    total.count += self->entries[i].count;
+    total.cycles += self->entries[i].cycles;
+  }
+  const char* const header =
+      (self->measure_cycles ? "          count       %           cycles"
+                              "       %  cycles/op"
+                            : "          count       %");
+  // Instructions.
+  bool* is_target = calloc(n + 1, sizeof(bool));
+  struct u7_vm0_profile_row* rows =
+      malloc((n > U7_VM0_OPCODE_COUNT ? n : U7_VM0_OPCODE_COUNT) *
+                 sizeof(struct u7_vm0_profile_row) +
+             1);
+  if (is_target == NULL || rows == NULL) {
+    fprintf(file, "u7_vm0_profile_report: out of memory\n");
+    free(is_target);
+    free(rows);
+    return;
+  }
+  for (size_t i = 0; i < n; ++i) {
+    const int64_t label = u7_vm0_profile_label(&self->instructions[i]);
+    if (label >= 0 && (uint64_t)label < n) {
+      is_target[label] = true;
+    }
+  }
+  fprintf(file, "Instructions:\n  index  label  %-36s%s\n", "opcode", header);
+  for (size_t i = 0; i < n; ++i) {
+    const enum u7_vm0_opcode opcode =
+        u7_vm0_instruction_opcode(&self->instructions[i]);
+    char label[32] = "";
+    if (is_target[i]) {
+      snprintf(label, sizeof(label), "L%zu:", i);
+    }
+    const char* name =
+        (opcode == U7_VM0_OPCODE_UNKNOWN ? "?"
+                                         : u7_vm0_opcode_info(opcode)->name);
+    fprintf(file, "  %5zu  %-6s %-36s", i, label, name);
+    u7_vm0_profile_print_entry(self, self->entries[i], total, file);
+    fprintf(file, "\n");
+  }
+  // Opcodes.
+  struct u7_vm0_profile_entry opcode_entries[U7_VM0_OPCODE_COUNT];
+  u7_vm0_profile_opcode_entries(self, opcode_entries);
+  size_t rows_size = 0;
+  for (int i = 0; i < U7_VM0_OPCODE_COUNT; ++i) {
+    if (opcode_entries[i].count > 0) {
+      rows[rows_size++] = (struct u7_vm0_profile_row){
+          .key = (self->measure_cycles ? opcode_entries[i].cycles
+                                       : opcode_entries[i].count),
+          .first = (size_t)i,
+          .entry = opcode_entries[i],
+      };
+    }
+  }
+  qsort(rows, rows_size, sizeof(*rows), u7_vm0_profile_row_compare);
+  fprintf(file, "Opcodes:\n  %-51s%s\n", "opcode", header);
+  for (size_t i = 0; i < rows_size; ++i) {
+    fprintf(file, "  %-51s", u7_vm0_opcode_info(rows[i].first)->name);
+    u7_vm0_profile_print_entry(self, rows[i].entry, total, file);
+    fprintf(file, "\n");
+  }
+  // Loops: the ranges [label, index] of the backward jumps.
+  rows_size = 0;
+  for (size_t i = 0; i < n; ++i) {
+    const int64_t label = u7_vm0_profile_label(&self->instructions[i]);
+    if (label < 0 || (uint64_t)label > i) {
+      continue;
+    }
+    struct u7_vm0_profile_row row = {.first = (size_t)label, .last = i};
+    for (size_t j = row.first; j <= row.last; ++j) {
+      row.entry.count += self->entries[j].count;
+      row.entry.cycles += self->entries[j].cycles;
+    }
+    row.key = (self->measure_cycles ? row.entry.cycles : row.entry.count);
+    rows[rows_size++] = row;
+  }
+  qsort(rows, rows_size, sizeof(*rows), u7_vm0_profile_row_compare);
+  fprintf(file, "Loops:\n  %-22s %14s%s\n", "range", "iterations", header);
+  for (size_t i = 0; i < rows_size; ++i) {
+    char range[64];
+    snprintf(range, sizeof(range), "L%zu..%zu", rows[i].first, rows[i].last);
+    fprintf(file, "  %-22s %14" PRIu64, range,
+            self->entries[rows[i].last].count);
+    u7_vm0_profile_print_entry(self, rows[i].entry, total, file);
+    fprintf(file, "\n");
+  }
+  free(is_target);
+  free(rows);
+}
@@ -0,0 +1,82 @@
+#include "@/public/profile.h"
+
+#include "@/public/assembler.h"
+#include "@/public/opcode.h"
+#include "@/public/program.h"
+#include "@/testing.h"
+
+#include <errno.h>
+#include <github.com/apronchenkov/error/public/error.h>
+#include <inttypes.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+
+// Tests for u7_vm0_profile: a profiled program behaves as the original one,
+// and the counters match the executed instructions.
+
+// The verified jump table reads the labels of its entries; under the
+// profiler, the instruction pointers of the state are trampolines.
+static u7_error test_jump_table() {
+  static const char text[] =
+      "i64 s, r\n"
+      "read s\n"
+      "switch s, other, zero, one, two\n"
+      "other: r = -1\n"
+      "jmp done\n"
+      "zero: r = 10\n"
+      "jmp done\n"
+      "one: r = 11\n"
+      "jmp done\n"
+      "two: r = 12\n"
+      "done: write r\n"
+      "ret\n";
+  int64_t const inputs[] = {0, 1, 2, 3, -1};
+  int64_t const expected[] = {10, 11, 12, -1, -1};
+  const size_t size = sizeof(inputs) / sizeof(inputs[0]);
+  struct u7_vm0_program program;
+  u7_error error = u7_vm0_assemble(&program, text, strlen(text));
+  if (error.error_code != 0) {
+    return error;
+  }
+  size_t jump_table = 0;
+  while (!u7_vm0_opcode_is_jump_table(
+      u7_vm0_instruction_opcode(&program.instructions[jump_table]))) {
+    ++jump_table;
+  }
+  struct u7_vm0_profile profile;
+  error = u7_vm0_profile_init(&profile, program.instructions,
+                              program.instructions_size, false);
+  if (error.error_code != 0) {
+    u7_vm0_program_destroy(&program);
+    return error;
+  }
+  for (size_t i = 0; i < size && error.error_code == 0; ++i) {
+    int64_t lhs, rhs;
+    error = u7_vm0_test_run_single(&program, program.js, inputs[i], &lhs);
+    if (error.error_code == 0) {
+      error = u7_vm0_test_run_single(&program, profile.js, inputs[i], &rhs);
+    }
+    if (error.error_code == 0 && (lhs != expected[i] || rhs != expected[i])) {
+      error = u7_errnof(EINVAL,
+                        "jump_table: input %" PRId64 ": expected %" PRId64
+                        ", got %" PRId64 " and %" PRId64 " (profiled)",
+                        inputs[i], expected[i], lhs, rhs);
+    }
+  }
+  if (error.error_code == 0 && profile.entries[jump_table].count != size) {
+    error = u7_errnof(EINVAL,
+                      "jump_table: executed %" PRIu64 " times, expected %zu",
+                      profile.entries[jump_table].count, size);
+  }
+  u7_vm0_profile_destroy(&profile);
+  u7_vm0_program_destroy(&program);
+  return error;
+}
+
+int main() {
+  u7_error (*const tests[])() = {
+      &test_jump_table,
+  };
+  return u7_vm0_test_main(tests, sizeof(tests) / sizeof(tests[0]));
+}
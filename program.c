@@ -0,0 +1,305 @@
+#include "@/public/program.h"
+
+#include "@/public/opcode.h"
+#include "@/public/verify.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <github.com/apronchenkov/error/public/error.h>
+#include <inttypes.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+static const char u7_vm0_program_magic[8] = {'U', '7', 'V', 'M',
+                                             '0', 'P', 'R', 'G'};
+
+enum {
+  U7_VM0_PROGRAM_HEADER_SIZE = 48,
+  U7_VM0_PROGRAM_INSTRUCTION_SIZE = 32,
+};
+
+static void u7_vm0_store_le32(char* p, uint32_t value) {
+  if (__BYTE_ORDER__ == __ORDER_BIG_ENDIAN__) {
+    value = __builtin_bswap32(value);
+  }
+  memcpy(p, &value, sizeof(value));
+}
+
+static void u7_vm0_store_le64(char* p, uint64_t value) {
+  if (__BYTE_ORDER__ == __ORDER_BIG_ENDIAN__) {
+    value = __builtin_bswap64(value);
+  }
+  memcpy(p, &value, sizeof(value));
+}
+
+static uint32_t u7_vm0_load_le32(char const* p) {
+  uint32_t value;
+  memcpy(&value, p, sizeof(value));
+  if (__BYTE_ORDER__ == __ORDER_BIG_ENDIAN__) {
+    value = __builtin_bswap32(value);
+  }
+  return value;
+}
+
+static uint64_t u7_vm0_load_le64(char const* p) {
+  uint64_t value;
+  memcpy(&value, p, sizeof(value));
+  if (__BYTE_ORDER__ == __ORDER_BIG_ENDIAN__) {
+    value = __builtin_bswap64(value);
+  }
+  return value;
+}
+
+static size_t u7_vm0_align8(size_t size) { return (size + 7) & ~(size_t)7; }
+
+u7_error u7_vm0_program_write(
+    const char* path, struct u7_vm0_instruction const* instructions,
+    size_t instructions_size,
+    struct u7_vm_stack_frame_layout const* locals_frame_layout) {
+  // Only the opcodes used by the program go to the name table.
+  int name_indices[U7_VM0_OPCODE_COUNT];
+  for (int i = 0; i < U7_VM0_OPCODE_COUNT; ++i) {
+    name_indices[i] = -1;
+  }
+  uint32_t opcode_names_size = 0;
+  size_t names_bytes = 0;
+  for (size_t i = 0; i < instructions_size; ++i) {
+    const enum u7_vm0_opcode opcode =
+        u7_vm0_instruction_opcode(&instructions[i]);
+    if (opcode == U7_VM0_OPCODE_UNKNOWN) {
+      return u7_errnof(EINVAL, "u7_vm0_program_write: instruction %zu: unknown",
+                       i);
+    }
+    if (u7_vm0_opcode_is_call(opcode)) {
+      return u7_errnof(EINVAL,
+                       "u7_vm0_program_write: instruction %zu: %s: frame "
+                       "layouts cannot be serialized",
+                       i, u7_vm0_opcode_info(opcode)->name);
+    }
+    if (name_indices[opcode] < 0) {
+      name_indices[opcode] = (int)opcode_names_size++;
+      names_bytes += 1 + strlen(u7_vm0_opcode_info(opcode)->name);
+    }
+  }
+  const char* description = locals_frame_layout->description;
+  const size_t description_size =
+      (description != NULL ? strlen(description) : 0);
+  const size_t instructions_offset = u7_vm0_align8(
+      U7_VM0_PROGRAM_HEADER_SIZE + names_bytes + description_size);
+  const size_t size = instructions_offset +
+                      instructions_size * U7_VM0_PROGRAM_INSTRUCTION_SIZE;
+  char* buffer = calloc(1, size);
+  if (buffer == NULL) {
+    return u7_errnof(ENOMEM, "u7_vm0_program_write: out of memory");
+  }
+  memcpy(buffer, u7_vm0_program_magic, sizeof(u7_vm0_program_magic));
+  u7_vm0_store_le32(buffer + 8, U7_VM0_PROGRAM_VERSION);
+  u7_vm0_store_le32(buffer + 12, opcode_names_size);
+  u7_vm0_store_le64(buffer + 16, instructions_size);
+  u7_vm0_store_le64(buffer + 24, locals_frame_layout->locals_size);
+  u7_vm0_store_le64(buffer + 32, locals_frame_layout->extra_capacity);
+  u7_vm0_store_le32(buffer + 40, (uint32_t)description_size);
+  char* p = buffer + U7_VM0_PROGRAM_HEADER_SIZE;
+  for (uint32_t k = 0; k < opcode_names_size; ++k) {
+    for (int i = 0; i < U7_VM0_OPCODE_COUNT; ++i) {
+      if (name_indices[i] == (int)k) {
+        const char* name = u7_vm0_opcode_info((enum u7_vm0_opcode)i)->name;
+        const size_t name_size = strlen(name);
+        *p++ = (char)(uint8_t)name_size;
+        memcpy(p, name, name_size);
+        p += name_size;
+        break;
+      }
+    }
+  }
+  if (description_size > 0) {
+    memcpy(p, description, description_size);
+  }
+  p = buffer + instructions_offset;
+  for (size_t i = 0; i < instructions_size; ++i) {
+    const enum u7_vm0_opcode opcode =
+        u7_vm0_instruction_opcode(&instructions[i]);
+    u7_vm0_store_le32(p, (uint32_t)name_indices[opcode]);
+    u7_vm0_store_le64(p + 8, (uint64_t)instructions[i].arg1.i64);
+    u7_vm0_store_le64(p + 16, (uint64_t)instructions[i].arg2.i64);
+    u7_vm0_store_le64(p + 24, (uint64_t)instructions[i].arg3.i64);
+    p += U7_VM0_PROGRAM_INSTRUCTION_SIZE;
+  }
+
+  u7_error error = u7_ok();
+  const int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+  if (fd < 0) {
+    error = u7_errnof(errno, "u7_vm0_program_write: open failed: %s", path);
+  }
+  for (size_t offset = 0; fd >= 0 && offset < size;) {
+    const ssize_t n = write(fd, buffer + offset, size - offset);
+    if (n < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      error = u7_errnof(errno, "u7_vm0_program_write: write failed: %s", path);
+      break;
+    }
+    offset += (size_t)n;
+  }
+  if (fd >= 0 && close(fd) != 0 && error.error_code == 0) {
+    error = u7_errnof(errno, "u7_vm0_program_write: close failed: %s", path);
+  }
+  free(buffer);
+  return error;
+}
+
+u7_error u7_vm0_program_load_memory(struct u7_vm0_program* self,
+                                    void const* data, size_t size) {
+  char const* const begin = (char const*)data;
+  if (size < U7_VM0_PROGRAM_HEADER_SIZE ||
+      memcmp(begin, u7_vm0_program_magic, sizeof(u7_vm0_program_magic)) !=
+          0) {
+    return u7_errnof(EINVAL, "u7_vm0_program_load: not a program file");
+  }
+  const uint32_t version = u7_vm0_load_le32(begin + 8);
+  if (version != U7_VM0_PROGRAM_VERSION) {
+    return u7_errnof(EINVAL, "u7_vm0_program_load: unsupported version: %u",
+                     (unsigned)version);
+  }
+  const uint32_t opcode_names_size = u7_vm0_load_le32(begin + 12);
+  const uint64_t instructions_size = u7_vm0_load_le64(begin + 16);
+  const uint64_t locals_size = u7_vm0_load_le64(begin + 24);
+  const uint64_t extra_capacity = u7_vm0_load_le64(begin + 32);
+  const uint32_t description_size = u7_vm0_load_le32(begin + 40);
+
+  if (opcode_names_size > size - U7_VM0_PROGRAM_HEADER_SIZE) {
+    return u7_errnof(EINVAL, "u7_vm0_program_load: truncated name table");
+  }
+  enum u7_vm0_opcode* opcodes =
+      malloc(((size_t)opcode_names_size + 1) * sizeof(enum u7_vm0_opcode));
+  if (opcodes == NULL) {
+    return u7_errnof(ENOMEM, "u7_vm0_program_load: out of memory");
+  }
+  size_t offset = U7_VM0_PROGRAM_HEADER_SIZE;
+  for (uint32_t k = 0; k < opcode_names_size; ++k) {
+    if (offset >= size ||
+        size - offset - 1 < (size_t)(uint8_t)begin[offset]) {
+      free(opcodes);
+      return u7_errnof(EINVAL, "u7_vm0_program_load: truncated name table");
+    }
+    const size_t name_size = (uint8_t)begin[offset];
+    opcodes[k] = u7_vm0_opcode_by_name(begin + offset + 1, name_size);
+    if (opcodes[k] == U7_VM0_OPCODE_UNKNOWN) {
+      free(opcodes);
+      return u7_errnof(EINVAL, "u7_vm0_program_load: unknown opcode: %.*s",
+                       (int)name_size, begin + offset + 1);
+    }
+    if (u7_vm0_opcode_is_call(opcodes[k])) {
+      // A frame layout operand is a pointer, which cannot be trusted.
+      free(opcodes);
+      return u7_errnof(EINVAL,
+                       "u7_vm0_program_load: unsupported opcode: %.*s",
+                       (int)name_size, begin + offset + 1);
+    }
+    offset += 1 + name_size;
+  }
+  if (size - offset < description_size) {
+    free(opcodes);
+    return u7_errnof(EINVAL, "u7_vm0_program_load: truncated description");
+  }
+  char const* const description = begin + offset;
+  offset = u7_vm0_align8(offset + description_size);
+  if (offset > size || (size - offset) / U7_VM0_PROGRAM_INSTRUCTION_SIZE <
+                           instructions_size) {
+    free(opcodes);
+    return u7_errnof(EINVAL, "u7_vm0_program_load: truncated instructions");
+  }
+
+  // A single allocation for the instructions, the pointer array and the
+  // description.
+  const size_t n = (size_t)instructions_size;
+  char* memory = malloc(n * sizeof(struct u7_vm0_instruction) +
+                        n * sizeof(struct u7_vm_instruction const*) +
+                        description_size + 1);
+  if (memory == NULL) {
+    free(opcodes);
+    return u7_errnof(ENOMEM, "u7_vm0_program_load: out of memory");
+  }
+  self->memory = memory;
+  self->instructions = (struct u7_vm0_instruction*)memory;
+  self->js = (struct u7_vm_instruction const**)(
+      memory + n * sizeof(struct u7_vm0_instruction));
+  self->instructions_size = n;
+  char* description_copy = (char*)(self->js + n);
+  memcpy(description_copy, description, description_size);
+  description_copy[description_size] = '\0';
+  self->locals_frame_layout = (struct u7_vm_stack_frame_layout){
+      .locals_size = (size_t)locals_size,
+      .deinit_fn = NULL,
+      .extra_capacity = (size_t)extra_capacity,
+      .description = description_copy,
+  };
+  char const* p = begin + offset;
+  for (size_t i = 0; i < n; ++i) {
+    const uint32_t name_index = u7_vm0_load_le32(p);
+    if (name_index >= opcode_names_size) {
+      free(opcodes);
+      u7_vm0_program_destroy(self);
+      return u7_errnof(EINVAL,
+                       "u7_vm0_program_load: instruction %zu: bad opcode "
+                       "index: %" PRIu32,
+                       i, name_index);
+    }
+    self->instructions[i].base = u7_vm0_opcode_info(opcodes[name_index])->base;
+    self->instructions[i].arg1.i64 = (int64_t)u7_vm0_load_le64(p + 8);
+    self->instructions[i].arg2.i64 = (int64_t)u7_vm0_load_le64(p + 16);
+    self->instructions[i].arg3.i64 = (int64_t)u7_vm0_load_le64(p + 24);
+    self->js[i] = &self->instructions[i].base;
+    p += U7_VM0_PROGRAM_INSTRUCTION_SIZE;
+  }
+  free(opcodes);
+  u7_error error = u7_vm0_verify(self->instructions, self->instructions_size,
+                                 &self->locals_frame_layout);
+  if (error.error_code != 0) {
+    u7_vm0_program_destroy(self);
+  }
+  return error;
+}
+
+u7_error u7_vm0_program_load(struct u7_vm0_program* self, const char* path) {
+  const int fd = open(path, O_RDONLY | O_CLOEXEC);
+  if (fd < 0) {
+    return u7_errnof(errno, "u7_vm0_program_load: open failed: %s", path);
+  }
+  struct stat st;
+  if (fstat(fd, &st) != 0) {
+    const int error_code = errno;
+    close(fd);
+    return u7_errnof(error_code, "u7_vm0_program_load: fstat failed: %s",
+                     path);
+  }
+  const size_t size = (size_t)st.st_size;
+  void* mapping = NULL;
+  if (size > 0) {
+    mapping = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (mapping == MAP_FAILED) {
+      const int error_code = errno;
+      close(fd);
+      return u7_errnof(error_code, "u7_vm0_program_load: mmap failed: %s",
+                       path);
+    }
+  }
+  close(fd);
+  u7_error error = u7_vm0_program_load_memory(self, mapping, size);
+  if (mapping != NULL) {
+    munmap(mapping, size);
+  }
+  return error;
+}
+
+void u7_vm0_program_destroy(struct u7_vm0_program* self) {
+  free(self->memory);
+  self->memory = NULL;
+  self->instructions = NULL;
+  self->js = NULL;
+  self->instructions_size = 0;
+}
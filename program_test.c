@@ -0,0 +1,273 @@
+#include "@/public/program.h"
+
+#include "@/public/assembler.h"
+#include "@/public/vm0.h"
+#include "@/testing.h"
+
+#include <errno.h>
+#include <github.com/apronchenkov/error/public/error.h>
+#include <inttypes.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+// Tests for the serialized program format: a written program loads back
+// and runs the same, and a truncated or corrupt image is rejected without
+// reading outside of it.
+
+static const char sum_text[] =
+    "i64 n, s\n"
+    "read n\n"
+    "s = 0\n"
+    "jz n, done\n"
+    "loop: s = s + n\n"
+    "n = n + -1\n"
+    "jnz n, loop\n"
+    "done: write s\n"
+    "ret\n";
+
+// Writes the program to a temporary file and reads the file into *image,
+// which the caller frees.
+static u7_error write_image(struct u7_vm0_program const* program,
+                            char** image, size_t* image_size) {
+  char path[] = "/tmp/u7_vm0_program_test_XXXXXX";
+  const int fd = mkstemp(path);
+  if (fd < 0) {
+    return u7_errnof(errno, "write_image: mkstemp failed");
+  }
+  close(fd);
+  u7_error error =
+      u7_vm0_program_write(path, program->instructions,
+                           program->instructions_size,
+                           &program->locals_frame_layout);
+  FILE* file = (error.error_code == 0 ? fopen(path, "rb") : NULL);
+  if (error.error_code == 0 && file == NULL) {
+    error = u7_errnof(errno, "write_image: fopen failed");
+  }
+  if (file != NULL) {
+    *image = malloc(4096);
+    *image_size = fread(*image, 1, 4096, file);
+    if (!feof(file)) {
+      error = u7_errnof(EFBIG, "write_image: the image is too large");
+    }
+    fclose(file);
+    if (error.error_code != 0) {
+      free(*image);
+    }
+  }
+  unlink(path);
+  return error;
+}
+
+// Loads a copy of the first `size` bytes of the image, so that the sanitizers
+// catch a read past its end. The loaded program is destroyed.
+static u7_error load_prefix(char const* image, size_t size) {
+  char* copy = malloc(size > 0 ? size : 1);
+  if (copy == NULL) {
+    return u7_errnof(ENOMEM, "load_prefix: out of memory");
+  }
+  memcpy(copy, image, size);
+  struct u7_vm0_program program;
+  u7_error error = u7_vm0_program_load_memory(&program, copy, size);
+  if (error.error_code == 0) {
+    u7_vm0_program_destroy(&program);
+  }
+  free(copy);
+  return error;
+}
+
+static u7_error test_round_trip() {
+  struct u7_vm0_program original;
+  u7_error error = u7_vm0_assemble(&original, sum_text, strlen(sum_text));
+  if (error.error_code != 0) {
+    return error;
+  }
+  char path[] = "/tmp/u7_vm0_program_test_XXXXXX";
+  const int fd = mkstemp(path);
+  if (fd < 0) {
+    u7_vm0_program_destroy(&original);
+    return u7_errnof(errno, "round_trip: mkstemp failed");
+  }
+  close(fd);
+  error = u7_vm0_program_write(path, original.instructions,
+                               original.instructions_size,
+                               &original.locals_frame_layout);
+  struct u7_vm0_program loaded;
+  if (error.error_code == 0) {
+    error = u7_vm0_program_load(&loaded, path);
+  }
+  unlink(path);
+  if (error.error_code != 0) {
+    u7_vm0_program_destroy(&original);
+    return error;
+  }
+  if (loaded.instructions_size != original.instructions_size ||
+      loaded.locals_frame_layout.locals_size !=
+          original.locals_frame_layout.locals_size ||
+      strcmp(loaded.locals_frame_layout.description,
+             original.locals_frame_layout.description) != 0) {
+    error = u7_errnof(EINVAL, "round_trip: the program has changed");
+  }
+  int64_t const inputs[] = {0, 1, 100};
+  for (size_t i = 0; i < 3 && error.error_code == 0; ++i) {
+    int64_t lhs, rhs;
+    error = u7_vm0_test_run_single(&original, original.js, inputs[i], &lhs);
+    if (error.error_code == 0) {
+      error = u7_vm0_test_run_single(&loaded, loaded.js, inputs[i], &rhs);
+    }
+    if (error.error_code == 0 && lhs != rhs) {
+      error = u7_errnof(EINVAL,
+                        "round_trip: input %" PRId64 ": %" PRId64
+                        " (original) and %" PRId64 " (loaded)",
+                        inputs[i], lhs, rhs);
+    }
+  }
+  u7_vm0_program_destroy(&loaded);
+  u7_vm0_program_destroy(&original);
+  return error;
+}
+
+// Every proper prefix of an image is rejected.
+static u7_error test_truncated() {
+  struct u7_vm0_program program;
+  u7_error error = u7_vm0_assemble(&program, sum_text, strlen(sum_text));
+  if (error.error_code != 0) {
+    return error;
+  }
+  char* image;
+  size_t image_size;
+  error = write_image(&program, &image, &image_size);
+  u7_vm0_program_destroy(&program);
+  if (error.error_code != 0) {
+    return error;
+  }
+  error = load_prefix(image, image_size);
+  for (size_t size = 0; size < image_size && error.error_code == 0; ++size) {
+    char name[64];
+    snprintf(name, sizeof(name), "truncated: %zu of %zu bytes", size,
+             image_size);
+    error = u7_vm0_test_expect_error(name, load_prefix(image, size), EINVAL);
+  }
+  free(image);
+  return error;
+}
+
+// Sets the bytes [offset, offset + size) of a copy of the image to `value`
+// and checks that the load fails with `error_code`.
+static u7_error expect_corrupt(const char* name, char const* image,
+                               size_t image_size, size_t offset, size_t size,
+                               int value, int error_code) {
+  char* copy = malloc(image_size);
+  if (copy == NULL) {
+    return u7_errnof(ENOMEM, "%s: out of memory", name);
+  }
+  memcpy(copy, image, image_size);
+  memset(copy + offset, value, size);
+  u7_error error = u7_vm0_test_expect_error(
+      name, load_prefix(copy, image_size), error_code);
+  free(copy);
+  return error;
+}
+
+static u7_error test_corrupt() {
+  struct u7_vm0_program program;
+  u7_error error = u7_vm0_assemble(&program, sum_text, strlen(sum_text));
+  if (error.error_code != 0) {
+    return error;
+  }
+  char* image;
+  size_t image_size;
+  error = write_image(&program, &image, &image_size);
+  u7_vm0_program_destroy(&program);
+  if (error.error_code != 0) {
+    return error;
+  }
+  // The instructions are at the end of the image, 32 bytes each.
+  const size_t last = image_size - 32;
+  struct {
+    const char* name;
+    size_t offset;
+    size_t size;
+    int value;
+    int error_code;
+  } const cases[] = {
+      {"corrupt: magic", 0, 1, 'X', EINVAL},
+      {"corrupt: version", 8, 4, 0x7F, EINVAL},
+      {"corrupt: name table size", 12, 4, 0xFF, EINVAL},
+      {"corrupt: instructions size", 16, 8, 0x7F, EINVAL},
+      {"corrupt: description size", 40, 4, 0xFF, EINVAL},
+      {"corrupt: opcode name", 48 + 1, 1, 'Z', EINVAL},
+      {"corrupt: opcode name size", 48, 1, 0xFF, EINVAL},
+      {"corrupt: opcode index", last, 4, 0x7F, EINVAL},
+      // The verifier rejects the operands that point outside of the program
+      // or of the locals frame. `ret` takes no operands; the instruction
+      // before it is `write s`, and the one before that is `jnz n, loop`.
+      {"corrupt: variable offset", last - 32 + 8, 8, 0x7F, ERANGE},
+      {"corrupt: label", last - 2 * 32 + 16, 8, 0x7F, ERANGE},
+  };
+  for (size_t i = 0;
+       i < sizeof(cases) / sizeof(cases[0]) && error.error_code == 0; ++i) {
+    error = expect_corrupt(cases[i].name, image, image_size, cases[i].offset,
+                           cases[i].size, cases[i].value,
+                           cases[i].error_code);
+  }
+  // Any single damaged byte either leaves a valid program or is rejected.
+  for (size_t offset = 0; offset < image_size && error.error_code == 0;
+       ++offset) {
+    image[offset] ^= 0xA5;
+    u7_error load_error = load_prefix(image, image_size);
+    image[offset] ^= 0xA5;
+    if (load_error.error_code != 0 && load_error.error_code != EINVAL &&
+        load_error.error_code != ERANGE) {
+      error = u7_errnof(EINVAL, "corrupt: byte %zu: %" U7_ERROR_FMT, offset,
+                        U7_ERROR_FMT_PARAMS(load_error));
+    }
+    u7_error_release(load_error);
+  }
+  free(image);
+  return error;
+}
+
+// The frame layouts of the calls are pointers; such programs are not
+// written.
+static u7_error test_call_not_written() {
+  static const struct u7_vm_stack_frame_layout frame_layout = {
+      .locals_size = sizeof(int64_t),
+  };
+  const struct u7_vm0_arg n = {.kind = U7_VM0_ARG_KIND_I64_VARIABLE,
+                               .value.i64 = 0};
+  const struct u7_vm0_arg label = {.kind = U7_VM0_ARG_KIND_I64_LABEL,
+                                   .value.i64 = 2};
+  u7_error error = u7_ok();
+  const struct u7_vm0_instruction instructions[] = {
+      u7_vm0_call(&error, label, &frame_layout, n, 1),
+      u7_vm0_ret(),
+      u7_vm0_ret(),
+  };
+  if (error.error_code != 0) {
+    return error;
+  }
+  return u7_vm0_test_expect_error(
+      "call_not_written",
+      u7_vm0_program_write("/tmp/u7_vm0_program_test_call", instructions, 3,
+                           &frame_layout),
+      EINVAL);
+}
+
+static u7_error test_missing_file() {
+  struct u7_vm0_program program;
+  return u7_vm0_test_expect_error(
+      "missing_file",
+      u7_vm0_program_load(&program, "/nonexistent/u7_vm0_program_test"),
+      ENOENT);
+}
+
+int main() {
+  u7_error (*const tests[])() = {
+      &test_round_trip,       &test_truncated,     &test_corrupt,
+      &test_call_not_written, &test_missing_file,
+  };
+  return u7_vm0_test_main(tests, sizeof(tests) / sizeof(tests[0]));
+}
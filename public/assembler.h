@@ -0,0 +1,51 @@
+#ifndef U7_VM0_ASSEMBLER_H_
+#define U7_VM0_ASSEMBLER_H_
+
+#include "@/public/program.h"
+
+#include <github.com/apronchenkov/error/public/error.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif  // __cplusplus
+
+// Assembles a program from text, one statement per line:
+//
+//   # Comment (also: // comment).
+//   i64 n, t         -- local declarations: i32, i64, f32 or f64;
+//   f64 v[4]         -- an array; `v` is `v[0]`, `v[2]` is its third element.
+//   loop:            -- a label; may be followed by a statement.
+//   read n           -- input
+//   read v, 4        -- input of consecutive variables
+//   write x          -- output of a variable or a constant
+//   write v, 4       -- output of consecutive variables
+//   x = 1            -- copy
+//   x = a + b        -- math_add; also `*`, `&`, `<<` and `>>`
+//   jz t, next       -- jump_if_zero
+//   jnz n, loop      -- jump_if_not_zero
+//   jmp loop         -- jump
+//   if i < n goto loop
+//                    -- jump_if_less; also `<=`, `>`, `>=`, `==` and `!=`
+//   switch s, other, a, b, c
+//                    -- jump_table: to a, b or c if s is 0, 1 or 2, and to
+//                       `other` otherwise
+//   yield
+//   ret
+//
+// Constants take the type of the destination (of the left-hand side, in
+// comparisons); a constant passed to `write` is i64 or f64, depending on its
+// spelling. Locals must be declared before they are used; labels may be used
+// before they are defined.
+//
+// The text is processed in a single pass, in linear time, without
+// allocations per token. The resulting program is verified with
+// u7_vm0_verify(); its locals frame layout holds the declared locals.
+u7_error u7_vm0_assemble(struct u7_vm0_program* program, const char* text,
+                         size_t text_size);
+
+#ifdef __cplusplus
+}  // extern "C"
+#endif  // __cplusplus
+
+#endif  // U7_VM0_ASSEMBLER_H_
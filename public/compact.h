@@ -0,0 +1,61 @@
+#ifndef U7_VM0_COMPACT_H_
+#define U7_VM0_COMPACT_H_
+
+#include "@/public/vm0.h"
+
+#include <github.com/apronchenkov/error/public/error.h>
+#include <github.com/apronchenkov/vm/public/state.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif  // __cplusplus
+
+// Compact form of a program: 8 bytes per instruction instead of 32 (plus
+// the pointer array), so that hot loops occupy fewer cache lines.
+//
+// Variable offsets, labels and counts are stored in the operands directly;
+// constants, packed variable pairs, frame layouts and call slots are stored
+// in a side pool and the operands hold their indices.
+
+struct u7_vm0_compact_instruction {
+  uint16_t opcode;  // enum u7_vm0_opcode
+  uint16_t args[3];
+};
+
+struct u7_vm0_compact_program {
+  struct u7_vm0_compact_instruction* instructions;
+  size_t instructions_size;
+  union u7_vm0_value* constants;
+  size_t constants_size;
+};
+
+// Encodes an instruction array. Fails with ERANGE if an operand does not fit
+// into 16 bits, or with E2BIG if the program has too many instructions or
+// constants.
+u7_error u7_vm0_compact_program_init(
+    struct u7_vm0_compact_program* self,
+    struct u7_vm0_instruction const* instructions, size_t instructions_size);
+
+void u7_vm0_compact_program_destroy(struct u7_vm0_compact_program* self);
+
+// Returns the regular form of an instruction.
+struct u7_vm0_instruction u7_vm0_compact_program_decode(
+    struct u7_vm0_compact_program const* self, size_t index);
+
+// Counterpart of u7_vm_state_run(): executes the program from state->ip
+// until `yield`, `ret` or a panic. Errors are reported through
+// u7_vm0_globals (see u7_vm0_state_take_error()), exactly as by the regular
+// dispatch loop.
+//
+// The state must have been initialized with the same number of
+// instructions as the compact program.
+void u7_vm0_compact_run(struct u7_vm0_compact_program const* program,
+                        struct u7_vm_state* state);
+
+#ifdef __cplusplus
+}  // extern "C"
+#endif  // __cplusplus
+
+#endif  // U7_VM0_COMPACT_H_
@@ -0,0 +1,36 @@
+#ifndef U7_VM0_FUSE_H_
+#define U7_VM0_FUSE_H_
+
+#include "@/public/vm0.h"
+
+#include <github.com/apronchenkov/error/public/error.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif  // __cplusplus
+
+// Peephole pass that replaces common pairs of adjacent instructions with
+// fused instructions, dispatched once:
+//
+//   t = n & c; jz/jnz t, L        -> bitwise_and_jump_if_[not_]zero
+//   n = n >> c; jnz n, L          -> bitwise_right_shift_jump_if_not_zero
+//   n = n << c; jnz n, L          -> bitwise_left_shift_jump_if_not_zero
+//   s = a * b; x = s + c          -> math_multiply_add (f64)
+//   s0 = a * b; s1 = c * d        -> math_multiply_2 (f64)
+//   x0 = a + b; x1 = c + d        -> math_add_2 (f64)
+//
+// The fused instructions have exactly the semantics of the original pairs
+// (all the intermediate variables are still written). A pair is not fused if
+// its second instruction is a jump target. Labels are remapped to the
+// compacted program and *instructions_size is updated.
+//
+// The program must have passed u7_vm0_verify(); the result stays verified.
+u7_error u7_vm0_fuse(struct u7_vm0_instruction* instructions,
+                     size_t* instructions_size);
+
+#ifdef __cplusplus
+}  // extern "C"
+#endif  // __cplusplus
+
+#endif  // U7_VM0_FUSE_H_
@@ -2,6 +2,8 @@
 #define U7_VM0_INPUT_H_
 
 #include <github.com/apronchenkov/error/public/error.h>
+#include <stdbool.h>
+#include <stddef.h>
 #include <stdint.h>
 
 #ifdef __cplusplus
@@ -19,15 +21,104 @@ typedef u7_error (*u7_vm0_input_read_f32_fn_t)(struct u7_vm0_input* self,
 typedef u7_error (*u7_vm0_input_read_f64_fn_t)(struct u7_vm0_input* self,
                                                double* result);
 
+// Batch versions: read `count` consecutive values, and store the number of
+// values read in *done, also on failure.
+typedef u7_error (*u7_vm0_input_read_i32_n_fn_t)(struct u7_vm0_input* self,
+                                                 int32_t* result,
+                                                 size_t count, size_t* done);
+typedef u7_error (*u7_vm0_input_read_i64_n_fn_t)(struct u7_vm0_input* self,
+                                                 int64_t* result,
+                                                 size_t count, size_t* done);
+typedef u7_error (*u7_vm0_input_read_f32_n_fn_t)(struct u7_vm0_input* self,
+                                                 float* result, size_t count,
+                                                 size_t* done);
+typedef u7_error (*u7_vm0_input_read_f64_n_fn_t)(struct u7_vm0_input* self,
+                                                 double* result,
+                                                 size_t count, size_t* done);
+
+// A backend that cannot proceed without blocking may fail with EAGAIN; the
+// program then stops, and the instruction is retried when it is resumed
+// (see u7_vm0_globals.blocked). A scalar function must have read nothing in
+// that call. A batch function may have read a prefix of the values, which
+// it reports in *done; the retry reads only the rest (see
+// u7_vm0_globals.io_done).
 struct u7_vm0_input {
   u7_vm0_input_read_i32_fn_t read_i32_fn;
   u7_vm0_input_read_i64_fn_t read_i64_fn;
   u7_vm0_input_read_f32_fn_t read_f32_fn;
   u7_vm0_input_read_f64_fn_t read_f64_fn;
+
+  // Optional; NULL means that the values are read one at a time.
+  u7_vm0_input_read_i32_n_fn_t read_i32_n_fn;
+  u7_vm0_input_read_i64_n_fn_t read_i64_n_fn;
+  u7_vm0_input_read_f32_n_fn_t read_f32_n_fn;
+  u7_vm0_input_read_f64_n_fn_t read_f64_n_fn;
 };
 
+// Reads `count` values, through the batch function if the input has one,
+// and stores the number of values read in *done.
+#define U7_VM0_DEFINE_INPUT_READ_N(type_name, type)                          \
+  static inline u7_error u7_vm0_input_read_##type_name##_n(                  \
+      struct u7_vm0_input* self, type* result, size_t count, size_t* done) { \
+    if (self->read_##type_name##_n_fn != NULL) {                             \
+      return self->read_##type_name##_n_fn(self, result, count, done);       \
+    }                                                                        \
+    for (*done = 0; *done < count; ++*done) {                                \
+      u7_error error = self->read_##type_name##_fn(self, &result[*done]);    \
+      if (error.error_code != 0) {                                           \
+        return error;                                                        \
+      }                                                                      \
+    }                                                                        \
+    return u7_ok();                                                          \
+  }
+
+U7_VM0_DEFINE_INPUT_READ_N(i32, int32_t)
+U7_VM0_DEFINE_INPUT_READ_N(i64, int64_t)
+U7_VM0_DEFINE_INPUT_READ_N(f32, float)
+U7_VM0_DEFINE_INPUT_READ_N(f64, double)
+
+#undef U7_VM0_DEFINE_INPUT_READ_N
+
 extern struct u7_vm0_input u7_vm0_input_scanf;
 
+// Reads whitespace-separated values from a file descriptor through a large
+// buffer, with a hand-rolled parser instead of scanf. The buffer is
+// allocated once, in u7_vm0_buffered_input_init().
+struct u7_vm0_buffered_input {
+  struct u7_vm0_input base;
+  int fd;
+  char* buffer;
+  size_t capacity;
+  size_t begin;  // The first unread byte.
+  size_t end;    // The end of the data read from fd.
+  bool eof;
+};
+
+u7_error u7_vm0_buffered_input_init(struct u7_vm0_buffered_input* self,
+                                    int fd, size_t capacity);
+
+void u7_vm0_buffered_input_destroy(struct u7_vm0_buffered_input* self);
+
+// Reads raw little-endian values from a memory span, without parsing or
+// copying the data.
+struct u7_vm0_memory_input {
+  struct u7_vm0_input base;
+  char const* cursor;
+  char const* end;
+  void* mapping;  // Owned mapping, if initialized from a file.
+  size_t mapping_size;
+};
+
+// The span is provided by the caller and must outlive the input.
+void u7_vm0_memory_input_init(struct u7_vm0_memory_input* self,
+                              void const* data, size_t size);
+
+// Maps the file read-only.
+u7_error u7_vm0_memory_input_init_file(struct u7_vm0_memory_input* self,
+                                       const char* path);
+
+void u7_vm0_memory_input_destroy(struct u7_vm0_memory_input* self);
+
 #ifdef __cplusplus
 }  // extern "C"
 #endif  // __cplusplus
@@ -0,0 +1,55 @@
+#ifndef U7_VM0_JIT_H_
+#define U7_VM0_JIT_H_
+
+#include "@/public/vm0.h"
+
+#include <github.com/apronchenkov/error/public/error.h>
+#include <github.com/apronchenkov/vm/public/state.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif  // __cplusplus
+
+// Baseline JIT: translates a program to x86-64 machine code, one native
+// sequence per instruction. The locals base and the state are kept in
+// callee-saved registers. Copies, bitwise_and, shifts by constants,
+// math_add and math_multiply (with the same overflow panics), jumps,
+// compare-and-branches, jump tables, yield and the fused instructions of
+// u7_vm0_fuse() are compiled natively; every other instruction, and the slow
+// paths of the native ones, call the regular execute_fn.
+//
+// Available on x86-64 only; elsewhere u7_vm0_jit_program_init() fails with
+// ENOTSUP.
+
+struct u7_vm0_jit_program {
+  void* code;  // Executable mapping.
+  size_t code_size;
+  void const** entries;  // Native address of every instruction.
+  struct u7_vm0_instruction* instructions;  // Used by the fallbacks.
+  size_t instructions_size;
+};
+
+// Compiles a program that has passed u7_vm0_verify(). The instructions are
+// copied, so the source array does not need to outlive the compiled program.
+u7_error u7_vm0_jit_program_init(struct u7_vm0_jit_program* self,
+                                 struct u7_vm0_instruction const* instructions,
+                                 size_t instructions_size);
+
+void u7_vm0_jit_program_destroy(struct u7_vm0_jit_program* self);
+
+// Counterpart of u7_vm_state_run(): executes the program from state->ip
+// until `yield`, `ret` or a panic. Errors are reported through
+// u7_vm0_globals (see u7_vm0_state_take_error()), exactly as by the regular
+// dispatch loop.
+//
+// The state must have been initialized with the same number of
+// instructions as the compiled program.
+void u7_vm0_jit_run(struct u7_vm0_jit_program const* program,
+                    struct u7_vm_state* state);
+
+#ifdef __cplusplus
+}  // extern "C"
+#endif  // __cplusplus
+
+#endif  // U7_VM0_JIT_H_
@@ -0,0 +1,561 @@
+#ifndef U7_VM0_OPCODE_H_
+#define U7_VM0_OPCODE_H_
+
+#include "@/public/vm0.h"
+
+#include <github.com/apronchenkov/vm/public/instruction.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif  // __cplusplus
+
+// Kinds of the instruction operands (arg1, arg2, arg3).
+enum u7_vm0_operand_kind {
+  U7_VM0_OPERAND_NONE,
+  U7_VM0_OPERAND_I32_CONSTANT,
+  U7_VM0_OPERAND_I64_CONSTANT,
+  U7_VM0_OPERAND_F32_CONSTANT,
+  U7_VM0_OPERAND_F64_CONSTANT,
+  U7_VM0_OPERAND_I32_SRC,  // Offset of a local variable that is read.
+  U7_VM0_OPERAND_I64_SRC,
+  U7_VM0_OPERAND_F32_SRC,
+  U7_VM0_OPERAND_F64_SRC,
+  U7_VM0_OPERAND_I32_DST,  // Offset of a local variable that is written.
+  U7_VM0_OPERAND_I64_DST,
+  U7_VM0_OPERAND_F32_DST,
+  U7_VM0_OPERAND_F64_DST,
+  U7_VM0_OPERAND_LABEL,  // Index of an instruction.
+  // Two local variables packed by u7_vm0_operand_pair(first, second).
+  U7_VM0_OPERAND_I32_DST_SRC_PAIR,  // The first is written, the second read.
+  U7_VM0_OPERAND_I64_DST_SRC_PAIR,
+  U7_VM0_OPERAND_F64_SRC_PAIR,  // Both are read.
+  U7_VM0_OPERAND_F64_DST_PAIR,  // Both are written.
+  // Offset of consecutive local variables; the next operand is the count.
+  U7_VM0_OPERAND_I32_SRC_ARRAY,
+  U7_VM0_OPERAND_I64_SRC_ARRAY,
+  U7_VM0_OPERAND_F32_SRC_ARRAY,
+  U7_VM0_OPERAND_F64_SRC_ARRAY,
+  U7_VM0_OPERAND_I32_DST_ARRAY,
+  U7_VM0_OPERAND_I64_DST_ARRAY,
+  U7_VM0_OPERAND_F32_DST_ARRAY,
+  U7_VM0_OPERAND_F64_DST_ARRAY,
+  U7_VM0_OPERAND_F32_DST_SRC_ARRAY,  // Both read and written.
+  U7_VM0_OPERAND_F64_DST_SRC_ARRAY,
+  // Number of the array elements (or of the jump table entries);
+  // non-negative.
+  U7_VM0_OPERAND_COUNT,
+  // Offsets of two arrays packed by u7_vm0_operand_pair(first, second); both
+  // are read, and the count is the COUNT operand of the instruction.
+  U7_VM0_OPERAND_I64_SRC_ARRAY_PAIR,
+  U7_VM0_OPERAND_F32_SRC_ARRAY_PAIR,
+  U7_VM0_OPERAND_F64_SRC_ARRAY_PAIR,
+  // Pointer to a struct u7_vm_stack_frame_layout; see u7_vm0_call().
+  U7_VM0_OPERAND_FRAME_LAYOUT,
+  // Consecutive 8-byte slots packed by u7_vm0_operand_pair(offset, count);
+  // the slots are read, and the first one receives the result of a call.
+  U7_VM0_OPERAND_SLOTS,
+};
+
+// X-macro with all instruction variants:
+//   X(OPCODE, exec_name, arg1_kind, arg2_kind, arg3_kind)
+#define U7_VM0_OPCODES(X)                                                     \
+  X(YIELD, yield, NONE, NONE, NONE)                                           \
+  X(RET, ret, NONE, NONE, NONE)                                               \
+  X(RET_I32V, ret_i32v, I32_SRC, NONE, NONE)                                  \
+  X(RET_I64V, ret_i64v, I64_SRC, NONE, NONE)                                  \
+  X(RET_F32V, ret_f32v, F32_SRC, NONE, NONE)                                  \
+  X(RET_F64V, ret_f64v, F64_SRC, NONE, NONE)                                  \
+  X(CALL, call, LABEL, FRAME_LAYOUT, SLOTS)                                   \
+  X(TAIL_CALL, tail_call, LABEL, FRAME_LAYOUT, SLOTS)                         \
+  X(INPUT_I32V, input_i32v, I32_DST, NONE, NONE)                              \
+  X(INPUT_I64V, input_i64v, I64_DST, NONE, NONE)                              \
+  X(INPUT_F32V, input_f32v, F32_DST, NONE, NONE)                              \
+  X(INPUT_F64V, input_f64v, F64_DST, NONE, NONE)                              \
+  X(OUTPUT_I32C, output_i32c, I32_CONSTANT, NONE, NONE)                       \
+  X(OUTPUT_I64C, output_i64c, I64_CONSTANT, NONE, NONE)                       \
+  X(OUTPUT_F32C, output_f32c, F32_CONSTANT, NONE, NONE)                       \
+  X(OUTPUT_F64C, output_f64c, F64_CONSTANT, NONE, NONE)                       \
+  X(OUTPUT_I32V, output_i32v, I32_SRC, NONE, NONE)                            \
+  X(OUTPUT_I64V, output_i64v, I64_SRC, NONE, NONE)                            \
+  X(OUTPUT_F32V, output_f32v, F32_SRC, NONE, NONE)                            \
+  X(OUTPUT_F64V, output_f64v, F64_SRC, NONE, NONE)                            \
+  X(INPUT_N_I32V, input_n_i32v, I32_DST_ARRAY, COUNT, NONE)                   \
+  X(INPUT_N_I64V, input_n_i64v, I64_DST_ARRAY, COUNT, NONE)                   \
+  X(INPUT_N_F32V, input_n_f32v, F32_DST_ARRAY, COUNT, NONE)                   \
+  X(INPUT_N_F64V, input_n_f64v, F64_DST_ARRAY, COUNT, NONE)                   \
+  X(OUTPUT_N_I32V, output_n_i32v, I32_SRC_ARRAY, COUNT, NONE)                 \
+  X(OUTPUT_N_I64V, output_n_i64v, I64_SRC_ARRAY, COUNT, NONE)                 \
+  X(OUTPUT_N_F32V, output_n_f32v, F32_SRC_ARRAY, COUNT, NONE)                 \
+  X(OUTPUT_N_F64V, output_n_f64v, F64_SRC_ARRAY, COUNT, NONE)                 \
+  X(COPY_I32C, copy_i32c, I32_DST, I32_CONSTANT, NONE)                        \
+  X(COPY_I64C, copy_i64c, I64_DST, I64_CONSTANT, NONE)                        \
+  X(COPY_F32C, copy_f32c, F32_DST, F32_CONSTANT, NONE)                        \
+  X(COPY_F64C, copy_f64c, F64_DST, F64_CONSTANT, NONE)                        \
+  X(COPY_I32V, copy_i32v, I32_DST, I32_SRC, NONE)                             \
+  X(COPY_I64V, copy_i64v, I64_DST, I64_SRC, NONE)                             \
+  X(COPY_F32V, copy_f32v, F32_DST, F32_SRC, NONE)                             \
+  X(COPY_F64V, copy_f64v, F64_DST, F64_SRC, NONE)                             \
+  X(BITWISE_AND_I32VC, bitwise_and_i32vc, I32_DST, I32_SRC, I32_CONSTANT)     \
+  X(BITWISE_AND_I64VC, bitwise_and_i64vc, I64_DST, I64_SRC, I64_CONSTANT)     \
+  X(BITWISE_AND_I32VV, bitwise_and_i32vv, I32_DST, I32_SRC, I32_SRC)          \
+  X(BITWISE_AND_I64VV, bitwise_and_i64vv, I64_DST, I64_SRC, I64_SRC)          \
+  X(BITWISE_LEFT_SHIFT_I32CV, bitwise_left_shift_i32cv, I32_DST,              \
+    I32_CONSTANT, I32_SRC)                                                    \
+  X(BITWISE_LEFT_SHIFT_I32VC, bitwise_left_shift_i32vc, I32_DST, I32_SRC,     \
+    I32_CONSTANT)                                                             \
+  X(BITWISE_RIGHT_SHIFT_I32VC, bitwise_right_shift_i32vc, I32_DST, I32_SRC,   \
+    I32_CONSTANT)                                                             \
+  X(BITWISE_LEFT_SHIFT_I32VV, bitwise_left_shift_i32vv, I32_DST, I32_SRC,     \
+    I32_SRC)                                                                  \
+  X(BITWISE_LEFT_SHIFT_I64CV, bitwise_left_shift_i64cv, I64_DST,              \
+    I64_CONSTANT, I64_SRC)                                                    \
+  X(BITWISE_LEFT_SHIFT_I64VC, bitwise_left_shift_i64vc, I64_DST, I64_SRC,     \
+    I64_CONSTANT)                                                             \
+  X(BITWISE_RIGHT_SHIFT_I64VC, bitwise_right_shift_i64vc, I64_DST, I64_SRC,   \
+    I64_CONSTANT)                                                             \
+  X(BITWISE_LEFT_SHIFT_I64VV, bitwise_left_shift_i64vv, I64_DST, I64_SRC,     \
+    I64_SRC)                                                                  \
+  X(MATH_ADD_I32VC, math_add_i32vc, I32_DST, I32_SRC, I32_CONSTANT)           \
+  X(MATH_ADD_I32VV, math_add_i32vv, I32_DST, I32_SRC, I32_SRC)                \
+  X(MATH_ADD_I64VC, math_add_i64vc, I64_DST, I64_SRC, I64_CONSTANT)           \
+  X(MATH_ADD_I64VV, math_add_i64vv, I64_DST, I64_SRC, I64_SRC)                \
+  X(MATH_ADD_F32VC, math_add_f32vc, F32_DST, F32_SRC, F32_CONSTANT)           \
+  X(MATH_ADD_F32VV, math_add_f32vv, F32_DST, F32_SRC, F32_SRC)                \
+  X(MATH_ADD_F64VC, math_add_f64vc, F64_DST, F64_SRC, F64_CONSTANT)           \
+  X(MATH_ADD_F64VV, math_add_f64vv, F64_DST, F64_SRC, F64_SRC)                \
+  X(MATH_MULTIPLY_I32VC, math_multiply_i32vc, I32_DST, I32_SRC, I32_CONSTANT) \
+  X(MATH_MULTIPLY_I32VV, math_multiply_i32vv, I32_DST, I32_SRC, I32_SRC)      \
+  X(MATH_MULTIPLY_I64VC, math_multiply_i64vc, I64_DST, I64_SRC, I64_CONSTANT) \
+  X(MATH_MULTIPLY_I64VV, math_multiply_i64vv, I64_DST, I64_SRC, I64_SRC)      \
+  X(MATH_MULTIPLY_F32VC, math_multiply_f32vc, F32_DST, F32_SRC, F32_CONSTANT) \
+  X(MATH_MULTIPLY_F32VV, math_multiply_f32vv, F32_DST, F32_SRC, F32_SRC)      \
+  X(MATH_MULTIPLY_F64VC, math_multiply_f64vc, F64_DST, F64_SRC, F64_CONSTANT) \
+  X(MATH_MULTIPLY_F64VV, math_multiply_f64vv, F64_DST, F64_SRC, F64_SRC)      \
+  X(JUMP_IF_ZERO_I32, jump_if_zero_i32, I32_SRC, LABEL, NONE)                 \
+  X(JUMP_IF_ZERO_I64, jump_if_zero_i64, I64_SRC, LABEL, NONE)                 \
+  X(JUMP_IF_ZERO_F32, jump_if_zero_f32, F32_SRC, LABEL, NONE)                 \
+  X(JUMP_IF_ZERO_F64, jump_if_zero_f64, F64_SRC, LABEL, NONE)                 \
+  X(JUMP_IF_NOT_ZERO_I32, jump_if_not_zero_i32, I32_SRC, LABEL, NONE)         \
+  X(JUMP_IF_NOT_ZERO_I64, jump_if_not_zero_i64, I64_SRC, LABEL, NONE)         \
+  X(JUMP_IF_NOT_ZERO_F32, jump_if_not_zero_f32, F32_SRC, LABEL, NONE)         \
+  X(JUMP_IF_NOT_ZERO_F64, jump_if_not_zero_f64, F64_SRC, LABEL, NONE)         \
+  X(JUMP, jump, LABEL, NONE, NONE)                                            \
+  X(JUMP_TABLE_I32, jump_table_i32, I32_SRC, COUNT, LABEL)                    \
+  X(JUMP_TABLE_I64, jump_table_i64, I64_SRC, COUNT, LABEL)                    \
+  X(JUMP_IF_EQUAL_I32VC, jump_if_equal_i32vc, I32_SRC, I32_CONSTANT, LABEL)   \
+  X(JUMP_IF_EQUAL_I32VV, jump_if_equal_i32vv, I32_SRC, I32_SRC, LABEL)        \
+  X(JUMP_IF_EQUAL_I64VC, jump_if_equal_i64vc, I64_SRC, I64_CONSTANT, LABEL)   \
+  X(JUMP_IF_EQUAL_I64VV, jump_if_equal_i64vv, I64_SRC, I64_SRC, LABEL)        \
+  X(JUMP_IF_EQUAL_F32VC, jump_if_equal_f32vc, F32_SRC, F32_CONSTANT, LABEL)   \
+  X(JUMP_IF_EQUAL_F32VV, jump_if_equal_f32vv, F32_SRC, F32_SRC, LABEL)        \
+  X(JUMP_IF_EQUAL_F64VC, jump_if_equal_f64vc, F64_SRC, F64_CONSTANT, LABEL)   \
+  X(JUMP_IF_EQUAL_F64VV, jump_if_equal_f64vv, F64_SRC, F64_SRC, LABEL)        \
+  X(JUMP_IF_NOT_EQUAL_I32VC, jump_if_not_equal_i32vc, I32_SRC, I32_CONSTANT,  \
+    LABEL)                                                                    \
+  X(JUMP_IF_NOT_EQUAL_I32VV, jump_if_not_equal_i32vv, I32_SRC, I32_SRC,       \
+    LABEL)                                                                    \
+  X(JUMP_IF_NOT_EQUAL_I64VC, jump_if_not_equal_i64vc, I64_SRC, I64_CONSTANT,  \
+    LABEL)                                                                    \
+  X(JUMP_IF_NOT_EQUAL_I64VV, jump_if_not_equal_i64vv, I64_SRC, I64_SRC,       \
+    LABEL)                                                                    \
+  X(JUMP_IF_NOT_EQUAL_F32VC, jump_if_not_equal_f32vc, F32_SRC, F32_CONSTANT,  \
+    LABEL)                                                                    \
+  X(JUMP_IF_NOT_EQUAL_F32VV, jump_if_not_equal_f32vv, F32_SRC, F32_SRC,       \
+    LABEL)                                                                    \
+  X(JUMP_IF_NOT_EQUAL_F64VC, jump_if_not_equal_f64vc, F64_SRC, F64_CONSTANT,  \
+    LABEL)                                                                    \
+  X(JUMP_IF_NOT_EQUAL_F64VV, jump_if_not_equal_f64vv, F64_SRC, F64_SRC,       \
+    LABEL)                                                                    \
+  X(JUMP_IF_LESS_I32VC, jump_if_less_i32vc, I32_SRC, I32_CONSTANT, LABEL)     \
+  X(JUMP_IF_LESS_I32VV, jump_if_less_i32vv, I32_SRC, I32_SRC, LABEL)          \
+  X(JUMP_IF_LESS_I64VC, jump_if_less_i64vc, I64_SRC, I64_CONSTANT, LABEL)     \
+  X(JUMP_IF_LESS_I64VV, jump_if_less_i64vv, I64_SRC, I64_SRC, LABEL)          \
+  X(JUMP_IF_LESS_F32VC, jump_if_less_f32vc, F32_SRC, F32_CONSTANT, LABEL)     \
+  X(JUMP_IF_LESS_F32VV, jump_if_less_f32vv, F32_SRC, F32_SRC, LABEL)          \
+  X(JUMP_IF_LESS_F64VC, jump_if_less_f64vc, F64_SRC, F64_CONSTANT, LABEL)     \
+  X(JUMP_IF_LESS_F64VV, jump_if_less_f64vv, F64_SRC, F64_SRC, LABEL)          \
+  X(JUMP_IF_LESS_OR_EQUAL_I32VC, jump_if_less_or_equal_i32vc, I32_SRC,        \
+    I32_CONSTANT, LABEL)                                                      \
+  X(JUMP_IF_LESS_OR_EQUAL_I32VV, jump_if_less_or_equal_i32vv, I32_SRC,        \
+    I32_SRC, LABEL)                                                           \
+  X(JUMP_IF_LESS_OR_EQUAL_I64VC, jump_if_less_or_equal_i64vc, I64_SRC,        \
+    I64_CONSTANT, LABEL)                                                      \
+  X(JUMP_IF_LESS_OR_EQUAL_I64VV, jump_if_less_or_equal_i64vv, I64_SRC,        \
+    I64_SRC, LABEL)                                                           \
+  X(JUMP_IF_LESS_OR_EQUAL_F32VC, jump_if_less_or_equal_f32vc, F32_SRC,        \
+    F32_CONSTANT, LABEL)                                                      \
+  X(JUMP_IF_LESS_OR_EQUAL_F32VV, jump_if_less_or_equal_f32vv, F32_SRC,        \
+    F32_SRC, LABEL)                                                           \
+  X(JUMP_IF_LESS_OR_EQUAL_F64VC, jump_if_less_or_equal_f64vc, F64_SRC,        \
+    F64_CONSTANT, LABEL)                                                      \
+  X(JUMP_IF_LESS_OR_EQUAL_F64VV, jump_if_less_or_equal_f64vv, F64_SRC,        \
+    F64_SRC, LABEL)                                                           \
+  X(JUMP_IF_GREATER_I32VC, jump_if_greater_i32vc, I32_SRC, I32_CONSTANT,      \
+    LABEL)                                                                    \
+  X(JUMP_IF_GREATER_I64VC, jump_if_greater_i64vc, I64_SRC, I64_CONSTANT,      \
+    LABEL)                                                                    \
+  X(JUMP_IF_GREATER_F32VC, jump_if_greater_f32vc, F32_SRC, F32_CONSTANT,      \
+    LABEL)                                                                    \
+  X(JUMP_IF_GREATER_F64VC, jump_if_greater_f64vc, F64_SRC, F64_CONSTANT,      \
+    LABEL)                                                                    \
+  X(JUMP_IF_GREATER_OR_EQUAL_I32VC, jump_if_greater_or_equal_i32vc, I32_SRC,  \
+    I32_CONSTANT, LABEL)                                                      \
+  X(JUMP_IF_GREATER_OR_EQUAL_I64VC, jump_if_greater_or_equal_i64vc, I64_SRC,  \
+    I64_CONSTANT, LABEL)                                                      \
+  X(JUMP_IF_GREATER_OR_EQUAL_F32VC, jump_if_greater_or_equal_f32vc, F32_SRC,  \
+    F32_CONSTANT, LABEL)                                                      \
+  X(JUMP_IF_GREATER_OR_EQUAL_F64VC, jump_if_greater_or_equal_f64vc, F64_SRC,  \
+    F64_CONSTANT, LABEL)                                                      \
+  X(JUMP_IF_ZERO_I32_UNCHECKED, jump_if_zero_i32_unchecked, I32_SRC, LABEL,   \
+    NONE)                                                                     \
+  X(JUMP_IF_ZERO_I64_UNCHECKED, jump_if_zero_i64_unchecked, I64_SRC, LABEL,   \
+    NONE)                                                                     \
+  X(JUMP_IF_ZERO_F32_UNCHECKED, jump_if_zero_f32_unchecked, F32_SRC, LABEL,   \
+    NONE)                                                                     \
+  X(JUMP_IF_ZERO_F64_UNCHECKED, jump_if_zero_f64_unchecked, F64_SRC, LABEL,   \
+    NONE)                                                                     \
+  X(JUMP_IF_NOT_ZERO_I32_UNCHECKED, jump_if_not_zero_i32_unchecked, I32_SRC,  \
+    LABEL, NONE)                                                              \
+  X(JUMP_IF_NOT_ZERO_I64_UNCHECKED, jump_if_not_zero_i64_unchecked, I64_SRC,  \
+    LABEL, NONE)                                                              \
+  X(JUMP_IF_NOT_ZERO_F32_UNCHECKED, jump_if_not_zero_f32_unchecked, F32_SRC,  \
+    LABEL, NONE)                                                              \
+  X(JUMP_IF_NOT_ZERO_F64_UNCHECKED, jump_if_not_zero_f64_unchecked, F64_SRC,  \
+    LABEL, NONE)                                                              \
+  X(JUMP_UNCHECKED, jump_unchecked, LABEL, NONE, NONE)                        \
+  X(JUMP_TABLE_I32_UNCHECKED, jump_table_i32_unchecked, I32_SRC, COUNT,       \
+    LABEL)                                                                    \
+  X(JUMP_TABLE_I64_UNCHECKED, jump_table_i64_unchecked, I64_SRC, COUNT,       \
+    LABEL)                                                                    \
+  X(JUMP_IF_EQUAL_I32VC_UNCHECKED, jump_if_equal_i32vc_unchecked, I32_SRC,    \
+    I32_CONSTANT, LABEL)                                                      \
+  X(JUMP_IF_EQUAL_I32VV_UNCHECKED, jump_if_equal_i32vv_unchecked, I32_SRC,    \
+    I32_SRC, LABEL)                                                           \
+  X(JUMP_IF_EQUAL_I64VC_UNCHECKED, jump_if_equal_i64vc_unchecked, I64_SRC,    \
+    I64_CONSTANT, LABEL)                                                      \
+  X(JUMP_IF_EQUAL_I64VV_UNCHECKED, jump_if_equal_i64vv_unchecked, I64_SRC,    \
+    I64_SRC, LABEL)                                                           \
+  X(JUMP_IF_EQUAL_F32VC_UNCHECKED, jump_if_equal_f32vc_unchecked, F32_SRC,    \
+    F32_CONSTANT, LABEL)                                                      \
+  X(JUMP_IF_EQUAL_F32VV_UNCHECKED, jump_if_equal_f32vv_unchecked, F32_SRC,    \
+    F32_SRC, LABEL)                                                           \
+  X(JUMP_IF_EQUAL_F64VC_UNCHECKED, jump_if_equal_f64vc_unchecked, F64_SRC,    \
+    F64_CONSTANT, LABEL)                                                      \
+  X(JUMP_IF_EQUAL_F64VV_UNCHECKED, jump_if_equal_f64vv_unchecked, F64_SRC,    \
+    F64_SRC, LABEL)                                                           \
+  X(JUMP_IF_NOT_EQUAL_I32VC_UNCHECKED, jump_if_not_equal_i32vc_unchecked,     \
+    I32_SRC, I32_CONSTANT, LABEL)                                             \
+  X(JUMP_IF_NOT_EQUAL_I32VV_UNCHECKED, jump_if_not_equal_i32vv_unchecked,     \
+    I32_SRC, I32_SRC, LABEL)                                                  \
+  X(JUMP_IF_NOT_EQUAL_I64VC_UNCHECKED, jump_if_not_equal_i64vc_unchecked,     \
+    I64_SRC, I64_CONSTANT, LABEL)                                             \
+  X(JUMP_IF_NOT_EQUAL_I64VV_UNCHECKED, jump_if_not_equal_i64vv_unchecked,     \
+    I64_SRC, I64_SRC, LABEL)                                                  \
+  X(JUMP_IF_NOT_EQUAL_F32VC_UNCHECKED, jump_if_not_equal_f32vc_unchecked,     \
+    F32_SRC, F32_CONSTANT, LABEL)                                             \
+  X(JUMP_IF_NOT_EQUAL_F32VV_UNCHECKED, jump_if_not_equal_f32vv_unchecked,     \
+    F32_SRC, F32_SRC, LABEL)                                                  \
+  X(JUMP_IF_NOT_EQUAL_F64VC_UNCHECKED, jump_if_not_equal_f64vc_unchecked,     \
+    F64_SRC, F64_CONSTANT, LABEL)                                             \
+  X(JUMP_IF_NOT_EQUAL_F64VV_UNCHECKED, jump_if_not_equal_f64vv_unchecked,     \
+    F64_SRC, F64_SRC, LABEL)                                                  \
+  X(JUMP_IF_LESS_I32VC_UNCHECKED, jump_if_less_i32vc_unchecked, I32_SRC,      \
+    I32_CONSTANT, LABEL)                                                      \
+  X(JUMP_IF_LESS_I32VV_UNCHECKED, jump_if_less_i32vv_unchecked, I32_SRC,      \
+    I32_SRC, LABEL)                                                           \
+  X(JUMP_IF_LESS_I64VC_UNCHECKED, jump_if_less_i64vc_unchecked, I64_SRC,      \
+    I64_CONSTANT, LABEL)                                                      \
+  X(JUMP_IF_LESS_I64VV_UNCHECKED, jump_if_less_i64vv_unchecked, I64_SRC,      \
+    I64_SRC, LABEL)                                                           \
+  X(JUMP_IF_LESS_F32VC_UNCHECKED, jump_if_less_f32vc_unchecked, F32_SRC,      \
+    F32_CONSTANT, LABEL)                                                      \
+  X(JUMP_IF_LESS_F32VV_UNCHECKED, jump_if_less_f32vv_unchecked, F32_SRC,      \
+    F32_SRC, LABEL)                                                           \
+  X(JUMP_IF_LESS_F64VC_UNCHECKED, jump_if_less_f64vc_unchecked, F64_SRC,      \
+    F64_CONSTANT, LABEL)                                                      \
+  X(JUMP_IF_LESS_F64VV_UNCHECKED, jump_if_less_f64vv_unchecked, F64_SRC,      \
+    F64_SRC, LABEL)                                                           \
+  X(JUMP_IF_LESS_OR_EQUAL_I32VC_UNCHECKED,                                    \
+    jump_if_less_or_equal_i32vc_unchecked, I32_SRC, I32_CONSTANT, LABEL)      \
+  X(JUMP_IF_LESS_OR_EQUAL_I32VV_UNCHECKED,                                    \
+    jump_if_less_or_equal_i32vv_unchecked, I32_SRC, I32_SRC, LABEL)           \
+  X(JUMP_IF_LESS_OR_EQUAL_I64VC_UNCHECKED,                                    \
+    jump_if_less_or_equal_i64vc_unchecked, I64_SRC, I64_CONSTANT, LABEL)      \
+  X(JUMP_IF_LESS_OR_EQUAL_I64VV_UNCHECKED,                                    \
+    jump_if_less_or_equal_i64vv_unchecked, I64_SRC, I64_SRC, LABEL)           \
+  X(JUMP_IF_LESS_OR_EQUAL_F32VC_UNCHECKED,                                    \
+    jump_if_less_or_equal_f32vc_unchecked, F32_SRC, F32_CONSTANT, LABEL)      \
+  X(JUMP_IF_LESS_OR_EQUAL_F32VV_UNCHECKED,                                    \
+    jump_if_less_or_equal_f32vv_unchecked, F32_SRC, F32_SRC, LABEL)           \
+  X(JUMP_IF_LESS_OR_EQUAL_F64VC_UNCHECKED,                                    \
+    jump_if_less_or_equal_f64vc_unchecked, F64_SRC, F64_CONSTANT, LABEL)      \
+  X(JUMP_IF_LESS_OR_EQUAL_F64VV_UNCHECKED,                                    \
+    jump_if_less_or_equal_f64vv_unchecked, F64_SRC, F64_SRC, LABEL)           \
+  X(JUMP_IF_GREATER_I32VC_UNCHECKED, jump_if_greater_i32vc_unchecked,         \
+    I32_SRC, I32_CONSTANT, LABEL)                                             \
+  X(JUMP_IF_GREATER_I64VC_UNCHECKED, jump_if_greater_i64vc_unchecked,         \
+    I64_SRC, I64_CONSTANT, LABEL)                                             \
+  X(JUMP_IF_GREATER_F32VC_UNCHECKED, jump_if_greater_f32vc_unchecked,         \
+    F32_SRC, F32_CONSTANT, LABEL)                                             \
+  X(JUMP_IF_GREATER_F64VC_UNCHECKED, jump_if_greater_f64vc_unchecked,         \
+    F64_SRC, F64_CONSTANT, LABEL)                                             \
+  X(JUMP_IF_GREATER_OR_EQUAL_I32VC_UNCHECKED,                                 \
+    jump_if_greater_or_equal_i32vc_unchecked, I32_SRC, I32_CONSTANT, LABEL)   \
+  X(JUMP_IF_GREATER_OR_EQUAL_I64VC_UNCHECKED,                                 \
+    jump_if_greater_or_equal_i64vc_unchecked, I64_SRC, I64_CONSTANT, LABEL)   \
+  X(JUMP_IF_GREATER_OR_EQUAL_F32VC_UNCHECKED,                                 \
+    jump_if_greater_or_equal_f32vc_unchecked, F32_SRC, F32_CONSTANT, LABEL)   \
+  X(JUMP_IF_GREATER_OR_EQUAL_F64VC_UNCHECKED,                                 \
+    jump_if_greater_or_equal_f64vc_unchecked, F64_SRC, F64_CONSTANT, LABEL)   \
+  X(BITWISE_AND_JUMP_IF_ZERO_I32VC, bitwise_and_jump_if_zero_i32vc,           \
+    I32_DST_SRC_PAIR, I32_CONSTANT, LABEL)                                    \
+  X(BITWISE_AND_JUMP_IF_ZERO_I64VC, bitwise_and_jump_if_zero_i64vc,           \
+    I64_DST_SRC_PAIR, I64_CONSTANT, LABEL)                                    \
+  X(BITWISE_AND_JUMP_IF_NOT_ZERO_I32VC, bitwise_and_jump_if_not_zero_i32vc,   \
+    I32_DST_SRC_PAIR, I32_CONSTANT, LABEL)                                    \
+  X(BITWISE_AND_JUMP_IF_NOT_ZERO_I64VC, bitwise_and_jump_if_not_zero_i64vc,   \
+    I64_DST_SRC_PAIR, I64_CONSTANT, LABEL)                                    \
+  X(BITWISE_LEFT_SHIFT_JUMP_IF_NOT_ZERO_I32VC,                                \
+    bitwise_left_shift_jump_if_not_zero_i32vc, I32_DST_SRC_PAIR,              \
+    I32_CONSTANT, LABEL)                                                      \
+  X(BITWISE_LEFT_SHIFT_JUMP_IF_NOT_ZERO_I64VC,                                \
+    bitwise_left_shift_jump_if_not_zero_i64vc, I64_DST_SRC_PAIR,              \
+    I64_CONSTANT, LABEL)                                                      \
+  X(BITWISE_RIGHT_SHIFT_JUMP_IF_NOT_ZERO_I32VC,                               \
+    bitwise_right_shift_jump_if_not_zero_i32vc, I32_DST_SRC_PAIR,             \
+    I32_CONSTANT, LABEL)                                                      \
+  X(BITWISE_RIGHT_SHIFT_JUMP_IF_NOT_ZERO_I64VC,                               \
+    bitwise_right_shift_jump_if_not_zero_i64vc, I64_DST_SRC_PAIR,             \
+    I64_CONSTANT, LABEL)                                                      \
+  X(MATH_ADD_2_F64VV, math_add_2_f64vv, F64_DST_PAIR, F64_SRC_PAIR,           \
+    F64_SRC_PAIR)                                                             \
+  X(MATH_MULTIPLY_2_F64VV, math_multiply_2_f64vv, F64_DST_PAIR,               \
+    F64_SRC_PAIR, F64_SRC_PAIR)                                               \
+  X(MATH_MULTIPLY_ADD_F64VVV, math_multiply_add_f64vvv, F64_DST_PAIR,         \
+    F64_SRC_PAIR, F64_SRC)                                                    \
+  X(VECTOR_ADD_F32, vector_add_f32, F32_DST_ARRAY, COUNT,                     \
+    F32_SRC_ARRAY_PAIR)                                                       \
+  X(VECTOR_ADD_F64, vector_add_f64, F64_DST_ARRAY, COUNT,                     \
+    F64_SRC_ARRAY_PAIR)                                                       \
+  X(VECTOR_MULTIPLY_F32, vector_multiply_f32, F32_DST_ARRAY, COUNT,           \
+    F32_SRC_ARRAY_PAIR)                                                       \
+  X(VECTOR_MULTIPLY_F64, vector_multiply_f64, F64_DST_ARRAY, COUNT,           \
+    F64_SRC_ARRAY_PAIR)                                                       \
+  X(VECTOR_MULTIPLY_ADD_F32, vector_multiply_add_f32, F32_DST_SRC_ARRAY,      \
+    COUNT, F32_SRC_ARRAY_PAIR)                                                \
+  X(VECTOR_MULTIPLY_ADD_F64, vector_multiply_add_f64, F64_DST_SRC_ARRAY,      \
+    COUNT, F64_SRC_ARRAY_PAIR)                                                \
+  X(VECTOR_DOT_F32, vector_dot_f32, F32_DST, F32_SRC_ARRAY_PAIR, COUNT)       \
+  X(VECTOR_DOT_F64, vector_dot_f64, F64_DST, F64_SRC_ARRAY_PAIR, COUNT)       \
+  X(VECTOR_SUM_F32, vector_sum_f32, F32_DST, F32_SRC_ARRAY, COUNT)            \
+  X(VECTOR_SUM_F64, vector_sum_f64, F64_DST, F64_SRC_ARRAY, COUNT)            \
+  X(VECTOR_BROADCAST_F32, vector_broadcast_f32, F32_DST_ARRAY, COUNT,         \
+    F32_SRC)                                                                  \
+  X(VECTOR_BROADCAST_F64, vector_broadcast_f64, F64_DST_ARRAY, COUNT,         \
+    F64_SRC)                                                                  \
+  X(MATRIX_MULTIPLY_2X2_I64, matrix_multiply_2x2_i64, I64_DST_ARRAY, COUNT,   \
+    I64_SRC_ARRAY_PAIR)                                                       \
+  X(MATRIX_MULTIPLY_2X2_F64, matrix_multiply_2x2_f64, F64_DST_ARRAY, COUNT,   \
+    F64_SRC_ARRAY_PAIR)                                                       \
+  X(MATRIX_MULTIPLY_3X3_I64, matrix_multiply_3x3_i64, I64_DST_ARRAY, COUNT,   \
+    I64_SRC_ARRAY_PAIR)                                                       \
+  X(MATRIX_MULTIPLY_3X3_F64, matrix_multiply_3x3_f64, F64_DST_ARRAY, COUNT,   \
+    F64_SRC_ARRAY_PAIR)                                                       \
+  X(MATRIX_MULTIPLY_4X4_I64, matrix_multiply_4x4_i64, I64_DST_ARRAY, COUNT,   \
+    I64_SRC_ARRAY_PAIR)                                                       \
+  X(MATRIX_MULTIPLY_4X4_F64, matrix_multiply_4x4_f64, F64_DST_ARRAY, COUNT,   \
+    F64_SRC_ARRAY_PAIR)
+
+enum u7_vm0_opcode {
+  U7_VM0_OPCODE_UNKNOWN = -1,
+#define U7_VM0_OPCODE_ENUM_ITEM(opcode, exec_name, arg1_kind, arg2_kind, \
+                                arg3_kind)                               \
+  U7_VM0_OPCODE_##opcode,
+  U7_VM0_OPCODES(U7_VM0_OPCODE_ENUM_ITEM)
+#undef U7_VM0_OPCODE_ENUM_ITEM
+      U7_VM0_OPCODE_COUNT,
+};
+
+struct u7_vm0_opcode_info {
+  struct u7_vm_instruction base;  // Holds the execute_fn of the opcode.
+  const char* name;
+  enum u7_vm0_operand_kind operand_kinds[3];
+};
+
+// Returns the description of the opcode.
+struct u7_vm0_opcode_info const* u7_vm0_opcode_info(enum u7_vm0_opcode opcode);
+
+// Returns the opcode of the instruction, or U7_VM0_OPCODE_UNKNOWN if the
+// instruction was not constructed by this library.
+enum u7_vm0_opcode u7_vm0_instruction_opcode(
+    struct u7_vm0_instruction const* instruction);
+
+// Returns the opcode of the instruction that has caused the fault.
+enum u7_vm0_opcode u7_vm0_fault_opcode(struct u7_vm0_fault const* fault);
+
+// Returns the opcode with the given name (not necessarily NUL-terminated),
+// or U7_VM0_OPCODE_UNKNOWN.
+enum u7_vm0_opcode u7_vm0_opcode_by_name(const char* name, size_t name_size);
+
+// Returns the size of the local variable(s) referenced by an operand (of an
+// element, for arrays), or 0 if the operand is not a variable.
+static inline int64_t u7_vm0_operand_kind_variable_size(
+    enum u7_vm0_operand_kind kind) {
+  switch (kind) {
+    case U7_VM0_OPERAND_I32_SRC:
+    case U7_VM0_OPERAND_I32_DST:
+    case U7_VM0_OPERAND_I32_DST_SRC_PAIR:
+    case U7_VM0_OPERAND_I32_SRC_ARRAY:
+    case U7_VM0_OPERAND_I32_DST_ARRAY:
+      return sizeof(int32_t);
+    case U7_VM0_OPERAND_I64_SRC:
+    case U7_VM0_OPERAND_I64_DST:
+    case U7_VM0_OPERAND_I64_DST_SRC_PAIR:
+    case U7_VM0_OPERAND_I64_SRC_ARRAY:
+    case U7_VM0_OPERAND_I64_DST_ARRAY:
+    case U7_VM0_OPERAND_I64_SRC_ARRAY_PAIR:
+      return sizeof(int64_t);
+    case U7_VM0_OPERAND_F32_SRC:
+    case U7_VM0_OPERAND_F32_DST:
+    case U7_VM0_OPERAND_F32_SRC_ARRAY:
+    case U7_VM0_OPERAND_F32_DST_ARRAY:
+    case U7_VM0_OPERAND_F32_DST_SRC_ARRAY:
+    case U7_VM0_OPERAND_F32_SRC_ARRAY_PAIR:
+      return sizeof(float);
+    case U7_VM0_OPERAND_F64_SRC:
+    case U7_VM0_OPERAND_F64_DST:
+    case U7_VM0_OPERAND_F64_SRC_PAIR:
+    case U7_VM0_OPERAND_F64_DST_PAIR:
+    case U7_VM0_OPERAND_F64_SRC_ARRAY:
+    case U7_VM0_OPERAND_F64_DST_ARRAY:
+    case U7_VM0_OPERAND_F64_DST_SRC_ARRAY:
+    case U7_VM0_OPERAND_F64_SRC_ARRAY_PAIR:
+      return sizeof(double);
+    default:
+      return 0;
+  }
+}
+
+static inline bool u7_vm0_operand_kind_is_pair(enum u7_vm0_operand_kind kind) {
+  return kind == U7_VM0_OPERAND_I32_DST_SRC_PAIR ||
+         kind == U7_VM0_OPERAND_I64_DST_SRC_PAIR ||
+         kind == U7_VM0_OPERAND_F64_SRC_PAIR ||
+         kind == U7_VM0_OPERAND_F64_DST_PAIR;
+}
+
+static inline bool u7_vm0_operand_kind_is_array(
+    enum u7_vm0_operand_kind kind) {
+  return kind >= U7_VM0_OPERAND_I32_SRC_ARRAY &&
+         kind <= U7_VM0_OPERAND_F64_DST_SRC_ARRAY;
+}
+
+static inline bool u7_vm0_operand_kind_is_array_pair(
+    enum u7_vm0_operand_kind kind) {
+  return kind == U7_VM0_OPERAND_I64_SRC_ARRAY_PAIR ||
+         kind == U7_VM0_OPERAND_F32_SRC_ARRAY_PAIR ||
+         kind == U7_VM0_OPERAND_F64_SRC_ARRAY_PAIR;
+}
+
+// Returns the index of the COUNT operand of the opcode, or -1.
+static inline int u7_vm0_opcode_info_count_index(
+    struct u7_vm0_opcode_info const* info) {
+  for (int i = 0; i < 3; ++i) {
+    if (info->operand_kinds[i] == U7_VM0_OPERAND_COUNT) {
+      return i;
+    }
+  }
+  return -1;
+}
+
+// Returns the number of rows (and columns) of the square matrices of the
+// opcode, or 0 if it is not a matrix instruction. Its COUNT operand is the
+// number of the matrix elements.
+static inline int64_t u7_vm0_opcode_matrix_size(enum u7_vm0_opcode opcode) {
+  switch (opcode) {
+    case U7_VM0_OPCODE_MATRIX_MULTIPLY_2X2_I64:
+    case U7_VM0_OPCODE_MATRIX_MULTIPLY_2X2_F64:
+      return 2;
+    case U7_VM0_OPCODE_MATRIX_MULTIPLY_3X3_I64:
+    case U7_VM0_OPCODE_MATRIX_MULTIPLY_3X3_F64:
+      return 3;
+    case U7_VM0_OPCODE_MATRIX_MULTIPLY_4X4_I64:
+    case U7_VM0_OPCODE_MATRIX_MULTIPLY_4X4_F64:
+      return 4;
+    default:
+      return 0;
+  }
+}
+
+// Returns true for `ret` and its variants that return a value.
+static inline bool u7_vm0_opcode_is_return(enum u7_vm0_opcode opcode) {
+  return opcode == U7_VM0_OPCODE_RET || opcode == U7_VM0_OPCODE_RET_I32V ||
+         opcode == U7_VM0_OPCODE_RET_I64V || opcode == U7_VM0_OPCODE_RET_F32V ||
+         opcode == U7_VM0_OPCODE_RET_F64V;
+}
+
+static inline bool u7_vm0_opcode_is_call(enum u7_vm0_opcode opcode) {
+  return opcode == U7_VM0_OPCODE_CALL || opcode == U7_VM0_OPCODE_TAIL_CALL;
+}
+
+// Returns true for `jump`, which never continues with the next instruction.
+static inline bool u7_vm0_opcode_is_jump(enum u7_vm0_opcode opcode) {
+  return opcode == U7_VM0_OPCODE_JUMP || opcode == U7_VM0_OPCODE_JUMP_UNCHECKED;
+}
+
+// Returns true for `jump_table`; its entries are the COUNT instructions that
+// follow it (see u7_vm0_jump_table()).
+static inline bool u7_vm0_opcode_is_jump_table(enum u7_vm0_opcode opcode) {
+  return opcode == U7_VM0_OPCODE_JUMP_TABLE_I32 ||
+         opcode == U7_VM0_OPCODE_JUMP_TABLE_I64 ||
+         opcode == U7_VM0_OPCODE_JUMP_TABLE_I32_UNCHECKED ||
+         opcode == U7_VM0_OPCODE_JUMP_TABLE_I64_UNCHECKED;
+}
+
+// Packs offsets of two local variables into a single operand value.
+static inline int64_t u7_vm0_operand_pair(int32_t first, int32_t second) {
+  return (int64_t)((uint64_t)(uint32_t)first |
+                   ((uint64_t)(uint32_t)second << 32));
+}
+
+static inline int32_t u7_vm0_operand_pair_first(int64_t pair) {
+  return (int32_t)(uint32_t)(uint64_t)pair;
+}
+
+static inline int32_t u7_vm0_operand_pair_second(int64_t pair) {
+  return (int32_t)(uint32_t)((uint64_t)pair >> 32);
+}
+
+// Returns the width in bits of the shifted value for a shift by a constant,
+// or 0 for the other opcodes. The constant count must be less than the
+// width; right shifts hold the count as a positive number.
+static inline int u7_vm0_opcode_shift_width(enum u7_vm0_opcode opcode) {
+  switch (opcode) {
+    case U7_VM0_OPCODE_BITWISE_LEFT_SHIFT_I32VC:
+    case U7_VM0_OPCODE_BITWISE_RIGHT_SHIFT_I32VC:
+    case U7_VM0_OPCODE_BITWISE_LEFT_SHIFT_JUMP_IF_NOT_ZERO_I32VC:
+    case U7_VM0_OPCODE_BITWISE_RIGHT_SHIFT_JUMP_IF_NOT_ZERO_I32VC:
+      return 32;
+    case U7_VM0_OPCODE_BITWISE_LEFT_SHIFT_I64VC:
+    case U7_VM0_OPCODE_BITWISE_RIGHT_SHIFT_I64VC:
+    case U7_VM0_OPCODE_BITWISE_LEFT_SHIFT_JUMP_IF_NOT_ZERO_I64VC:
+    case U7_VM0_OPCODE_BITWISE_RIGHT_SHIFT_JUMP_IF_NOT_ZERO_I64VC:
+      return 64;
+    default:
+      return 0;
+  }
+}
+
+// Returns the frame layout held by a FRAME_LAYOUT operand.
+static inline struct u7_vm_stack_frame_layout const*
+u7_vm0_operand_frame_layout(int64_t value) {
+  return (struct u7_vm_stack_frame_layout const*)(intptr_t)value;
+}
+
+#ifdef __cplusplus
+}  // extern "C"
+#endif  // __cplusplus
+
+#endif  // U7_VM0_OPCODE_H_
@@ -0,0 +1,44 @@
+#ifndef U7_VM0_OPTIMIZE_H_
+#define U7_VM0_OPTIMIZE_H_
+
+#include "@/public/vm0.h"
+
+#include <github.com/apronchenkov/error/public/error.h>
+#include <github.com/apronchenkov/vm/public/state.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif  // __cplusplus
+
+// Optimization pass over the control-flow graph of the program (the basic
+// blocks start at the label targets and after the jumps):
+//
+//  * constant propagation: the variables with known values are replaced with
+//    constants (`*vv` -> `*vc`/`*cv`, `copy_*v` -> `copy_*c`,
+//    `output_*v` -> `output_*c`), the operations on constants are folded,
+//    and the jumps with known conditions (and the jump tables with known
+//    indices) are resolved;
+//  * dead-store elimination: an instruction that cannot fail and writes only
+//    variables that are overwritten before being read is removed;
+//  * unreachable instructions are removed.
+//
+// The host may access the variables between the runs, so all of them are
+// live at `yield` and `ret`, and no values are assumed after `yield`. An
+// instruction that may fail keeps alive the variables read at the beginning
+// of the program, as the next run starts over. The operations that may fail
+// (integer overflow, an out of range shift) are never folded. Labels are
+// remapped to the compacted program and *instructions_size is updated.
+//
+// The program is verified with u7_vm0_verify(), before and after the pass.
+// The programs with functions (see u7_vm0_call()) are rejected. Run it
+// before u7_vm0_fuse().
+u7_error u7_vm0_optimize(
+    struct u7_vm0_instruction* instructions, size_t* instructions_size,
+    struct u7_vm_stack_frame_layout const* locals_frame_layout);
+
+#ifdef __cplusplus
+}  // extern "C"
+#endif  // __cplusplus
+
+#endif  // U7_VM0_OPTIMIZE_H_
@@ -2,6 +2,7 @@
 #define U7_VM0_OUTPUT_H_
 
 #include <github.com/apronchenkov/error/public/error.h>
+#include <stddef.h>
 #include <stdint.h>
 
 #ifdef __cplusplus
@@ -19,15 +20,115 @@ typedef u7_error (*u7_vm0_output_write_f32_fn_t)(struct u7_vm0_output* self,
 typedef u7_error (*u7_vm0_output_write_f64_fn_t)(struct u7_vm0_output* self,
                                                  double value);
 
+// Batch versions: write `count` consecutive values, and store the number of
+// values written in *done, also on failure.
+typedef u7_error (*u7_vm0_output_write_i32_n_fn_t)(struct u7_vm0_output* self,
+                                                   int32_t const* values,
+                                                   size_t count, size_t* done);
+typedef u7_error (*u7_vm0_output_write_i64_n_fn_t)(struct u7_vm0_output* self,
+                                                   int64_t const* values,
+                                                   size_t count, size_t* done);
+typedef u7_error (*u7_vm0_output_write_f32_n_fn_t)(struct u7_vm0_output* self,
+                                                   float const* values,
+                                                   size_t count, size_t* done);
+typedef u7_error (*u7_vm0_output_write_f64_n_fn_t)(struct u7_vm0_output* self,
+                                                   double const* values,
+                                                   size_t count, size_t* done);
+
+// A backend that cannot proceed without blocking may fail with EAGAIN; the
+// program then stops, and the instruction is retried when it is resumed
+// (see u7_vm0_globals.blocked). A scalar function must have written nothing
+// in that call. A batch function may have written a prefix of the values,
+// which it reports in *done; the retry writes only the rest (see
+// u7_vm0_globals.io_done).
 struct u7_vm0_output {
   u7_vm0_output_write_i32_fn_t write_i32_fn;
   u7_vm0_output_write_i64_fn_t write_i64_fn;
   u7_vm0_output_write_f32_fn_t write_f32_fn;
   u7_vm0_output_write_f64_fn_t write_f64_fn;
+
+  // Optional; NULL means that the values are written one at a time.
+  u7_vm0_output_write_i32_n_fn_t write_i32_n_fn;
+  u7_vm0_output_write_i64_n_fn_t write_i64_n_fn;
+  u7_vm0_output_write_f32_n_fn_t write_f32_n_fn;
+  u7_vm0_output_write_f64_n_fn_t write_f64_n_fn;
 };
 
+// Writes `count` values, through the batch function if the output has one,
+// and stores the number of values written in *done.
+#define U7_VM0_DEFINE_OUTPUT_WRITE_N(type_name, type)                     \
+  static inline u7_error u7_vm0_output_write_##type_name##_n(             \
+      struct u7_vm0_output* self, type const* values, size_t count,       \
+      size_t* done) {                                                     \
+    if (self->write_##type_name##_n_fn != NULL) {                         \
+      return self->write_##type_name##_n_fn(self, values, count, done);   \
+    }                                                                     \
+    for (*done = 0; *done < count; ++*done) {                             \
+      u7_error error = self->write_##type_name##_fn(self, values[*done]); \
+      if (error.error_code != 0) {                                        \
+        return error;                                                     \
+      }                                                                   \
+    }                                                                     \
+    return u7_ok();                                                       \
+  }
+
+U7_VM0_DEFINE_OUTPUT_WRITE_N(i32, int32_t)
+U7_VM0_DEFINE_OUTPUT_WRITE_N(i64, int64_t)
+U7_VM0_DEFINE_OUTPUT_WRITE_N(f32, float)
+U7_VM0_DEFINE_OUTPUT_WRITE_N(f64, double)
+
+#undef U7_VM0_DEFINE_OUTPUT_WRITE_N
+
 extern struct u7_vm0_output u7_vm0_output_printf;
 
+// Formats values into a reusable buffer that is written to a file
+// descriptor in bulk, when it fills up or on u7_vm0_buffered_output_flush().
+// Integers use a digit-pair table; floats use the shortest representation
+// that reads back to the same value.
+struct u7_vm0_buffered_output {
+  struct u7_vm0_output base;
+  int fd;
+  char* buffer;
+  size_t capacity;
+  size_t size;
+};
+
+u7_error u7_vm0_buffered_output_init(struct u7_vm0_buffered_output* self,
+                                     int fd, size_t capacity);
+
+u7_error u7_vm0_buffered_output_flush(struct u7_vm0_buffered_output* self);
+
+// Does not flush: call u7_vm0_buffered_output_flush() first.
+void u7_vm0_buffered_output_destroy(struct u7_vm0_buffered_output* self);
+
+// Writes raw little-endian values to a memory span. Writing past the end of
+// the span fails with ENOSPC.
+struct u7_vm0_memory_output {
+  struct u7_vm0_output base;
+  char* begin;
+  char* cursor;
+  char* end;
+  int fd;  // Owned file, if initialized from a file; otherwise -1.
+};
+
+// The span is provided by the caller and must outlive the output.
+void u7_vm0_memory_output_init(struct u7_vm0_memory_output* self, void* data,
+                               size_t capacity);
+
+// Creates (or truncates) the file and maps `capacity` bytes of it.
+u7_error u7_vm0_memory_output_init_file(struct u7_vm0_memory_output* self,
+                                        const char* path, size_t capacity);
+
+// Returns the number of bytes written.
+static inline size_t u7_vm0_memory_output_size(
+    struct u7_vm0_memory_output const* self) {
+  return (size_t)(self->cursor - self->begin);
+}
+
+// For a file-backed output, unmaps the file and truncates it to the written
+// size.
+u7_error u7_vm0_memory_output_destroy(struct u7_vm0_memory_output* self);
+
 #ifdef __cplusplus
 }  // extern "C"
 #endif  // __cplusplus
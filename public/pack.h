@@ -0,0 +1,54 @@
+#ifndef U7_VM0_PACK_H_
+#define U7_VM0_PACK_H_
+
+#include "@/public/vm0.h"
+
+#include <github.com/apronchenkov/error/public/error.h>
+#include <github.com/apronchenkov/vm/public/state.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif  // __cplusplus
+
+// Rearranges the locals frame of the program:
+//
+//  * the variables whose lifetimes do not overlap share a slot (see
+//    `observed` below);
+//  * the slots are ordered by the number of accesses (the instructions
+//    inside loops count more), so the hottest variables share cache lines;
+//  * the bytes that no instruction references are dropped.
+//
+// The variables that overlap in the original frame (e.g. an array and its
+// element) move together. A variable read at the beginning of the program,
+// before being written, keeps its value between the runs and gets a slot of
+// its own. The instructions are rewritten, and locals_frame_layout->
+// locals_size is updated.
+//
+// `observed` is NULL, or has an entry per byte of the original frame, which
+// is true if the host reads the byte at `yield` or `ret`. The observed
+// variables are live there and keep their values; the other ones are dead
+// after their last read, and their slots may be reused. NULL means that the
+// host observes every variable: the written variables do not share slots,
+// but the slots are still reordered and stripped of the unused bytes.
+//
+// `offsets` is NULL, or has an entry per byte of the original frame, which
+// receives its new offset, or -1 if the byte has been dropped. Use it to
+// translate a locals template (see u7_vm0_state_pool_init()) or to find an
+// observed result.
+//
+// The program is verified with u7_vm0_verify(), before and after the pass.
+// The programs with functions (see u7_vm0_call()) are rejected: their frames
+// are not packed.
+u7_error u7_vm0_pack_locals(
+    struct u7_vm0_instruction* instructions, size_t instructions_size,
+    struct u7_vm_stack_frame_layout* locals_frame_layout,
+    bool const* observed, int64_t* offsets);
+
+#ifdef __cplusplus
+}  // extern "C"
+#endif  // __cplusplus
+
+#endif  // U7_VM0_PACK_H_
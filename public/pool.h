@@ -0,0 +1,68 @@
+#ifndef U7_VM0_POOL_H_
+#define U7_VM0_POOL_H_
+
+#include "@/public/input.h"
+#include "@/public/output.h"
+#include "@/public/vm0.h"
+
+#include <github.com/apronchenkov/error/public/error.h>
+#include <github.com/apronchenkov/vm/public/instruction.h>
+#include <github.com/apronchenkov/vm/public/state.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif  // __cplusplus
+
+// Pool of initialized states of one program: the stack memory, the globals
+// frame and the locals frame are kept between the executions, and a state
+// is reset in O(locals_size) instead of being rebuilt.
+//
+// Not thread-safe; use a pool per thread.
+
+struct u7_vm0_pooled_state;
+
+struct u7_vm0_state_pool {
+  struct u7_vm_instruction const* const* js;  // Not owned.
+  size_t instructions_size;
+  struct u7_vm_stack_frame_layout const* locals_frame_layout;  // Not owned.
+  void* locals_template;  // Initial values of the locals; NULL for zeroes.
+  size_t locals_base_offset;  // Base offset of the locals frame.
+  // Installed into the globals by every reset.
+  struct u7_vm0_input* input;
+  struct u7_vm0_output* output;
+  struct u7_vm0_pooled_state* free_states;
+};
+
+// The instructions and the layout must outlive the pool. `locals_template`
+// is NULL, or points to locals_size bytes, which are copied.
+u7_error u7_vm0_state_pool_init(
+    struct u7_vm0_state_pool* self, struct u7_vm_instruction const* const* js,
+    size_t instructions_size,
+    struct u7_vm_stack_frame_layout const* locals_frame_layout,
+    void const* locals_template);
+
+// Destroys the pooled states; the acquired ones must be released first.
+void u7_vm0_state_pool_destroy(struct u7_vm0_state_pool* self);
+
+// Returns a state ready to run the program from the beginning, reusing a
+// released one if possible.
+u7_error u7_vm0_state_pool_acquire(struct u7_vm0_state_pool* self,
+                                   struct u7_vm_state** result);
+
+// Returns the state to the pool; the state may be in any condition, e.g.
+// yielded or failed.
+void u7_vm0_state_pool_release(struct u7_vm0_state_pool* self,
+                               struct u7_vm_state* state);
+
+// Resets an acquired state as if it were acquired anew: drops the frames
+// above the locals frame and the failure, rewinds ip, and restores the
+// locals and the I/O backends.
+void u7_vm0_state_pool_reset(struct u7_vm0_state_pool const* self,
+                             struct u7_vm_state* state);
+
+#ifdef __cplusplus
+}  // extern "C"
+#endif  // __cplusplus
+
+#endif  // U7_VM0_POOL_H_
@@ -0,0 +1,65 @@
+#ifndef U7_VM0_PROFILE_H_
+#define U7_VM0_PROFILE_H_
+
+#include "@/public/opcode.h"
+#include "@/public/vm0.h"
+
+#include <github.com/apronchenkov/error/public/error.h>
+#include <github.com/apronchenkov/vm/public/instruction.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif  // __cplusplus
+
+// Opt-in execution profiler. The profile holds a trampoline per instruction;
+// a trampoline updates the counters and calls the execute_fn of the original
+// instruction. A state initialized with `profile.js` instead of the regular
+// instruction pointers runs the same program with profiling; programs that
+// are not profiled are not affected at all.
+
+struct u7_vm0_profile_entry {
+  uint64_t count;   // Number of executions.
+  uint64_t cycles;  // Time spent in the execute_fn, if measured.
+};
+
+struct u7_vm0_profile {
+  struct u7_vm0_instruction const* instructions;  // Not owned.
+  size_t instructions_size;
+  struct u7_vm_instruction const** js;  // Trampolines, by instruction index.
+  struct u7_vm0_profile_entry* entries;  // By instruction index.
+  bool measure_cycles;
+  void* memory;  // The single allocation that holds all of the above.
+};
+
+// Creates trampolines for the instructions, which must outlive the profile.
+// With `measure_cycles`, every execution is timed with the time stamp counter
+// (or a monotonic clock in nanoseconds, where there is no such counter).
+u7_error u7_vm0_profile_init(struct u7_vm0_profile* self,
+                             struct u7_vm0_instruction const* instructions,
+                             size_t instructions_size, bool measure_cycles);
+
+void u7_vm0_profile_destroy(struct u7_vm0_profile* self);
+
+// Zeroes the counters.
+void u7_vm0_profile_reset(struct u7_vm0_profile* self);
+
+// Sums the counters by opcode; instructions with an unknown opcode are not
+// included.
+void u7_vm0_profile_opcode_entries(
+    struct u7_vm0_profile const* self,
+    struct u7_vm0_profile_entry result[U7_VM0_OPCODE_COUNT]);
+
+// Prints a human-readable report: the counters of every instruction (jump
+// targets are marked with labels L<index>), the counters by opcode, and the
+// loops (ranges closed by a backward jump) ordered by cost.
+void u7_vm0_profile_report(struct u7_vm0_profile const* self, FILE* file);
+
+#ifdef __cplusplus
+}  // extern "C"
+#endif  // __cplusplus
+
+#endif  // U7_VM0_PROFILE_H_
@@ -0,0 +1,71 @@
+#ifndef U7_VM0_PROGRAM_H_
+#define U7_VM0_PROGRAM_H_
+
+#include "@/public/vm0.h"
+
+#include <github.com/apronchenkov/error/public/error.h>
+#include <github.com/apronchenkov/vm/public/instruction.h>
+#include <github.com/apronchenkov/vm/public/state.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif  // __cplusplus
+
+// Serialized program format, version 1. All integers are little-endian.
+//
+//   header:
+//     char magic[8] = "U7VM0PRG"
+//     uint32 version
+//     uint32 opcode_names_size
+//     uint64 instructions_size
+//     uint64 locals_size         -- the locals frame layout
+//     uint64 extra_capacity
+//     uint32 description_size
+//     uint32 reserved
+//   opcode names: opcode_names_size x {uint8 size; char name[size]}
+//   description:  char description[description_size]
+//   (zero padding to a multiple of 8)
+//   instructions: instructions_size x {uint32 opcode_name_index;
+//                                      uint32 reserved;
+//                                      uint64 arg1, arg2, arg3}
+//
+// Instructions refer to opcodes by name, through the name table, so the
+// files stay valid when the opcodes are renumbered. The operand kinds are
+// implied by the opcode; labels are instruction indices. The calls are not
+// supported, as their frame layouts are pointers (see u7_vm0_call()).
+
+#define U7_VM0_PROGRAM_VERSION 1
+
+// A program ready to be executed with u7_vm_state_init(&state, ...,
+// program.js, program.instructions_size), with locals_frame_layout as the
+// current frame.
+struct u7_vm0_program {
+  struct u7_vm0_instruction* instructions;
+  struct u7_vm_instruction const** js;  // Points into `instructions`.
+  size_t instructions_size;
+  struct u7_vm_stack_frame_layout locals_frame_layout;
+  void* memory;  // The single allocation that holds all of the above.
+};
+
+// Writes the program to a file.
+u7_error u7_vm0_program_write(
+    const char* path, struct u7_vm0_instruction const* instructions,
+    size_t instructions_size,
+    struct u7_vm_stack_frame_layout const* locals_frame_layout);
+
+// Loads a program from a memory span. The program is verified with
+// u7_vm0_verify(), so a malformed file cannot produce an unsafe program.
+u7_error u7_vm0_program_load_memory(struct u7_vm0_program* self,
+                                    void const* data, size_t size);
+
+// Maps the file read-only and loads the program from it.
+u7_error u7_vm0_program_load(struct u7_vm0_program* self, const char* path);
+
+void u7_vm0_program_destroy(struct u7_vm0_program* self);
+
+#ifdef __cplusplus
+}  // extern "C"
+#endif  // __cplusplus
+
+#endif  // U7_VM0_PROGRAM_H_
@@ -0,0 +1,75 @@
+#ifndef U7_VM0_RUNNER_H_
+#define U7_VM0_RUNNER_H_
+
+#include "@/public/input.h"
+#include "@/public/output.h"
+#include "@/public/vm0.h"
+
+#include <github.com/apronchenkov/error/public/error.h>
+#include <github.com/apronchenkov/vm/public/state.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif  // __cplusplus
+
+// Executes batches of independent states on a pool of threads. Every worker
+// owns a range of the batch and takes states from its front; an idle worker
+// steals the back half of the range of another worker. A state is run from
+// its current ip until `ret`, a failure or an I/O backend that would block;
+// `yield` only resumes it.
+
+// I/O backends of a worker. A backend is not shared between threads, so it
+// needs no synchronization; NULL keeps the backend of the state.
+struct u7_vm0_runner_backends {
+  struct u7_vm0_input* input;
+  struct u7_vm0_output* output;
+};
+
+struct u7_vm0_runner_worker;
+
+struct u7_vm0_runner {
+  struct u7_vm0_runner_worker* workers;
+  size_t workers_size;
+  pthread_mutex_t mutex;
+  pthread_cond_t start_cond;
+  pthread_cond_t done_cond;
+  uint64_t generation;  // Incremented for every batch.
+  size_t active_workers;
+  bool stop;
+  // The current batch.
+  struct u7_vm_state* const* states;
+  u7_error* errors;
+  struct u7_vm0_runner_backends const* backends;
+};
+
+// Starts `workers_size` threads. The threads refer to the runner, so it must
+// not be moved until it is destroyed.
+u7_error u7_vm0_runner_init(struct u7_vm0_runner* self, size_t workers_size);
+
+// Stops and joins the threads.
+void u7_vm0_runner_destroy(struct u7_vm0_runner* self);
+
+// Runs every state once and waits for the batch to finish. The states may
+// share the instruction array, which is only read. Failures are taken with
+// u7_vm0_state_take_error() into `errors[i]`, or discarded if `errors` is
+// NULL. A state whose backend has failed with EAGAIN stays at the blocked
+// I/O instruction, with u7_vm0_globals.blocked cleared, and is reported with
+// EAGAIN; running it again retries the instruction. `backends` is NULL, or
+// holds an entry per worker that is installed into the globals of the states
+// run by the worker.
+//
+// Not thread-safe: a runner executes one batch at a time.
+void u7_vm0_runner_run(struct u7_vm0_runner* self,
+                       struct u7_vm_state* const* states, u7_error* errors,
+                       size_t states_size,
+                       struct u7_vm0_runner_backends const* backends);
+
+#ifdef __cplusplus
+}  // extern "C"
+#endif  // __cplusplus
+
+#endif  // U7_VM0_RUNNER_H_
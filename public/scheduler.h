@@ -0,0 +1,68 @@
+#ifndef U7_VM0_SCHEDULER_H_
+#define U7_VM0_SCHEDULER_H_
+
+#include "@/public/vm0.h"
+
+#include <github.com/apronchenkov/error/public/error.h>
+#include <github.com/apronchenkov/vm/public/state.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif  // __cplusplus
+
+// Cooperative scheduler that multiplexes states on the calling thread. A
+// task runs until it yields, blocks on I/O, finishes, or exhausts the
+// instruction budget of a time slice; then the next runnable task of the
+// highest priority runs. Tasks of the same priority take turns.
+//
+// The tasks are executed by a dispatch loop that counts instructions, like
+// u7_vm_state_run(); the threaded, compact and JIT engines are not used.
+
+#define U7_VM0_SCHEDULER_PRIORITIES 4
+
+enum u7_vm0_task_status {
+  U7_VM0_TASK_RUNNABLE,
+  U7_VM0_TASK_BLOCKED,   // Waits for u7_vm0_scheduler_wake().
+  U7_VM0_TASK_FINISHED,  // Executed `ret`, or failed.
+};
+
+struct u7_vm0_task {
+  struct u7_vm_state* state;  // Not owned.
+  int priority;  // From 0 to U7_VM0_SCHEDULER_PRIORITIES - 1; 0 is the highest.
+  enum u7_vm0_task_status status;
+  u7_error error;         // The failure of a finished task.
+  uint64_t instructions;  // The number of executed instructions.
+  struct u7_vm0_task* next;  // The run queue.
+};
+
+struct u7_vm0_scheduler {
+  size_t budget;  // Instructions per time slice.
+  struct u7_vm0_task* heads[U7_VM0_SCHEDULER_PRIORITIES];
+  struct u7_vm0_task* tails[U7_VM0_SCHEDULER_PRIORITIES];
+  size_t blocked_size;
+};
+
+u7_error u7_vm0_scheduler_init(struct u7_vm0_scheduler* self, size_t budget);
+
+// Adds a runnable task. The task and the state must outlive the scheduler,
+// or the task must be finished.
+u7_error u7_vm0_scheduler_spawn(struct u7_vm0_scheduler* self,
+                                struct u7_vm0_task* task,
+                                struct u7_vm_state* state, int priority);
+
+// Makes a blocked task runnable again; the blocked I/O instruction is retried.
+void u7_vm0_scheduler_wake(struct u7_vm0_scheduler* self,
+                           struct u7_vm0_task* task);
+
+// Runs the tasks until none of them is runnable. Returns the number of the
+// blocked tasks, which the caller is expected to wake when their backends
+// are ready.
+size_t u7_vm0_scheduler_run(struct u7_vm0_scheduler* self);
+
+#ifdef __cplusplus
+}  // extern "C"
+#endif  // __cplusplus
+
+#endif  // U7_VM0_SCHEDULER_H_
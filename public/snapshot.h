@@ -0,0 +1,56 @@
+#ifndef U7_VM0_SNAPSHOT_H_
+#define U7_VM0_SNAPSHOT_H_
+
+#include "@/public/vm0.h"
+
+#include <github.com/apronchenkov/error/public/error.h>
+#include <github.com/apronchenkov/vm/public/state.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif  // __cplusplus
+
+// Snapshot format, version 2. All integers are little-endian.
+//
+//   header:
+//     char magic[8] = "U7VM0SNP"
+//     uint32 version
+//     uint32 flags               -- bit 0: u7_vm0_globals.blocked
+//     uint64 instructions_size
+//     uint64 ip
+//     uint64 locals_size
+//     uint64 io_done             -- u7_vm0_globals.io_done
+//     int32 error_code           -- the pending failure, or 0
+//     uint32 message_size        -- at most U7_VM0_SNAPSHOT_MAX_MESSAGE_SIZE
+//   message: char message[message_size]
+//   (zero padding to a multiple of 8)
+//   locals: char locals[locals_size]
+//
+// The locals are stored as raw bytes, so a snapshot can be restored only on
+// a host with the same byte order. The I/O backends are not saved.
+
+#define U7_VM0_SNAPSHOT_VERSION 2
+
+// Longer messages of the pending failure are truncated when saved, and
+// rejected when restored.
+#define U7_VM0_SNAPSHOT_MAX_MESSAGE_SIZE 4096
+
+// Saves a state that is not running (e.g. after `yield`, or between runs)
+// to a buffer allocated with malloc(). Only the frame of the program is
+// saved, so a state that has yielded inside a call is rejected.
+u7_error u7_vm0_snapshot_save(struct u7_vm_state* state, void** data,
+                              size_t* size);
+
+// Restores a snapshot into a state that has been initialized for the same
+// program, with a locals frame of the same size as the current frame (e.g.
+// a new state, or one acquired from a u7_vm0_state_pool). The pending
+// failure, if any, is restored as an error.
+u7_error u7_vm0_snapshot_restore(struct u7_vm_state* state, void const* data,
+                                 size_t size);
+
+#ifdef __cplusplus
+}  // extern "C"
+#endif  // __cplusplus
+
+#endif  // U7_VM0_SNAPSHOT_H_
@@ -0,0 +1,50 @@
+#ifndef U7_VM0_THREADED_H_
+#define U7_VM0_THREADED_H_
+
+#include "@/public/vm0.h"
+
+#include <github.com/apronchenkov/error/public/error.h>
+#include <github.com/apronchenkov/vm/public/state.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif  // __cplusplus
+
+// Direct-threaded form of a program: every instruction carries the address
+// of its handler inside u7_vm0_threaded_run(), so the handlers jump straight
+// to each other without a call/return per instruction.
+
+struct u7_vm0_threaded_instruction {
+  void const* handler;
+  struct u7_vm0_instruction instruction;
+};
+
+struct u7_vm0_threaded_program {
+  struct u7_vm0_threaded_instruction* instructions;
+  size_t instructions_size;
+};
+
+// Translates a finished instruction array. The instructions are copied, so
+// the source array does not need to outlive the threaded program.
+u7_error u7_vm0_threaded_program_init(
+    struct u7_vm0_threaded_program* self,
+    struct u7_vm0_instruction const* instructions, size_t instructions_size);
+
+void u7_vm0_threaded_program_destroy(struct u7_vm0_threaded_program* self);
+
+// Counterpart of u7_vm_state_run(): executes the program from state->ip
+// until `yield`, `ret` or a panic. Errors are reported through
+// u7_vm0_globals (see u7_vm0_state_take_error()), exactly as by the regular
+// dispatch loop.
+//
+// The state must have been initialized with the same number of
+// instructions as the threaded program.
+void u7_vm0_threaded_run(struct u7_vm0_threaded_program const* program,
+                         struct u7_vm_state* state);
+
+#ifdef __cplusplus
+}  // extern "C"
+#endif  // __cplusplus
+
+#endif  // U7_VM0_THREADED_H_
@@ -0,0 +1,51 @@
+#ifndef U7_VM0_VECTOR_H_
+#define U7_VM0_VECTOR_H_
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif  // __cplusplus
+
+// Kernels of the vector instructions. They use AVX2 or SSE2, if the CPU
+// supports them (it is checked once, at the first call), and scalar code
+// otherwise.
+//
+// The results do not depend on the chosen implementation: a multiply-add
+// rounds the product and the sum separately, and the reductions accumulate
+// element k into the partial sum k % 4 (f64) or k % 8 (f32), then add the
+// partial sums pairwise: ((p0 + p1) + (p2 + p3)).
+//
+// A source array must either coincide with the destination or not overlap
+// it. The arrays do not need to be aligned.
+
+void u7_vm0_vector_add_f32(float* dst, float const* lhs, float const* rhs,
+                           size_t n);
+void u7_vm0_vector_add_f64(double* dst, double const* lhs, double const* rhs,
+                           size_t n);
+
+void u7_vm0_vector_multiply_f32(float* dst, float const* lhs,
+                                float const* rhs, size_t n);
+void u7_vm0_vector_multiply_f64(double* dst, double const* lhs,
+                                double const* rhs, size_t n);
+
+// dst[k] += lhs[k] * rhs[k]
+void u7_vm0_vector_multiply_add_f32(float* dst, float const* lhs,
+                                    float const* rhs, size_t n);
+void u7_vm0_vector_multiply_add_f64(double* dst, double const* lhs,
+                                    double const* rhs, size_t n);
+
+float u7_vm0_vector_dot_f32(float const* lhs, float const* rhs, size_t n);
+double u7_vm0_vector_dot_f64(double const* lhs, double const* rhs, size_t n);
+
+float u7_vm0_vector_sum_f32(float const* src, size_t n);
+double u7_vm0_vector_sum_f64(double const* src, size_t n);
+
+void u7_vm0_vector_broadcast_f32(float* dst, float value, size_t n);
+void u7_vm0_vector_broadcast_f64(double* dst, double value, size_t n);
+
+#ifdef __cplusplus
+}  // extern "C"
+#endif  // __cplusplus
+
+#endif  // U7_VM0_VECTOR_H_
@@ -0,0 +1,40 @@
+#ifndef U7_VM0_VERIFY_H_
+#define U7_VM0_VERIFY_H_
+
+#include "@/public/vm0.h"
+
+#include <github.com/apronchenkov/error/public/error.h>
+#include <github.com/apronchenkov/vm/public/state.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif  // __cplusplus
+
+// Checks the program once, at load time:
+//  * every instruction was constructed by this library;
+//  * every label is within [0, instructions_size), and the entries of
+//    every jump table are `jump`s;
+//  * every shift by a constant has a count below the width of the value;
+//  * every variable is aligned and fits into the locals frame; the
+//    instructions reachable from the label of a call are checked against
+//    the frame layout of the callee, and the arguments of a call must fit
+//    into both frames (and into U7_VM0_TAIL_CALL_MAX_COUNT slots, for a
+//    tail call);
+//  * the program ends with `ret` (or `ret_value`), so execution cannot run
+//    past its end.
+//
+// On success replaces the jump instructions with the variants that do not
+// re-check the label on every execution; a jump table then reads the label
+// of its entry directly. The verified program must be executed with
+// `locals_frame_layout` (or a layout with no smaller locals_size) as the
+// current frame.
+u7_error u7_vm0_verify(
+    struct u7_vm0_instruction* instructions, size_t instructions_size,
+    struct u7_vm_stack_frame_layout const* locals_frame_layout);
+
+#ifdef __cplusplus
+}  // extern "C"
+#endif  // __cplusplus
+
+#endif  // U7_VM0_VERIFY_H_
@@ -7,6 +7,8 @@
 #include <github.com/apronchenkov/error/public/error.h>
 #include <github.com/apronchenkov/vm/public/instruction.h>
 #include <github.com/apronchenkov/vm/public/state.h>
+#include <stdbool.h>
+#include <stddef.h>
 #include <stdint.h>
 
 #ifdef __cplusplus
@@ -15,10 +17,40 @@ extern "C" {
 
 // Endpoints for interaction with VM.
 
+// The failures of the arithmetic and jump instructions are recorded as a
+// fault, without formatting a message; other failures are stored as an error.
+enum u7_vm0_fault_kind {
+  U7_VM0_FAULT_NONE,
+  U7_VM0_FAULT_INTEGER_OVERFLOW,    // Operands: lhs, rhs.
+  U7_VM0_FAULT_SHIFT_OUT_OF_RANGE,  // Operands: the shift count.
+  U7_VM0_FAULT_LABEL_OUT_OF_RANGE,  // Operands: the label.
+};
+
+struct u7_vm0_fault {
+  int error_code;  // 0, if there is no fault.
+  enum u7_vm0_fault_kind kind;
+  const char* function;      // Static string; the prefix of the message.
+  size_t instruction_index;  // Index of the failed instruction.
+  // Identifies the opcode; see u7_vm0_fault_opcode().
+  bool (*execute_fn)(struct u7_vm_state* state,
+                     struct u7_vm_instruction const* self);
+  int64_t operands[2];
+};
+
 struct u7_vm0_globals {
   u7_error error;
+  struct u7_vm0_fault fault;
   struct u7_vm0_input* input;
   struct u7_vm0_output* output;
+  // Set when the program has stopped because an I/O backend returned EAGAIN;
+  // ip refers to the I/O instruction, so resuming the program retries it.
+  // Cleared by the caller.
+  bool blocked;
+  // Number of the values that a blocked input_n or output_n has already
+  // transferred; the retry resumes after them. 0 otherwise.
+  size_t io_done;
+  // Number of the calls that have not returned yet; see u7_vm0_call().
+  size_t call_depth;
 };
 
 extern struct u7_vm_stack_frame_layout const* const u7_vm0_globals_frame_layout;
@@ -29,6 +61,22 @@ static inline struct u7_vm0_globals* u7_vm0_state_globals(
   return (struct u7_vm0_globals*)u7_vm_state_globals(state);
 }
 
+// Returns true if the program has failed with an error or a fault.
+static inline bool u7_vm0_state_failed(struct u7_vm_state* state) {
+  struct u7_vm0_globals const* globals = u7_vm0_state_globals(state);
+  return globals->error.error_code != 0 || globals->fault.error_code != 0;
+}
+
+// Returns the failure of the program, formatting the message of a fault, and
+// resets it; returns u7_ok() if the program has not failed.
+u7_error u7_vm0_state_take_error(struct u7_vm_state* state);
+
+// Resets the failure of the program without formatting a message.
+void u7_vm0_state_clear_error(struct u7_vm_state* state);
+
+// Formats the message of a fault, without resetting it.
+u7_error u7_vm0_fault_error(struct u7_vm0_fault const* fault);
+
 // Returns pointer to the input interface stored in the global structure.
 static inline struct u7_vm0_input* u7_vm0_state_global_input(
     struct u7_vm_state* state) {
@@ -82,6 +130,49 @@ static inline double* u7_vm0_state_local_f64(struct u7_vm_state* state,
   return (double*)u7_vm_memory_add_offset(u7_vm_state_locals(state), offset);
 }
 
+// Same as u7_vm0_state_local_*(), but relative to `locals`, a cached value of
+// u7_vm_state_locals(state). Engines keep the cache in a register across
+// instructions, and must refresh it whenever the current frame may change.
+static inline int32_t* u7_vm0_cached_local_i32(struct u7_vm_state* state,
+                                               void* locals, int64_t offset) {
+  assert(locals == u7_vm_state_locals(state));
+  assert(offset % u7_vm_alignof(int32_t) == 0);
+  assert(offset >= 0);
+  assert(offset + sizeof(int32_t) <=
+         u7_vm_stack_current_frame_layout(&state->stack)->locals_size);
+  return (int32_t*)u7_vm_memory_add_offset(locals, offset);
+}
+
+static inline int64_t* u7_vm0_cached_local_i64(struct u7_vm_state* state,
+                                               void* locals, int64_t offset) {
+  assert(locals == u7_vm_state_locals(state));
+  assert(offset % u7_vm_alignof(int64_t) == 0);
+  assert(offset >= 0);
+  assert(offset + sizeof(int64_t) <=
+         u7_vm_stack_current_frame_layout(&state->stack)->locals_size);
+  return (int64_t*)u7_vm_memory_add_offset(locals, offset);
+}
+
+static inline float* u7_vm0_cached_local_f32(struct u7_vm_state* state,
+                                             void* locals, int64_t offset) {
+  assert(locals == u7_vm_state_locals(state));
+  assert(offset % u7_vm_alignof(float) == 0);
+  assert(offset >= 0);
+  assert(offset + sizeof(float) <=
+         u7_vm_stack_current_frame_layout(&state->stack)->locals_size);
+  return (float*)u7_vm_memory_add_offset(locals, offset);
+}
+
+static inline double* u7_vm0_cached_local_f64(struct u7_vm_state* state,
+                                              void* locals, int64_t offset) {
+  assert(locals == u7_vm_state_locals(state));
+  assert(offset % u7_vm_alignof(double) == 0);
+  assert(offset >= 0);
+  assert(offset + sizeof(double) <=
+         u7_vm_stack_current_frame_layout(&state->stack)->locals_size);
+  return (double*)u7_vm_memory_add_offset(locals, offset);
+}
+
 // Instructions.
 
 union u7_vm0_value {
@@ -119,6 +210,15 @@ struct u7_vm0_instruction u7_vm0_input(u7_error* error, struct u7_vm0_arg dst);
 
 struct u7_vm0_instruction u7_vm0_output(u7_error* error, struct u7_vm0_arg dst);
 
+// Reads `count` values into consecutive variables, starting from `dst`.
+struct u7_vm0_instruction u7_vm0_input_n(u7_error* error,
+                                         struct u7_vm0_arg dst, int64_t count);
+
+// Writes `count` consecutive variables, starting from `src`.
+struct u7_vm0_instruction u7_vm0_output_n(u7_error* error,
+                                          struct u7_vm0_arg src,
+                                          int64_t count);
+
 struct u7_vm0_instruction u7_vm0_copy(u7_error* error, struct u7_vm0_arg dst,
                                       struct u7_vm0_arg src);
 
@@ -150,6 +250,157 @@ struct u7_vm0_instruction u7_vm0_jump_if_not_zero(u7_error* error,
                                                   struct u7_vm0_arg src,
                                                   struct u7_vm0_arg label);
 
+// Compare-and-branch: jumps to `label` if `lhs` compares to `rhs` as the name
+// says. `lhs` is a variable, and `rhs` is a variable or a constant of the same
+// type. A comparison with NaN is false, except for jump_if_not_equal.
+struct u7_vm0_instruction u7_vm0_jump_if_equal(u7_error* error,
+                                               struct u7_vm0_arg lhs,
+                                               struct u7_vm0_arg rhs,
+                                               struct u7_vm0_arg label);
+
+struct u7_vm0_instruction u7_vm0_jump_if_not_equal(u7_error* error,
+                                                   struct u7_vm0_arg lhs,
+                                                   struct u7_vm0_arg rhs,
+                                                   struct u7_vm0_arg label);
+
+struct u7_vm0_instruction u7_vm0_jump_if_less(u7_error* error,
+                                              struct u7_vm0_arg lhs,
+                                              struct u7_vm0_arg rhs,
+                                              struct u7_vm0_arg label);
+
+struct u7_vm0_instruction u7_vm0_jump_if_less_or_equal(
+    u7_error* error, struct u7_vm0_arg lhs, struct u7_vm0_arg rhs,
+    struct u7_vm0_arg label);
+
+struct u7_vm0_instruction u7_vm0_jump_if_greater(u7_error* error,
+                                                 struct u7_vm0_arg lhs,
+                                                 struct u7_vm0_arg rhs,
+                                                 struct u7_vm0_arg label);
+
+struct u7_vm0_instruction u7_vm0_jump_if_greater_or_equal(
+    u7_error* error, struct u7_vm0_arg lhs, struct u7_vm0_arg rhs,
+    struct u7_vm0_arg label);
+
+struct u7_vm0_instruction u7_vm0_jump(u7_error* error,
+                                      struct u7_vm0_arg label);
+
+// Jumps to the entry `src` of the table, or to `label` if src is not within
+// [0, count). The table is the `count` instructions that follow this one,
+// and they must be `jump`s (see u7_vm0_jump()); `src` is an i32 or i64
+// variable. Once the program is verified, the jump goes straight to the
+// label of the entry.
+struct u7_vm0_instruction u7_vm0_jump_table(u7_error* error,
+                                            struct u7_vm0_arg src,
+                                            int64_t count,
+                                            struct u7_vm0_arg label);
+
+// Vector instructions over arrays of `count` consecutive f32 or f64
+// variables, starting from the given ones (see public/vector.h). A source
+// array must either coincide with the destination array or not overlap it.
+
+// dst[k] = lhs[k] + rhs[k]
+struct u7_vm0_instruction u7_vm0_vector_add(u7_error* error,
+                                            struct u7_vm0_arg dst,
+                                            struct u7_vm0_arg lhs,
+                                            struct u7_vm0_arg rhs,
+                                            int64_t count);
+
+// dst[k] = lhs[k] * rhs[k]
+struct u7_vm0_instruction u7_vm0_vector_multiply(u7_error* error,
+                                                 struct u7_vm0_arg dst,
+                                                 struct u7_vm0_arg lhs,
+                                                 struct u7_vm0_arg rhs,
+                                                 int64_t count);
+
+// dst[k] += lhs[k] * rhs[k]
+struct u7_vm0_instruction u7_vm0_vector_multiply_add(u7_error* error,
+                                                     struct u7_vm0_arg dst,
+                                                     struct u7_vm0_arg lhs,
+                                                     struct u7_vm0_arg rhs,
+                                                     int64_t count);
+
+// dst = sum(lhs[k] * rhs[k])
+struct u7_vm0_instruction u7_vm0_vector_dot(u7_error* error,
+                                            struct u7_vm0_arg dst,
+                                            struct u7_vm0_arg lhs,
+                                            struct u7_vm0_arg rhs,
+                                            int64_t count);
+
+// dst = sum(src[k])
+struct u7_vm0_instruction u7_vm0_vector_sum(u7_error* error,
+                                            struct u7_vm0_arg dst,
+                                            struct u7_vm0_arg src,
+                                            int64_t count);
+
+// dst[k] = src
+struct u7_vm0_instruction u7_vm0_vector_broadcast(u7_error* error,
+                                                  struct u7_vm0_arg dst,
+                                                  struct u7_vm0_arg src,
+                                                  int64_t count);
+
+// dst = lhs * rhs, for `size` x `size` matrices (size is 2, 3 or 4) of i64 or
+// f64 variables, stored row-major starting from the given ones. As with
+// u7_vm0_math_add() and u7_vm0_math_multiply(), an i64 overflow is a
+// failure; `dst` is not modified then. A source must either coincide with
+// `dst` or not overlap it.
+struct u7_vm0_instruction u7_vm0_matrix_multiply(u7_error* error,
+                                                 struct u7_vm0_arg dst,
+                                                 struct u7_vm0_arg lhs,
+                                                 struct u7_vm0_arg rhs,
+                                                 int64_t size);
+
+// Functions. A function is a part of the program that starts at a label and
+// runs in a frame of its own, pushed onto the stack by the call:
+//
+//  * `call` pushes a frame with `frame_layout` (which must outlive the
+//    program), copies `count` 8-byte slots, starting from the variable
+//    `args`, to the beginning of the new frame, and jumps to the label;
+//  * `ret` pops the frame and resumes the caller after the call;
+//    `ret_value` also writes `src` to the first slot of the arguments
+//    (which must exist even if `count` is 0). Outside of a call, `ret` and
+//    `ret_value` end the program.
+//
+// The slots may hold variables of any type; an i32 or f32 variable occupies
+// the beginning of its slot.
+struct u7_vm0_instruction u7_vm0_call(
+    u7_error* error, struct u7_vm0_arg label,
+    struct u7_vm_stack_frame_layout const* frame_layout,
+    struct u7_vm0_arg args, int64_t count);
+
+// Maximum number of the argument slots of u7_vm0_tail_call().
+#define U7_VM0_TAIL_CALL_MAX_COUNT 32
+
+// Same as u7_vm0_call(), but the callee replaces the current function: its
+// frame takes the place of the current one, and it returns to the caller of
+// the current function. If the frames have the same layout, the current one
+// is reused: the arguments are moved to its beginning, and the other
+// variables keep their values instead of being zeroed, so a self-recursive
+// call costs about as much as a jump. Otherwise the arguments are saved on
+// the C stack while the frames are swapped; in either case `count` is at
+// most U7_VM0_TAIL_CALL_MAX_COUNT. Outside of a call, it is a regular call.
+struct u7_vm0_instruction u7_vm0_tail_call(
+    u7_error* error, struct u7_vm0_arg label,
+    struct u7_vm_stack_frame_layout const* frame_layout,
+    struct u7_vm0_arg args, int64_t count);
+
+struct u7_vm0_instruction u7_vm0_ret_value(u7_error* error,
+                                           struct u7_vm0_arg src);
+
+// The steps of `call` and `ret`, for the engines that execute them without
+// the regular execute_fn. u7_vm0_state_enter_call() pushes the frames of a
+// call to the function at `target` (a valid label) with the SLOTS operand
+// `slots`, and sets ip to `target`; state->ip must point after the call.
+// u7_vm0_state_leave_call() pops them, writes `result_size` bytes of
+// `result` to the result slot, and sets ip after the call. Both return
+// false if the program stops: on a failure, and when leaving outside of a
+// call, which ends the program.
+bool u7_vm0_state_enter_call(
+    struct u7_vm_state* state, size_t target,
+    struct u7_vm_stack_frame_layout const* frame_layout, int64_t slots);
+
+bool u7_vm0_state_leave_call(struct u7_vm_state* state, void const* result,
+                             size_t result_size);
+
 struct u7_vm0_instruction u7_vm0_yield();
 struct u7_vm0_instruction u7_vm0_ret();
 
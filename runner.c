@@ -0,0 +1,216 @@
+#include "@/public/runner.h"
+
+#include <errno.h>
+#include <github.com/apronchenkov/error/public/error.h>
+#include <github.com/apronchenkov/vm/public/state.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define U7_VM0_RUNNER_CACHE_LINE_SIZE 64
+
+struct u7_vm0_runner_worker {
+  struct u7_vm0_runner* runner;
+  size_t index;
+  pthread_t thread;
+  pthread_mutex_t mutex;  // Guards the range.
+  size_t begin;
+  size_t end;
+} __attribute__((aligned(U7_VM0_RUNNER_CACHE_LINE_SIZE)));
+
+// Takes the front state of the worker's range; returns false if the range is
+// empty.
+static bool u7_vm0_runner_pop(struct u7_vm0_runner_worker* worker,
+                              size_t* result) {
+  pthread_mutex_lock(&worker->mutex);
+  const bool ok = (worker->begin < worker->end);
+  if (ok) {
+    *result = worker->begin++;
+  }
+  pthread_mutex_unlock(&worker->mutex);
+  return ok;
+}
+
+// Moves the back half of another worker's range to the worker; returns false
+// if there is nothing left to steal.
+static bool u7_vm0_runner_steal(struct u7_vm0_runner_worker* worker) {
+  struct u7_vm0_runner* runner = worker->runner;
+  for (size_t i = 1; i < runner->workers_size; ++i) {
+    struct u7_vm0_runner_worker* victim =
+        &runner->workers[(worker->index + i) % runner->workers_size];
+    pthread_mutex_lock(&victim->mutex);
+    const size_t begin = victim->begin;
+    const size_t end = victim->end;
+    if (begin < end) {
+      victim->end = begin + (end - begin) / 2;
+    }
+    const size_t middle = victim->end;
+    pthread_mutex_unlock(&victim->mutex);
+    if (begin < end) {
+      pthread_mutex_lock(&worker->mutex);
+      worker->begin = middle;
+      worker->end = end;
+      pthread_mutex_unlock(&worker->mutex);
+      return true;
+    }
+  }
+  return false;
+}
+
+static void u7_vm0_runner_execute(struct u7_vm0_runner_worker* worker,
+                                  size_t i) {
+  struct u7_vm0_runner* runner = worker->runner;
+  struct u7_vm_state* state = runner->states[i];
+  if (runner->backends != NULL) {
+    struct u7_vm0_runner_backends const* backends =
+        &runner->backends[worker->index];
+    struct u7_vm0_globals* globals = u7_vm0_state_globals(state);
+    if (backends->input != NULL) {
+      globals->input = backends->input;
+    }
+    if (backends->output != NULL) {
+      globals->output = backends->output;
+    }
+  }
+  // `ret` and the failures reset ip to 0, and `yield` never does. A blocked
+  // I/O instruction stops the state where it is, as the batch cannot wait
+  // for its backend.
+  struct u7_vm0_globals* globals = u7_vm0_state_globals(state);
+  do {
+    u7_vm_state_run(state);
+  } while (!globals->blocked && state->ip != 0 &&
+           !u7_vm0_state_failed(state));
+  if (globals->blocked) {
+    globals->blocked = false;
+    if (runner->errors != NULL) {
+      runner->errors[i] =
+          u7_errnof(EAGAIN, "u7_vm0_runner_run: blocked at instruction %zu",
+                    state->ip);
+    }
+  } else if (runner->errors != NULL) {
+    runner->errors[i] = u7_vm0_state_take_error(state);
+  } else {
+    u7_vm0_state_clear_error(state);
+  }
+}
+
+static void* u7_vm0_runner_thread(void* arg) {
+  struct u7_vm0_runner_worker* worker = arg;
+  struct u7_vm0_runner* runner = worker->runner;
+  uint64_t generation = 0;
+  for (;;) {
+    pthread_mutex_lock(&runner->mutex);
+    while (!runner->stop && runner->generation == generation) {
+      pthread_cond_wait(&runner->start_cond, &runner->mutex);
+    }
+    if (runner->stop) {
+      pthread_mutex_unlock(&runner->mutex);
+      return NULL;
+    }
+    generation = runner->generation;
+    pthread_mutex_unlock(&runner->mutex);
+    // No states are added to a batch, so once every range is seen empty, the
+    // remaining states are owned by the workers that are running them.
+    size_t i;
+    while (u7_vm0_runner_pop(worker, &i) ||
+           (u7_vm0_runner_steal(worker) && u7_vm0_runner_pop(worker, &i))) {
+      u7_vm0_runner_execute(worker, i);
+    }
+    pthread_mutex_lock(&runner->mutex);
+    if (--runner->active_workers == 0) {
+      pthread_cond_signal(&runner->done_cond);
+    }
+    pthread_mutex_unlock(&runner->mutex);
+  }
+}
+
+// Stops the first `threads_size` threads and releases the resources.
+static void u7_vm0_runner_shutdown(struct u7_vm0_runner* self,
+                                   size_t threads_size) {
+  pthread_mutex_lock(&self->mutex);
+  self->stop = true;
+  pthread_cond_broadcast(&self->start_cond);
+  pthread_mutex_unlock(&self->mutex);
+  for (size_t i = 0; i < threads_size; ++i) {
+    pthread_join(self->workers[i].thread, NULL);
+  }
+  for (size_t i = 0; i < self->workers_size; ++i) {
+    pthread_mutex_destroy(&self->workers[i].mutex);
+  }
+  pthread_cond_destroy(&self->done_cond);
+  pthread_cond_destroy(&self->start_cond);
+  pthread_mutex_destroy(&self->mutex);
+  free(self->workers);
+  self->workers = NULL;
+  self->workers_size = 0;
+}
+
+u7_error u7_vm0_runner_init(struct u7_vm0_runner* self, size_t workers_size) {
+  if (workers_size == 0) {
+    return u7_errnof(EINVAL, "u7_vm0_runner_init: no workers");
+  }
+  const size_t size = workers_size * sizeof(struct u7_vm0_runner_worker);
+  if (size / sizeof(struct u7_vm0_runner_worker) != workers_size) {
+    return u7_errnof(ENOMEM, "u7_vm0_runner_init: out of memory");
+  }
+  struct u7_vm0_runner_worker* workers =
+      aligned_alloc(U7_VM0_RUNNER_CACHE_LINE_SIZE, size);
+  if (workers == NULL) {
+    return u7_errnof(ENOMEM, "u7_vm0_runner_init: out of memory");
+  }
+  memset(workers, 0, size);
+  *self = (struct u7_vm0_runner){
+      .workers = workers,
+      .workers_size = workers_size,
+  };
+  pthread_mutex_init(&self->mutex, NULL);
+  pthread_cond_init(&self->start_cond, NULL);
+  pthread_cond_init(&self->done_cond, NULL);
+  for (size_t i = 0; i < workers_size; ++i) {
+    workers[i].runner = self;
+    workers[i].index = i;
+    pthread_mutex_init(&workers[i].mutex, NULL);
+  }
+  for (size_t i = 0; i < workers_size; ++i) {
+    const int error_code = pthread_create(&workers[i].thread, NULL,
+                                          u7_vm0_runner_thread, &workers[i]);
+    if (error_code != 0) {
+      u7_vm0_runner_shutdown(self, i);
+      return u7_errnof(error_code, "u7_vm0_runner_init: pthread_create: %s",
+                       strerror(error_code));
+    }
+  }
+  return u7_ok();
+}
+
+void u7_vm0_runner_destroy(struct u7_vm0_runner* self) {
+  u7_vm0_runner_shutdown(self, self->workers_size);
+}
+
+void u7_vm0_runner_run(struct u7_vm0_runner* self,
+                       struct u7_vm_state* const* states, u7_error* errors,
+                       size_t states_size,
+                       struct u7_vm0_runner_backends const* backends) {
+  if (states_size == 0) {
+    return;
+  }
+  const size_t n = self->workers_size;
+  for (size_t i = 0; i < n; ++i) {
+    // The workers are idle, and take the lock before reading the range.
+    self->workers[i].begin = states_size * i / n;
+    self->workers[i].end = states_size * (i + 1) / n;
+  }
+  pthread_mutex_lock(&self->mutex);
+  self->states = states;
+  self->errors = errors;
+  self->backends = backends;
+  self->generation += 1;
+  self->active_workers = n;
+  pthread_cond_broadcast(&self->start_cond);
+  while (self->active_workers > 0) {
+    pthread_cond_wait(&self->done_cond, &self->mutex);
+  }
+  self->states = NULL;
+  self->errors = NULL;
+  self->backends = NULL;
+  pthread_mutex_unlock(&self->mutex);
+}
@@ -0,0 +1,324 @@
+#include "@/public/runner.h"
+
+#include "@/public/assembler.h"
+#include "@/public/program.h"
+#include "@/testing.h"
+
+#include <errno.h>
+#include <github.com/apronchenkov/error/public/error.h>
+#include <github.com/apronchenkov/vm/public/state.h>
+#include <inttypes.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+// Tests for u7_vm0_runner_run(): every state of a batch is run to `ret` or
+// to its own failure, independently of the other states and of the worker
+// that runs it.
+
+enum { TEST_STATES = 96, TEST_WORKERS = 4 };
+
+// Writes 1 + 2 + ... + n, yielding on every iteration; fails with ERANGE if
+// n * n overflows, and with ENODATA without input.
+static const char sum_text[] =
+    "i64 n, i, s, t\n"
+    "read n\n"
+    "t = n * n\n"
+    "i = 0\n"
+    "s = 0\n"
+    "jz n, done\n"
+    "loop: i = i + 1\n"
+    "s = s + i\n"
+    "yield\n"
+    "if i < n goto loop\n"
+    "done: write s\n"
+    "ret\n";
+
+// The inputs of the batch: state i sums to i, except that every seventh
+// state overflows and every eleventh state has no input.
+static size_t batch_input(size_t i, int64_t* input) {
+  if (i % 11 == 5) {
+    return 0;
+  }
+  *input = (i % 7 == 3 ? INT64_MAX : (int64_t)i);
+  return 1;
+}
+
+static int batch_error_code(size_t i) {
+  if (i % 11 == 5) {
+    return ENODATA;
+  }
+  return (i % 7 == 3 ? ERANGE : 0);
+}
+
+struct batch {
+  struct u7_vm0_test_state test_states[TEST_STATES];
+  struct u7_vm_state* states[TEST_STATES];
+  int64_t inputs[TEST_STATES];
+  int64_t outputs[TEST_STATES];
+  size_t size;
+};
+
+static u7_error batch_init(struct batch* self,
+                           struct u7_vm0_program const* program) {
+  self->size = 0;
+  for (size_t i = 0; i < TEST_STATES; ++i) {
+    const size_t input_size = batch_input(i, &self->inputs[i]);
+    u7_error error = u7_vm0_test_state_init(
+        &self->test_states[i], program, program->js, &self->inputs[i],
+        input_size, &self->outputs[i], 1);
+    if (error.error_code != 0) {
+      return error;
+    }
+    self->states[i] = &self->test_states[i].state;
+    self->size += 1;
+  }
+  return u7_ok();
+}
+
+static void batch_destroy(struct batch* self) {
+  for (size_t i = 0; i < self->size; ++i) {
+    u7_vm0_test_state_destroy(&self->test_states[i]);
+  }
+}
+
+// Checks the output of every state of the batch, and the errors unless
+// `errors` is NULL.
+static u7_error batch_check(const char* name, struct batch* self,
+                            u7_error* errors) {
+  for (size_t i = 0; i < self->size; ++i) {
+    const int error_code = batch_error_code(i);
+    if (errors != NULL) {
+      char error_name[64];
+      snprintf(error_name, sizeof(error_name), "%s: state %zu", name, i);
+      u7_error error =
+          u7_vm0_test_expect_error(error_name, errors[i], error_code);
+      errors[i] = u7_ok();
+      if (error.error_code != 0) {
+        return error;
+      }
+    }
+    struct u7_vm_state* state = self->states[i];
+    if (u7_vm0_state_failed(state) || state->ip != 0) {
+      return u7_errnof(EINVAL, "%s: state %zu: not finished", name, i);
+    }
+    const size_t output_size =
+        u7_vm0_test_state_output_size(&self->test_states[i]);
+    if (output_size != (error_code == 0 ? 1 : 0)) {
+      return u7_errnof(EINVAL, "%s: state %zu: %zu values written", name, i,
+                       output_size);
+    }
+    const int64_t expected = (int64_t)i * ((int64_t)i + 1) / 2;
+    if (error_code == 0 && self->outputs[i] != expected) {
+      return u7_errnof(EINVAL,
+                       "%s: state %zu: expected %" PRId64 ", got %" PRId64,
+                       name, i, expected, self->outputs[i]);
+    }
+  }
+  return u7_ok();
+}
+
+// Runs a batch on `workers_size` workers, then another one on the same
+// runner with the errors discarded.
+static u7_error check_batches(const char* name, size_t workers_size) {
+  struct u7_vm0_program program;
+  u7_error error = u7_vm0_assemble(&program, sum_text, strlen(sum_text));
+  if (error.error_code != 0) {
+    return error;
+  }
+  struct u7_vm0_runner runner;
+  error = u7_vm0_runner_init(&runner, workers_size);
+  if (error.error_code != 0) {
+    u7_vm0_program_destroy(&program);
+    return error;
+  }
+  static struct batch batch;
+  u7_error errors[TEST_STATES];
+  for (int round = 0; round < 2 && error.error_code == 0; ++round) {
+    error = batch_init(&batch, &program);
+    if (error.error_code == 0) {
+      u7_error* round_errors = (round == 0 ? errors : NULL);
+      u7_vm0_runner_run(&runner, batch.states, round_errors, batch.size,
+                        NULL);
+      error = batch_check(name, &batch, round_errors);
+    }
+    batch_destroy(&batch);
+  }
+  u7_vm0_runner_destroy(&runner);
+  u7_vm0_program_destroy(&program);
+  return error;
+}
+
+static u7_error test_single_worker() {
+  return check_batches("single_worker", 1);
+}
+
+static u7_error test_workers() {
+  return check_batches("workers", TEST_WORKERS);
+}
+
+// More workers than states: most of the workers have empty ranges.
+static u7_error test_idle_workers() {
+  return check_batches("idle_workers", 2 * TEST_STATES);
+}
+
+// An input of a single value that fails with EAGAIN on its first read.
+struct blocking_input {
+  struct u7_vm0_input base;
+  int64_t value;
+  size_t reads;
+};
+
+static u7_error blocking_read_i64(struct u7_vm0_input* input,
+                                  int64_t* result) {
+  struct blocking_input* self = (struct blocking_input*)input;
+  if (self->reads++ == 0) {
+    return u7_errnof(EAGAIN, "blocking_read_i64: would block");
+  }
+  *result = self->value;
+  return u7_ok();
+}
+
+// A blocked state is reported with EAGAIN, stays at its read, and finishes
+// in the next batch; the other states of the batch are not affected.
+static u7_error test_blocked() {
+  struct u7_vm0_program program;
+  u7_error error = u7_vm0_assemble(&program, sum_text, strlen(sum_text));
+  if (error.error_code != 0) {
+    return error;
+  }
+  int64_t const inputs[3] = {4, 0, 5};
+  int64_t outputs[3] = {-1, -1, -1};
+  struct u7_vm0_test_state test_states[3];
+  size_t test_states_size = 0;
+  while (test_states_size < 3 && error.error_code == 0) {
+    error = u7_vm0_test_state_init(&test_states[test_states_size], &program,
+                                   program.js, &inputs[test_states_size], 1,
+                                   &outputs[test_states_size], 1);
+    test_states_size += (error.error_code == 0 ? 1 : 0);
+  }
+  struct blocking_input blocking = {
+      .base = {.read_i64_fn = &blocking_read_i64},
+      .value = 10,
+  };
+  struct u7_vm0_runner runner;
+  if (error.error_code == 0) {
+    u7_vm0_state_globals(&test_states[1].state)->input = &blocking.base;
+    error = u7_vm0_runner_init(&runner, 2);
+  }
+  if (error.error_code == 0) {
+    struct u7_vm_state* const states[3] = {
+        &test_states[0].state, &test_states[1].state, &test_states[2].state};
+    u7_error errors[3];
+    u7_vm0_runner_run(&runner, states, errors, 3, NULL);
+    int const error_codes[3] = {0, EAGAIN, 0};
+    for (size_t i = 0; i < 3; ++i) {
+      u7_error state_error =
+          u7_vm0_test_expect_error("blocked", errors[i], error_codes[i]);
+      if (error.error_code == 0) {
+        error = state_error;
+      } else {
+        u7_error_release(state_error);
+      }
+    }
+    // The read is the first instruction of the program.
+    struct u7_vm0_globals const* globals =
+        u7_vm0_state_globals(&test_states[1].state);
+    if (error.error_code == 0 &&
+        (globals->blocked || test_states[1].state.ip != 0 ||
+         blocking.reads != 1 || outputs[1] != -1 || outputs[0] != 10 ||
+         outputs[2] != 15)) {
+      error = u7_errnof(EINVAL, "blocked: unexpected state after the batch");
+    }
+    if (error.error_code == 0) {
+      u7_vm0_runner_run(&runner, &states[1], errors, 1, NULL);
+      error = u7_vm0_test_expect_error("blocked: resumed", errors[0], 0);
+    }
+    if (error.error_code == 0 && (blocking.reads != 2 || outputs[1] != 55)) {
+      error = u7_errnof(EINVAL, "blocked: expected 55 after the resumption");
+    }
+    u7_vm0_runner_destroy(&runner);
+  }
+  for (size_t i = 0; i < test_states_size; ++i) {
+    u7_vm0_test_state_destroy(&test_states[i]);
+  }
+  u7_vm0_program_destroy(&program);
+  return error;
+}
+
+// The backends of a worker replace those of the states that it runs.
+static u7_error test_backends() {
+  struct u7_vm0_program program;
+  u7_error error = u7_vm0_assemble(&program, sum_text, strlen(sum_text));
+  if (error.error_code != 0) {
+    return error;
+  }
+  static struct batch batch;
+  error = batch_init(&batch, &program);
+  struct u7_vm0_runner runner;
+  if (error.error_code == 0) {
+    error = u7_vm0_runner_init(&runner, TEST_WORKERS);
+  }
+  if (error.error_code == 0) {
+    static int64_t outputs[TEST_WORKERS][TEST_STATES];
+    struct u7_vm0_memory_output memory_outputs[TEST_WORKERS];
+    struct u7_vm0_runner_backends backends[TEST_WORKERS];
+    for (size_t i = 0; i < TEST_WORKERS; ++i) {
+      u7_vm0_memory_output_init(&memory_outputs[i], outputs[i],
+                                sizeof(outputs[i]));
+      backends[i] = (struct u7_vm0_runner_backends){
+          .input = NULL, .output = &memory_outputs[i].base};
+    }
+    u7_vm0_runner_run(&runner, batch.states, NULL, batch.size, backends);
+    int64_t sum = 0;
+    int64_t expected_sum = 0;
+    size_t count = 0;
+    size_t expected_count = 0;
+    for (size_t i = 0; i < TEST_WORKERS; ++i) {
+      const size_t size =
+          u7_vm0_memory_output_size(&memory_outputs[i]) / sizeof(int64_t);
+      for (size_t j = 0; j < size; ++j) {
+        sum += outputs[i][j];
+      }
+      count += size;
+      u7_error_release(u7_vm0_memory_output_destroy(&memory_outputs[i]));
+    }
+    for (size_t i = 0; i < batch.size; ++i) {
+      if (batch_error_code(i) == 0) {
+        expected_sum += (int64_t)i * ((int64_t)i + 1) / 2;
+        expected_count += 1;
+      }
+      if (u7_vm0_test_state_output_size(&batch.test_states[i]) != 0) {
+        error = u7_errnof(EINVAL,
+                          "backends: state %zu: wrote to its own output", i);
+      }
+    }
+    if (error.error_code == 0 &&
+        (count != expected_count || sum != expected_sum)) {
+      error = u7_errnof(EINVAL,
+                        "backends: expected %zu values with the sum %" PRId64
+                        ", got %zu values with the sum %" PRId64,
+                        expected_count, expected_sum, count, sum);
+    }
+    u7_vm0_runner_destroy(&runner);
+  }
+  batch_destroy(&batch);
+  u7_vm0_program_destroy(&program);
+  return error;
+}
+
+static u7_error test_no_workers() {
+  struct u7_vm0_runner runner;
+  return u7_vm0_test_expect_error("no_workers",
+                                  u7_vm0_runner_init(&runner, 0), EINVAL);
+}
+
+int main() {
+  u7_error (*const tests[])() = {
+      &test_single_worker, &test_workers,  &test_idle_workers,
+      &test_blocked,       &test_backends, &test_no_workers,
+  };
+  return u7_vm0_test_main(tests, sizeof(tests) / sizeof(tests[0]));
+}
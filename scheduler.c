@@ -0,0 +1,109 @@
+#include "@/public/scheduler.h"
+
+#include <errno.h>
+#include <github.com/apronchenkov/error/public/error.h>
+#include <github.com/apronchenkov/vm/public/instruction.h>
+#include <github.com/apronchenkov/vm/public/state.h>
+#include <stdbool.h>
+
+u7_error u7_vm0_scheduler_init(struct u7_vm0_scheduler* self, size_t budget) {
+  if (budget == 0) {
+    return u7_errnof(EINVAL, "u7_vm0_scheduler_init: zero budget");
+  }
+  *self = (struct u7_vm0_scheduler){.budget = budget};
+  return u7_ok();
+}
+
+static void u7_vm0_scheduler_push(struct u7_vm0_scheduler* self,
+                                  struct u7_vm0_task* task) {
+  task->status = U7_VM0_TASK_RUNNABLE;
+  task->next = NULL;
+  if (self->tails[task->priority] == NULL) {
+    self->heads[task->priority] = task;
+  } else {
+    self->tails[task->priority]->next = task;
+  }
+  self->tails[task->priority] = task;
+}
+
+// Removes the first task of the highest priority; returns NULL if there is
+// no runnable task.
+static struct u7_vm0_task* u7_vm0_scheduler_pop(
+    struct u7_vm0_scheduler* self) {
+  for (int i = 0; i < U7_VM0_SCHEDULER_PRIORITIES; ++i) {
+    struct u7_vm0_task* task = self->heads[i];
+    if (task != NULL) {
+      self->heads[i] = task->next;
+      if (self->heads[i] == NULL) {
+        self->tails[i] = NULL;
+      }
+      task->next = NULL;
+      return task;
+    }
+  }
+  return NULL;
+}
+
+u7_error u7_vm0_scheduler_spawn(struct u7_vm0_scheduler* self,
+                                struct u7_vm0_task* task,
+                                struct u7_vm_state* state, int priority) {
+  if (priority < 0 || priority >= U7_VM0_SCHEDULER_PRIORITIES) {
+    return u7_errnof(EINVAL, "u7_vm0_scheduler_spawn: invalid priority: %d",
+                     priority);
+  }
+  *task = (struct u7_vm0_task){.state = state, .priority = priority};
+  u7_vm0_scheduler_push(self, task);
+  return u7_ok();
+}
+
+void u7_vm0_scheduler_wake(struct u7_vm0_scheduler* self,
+                           struct u7_vm0_task* task) {
+  if (task->status != U7_VM0_TASK_BLOCKED) {
+    return;
+  }
+  assert(self->blocked_size > 0);
+  self->blocked_size -= 1;
+  u7_vm0_scheduler_push(self, task);
+}
+
+// Counterpart of u7_vm_state_run() that executes at most `budget`
+// instructions. Returns true if the program has stopped by itself.
+static bool u7_vm0_scheduler_run_slice(struct u7_vm0_task* task,
+                                       size_t budget) {
+  struct u7_vm_state* state = task->state;
+  for (size_t i = 0; i < budget; ++i) {
+    struct u7_vm_instruction const* instruction =
+        state->instructions[state->ip++];
+    if (!instruction->execute_fn(state, instruction)) {
+      task->instructions += i + 1;
+      return true;
+    }
+  }
+  task->instructions += budget;
+  return false;
+}
+
+size_t u7_vm0_scheduler_run(struct u7_vm0_scheduler* self) {
+  struct u7_vm0_task* task;
+  while ((task = u7_vm0_scheduler_pop(self)) != NULL) {
+    struct u7_vm_state* state = task->state;
+    if (!u7_vm0_scheduler_run_slice(task, self->budget)) {
+      u7_vm0_scheduler_push(self, task);  // Preempted.
+      continue;
+    }
+    struct u7_vm0_globals* globals = u7_vm0_state_globals(state);
+    if (u7_vm0_state_failed(state)) {
+      task->status = U7_VM0_TASK_FINISHED;
+      task->error = u7_vm0_state_take_error(state);
+    } else if (globals->blocked) {
+      globals->blocked = false;
+      task->status = U7_VM0_TASK_BLOCKED;
+      self->blocked_size += 1;
+    } else if (state->ip == 0) {
+      task->status = U7_VM0_TASK_FINISHED;  // `ret`.
+    } else {
+      u7_vm0_scheduler_push(self, task);  // `yield`.
+    }
+  }
+  return self->blocked_size;
+}
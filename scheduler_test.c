@@ -0,0 +1,356 @@
+#include "@/public/scheduler.h"
+
+#include "@/public/assembler.h"
+#include "@/public/program.h"
+#include "@/testing.h"
+
+#include <errno.h>
+#include <github.com/apronchenkov/error/public/error.h>
+#include <github.com/apronchenkov/vm/public/state.h>
+#include <inttypes.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+// Tests for u7_vm0_scheduler_run(): the order in which the tasks write into
+// a shared output shows when they were preempted, yielded, blocked or
+// finished.
+
+enum { TEST_MAX_TASKS = 4, TEST_MAX_VALUES = 64 };
+
+// Reads an id and a count, and writes the id `count` times: 2 + 3 * count + 1
+// instructions.
+static const char writer_text[] =
+    "i64 id, n\n"
+    "read id\n"
+    "read n\n"
+    "loop: write id\n"
+    "n = n + -1\n"
+    "jnz n, loop\n"
+    "ret\n";
+
+// Same as writer_text, but yields after every write: 2 + 4 * count + 1
+// instructions.
+static const char yielding_writer_text[] =
+    "i64 id, n\n"
+    "read id\n"
+    "read n\n"
+    "loop: write id\n"
+    "yield\n"
+    "n = n + -1\n"
+    "jnz n, loop\n"
+    "ret\n";
+
+// Tasks of a program, each with its own input of an id and a count, that
+// write into a shared output.
+struct fixture {
+  struct u7_vm0_program program;
+  struct u7_vm0_scheduler scheduler;
+  struct u7_vm0_test_state test_states[TEST_MAX_TASKS];
+  struct u7_vm0_task tasks[TEST_MAX_TASKS];
+  int64_t inputs[TEST_MAX_TASKS][2];
+  size_t size;
+  struct u7_vm0_memory_output output;
+  int64_t values[TEST_MAX_VALUES];
+};
+
+static u7_error fixture_init(struct fixture* self, const char* text,
+                             size_t budget) {
+  self->size = 0;
+  u7_vm0_memory_output_init(&self->output, self->values,
+                            sizeof(self->values));
+  u7_error error = u7_vm0_assemble(&self->program, text, strlen(text));
+  if (error.error_code != 0) {
+    u7_error_release(u7_vm0_memory_output_destroy(&self->output));
+    return error;
+  }
+  error = u7_vm0_scheduler_init(&self->scheduler, budget);
+  if (error.error_code != 0) {
+    u7_vm0_program_destroy(&self->program);
+    u7_error_release(u7_vm0_memory_output_destroy(&self->output));
+  }
+  return error;
+}
+
+static void fixture_destroy(struct fixture* self) {
+  for (size_t i = 0; i < self->size; ++i) {
+    u7_error_release(self->tasks[i].error);
+    u7_vm0_test_state_destroy(&self->test_states[i]);
+  }
+  u7_vm0_program_destroy(&self->program);
+  u7_error_release(u7_vm0_memory_output_destroy(&self->output));
+}
+
+// Spawns a task that writes `id` `count` times.
+static u7_error fixture_spawn(struct fixture* self, int64_t id, int64_t count,
+                              int priority) {
+  const size_t i = self->size;
+  self->inputs[i][0] = id;
+  self->inputs[i][1] = count;
+  u7_error error = u7_vm0_test_state_init(&self->test_states[i],
+                                          &self->program, self->program.js,
+                                          self->inputs[i], 2, NULL, 0);
+  if (error.error_code != 0) {
+    return error;
+  }
+  struct u7_vm_state* state = &self->test_states[i].state;
+  u7_vm0_state_globals(state)->output = &self->output.base;
+  error = u7_vm0_scheduler_spawn(&self->scheduler, &self->tasks[i], state,
+                                 priority);
+  if (error.error_code != 0) {
+    u7_vm0_test_state_destroy(&self->test_states[i]);
+    return error;
+  }
+  self->size += 1;
+  return u7_ok();
+}
+
+// Checks that the shared output is `expected`, given as a string of ids.
+static u7_error fixture_expect_output(struct fixture* self, const char* name,
+                                      const char* expected) {
+  const size_t size =
+      u7_vm0_memory_output_size(&self->output) / sizeof(int64_t);
+  char actual[TEST_MAX_VALUES + 1];
+  for (size_t i = 0; i < size; ++i) {
+    actual[i] = (char)('0' + self->values[i]);
+  }
+  actual[size] = '\0';
+  if (strcmp(actual, expected) != 0) {
+    return u7_errnof(EINVAL, "%s: expected the output %s, got %s", name,
+                     expected, actual);
+  }
+  return u7_ok();
+}
+
+// Checks that every task has finished without an error, after executing
+// `instructions` instructions.
+static u7_error fixture_expect_finished(struct fixture* self,
+                                        const char* name,
+                                        uint64_t instructions) {
+  for (size_t i = 0; i < self->size; ++i) {
+    struct u7_vm0_task const* task = &self->tasks[i];
+    if (task->status != U7_VM0_TASK_FINISHED || task->error.error_code != 0 ||
+        task->instructions != instructions) {
+      return u7_errnof(EINVAL,
+                       "%s: task %zu: status %d, error %d, %" PRIu64
+                       " instructions; expected %" PRIu64,
+                       name, i, (int)task->status, task->error.error_code,
+                       task->instructions, instructions);
+    }
+  }
+  return u7_ok();
+}
+
+// Two tasks of the same priority, with `budget` instructions per slice.
+static u7_error check_budget(const char* name, size_t budget,
+                             const char* expected) {
+  static struct fixture fixture;
+  u7_error error = fixture_init(&fixture, writer_text, budget);
+  if (error.error_code != 0) {
+    return error;
+  }
+  error = fixture_spawn(&fixture, 1, 5, 1);
+  if (error.error_code == 0) {
+    error = fixture_spawn(&fixture, 2, 5, 1);
+  }
+  if (error.error_code == 0 && u7_vm0_scheduler_run(&fixture.scheduler) != 0) {
+    error = u7_errnof(EINVAL, "%s: blocked tasks", name);
+  }
+  if (error.error_code == 0) {
+    error = fixture_expect_output(&fixture, name, expected);
+  }
+  if (error.error_code == 0) {
+    error = fixture_expect_finished(&fixture, name, 2 + 3 * 5 + 1);
+  }
+  fixture_destroy(&fixture);
+  return error;
+}
+
+// A task that does not yield runs to its end within a large budget.
+static u7_error test_large_budget() {
+  return check_budget("large_budget", 1000, "1111122222");
+}
+
+// Once a task exhausts its budget, the other task runs: of the 18
+// instructions of a task, the slices of 7 instructions execute 2, 2 and 1
+// writes.
+static u7_error test_budget_exhaustion() {
+  return check_budget("budget_exhaustion", 7, "1122112212");
+}
+
+// Every slice executes a single instruction.
+static u7_error test_unit_budget() {
+  return check_budget("unit_budget", 1, "1212121212");
+}
+
+// The tasks of the same priority take turns at every `yield`; a task of a
+// higher priority runs first, however late it is spawned.
+static u7_error test_priorities() {
+  static struct fixture fixture;
+  u7_error error = fixture_init(&fixture, yielding_writer_text, 1000);
+  if (error.error_code != 0) {
+    return error;
+  }
+  error = fixture_spawn(&fixture, 3, 2, 3);
+  if (error.error_code == 0) {
+    error = fixture_spawn(&fixture, 1, 3, 2);
+  }
+  if (error.error_code == 0) {
+    error = fixture_spawn(&fixture, 2, 3, 2);
+  }
+  if (error.error_code == 0) {
+    error = fixture_spawn(&fixture, 0, 2, 0);
+  }
+  if (error.error_code == 0) {
+    u7_vm0_scheduler_run(&fixture.scheduler);
+    error = fixture_expect_output(&fixture, "priorities", "0012121233");
+  }
+  fixture_destroy(&fixture);
+  return error;
+}
+
+static u7_error test_invalid_arguments() {
+  struct u7_vm0_scheduler scheduler;
+  u7_error error = u7_vm0_test_expect_error(
+      "invalid_arguments: budget", u7_vm0_scheduler_init(&scheduler, 0),
+      EINVAL);
+  if (error.error_code != 0) {
+    return error;
+  }
+  error = u7_vm0_scheduler_init(&scheduler, 1);
+  if (error.error_code != 0) {
+    return error;
+  }
+  struct u7_vm0_task task;
+  error = u7_vm0_test_expect_error(
+      "invalid_arguments: priority",
+      u7_vm0_scheduler_spawn(&scheduler, &task, NULL,
+                             U7_VM0_SCHEDULER_PRIORITIES),
+      EINVAL);
+  if (error.error_code != 0) {
+    return error;
+  }
+  return u7_vm0_test_expect_error(
+      "invalid_arguments: negative priority",
+      u7_vm0_scheduler_spawn(&scheduler, &task, NULL, -1), EINVAL);
+}
+
+// An input that fails with EAGAIN until it is released.
+struct gated_input {
+  struct u7_vm0_input base;
+  bool open;
+  int64_t values[2];
+  size_t cursor;
+};
+
+static u7_error gated_read_i64(struct u7_vm0_input* input, int64_t* result) {
+  struct gated_input* self = (struct gated_input*)input;
+  if (!self->open) {
+    return u7_errnof(EAGAIN, "gated_read_i64: would block");
+  }
+  if (self->cursor == 2) {
+    return u7_errnof(ENODATA, "gated_read_i64: eof");
+  }
+  *result = self->values[self->cursor++];
+  return u7_ok();
+}
+
+// A blocked task waits without holding back the others, and resumes at its
+// read once woken.
+static u7_error test_blocked() {
+  static struct fixture fixture;
+  u7_error error = fixture_init(&fixture, writer_text, 1000);
+  if (error.error_code != 0) {
+    return error;
+  }
+  struct gated_input gated = {
+      .base = {.read_i64_fn = &gated_read_i64},
+      .values = {1, 2},
+  };
+  error = fixture_spawn(&fixture, 1, 2, 0);
+  if (error.error_code == 0) {
+    error = fixture_spawn(&fixture, 2, 2, 1);
+  }
+  if (error.error_code == 0) {
+    u7_vm0_state_globals(&fixture.test_states[0].state)->input = &gated.base;
+    const size_t blocked = u7_vm0_scheduler_run(&fixture.scheduler);
+    if (blocked != 1 || fixture.tasks[0].status != U7_VM0_TASK_BLOCKED ||
+        fixture.tasks[1].status != U7_VM0_TASK_FINISHED) {
+      error = u7_errnof(EINVAL, "blocked: %zu blocked tasks", blocked);
+    }
+  }
+  if (error.error_code == 0) {
+    error = fixture_expect_output(&fixture, "blocked: first run", "22");
+  }
+  if (error.error_code == 0) {
+    gated.open = true;
+    u7_vm0_scheduler_wake(&fixture.scheduler, &fixture.tasks[0]);
+    // Waking a task that is not blocked has no effect.
+    u7_vm0_scheduler_wake(&fixture.scheduler, &fixture.tasks[1]);
+    const size_t blocked = u7_vm0_scheduler_run(&fixture.scheduler);
+    if (blocked != 0) {
+      error = u7_errnof(EINVAL, "blocked: %zu blocked tasks after the wake",
+                        blocked);
+    }
+  }
+  if (error.error_code == 0) {
+    error = fixture_expect_output(&fixture, "blocked: second run", "2211");
+  }
+  // The blocked read has been executed twice.
+  if (error.error_code == 0 &&
+      fixture.tasks[0].instructions != 2 + 3 * 2 + 1 + 1) {
+    error = u7_errnof(EINVAL, "blocked: %" PRIu64 " instructions",
+                      fixture.tasks[0].instructions);
+  }
+  fixture_destroy(&fixture);
+  return error;
+}
+
+// A failed task finishes with its error; the other tasks are not affected.
+static u7_error test_failure() {
+  static struct fixture fixture;
+  u7_error error = fixture_init(&fixture, writer_text, 2);
+  if (error.error_code != 0) {
+    return error;
+  }
+  // A count of 0 wraps around and writes until the output is full, and
+  // fails with ENOSPC.
+  error = fixture_spawn(&fixture, 1, 0, 0);
+  if (error.error_code == 0) {
+    error = fixture_spawn(&fixture, 2, 3, 0);
+  }
+  if (error.error_code == 0) {
+    u7_vm0_scheduler_run(&fixture.scheduler);
+    struct u7_vm0_task const* failed = &fixture.tasks[0];
+    if (failed->status != U7_VM0_TASK_FINISHED ||
+        failed->error.error_code != ENOSPC ||
+        fixture.tasks[1].status != U7_VM0_TASK_FINISHED ||
+        fixture.tasks[1].error.error_code != 0) {
+      error = u7_errnof(EINVAL, "failure: unexpected status of the tasks");
+    }
+  }
+  if (error.error_code == 0) {
+    size_t twos = 0;
+    const size_t size =
+        u7_vm0_memory_output_size(&fixture.output) / sizeof(int64_t);
+    for (size_t i = 0; i < size; ++i) {
+      twos += (fixture.values[i] == 2 ? 1 : 0);
+    }
+    if (size != TEST_MAX_VALUES || twos != 3) {
+      error = u7_errnof(EINVAL, "failure: %zu values, %zu of the second task",
+                        size, twos);
+    }
+  }
+  fixture_destroy(&fixture);
+  return error;
+}
+
+int main() {
+  u7_error (*const tests[])() = {
+      &test_large_budget, &test_budget_exhaustion, &test_unit_budget,
+      &test_priorities,   &test_invalid_arguments, &test_blocked,
+      &test_failure,
+  };
+  return u7_vm0_test_main(tests, sizeof(tests) / sizeof(tests[0]));
+}
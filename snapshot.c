@@ -0,0 +1,191 @@
+#include "@/public/snapshot.h"
+
+#include <errno.h>
+#include <github.com/apronchenkov/error/public/error.h>
+#include <github.com/apronchenkov/vm/public/state.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+static const char u7_vm0_snapshot_magic[8] = {'U', '7', 'V', 'M',
+                                              '0', 'S', 'N', 'P'};
+
+enum {
+  U7_VM0_SNAPSHOT_HEADER_SIZE = 56,
+  U7_VM0_SNAPSHOT_FLAG_BLOCKED = 1,
+};
+
+static void u7_vm0_snapshot_store_le32(char* p, uint32_t value) {
+  if (__BYTE_ORDER__ == __ORDER_BIG_ENDIAN__) {
+    value = __builtin_bswap32(value);
+  }
+  memcpy(p, &value, sizeof(value));
+}
+
+static void u7_vm0_snapshot_store_le64(char* p, uint64_t value) {
+  if (__BYTE_ORDER__ == __ORDER_BIG_ENDIAN__) {
+    value = __builtin_bswap64(value);
+  }
+  memcpy(p, &value, sizeof(value));
+}
+
+static uint32_t u7_vm0_snapshot_load_le32(char const* p) {
+  uint32_t value;
+  memcpy(&value, p, sizeof(value));
+  if (__BYTE_ORDER__ == __ORDER_BIG_ENDIAN__) {
+    value = __builtin_bswap32(value);
+  }
+  return value;
+}
+
+static uint64_t u7_vm0_snapshot_load_le64(char const* p) {
+  uint64_t value;
+  memcpy(&value, p, sizeof(value));
+  if (__BYTE_ORDER__ == __ORDER_BIG_ENDIAN__) {
+    value = __builtin_bswap64(value);
+  }
+  return value;
+}
+
+static size_t u7_vm0_snapshot_align8(size_t size) {
+  return (size + 7) & ~(size_t)7;
+}
+
+// Returns the size of the locals frame, or an error if there are values
+// or frames of calls above it.
+static u7_error u7_vm0_snapshot_locals_size(const char* function,
+                                            struct u7_vm_state* state,
+                                            size_t* result) {
+  if (u7_vm0_state_globals(state)->call_depth != 0) {
+    return u7_errnof(EINVAL, "%s: the program is inside a call", function);
+  }
+  const size_t locals_size =
+      u7_vm_stack_current_frame_layout(&state->stack)->locals_size;
+  if (state->stack.top_offset != state->stack.base_offset +
+                                     U7_VM_STACK_FRAME_HEADER_SIZE +
+                                     locals_size) {
+    return u7_errnof(EINVAL, "%s: the stack has values above the locals",
+                     function);
+  }
+  *result = locals_size;
+  return u7_ok();
+}
+
+u7_error u7_vm0_snapshot_save(struct u7_vm_state* state, void** data,
+                              size_t* size) {
+  size_t locals_size = 0;
+  u7_error error =
+      u7_vm0_snapshot_locals_size("u7_vm0_snapshot_save", state, &locals_size);
+  if (error.error_code != 0) {
+    return error;
+  }
+  struct u7_vm0_globals* globals = u7_vm0_state_globals(state);
+  // A fault is saved by its message, as it refers to the execute functions
+  // of this process.
+  u7_error failure = u7_ok();
+  if (globals->fault.error_code != 0) {
+    failure = u7_vm0_fault_error(&globals->fault);
+  }
+  u7_error const* pending =
+      (globals->fault.error_code != 0 ? &failure : &globals->error);
+  const char* message =
+      (pending->error_code != 0 && pending->message != NULL ? pending->message
+                                                            : "");
+  size_t message_size = strlen(message);
+  if (message_size > U7_VM0_SNAPSHOT_MAX_MESSAGE_SIZE) {
+    message_size = U7_VM0_SNAPSHOT_MAX_MESSAGE_SIZE;
+  }
+  const size_t locals_offset =
+      u7_vm0_snapshot_align8(U7_VM0_SNAPSHOT_HEADER_SIZE + message_size);
+  const size_t result_size = locals_offset + locals_size;
+  char* buffer = calloc(1, result_size);
+  if (buffer == NULL) {
+    u7_error_clear(&failure);
+    return u7_errnof(ENOMEM, "u7_vm0_snapshot_save: out of memory");
+  }
+  memcpy(buffer, u7_vm0_snapshot_magic, sizeof(u7_vm0_snapshot_magic));
+  u7_vm0_snapshot_store_le32(buffer + 8, U7_VM0_SNAPSHOT_VERSION);
+  u7_vm0_snapshot_store_le32(
+      buffer + 12, (globals->blocked ? U7_VM0_SNAPSHOT_FLAG_BLOCKED : 0));
+  u7_vm0_snapshot_store_le64(buffer + 16, state->instructions_size);
+  u7_vm0_snapshot_store_le64(buffer + 24, state->ip);
+  u7_vm0_snapshot_store_le64(buffer + 32, locals_size);
+  u7_vm0_snapshot_store_le64(buffer + 40, globals->io_done);
+  u7_vm0_snapshot_store_le32(buffer + 48, (uint32_t)pending->error_code);
+  u7_vm0_snapshot_store_le32(buffer + 52, (uint32_t)message_size);
+  memcpy(buffer + U7_VM0_SNAPSHOT_HEADER_SIZE, message, message_size);
+  memcpy(buffer + locals_offset, u7_vm_state_locals(state), locals_size);
+  u7_error_clear(&failure);
+  *data = buffer;
+  *size = result_size;
+  return u7_ok();
+}
+
+u7_error u7_vm0_snapshot_restore(struct u7_vm_state* state, void const* data,
+                                 size_t size) {
+  char const* const buffer = data;
+  if (size < U7_VM0_SNAPSHOT_HEADER_SIZE ||
+      memcmp(buffer, u7_vm0_snapshot_magic, sizeof(u7_vm0_snapshot_magic)) !=
+          0) {
+    return u7_errnof(EINVAL, "u7_vm0_snapshot_restore: not a snapshot");
+  }
+  const uint32_t version = u7_vm0_snapshot_load_le32(buffer + 8);
+  if (version != U7_VM0_SNAPSHOT_VERSION) {
+    return u7_errnof(EINVAL,
+                     "u7_vm0_snapshot_restore: unsupported version: %u",
+                     (unsigned)version);
+  }
+  const uint32_t flags = u7_vm0_snapshot_load_le32(buffer + 12);
+  const uint64_t instructions_size = u7_vm0_snapshot_load_le64(buffer + 16);
+  const uint64_t ip = u7_vm0_snapshot_load_le64(buffer + 24);
+  const uint64_t saved_locals_size = u7_vm0_snapshot_load_le64(buffer + 32);
+  const uint64_t io_done = u7_vm0_snapshot_load_le64(buffer + 40);
+  const int error_code = (int32_t)u7_vm0_snapshot_load_le32(buffer + 48);
+  const uint32_t message_size = u7_vm0_snapshot_load_le32(buffer + 52);
+  if (instructions_size != state->instructions_size) {
+    return u7_errnof(EINVAL,
+                     "u7_vm0_snapshot_restore: instructions_size mismatch: "
+                     "%zu != %zu",
+                     (size_t)instructions_size, state->instructions_size);
+  }
+  if (ip >= instructions_size) {
+    return u7_errnof(EINVAL, "u7_vm0_snapshot_restore: ip is out of range");
+  }
+  if (io_done != 0 && (flags & U7_VM0_SNAPSHOT_FLAG_BLOCKED) == 0) {
+    return u7_errnof(EINVAL,
+                     "u7_vm0_snapshot_restore: io_done without blocked flag");
+  }
+  if (message_size > U7_VM0_SNAPSHOT_MAX_MESSAGE_SIZE) {
+    return u7_errnof(EINVAL,
+                     "u7_vm0_snapshot_restore: message is too long: %u",
+                     (unsigned)message_size);
+  }
+  size_t locals_size = 0;
+  u7_error error = u7_vm0_snapshot_locals_size("u7_vm0_snapshot_restore",
+                                               state, &locals_size);
+  if (error.error_code != 0) {
+    return error;
+  }
+  if (saved_locals_size != locals_size) {
+    return u7_errnof(EINVAL,
+                     "u7_vm0_snapshot_restore: locals_size mismatch: "
+                     "%zu != %zu",
+                     (size_t)saved_locals_size, locals_size);
+  }
+  const size_t locals_offset =
+      u7_vm0_snapshot_align8(U7_VM0_SNAPSHOT_HEADER_SIZE + message_size);
+  if (locals_offset > size || size - locals_offset != locals_size) {
+    return u7_errnof(EINVAL, "u7_vm0_snapshot_restore: truncated snapshot");
+  }
+  u7_vm0_state_clear_error(state);
+  struct u7_vm0_globals* globals = u7_vm0_state_globals(state);
+  if (error_code != 0) {
+    globals->error = u7_errnof(error_code, "%.*s", (int)message_size,
+                               buffer + U7_VM0_SNAPSHOT_HEADER_SIZE);
+  }
+  globals->blocked = ((flags & U7_VM0_SNAPSHOT_FLAG_BLOCKED) != 0);
+  globals->io_done = (size_t)io_done;
+  state->ip = (size_t)ip;
+  memcpy(u7_vm_state_locals(state), buffer + locals_offset, locals_size);
+  return u7_ok();
+}
@@ -0,0 +1,379 @@
+#include "@/public/snapshot.h"
+
+#include "@/public/assembler.h"
+#include "@/public/program.h"
+#include "@/public/vm0.h"
+#include "@/testing.h"
+
+#include <errno.h>
+#include <github.com/apronchenkov/error/public/error.h>
+#include <github.com/apronchenkov/vm/public/state.h>
+#include <inttypes.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Tests for u7_vm0_snapshot_save() and u7_vm0_snapshot_restore(): a restored
+// state continues exactly where the saved one stopped, and a snapshot that
+// does not fit the state is rejected without modifying it.
+
+// Writes 1 + 2 + ... + n, yielding on every iteration.
+static const char sum_text[] =
+    "i64 n, i, s\n"
+    "read n\n"
+    "i = 0\n"
+    "s = 0\n"
+    "loop: i = i + 1\n"
+    "s = s + i\n"
+    "yield\n"
+    "if i < n goto loop\n"
+    "write s\n"
+    "ret\n";
+
+// The same instructions with a larger locals frame.
+static const char wide_sum_text[] =
+    "i64 n, i, s, t[8]\n"
+    "read n\n"
+    "i = 0\n"
+    "s = 0\n"
+    "loop: i = i + 1\n"
+    "s = s + i\n"
+    "yield\n"
+    "if i < n goto loop\n"
+    "write s\n"
+    "ret\n";
+
+static const char short_text[] =
+    "i64 n, i, s\n"
+    "write 1\n"
+    "ret\n";
+
+// Two states of the sum program, both with the input 10.
+struct fixture {
+  struct u7_vm0_program program;
+  int64_t input;
+  int64_t outputs[2];
+  struct u7_vm0_test_state test_states[2];
+};
+
+static u7_error fixture_init(struct fixture* self, const char* text) {
+  u7_error error = u7_vm0_assemble(&self->program, text, strlen(text));
+  if (error.error_code != 0) {
+    return error;
+  }
+  self->input = 10;
+  for (int i = 0; i < 2; ++i) {
+    error = u7_vm0_test_state_init(&self->test_states[i], &self->program,
+                                   self->program.js, &self->input, 1,
+                                   &self->outputs[i], 1);
+    if (error.error_code != 0) {
+      if (i == 1) {
+        u7_vm0_test_state_destroy(&self->test_states[0]);
+      }
+      u7_vm0_program_destroy(&self->program);
+      return error;
+    }
+  }
+  return u7_ok();
+}
+
+static void fixture_destroy(struct fixture* self) {
+  u7_vm0_test_state_destroy(&self->test_states[1]);
+  u7_vm0_test_state_destroy(&self->test_states[0]);
+  u7_vm0_program_destroy(&self->program);
+}
+
+static uint32_t load_le32(char const* p) {
+  uint32_t value = 0;
+  for (int i = 0; i < 4; ++i) {
+    value |= (uint32_t)(unsigned char)p[i] << (8 * i);
+  }
+  return value;
+}
+
+static void store_le32(char* p, uint32_t value) {
+  for (int i = 0; i < 4; ++i) {
+    p[i] = (char)(value >> (8 * i));
+  }
+}
+
+// Runs the state `yields` times, and saves it.
+static u7_error run_and_save(struct u7_vm_state* state, int yields,
+                             void** data, size_t* size) {
+  for (int i = 0; i < yields; ++i) {
+    u7_vm_state_run(state);
+  }
+  return u7_vm0_snapshot_save(state, data, size);
+}
+
+// Resumes the state until `ret`, and checks that it writes 55.
+static u7_error expect_sum(const char* name, struct fixture* self, int i) {
+  struct u7_vm_state* state = &self->test_states[i].state;
+  do {
+    u7_vm_state_run(state);
+  } while (state->ip != 0 && !u7_vm0_state_failed(state));
+  u7_error error = u7_vm0_state_take_error(state);
+  if (error.error_code != 0) {
+    return error;
+  }
+  if (u7_vm0_test_state_output_size(&self->test_states[i]) != 1 ||
+      self->outputs[i] != 55) {
+    return u7_errnof(EINVAL, "%s: expected 55 written", name);
+  }
+  return u7_ok();
+}
+
+// A state restored from a snapshot taken after three iterations writes the
+// same sum as the original one; the input is not saved, so the restored
+// state does not read it.
+static u7_error test_round_trip() {
+  static struct fixture fixture;
+  u7_error error = fixture_init(&fixture, sum_text);
+  if (error.error_code != 0) {
+    return error;
+  }
+  void* data = NULL;
+  size_t size = 0;
+  error = run_and_save(&fixture.test_states[0].state, 3, &data, &size);
+  if (error.error_code == 0) {
+    error = u7_vm0_snapshot_restore(&fixture.test_states[1].state, data, size);
+  }
+  if (error.error_code == 0 &&
+      fixture.test_states[1].state.ip != fixture.test_states[0].state.ip) {
+    error = u7_errnof(EINVAL, "round_trip: ip is not restored");
+  }
+  if (error.error_code == 0) {
+    error = expect_sum("round_trip: original", &fixture, 0);
+  }
+  if (error.error_code == 0) {
+    error = expect_sum("round_trip: restored", &fixture, 1);
+  }
+  free(data);
+  fixture_destroy(&fixture);
+  return error;
+}
+
+// Restores the snapshot into a state of the other program, which must fail
+// with EINVAL and leave the state as it was.
+static u7_error expect_mismatch(const char* name, const char* text,
+                                void const* data, size_t size) {
+  static struct fixture fixture;
+  u7_error error = fixture_init(&fixture, text);
+  if (error.error_code != 0) {
+    return error;
+  }
+  struct u7_vm_state* state = &fixture.test_states[0].state;
+  u7_vm_state_run(state);
+  const size_t ip = state->ip;
+  const size_t locals_size = fixture.program.locals_frame_layout.locals_size;
+  char locals[128];
+  memcpy(locals, u7_vm_state_locals(state), locals_size);
+  error = u7_vm0_test_expect_error(
+      name, u7_vm0_snapshot_restore(state, data, size), EINVAL);
+  if (error.error_code == 0 &&
+      (state->ip != ip || u7_vm0_state_failed(state) ||
+       memcmp(locals, u7_vm_state_locals(state), locals_size) != 0)) {
+    error = u7_errnof(EINVAL, "%s: the state is modified", name);
+  }
+  fixture_destroy(&fixture);
+  return error;
+}
+
+static u7_error test_mismatched_program() {
+  static struct fixture fixture;
+  u7_error error = fixture_init(&fixture, sum_text);
+  if (error.error_code != 0) {
+    return error;
+  }
+  void* data = NULL;
+  size_t size = 0;
+  error = run_and_save(&fixture.test_states[0].state, 2, &data, &size);
+  fixture_destroy(&fixture);
+  if (error.error_code != 0) {
+    return error;
+  }
+  error = expect_mismatch("mismatched_program: instructions", short_text,
+                          data, size);
+  if (error.error_code == 0) {
+    error = expect_mismatch("mismatched_program: locals", wide_sum_text, data,
+                            size);
+  }
+  free(data);
+  return error;
+}
+
+// Every proper prefix, a wrong magic or version, an ip out of range, io_done
+// without the blocked flag, and a message over the limit are rejected.
+static u7_error test_corrupt() {
+  static struct fixture fixture;
+  u7_error error = fixture_init(&fixture, sum_text);
+  if (error.error_code != 0) {
+    return error;
+  }
+  char* data = NULL;
+  size_t size = 0;
+  error = run_and_save(&fixture.test_states[0].state, 1, (void**)&data, &size);
+  if (error.error_code == 0 && size > 256) {
+    error = u7_errnof(EINVAL, "corrupt: the snapshot is too large");
+  }
+  struct u7_vm_state* state = &fixture.test_states[1].state;
+  for (size_t prefix = 0; prefix < size && error.error_code == 0; ++prefix) {
+    char name[64];
+    snprintf(name, sizeof(name), "corrupt: %zu of %zu bytes", prefix, size);
+    error = u7_vm0_test_expect_error(
+        name, u7_vm0_snapshot_restore(state, data, prefix), EINVAL);
+  }
+  struct {
+    const char* name;
+    size_t offset;
+    uint32_t value;
+  } const cases[] = {
+      {"corrupt: magic", 0, 0x30304D56},
+      {"corrupt: version", 8, U7_VM0_SNAPSHOT_VERSION + 1},
+      {"corrupt: ip", 24, 1000},
+      {"corrupt: io_done without blocked", 40, 2},
+      {"corrupt: message size", 52, U7_VM0_SNAPSHOT_MAX_MESSAGE_SIZE + 1},
+  };
+  for (size_t i = 0;
+       i < sizeof(cases) / sizeof(cases[0]) && error.error_code == 0; ++i) {
+    char copy[256];
+    memcpy(copy, data, size);
+    store_le32(copy + cases[i].offset, cases[i].value);
+    error = u7_vm0_test_expect_error(
+        cases[i].name, u7_vm0_snapshot_restore(state, copy, size), EINVAL);
+  }
+  if (error.error_code == 0 && state->ip != 0) {
+    error = u7_errnof(EINVAL, "corrupt: the state is modified");
+  }
+  free(data);
+  fixture_destroy(&fixture);
+  return error;
+}
+
+// The pending failure is restored as an error, with the message of the
+// fault; a message over the limit is truncated.
+static u7_error test_failure() {
+  static struct fixture fixture;
+  u7_error error = fixture_init(&fixture, sum_text);
+  if (error.error_code != 0) {
+    return error;
+  }
+  struct u7_vm_state* state = &fixture.test_states[0].state;
+  char message[U7_VM0_SNAPSHOT_MAX_MESSAGE_SIZE + 100];
+  memset(message, 'x', sizeof(message) - 1);
+  message[sizeof(message) - 1] = '\0';
+  u7_vm_state_run(state);
+  u7_vm0_state_globals(state)->error = u7_errnof(ENOSPC, "%s", message);
+  size_t message_size = strlen(u7_vm0_state_globals(state)->error.message);
+  if (message_size > U7_VM0_SNAPSHOT_MAX_MESSAGE_SIZE) {
+    message_size = U7_VM0_SNAPSHOT_MAX_MESSAGE_SIZE;
+  }
+  void* data = NULL;
+  size_t size = 0;
+  error = u7_vm0_snapshot_save(state, &data, &size);
+  u7_vm0_state_clear_error(state);
+  struct u7_vm_state* restored = &fixture.test_states[1].state;
+  if (error.error_code == 0) {
+    error = u7_vm0_snapshot_restore(restored, data, size);
+  }
+  if (error.error_code == 0 &&
+      load_le32((char const*)data + 52) != message_size) {
+    error = u7_errnof(EINVAL, "failure: the message is not truncated");
+  }
+  if (error.error_code == 0) {
+    u7_error failure = u7_vm0_state_take_error(restored);
+    if (failure.error_code != ENOSPC || failure.message == NULL ||
+        strncmp(failure.message, "xxxx", 4) != 0) {
+      error = u7_errnof(EINVAL, "failure: the error is not restored");
+    }
+    u7_error_release(failure);
+  }
+  free(data);
+  fixture_destroy(&fixture);
+  return error;
+}
+
+// The blocked flag and io_done are saved and restored.
+static u7_error test_blocked() {
+  static struct fixture fixture;
+  u7_error error = fixture_init(&fixture, sum_text);
+  if (error.error_code != 0) {
+    return error;
+  }
+  struct u7_vm_state* state = &fixture.test_states[0].state;
+  u7_vm_state_run(state);
+  u7_vm0_state_globals(state)->blocked = true;
+  u7_vm0_state_globals(state)->io_done = 2;
+  void* data = NULL;
+  size_t size = 0;
+  error = u7_vm0_snapshot_save(state, &data, &size);
+  struct u7_vm_state* restored = &fixture.test_states[1].state;
+  if (error.error_code == 0) {
+    error = u7_vm0_snapshot_restore(restored, data, size);
+  }
+  struct u7_vm0_globals const* globals = u7_vm0_state_globals(restored);
+  if (error.error_code == 0 && (!globals->blocked || globals->io_done != 2)) {
+    error = u7_errnof(EINVAL, "blocked: blocked=%d, io_done=%zu",
+                      (int)globals->blocked, globals->io_done);
+  }
+  free(data);
+  fixture_destroy(&fixture);
+  return error;
+}
+
+static struct u7_vm0_arg i64_variable(int64_t index) {
+  return (struct u7_vm0_arg){.kind = U7_VM0_ARG_KIND_I64_VARIABLE,
+                             .value.i64 = index * (int64_t)sizeof(int64_t)};
+}
+
+// A state that has yielded inside a call is not saved.
+static u7_error test_inside_call() {
+  static const struct u7_vm_stack_frame_layout frame_layout = {
+      .locals_size = sizeof(int64_t),
+      .description = "snapshot_test",
+  };
+  const struct u7_vm0_arg label = {.kind = U7_VM0_ARG_KIND_I64_LABEL,
+                                   .value.i64 = 2};
+  u7_error error = u7_ok();
+  const struct u7_vm0_instruction instructions[] = {
+      u7_vm0_call(&error, label, &frame_layout, i64_variable(0), 1),
+      u7_vm0_ret(),
+      u7_vm0_yield(),
+      u7_vm0_ret(),
+  };
+  if (error.error_code != 0) {
+    return error;
+  }
+  struct u7_vm0_program program;
+  error = u7_vm0_test_program_init(
+      &program, instructions, sizeof(instructions) / sizeof(instructions[0]),
+      &frame_layout);
+  if (error.error_code != 0) {
+    return error;
+  }
+  struct u7_vm0_test_state test_state;
+  error =
+      u7_vm0_test_state_init(&test_state, &program, program.js, NULL, 0,
+                             NULL, 0);
+  if (error.error_code == 0) {
+    u7_vm_state_run(&test_state.state);
+    void* data = NULL;
+    size_t size = 0;
+    error = u7_vm0_test_expect_error(
+        "inside_call", u7_vm0_snapshot_save(&test_state.state, &data, &size),
+        EINVAL);
+    u7_vm0_test_state_destroy(&test_state);
+  }
+  u7_vm0_program_destroy(&program);
+  return error;
+}
+
+int main() {
+  u7_error (*const tests[])() = {
+      &test_round_trip, &test_mismatched_program, &test_corrupt,
+      &test_failure,    &test_blocked,            &test_inside_call,
+  };
+  return u7_vm0_test_main(tests, sizeof(tests) / sizeof(tests[0]));
+}
@@ -1,5 +1,8 @@
 #include "@/public/vm0.h"
 
+#include "@/public/fuse.h"
+#include "@/public/verify.h"
+
 #include <errno.h>
 #include <github.com/apronchenkov/error/public/error.h>
 #include <github.com/apronchenkov/vm/public/state.h>
@@ -237,9 +240,22 @@ u7_error Main() {
     return error;
   }
 
-  const size_t isn = sizeof(is) / sizeof(is[0]);
+  static struct u7_vm_stack_frame_layout local_frame_layout = {
+      .locals_size = sizeof(struct locals),
+      .description = "locals",
+  };
+  size_t isn = sizeof(is) / sizeof(is[0]);
+  error = u7_vm0_verify(is, isn, &local_frame_layout);
+  if (error.error_code != 0) {
+    return error;
+  }
+  error = u7_vm0_fuse(is, &isn);
+  if (error.error_code != 0) {
+    return error;
+  }
+
   struct u7_vm_instruction const* js[sizeof(is) / sizeof(is[0])];
-  for (size_t i = 0; i < sizeof(is) / sizeof(is[0]); ++i) {
+  for (size_t i = 0; i < isn; ++i) {
     js[i] = &is[i].base;
   }
 
@@ -249,10 +265,6 @@ u7_error Main() {
     return error;
   }
 
-  static struct u7_vm_stack_frame_layout local_frame_layout = {
-      .locals_size = sizeof(struct locals),
-      .description = "locals",
-  };
   error = u7_vm_stack_push_frame(&state.stack, &local_frame_layout);
   if (error.error_code != 0) {
     return error;
@@ -263,7 +275,7 @@ u7_error Main() {
 
   while (error.error_code == 0) {
     u7_vm_state_run(&state);
-    error = u7_error_move(&u7_vm0_state_globals(&state)->error);
+    error = u7_vm0_state_take_error(&state);
   }
   u7_vm_state_destroy(&state);
   return error;
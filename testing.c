@@ -0,0 +1,198 @@
+#include "@/testing.h"
+
+#include "@/public/verify.h"
+#include "@/public/vm0.h"
+
+#include <errno.h>
+#include <github.com/apronchenkov/error/public/error.h>
+#include <github.com/apronchenkov/vm/public/state.h>
+#include <github.com/apronchenkov/yalog/public/basic.h>
+#include <github.com/apronchenkov/yalog/public/logging_printf.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+u7_error u7_vm0_test_program_init(
+    struct u7_vm0_program* self,
+    struct u7_vm0_instruction const* instructions, size_t instructions_size,
+    struct u7_vm_stack_frame_layout const* locals_frame_layout) {
+  const size_t n = instructions_size;
+  char* memory = malloc(n * (sizeof(struct u7_vm0_instruction) +
+                             sizeof(struct u7_vm_instruction const*)));
+  if (memory == NULL) {
+    return u7_errnof(ENOMEM, "u7_vm0_test_program_init: out of memory");
+  }
+  self->memory = memory;
+  self->instructions = (struct u7_vm0_instruction*)memory;
+  self->js = (struct u7_vm_instruction const**)(
+      memory + n * sizeof(struct u7_vm0_instruction));
+  self->instructions_size = n;
+  self->locals_frame_layout = *locals_frame_layout;
+  memcpy(self->instructions, instructions,
+         n * sizeof(struct u7_vm0_instruction));
+  for (size_t i = 0; i < n; ++i) {
+    self->js[i] = &self->instructions[i].base;
+  }
+  u7_error error = u7_vm0_verify(self->instructions, n, locals_frame_layout);
+  if (error.error_code != 0) {
+    u7_vm0_program_destroy(self);
+  }
+  return error;
+}
+
+u7_error u7_vm0_test_state_init(struct u7_vm0_test_state* self,
+                                struct u7_vm0_program const* program,
+                                struct u7_vm_instruction const* const* js,
+                                int64_t const* input, size_t input_size,
+                                int64_t* output, size_t output_capacity) {
+  u7_error error = u7_vm_state_init(&self->state, u7_vm0_globals_frame_layout,
+                                    js, program->instructions_size);
+  if (error.error_code != 0) {
+    return error;
+  }
+  error =
+      u7_vm_stack_push_frame(&self->state.stack, &program->locals_frame_layout);
+  if (error.error_code != 0) {
+    u7_vm_state_destroy(&self->state);
+    return error;
+  }
+  u7_vm0_memory_input_init(&self->input, input, input_size * sizeof(int64_t));
+  u7_vm0_memory_output_init(&self->output, output,
+                            output_capacity * sizeof(int64_t));
+  u7_vm0_state_globals(&self->state)->input = &self->input.base;
+  u7_vm0_state_globals(&self->state)->output = &self->output.base;
+  return u7_ok();
+}
+
+void u7_vm0_test_state_destroy(struct u7_vm0_test_state* self) {
+  u7_vm_state_destroy(&self->state);
+  u7_vm0_memory_input_destroy(&self->input);
+  u7_error_release(u7_vm0_memory_output_destroy(&self->output));
+}
+
+u7_error u7_vm0_test_run(struct u7_vm0_program const* program,
+                         struct u7_vm_instruction const* const* js,
+                         int64_t const* input, size_t input_size,
+                         int64_t* output, size_t* output_size) {
+  struct u7_vm0_test_state test_state;
+  u7_error error = u7_vm0_test_state_init(&test_state, program, js, input,
+                                          input_size, output, *output_size);
+  if (error.error_code != 0) {
+    return error;
+  }
+  u7_vm_state_run(&test_state.state);
+  error = u7_vm0_state_take_error(&test_state.state);
+  *output_size = u7_vm0_test_state_output_size(&test_state);
+  u7_vm0_test_state_destroy(&test_state);
+  return error;
+}
+
+u7_error u7_vm0_test_run_single(struct u7_vm0_program const* program,
+                                struct u7_vm_instruction const* const* js,
+                                int64_t input, int64_t* output) {
+  size_t output_size = 1;
+  u7_error error =
+      u7_vm0_test_run(program, js, &input, 1, output, &output_size);
+  if (error.error_code == 0 && output_size != 1) {
+    error = u7_errnof(EINVAL, "u7_vm0_test_run_single: %zu values written",
+                      output_size);
+  }
+  return error;
+}
+
+u7_error u7_vm0_test_run_engine(struct u7_vm0_program const* program,
+                                u7_vm0_test_run_fn run_fn,
+                                void const* engine, int64_t const* input,
+                                size_t input_size, int64_t* output,
+                                size_t* output_size) {
+  struct u7_vm0_test_state test_state;
+  u7_error error =
+      u7_vm0_test_state_init(&test_state, program, program->js, input,
+                             input_size, output, *output_size);
+  if (error.error_code != 0) {
+    return error;
+  }
+  // `ret` and the failures reset ip to 0; `yield` leaves it after itself.
+  do {
+    run_fn(engine, &test_state.state);
+  } while (test_state.state.ip != 0);
+  error = u7_vm0_state_take_error(&test_state.state);
+  *output_size = u7_vm0_test_state_output_size(&test_state);
+  u7_vm0_test_state_destroy(&test_state);
+  return error;
+}
+
+static void u7_vm0_test_run_loop(void const* engine,
+                                 struct u7_vm_state* state) {
+  u7_vm_state_run(state);
+}
+
+enum { U7_VM0_TEST_MAX_OUTPUT_SIZE = 64 };
+
+u7_error u7_vm0_test_check_engine(const char* name,
+                                  struct u7_vm0_program const* program,
+                                  u7_vm0_test_run_fn run_fn,
+                                  void const* engine, int64_t const* input,
+                                  size_t input_size) {
+  int64_t expected[U7_VM0_TEST_MAX_OUTPUT_SIZE];
+  int64_t actual[U7_VM0_TEST_MAX_OUTPUT_SIZE];
+  size_t expected_size = U7_VM0_TEST_MAX_OUTPUT_SIZE;
+  size_t actual_size = U7_VM0_TEST_MAX_OUTPUT_SIZE;
+  u7_error expected_error =
+      u7_vm0_test_run_engine(program, &u7_vm0_test_run_loop, NULL, input,
+                             input_size, expected, &expected_size);
+  u7_error actual_error = u7_vm0_test_run_engine(
+      program, run_fn, engine, input, input_size, actual, &actual_size);
+  const int expected_code = expected_error.error_code;
+  const int actual_code = actual_error.error_code;
+  u7_error_release(expected_error);
+  u7_error_release(actual_error);
+  if (actual_code != expected_code) {
+    return u7_errnof(EINVAL, "%s: expected error %d, got %d", name,
+                     expected_code, actual_code);
+  }
+  if (actual_size != expected_size) {
+    return u7_errnof(EINVAL, "%s: expected %zu values written, got %zu",
+                     name, expected_size, actual_size);
+  }
+  for (size_t i = 0; i < expected_size; ++i) {
+    if (actual[i] != expected[i]) {
+      return u7_errnof(EINVAL,
+                       "%s: value %zu: expected %" PRId64 ", got %" PRId64,
+                       name, i, expected[i], actual[i]);
+    }
+  }
+  return u7_ok();
+}
+
+u7_error u7_vm0_test_expect_error(const char* name, u7_error error,
+                                  int error_code) {
+  if (error.error_code == error_code) {
+    u7_error_release(error);
+    return u7_ok();
+  }
+  if (error.error_code == 0) {
+    return u7_errnof(EINVAL, "%s: expected error %d, got success", name,
+                     error_code);
+  }
+  u7_error result =
+      u7_errnof(EINVAL, "%s: expected error %d, got %" U7_ERROR_FMT, name,
+                error_code, U7_ERROR_FMT_PARAMS(error));
+  u7_error_release(error);
+  return result;
+}
+
+int u7_vm0_test_main(u7_error (*const* tests)(), size_t tests_size) {
+  YalogSetConfig(YalogCreatePlainConfig(YalogCreateStderrSink(YALOG_INFO)));
+  int result = 0;
+  for (size_t i = 0; i < tests_size; ++i) {
+    u7_error error = tests[i]();
+    if (error.error_code) {
+      YALOG_PRINTF(ERROR, "%" U7_ERROR_FMT "\n", U7_ERROR_FMT_PARAMS(error));
+      u7_error_release(error);
+      result = -1;
+    }
+  }
+  return result;
+}
@@ -0,0 +1,98 @@
+#ifndef U7_VM0_TESTING_H_
+#define U7_VM0_TESTING_H_
+
+#include "@/public/input.h"
+#include "@/public/output.h"
+#include "@/public/program.h"
+
+#include <github.com/apronchenkov/error/public/error.h>
+#include <github.com/apronchenkov/vm/public/instruction.h>
+#include <github.com/apronchenkov/vm/public/state.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif  // __cplusplus
+
+// Builds a program from a copy of the instructions, verified with
+// u7_vm0_verify(); destroy it with u7_vm0_program_destroy().
+u7_error u7_vm0_test_program_init(
+    struct u7_vm0_program* self,
+    struct u7_vm0_instruction const* instructions, size_t instructions_size,
+    struct u7_vm_stack_frame_layout const* locals_frame_layout);
+
+// Fixture of the tests: a state of a program, with i64 values in memory as
+// its input and output, and the locals frame of the program as the current
+// frame.
+struct u7_vm0_test_state {
+  struct u7_vm0_memory_input input;
+  struct u7_vm0_memory_output output;
+  struct u7_vm_state state;
+};
+
+// Executes the program through `js` (e.g. program->js, or the trampolines of
+// a profile). The input and the output must outlive the state; the output has
+// room for `output_capacity` values.
+u7_error u7_vm0_test_state_init(struct u7_vm0_test_state* self,
+                                struct u7_vm0_program const* program,
+                                struct u7_vm_instruction const* const* js,
+                                int64_t const* input, size_t input_size,
+                                int64_t* output, size_t output_capacity);
+
+void u7_vm0_test_state_destroy(struct u7_vm0_test_state* self);
+
+// Returns the number of the values written so far.
+static inline size_t u7_vm0_test_state_output_size(
+    struct u7_vm0_test_state const* self) {
+  return u7_vm0_memory_output_size(&self->output) / sizeof(int64_t);
+}
+
+// Runs the program once, with u7_vm_state_run(), until `ret`, `yield` or a
+// failure, and returns the failure. On input, *output_size is the capacity of
+// `output`; on output, the number of the written values.
+u7_error u7_vm0_test_run(struct u7_vm0_program const* program,
+                         struct u7_vm_instruction const* const* js,
+                         int64_t const* input, size_t input_size,
+                         int64_t* output, size_t* output_size);
+
+// Same as u7_vm0_test_run(), for a program that reads at most one value and
+// writes exactly one.
+u7_error u7_vm0_test_run_single(struct u7_vm0_program const* program,
+                                struct u7_vm_instruction const* const* js,
+                                int64_t input, int64_t* output);
+
+// An execution engine: runs the state from state->ip until `ret`, `yield`
+// or a failure, like u7_vm_state_run().
+typedef void (*u7_vm0_test_run_fn)(void const* engine,
+                                   struct u7_vm_state* state);
+
+// Same as u7_vm0_test_run(), but executes the program with `run_fn` and
+// resumes it after every `yield`, until `ret` or a failure.
+u7_error u7_vm0_test_run_engine(struct u7_vm0_program const* program,
+                                u7_vm0_test_run_fn run_fn,
+                                void const* engine, int64_t const* input,
+                                size_t input_size, int64_t* output,
+                                size_t* output_size);
+
+// Checks that the engine writes the same values and fails with the same
+// error code as u7_vm_state_run() does, for the given input.
+u7_error u7_vm0_test_check_engine(const char* name,
+                                  struct u7_vm0_program const* program,
+                                  u7_vm0_test_run_fn run_fn,
+                                  void const* engine, int64_t const* input,
+                                  size_t input_size);
+
+// Checks that `error` has `error_code`; takes the ownership of `error`.
+u7_error u7_vm0_test_expect_error(const char* name, u7_error error,
+                                  int error_code);
+
+// Runs the tests, logs their failures, and returns the exit code of the test
+// binary.
+int u7_vm0_test_main(u7_error (*const* tests)(), size_t tests_size);
+
+#ifdef __cplusplus
+}  // extern "C"
+#endif  // __cplusplus
+
+#endif  // U7_VM0_TESTING_H_
@@ -0,0 +1,723 @@
+#include "@/public/threaded.h"
+
+#include "@/public/opcode.h"
+
+#include <errno.h>
+#include <github.com/apronchenkov/error/public/error.h>
+#include <github.com/apronchenkov/vm/public/state.h>
+#include <stdlib.h>
+
+// Locals are addressed through `locals`, the cached base of the current
+// frame, which is reloaded only after an execute_fn call.
+#define U7_VM0_THREADED_LOCAL(type, arg)                                \
+  (*u7_vm0_cached_local_##type(state, locals, it->instruction.arg.i64))
+
+#define U7_VM0_THREADED_PAIR_LOCAL(type, arg, half)                        \
+  (*u7_vm0_cached_local_##type(                                            \
+      state, locals, u7_vm0_operand_pair_##half(it->instruction.arg.i64)))
+
+#define U7_VM0_THREADED_NEXT() \
+  do {                         \
+    ++it;                      \
+    goto* it->handler;         \
+  } while (0)
+
+#define U7_VM0_THREADED_JUMP_IF(condition, label_arg)                         \
+  do {                                                                        \
+    it = ((condition) ? program->instructions + it->instruction.label_arg.i64 \
+                      : it + 1);                                              \
+    goto* it->handler;                                                        \
+  } while (0)
+
+#define U7_VM0_THREADED_JUMP_IF_COMPARE(type, op, rhs)                     \
+  U7_VM0_THREADED_JUMP_IF(U7_VM0_THREADED_LOCAL(type, arg1) op(rhs), arg3)
+
+// The entries of the table follow the instruction; each is a `jump`.
+#define U7_VM0_THREADED_JUMP_TABLE(type)                      \
+  do {                                                        \
+    const uint64_t index =                                    \
+        (uint64_t)(int64_t)U7_VM0_THREADED_LOCAL(type, arg1); \
+    it = program->instructions +                              \
+         (index < (uint64_t)it->instruction.arg2.i64          \
+              ? it[1 + index].instruction.arg1.i64            \
+              : it->instruction.arg3.i64);                    \
+    goto* it->handler;                                        \
+  } while (0)
+
+// If `program` is NULL, stores the handler table to *handlers and returns.
+// The table is indexed by opcode; the entry at U7_VM0_OPCODE_COUNT is the
+// generic handler.
+static void u7_vm0_threaded_execute(
+    struct u7_vm0_threaded_program const* program, struct u7_vm_state* state,
+    void const* const** handlers) {
+  static void const* const handler_table[U7_VM0_OPCODE_COUNT + 1] = {
+      [U7_VM0_OPCODE_YIELD] = &&yield,
+      [U7_VM0_OPCODE_COPY_I32C] = &&copy_i32c,
+      [U7_VM0_OPCODE_COPY_I64C] = &&copy_i64c,
+      [U7_VM0_OPCODE_COPY_F32C] = &&copy_f32c,
+      [U7_VM0_OPCODE_COPY_F64C] = &&copy_f64c,
+      [U7_VM0_OPCODE_COPY_I32V] = &&copy_i32v,
+      [U7_VM0_OPCODE_COPY_I64V] = &&copy_i64v,
+      [U7_VM0_OPCODE_COPY_F32V] = &&copy_f32v,
+      [U7_VM0_OPCODE_COPY_F64V] = &&copy_f64v,
+      [U7_VM0_OPCODE_BITWISE_AND_I32VC] = &&bitwise_and_i32vc,
+      [U7_VM0_OPCODE_BITWISE_AND_I32VV] = &&bitwise_and_i32vv,
+      [U7_VM0_OPCODE_BITWISE_LEFT_SHIFT_I32VC] = &&bitwise_left_shift_i32vc,
+      [U7_VM0_OPCODE_BITWISE_RIGHT_SHIFT_I32VC] = &&bitwise_right_shift_i32vc,
+      [U7_VM0_OPCODE_BITWISE_AND_I64VC] = &&bitwise_and_i64vc,
+      [U7_VM0_OPCODE_BITWISE_AND_I64VV] = &&bitwise_and_i64vv,
+      [U7_VM0_OPCODE_BITWISE_LEFT_SHIFT_I64VC] = &&bitwise_left_shift_i64vc,
+      [U7_VM0_OPCODE_BITWISE_RIGHT_SHIFT_I64VC] = &&bitwise_right_shift_i64vc,
+      [U7_VM0_OPCODE_MATH_ADD_I32VC] = &&math_add_i32vc,
+      [U7_VM0_OPCODE_MATH_ADD_I32VV] = &&math_add_i32vv,
+      [U7_VM0_OPCODE_MATH_ADD_I64VC] = &&math_add_i64vc,
+      [U7_VM0_OPCODE_MATH_ADD_I64VV] = &&math_add_i64vv,
+      [U7_VM0_OPCODE_MATH_ADD_F32VC] = &&math_add_f32vc,
+      [U7_VM0_OPCODE_MATH_ADD_F32VV] = &&math_add_f32vv,
+      [U7_VM0_OPCODE_MATH_ADD_F64VC] = &&math_add_f64vc,
+      [U7_VM0_OPCODE_MATH_ADD_F64VV] = &&math_add_f64vv,
+      [U7_VM0_OPCODE_MATH_MULTIPLY_I32VC] = &&math_multiply_i32vc,
+      [U7_VM0_OPCODE_MATH_MULTIPLY_I32VV] = &&math_multiply_i32vv,
+      [U7_VM0_OPCODE_MATH_MULTIPLY_I64VC] = &&math_multiply_i64vc,
+      [U7_VM0_OPCODE_MATH_MULTIPLY_I64VV] = &&math_multiply_i64vv,
+      [U7_VM0_OPCODE_MATH_MULTIPLY_F32VC] = &&math_multiply_f32vc,
+      [U7_VM0_OPCODE_MATH_MULTIPLY_F32VV] = &&math_multiply_f32vv,
+      [U7_VM0_OPCODE_MATH_MULTIPLY_F64VC] = &&math_multiply_f64vc,
+      [U7_VM0_OPCODE_MATH_MULTIPLY_F64VV] = &&math_multiply_f64vv,
+      [U7_VM0_OPCODE_JUMP_IF_ZERO_I32] = &&jump_if_zero_i32,
+      [U7_VM0_OPCODE_JUMP_IF_ZERO_I64] = &&jump_if_zero_i64,
+      [U7_VM0_OPCODE_JUMP_IF_ZERO_F32] = &&jump_if_zero_f32,
+      [U7_VM0_OPCODE_JUMP_IF_ZERO_F64] = &&jump_if_zero_f64,
+      [U7_VM0_OPCODE_JUMP_IF_NOT_ZERO_I32] = &&jump_if_not_zero_i32,
+      [U7_VM0_OPCODE_JUMP_IF_NOT_ZERO_I64] = &&jump_if_not_zero_i64,
+      [U7_VM0_OPCODE_JUMP_IF_NOT_ZERO_F32] = &&jump_if_not_zero_f32,
+      [U7_VM0_OPCODE_JUMP_IF_NOT_ZERO_F64] = &&jump_if_not_zero_f64,
+      [U7_VM0_OPCODE_JUMP_IF_ZERO_I32_UNCHECKED] = &&jump_if_zero_i32_unchecked,
+      [U7_VM0_OPCODE_JUMP_IF_ZERO_I64_UNCHECKED] = &&jump_if_zero_i64_unchecked,
+      [U7_VM0_OPCODE_JUMP_IF_ZERO_F32_UNCHECKED] = &&jump_if_zero_f32_unchecked,
+      [U7_VM0_OPCODE_JUMP_IF_ZERO_F64_UNCHECKED] = &&jump_if_zero_f64_unchecked,
+      [U7_VM0_OPCODE_JUMP_IF_NOT_ZERO_I32_UNCHECKED] =
+          &&jump_if_not_zero_i32_unchecked,
+      [U7_VM0_OPCODE_JUMP_IF_NOT_ZERO_I64_UNCHECKED] =
+          &&jump_if_not_zero_i64_unchecked,
+      [U7_VM0_OPCODE_JUMP_IF_NOT_ZERO_F32_UNCHECKED] =
+          &&jump_if_not_zero_f32_unchecked,
+      [U7_VM0_OPCODE_JUMP_IF_NOT_ZERO_F64_UNCHECKED] =
+          &&jump_if_not_zero_f64_unchecked,
+      [U7_VM0_OPCODE_JUMP] = &&jump,
+      [U7_VM0_OPCODE_JUMP_UNCHECKED] = &&jump_unchecked,
+      [U7_VM0_OPCODE_JUMP_TABLE_I32_UNCHECKED] = &&jump_table_i32_unchecked,
+      [U7_VM0_OPCODE_JUMP_TABLE_I64_UNCHECKED] = &&jump_table_i64_unchecked,
+      [U7_VM0_OPCODE_JUMP_IF_EQUAL_I32VC_UNCHECKED] =
+          &&jump_if_equal_i32vc_unchecked,
+      [U7_VM0_OPCODE_JUMP_IF_EQUAL_I32VV_UNCHECKED] =
+          &&jump_if_equal_i32vv_unchecked,
+      [U7_VM0_OPCODE_JUMP_IF_EQUAL_I64VC_UNCHECKED] =
+          &&jump_if_equal_i64vc_unchecked,
+      [U7_VM0_OPCODE_JUMP_IF_EQUAL_I64VV_UNCHECKED] =
+          &&jump_if_equal_i64vv_unchecked,
+      [U7_VM0_OPCODE_JUMP_IF_EQUAL_F32VC_UNCHECKED] =
+          &&jump_if_equal_f32vc_unchecked,
+      [U7_VM0_OPCODE_JUMP_IF_EQUAL_F32VV_UNCHECKED] =
+          &&jump_if_equal_f32vv_unchecked,
+      [U7_VM0_OPCODE_JUMP_IF_EQUAL_F64VC_UNCHECKED] =
+          &&jump_if_equal_f64vc_unchecked,
+      [U7_VM0_OPCODE_JUMP_IF_EQUAL_F64VV_UNCHECKED] =
+          &&jump_if_equal_f64vv_unchecked,
+      [U7_VM0_OPCODE_JUMP_IF_NOT_EQUAL_I32VC_UNCHECKED] =
+          &&jump_if_not_equal_i32vc_unchecked,
+      [U7_VM0_OPCODE_JUMP_IF_NOT_EQUAL_I32VV_UNCHECKED] =
+          &&jump_if_not_equal_i32vv_unchecked,
+      [U7_VM0_OPCODE_JUMP_IF_NOT_EQUAL_I64VC_UNCHECKED] =
+          &&jump_if_not_equal_i64vc_unchecked,
+      [U7_VM0_OPCODE_JUMP_IF_NOT_EQUAL_I64VV_UNCHECKED] =
+          &&jump_if_not_equal_i64vv_unchecked,
+      [U7_VM0_OPCODE_JUMP_IF_NOT_EQUAL_F32VC_UNCHECKED] =
+          &&jump_if_not_equal_f32vc_unchecked,
+      [U7_VM0_OPCODE_JUMP_IF_NOT_EQUAL_F32VV_UNCHECKED] =
+          &&jump_if_not_equal_f32vv_unchecked,
+      [U7_VM0_OPCODE_JUMP_IF_NOT_EQUAL_F64VC_UNCHECKED] =
+          &&jump_if_not_equal_f64vc_unchecked,
+      [U7_VM0_OPCODE_JUMP_IF_NOT_EQUAL_F64VV_UNCHECKED] =
+          &&jump_if_not_equal_f64vv_unchecked,
+      [U7_VM0_OPCODE_JUMP_IF_LESS_I32VC_UNCHECKED] =
+          &&jump_if_less_i32vc_unchecked,
+      [U7_VM0_OPCODE_JUMP_IF_LESS_I32VV_UNCHECKED] =
+          &&jump_if_less_i32vv_unchecked,
+      [U7_VM0_OPCODE_JUMP_IF_LESS_I64VC_UNCHECKED] =
+          &&jump_if_less_i64vc_unchecked,
+      [U7_VM0_OPCODE_JUMP_IF_LESS_I64VV_UNCHECKED] =
+          &&jump_if_less_i64vv_unchecked,
+      [U7_VM0_OPCODE_JUMP_IF_LESS_F32VC_UNCHECKED] =
+          &&jump_if_less_f32vc_unchecked,
+      [U7_VM0_OPCODE_JUMP_IF_LESS_F32VV_UNCHECKED] =
+          &&jump_if_less_f32vv_unchecked,
+      [U7_VM0_OPCODE_JUMP_IF_LESS_F64VC_UNCHECKED] =
+          &&jump_if_less_f64vc_unchecked,
+      [U7_VM0_OPCODE_JUMP_IF_LESS_F64VV_UNCHECKED] =
+          &&jump_if_less_f64vv_unchecked,
+      [U7_VM0_OPCODE_JUMP_IF_LESS_OR_EQUAL_I32VC_UNCHECKED] =
+          &&jump_if_less_or_equal_i32vc_unchecked,
+      [U7_VM0_OPCODE_JUMP_IF_LESS_OR_EQUAL_I32VV_UNCHECKED] =
+          &&jump_if_less_or_equal_i32vv_unchecked,
+      [U7_VM0_OPCODE_JUMP_IF_LESS_OR_EQUAL_I64VC_UNCHECKED] =
+          &&jump_if_less_or_equal_i64vc_unchecked,
+      [U7_VM0_OPCODE_JUMP_IF_LESS_OR_EQUAL_I64VV_UNCHECKED] =
+          &&jump_if_less_or_equal_i64vv_unchecked,
+      [U7_VM0_OPCODE_JUMP_IF_LESS_OR_EQUAL_F32VC_UNCHECKED] =
+          &&jump_if_less_or_equal_f32vc_unchecked,
+      [U7_VM0_OPCODE_JUMP_IF_LESS_OR_EQUAL_F32VV_UNCHECKED] =
+          &&jump_if_less_or_equal_f32vv_unchecked,
+      [U7_VM0_OPCODE_JUMP_IF_LESS_OR_EQUAL_F64VC_UNCHECKED] =
+          &&jump_if_less_or_equal_f64vc_unchecked,
+      [U7_VM0_OPCODE_JUMP_IF_LESS_OR_EQUAL_F64VV_UNCHECKED] =
+          &&jump_if_less_or_equal_f64vv_unchecked,
+      [U7_VM0_OPCODE_JUMP_IF_GREATER_I32VC_UNCHECKED] =
+          &&jump_if_greater_i32vc_unchecked,
+      [U7_VM0_OPCODE_JUMP_IF_GREATER_I64VC_UNCHECKED] =
+          &&jump_if_greater_i64vc_unchecked,
+      [U7_VM0_OPCODE_JUMP_IF_GREATER_F32VC_UNCHECKED] =
+          &&jump_if_greater_f32vc_unchecked,
+      [U7_VM0_OPCODE_JUMP_IF_GREATER_F64VC_UNCHECKED] =
+          &&jump_if_greater_f64vc_unchecked,
+      [U7_VM0_OPCODE_JUMP_IF_GREATER_OR_EQUAL_I32VC_UNCHECKED] =
+          &&jump_if_greater_or_equal_i32vc_unchecked,
+      [U7_VM0_OPCODE_JUMP_IF_GREATER_OR_EQUAL_I64VC_UNCHECKED] =
+          &&jump_if_greater_or_equal_i64vc_unchecked,
+      [U7_VM0_OPCODE_JUMP_IF_GREATER_OR_EQUAL_F32VC_UNCHECKED] =
+          &&jump_if_greater_or_equal_f32vc_unchecked,
+      [U7_VM0_OPCODE_JUMP_IF_GREATER_OR_EQUAL_F64VC_UNCHECKED] =
+          &&jump_if_greater_or_equal_f64vc_unchecked,
+      [U7_VM0_OPCODE_BITWISE_AND_JUMP_IF_ZERO_I64VC] =
+          &&bitwise_and_jump_if_zero_i64vc,
+      [U7_VM0_OPCODE_BITWISE_AND_JUMP_IF_NOT_ZERO_I64VC] =
+          &&bitwise_and_jump_if_not_zero_i64vc,
+      [U7_VM0_OPCODE_BITWISE_RIGHT_SHIFT_JUMP_IF_NOT_ZERO_I64VC] =
+          &&bitwise_right_shift_jump_if_not_zero_i64vc,
+      [U7_VM0_OPCODE_MATH_ADD_2_F64VV] = &&math_add_2_f64vv,
+      [U7_VM0_OPCODE_MATH_MULTIPLY_2_F64VV] = &&math_multiply_2_f64vv,
+      [U7_VM0_OPCODE_MATH_MULTIPLY_ADD_F64VVV] = &&math_multiply_add_f64vvv,
+      [U7_VM0_OPCODE_COUNT] = &&generic,
+  };
+  if (program == NULL) {
+    *handlers = handler_table;
+    return;
+  }
+  assert(state->instructions_size == program->instructions_size);
+  assert(state->ip < program->instructions_size);
+  struct u7_vm0_threaded_instruction const* it =
+      program->instructions + state->ip;
+  void* locals = u7_vm_state_locals(state);
+  goto* it->handler;
+
+yield:
+  state->ip = (size_t)(it - program->instructions) + 1;
+  return;
+
+generic:
+  // Instructions without a dedicated handler (and the slow paths of the
+  // ones with it) are executed through their regular execute_fn.
+  state->ip = (size_t)(it - program->instructions) + 1;
+  if (!it->instruction.base.execute_fn(state, &it->instruction.base)) {
+    return;
+  }
+  it = program->instructions + state->ip;
+  locals = u7_vm_state_locals(state);
+  goto* it->handler;
+
+copy_i32c:
+  U7_VM0_THREADED_LOCAL(i32, arg1) = it->instruction.arg2.i32;
+  U7_VM0_THREADED_NEXT();
+
+copy_i64c:
+  U7_VM0_THREADED_LOCAL(i64, arg1) = it->instruction.arg2.i64;
+  U7_VM0_THREADED_NEXT();
+
+copy_f32c:
+  U7_VM0_THREADED_LOCAL(f32, arg1) = it->instruction.arg2.f32;
+  U7_VM0_THREADED_NEXT();
+
+copy_f64c:
+  U7_VM0_THREADED_LOCAL(f64, arg1) = it->instruction.arg2.f64;
+  U7_VM0_THREADED_NEXT();
+
+copy_i32v:
+  U7_VM0_THREADED_LOCAL(i32, arg1) = U7_VM0_THREADED_LOCAL(i32, arg2);
+  U7_VM0_THREADED_NEXT();
+
+copy_i64v:
+  U7_VM0_THREADED_LOCAL(i64, arg1) = U7_VM0_THREADED_LOCAL(i64, arg2);
+  U7_VM0_THREADED_NEXT();
+
+copy_f32v:
+  U7_VM0_THREADED_LOCAL(f32, arg1) = U7_VM0_THREADED_LOCAL(f32, arg2);
+  U7_VM0_THREADED_NEXT();
+
+copy_f64v:
+  U7_VM0_THREADED_LOCAL(f64, arg1) = U7_VM0_THREADED_LOCAL(f64, arg2);
+  U7_VM0_THREADED_NEXT();
+
+bitwise_and_i32vc:
+  U7_VM0_THREADED_LOCAL(i32, arg1) =
+      U7_VM0_THREADED_LOCAL(i32, arg2) & it->instruction.arg3.i32;
+  U7_VM0_THREADED_NEXT();
+
+bitwise_and_i32vv:
+  U7_VM0_THREADED_LOCAL(i32, arg1) =
+      U7_VM0_THREADED_LOCAL(i32, arg2) & U7_VM0_THREADED_LOCAL(i32, arg3);
+  U7_VM0_THREADED_NEXT();
+
+bitwise_left_shift_i32vc:
+  U7_VM0_THREADED_LOCAL(i32, arg1) =
+      U7_VM0_THREADED_LOCAL(i32, arg2) << it->instruction.arg3.i32;
+  U7_VM0_THREADED_NEXT();
+
+bitwise_right_shift_i32vc:
+  U7_VM0_THREADED_LOCAL(i32, arg1) =
+      U7_VM0_THREADED_LOCAL(i32, arg2) >> it->instruction.arg3.i32;
+  U7_VM0_THREADED_NEXT();
+
+bitwise_and_i64vc:
+  U7_VM0_THREADED_LOCAL(i64, arg1) =
+      U7_VM0_THREADED_LOCAL(i64, arg2) & it->instruction.arg3.i64;
+  U7_VM0_THREADED_NEXT();
+
+bitwise_and_i64vv:
+  U7_VM0_THREADED_LOCAL(i64, arg1) =
+      U7_VM0_THREADED_LOCAL(i64, arg2) & U7_VM0_THREADED_LOCAL(i64, arg3);
+  U7_VM0_THREADED_NEXT();
+
+bitwise_left_shift_i64vc:
+  U7_VM0_THREADED_LOCAL(i64, arg1) =
+      U7_VM0_THREADED_LOCAL(i64, arg2) << it->instruction.arg3.i64;
+  U7_VM0_THREADED_NEXT();
+
+bitwise_right_shift_i64vc:
+  U7_VM0_THREADED_LOCAL(i64, arg1) =
+      U7_VM0_THREADED_LOCAL(i64, arg2) >> it->instruction.arg3.i64;
+  U7_VM0_THREADED_NEXT();
+
+math_add_i32vc:
+  {
+    int32_t result;
+    if (__builtin_add_overflow(U7_VM0_THREADED_LOCAL(i32, arg2),
+                               it->instruction.arg3.i32, &result)) {
+      goto generic;  // Let the original instruction report the overflow.
+    }
+    U7_VM0_THREADED_LOCAL(i32, arg1) = result;
+  }
+  U7_VM0_THREADED_NEXT();
+
+math_add_i32vv:
+  {
+    int32_t result;
+    if (__builtin_add_overflow(U7_VM0_THREADED_LOCAL(i32, arg2),
+                               U7_VM0_THREADED_LOCAL(i32, arg3), &result)) {
+      goto generic;  // Let the original instruction report the overflow.
+    }
+    U7_VM0_THREADED_LOCAL(i32, arg1) = result;
+  }
+  U7_VM0_THREADED_NEXT();
+
+math_add_i64vc:
+  {
+    int64_t result;
+    if (__builtin_add_overflow(U7_VM0_THREADED_LOCAL(i64, arg2),
+                               it->instruction.arg3.i64, &result)) {
+      goto generic;  // Let the original instruction report the overflow.
+    }
+    U7_VM0_THREADED_LOCAL(i64, arg1) = result;
+  }
+  U7_VM0_THREADED_NEXT();
+
+math_add_i64vv:
+  {
+    int64_t result;
+    if (__builtin_add_overflow(U7_VM0_THREADED_LOCAL(i64, arg2),
+                               U7_VM0_THREADED_LOCAL(i64, arg3), &result)) {
+      goto generic;  // Let the original instruction report the overflow.
+    }
+    U7_VM0_THREADED_LOCAL(i64, arg1) = result;
+  }
+  U7_VM0_THREADED_NEXT();
+
+math_add_f32vc:
+  U7_VM0_THREADED_LOCAL(f32, arg1) =
+      U7_VM0_THREADED_LOCAL(f32, arg2) + it->instruction.arg3.f32;
+  U7_VM0_THREADED_NEXT();
+
+math_add_f32vv:
+  U7_VM0_THREADED_LOCAL(f32, arg1) =
+      U7_VM0_THREADED_LOCAL(f32, arg2) + U7_VM0_THREADED_LOCAL(f32, arg3);
+  U7_VM0_THREADED_NEXT();
+
+math_add_f64vc:
+  U7_VM0_THREADED_LOCAL(f64, arg1) =
+      U7_VM0_THREADED_LOCAL(f64, arg2) + it->instruction.arg3.f64;
+  U7_VM0_THREADED_NEXT();
+
+math_add_f64vv:
+  U7_VM0_THREADED_LOCAL(f64, arg1) =
+      U7_VM0_THREADED_LOCAL(f64, arg2) + U7_VM0_THREADED_LOCAL(f64, arg3);
+  U7_VM0_THREADED_NEXT();
+
+math_multiply_i32vc:
+  {
+    int32_t result;
+    if (__builtin_mul_overflow(U7_VM0_THREADED_LOCAL(i32, arg2),
+                               it->instruction.arg3.i32, &result)) {
+      goto generic;  // Let the original instruction report the overflow.
+    }
+    U7_VM0_THREADED_LOCAL(i32, arg1) = result;
+  }
+  U7_VM0_THREADED_NEXT();
+
+math_multiply_i32vv:
+  {
+    int32_t result;
+    if (__builtin_mul_overflow(U7_VM0_THREADED_LOCAL(i32, arg2),
+                               U7_VM0_THREADED_LOCAL(i32, arg3), &result)) {
+      goto generic;  // Let the original instruction report the overflow.
+    }
+    U7_VM0_THREADED_LOCAL(i32, arg1) = result;
+  }
+  U7_VM0_THREADED_NEXT();
+
+math_multiply_i64vc:
+  {
+    int64_t result;
+    if (__builtin_mul_overflow(U7_VM0_THREADED_LOCAL(i64, arg2),
+                               it->instruction.arg3.i64, &result)) {
+      goto generic;  // Let the original instruction report the overflow.
+    }
+    U7_VM0_THREADED_LOCAL(i64, arg1) = result;
+  }
+  U7_VM0_THREADED_NEXT();
+
+math_multiply_i64vv:
+  {
+    int64_t result;
+    if (__builtin_mul_overflow(U7_VM0_THREADED_LOCAL(i64, arg2),
+                               U7_VM0_THREADED_LOCAL(i64, arg3), &result)) {
+      goto generic;  // Let the original instruction report the overflow.
+    }
+    U7_VM0_THREADED_LOCAL(i64, arg1) = result;
+  }
+  U7_VM0_THREADED_NEXT();
+
+math_multiply_f32vc:
+  U7_VM0_THREADED_LOCAL(f32, arg1) =
+      U7_VM0_THREADED_LOCAL(f32, arg2) * it->instruction.arg3.f32;
+  U7_VM0_THREADED_NEXT();
+
+math_multiply_f32vv:
+  U7_VM0_THREADED_LOCAL(f32, arg1) =
+      U7_VM0_THREADED_LOCAL(f32, arg2) * U7_VM0_THREADED_LOCAL(f32, arg3);
+  U7_VM0_THREADED_NEXT();
+
+math_multiply_f64vc:
+  U7_VM0_THREADED_LOCAL(f64, arg1) =
+      U7_VM0_THREADED_LOCAL(f64, arg2) * it->instruction.arg3.f64;
+  U7_VM0_THREADED_NEXT();
+
+math_multiply_f64vv:
+  U7_VM0_THREADED_LOCAL(f64, arg1) =
+      U7_VM0_THREADED_LOCAL(f64, arg2) * U7_VM0_THREADED_LOCAL(f64, arg3);
+  U7_VM0_THREADED_NEXT();
+
+jump_if_zero_i32:
+  if ((size_t)it->instruction.arg2.i64 >= program->instructions_size) {
+    goto generic;  // Let the original instruction report the error.
+  }
+  U7_VM0_THREADED_JUMP_IF(U7_VM0_THREADED_LOCAL(i32, arg1) == 0, arg2);
+
+jump_if_zero_i64:
+  if ((size_t)it->instruction.arg2.i64 >= program->instructions_size) {
+    goto generic;  // Let the original instruction report the error.
+  }
+  U7_VM0_THREADED_JUMP_IF(U7_VM0_THREADED_LOCAL(i64, arg1) == 0, arg2);
+
+jump_if_zero_f32:
+  if ((size_t)it->instruction.arg2.i64 >= program->instructions_size) {
+    goto generic;  // Let the original instruction report the error.
+  }
+  U7_VM0_THREADED_JUMP_IF(U7_VM0_THREADED_LOCAL(f32, arg1) == 0, arg2);
+
+jump_if_zero_f64:
+  if ((size_t)it->instruction.arg2.i64 >= program->instructions_size) {
+    goto generic;  // Let the original instruction report the error.
+  }
+  U7_VM0_THREADED_JUMP_IF(U7_VM0_THREADED_LOCAL(f64, arg1) == 0, arg2);
+
+jump_if_not_zero_i32:
+  if ((size_t)it->instruction.arg2.i64 >= program->instructions_size) {
+    goto generic;  // Let the original instruction report the error.
+  }
+  U7_VM0_THREADED_JUMP_IF(U7_VM0_THREADED_LOCAL(i32, arg1) != 0, arg2);
+
+jump_if_not_zero_i64:
+  if ((size_t)it->instruction.arg2.i64 >= program->instructions_size) {
+    goto generic;  // Let the original instruction report the error.
+  }
+  U7_VM0_THREADED_JUMP_IF(U7_VM0_THREADED_LOCAL(i64, arg1) != 0, arg2);
+
+jump_if_not_zero_f32:
+  if ((size_t)it->instruction.arg2.i64 >= program->instructions_size) {
+    goto generic;  // Let the original instruction report the error.
+  }
+  U7_VM0_THREADED_JUMP_IF(U7_VM0_THREADED_LOCAL(f32, arg1) != 0, arg2);
+
+jump_if_not_zero_f64:
+  if ((size_t)it->instruction.arg2.i64 >= program->instructions_size) {
+    goto generic;  // Let the original instruction report the error.
+  }
+  U7_VM0_THREADED_JUMP_IF(U7_VM0_THREADED_LOCAL(f64, arg1) != 0, arg2);
+
+jump_if_zero_i32_unchecked:
+  U7_VM0_THREADED_JUMP_IF(U7_VM0_THREADED_LOCAL(i32, arg1) == 0, arg2);
+
+jump_if_zero_i64_unchecked:
+  U7_VM0_THREADED_JUMP_IF(U7_VM0_THREADED_LOCAL(i64, arg1) == 0, arg2);
+
+jump_if_zero_f32_unchecked:
+  U7_VM0_THREADED_JUMP_IF(U7_VM0_THREADED_LOCAL(f32, arg1) == 0, arg2);
+
+jump_if_zero_f64_unchecked:
+  U7_VM0_THREADED_JUMP_IF(U7_VM0_THREADED_LOCAL(f64, arg1) == 0, arg2);
+
+jump_if_not_zero_i32_unchecked:
+  U7_VM0_THREADED_JUMP_IF(U7_VM0_THREADED_LOCAL(i32, arg1) != 0, arg2);
+
+jump_if_not_zero_i64_unchecked:
+  U7_VM0_THREADED_JUMP_IF(U7_VM0_THREADED_LOCAL(i64, arg1) != 0, arg2);
+
+jump_if_not_zero_f32_unchecked:
+  U7_VM0_THREADED_JUMP_IF(U7_VM0_THREADED_LOCAL(f32, arg1) != 0, arg2);
+
+jump_if_not_zero_f64_unchecked:
+  U7_VM0_THREADED_JUMP_IF(U7_VM0_THREADED_LOCAL(f64, arg1) != 0, arg2);
+
+jump:
+  if ((size_t)it->instruction.arg1.i64 >= program->instructions_size) {
+    goto generic;  // Let the original instruction report the error.
+  }
+  U7_VM0_THREADED_JUMP_IF(true, arg1);
+
+jump_unchecked:
+  U7_VM0_THREADED_JUMP_IF(true, arg1);
+
+jump_table_i32_unchecked:
+  U7_VM0_THREADED_JUMP_TABLE(i32);
+
+jump_table_i64_unchecked:
+  U7_VM0_THREADED_JUMP_TABLE(i64);
+
+jump_if_equal_i32vc_unchecked:
+  U7_VM0_THREADED_JUMP_IF_COMPARE(i32, ==, it->instruction.arg2.i32);
+
+jump_if_equal_i32vv_unchecked:
+  U7_VM0_THREADED_JUMP_IF_COMPARE(i32, ==, U7_VM0_THREADED_LOCAL(i32, arg2));
+
+jump_if_equal_i64vc_unchecked:
+  U7_VM0_THREADED_JUMP_IF_COMPARE(i64, ==, it->instruction.arg2.i64);
+
+jump_if_equal_i64vv_unchecked:
+  U7_VM0_THREADED_JUMP_IF_COMPARE(i64, ==, U7_VM0_THREADED_LOCAL(i64, arg2));
+
+jump_if_equal_f32vc_unchecked:
+  U7_VM0_THREADED_JUMP_IF_COMPARE(f32, ==, it->instruction.arg2.f32);
+
+jump_if_equal_f32vv_unchecked:
+  U7_VM0_THREADED_JUMP_IF_COMPARE(f32, ==, U7_VM0_THREADED_LOCAL(f32, arg2));
+
+jump_if_equal_f64vc_unchecked:
+  U7_VM0_THREADED_JUMP_IF_COMPARE(f64, ==, it->instruction.arg2.f64);
+
+jump_if_equal_f64vv_unchecked:
+  U7_VM0_THREADED_JUMP_IF_COMPARE(f64, ==, U7_VM0_THREADED_LOCAL(f64, arg2));
+
+jump_if_not_equal_i32vc_unchecked:
+  U7_VM0_THREADED_JUMP_IF_COMPARE(i32, !=, it->instruction.arg2.i32);
+
+jump_if_not_equal_i32vv_unchecked:
+  U7_VM0_THREADED_JUMP_IF_COMPARE(i32, !=, U7_VM0_THREADED_LOCAL(i32, arg2));
+
+jump_if_not_equal_i64vc_unchecked:
+  U7_VM0_THREADED_JUMP_IF_COMPARE(i64, !=, it->instruction.arg2.i64);
+
+jump_if_not_equal_i64vv_unchecked:
+  U7_VM0_THREADED_JUMP_IF_COMPARE(i64, !=, U7_VM0_THREADED_LOCAL(i64, arg2));
+
+jump_if_not_equal_f32vc_unchecked:
+  U7_VM0_THREADED_JUMP_IF_COMPARE(f32, !=, it->instruction.arg2.f32);
+
+jump_if_not_equal_f32vv_unchecked:
+  U7_VM0_THREADED_JUMP_IF_COMPARE(f32, !=, U7_VM0_THREADED_LOCAL(f32, arg2));
+
+jump_if_not_equal_f64vc_unchecked:
+  U7_VM0_THREADED_JUMP_IF_COMPARE(f64, !=, it->instruction.arg2.f64);
+
+jump_if_not_equal_f64vv_unchecked:
+  U7_VM0_THREADED_JUMP_IF_COMPARE(f64, !=, U7_VM0_THREADED_LOCAL(f64, arg2));
+
+jump_if_less_i32vc_unchecked:
+  U7_VM0_THREADED_JUMP_IF_COMPARE(i32, <, it->instruction.arg2.i32);
+
+jump_if_less_i32vv_unchecked:
+  U7_VM0_THREADED_JUMP_IF_COMPARE(i32, <, U7_VM0_THREADED_LOCAL(i32, arg2));
+
+jump_if_less_i64vc_unchecked:
+  U7_VM0_THREADED_JUMP_IF_COMPARE(i64, <, it->instruction.arg2.i64);
+
+jump_if_less_i64vv_unchecked:
+  U7_VM0_THREADED_JUMP_IF_COMPARE(i64, <, U7_VM0_THREADED_LOCAL(i64, arg2));
+
+jump_if_less_f32vc_unchecked:
+  U7_VM0_THREADED_JUMP_IF_COMPARE(f32, <, it->instruction.arg2.f32);
+
+jump_if_less_f32vv_unchecked:
+  U7_VM0_THREADED_JUMP_IF_COMPARE(f32, <, U7_VM0_THREADED_LOCAL(f32, arg2));
+
+jump_if_less_f64vc_unchecked:
+  U7_VM0_THREADED_JUMP_IF_COMPARE(f64, <, it->instruction.arg2.f64);
+
+jump_if_less_f64vv_unchecked:
+  U7_VM0_THREADED_JUMP_IF_COMPARE(f64, <, U7_VM0_THREADED_LOCAL(f64, arg2));
+
+jump_if_less_or_equal_i32vc_unchecked:
+  U7_VM0_THREADED_JUMP_IF_COMPARE(i32, <=, it->instruction.arg2.i32);
+
+jump_if_less_or_equal_i32vv_unchecked:
+  U7_VM0_THREADED_JUMP_IF_COMPARE(i32, <=, U7_VM0_THREADED_LOCAL(i32, arg2));
+
+jump_if_less_or_equal_i64vc_unchecked:
+  U7_VM0_THREADED_JUMP_IF_COMPARE(i64, <=, it->instruction.arg2.i64);
+
+jump_if_less_or_equal_i64vv_unchecked:
+  U7_VM0_THREADED_JUMP_IF_COMPARE(i64, <=, U7_VM0_THREADED_LOCAL(i64, arg2));
+
+jump_if_less_or_equal_f32vc_unchecked:
+  U7_VM0_THREADED_JUMP_IF_COMPARE(f32, <=, it->instruction.arg2.f32);
+
+jump_if_less_or_equal_f32vv_unchecked:
+  U7_VM0_THREADED_JUMP_IF_COMPARE(f32, <=, U7_VM0_THREADED_LOCAL(f32, arg2));
+
+jump_if_less_or_equal_f64vc_unchecked:
+  U7_VM0_THREADED_JUMP_IF_COMPARE(f64, <=, it->instruction.arg2.f64);
+
+jump_if_less_or_equal_f64vv_unchecked:
+  U7_VM0_THREADED_JUMP_IF_COMPARE(f64, <=, U7_VM0_THREADED_LOCAL(f64, arg2));
+
+jump_if_greater_i32vc_unchecked:
+  U7_VM0_THREADED_JUMP_IF_COMPARE(i32, >, it->instruction.arg2.i32);
+
+jump_if_greater_i64vc_unchecked:
+  U7_VM0_THREADED_JUMP_IF_COMPARE(i64, >, it->instruction.arg2.i64);
+
+jump_if_greater_f32vc_unchecked:
+  U7_VM0_THREADED_JUMP_IF_COMPARE(f32, >, it->instruction.arg2.f32);
+
+jump_if_greater_f64vc_unchecked:
+  U7_VM0_THREADED_JUMP_IF_COMPARE(f64, >, it->instruction.arg2.f64);
+
+jump_if_greater_or_equal_i32vc_unchecked:
+  U7_VM0_THREADED_JUMP_IF_COMPARE(i32, >=, it->instruction.arg2.i32);
+
+jump_if_greater_or_equal_i64vc_unchecked:
+  U7_VM0_THREADED_JUMP_IF_COMPARE(i64, >=, it->instruction.arg2.i64);
+
+jump_if_greater_or_equal_f32vc_unchecked:
+  U7_VM0_THREADED_JUMP_IF_COMPARE(f32, >=, it->instruction.arg2.f32);
+
+jump_if_greater_or_equal_f64vc_unchecked:
+  U7_VM0_THREADED_JUMP_IF_COMPARE(f64, >=, it->instruction.arg2.f64);
+
+bitwise_and_jump_if_zero_i64vc:
+  {
+    const int64_t result =
+        U7_VM0_THREADED_PAIR_LOCAL(i64, arg1, second) &
+        it->instruction.arg2.i64;
+    U7_VM0_THREADED_PAIR_LOCAL(i64, arg1, first) = result;
+    U7_VM0_THREADED_JUMP_IF(result == 0, arg3);
+  }
+
+bitwise_and_jump_if_not_zero_i64vc:
+  {
+    const int64_t result =
+        U7_VM0_THREADED_PAIR_LOCAL(i64, arg1, second) &
+        it->instruction.arg2.i64;
+    U7_VM0_THREADED_PAIR_LOCAL(i64, arg1, first) = result;
+    U7_VM0_THREADED_JUMP_IF(result != 0, arg3);
+  }
+
+bitwise_right_shift_jump_if_not_zero_i64vc:
+  {
+    const int64_t result =
+        U7_VM0_THREADED_PAIR_LOCAL(i64, arg1, second) >>
+        it->instruction.arg2.i64;
+    U7_VM0_THREADED_PAIR_LOCAL(i64, arg1, first) = result;
+    U7_VM0_THREADED_JUMP_IF(result != 0, arg3);
+  }
+
+math_add_2_f64vv:
+  U7_VM0_THREADED_PAIR_LOCAL(f64, arg1, first) =
+      U7_VM0_THREADED_PAIR_LOCAL(f64, arg2, first) +
+      U7_VM0_THREADED_PAIR_LOCAL(f64, arg2, second);
+  U7_VM0_THREADED_PAIR_LOCAL(f64, arg1, second) =
+      U7_VM0_THREADED_PAIR_LOCAL(f64, arg3, first) +
+      U7_VM0_THREADED_PAIR_LOCAL(f64, arg3, second);
+  U7_VM0_THREADED_NEXT();
+
+math_multiply_2_f64vv:
+  U7_VM0_THREADED_PAIR_LOCAL(f64, arg1, first) =
+      U7_VM0_THREADED_PAIR_LOCAL(f64, arg2, first) *
+      U7_VM0_THREADED_PAIR_LOCAL(f64, arg2, second);
+  U7_VM0_THREADED_PAIR_LOCAL(f64, arg1, second) =
+      U7_VM0_THREADED_PAIR_LOCAL(f64, arg3, first) *
+      U7_VM0_THREADED_PAIR_LOCAL(f64, arg3, second);
+  U7_VM0_THREADED_NEXT();
+
+math_multiply_add_f64vvv:
+  U7_VM0_THREADED_PAIR_LOCAL(f64, arg1, first) =
+      U7_VM0_THREADED_PAIR_LOCAL(f64, arg2, first) *
+      U7_VM0_THREADED_PAIR_LOCAL(f64, arg2, second);
+  U7_VM0_THREADED_PAIR_LOCAL(f64, arg1, second) =
+      U7_VM0_THREADED_PAIR_LOCAL(f64, arg1, first) +
+      U7_VM0_THREADED_LOCAL(f64, arg3);
+  U7_VM0_THREADED_NEXT();
+}
+
+u7_error u7_vm0_threaded_program_init(
+    struct u7_vm0_threaded_program* self,
+    struct u7_vm0_instruction const* instructions, size_t instructions_size) {
+  void const* const* handlers = NULL;
+  u7_vm0_threaded_execute(NULL, NULL, &handlers);
+  self->instructions =
+      malloc(instructions_size * sizeof(struct u7_vm0_threaded_instruction));
+  if (self->instructions == NULL) {
+    return u7_errnof(ENOMEM, "u7_vm0_threaded_program_init: out of memory");
+  }
+  self->instructions_size = instructions_size;
+  for (size_t i = 0; i < instructions_size; ++i) {
+    const enum u7_vm0_opcode opcode =
+        u7_vm0_instruction_opcode(&instructions[i]);
+    if (opcode == U7_VM0_OPCODE_UNKNOWN || handlers[opcode] == NULL) {
+      self->instructions[i].handler = handlers[U7_VM0_OPCODE_COUNT];
+    } else {
+      self->instructions[i].handler = handlers[opcode];
+    }
+    self->instructions[i].instruction = instructions[i];
+  }
+  return u7_ok();
+}
+
+void u7_vm0_threaded_program_destroy(struct u7_vm0_threaded_program* self) {
+  free(self->instructions);
+  self->instructions = NULL;
+  self->instructions_size = 0;
+}
+
+void u7_vm0_threaded_run(struct u7_vm0_threaded_program const* program,
+                         struct u7_vm_state* state) {
+  u7_vm0_threaded_execute(program, state, NULL);
+}
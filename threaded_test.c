@@ -0,0 +1,161 @@
+#include "@/public/threaded.h"
+
+#include "@/public/assembler.h"
+#include "@/public/fuse.h"
+#include "@/public/program.h"
+#include "@/testing.h"
+
+#include <github.com/apronchenkov/error/public/error.h>
+#include <github.com/apronchenkov/vm/public/state.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+// Tests for u7_vm0_threaded_run(): the threaded programs write the same
+// values and fail in the same way as the regular dispatch loop.
+
+static void run_threaded(void const* engine, struct u7_vm_state* state) {
+  u7_vm0_threaded_run((struct u7_vm0_threaded_program const*)engine, state);
+}
+
+// Runs the program (fused with u7_vm0_fuse() if `fuse`) for every input.
+static u7_error check_threaded(const char* name, const char* text, bool fuse,
+                               int64_t const* inputs, size_t inputs_size) {
+  struct u7_vm0_program program;
+  u7_error error = u7_vm0_assemble(&program, text, strlen(text));
+  if (error.error_code != 0) {
+    return error;
+  }
+  if (fuse) {
+    error = u7_vm0_fuse(program.instructions, &program.instructions_size);
+    if (error.error_code != 0) {
+      u7_vm0_program_destroy(&program);
+      return error;
+    }
+  }
+  struct u7_vm0_threaded_program threaded;
+  error = u7_vm0_threaded_program_init(&threaded, program.instructions,
+                                       program.instructions_size);
+  if (error.error_code != 0) {
+    u7_vm0_program_destroy(&program);
+    return error;
+  }
+  for (size_t i = 0; i < inputs_size && error.error_code == 0; ++i) {
+    error = u7_vm0_test_check_engine(name, &program, &run_threaded,
+                                     &threaded, &inputs[i], 1);
+  }
+  u7_vm0_threaded_program_destroy(&threaded);
+  u7_vm0_program_destroy(&program);
+  return error;
+}
+
+static const char sum_text[] =
+    "i64 n, i, s\n"
+    "read n\n"
+    "i = 0\n"
+    "s = 0\n"
+    "jz n, done\n"
+    "loop: i = i + 1\n"
+    "s = s + i\n"
+    "if i < n goto loop\n"
+    "done: write s\n"
+    "ret\n";
+
+static u7_error test_loop() {
+  int64_t const inputs[] = {0, 1, 10, 1000};
+  return check_threaded("loop", sum_text, false, inputs,
+                        sizeof(inputs) / sizeof(inputs[0]));
+}
+
+static u7_error test_fused() {
+  static const char text[] =
+      "i64 n, t, c\n"
+      "read n\n"
+      "c = 0\n"
+      "loop: t = n & 1\n"
+      "jz t, even\n"
+      "c = c + 1\n"
+      "even: n = n >> 1\n"
+      "jnz n, loop\n"
+      "write c\n"
+      "ret\n";
+  int64_t const inputs[] = {0, 1, 255, 0x5555, INT64_MAX};
+  return check_threaded("fused", text, true, inputs,
+                        sizeof(inputs) / sizeof(inputs[0]));
+}
+
+static u7_error test_jump_table() {
+  static const char text[] =
+      "i32 s\n"
+      "i64 r\n"
+      "read r\n"
+      "s = 2\n"
+      "jz r, dispatch\n"
+      "s = 0\n"
+      "dispatch: switch s, other, zero, one, two\n"
+      "other: write -1\n"
+      "ret\n"
+      "zero: write 10\n"
+      "ret\n"
+      "one: write 11\n"
+      "ret\n"
+      "two: write 12\n"
+      "ret\n";
+  int64_t const inputs[] = {0, 1};
+  return check_threaded("jump_table", text, false, inputs,
+                        sizeof(inputs) / sizeof(inputs[0]));
+}
+
+// Resuming after `yield` continues from the next instruction.
+static u7_error test_yield() {
+  static const char text[] =
+      "i64 n\n"
+      "read n\n"
+      "write n\n"
+      "yield\n"
+      "n = n * 2\n"
+      "write n\n"
+      "yield\n"
+      "write 7\n"
+      "ret\n";
+  int64_t const inputs[] = {-3, 21};
+  return check_threaded("yield", text, false, inputs,
+                        sizeof(inputs) / sizeof(inputs[0]));
+}
+
+// An overflow stops the program with the same error as the dispatch loop,
+// after the values written before it.
+static u7_error test_overflow() {
+  static const char text[] =
+      "i64 n\n"
+      "read n\n"
+      "write n\n"
+      "n = n * n\n"
+      "write n\n"
+      "ret\n";
+  int64_t const inputs[] = {3, INT64_C(1) << 40};
+  return check_threaded("overflow", text, false, inputs,
+                        sizeof(inputs) / sizeof(inputs[0]));
+}
+
+// A read past the end of the input fails with ENODATA.
+static u7_error test_end_of_input() {
+  static const char text[] =
+      "i64 a, b\n"
+      "read a\n"
+      "write a\n"
+      "read b\n"
+      "write b\n"
+      "ret\n";
+  int64_t const inputs[] = {5};
+  return check_threaded("end_of_input", text, false, inputs,
+                        sizeof(inputs) / sizeof(inputs[0]));
+}
+
+int main() {
+  u7_error (*const tests[])() = {
+      &test_loop,     &test_fused,    &test_jump_table,
+      &test_yield,    &test_overflow, &test_end_of_input,
+  };
+  return u7_vm0_test_main(tests, sizeof(tests) / sizeof(tests[0]));
+}
@@ -0,0 +1,347 @@
+#include "@/public/vector.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+#include <pthread.h>
+#define U7_VM0_VECTOR_X86_64 1
+#endif
+
+// Hides the value from the optimizer, so that a product passed through it is
+// rounded before being added: the compiler may not fuse the two into a
+// multiply-add, whatever the instruction set it targets.
+#ifdef U7_VM0_VECTOR_X86_64
+#define U7_VM0_VECTOR_ROUND(value) __asm__("" : "+x"(value))
+#else
+#define U7_VM0_VECTOR_ROUND(value) __asm__("" : "+m"(value))
+#endif
+
+// Number of the partial sums of a reduction (a 32-byte register).
+enum {
+  U7_VM0_VECTOR_LANES_F32 = 8,
+  U7_VM0_VECTOR_LANES_F64 = 4,
+};
+
+static float u7_vm0_vector_reduce_f32(float const* p) {
+  return ((p[0] + p[1]) + (p[2] + p[3])) + ((p[4] + p[5]) + (p[6] + p[7]));
+}
+
+static double u7_vm0_vector_reduce_f64(double const* p) {
+  return (p[0] + p[1]) + (p[2] + p[3]);
+}
+
+// Scalar code, for the elements [k, n).
+#define U7_VM0_VECTOR_DEFINE_TAILS(suffix, type, lanes)                  \
+  static void u7_vm0_vector_add_##suffix##_tail(                         \
+      type* dst, type const* lhs, type const* rhs, size_t k, size_t n) { \
+    for (; k < n; ++k) {                                                 \
+      dst[k] = lhs[k] + rhs[k];                                          \
+    }                                                                    \
+  }                                                                      \
+  static void u7_vm0_vector_multiply_##suffix##_tail(                    \
+      type* dst, type const* lhs, type const* rhs, size_t k, size_t n) { \
+    for (; k < n; ++k) {                                                 \
+      dst[k] = lhs[k] * rhs[k];                                          \
+    }                                                                    \
+  }                                                                      \
+  static void u7_vm0_vector_multiply_add_##suffix##_tail(                \
+      type* dst, type const* lhs, type const* rhs, size_t k, size_t n) { \
+    for (; k < n; ++k) {                                                 \
+      type product = lhs[k] * rhs[k];                                    \
+      U7_VM0_VECTOR_ROUND(product);                                      \
+      dst[k] += product;                                                 \
+    }                                                                    \
+  }                                                                      \
+  static void u7_vm0_vector_dot_##suffix##_tail(                         \
+      type* partial, type const* lhs, type const* rhs, size_t k,         \
+      size_t n) {                                                        \
+    for (; k < n; ++k) {                                                 \
+      type product = lhs[k] * rhs[k];                                    \
+      U7_VM0_VECTOR_ROUND(product);                                      \
+      partial[k % lanes] += product;                                     \
+    }                                                                    \
+  }                                                                      \
+  static void u7_vm0_vector_sum_##suffix##_tail(                         \
+      type* partial, type const* src, size_t k, size_t n) {              \
+    for (; k < n; ++k) {                                                 \
+      partial[k % lanes] += src[k];                                      \
+    }                                                                    \
+  }                                                                      \
+  static void u7_vm0_vector_broadcast_##suffix##_tail(                   \
+      type* dst, type value, size_t k, size_t n) {                       \
+    for (; k < n; ++k) {                                                 \
+      dst[k] = value;                                                    \
+    }                                                                    \
+  }
+
+U7_VM0_VECTOR_DEFINE_TAILS(f32, float, U7_VM0_VECTOR_LANES_F32)
+U7_VM0_VECTOR_DEFINE_TAILS(f64, double, U7_VM0_VECTOR_LANES_F64)
+
+#ifdef U7_VM0_VECTOR_X86_64
+
+// The kernels for an instruction set; a reduction keeps its partial sums in
+// 32 bytes of registers, i.e. one AVX or two SSE accumulators.
+#define U7_VM0_VECTOR_DEFINE_KERNELS(isa, suffix, type, lanes, vtype, load, \
+                                     store, set1, add, multiply)            \
+  __attribute__((target(#isa))) static void                                 \
+      u7_vm0_vector_add_##suffix##_##isa(type* dst, type const* lhs,        \
+                                         type const* rhs, size_t n) {       \
+    enum { kWidth = sizeof(vtype) / sizeof(type) };                         \
+    size_t k = 0;                                                           \
+    for (; k + kWidth <= n; k += kWidth) {                                  \
+      store(dst + k, add(load(lhs + k), load(rhs + k)));                    \
+    }                                                                       \
+    u7_vm0_vector_add_##suffix##_tail(dst, lhs, rhs, k, n);                 \
+  }                                                                         \
+  __attribute__((target(#isa))) static void                                 \
+      u7_vm0_vector_multiply_##suffix##_##isa(type* dst, type const* lhs,   \
+                                              type const* rhs, size_t n) {  \
+    enum { kWidth = sizeof(vtype) / sizeof(type) };                         \
+    size_t k = 0;                                                           \
+    for (; k + kWidth <= n; k += kWidth) {                                  \
+      store(dst + k, multiply(load(lhs + k), load(rhs + k)));               \
+    }                                                                       \
+    u7_vm0_vector_multiply_##suffix##_tail(dst, lhs, rhs, k, n);            \
+  }                                                                         \
+  __attribute__((target(#isa))) static void                                 \
+      u7_vm0_vector_multiply_add_##suffix##_##isa(                          \
+          type* dst, type const* lhs, type const* rhs, size_t n) {          \
+    enum { kWidth = sizeof(vtype) / sizeof(type) };                         \
+    size_t k = 0;                                                           \
+    for (; k + kWidth <= n; k += kWidth) {                                  \
+      vtype product = multiply(load(lhs + k), load(rhs + k));               \
+      U7_VM0_VECTOR_ROUND(product);                                         \
+      store(dst + k, add(load(dst + k), product));                          \
+    }                                                                       \
+    u7_vm0_vector_multiply_add_##suffix##_tail(dst, lhs, rhs, k, n);        \
+  }                                                                         \
+  __attribute__((target(#isa))) static type                                 \
+      u7_vm0_vector_dot_##suffix##_##isa(type const* lhs, type const* rhs,  \
+                                         size_t n) {                        \
+    enum {                                                                  \
+      kWidth = sizeof(vtype) / sizeof(type),                                \
+      kLanes = lanes,                                                       \
+      kAccumulators = kLanes / kWidth,                                      \
+    };                                                                      \
+    vtype accumulators[kAccumulators];                                      \
+    for (int a = 0; a < kAccumulators; ++a) {                               \
+      accumulators[a] = set1(0);                                            \
+    }                                                                       \
+    size_t k = 0;                                                           \
+    for (; k + kLanes <= n; k += kLanes) {                                  \
+      for (int a = 0; a < kAccumulators; ++a) {                             \
+        vtype product = multiply(load(lhs + k + a * kWidth),                \
+                                 load(rhs + k + a * kWidth));               \
+        U7_VM0_VECTOR_ROUND(product);                                       \
+        accumulators[a] = add(accumulators[a], product);                    \
+      }                                                                     \
+    }                                                                       \
+    type partial[kLanes];                                                   \
+    for (int a = 0; a < kAccumulators; ++a) {                               \
+      store(partial + a * kWidth, accumulators[a]);                         \
+    }                                                                       \
+    u7_vm0_vector_dot_##suffix##_tail(partial, lhs, rhs, k, n);             \
+    return u7_vm0_vector_reduce_##suffix(partial);                          \
+  }                                                                         \
+  __attribute__((target(#isa))) static type                                 \
+      u7_vm0_vector_sum_##suffix##_##isa(type const* src, size_t n) {       \
+    enum {                                                                  \
+      kWidth = sizeof(vtype) / sizeof(type),                                \
+      kLanes = lanes,                                                       \
+      kAccumulators = kLanes / kWidth,                                      \
+    };                                                                      \
+    vtype accumulators[kAccumulators];                                      \
+    for (int a = 0; a < kAccumulators; ++a) {                               \
+      accumulators[a] = set1(0);                                            \
+    }                                                                       \
+    size_t k = 0;                                                           \
+    for (; k + kLanes <= n; k += kLanes) {                                  \
+      for (int a = 0; a < kAccumulators; ++a) {                             \
+        accumulators[a] = add(accumulators[a], load(src + k + a * kWidth)); \
+      }                                                                     \
+    }                                                                       \
+    type partial[kLanes];                                                   \
+    for (int a = 0; a < kAccumulators; ++a) {                               \
+      store(partial + a * kWidth, accumulators[a]);                         \
+    }                                                                       \
+    u7_vm0_vector_sum_##suffix##_tail(partial, src, k, n);                  \
+    return u7_vm0_vector_reduce_##suffix(partial);                          \
+  }                                                                         \
+  __attribute__((target(#isa))) static void                                 \
+      u7_vm0_vector_broadcast_##suffix##_##isa(type* dst, type value,       \
+                                               size_t n) {                  \
+    enum { kWidth = sizeof(vtype) / sizeof(type) };                         \
+    const vtype values = set1(value);                                       \
+    size_t k = 0;                                                           \
+    for (; k + kWidth <= n; k += kWidth) {                                  \
+      store(dst + k, values);                                               \
+    }                                                                       \
+    u7_vm0_vector_broadcast_##suffix##_tail(dst, value, k, n);              \
+  }
+
+U7_VM0_VECTOR_DEFINE_KERNELS(sse2, f32, float,
+                             U7_VM0_VECTOR_LANES_F32, __m128, _mm_loadu_ps,
+                             _mm_storeu_ps, _mm_set1_ps, _mm_add_ps,
+                             _mm_mul_ps)
+U7_VM0_VECTOR_DEFINE_KERNELS(sse2, f64, double,
+                             U7_VM0_VECTOR_LANES_F64, __m128d, _mm_loadu_pd,
+                             _mm_storeu_pd, _mm_set1_pd, _mm_add_pd,
+                             _mm_mul_pd)
+U7_VM0_VECTOR_DEFINE_KERNELS(avx2, f32, float,
+                             U7_VM0_VECTOR_LANES_F32, __m256, _mm256_loadu_ps,
+                             _mm256_storeu_ps, _mm256_set1_ps, _mm256_add_ps,
+                             _mm256_mul_ps)
+U7_VM0_VECTOR_DEFINE_KERNELS(avx2, f64, double,
+                             U7_VM0_VECTOR_LANES_F64, __m256d, _mm256_loadu_pd,
+                             _mm256_storeu_pd, _mm256_set1_pd, _mm256_add_pd,
+                             _mm256_mul_pd)
+
+struct u7_vm0_vector_kernels {
+  void (*add_f32)(float*, float const*, float const*, size_t);
+  void (*add_f64)(double*, double const*, double const*, size_t);
+  void (*multiply_f32)(float*, float const*, float const*, size_t);
+  void (*multiply_f64)(double*, double const*, double const*, size_t);
+  void (*multiply_add_f32)(float*, float const*, float const*, size_t);
+  void (*multiply_add_f64)(double*, double const*, double const*, size_t);
+  float (*dot_f32)(float const*, float const*, size_t);
+  double (*dot_f64)(double const*, double const*, size_t);
+  float (*sum_f32)(float const*, size_t);
+  double (*sum_f64)(double const*, size_t);
+  void (*broadcast_f32)(float*, float, size_t);
+  void (*broadcast_f64)(double*, double, size_t);
+};
+
+#define U7_VM0_VECTOR_KERNELS(isa)                               \
+  {                                                              \
+      .add_f32 = &u7_vm0_vector_add_f32_##isa,                   \
+      .add_f64 = &u7_vm0_vector_add_f64_##isa,                   \
+      .multiply_f32 = &u7_vm0_vector_multiply_f32_##isa,         \
+      .multiply_f64 = &u7_vm0_vector_multiply_f64_##isa,         \
+      .multiply_add_f32 = &u7_vm0_vector_multiply_add_f32_##isa, \
+      .multiply_add_f64 = &u7_vm0_vector_multiply_add_f64_##isa, \
+      .dot_f32 = &u7_vm0_vector_dot_f32_##isa,                   \
+      .dot_f64 = &u7_vm0_vector_dot_f64_##isa,                   \
+      .sum_f32 = &u7_vm0_vector_sum_f32_##isa,                   \
+      .sum_f64 = &u7_vm0_vector_sum_f64_##isa,                   \
+      .broadcast_f32 = &u7_vm0_vector_broadcast_f32_##isa,       \
+      .broadcast_f64 = &u7_vm0_vector_broadcast_f64_##isa,       \
+  }
+
+static const struct u7_vm0_vector_kernels u7_vm0_vector_kernels_sse2 =
+    U7_VM0_VECTOR_KERNELS(sse2);
+static const struct u7_vm0_vector_kernels u7_vm0_vector_kernels_avx2 =
+    U7_VM0_VECTOR_KERNELS(avx2);
+
+// The kernels for the CPU, selected once.
+static struct u7_vm0_vector_kernels const* u7_vm0_vector_kernels;
+static pthread_once_t u7_vm0_vector_kernels_once = PTHREAD_ONCE_INIT;
+
+static void u7_vm0_vector_kernels_init(void) {
+  u7_vm0_vector_kernels = (__builtin_cpu_supports("avx2")
+                               ? &u7_vm0_vector_kernels_avx2
+                               : &u7_vm0_vector_kernels_sse2);
+}
+
+static struct u7_vm0_vector_kernels const* u7_vm0_vector_get_kernels(void) {
+  pthread_once(&u7_vm0_vector_kernels_once, &u7_vm0_vector_kernels_init);
+  return u7_vm0_vector_kernels;
+}
+
+#define U7_VM0_VECTOR_DISPATCH(fn, ...)          \
+  (u7_vm0_vector_get_kernels()->fn(__VA_ARGS__))
+
+#else  // U7_VM0_VECTOR_X86_64
+
+#define U7_VM0_VECTOR_DEFINE_KERNELS(suffix, type, lanes)            \
+  static void u7_vm0_vector_add_##suffix##_scalar(                   \
+      type* dst, type const* lhs, type const* rhs, size_t n) {       \
+    u7_vm0_vector_add_##suffix##_tail(dst, lhs, rhs, 0, n);          \
+  }                                                                  \
+  static void u7_vm0_vector_multiply_##suffix##_scalar(              \
+      type* dst, type const* lhs, type const* rhs, size_t n) {       \
+    u7_vm0_vector_multiply_##suffix##_tail(dst, lhs, rhs, 0, n);     \
+  }                                                                  \
+  static void u7_vm0_vector_multiply_add_##suffix##_scalar(          \
+      type* dst, type const* lhs, type const* rhs, size_t n) {       \
+    u7_vm0_vector_multiply_add_##suffix##_tail(dst, lhs, rhs, 0, n); \
+  }                                                                  \
+  static type u7_vm0_vector_dot_##suffix##_scalar(                   \
+      type const* lhs, type const* rhs, size_t n) {                  \
+    type partial[lanes] = {0};                                       \
+    u7_vm0_vector_dot_##suffix##_tail(partial, lhs, rhs, 0, n);      \
+    return u7_vm0_vector_reduce_##suffix(partial);                   \
+  }                                                                  \
+  static type u7_vm0_vector_sum_##suffix##_scalar(type const* src,   \
+                                                  size_t n) {        \
+    type partial[lanes] = {0};                                       \
+    u7_vm0_vector_sum_##suffix##_tail(partial, src, 0, n);           \
+    return u7_vm0_vector_reduce_##suffix(partial);                   \
+  }                                                                  \
+  static void u7_vm0_vector_broadcast_##suffix##_scalar(             \
+      type* dst, type value, size_t n) {                             \
+    u7_vm0_vector_broadcast_##suffix##_tail(dst, value, 0, n);       \
+  }
+
+U7_VM0_VECTOR_DEFINE_KERNELS(f32, float, U7_VM0_VECTOR_LANES_F32)
+U7_VM0_VECTOR_DEFINE_KERNELS(f64, double, U7_VM0_VECTOR_LANES_F64)
+
+#define U7_VM0_VECTOR_DISPATCH(fn, ...)    \
+  u7_vm0_vector_##fn##_scalar(__VA_ARGS__)
+
+#endif  // U7_VM0_VECTOR_X86_64
+
+void u7_vm0_vector_add_f32(float* dst, float const* lhs, float const* rhs,
+                           size_t n) {
+  U7_VM0_VECTOR_DISPATCH(add_f32, dst, lhs, rhs, n);
+}
+
+void u7_vm0_vector_add_f64(double* dst, double const* lhs, double const* rhs,
+                           size_t n) {
+  U7_VM0_VECTOR_DISPATCH(add_f64, dst, lhs, rhs, n);
+}
+
+void u7_vm0_vector_multiply_f32(float* dst, float const* lhs,
+                                float const* rhs, size_t n) {
+  U7_VM0_VECTOR_DISPATCH(multiply_f32, dst, lhs, rhs, n);
+}
+
+void u7_vm0_vector_multiply_f64(double* dst, double const* lhs,
+                                double const* rhs, size_t n) {
+  U7_VM0_VECTOR_DISPATCH(multiply_f64, dst, lhs, rhs, n);
+}
+
+void u7_vm0_vector_multiply_add_f32(float* dst, float const* lhs,
+                                    float const* rhs, size_t n) {
+  U7_VM0_VECTOR_DISPATCH(multiply_add_f32, dst, lhs, rhs, n);
+}
+
+void u7_vm0_vector_multiply_add_f64(double* dst, double const* lhs,
+                                    double const* rhs, size_t n) {
+  U7_VM0_VECTOR_DISPATCH(multiply_add_f64, dst, lhs, rhs, n);
+}
+
+float u7_vm0_vector_dot_f32(float const* lhs, float const* rhs, size_t n) {
+  return U7_VM0_VECTOR_DISPATCH(dot_f32, lhs, rhs, n);
+}
+
+double u7_vm0_vector_dot_f64(double const* lhs, double const* rhs, size_t n) {
+  return U7_VM0_VECTOR_DISPATCH(dot_f64, lhs, rhs, n);
+}
+
+float u7_vm0_vector_sum_f32(float const* src, size_t n) {
+  return U7_VM0_VECTOR_DISPATCH(sum_f32, src, n);
+}
+
+double u7_vm0_vector_sum_f64(double const* src, size_t n) {
+  return U7_VM0_VECTOR_DISPATCH(sum_f64, src, n);
+}
+
+void u7_vm0_vector_broadcast_f32(float* dst, float value, size_t n) {
+  U7_VM0_VECTOR_DISPATCH(broadcast_f32, dst, value, n);
+}
+
+void u7_vm0_vector_broadcast_f64(double* dst, double value, size_t n) {
+  U7_VM0_VECTOR_DISPATCH(broadcast_f64, dst, value, n);
+}
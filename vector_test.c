@@ -0,0 +1,287 @@
+#include "@/public/vector.h"
+
+#include "@/public/program.h"
+#include "@/public/vm0.h"
+#include "@/testing.h"
+
+#include <errno.h>
+#include <github.com/apronchenkov/error/public/error.h>
+#include <stdint.h>
+#include <string.h>
+
+// Tests for the vector kernels and instructions: every count, including the
+// tails that the SIMD code handles one element at a time, gives bit for bit
+// the results of the scalar definitions in public/vector.h.
+
+enum {
+  TEST_MAX_COUNT = 37,
+  // Elements around the arrays that must stay intact; the arrays start at
+  // an odd element, so they are not aligned.
+  TEST_GUARD = 3,
+  TEST_BUFFER_SIZE = TEST_MAX_COUNT + 2 * TEST_GUARD,
+};
+
+static uint64_t next_random(uint64_t* seed) {
+  *seed = *seed * 6364136223846793005u + 1442695040888963407u;
+  return *seed >> 33;
+}
+
+// Values with many significant bits, so that every rounding matters.
+#define TEST_DEFINE_HELPERS(suffix, type)                                    \
+  static void fill_##suffix(type* values, size_t size, uint64_t seed) {      \
+    for (size_t i = 0; i < size; ++i) {                                      \
+      values[i] = ((type)next_random(&seed) - (type)(1u << 30)) /            \
+                  (type)(1u << 27) / (type)3;                                \
+    }                                                                        \
+  }                                                                          \
+  static type reference_reduce_##suffix(type const* partial, size_t lanes) { \
+    if (lanes == 4) {                                                        \
+      return (partial[0] + partial[1]) + (partial[2] + partial[3]);          \
+    }                                                                        \
+    return ((partial[0] + partial[1]) + (partial[2] + partial[3])) +         \
+           ((partial[4] + partial[5]) + (partial[6] + partial[7]));          \
+  }                                                                          \
+  static type reference_dot_##suffix(type const* lhs, type const* rhs,       \
+                                     size_t n, size_t lanes) {               \
+    type partial[8] = {0};                                                   \
+    for (size_t k = 0; k < n; ++k) {                                         \
+      volatile type product = lhs[k] * rhs[k];                               \
+      partial[k % lanes] += product;                                         \
+    }                                                                        \
+    return reference_reduce_##suffix(partial, lanes);                        \
+  }                                                                          \
+  static type reference_sum_##suffix(type const* src, size_t n,              \
+                                     size_t lanes) {                         \
+    type partial[8] = {0};                                                   \
+    for (size_t k = 0; k < n; ++k) {                                         \
+      partial[k % lanes] += src[k];                                          \
+    }                                                                        \
+    return reference_reduce_##suffix(partial, lanes);                        \
+  }
+
+TEST_DEFINE_HELPERS(f32, float)
+TEST_DEFINE_HELPERS(f64, double)
+
+// Checks the kernels of a type for every count from 0 to TEST_MAX_COUNT,
+// with separate arrays, and with dst coinciding with lhs.
+#define TEST_DEFINE_CHECK_KERNELS(suffix, type, lanes)                        \
+  static u7_error check_kernels_##suffix(size_t n, int aliased) {             \
+    type lhs[TEST_BUFFER_SIZE];                                               \
+    type rhs[TEST_BUFFER_SIZE];                                               \
+    type dst[TEST_BUFFER_SIZE];                                               \
+    type expected[TEST_BUFFER_SIZE];                                          \
+    fill_##suffix(lhs, TEST_BUFFER_SIZE, 1 + n);                              \
+    fill_##suffix(rhs, TEST_BUFFER_SIZE, 1000 + n);                           \
+    type* const a = lhs + TEST_GUARD;                                         \
+    type* const b = rhs + TEST_GUARD;                                         \
+    type* const c = (aliased ? a : dst + TEST_GUARD);                         \
+    type* const c_buffer = (aliased ? lhs : dst);                             \
+    const char* const name = (aliased ? "aliased " #suffix : #suffix);        \
+    for (int op = 0; op < 4; ++op) {                                          \
+      fill_##suffix(dst, TEST_BUFFER_SIZE, 2000 + n);                         \
+      if (aliased) {                                                          \
+        fill_##suffix(lhs, TEST_BUFFER_SIZE, 1 + n);                          \
+      }                                                                       \
+      memcpy(expected, c_buffer, sizeof(expected));                           \
+      type* const e = expected + TEST_GUARD;                                  \
+      const char* op_name = "";                                               \
+      for (size_t k = 0; k < n; ++k) {                                        \
+        volatile type product = a[k] * b[k];                                  \
+        switch (op) {                                                         \
+          case 0:                                                             \
+            e[k] = a[k] + b[k];                                               \
+            break;                                                            \
+          case 1:                                                             \
+            e[k] = product;                                                   \
+            break;                                                            \
+          case 2:                                                             \
+            e[k] = c[k] + product;                                            \
+            break;                                                            \
+          default:                                                            \
+            e[k] = (type)0.75;                                                \
+            break;                                                            \
+        }                                                                     \
+      }                                                                       \
+      switch (op) {                                                           \
+        case 0:                                                               \
+          op_name = "add";                                                    \
+          u7_vm0_vector_add_##suffix(c, a, b, n);                             \
+          break;                                                              \
+        case 1:                                                               \
+          op_name = "multiply";                                               \
+          u7_vm0_vector_multiply_##suffix(c, a, b, n);                        \
+          break;                                                              \
+        case 2:                                                               \
+          op_name = "multiply_add";                                           \
+          u7_vm0_vector_multiply_add_##suffix(c, a, b, n);                    \
+          break;                                                              \
+        default:                                                              \
+          op_name = "broadcast";                                              \
+          u7_vm0_vector_broadcast_##suffix(c, (type)0.75, n);                 \
+          break;                                                              \
+      }                                                                       \
+      if (memcmp(expected, c_buffer, sizeof(expected)) != 0) {                \
+        return u7_errnof(EINVAL, "%s %s: n=%zu: unexpected result", name,     \
+                         op_name, n);                                         \
+      }                                                                       \
+    }                                                                         \
+    fill_##suffix(lhs, TEST_BUFFER_SIZE, 1 + n);                              \
+    const type dot = u7_vm0_vector_dot_##suffix(a, b, n);                     \
+    const type expected_dot = reference_dot_##suffix(a, b, n, lanes);         \
+    const type sum = u7_vm0_vector_sum_##suffix(a, n);                        \
+    const type expected_sum = reference_sum_##suffix(a, n, lanes);            \
+    if (memcmp(&dot, &expected_dot, sizeof(type)) != 0) {                     \
+      return u7_errnof(EINVAL, "%s dot: n=%zu: %.17g instead of %.17g", name, \
+                       n, (double)dot, (double)expected_dot);                 \
+    }                                                                         \
+    if (memcmp(&sum, &expected_sum, sizeof(type)) != 0) {                     \
+      return u7_errnof(EINVAL, "%s sum: n=%zu: %.17g instead of %.17g", name, \
+                       n, (double)sum, (double)expected_sum);                 \
+    }                                                                         \
+    return u7_ok();                                                           \
+  }
+
+TEST_DEFINE_CHECK_KERNELS(f32, float, 8)
+TEST_DEFINE_CHECK_KERNELS(f64, double, 4)
+
+static u7_error test_kernels() {
+  for (size_t n = 0; n <= TEST_MAX_COUNT; ++n) {
+    for (int aliased = 0; aliased < 2; ++aliased) {
+      u7_error error = check_kernels_f32(n, aliased);
+      if (error.error_code == 0) {
+        error = check_kernels_f64(n, aliased);
+      }
+      if (error.error_code != 0) {
+        return error;
+      }
+    }
+  }
+  return u7_ok();
+}
+
+static struct u7_vm0_arg f64_variable(int64_t index) {
+  return (struct u7_vm0_arg){.kind = U7_VM0_ARG_KIND_F64_VARIABLE,
+                             .value.i64 = index * (int64_t)sizeof(double)};
+}
+
+static struct u7_vm0_arg f32_variable(int64_t index) {
+  return (struct u7_vm0_arg){.kind = U7_VM0_ARG_KIND_F32_VARIABLE,
+                             .value.i64 = index * (int64_t)sizeof(float)};
+}
+
+// The instructions address the arrays by the offsets of their first
+// variables: a[5] + b[5], a . b, sum(a), and a broadcast of the sum.
+static u7_error test_instructions() {
+  static const struct u7_vm_stack_frame_layout frame_layout = {
+      .locals_size = 16 * sizeof(double),
+      .description = "vector_test",
+  };
+  const struct u7_vm0_arg a = f64_variable(0);
+  const struct u7_vm0_arg b = f64_variable(5);
+  const struct u7_vm0_arg s = f64_variable(10);
+  const struct u7_vm0_arg d = f64_variable(15);
+  u7_error error = u7_ok();
+  const struct u7_vm0_instruction instructions[] = {
+      u7_vm0_input_n(&error, a, 10),
+      u7_vm0_vector_add(&error, s, a, b, 5),
+      u7_vm0_output_n(&error, s, 5),
+      u7_vm0_vector_dot(&error, d, a, b, 5),
+      u7_vm0_output(&error, d),
+      u7_vm0_vector_sum(&error, d, a, 5),
+      u7_vm0_output(&error, d),
+      u7_vm0_vector_broadcast(&error, s, d, 5),
+      u7_vm0_output_n(&error, s, 5),
+      u7_vm0_ret(),
+  };
+  if (error.error_code != 0) {
+    return error;
+  }
+  struct u7_vm0_program program;
+  error = u7_vm0_test_program_init(
+      &program, instructions, sizeof(instructions) / sizeof(instructions[0]),
+      &frame_layout);
+  if (error.error_code != 0) {
+    return error;
+  }
+  double values[10];
+  fill_f64(values, 10, 7);
+  double expected[12];
+  for (int k = 0; k < 5; ++k) {
+    expected[k] = values[k] + values[5 + k];
+  }
+  expected[5] = reference_dot_f64(values, values + 5, 5, 4);
+  expected[6] = reference_sum_f64(values, 5, 4);
+  for (int k = 0; k < 5; ++k) {
+    expected[7 + k] = expected[6];
+  }
+  int64_t input[10];
+  memcpy(input, values, sizeof(input));
+  int64_t output[12];
+  size_t output_size = 12;
+  error = u7_vm0_test_run(&program, program.js, input, 10, output,
+                          &output_size);
+  u7_vm0_program_destroy(&program);
+  if (error.error_code == 0 &&
+      (output_size != 12 || memcmp(output, expected, sizeof(output)) != 0)) {
+    error = u7_errnof(EINVAL, "instructions: unexpected output");
+  }
+  return error;
+}
+
+static u7_error test_invalid_arguments() {
+  const struct u7_vm0_arg i64_variable = {
+      .kind = U7_VM0_ARG_KIND_I64_VARIABLE, .value.i64 = 0};
+  struct {
+    const char* name;
+    struct u7_vm0_arg dst;
+    struct u7_vm0_arg lhs;
+    struct u7_vm0_arg rhs;
+    int64_t count;
+  } const cases[] = {
+      // dst[0..4) and lhs[2..6) partially overlap.
+      {"partial overlap", f64_variable(0), f64_variable(2), f64_variable(8),
+       4},
+      {"partial overlap of f32", f32_variable(4), f32_variable(8),
+       f32_variable(4), 5},
+      {"negative count", f64_variable(0), f64_variable(0), f64_variable(8),
+       -1},
+      {"i64 dst", i64_variable, f64_variable(0), f64_variable(8), 4},
+      {"mixed types", f64_variable(0), f32_variable(16), f64_variable(8), 4},
+  };
+  for (size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); ++i) {
+    u7_error error = u7_ok();
+    u7_vm0_vector_add(&error, cases[i].dst, cases[i].lhs, cases[i].rhs,
+                      cases[i].count);
+    error = u7_vm0_test_expect_error(cases[i].name, error, EINVAL);
+    if (error.error_code != 0) {
+      return error;
+    }
+  }
+  // Adjacent arrays and a reduction into an element of the sources are
+  // accepted.
+  u7_error error = u7_ok();
+  u7_vm0_vector_multiply_add(&error, f64_variable(0), f64_variable(4),
+                             f64_variable(0), 4);
+  u7_vm0_vector_dot(&error, f64_variable(2), f64_variable(0),
+                    f64_variable(1), 4);
+  if (error.error_code != 0) {
+    return error;
+  }
+  u7_vm0_vector_sum(&error, f64_variable(0), f32_variable(0), 4);
+  error = u7_vm0_test_expect_error("sum of mixed types", error, EINVAL);
+  if (error.error_code != 0) {
+    return error;
+  }
+  u7_vm0_vector_broadcast(&error, f32_variable(0), f32_variable(0), -2);
+  return u7_vm0_test_expect_error("broadcast with a negative count", error,
+                                  EINVAL);
+}
+
+int main() {
+  u7_error (*const tests[])() = {
+      &test_kernels,
+      &test_instructions,
+      &test_invalid_arguments,
+  };
+  return u7_vm0_test_main(tests, sizeof(tests) / sizeof(tests[0]));
+}
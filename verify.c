@@ -0,0 +1,383 @@
+#include "@/public/verify.h"
+
+#include "@/public/opcode.h"
+
+#include <assert.h>
+#include <errno.h>
+#include <github.com/apronchenkov/error/public/error.h>
+#include <inttypes.h>
+#include <stdlib.h>
+
+static enum u7_vm0_opcode u7_vm0_unchecked_opcode(enum u7_vm0_opcode opcode) {
+  switch (opcode) {
+    case U7_VM0_OPCODE_JUMP_IF_ZERO_I32:
+      return U7_VM0_OPCODE_JUMP_IF_ZERO_I32_UNCHECKED;
+    case U7_VM0_OPCODE_JUMP_IF_ZERO_I64:
+      return U7_VM0_OPCODE_JUMP_IF_ZERO_I64_UNCHECKED;
+    case U7_VM0_OPCODE_JUMP_IF_ZERO_F32:
+      return U7_VM0_OPCODE_JUMP_IF_ZERO_F32_UNCHECKED;
+    case U7_VM0_OPCODE_JUMP_IF_ZERO_F64:
+      return U7_VM0_OPCODE_JUMP_IF_ZERO_F64_UNCHECKED;
+    case U7_VM0_OPCODE_JUMP_IF_NOT_ZERO_I32:
+      return U7_VM0_OPCODE_JUMP_IF_NOT_ZERO_I32_UNCHECKED;
+    case U7_VM0_OPCODE_JUMP_IF_NOT_ZERO_I64:
+      return U7_VM0_OPCODE_JUMP_IF_NOT_ZERO_I64_UNCHECKED;
+    case U7_VM0_OPCODE_JUMP_IF_NOT_ZERO_F32:
+      return U7_VM0_OPCODE_JUMP_IF_NOT_ZERO_F32_UNCHECKED;
+    case U7_VM0_OPCODE_JUMP_IF_NOT_ZERO_F64:
+      return U7_VM0_OPCODE_JUMP_IF_NOT_ZERO_F64_UNCHECKED;
+    case U7_VM0_OPCODE_JUMP:
+      return U7_VM0_OPCODE_JUMP_UNCHECKED;
+    case U7_VM0_OPCODE_JUMP_TABLE_I32:
+      return U7_VM0_OPCODE_JUMP_TABLE_I32_UNCHECKED;
+    case U7_VM0_OPCODE_JUMP_TABLE_I64:
+      return U7_VM0_OPCODE_JUMP_TABLE_I64_UNCHECKED;
+    default:
+      // The unchecked compare-and-branch variants are listed in the same
+      // order as the checked ones.
+      if (opcode >= U7_VM0_OPCODE_JUMP_IF_EQUAL_I32VC &&
+          opcode <= U7_VM0_OPCODE_JUMP_IF_GREATER_OR_EQUAL_F64VC) {
+        return (enum u7_vm0_opcode)(
+            opcode - U7_VM0_OPCODE_JUMP_IF_EQUAL_I32VC +
+            U7_VM0_OPCODE_JUMP_IF_EQUAL_I32VC_UNCHECKED);
+      }
+      return opcode;
+  }
+}
+
+static u7_error u7_vm0_verify_variable(
+    size_t index, struct u7_vm0_opcode_info const* info, int operand_index,
+    int64_t offset, int64_t size, int64_t count, size_t locals_size) {
+  if (offset < 0 || count < 0 || (uint64_t)count > locals_size / size ||
+      (uint64_t)offset + (uint64_t)(size * count) > locals_size) {
+    return u7_errnof(ERANGE,
+                     "u7_vm0_verify: instruction %zu: %s: arg%d: variable "
+                     "is out of the locals frame: offset=%" PRId64,
+                     index, info->name, operand_index + 1, offset);
+  }
+  if (offset % size != 0) {
+    return u7_errnof(EINVAL,
+                     "u7_vm0_verify: instruction %zu: %s: arg%d: variable "
+                     "is misaligned: offset=%" PRId64,
+                     index, info->name, operand_index + 1, offset);
+  }
+  return u7_ok();
+}
+
+// Verifies the source arrays of a vector instruction; if the destination is
+// an array too, each of them must either coincide with it or not overlap it.
+static u7_error u7_vm0_verify_array_pair(
+    size_t index, struct u7_vm0_opcode_info const* info, int operand_index,
+    union u7_vm0_value const args[3], size_t locals_size) {
+  const enum u7_vm0_operand_kind kind = info->operand_kinds[operand_index];
+  const int64_t size = u7_vm0_operand_kind_variable_size(kind);
+  const int count_index = u7_vm0_opcode_info_count_index(info);
+  assert(count_index >= 0);
+  const int64_t count = args[count_index].i64;
+  const int64_t offsets[2] = {
+      u7_vm0_operand_pair_first(args[operand_index].i64),
+      u7_vm0_operand_pair_second(args[operand_index].i64),
+  };
+  for (int i = 0; i < 2; ++i) {
+    u7_error error =
+        u7_vm0_verify_variable(index, info, operand_index, offsets[i], size,
+                               count, locals_size);
+    if (error.error_code != 0) {
+      return error;
+    }
+    // Both arrays are within the locals frame, so there is no overflow.
+    const int64_t dst = args[0].i64;
+    if (u7_vm0_operand_kind_is_array(info->operand_kinds[0]) &&
+        offsets[i] != dst && offsets[i] < dst + size * count &&
+        dst < offsets[i] + size * count) {
+      return u7_errnof(EINVAL,
+                       "u7_vm0_verify: instruction %zu: %s: arg%d: source "
+                       "array partially overlaps the destination: "
+                       "offset=%" PRId64,
+                       index, info->name, operand_index + 1, offsets[i]);
+    }
+  }
+  return u7_ok();
+}
+
+static u7_error u7_vm0_verify_operand(
+    size_t index, struct u7_vm0_opcode_info const* info, int operand_index,
+    union u7_vm0_value const args[3], size_t instructions_size,
+    size_t locals_size) {
+  const enum u7_vm0_operand_kind kind = info->operand_kinds[operand_index];
+  const union u7_vm0_value value = args[operand_index];
+  if (kind == U7_VM0_OPERAND_LABEL) {
+    if (value.i64 < 0 || (uint64_t)value.i64 >= instructions_size) {
+      return u7_errnof(ERANGE,
+                       "u7_vm0_verify: instruction %zu: %s: arg%d: label is "
+                       "out of range: %" PRId64,
+                       index, info->name, operand_index + 1, value.i64);
+    }
+    return u7_ok();
+  }
+  if (kind == U7_VM0_OPERAND_COUNT) {
+    if (value.i64 < 0) {
+      return u7_errnof(EINVAL,
+                       "u7_vm0_verify: instruction %zu: %s: arg%d: count is "
+                       "negative: %" PRId64,
+                       index, info->name, operand_index + 1, value.i64);
+    }
+    return u7_ok();
+  }
+  if (kind == U7_VM0_OPERAND_FRAME_LAYOUT) {
+    if (u7_vm0_operand_frame_layout(value.i64) == NULL) {
+      return u7_errnof(EINVAL,
+                       "u7_vm0_verify: instruction %zu: %s: arg%d: no frame "
+                       "layout",
+                       index, info->name, operand_index + 1);
+    }
+    return u7_ok();
+  }
+  if (kind == U7_VM0_OPERAND_SLOTS) {
+    // The first slot receives the result, even if there are no arguments.
+    const int64_t count = u7_vm0_operand_pair_second(value.i64);
+    return u7_vm0_verify_variable(
+        index, info, operand_index, u7_vm0_operand_pair_first(value.i64),
+        sizeof(int64_t), (count == 0 ? 1 : count), locals_size);
+  }
+  const int64_t size = u7_vm0_operand_kind_variable_size(kind);
+  if (size == 0) {
+    return u7_ok();
+  }
+  if (u7_vm0_operand_kind_is_array(kind)) {
+    assert(operand_index < 2);
+    assert(info->operand_kinds[operand_index + 1] == U7_VM0_OPERAND_COUNT);
+    return u7_vm0_verify_variable(index, info, operand_index, value.i64, size,
+                                  args[operand_index + 1].i64, locals_size);
+  }
+  if (u7_vm0_operand_kind_is_array_pair(kind)) {
+    return u7_vm0_verify_array_pair(index, info, operand_index, args,
+                                    locals_size);
+  }
+  if (!u7_vm0_operand_kind_is_pair(kind)) {
+    return u7_vm0_verify_variable(index, info, operand_index, value.i64, size,
+                                  1, locals_size);
+  }
+  u7_error error = u7_vm0_verify_variable(
+      index, info, operand_index, u7_vm0_operand_pair_first(value.i64), size,
+      1, locals_size);
+  if (error.error_code != 0) {
+    return error;
+  }
+  return u7_vm0_verify_variable(index, info, operand_index,
+                                u7_vm0_operand_pair_second(value.i64), size, 1,
+                                locals_size);
+}
+
+// Lowers the frame size of instruction `index`, and schedules it for
+// propagation if it has changed.
+static void u7_vm0_verify_frames_lower(size_t* frames, size_t* pending,
+                                       size_t* pending_size, bool* queued,
+                                       size_t index, size_t locals_size) {
+  if (locals_size < frames[index]) {
+    frames[index] = locals_size;
+    if (!queued[index]) {
+      queued[index] = true;
+      pending[(*pending_size)++] = index;
+    }
+  }
+}
+
+// Computes the locals_size of the smallest frame each instruction may run
+// in: the program starts in its own frame, and the instructions reached from
+// the label of a call run in the frame of the callee (a call also continues
+// with the next instruction, after the return). The instructions that are
+// not reached are checked against the frame of the program. The malformed
+// operands are skipped; they are reported by the main pass.
+static u7_error u7_vm0_verify_frames(
+    struct u7_vm0_instruction const* instructions, size_t instructions_size,
+    size_t locals_size, size_t* frames) {
+  const size_t n = instructions_size;
+  size_t* pending = malloc(n * sizeof(size_t));
+  bool* queued = calloc(n, sizeof(bool));
+  if (pending == NULL || queued == NULL) {
+    free(pending);
+    free(queued);
+    return u7_errnof(ENOMEM, "u7_vm0_verify: out of memory");
+  }
+  for (size_t i = 0; i < n; ++i) {
+    frames[i] = SIZE_MAX;
+  }
+  size_t pending_size = 0;
+  u7_vm0_verify_frames_lower(frames, pending, &pending_size, queued, 0,
+                             locals_size);
+  while (pending_size > 0) {
+    const size_t i = pending[--pending_size];
+    queued[i] = false;
+    const enum u7_vm0_opcode opcode =
+        u7_vm0_instruction_opcode(&instructions[i]);
+    if (opcode == U7_VM0_OPCODE_UNKNOWN) {
+      continue;
+    }
+    if (!u7_vm0_opcode_is_return(opcode) && i + 1 < n) {
+      u7_vm0_verify_frames_lower(frames, pending, &pending_size, queued, i + 1,
+                                 frames[i]);
+    }
+    struct u7_vm0_opcode_info const* info = u7_vm0_opcode_info(opcode);
+    const union u7_vm0_value args[3] = {
+        instructions[i].arg1,
+        instructions[i].arg2,
+        instructions[i].arg3,
+    };
+    for (int j = 0; j < 3; ++j) {
+      if (info->operand_kinds[j] != U7_VM0_OPERAND_LABEL ||
+          args[j].i64 < 0 || (uint64_t)args[j].i64 >= n) {
+        continue;
+      }
+      size_t target_size = frames[i];
+      if (u7_vm0_opcode_is_call(opcode)) {
+        struct u7_vm_stack_frame_layout const* frame_layout =
+            u7_vm0_operand_frame_layout(args[1].i64);
+        if (frame_layout == NULL) {
+          continue;
+        }
+        target_size = frame_layout->locals_size;
+      }
+      u7_vm0_verify_frames_lower(frames, pending, &pending_size, queued,
+                                 (size_t)args[j].i64, target_size);
+    }
+  }
+  for (size_t i = 0; i < n; ++i) {
+    frames[i] = (frames[i] == SIZE_MAX ? locals_size : frames[i]);
+  }
+  free(pending);
+  free(queued);
+  return u7_ok();
+}
+
+// Checks the instructions; `frames` is NULL, or holds the locals_size of
+// every instruction (see u7_vm0_verify_frames()).
+static u7_error u7_vm0_verify_instructions(
+    struct u7_vm0_instruction const* instructions, size_t instructions_size,
+    size_t locals_size, size_t const* frames) {
+  for (size_t i = 0; i < instructions_size; ++i) {
+    const enum u7_vm0_opcode opcode =
+        u7_vm0_instruction_opcode(&instructions[i]);
+    if (opcode == U7_VM0_OPCODE_UNKNOWN) {
+      return u7_errnof(EINVAL, "u7_vm0_verify: instruction %zu: unknown", i);
+    }
+    struct u7_vm0_opcode_info const* info = u7_vm0_opcode_info(opcode);
+    const union u7_vm0_value args[3] = {
+        instructions[i].arg1,
+        instructions[i].arg2,
+        instructions[i].arg3,
+    };
+    for (int j = 0; j < 3; ++j) {
+      u7_error error =
+          u7_vm0_verify_operand(i, info, j, args, instructions_size,
+                                (frames != NULL ? frames[i] : locals_size));
+      if (error.error_code != 0) {
+        return error;
+      }
+    }
+    const int shift_width = u7_vm0_opcode_shift_width(opcode);
+    if (shift_width > 0) {
+      // The count is the only constant operand.
+      int k = 0;
+      while (info->operand_kinds[k] != U7_VM0_OPERAND_I32_CONSTANT &&
+             info->operand_kinds[k] != U7_VM0_OPERAND_I64_CONSTANT) {
+        ++k;
+      }
+      const int64_t count = (shift_width == 32 ? args[k].i32 : args[k].i64);
+      if (count < 0 || count >= shift_width) {
+        return u7_errnof(ERANGE,
+                         "u7_vm0_verify: instruction %zu: %s: arg%d: shift "
+                         "is out of range: %" PRId64,
+                         i, info->name, k + 1, count);
+      }
+    }
+    const int64_t matrix_size = u7_vm0_opcode_matrix_size(opcode);
+    if (matrix_size > 0 &&
+        args[u7_vm0_opcode_info_count_index(info)].i64 !=
+            matrix_size * matrix_size) {
+      return u7_errnof(EINVAL,
+                       "u7_vm0_verify: instruction %zu: %s: count must be "
+                       "%" PRId64,
+                       i, info->name, matrix_size * matrix_size);
+    }
+    if (u7_vm0_opcode_is_call(opcode) &&
+        sizeof(int64_t) * (uint64_t)u7_vm0_operand_pair_second(args[2].i64) >
+            u7_vm0_operand_frame_layout(args[1].i64)->locals_size) {
+      return u7_errnof(ERANGE,
+                       "u7_vm0_verify: instruction %zu: %s: the arguments "
+                       "do not fit into the callee frame",
+                       i, info->name);
+    }
+    if (opcode == U7_VM0_OPCODE_TAIL_CALL &&
+        u7_vm0_operand_pair_second(args[2].i64) >
+            U7_VM0_TAIL_CALL_MAX_COUNT) {
+      return u7_errnof(ERANGE,
+                       "u7_vm0_verify: instruction %zu: %s: too many "
+                       "arguments",
+                       i, info->name);
+    }
+    if (u7_vm0_opcode_is_jump_table(opcode)) {
+      // The entries precede the final `ret`.
+      if ((uint64_t)args[1].i64 >= instructions_size - i) {
+        return u7_errnof(ERANGE,
+                         "u7_vm0_verify: instruction %zu: %s: the table "
+                         "runs past the end of the program",
+                         i, info->name);
+      }
+      for (size_t k = i + 1; k <= i + (size_t)args[1].i64; ++k) {
+        if (!u7_vm0_opcode_is_jump(
+                u7_vm0_instruction_opcode(&instructions[k]))) {
+          return u7_errnof(EINVAL,
+                           "u7_vm0_verify: instruction %zu: %s: entry %zu "
+                           "is not a jump",
+                           i, info->name, k - i - 1);
+        }
+      }
+    }
+  }
+  if (!u7_vm0_opcode_is_return(
+          u7_vm0_instruction_opcode(&instructions[instructions_size - 1]))) {
+    return u7_errnof(EINVAL, "u7_vm0_verify: the last instruction must be ret");
+  }
+  return u7_ok();
+}
+
+u7_error u7_vm0_verify(
+    struct u7_vm0_instruction* instructions, size_t instructions_size,
+    struct u7_vm_stack_frame_layout const* locals_frame_layout) {
+  if (instructions_size == 0) {
+    return u7_errnof(EINVAL, "u7_vm0_verify: empty program");
+  }
+  // The frames are tracked only if there are calls.
+  size_t* frames = NULL;
+  for (size_t i = 0; i < instructions_size && frames == NULL; ++i) {
+    if (u7_vm0_opcode_is_call(u7_vm0_instruction_opcode(&instructions[i]))) {
+      frames = malloc(instructions_size * sizeof(size_t));
+      if (frames == NULL) {
+        return u7_errnof(ENOMEM, "u7_vm0_verify: out of memory");
+      }
+      u7_error error =
+          u7_vm0_verify_frames(instructions, instructions_size,
+                               locals_frame_layout->locals_size, frames);
+      if (error.error_code != 0) {
+        free(frames);
+        return error;
+      }
+    }
+  }
+  u7_error error = u7_vm0_verify_instructions(
+      instructions, instructions_size, locals_frame_layout->locals_size,
+      frames);
+  free(frames);
+  if (error.error_code != 0) {
+    return error;
+  }
+  // All checks passed; install the unchecked variants.
+  for (size_t i = 0; i < instructions_size; ++i) {
+    const enum u7_vm0_opcode opcode =
+        u7_vm0_instruction_opcode(&instructions[i]);
+    instructions[i].base =
+        u7_vm0_opcode_info(u7_vm0_unchecked_opcode(opcode))->base;
+  }
+  return u7_ok();
+}
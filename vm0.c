@@ -1,11 +1,17 @@
 #include "@/public/vm0.h"
 
+#include "@/public/opcode.h"
+#include "@/public/vector.h"
+
 #include <errno.h>
 #include <github.com/apronchenkov/vm/public/stack_push_pop.h>
 #include <github.com/apronchenkov/vm/public/state.h>
 #include <github.com/apronchenkov/yalog/public/logging_printf.h>
 #include <inttypes.h>
 #include <math.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
 
 static void u7_vm0_stack_frame_layout_deinit(
     struct u7_vm_stack_frame_layout const* self, void* memory) {
@@ -24,15 +30,22 @@ static struct u7_vm_stack_frame_layout u7_vm0_globals_frame_layout_impl = {
 struct u7_vm_stack_frame_layout const* const u7_vm0_globals_frame_layout =
     &u7_vm0_globals_frame_layout_impl;
 
-__attribute__((noinline)) static bool u7_vm0_panic(struct u7_vm_state* state,
-                                                   u7_error err) {
-  assert(err.error_code != 0);
-  struct u7_vm0_globals* globals = u7_vm0_state_globals(state);
-  assert(globals->error.error_code == 0);
-  if (globals->error.error_code != 0) {
-    u7_error_clear(&globals->error);
-  }
-  globals->error = err;
+// Frame pushed below the frame of a called function.
+struct u7_vm0_call_record {
+  size_t return_ip;
+  int64_t result_offset;  // Offset of the result slot in the caller frame.
+};
+
+static struct u7_vm_stack_frame_layout u7_vm0_call_record_frame_layout = {
+    .locals_size = u7_vm_align_size(sizeof(struct u7_vm0_call_record),
+                                    U7_VM_DEFAULT_ALIGNMENT),
+    .deinit_fn = NULL,
+    .extra_capacity = 0,
+    .description = "u7_vm0_call_record",
+};
+
+// Stops the program after a failure.
+static inline bool u7_vm0_halt(struct u7_vm_state* state) {
   state->ip = 0;  // Reset to the beginning.
   assert(state->stack.top_offset >=
          state->stack.base_offset + U7_VM_STACK_FRAME_HEADER_SIZE +
@@ -41,9 +54,104 @@ __attribute__((noinline)) static bool u7_vm0_panic(struct u7_vm_state* state,
       state->stack.base_offset +       // Assume, that the stack values
       U7_VM_STACK_FRAME_HEADER_SIZE +  // need no destruction work.
       u7_vm_stack_current_frame_layout(&state->stack)->locals_size;
+  // Unwind the calls, so that the program starts over in its own frame.
+  struct u7_vm0_globals* globals = u7_vm0_state_globals(state);
+  for (; globals->call_depth > 0; --globals->call_depth) {
+    u7_vm_stack_pop_frame(&state->stack);  // The callee frame.
+    u7_vm_stack_pop_frame(&state->stack);  // The call record.
+  }
   return false;
 }
 
+__attribute__((noinline)) static bool u7_vm0_panic(struct u7_vm_state* state,
+                                                   u7_error err) {
+  assert(err.error_code != 0);
+  struct u7_vm0_globals* globals = u7_vm0_state_globals(state);
+  assert(!u7_vm0_state_failed(state));
+  if (globals->error.error_code != 0) {
+    u7_error_clear(&globals->error);
+  }
+  globals->fault.error_code = 0;
+  globals->error = err;
+  return u7_vm0_halt(state);
+}
+
+// Fails the instruction with an error of an I/O backend. EAGAIN is not a
+// failure: the instruction is rewound, to be re-executed when the program is
+// resumed, and the program stops as if by `yield`.
+__attribute__((noinline)) static bool u7_vm0_io_panic(struct u7_vm_state* state,
+                                                      u7_error err) {
+  if (err.error_code == EAGAIN) {
+    u7_error_clear(&err);
+    assert(state->ip > 0);  // The engines advance ip before the execution.
+    state->ip -= 1;
+    u7_vm0_state_globals(state)->blocked = true;
+    return false;
+  }
+  return u7_vm0_panic(state, err);
+}
+
+// Same as u7_vm0_panic(), but only records the failure of the instruction
+// being executed; the message is formatted by u7_vm0_state_take_error().
+__attribute__((noinline)) static bool u7_vm0_fault(
+    struct u7_vm_state* state, struct u7_vm0_instruction const* self,
+    int error_code, enum u7_vm0_fault_kind kind, const char* function,
+    int64_t operand0, int64_t operand1) {
+  assert(error_code != 0);
+  struct u7_vm0_globals* globals = u7_vm0_state_globals(state);
+  assert(!u7_vm0_state_failed(state));
+  if (globals->error.error_code != 0) {
+    u7_error_clear(&globals->error);
+  }
+  assert(state->ip > 0);  // The engines advance ip before the execution.
+  globals->fault = (struct u7_vm0_fault){
+      .error_code = error_code,
+      .kind = kind,
+      .function = function,
+      .instruction_index = state->ip - 1,
+      .execute_fn = self->base.execute_fn,
+      .operands = {operand0, operand1},
+  };
+  return u7_vm0_halt(state);
+}
+
+u7_error u7_vm0_fault_error(struct u7_vm0_fault const* fault) {
+  assert(fault->error_code != 0);
+  switch (fault->kind) {
+    case U7_VM0_FAULT_INTEGER_OVERFLOW:
+      return u7_errnof(fault->error_code,
+                       "%s: integer overflow: lhs=%" PRId64 " rhs=%" PRId64,
+                       fault->function, fault->operands[0],
+                       fault->operands[1]);
+    case U7_VM0_FAULT_SHIFT_OUT_OF_RANGE:
+      return u7_errnof(fault->error_code, "%s: rhs=%" PRId64, fault->function,
+                       fault->operands[0]);
+    case U7_VM0_FAULT_LABEL_OUT_OF_RANGE:
+      return u7_errnof(fault->error_code, "%s: label is out of range: %zu",
+                       fault->function, (size_t)fault->operands[0]);
+    case U7_VM0_FAULT_NONE:
+      break;
+  }
+  return u7_errnof(fault->error_code, "%s: instruction %zu failed",
+                   fault->function, fault->instruction_index);
+}
+
+u7_error u7_vm0_state_take_error(struct u7_vm_state* state) {
+  struct u7_vm0_globals* globals = u7_vm0_state_globals(state);
+  if (globals->fault.error_code == 0) {
+    return u7_error_move(&globals->error);
+  }
+  u7_error result = u7_vm0_fault_error(&globals->fault);
+  globals->fault.error_code = 0;
+  return result;
+}
+
+void u7_vm0_state_clear_error(struct u7_vm_state* state) {
+  struct u7_vm0_globals* globals = u7_vm0_state_globals(state);
+  u7_error_clear(&globals->error);
+  globals->fault.error_code = 0;
+}
+
 __attribute__((noinline)) static u7_error u7_vm0_unsupported_arg_kind_error(
     const char* instruction_name, const char* arg_name,
     enum u7_vm0_arg_kind arg_kind) {
@@ -89,7 +197,7 @@ __attribute__((noinline)) static u7_error u7_vm0_unsupported_arg_kind_error(
                    instruction_name, arg_name, (int)arg_kind);
 }
 
-#define U7_VM0_DEFINE_INSTRUCTION_EXEC(fn_name) \
+#define U7_VM0_DEFINE_INSTRUCTION_EXEC(fn_name)                            \
   U7_VM_DEFINE_INSTRUCTION_EXEC(fn_name##_exec, struct u7_vm0_instruction)
 
 #define U7_VM0_DEFINE_INSTRUCTION_0(fn_name)     \
@@ -103,22 +211,247 @@ U7_VM0_DEFINE_INSTRUCTION_EXEC(yield) { return false; }
 
 U7_VM0_DEFINE_INSTRUCTION_0(yield)
 
+bool u7_vm0_state_leave_call(struct u7_vm_state* state, void const* result,
+                             size_t result_size) {
+  struct u7_vm0_globals* globals = u7_vm0_state_globals(state);
+  if (globals->call_depth == 0) {
+    state->ip = 0;  // Reset to the beginning.
+    assert(state->stack.top_offset ==
+           state->stack.base_offset + U7_VM_STACK_FRAME_HEADER_SIZE +
+               u7_vm_stack_current_frame_layout(&state->stack)->locals_size);
+    return false;
+  }
+  u7_vm_stack_pop_frame(&state->stack);
+  assert(u7_vm_stack_current_frame_layout(&state->stack) ==
+         &u7_vm0_call_record_frame_layout);
+  const struct u7_vm0_call_record record =
+      *(struct u7_vm0_call_record const*)u7_vm_state_locals(state);
+  u7_vm_stack_pop_frame(&state->stack);
+  globals->call_depth -= 1;
+  if (result_size > 0) {
+    memcpy(u7_vm_memory_add_offset(u7_vm_state_locals(state),
+                                   record.result_offset),
+           result, result_size);
+  }
+  state->ip = record.return_ip;
+  return true;
+}
+
 U7_VM0_DEFINE_INSTRUCTION_EXEC(ret) {
-  state->ip = 0;  // Reset to the beginning.
-  assert(state->stack.top_offset ==
-         state->stack.base_offset + U7_VM_STACK_FRAME_HEADER_SIZE +
-             u7_vm_stack_current_frame_layout(&state->stack)->locals_size);
-  return false;
+  return u7_vm0_state_leave_call(state, NULL, 0);
 }
 
 U7_VM0_DEFINE_INSTRUCTION_0(ret)
 
+#define U7_VM0_DEFINE_RET_VALUE_EXEC(type)                               \
+  U7_VM0_DEFINE_INSTRUCTION_EXEC(ret_##type##v) {                        \
+    const union u7_vm0_value result = {                                  \
+        .type = *u7_vm0_state_local_##type(state, self->arg1.i64)};      \
+    return u7_vm0_state_leave_call(state, &result, sizeof(result.type)); \
+  }
+
+U7_VM0_DEFINE_RET_VALUE_EXEC(i32)
+U7_VM0_DEFINE_RET_VALUE_EXEC(i64)
+U7_VM0_DEFINE_RET_VALUE_EXEC(f32)
+U7_VM0_DEFINE_RET_VALUE_EXEC(f64)
+
+bool u7_vm0_state_enter_call(
+    struct u7_vm_state* state, size_t target,
+    struct u7_vm_stack_frame_layout const* frame_layout, int64_t slots) {
+  assert(target < state->instructions_size);
+  const int32_t offset = u7_vm0_operand_pair_first(slots);
+  const size_t args_size =
+      sizeof(int64_t) * (size_t)u7_vm0_operand_pair_second(slots);
+  assert(args_size <= frame_layout->locals_size);
+  // The stack memory may move, so the arguments are addressed by offset.
+  const size_t args_offset =
+      state->stack.base_offset + U7_VM_STACK_FRAME_HEADER_SIZE + offset;
+  u7_error error = u7_vm_stack_push_frame(&state->stack,
+                                          &u7_vm0_call_record_frame_layout);
+  if (error.error_code != 0) {
+    return u7_vm0_panic(state, error);
+  }
+  struct u7_vm0_call_record* record = u7_vm_state_locals(state);
+  record->return_ip = state->ip;
+  record->result_offset = offset;
+  error = u7_vm_stack_push_frame(&state->stack, frame_layout);
+  if (error.error_code != 0) {
+    u7_vm_stack_pop_frame(&state->stack);
+    return u7_vm0_panic(state, error);
+  }
+  u7_vm0_state_globals(state)->call_depth += 1;
+  memcpy(u7_vm_state_locals(state),
+         u7_vm_memory_add_offset(state->stack.memory, (int64_t)args_offset),
+         args_size);
+  state->ip = target;
+  return true;
+}
+
+// Checks the label of a call instruction, and enters the call.
+static bool u7_vm0_call_enter(struct u7_vm_state* state,
+                              struct u7_vm0_instruction const* self,
+                              const char* function) {
+  const size_t target = (size_t)self->arg1.i64;
+  if (target >= state->instructions_size) {
+    return u7_vm0_fault(state, self, ERANGE, U7_VM0_FAULT_LABEL_OUT_OF_RANGE,
+                        function, (int64_t)target, 0);
+  }
+  return u7_vm0_state_enter_call(
+      state, target, u7_vm0_operand_frame_layout(self->arg2.i64),
+      self->arg3.i64);
+}
+
+U7_VM0_DEFINE_INSTRUCTION_EXEC(call) {
+  return u7_vm0_call_enter(state, self, "u7_vm0_call");
+}
+
+U7_VM0_DEFINE_INSTRUCTION_EXEC(tail_call) {
+  if (u7_vm0_state_globals(state)->call_depth == 0) {
+    return u7_vm0_call_enter(state, self, "u7_vm0_tail_call");
+  }
+  const size_t target = (size_t)self->arg1.i64;
+  if (target >= state->instructions_size) {
+    return u7_vm0_fault(state, self, ERANGE, U7_VM0_FAULT_LABEL_OUT_OF_RANGE,
+                        "u7_vm0_tail_call", (int64_t)target, 0);
+  }
+  struct u7_vm_stack_frame_layout const* frame_layout =
+      u7_vm0_operand_frame_layout(self->arg2.i64);
+  void* locals = u7_vm_state_locals(state);
+  void const* args = u7_vm_memory_add_offset(
+      locals, u7_vm0_operand_pair_first(self->arg3.i64));
+  const size_t args_size =
+      sizeof(int64_t) * (size_t)u7_vm0_operand_pair_second(self->arg3.i64);
+  state->ip = target;
+  if (u7_vm_stack_current_frame_layout(&state->stack) == frame_layout) {
+    // The frame is reused as is: the variables after the arguments keep the
+    // values of the current function, as documented in vm0.h.
+    memmove(locals, args, args_size);
+    return true;
+  }
+  // The new frame takes the place of the current one, so the arguments are
+  // saved aside; their number is limited when the instruction is built. The
+  // call record stays.
+  int64_t buffer[U7_VM0_TAIL_CALL_MAX_COUNT];
+  assert(args_size <= sizeof(buffer));
+  memcpy(buffer, args, args_size);
+  u7_vm_stack_pop_frame(&state->stack);
+  u7_error error = u7_vm_stack_push_frame(&state->stack, frame_layout);
+  if (error.error_code != 0) {
+    u7_vm_stack_pop_frame(&state->stack);  // The call record.
+    u7_vm0_state_globals(state)->call_depth -= 1;
+    return u7_vm0_panic(state, error);
+  }
+  memcpy(u7_vm_state_locals(state), buffer, args_size);
+  return true;
+}
+
+static struct u7_vm0_instruction u7_vm0_call_instruction(
+    u7_error* error, const char* instruction_name,
+    bool (*execute_fn)(struct u7_vm_state* state,
+                       struct u7_vm_instruction const* self),
+    struct u7_vm0_arg label,
+    struct u7_vm_stack_frame_layout const* frame_layout,
+    struct u7_vm0_arg args, int64_t count) {
+  struct u7_vm0_instruction result = {
+      .arg1 = label.value,
+      .arg2.i64 = (int64_t)(intptr_t)frame_layout,
+  };
+  if (error->error_code != 0) {
+    return result;
+  }
+  if (label.kind != U7_VM0_ARG_KIND_I64_LABEL) {
+    *error = u7_vm0_unsupported_arg_kind_error(instruction_name, "label",
+                                               label.kind);
+    return result;
+  }
+  if (args.kind != U7_VM0_ARG_KIND_I32_VARIABLE &&
+      args.kind != U7_VM0_ARG_KIND_I64_VARIABLE &&
+      args.kind != U7_VM0_ARG_KIND_F32_VARIABLE &&
+      args.kind != U7_VM0_ARG_KIND_F64_VARIABLE) {
+    *error = u7_vm0_unsupported_arg_kind_error(instruction_name, "args",
+                                               args.kind);
+    return result;
+  }
+  if (args.value.i64 < 0 || args.value.i64 > INT32_MAX ||
+      args.value.i64 % (int64_t)sizeof(int64_t) != 0) {
+    *error = u7_errnof(EINVAL,
+                       "%s: args must be an 8-byte slot: offset=%" PRId64,
+                       instruction_name, args.value.i64);
+    return result;
+  }
+  if (frame_layout == NULL) {
+    *error = u7_errnof(EINVAL, "%s: no frame layout", instruction_name);
+    return result;
+  }
+  if (count < 0 ||
+      (uint64_t)count > frame_layout->locals_size / sizeof(int64_t)) {
+    *error = u7_errnof(EINVAL,
+                       "%s: the arguments do not fit into the frame: "
+                       "count=%" PRId64,
+                       instruction_name, count);
+    return result;
+  }
+  result.arg3.i64 =
+      u7_vm0_operand_pair((int32_t)args.value.i64, (int32_t)count);
+  result.base.execute_fn = execute_fn;
+  return result;
+}
+
+struct u7_vm0_instruction u7_vm0_call(
+    u7_error* error, struct u7_vm0_arg label,
+    struct u7_vm_stack_frame_layout const* frame_layout,
+    struct u7_vm0_arg args, int64_t count) {
+  return u7_vm0_call_instruction(error, "u7_vm0_call", call_exec, label,
+                                 frame_layout, args, count);
+}
+
+struct u7_vm0_instruction u7_vm0_tail_call(
+    u7_error* error, struct u7_vm0_arg label,
+    struct u7_vm_stack_frame_layout const* frame_layout,
+    struct u7_vm0_arg args, int64_t count) {
+  if (error->error_code == 0 && count > U7_VM0_TAIL_CALL_MAX_COUNT) {
+    *error = u7_errnof(EINVAL,
+                       "u7_vm0_tail_call: too many arguments: count=%" PRId64,
+                       count);
+  }
+  return u7_vm0_call_instruction(error, "u7_vm0_tail_call", tail_call_exec,
+                                 label, frame_layout, args, count);
+}
+
+struct u7_vm0_instruction u7_vm0_ret_value(u7_error* error,
+                                           struct u7_vm0_arg src) {
+  struct u7_vm0_instruction result = {
+      .arg1 = src.value,
+  };
+  if (error->error_code != 0) {
+    return result;
+  }
+  switch (src.kind) {
+    case U7_VM0_ARG_KIND_I32_VARIABLE:
+      result.base.execute_fn = ret_i32v_exec;
+      break;
+    case U7_VM0_ARG_KIND_I64_VARIABLE:
+      result.base.execute_fn = ret_i64v_exec;
+      break;
+    case U7_VM0_ARG_KIND_F32_VARIABLE:
+      result.base.execute_fn = ret_f32v_exec;
+      break;
+    case U7_VM0_ARG_KIND_F64_VARIABLE:
+      result.base.execute_fn = ret_f64v_exec;
+      break;
+    default:
+      *error = u7_vm0_unsupported_arg_kind_error("u7_vm0_ret_value", "src",
+                                                 src.kind);
+  }
+  return result;
+}
+
 U7_VM0_DEFINE_INSTRUCTION_EXEC(input_i32v) {
   struct u7_vm0_input* input = u7_vm0_state_global_input(state);
   u7_error error =
       input->read_i32_fn(input, u7_vm0_state_local_i32(state, self->arg1.i64));
   if (error.error_code != 0) {
-    return u7_vm0_panic(state, error);
+    return u7_vm0_io_panic(state, error);
   }
   return true;
 }
@@ -128,7 +461,7 @@ U7_VM0_DEFINE_INSTRUCTION_EXEC(input_i64v) {
   u7_error error =
       input->read_i64_fn(input, u7_vm0_state_local_i64(state, self->arg1.i64));
   if (error.error_code != 0) {
-    return u7_vm0_panic(state, error);
+    return u7_vm0_io_panic(state, error);
   }
   return true;
 }
@@ -138,7 +471,7 @@ U7_VM0_DEFINE_INSTRUCTION_EXEC(input_f32v) {
   u7_error err =
       input->read_f32_fn(input, u7_vm0_state_local_f32(state, self->arg1.i64));
   if (err.error_code != 0) {
-    return u7_vm0_panic(state, err);
+    return u7_vm0_io_panic(state, err);
   }
   return true;
 }
@@ -148,7 +481,7 @@ U7_VM0_DEFINE_INSTRUCTION_EXEC(input_f64v) {
   u7_error err =
       input->read_f64_fn(input, u7_vm0_state_local_f64(state, self->arg1.i64));
   if (err.error_code != 0) {
-    return u7_vm0_panic(state, err);
+    return u7_vm0_io_panic(state, err);
   }
   return true;
 }
@@ -184,7 +517,7 @@ U7_VM0_DEFINE_INSTRUCTION_EXEC(output_i32c) {
   struct u7_vm0_output* output = u7_vm0_state_global_output(state);
   u7_error error = output->write_i32_fn(output, self->arg1.i32);
   if (error.error_code != 0) {
-    return u7_vm0_panic(state, error);
+    return u7_vm0_io_panic(state, error);
   }
   return true;
 }
@@ -193,7 +526,7 @@ U7_VM0_DEFINE_INSTRUCTION_EXEC(output_i64c) {
   struct u7_vm0_output* output = u7_vm0_state_global_output(state);
   u7_error error = output->write_i64_fn(output, self->arg1.i64);
   if (error.error_code != 0) {
-    return u7_vm0_panic(state, error);
+    return u7_vm0_io_panic(state, error);
   }
   return true;
 }
@@ -202,7 +535,7 @@ U7_VM0_DEFINE_INSTRUCTION_EXEC(output_f32c) {
   struct u7_vm0_output* output = u7_vm0_state_global_output(state);
   u7_error error = output->write_f32_fn(output, self->arg1.f32);
   if (error.error_code != 0) {
-    return u7_vm0_panic(state, error);
+    return u7_vm0_io_panic(state, error);
   }
   return true;
 }
@@ -211,7 +544,7 @@ U7_VM0_DEFINE_INSTRUCTION_EXEC(output_f64c) {
   struct u7_vm0_output* output = u7_vm0_state_global_output(state);
   u7_error error = output->write_f64_fn(output, self->arg1.f64);
   if (error.error_code != 0) {
-    return u7_vm0_panic(state, error);
+    return u7_vm0_io_panic(state, error);
   }
   return true;
 }
@@ -221,7 +554,7 @@ U7_VM0_DEFINE_INSTRUCTION_EXEC(output_i32v) {
   u7_error error = output->write_i32_fn(
       output, *u7_vm0_state_local_i32(state, self->arg1.i64));
   if (error.error_code != 0) {
-    return u7_vm0_panic(state, error);
+    return u7_vm0_io_panic(state, error);
   }
   return true;
 }
@@ -231,7 +564,7 @@ U7_VM0_DEFINE_INSTRUCTION_EXEC(output_i64v) {
   u7_error error = output->write_i64_fn(
       output, *u7_vm0_state_local_i64(state, self->arg1.i64));
   if (error.error_code != 0) {
-    return u7_vm0_panic(state, error);
+    return u7_vm0_io_panic(state, error);
   }
   return true;
 }
@@ -241,7 +574,7 @@ U7_VM0_DEFINE_INSTRUCTION_EXEC(output_f32v) {
   u7_error error = output->write_f32_fn(
       output, *u7_vm0_state_local_f32(state, self->arg1.i64));
   if (error.error_code != 0) {
-    return u7_vm0_panic(state, error);
+    return u7_vm0_io_panic(state, error);
   }
   return true;
 }
@@ -251,7 +584,7 @@ U7_VM0_DEFINE_INSTRUCTION_EXEC(output_f64v) {
   u7_error error = output->write_f64_fn(
       output, *u7_vm0_state_local_f64(state, self->arg1.i64));
   if (error.error_code != 0) {
-    return u7_vm0_panic(state, error);
+    return u7_vm0_io_panic(state, error);
   }
   return true;
 }
@@ -296,6 +629,146 @@ struct u7_vm0_instruction u7_vm0_output(u7_error* error,
   return result;
 }
 
+// The batch instructions read or write `count` consecutive variables. A
+// batch that blocks halfway keeps its progress in u7_vm0_globals.io_done.
+#define U7_VM0_DEFINE_INPUT_N_EXEC(type_name, type)                         \
+  U7_VM0_DEFINE_INSTRUCTION_EXEC(input_n_##type_name##v) {                  \
+    const size_t count = (size_t)self->arg2.i64;                            \
+    if (count == 0) {                                                       \
+      return true;                                                          \
+    }                                                                       \
+    assert(self->arg1.i64 + count * sizeof(type) <=                         \
+           u7_vm_stack_current_frame_layout(&state->stack)->locals_size);   \
+    struct u7_vm0_globals* globals = u7_vm0_state_globals(state);           \
+    const size_t begin = globals->io_done;                                  \
+    if (begin >= count) { /* E.g. restored from a forged snapshot. */       \
+      globals->io_done = 0;                                                 \
+      return u7_vm0_panic(                                                  \
+          state, u7_errnof(EINVAL, "input_n: io_done is out of range: %zu", \
+                           begin));                                         \
+    }                                                                       \
+    size_t done = 0;                                                        \
+    u7_error error = u7_vm0_input_read_##type_name##_n(                     \
+        u7_vm0_state_global_input(state),                                   \
+        u7_vm0_state_local_##type_name(state, self->arg1.i64) + begin,      \
+        count - begin, &done);                                              \
+    if (error.error_code != 0) {                                            \
+      globals->io_done = (error.error_code == EAGAIN ? begin + done : 0);   \
+      return u7_vm0_io_panic(state, error);                                 \
+    }                                                                       \
+    globals->io_done = 0;                                                   \
+    return true;                                                            \
+  }
+
+U7_VM0_DEFINE_INPUT_N_EXEC(i32, int32_t)
+U7_VM0_DEFINE_INPUT_N_EXEC(i64, int64_t)
+U7_VM0_DEFINE_INPUT_N_EXEC(f32, float)
+U7_VM0_DEFINE_INPUT_N_EXEC(f64, double)
+
+struct u7_vm0_instruction u7_vm0_input_n(u7_error* error,
+                                         struct u7_vm0_arg dst,
+                                         int64_t count) {
+  struct u7_vm0_instruction result = {
+      .arg1 = dst.value,
+      .arg2.i64 = count,
+  };
+  if (error->error_code != 0) {
+    return result;
+  }
+  if (count < 0) {
+    *error = u7_errnof(EINVAL, "u7_vm0_input_n: negative count: %" PRId64,
+                       count);
+    return result;
+  }
+  switch (dst.kind) {
+    case U7_VM0_ARG_KIND_I32_VARIABLE:
+      result.base.execute_fn = input_n_i32v_exec;
+      break;
+    case U7_VM0_ARG_KIND_I64_VARIABLE:
+      result.base.execute_fn = input_n_i64v_exec;
+      break;
+    case U7_VM0_ARG_KIND_F32_VARIABLE:
+      result.base.execute_fn = input_n_f32v_exec;
+      break;
+    case U7_VM0_ARG_KIND_F64_VARIABLE:
+      result.base.execute_fn = input_n_f64v_exec;
+      break;
+    default:
+      *error =
+          u7_vm0_unsupported_arg_kind_error("u7_vm0_input_n", "dst", dst.kind);
+  }
+  return result;
+}
+
+#define U7_VM0_DEFINE_OUTPUT_N_EXEC(type_name, type)                         \
+  U7_VM0_DEFINE_INSTRUCTION_EXEC(output_n_##type_name##v) {                  \
+    const size_t count = (size_t)self->arg2.i64;                             \
+    if (count == 0) {                                                        \
+      return true;                                                           \
+    }                                                                        \
+    assert(self->arg1.i64 + count * sizeof(type) <=                          \
+           u7_vm_stack_current_frame_layout(&state->stack)->locals_size);    \
+    struct u7_vm0_globals* globals = u7_vm0_state_globals(state);            \
+    const size_t begin = globals->io_done;                                   \
+    if (begin >= count) { /* E.g. restored from a forged snapshot. */        \
+      globals->io_done = 0;                                                  \
+      return u7_vm0_panic(                                                   \
+          state, u7_errnof(EINVAL, "output_n: io_done is out of range: %zu", \
+                           begin));                                          \
+    }                                                                        \
+    size_t done = 0;                                                         \
+    u7_error error = u7_vm0_output_write_##type_name##_n(                    \
+        u7_vm0_state_global_output(state),                                   \
+        u7_vm0_state_local_##type_name(state, self->arg1.i64) + begin,       \
+        count - begin, &done);                                               \
+    if (error.error_code != 0) {                                             \
+      globals->io_done = (error.error_code == EAGAIN ? begin + done : 0);    \
+      return u7_vm0_io_panic(state, error);                                  \
+    }                                                                        \
+    globals->io_done = 0;                                                    \
+    return true;                                                             \
+  }
+
+U7_VM0_DEFINE_OUTPUT_N_EXEC(i32, int32_t)
+U7_VM0_DEFINE_OUTPUT_N_EXEC(i64, int64_t)
+U7_VM0_DEFINE_OUTPUT_N_EXEC(f32, float)
+U7_VM0_DEFINE_OUTPUT_N_EXEC(f64, double)
+
+struct u7_vm0_instruction u7_vm0_output_n(u7_error* error,
+                                          struct u7_vm0_arg src,
+                                          int64_t count) {
+  struct u7_vm0_instruction result = {
+      .arg1 = src.value,
+      .arg2.i64 = count,
+  };
+  if (error->error_code != 0) {
+    return result;
+  }
+  if (count < 0) {
+    *error = u7_errnof(EINVAL, "u7_vm0_output_n: negative count: %" PRId64,
+                       count);
+    return result;
+  }
+  switch (src.kind) {
+    case U7_VM0_ARG_KIND_I32_VARIABLE:
+      result.base.execute_fn = output_n_i32v_exec;
+      break;
+    case U7_VM0_ARG_KIND_I64_VARIABLE:
+      result.base.execute_fn = output_n_i64v_exec;
+      break;
+    case U7_VM0_ARG_KIND_F32_VARIABLE:
+      result.base.execute_fn = output_n_f32v_exec;
+      break;
+    case U7_VM0_ARG_KIND_F64_VARIABLE:
+      result.base.execute_fn = output_n_f64v_exec;
+      break;
+    default:
+      *error = u7_vm0_unsupported_arg_kind_error("u7_vm0_output_n", "src",
+                                                 src.kind);
+  }
+  return result;
+}
+
 U7_VM0_DEFINE_INSTRUCTION_EXEC(copy_i32c) {
   *u7_vm0_state_local_i32(state, self->arg1.i64) = self->arg2.i32;
   return true;
@@ -499,11 +972,11 @@ U7_VM0_DEFINE_INSTRUCTION_EXEC(bitwise_left_shift_i32cv) {
   const int32_t lhs = self->arg2.i32;
   const int32_t rhs = *u7_vm0_state_local_i32(state, self->arg3.i64);
   if (rhs < -31) {
-    return u7_vm0_panic(
-        state, u7_errnof(EINVAL, "bitwise_left_shift_i32: rhs=%" PRId32, rhs));
+    return u7_vm0_fault(state, self, EINVAL, U7_VM0_FAULT_SHIFT_OUT_OF_RANGE,
+                        "bitwise_left_shift_i32", rhs, 0);
   } else if (rhs > 31) {
-    return u7_vm0_panic(
-        state, u7_errnof(EINVAL, "bitwise_left_shift_i32: rhs=%" PRId32, rhs));
+    return u7_vm0_fault(state, self, EINVAL, U7_VM0_FAULT_SHIFT_OUT_OF_RANGE,
+                        "bitwise_left_shift_i32", rhs, 0);
   }
   *dst = (rhs < 0 ? (lhs >> -rhs) : (lhs << rhs));
   return true;
@@ -526,11 +999,11 @@ U7_VM0_DEFINE_INSTRUCTION_EXEC(bitwise_left_shift_i32vv) {
   const int32_t lhs = *u7_vm0_state_local_i32(state, self->arg2.i64);
   const int32_t rhs = *u7_vm0_state_local_i32(state, self->arg3.i64);
   if (rhs < -31) {
-    return u7_vm0_panic(
-        state, u7_errnof(EINVAL, "bitwise_left_shift_i32: rhs=%" PRId32, rhs));
+    return u7_vm0_fault(state, self, EINVAL, U7_VM0_FAULT_SHIFT_OUT_OF_RANGE,
+                        "bitwise_left_shift_i32", rhs, 0);
   } else if (rhs > 31) {
-    return u7_vm0_panic(
-        state, u7_errnof(EINVAL, "bitwise_left_shift_i32: rhs=%" PRId32, rhs));
+    return u7_vm0_fault(state, self, EINVAL, U7_VM0_FAULT_SHIFT_OUT_OF_RANGE,
+                        "bitwise_left_shift_i32", rhs, 0);
   }
   *dst = (rhs < 0 ? (lhs >> -rhs) : (lhs << rhs));
   return true;
@@ -541,11 +1014,11 @@ U7_VM0_DEFINE_INSTRUCTION_EXEC(bitwise_left_shift_i64cv) {
   const int64_t lhs = self->arg2.i64;
   const int64_t rhs = *u7_vm0_state_local_i64(state, self->arg3.i64);
   if (rhs < -63) {
-    return u7_vm0_panic(
-        state, u7_errnof(EINVAL, "bitwise_left_shift_i64: rhs=%" PRId64, rhs));
+    return u7_vm0_fault(state, self, EINVAL, U7_VM0_FAULT_SHIFT_OUT_OF_RANGE,
+                        "bitwise_left_shift_i64", rhs, 0);
   } else if (rhs > 63) {
-    return u7_vm0_panic(
-        state, u7_errnof(EINVAL, "bitwise_left_shift_i64: rhs=%" PRId64, rhs));
+    return u7_vm0_fault(state, self, EINVAL, U7_VM0_FAULT_SHIFT_OUT_OF_RANGE,
+                        "bitwise_left_shift_i64", rhs, 0);
   }
   *dst = (rhs < 0 ? (lhs >> -rhs) : (lhs << rhs));
   return true;
@@ -568,11 +1041,11 @@ U7_VM0_DEFINE_INSTRUCTION_EXEC(bitwise_left_shift_i64vv) {
   const int64_t lhs = *u7_vm0_state_local_i64(state, self->arg2.i64);
   const int64_t rhs = *u7_vm0_state_local_i64(state, self->arg3.i64);
   if (rhs < -63) {
-    return u7_vm0_panic(
-        state, u7_errnof(EINVAL, "bitwise_left_shift_i64: rhs=%" PRId64, rhs));
+    return u7_vm0_fault(state, self, EINVAL, U7_VM0_FAULT_SHIFT_OUT_OF_RANGE,
+                        "bitwise_left_shift_i64", rhs, 0);
   } else if (rhs > 63) {
-    return u7_vm0_panic(
-        state, u7_errnof(EINVAL, "bitwise_left_shift_i64: rhs=%" PRId64, rhs));
+    return u7_vm0_fault(state, self, EINVAL, U7_VM0_FAULT_SHIFT_OUT_OF_RANGE,
+                        "bitwise_left_shift_i64", rhs, 0);
   }
   *dst = (rhs < 0 ? (lhs >> -rhs) : (lhs << rhs));
   return true;
@@ -603,7 +1076,7 @@ struct u7_vm0_instruction u7_vm0_bitwise_left_shift(u7_error* error,
         if (rhs.value.i32 < -31) {
           *error =
               u7_errnof(EINVAL, "u7_vm0_bitwise_left_shift_i32vc: rhs < -31");
-        } else if (rhs.value.i64 > 31) {
+        } else if (rhs.value.i32 > 31) {
           *error =
               u7_errnof(EINVAL, "u7_vm0_bitwise_left_shift_i32vc: rhs > 31");
         } else if (rhs.value.i32 == 0) {
@@ -672,11 +1145,8 @@ U7_VM0_DEFINE_INSTRUCTION_EXEC(math_add_i32vc) {
   const int32_t lhs = *u7_vm0_state_local_i32(state, self->arg2.i64);
   const int32_t rhs = self->arg3.i32;
   if (__builtin_add_overflow(lhs, rhs, dst)) {
-    return u7_vm0_panic(
-        state, u7_errnof(ERANGE,
-                         "u7_vm0_math_add: integer overflow: lhs=%" PRId32
-                         " rhs=%" PRId32,
-                         lhs, rhs));
+    return u7_vm0_fault(state, self, ERANGE, U7_VM0_FAULT_INTEGER_OVERFLOW,
+                        "u7_vm0_math_add", lhs, rhs);
   }
   return true;
 }
@@ -686,11 +1156,8 @@ U7_VM0_DEFINE_INSTRUCTION_EXEC(math_add_i32vv) {
   const int32_t lhs = *u7_vm0_state_local_i32(state, self->arg2.i64);
   const int32_t rhs = *u7_vm0_state_local_i32(state, self->arg3.i64);
   if (__builtin_add_overflow(lhs, rhs, dst)) {
-    return u7_vm0_panic(
-        state, u7_errnof(ERANGE,
-                         "u7_vm0_math_add: integer overflow: lhs=%" PRId32
-                         " rhs=%" PRId32,
-                         lhs, rhs));
+    return u7_vm0_fault(state, self, ERANGE, U7_VM0_FAULT_INTEGER_OVERFLOW,
+                        "u7_vm0_math_add", lhs, rhs);
   }
   return true;
 }
@@ -700,11 +1167,8 @@ U7_VM0_DEFINE_INSTRUCTION_EXEC(math_add_i64vc) {
   const int64_t lhs = *u7_vm0_state_local_i64(state, self->arg2.i64);
   const int64_t rhs = self->arg3.i64;
   if (__builtin_add_overflow(lhs, rhs, dst)) {
-    return u7_vm0_panic(
-        state, u7_errnof(ERANGE,
-                         "u7_vm0_math_add: integer overflow: lhs=%" PRId64
-                         " rhs=%" PRId64,
-                         lhs, rhs));
+    return u7_vm0_fault(state, self, ERANGE, U7_VM0_FAULT_INTEGER_OVERFLOW,
+                        "u7_vm0_math_add", lhs, rhs);
   }
   return true;
 }
@@ -714,11 +1178,8 @@ U7_VM0_DEFINE_INSTRUCTION_EXEC(math_add_i64vv) {
   const int64_t lhs = *u7_vm0_state_local_i64(state, self->arg2.i64);
   const int64_t rhs = *u7_vm0_state_local_i64(state, self->arg3.i64);
   if (__builtin_add_overflow(lhs, rhs, dst)) {
-    return u7_vm0_panic(
-        state, u7_errnof(ERANGE,
-                         "u7_vm0_math_add: integer overflow: lhs=%" PRId64
-                         " rhs=%" PRId64,
-                         lhs, rhs));
+    return u7_vm0_fault(state, self, ERANGE, U7_VM0_FAULT_INTEGER_OVERFLOW,
+                        "u7_vm0_math_add", lhs, rhs);
   }
   return true;
 }
@@ -829,11 +1290,8 @@ U7_VM0_DEFINE_INSTRUCTION_EXEC(math_multiply_i32vc) {
   const int32_t lhs = *u7_vm0_state_local_i32(state, self->arg2.i64);
   const int32_t rhs = self->arg3.i32;
   if (__builtin_smul_overflow(lhs, rhs, dst)) {
-    return u7_vm0_panic(
-        state, u7_errnof(ERANGE,
-                         "u7_vm0_math_multiply: integer overflow: lhs=%" PRId32
-                         " rhs=%" PRId32,
-                         lhs, rhs));
+    return u7_vm0_fault(state, self, ERANGE, U7_VM0_FAULT_INTEGER_OVERFLOW,
+                        "u7_vm0_math_multiply", lhs, rhs);
   }
   return true;
 }
@@ -843,11 +1301,8 @@ U7_VM0_DEFINE_INSTRUCTION_EXEC(math_multiply_i32vv) {
   const int32_t lhs = *u7_vm0_state_local_i32(state, self->arg2.i64);
   const int32_t rhs = *u7_vm0_state_local_i32(state, self->arg3.i64);
   if (__builtin_mul_overflow(lhs, rhs, dst)) {
-    return u7_vm0_panic(
-        state, u7_errnof(ERANGE,
-                         "u7_vm0_math_multiply: integer overflow: lhs=%" PRId32
-                         " rhs=%" PRId32,
-                         lhs, rhs));
+    return u7_vm0_fault(state, self, ERANGE, U7_VM0_FAULT_INTEGER_OVERFLOW,
+                        "u7_vm0_math_multiply", lhs, rhs);
   }
   return true;
 }
@@ -857,11 +1312,8 @@ U7_VM0_DEFINE_INSTRUCTION_EXEC(math_multiply_i64vc) {
   const int64_t lhs = *u7_vm0_state_local_i64(state, self->arg2.i64);
   const int64_t rhs = self->arg3.i64;
   if (__builtin_mul_overflow(lhs, rhs, dst)) {
-    return u7_vm0_panic(
-        state, u7_errnof(ERANGE,
-                         "u7_vm0_math_multiply: integer overflow: lhs=%" PRId64
-                         " rhs=%" PRId64,
-                         lhs, rhs));
+    return u7_vm0_fault(state, self, ERANGE, U7_VM0_FAULT_INTEGER_OVERFLOW,
+                        "u7_vm0_math_multiply", lhs, rhs);
   }
   return true;
 }
@@ -871,11 +1323,8 @@ U7_VM0_DEFINE_INSTRUCTION_EXEC(math_multiply_i64vv) {
   const int64_t lhs = *u7_vm0_state_local_i64(state, self->arg2.i64);
   const int64_t rhs = *u7_vm0_state_local_i64(state, self->arg3.i64);
   if (__builtin_mul_overflow(lhs, rhs, dst)) {
-    return u7_vm0_panic(
-        state, u7_errnof(ERANGE,
-                         "u7_vm0_math_multiply: integer overflow: lhs=%" PRId64
-                         " rhs=%" PRId64,
-                         lhs, rhs));
+    return u7_vm0_fault(state, self, ERANGE, U7_VM0_FAULT_INTEGER_OVERFLOW,
+                        "u7_vm0_math_multiply", lhs, rhs);
   }
   return true;
 }
@@ -985,9 +1434,8 @@ U7_VM0_DEFINE_INSTRUCTION_EXEC(jump_if_zero_i32) {
   const int32_t src = *u7_vm0_state_local_i32(state, self->arg1.i64);
   const size_t target = (size_t)self->arg2.i64;
   if (target >= state->instructions_size) {
-    return u7_vm0_panic(
-        state, u7_errnof(ERANGE, "u7_jump_if_zero: label is out of range: %zu",
-                         target));
+    return u7_vm0_fault(state, self, ERANGE, U7_VM0_FAULT_LABEL_OUT_OF_RANGE,
+                        "u7_jump_if_zero", (int64_t)target, 0);
   }
   state->ip = (src == 0 ? target : state->ip);
   return true;
@@ -997,9 +1445,8 @@ U7_VM0_DEFINE_INSTRUCTION_EXEC(jump_if_zero_i64) {
   const int64_t src = *u7_vm0_state_local_i64(state, self->arg1.i64);
   const size_t target = (size_t)self->arg2.i64;
   if (target >= state->instructions_size) {
-    return u7_vm0_panic(
-        state, u7_errnof(ERANGE, "u7_jump_if_zero: label is out of range: %zu",
-                         target));
+    return u7_vm0_fault(state, self, ERANGE, U7_VM0_FAULT_LABEL_OUT_OF_RANGE,
+                        "u7_jump_if_zero", (int64_t)target, 0);
   }
   state->ip = (src == 0 ? target : state->ip);
   return true;
@@ -1009,9 +1456,8 @@ U7_VM0_DEFINE_INSTRUCTION_EXEC(jump_if_zero_f32) {
   const float src = *u7_vm0_state_local_f32(state, self->arg1.i64);
   const size_t target = (size_t)self->arg2.i64;
   if (target >= state->instructions_size) {
-    return u7_vm0_panic(
-        state, u7_errnof(ERANGE, "u7_jump_if_zero: label is out of range: %zu",
-                         target));
+    return u7_vm0_fault(state, self, ERANGE, U7_VM0_FAULT_LABEL_OUT_OF_RANGE,
+                        "u7_jump_if_zero", (int64_t)target, 0);
   }
   state->ip = (src == 0 ? target : state->ip);
   return true;
@@ -1021,14 +1467,37 @@ U7_VM0_DEFINE_INSTRUCTION_EXEC(jump_if_zero_f64) {
   const double src = *u7_vm0_state_local_f64(state, self->arg1.i64);
   const size_t target = (size_t)self->arg2.i64;
   if (target >= state->instructions_size) {
-    return u7_vm0_panic(
-        state, u7_errnof(ERANGE, "u7_jump_if_zero: label is out of range: %zu",
-                         target));
+    return u7_vm0_fault(state, self, ERANGE, U7_VM0_FAULT_LABEL_OUT_OF_RANGE,
+                        "u7_jump_if_zero", (int64_t)target, 0);
   }
   state->ip = (src == 0 ? target : state->ip);
   return true;
 }
 
+U7_VM0_DEFINE_INSTRUCTION_EXEC(jump_if_zero_i32_unchecked) {
+  const int32_t src = *u7_vm0_state_local_i32(state, self->arg1.i64);
+  state->ip = (src == 0 ? (size_t)self->arg2.i64 : state->ip);
+  return true;
+}
+
+U7_VM0_DEFINE_INSTRUCTION_EXEC(jump_if_zero_i64_unchecked) {
+  const int64_t src = *u7_vm0_state_local_i64(state, self->arg1.i64);
+  state->ip = (src == 0 ? (size_t)self->arg2.i64 : state->ip);
+  return true;
+}
+
+U7_VM0_DEFINE_INSTRUCTION_EXEC(jump_if_zero_f32_unchecked) {
+  const float src = *u7_vm0_state_local_f32(state, self->arg1.i64);
+  state->ip = (src == 0 ? (size_t)self->arg2.i64 : state->ip);
+  return true;
+}
+
+U7_VM0_DEFINE_INSTRUCTION_EXEC(jump_if_zero_f64_unchecked) {
+  const double src = *u7_vm0_state_local_f64(state, self->arg1.i64);
+  state->ip = (src == 0 ? (size_t)self->arg2.i64 : state->ip);
+  return true;
+}
+
 struct u7_vm0_instruction u7_vm0_jump_if_zero(u7_error* error,
                                               struct u7_vm0_arg src,
                                               struct u7_vm0_arg label) {
@@ -1068,10 +1537,8 @@ U7_VM0_DEFINE_INSTRUCTION_EXEC(jump_if_not_zero_i32) {
   const int32_t src = *u7_vm0_state_local_i32(state, self->arg1.i64);
   const size_t target = (size_t)self->arg2.i64;
   if (target >= state->instructions_size) {
-    return u7_vm0_panic(
-        state,
-        u7_errnof(ERANGE, "u7_jump_if_not_zero: label is out of range: %zu",
-                  target));
+    return u7_vm0_fault(state, self, ERANGE, U7_VM0_FAULT_LABEL_OUT_OF_RANGE,
+                        "u7_jump_if_not_zero", (int64_t)target, 0);
   }
   state->ip = (src != 0 ? target : state->ip);
   return true;
@@ -1081,10 +1548,8 @@ U7_VM0_DEFINE_INSTRUCTION_EXEC(jump_if_not_zero_i64) {
   const int64_t src = *u7_vm0_state_local_i64(state, self->arg1.i64);
   const size_t target = (size_t)self->arg2.i64;
   if (target >= state->instructions_size) {
-    return u7_vm0_panic(
-        state,
-        u7_errnof(ERANGE, "u7_jump_if_not_zero: label is out of range: %zu",
-                  target));
+    return u7_vm0_fault(state, self, ERANGE, U7_VM0_FAULT_LABEL_OUT_OF_RANGE,
+                        "u7_jump_if_not_zero", (int64_t)target, 0);
   }
   state->ip = (src != 0 ? target : state->ip);
   return true;
@@ -1094,10 +1559,8 @@ U7_VM0_DEFINE_INSTRUCTION_EXEC(jump_if_not_zero_f32) {
   const float src = *u7_vm0_state_local_f32(state, self->arg1.i64);
   const size_t target = (size_t)self->arg2.i64;
   if (target >= state->instructions_size) {
-    return u7_vm0_panic(
-        state,
-        u7_errnof(ERANGE, "u7_jump_if_not_zero: label is out of range: %zu",
-                  target));
+    return u7_vm0_fault(state, self, ERANGE, U7_VM0_FAULT_LABEL_OUT_OF_RANGE,
+                        "u7_jump_if_not_zero", (int64_t)target, 0);
   }
   state->ip = (src != 0 ? target : state->ip);
   return true;
@@ -1107,15 +1570,37 @@ U7_VM0_DEFINE_INSTRUCTION_EXEC(jump_if_not_zero_f64) {
   const double src = *u7_vm0_state_local_f64(state, self->arg1.i64);
   const size_t target = (size_t)self->arg2.i64;
   if (target >= state->instructions_size) {
-    return u7_vm0_panic(
-        state,
-        u7_errnof(ERANGE, "u7_jump_if_not_zero: label is out of range: %zu",
-                  target));
+    return u7_vm0_fault(state, self, ERANGE, U7_VM0_FAULT_LABEL_OUT_OF_RANGE,
+                        "u7_jump_if_not_zero", (int64_t)target, 0);
   }
   state->ip = (src != 0 ? target : state->ip);
   return true;
 }
 
+U7_VM0_DEFINE_INSTRUCTION_EXEC(jump_if_not_zero_i32_unchecked) {
+  const int32_t src = *u7_vm0_state_local_i32(state, self->arg1.i64);
+  state->ip = (src != 0 ? (size_t)self->arg2.i64 : state->ip);
+  return true;
+}
+
+U7_VM0_DEFINE_INSTRUCTION_EXEC(jump_if_not_zero_i64_unchecked) {
+  const int64_t src = *u7_vm0_state_local_i64(state, self->arg1.i64);
+  state->ip = (src != 0 ? (size_t)self->arg2.i64 : state->ip);
+  return true;
+}
+
+U7_VM0_DEFINE_INSTRUCTION_EXEC(jump_if_not_zero_f32_unchecked) {
+  const float src = *u7_vm0_state_local_f32(state, self->arg1.i64);
+  state->ip = (src != 0 ? (size_t)self->arg2.i64 : state->ip);
+  return true;
+}
+
+U7_VM0_DEFINE_INSTRUCTION_EXEC(jump_if_not_zero_f64_unchecked) {
+  const double src = *u7_vm0_state_local_f64(state, self->arg1.i64);
+  state->ip = (src != 0 ? (size_t)self->arg2.i64 : state->ip);
+  return true;
+}
+
 struct u7_vm0_instruction u7_vm0_jump_if_not_zero(u7_error* error,
                                                   struct u7_vm0_arg src,
                                                   struct u7_vm0_arg label) {
@@ -1150,3 +1635,786 @@ struct u7_vm0_instruction u7_vm0_jump_if_not_zero(u7_error* error,
   }
   return result;
 }
+
+U7_VM0_DEFINE_INSTRUCTION_EXEC(jump) {
+  const size_t target = (size_t)self->arg1.i64;
+  if (target >= state->instructions_size) {
+    return u7_vm0_fault(state, self, ERANGE, U7_VM0_FAULT_LABEL_OUT_OF_RANGE,
+                        "u7_vm0_jump", (int64_t)target, 0);
+  }
+  state->ip = target;
+  return true;
+}
+
+U7_VM0_DEFINE_INSTRUCTION_EXEC(jump_unchecked) {
+  state->ip = (size_t)self->arg1.i64;
+  return true;
+}
+
+struct u7_vm0_instruction u7_vm0_jump(u7_error* error,
+                                      struct u7_vm0_arg label) {
+  struct u7_vm0_instruction result = {
+      .base = {.execute_fn = jump_exec},
+      .arg1 = label.value,
+  };
+  if (error->error_code != 0) {
+    return result;
+  }
+  if (label.kind != U7_VM0_ARG_KIND_I64_LABEL) {
+    *error = u7_vm0_unsupported_arg_kind_error("u7_vm0_jump", "label",
+                                               label.kind);
+  }
+  return result;
+}
+
+// The checked variant goes to the entry, which is a jump that checks its own
+// label. The unchecked one reads the label of the entry, which follows the
+// instruction in its array: state->instructions may hold wrappers (see
+// u7_vm0_profile_init()), not the instructions themselves. A negative index
+// converts to a value above any count.
+#define U7_VM0_DEFINE_JUMP_TABLE_EXEC(type)                                   \
+  U7_VM0_DEFINE_INSTRUCTION_EXEC(jump_table_##type) {                         \
+    const uint64_t index =                                                    \
+        (uint64_t)(int64_t)*u7_vm0_state_local_##type(state, self->arg1.i64); \
+    const size_t count = (size_t)self->arg2.i64;                              \
+    const size_t target = (size_t)self->arg3.i64;                             \
+    if (target >= state->instructions_size) {                                 \
+      return u7_vm0_fault(state, self, ERANGE,                                \
+                          U7_VM0_FAULT_LABEL_OUT_OF_RANGE,                    \
+                          "u7_vm0_jump_table", (int64_t)target, 0);           \
+    }                                                                         \
+    if (count > state->instructions_size - state->ip) {                       \
+      return u7_vm0_fault(state, self, ERANGE,                                \
+                          U7_VM0_FAULT_LABEL_OUT_OF_RANGE,                    \
+                          "u7_vm0_jump_table",                                \
+                          (int64_t)(state->ip + count - 1), 0);               \
+    }                                                                         \
+    state->ip = (index < count ? state->ip + (size_t)index : target);         \
+    return true;                                                              \
+  }                                                                           \
+                                                                              \
+  U7_VM0_DEFINE_INSTRUCTION_EXEC(jump_table_##type##_unchecked) {             \
+    const uint64_t index =                                                    \
+        (uint64_t)(int64_t)*u7_vm0_state_local_##type(state, self->arg1.i64); \
+    if (index < (uint64_t)self->arg2.i64) {                                   \
+      state->ip = (size_t)self[1 + index].arg1.i64;                           \
+    } else {                                                                  \
+      state->ip = (size_t)self->arg3.i64;                                     \
+    }                                                                         \
+    return true;                                                              \
+  }
+
+U7_VM0_DEFINE_JUMP_TABLE_EXEC(i32)
+U7_VM0_DEFINE_JUMP_TABLE_EXEC(i64)
+
+struct u7_vm0_instruction u7_vm0_jump_table(u7_error* error,
+                                            struct u7_vm0_arg src,
+                                            int64_t count,
+                                            struct u7_vm0_arg label) {
+  struct u7_vm0_instruction result = {
+      .arg1 = src.value,
+      .arg2.i64 = count,
+      .arg3 = label.value,
+  };
+  if (error->error_code != 0) {
+    return result;
+  }
+  if (count < 0) {
+    *error = u7_errnof(EINVAL, "u7_vm0_jump_table: negative count: %" PRId64,
+                       count);
+    return result;
+  }
+  if (label.kind != U7_VM0_ARG_KIND_I64_LABEL) {
+    *error = u7_vm0_unsupported_arg_kind_error("u7_vm0_jump_table", "label",
+                                               label.kind);
+    return result;
+  }
+  switch (src.kind) {
+    case U7_VM0_ARG_KIND_I32_VARIABLE:
+      result.base.execute_fn = jump_table_i32_exec;
+      break;
+    case U7_VM0_ARG_KIND_I64_VARIABLE:
+      result.base.execute_fn = jump_table_i64_exec;
+      break;
+    default:
+      *error = u7_vm0_unsupported_arg_kind_error("u7_vm0_jump_table", "src",
+                                                 src.kind);
+  }
+  return result;
+}
+
+// Defines the checked and the unchecked variants of a compare-and-branch;
+// `rhs` reads the second operand.
+#define U7_VM0_DEFINE_JUMP_IF_COMPARE_EXEC(name, type, form, op, rhs)         \
+  U7_VM0_DEFINE_INSTRUCTION_EXEC(jump_if_##name##_##type##form) {             \
+    const bool taken =                                                        \
+        (*u7_vm0_state_local_##type(state, self->arg1.i64) op(rhs));          \
+    const size_t target = (size_t)self->arg3.i64;                             \
+    if (target >= state->instructions_size) {                                 \
+      return u7_vm0_fault(state, self, ERANGE,                                \
+                          U7_VM0_FAULT_LABEL_OUT_OF_RANGE,                    \
+                          "u7_vm0_jump_if_" #name, (int64_t)target, 0);       \
+    }                                                                         \
+    state->ip = (taken ? target : state->ip);                                 \
+    return true;                                                              \
+  }                                                                           \
+                                                                              \
+  U7_VM0_DEFINE_INSTRUCTION_EXEC(jump_if_##name##_##type##form##_unchecked) { \
+    const bool taken =                                                        \
+        (*u7_vm0_state_local_##type(state, self->arg1.i64) op(rhs));          \
+    state->ip = (taken ? (size_t)self->arg3.i64 : state->ip);                 \
+    return true;                                                              \
+  }
+
+#define U7_VM0_DEFINE_JUMP_IF_COMPARE_VC_EXECS(name, op)                \
+  U7_VM0_DEFINE_JUMP_IF_COMPARE_EXEC(name, i32, vc, op, self->arg2.i32) \
+  U7_VM0_DEFINE_JUMP_IF_COMPARE_EXEC(name, i64, vc, op, self->arg2.i64) \
+  U7_VM0_DEFINE_JUMP_IF_COMPARE_EXEC(name, f32, vc, op, self->arg2.f32) \
+  U7_VM0_DEFINE_JUMP_IF_COMPARE_EXEC(name, f64, vc, op, self->arg2.f64)
+
+#define U7_VM0_DEFINE_JUMP_IF_COMPARE_VV_EXECS(name, op)                 \
+  U7_VM0_DEFINE_JUMP_IF_COMPARE_EXEC(                                    \
+      name, i32, vv, op, *u7_vm0_state_local_i32(state, self->arg2.i64)) \
+  U7_VM0_DEFINE_JUMP_IF_COMPARE_EXEC(                                    \
+      name, i64, vv, op, *u7_vm0_state_local_i64(state, self->arg2.i64)) \
+  U7_VM0_DEFINE_JUMP_IF_COMPARE_EXEC(                                    \
+      name, f32, vv, op, *u7_vm0_state_local_f32(state, self->arg2.i64)) \
+  U7_VM0_DEFINE_JUMP_IF_COMPARE_EXEC(                                    \
+      name, f64, vv, op, *u7_vm0_state_local_f64(state, self->arg2.i64))
+
+U7_VM0_DEFINE_JUMP_IF_COMPARE_VC_EXECS(equal, ==)
+U7_VM0_DEFINE_JUMP_IF_COMPARE_VV_EXECS(equal, ==)
+U7_VM0_DEFINE_JUMP_IF_COMPARE_VC_EXECS(not_equal, !=)
+U7_VM0_DEFINE_JUMP_IF_COMPARE_VV_EXECS(not_equal, !=)
+U7_VM0_DEFINE_JUMP_IF_COMPARE_VC_EXECS(less, <)
+U7_VM0_DEFINE_JUMP_IF_COMPARE_VV_EXECS(less, <)
+U7_VM0_DEFINE_JUMP_IF_COMPARE_VC_EXECS(less_or_equal, <=)
+U7_VM0_DEFINE_JUMP_IF_COMPARE_VV_EXECS(less_or_equal, <=)
+U7_VM0_DEFINE_JUMP_IF_COMPARE_VC_EXECS(greater, >)
+U7_VM0_DEFINE_JUMP_IF_COMPARE_VC_EXECS(greater_or_equal, >=)
+
+// The part of a compare-and-branch constructor for the operands of one type.
+#define U7_VM0_JUMP_IF_COMPARE_BY_RHS(name, vv_name, first, second, type, \
+                                      TYPE)                               \
+  if (rhs.kind == U7_VM0_ARG_KIND_##TYPE##_CONSTANT) {                    \
+    result.base.execute_fn = jump_if_##name##_##type##vc_exec;            \
+  } else if (rhs.kind == U7_VM0_ARG_KIND_##TYPE##_VARIABLE) {             \
+    result.arg1 = first.value;                                            \
+    result.arg2 = second.value;                                           \
+    result.base.execute_fn = jump_if_##vv_name##_##type##vv_exec;         \
+  } else {                                                                \
+    *error = u7_vm0_unsupported_arg_kind_error(                           \
+        "u7_vm0_jump_if_" #name "_" #type, "rhs", rhs.kind);              \
+  }
+
+// Defines u7_vm0_jump_if_<name>(); two variables are compared by
+// `jump_if_<vv_name>`, with `first` and `second` as its operands.
+#define U7_VM0_DEFINE_JUMP_IF_COMPARE(name, vv_name, first, second)         \
+  struct u7_vm0_instruction u7_vm0_jump_if_##name(                          \
+      u7_error* error, struct u7_vm0_arg lhs, struct u7_vm0_arg rhs,        \
+      struct u7_vm0_arg label) {                                            \
+    struct u7_vm0_instruction result = {                                    \
+        .arg1 = lhs.value,                                                  \
+        .arg2 = rhs.value,                                                  \
+        .arg3 = label.value,                                                \
+    };                                                                      \
+    if (error->error_code != 0) {                                           \
+      return result;                                                        \
+    }                                                                       \
+    if (label.kind != U7_VM0_ARG_KIND_I64_LABEL) {                          \
+      *error = u7_vm0_unsupported_arg_kind_error("u7_vm0_jump_if_" #name,   \
+                                                 "label", label.kind);      \
+      return result;                                                        \
+    }                                                                       \
+    if (lhs.kind == U7_VM0_ARG_KIND_I32_VARIABLE) {                         \
+      U7_VM0_JUMP_IF_COMPARE_BY_RHS(name, vv_name, first, second, i32, I32) \
+    } else if (lhs.kind == U7_VM0_ARG_KIND_I64_VARIABLE) {                  \
+      U7_VM0_JUMP_IF_COMPARE_BY_RHS(name, vv_name, first, second, i64, I64) \
+    } else if (lhs.kind == U7_VM0_ARG_KIND_F32_VARIABLE) {                  \
+      U7_VM0_JUMP_IF_COMPARE_BY_RHS(name, vv_name, first, second, f32, F32) \
+    } else if (lhs.kind == U7_VM0_ARG_KIND_F64_VARIABLE) {                  \
+      U7_VM0_JUMP_IF_COMPARE_BY_RHS(name, vv_name, first, second, f64, F64) \
+    } else {                                                                \
+      *error = u7_vm0_unsupported_arg_kind_error("u7_vm0_jump_if_" #name,   \
+                                                 "lhs", lhs.kind);          \
+    }                                                                       \
+    return result;                                                          \
+  }
+
+U7_VM0_DEFINE_JUMP_IF_COMPARE(equal, equal, lhs, rhs)
+U7_VM0_DEFINE_JUMP_IF_COMPARE(not_equal, not_equal, lhs, rhs)
+U7_VM0_DEFINE_JUMP_IF_COMPARE(less, less, lhs, rhs)
+U7_VM0_DEFINE_JUMP_IF_COMPARE(less_or_equal, less_or_equal, lhs, rhs)
+// `a > b` and `a >= b` compare two variables as `b < a` and `b <= a`.
+U7_VM0_DEFINE_JUMP_IF_COMPARE(greater, less, rhs, lhs)
+U7_VM0_DEFINE_JUMP_IF_COMPARE(greater_or_equal, less_or_equal, rhs, lhs)
+
+// Fused instructions; see u7_vm0_fuse().
+
+U7_VM0_DEFINE_INSTRUCTION_EXEC(bitwise_and_jump_if_zero_i32vc) {
+  const int32_t result =
+      *u7_vm0_state_local_i32(
+          state, u7_vm0_operand_pair_second(self->arg1.i64)) &
+      self->arg2.i32;
+  *u7_vm0_state_local_i32(state, u7_vm0_operand_pair_first(self->arg1.i64)) =
+      result;
+  state->ip = (result == 0 ? (size_t)self->arg3.i64 : state->ip);
+  return true;
+}
+
+U7_VM0_DEFINE_INSTRUCTION_EXEC(bitwise_and_jump_if_not_zero_i32vc) {
+  const int32_t result =
+      *u7_vm0_state_local_i32(
+          state, u7_vm0_operand_pair_second(self->arg1.i64)) &
+      self->arg2.i32;
+  *u7_vm0_state_local_i32(state, u7_vm0_operand_pair_first(self->arg1.i64)) =
+      result;
+  state->ip = (result != 0 ? (size_t)self->arg3.i64 : state->ip);
+  return true;
+}
+
+U7_VM0_DEFINE_INSTRUCTION_EXEC(bitwise_and_jump_if_zero_i64vc) {
+  const int64_t result =
+      *u7_vm0_state_local_i64(
+          state, u7_vm0_operand_pair_second(self->arg1.i64)) &
+      self->arg2.i64;
+  *u7_vm0_state_local_i64(state, u7_vm0_operand_pair_first(self->arg1.i64)) =
+      result;
+  state->ip = (result == 0 ? (size_t)self->arg3.i64 : state->ip);
+  return true;
+}
+
+U7_VM0_DEFINE_INSTRUCTION_EXEC(bitwise_and_jump_if_not_zero_i64vc) {
+  const int64_t result =
+      *u7_vm0_state_local_i64(
+          state, u7_vm0_operand_pair_second(self->arg1.i64)) &
+      self->arg2.i64;
+  *u7_vm0_state_local_i64(state, u7_vm0_operand_pair_first(self->arg1.i64)) =
+      result;
+  state->ip = (result != 0 ? (size_t)self->arg3.i64 : state->ip);
+  return true;
+}
+
+U7_VM0_DEFINE_INSTRUCTION_EXEC(bitwise_left_shift_jump_if_not_zero_i32vc) {
+  const int32_t result =
+      *u7_vm0_state_local_i32(
+          state, u7_vm0_operand_pair_second(self->arg1.i64)) <<
+      self->arg2.i32;
+  *u7_vm0_state_local_i32(state, u7_vm0_operand_pair_first(self->arg1.i64)) =
+      result;
+  state->ip = (result != 0 ? (size_t)self->arg3.i64 : state->ip);
+  return true;
+}
+
+U7_VM0_DEFINE_INSTRUCTION_EXEC(bitwise_right_shift_jump_if_not_zero_i32vc) {
+  const int32_t result =
+      *u7_vm0_state_local_i32(
+          state, u7_vm0_operand_pair_second(self->arg1.i64)) >>
+      self->arg2.i32;
+  *u7_vm0_state_local_i32(state, u7_vm0_operand_pair_first(self->arg1.i64)) =
+      result;
+  state->ip = (result != 0 ? (size_t)self->arg3.i64 : state->ip);
+  return true;
+}
+
+U7_VM0_DEFINE_INSTRUCTION_EXEC(bitwise_left_shift_jump_if_not_zero_i64vc) {
+  const int64_t result =
+      *u7_vm0_state_local_i64(
+          state, u7_vm0_operand_pair_second(self->arg1.i64)) <<
+      self->arg2.i64;
+  *u7_vm0_state_local_i64(state, u7_vm0_operand_pair_first(self->arg1.i64)) =
+      result;
+  state->ip = (result != 0 ? (size_t)self->arg3.i64 : state->ip);
+  return true;
+}
+
+U7_VM0_DEFINE_INSTRUCTION_EXEC(bitwise_right_shift_jump_if_not_zero_i64vc) {
+  const int64_t result =
+      *u7_vm0_state_local_i64(
+          state, u7_vm0_operand_pair_second(self->arg1.i64)) >>
+      self->arg2.i64;
+  *u7_vm0_state_local_i64(state, u7_vm0_operand_pair_first(self->arg1.i64)) =
+      result;
+  state->ip = (result != 0 ? (size_t)self->arg3.i64 : state->ip);
+  return true;
+}
+
+U7_VM0_DEFINE_INSTRUCTION_EXEC(math_add_2_f64vv) {
+  *u7_vm0_state_local_f64(state, u7_vm0_operand_pair_first(self->arg1.i64)) =
+      *u7_vm0_state_local_f64(state,
+                              u7_vm0_operand_pair_first(self->arg2.i64)) +
+      *u7_vm0_state_local_f64(state,
+                              u7_vm0_operand_pair_second(self->arg2.i64));
+  *u7_vm0_state_local_f64(state, u7_vm0_operand_pair_second(self->arg1.i64)) =
+      *u7_vm0_state_local_f64(state,
+                              u7_vm0_operand_pair_first(self->arg3.i64)) +
+      *u7_vm0_state_local_f64(state,
+                              u7_vm0_operand_pair_second(self->arg3.i64));
+  return true;
+}
+
+U7_VM0_DEFINE_INSTRUCTION_EXEC(math_multiply_2_f64vv) {
+  *u7_vm0_state_local_f64(state, u7_vm0_operand_pair_first(self->arg1.i64)) =
+      *u7_vm0_state_local_f64(state,
+                              u7_vm0_operand_pair_first(self->arg2.i64)) *
+      *u7_vm0_state_local_f64(state,
+                              u7_vm0_operand_pair_second(self->arg2.i64));
+  *u7_vm0_state_local_f64(state, u7_vm0_operand_pair_second(self->arg1.i64)) =
+      *u7_vm0_state_local_f64(state,
+                              u7_vm0_operand_pair_first(self->arg3.i64)) *
+      *u7_vm0_state_local_f64(state,
+                              u7_vm0_operand_pair_second(self->arg3.i64));
+  return true;
+}
+
+// Computes the product and the sum separately (no single-rounding fma), so
+// the result is the same as of the original instruction pair.
+U7_VM0_DEFINE_INSTRUCTION_EXEC(math_multiply_add_f64vvv) {
+  *u7_vm0_state_local_f64(state, u7_vm0_operand_pair_first(self->arg1.i64)) =
+      *u7_vm0_state_local_f64(state,
+                              u7_vm0_operand_pair_first(self->arg2.i64)) *
+      *u7_vm0_state_local_f64(state,
+                              u7_vm0_operand_pair_second(self->arg2.i64));
+  *u7_vm0_state_local_f64(state, u7_vm0_operand_pair_second(self->arg1.i64)) =
+      *u7_vm0_state_local_f64(state,
+                              u7_vm0_operand_pair_first(self->arg1.i64)) +
+      *u7_vm0_state_local_f64(state, self->arg3.i64);
+  return true;
+}
+
+// The vector instructions process `count` consecutive variables; the offsets
+// of the source arrays are packed into a pair.
+#define U7_VM0_DEFINE_VECTOR_EXEC(type_name, type)                  \
+  U7_VM0_DEFINE_INSTRUCTION_EXEC(vector_add_##type_name) {          \
+    u7_vm0_vector_add_##type_name(                                  \
+        u7_vm0_state_local_##type_name(state, self->arg1.i64),      \
+        u7_vm0_state_local_##type_name(                             \
+            state, u7_vm0_operand_pair_first(self->arg3.i64)),      \
+        u7_vm0_state_local_##type_name(                             \
+            state, u7_vm0_operand_pair_second(self->arg3.i64)),     \
+        (size_t)self->arg2.i64);                                    \
+    return true;                                                    \
+  }                                                                 \
+  U7_VM0_DEFINE_INSTRUCTION_EXEC(vector_multiply_##type_name) {     \
+    u7_vm0_vector_multiply_##type_name(                             \
+        u7_vm0_state_local_##type_name(state, self->arg1.i64),      \
+        u7_vm0_state_local_##type_name(                             \
+            state, u7_vm0_operand_pair_first(self->arg3.i64)),      \
+        u7_vm0_state_local_##type_name(                             \
+            state, u7_vm0_operand_pair_second(self->arg3.i64)),     \
+        (size_t)self->arg2.i64);                                    \
+    return true;                                                    \
+  }                                                                 \
+  U7_VM0_DEFINE_INSTRUCTION_EXEC(vector_multiply_add_##type_name) { \
+    u7_vm0_vector_multiply_add_##type_name(                         \
+        u7_vm0_state_local_##type_name(state, self->arg1.i64),      \
+        u7_vm0_state_local_##type_name(                             \
+            state, u7_vm0_operand_pair_first(self->arg3.i64)),      \
+        u7_vm0_state_local_##type_name(                             \
+            state, u7_vm0_operand_pair_second(self->arg3.i64)),     \
+        (size_t)self->arg2.i64);                                    \
+    return true;                                                    \
+  }                                                                 \
+  U7_VM0_DEFINE_INSTRUCTION_EXEC(vector_dot_##type_name) {          \
+    *u7_vm0_state_local_##type_name(state, self->arg1.i64) =        \
+        u7_vm0_vector_dot_##type_name(                              \
+            u7_vm0_state_local_##type_name(                         \
+                state, u7_vm0_operand_pair_first(self->arg2.i64)),  \
+            u7_vm0_state_local_##type_name(                         \
+                state, u7_vm0_operand_pair_second(self->arg2.i64)), \
+            (size_t)self->arg3.i64);                                \
+    return true;                                                    \
+  }                                                                 \
+  U7_VM0_DEFINE_INSTRUCTION_EXEC(vector_sum_##type_name) {          \
+    *u7_vm0_state_local_##type_name(state, self->arg1.i64) =        \
+        u7_vm0_vector_sum_##type_name(                              \
+            u7_vm0_state_local_##type_name(state, self->arg2.i64),  \
+            (size_t)self->arg3.i64);                                \
+    return true;                                                    \
+  }                                                                 \
+  U7_VM0_DEFINE_INSTRUCTION_EXEC(vector_broadcast_##type_name) {    \
+    u7_vm0_vector_broadcast_##type_name(                            \
+        u7_vm0_state_local_##type_name(state, self->arg1.i64),      \
+        *u7_vm0_state_local_##type_name(state, self->arg3.i64),     \
+        (size_t)self->arg2.i64);                                    \
+    return true;                                                    \
+  }
+
+U7_VM0_DEFINE_VECTOR_EXEC(f32, float)
+U7_VM0_DEFINE_VECTOR_EXEC(f64, double)
+
+// Checks the source arrays of an instruction, which must be variables of
+// the same kind as `dst`, and packs their offsets into `sources`.
+static bool u7_vm0_array_pair_check(u7_error* error,
+                                    const char* instruction_name,
+                                    struct u7_vm0_arg dst,
+                                    struct u7_vm0_arg lhs,
+                                    struct u7_vm0_arg rhs, int64_t count,
+                                    bool dst_is_array, int64_t* sources) {
+  if (lhs.kind != dst.kind) {
+    *error = u7_vm0_unsupported_arg_kind_error(instruction_name, "lhs",
+                                               lhs.kind);
+    return false;
+  }
+  if (rhs.kind != dst.kind) {
+    *error = u7_vm0_unsupported_arg_kind_error(instruction_name, "rhs",
+                                               rhs.kind);
+    return false;
+  }
+  if (lhs.value.i64 < 0 || lhs.value.i64 > INT32_MAX || rhs.value.i64 < 0 ||
+      rhs.value.i64 > INT32_MAX) {
+    *error = u7_errnof(ERANGE, "%s: offset is out of range", instruction_name);
+    return false;
+  }
+  const uint64_t element_size =
+      (dst.kind == U7_VM0_ARG_KIND_F32_VARIABLE ? sizeof(float)
+                                                : sizeof(int64_t));
+  const int64_t offsets[2] = {lhs.value.i64, rhs.value.i64};
+  for (int i = 0; dst_is_array && i < 2; ++i) {
+    const uint64_t distance =
+        (offsets[i] < dst.value.i64
+             ? (uint64_t)dst.value.i64 - (uint64_t)offsets[i]
+             : (uint64_t)offsets[i] - (uint64_t)dst.value.i64);
+    if (distance != 0 && distance / element_size < (uint64_t)count) {
+      *error = u7_errnof(EINVAL, "%s: %s partially overlaps dst",
+                         instruction_name, (i == 0 ? "lhs" : "rhs"));
+      return false;
+    }
+  }
+  *sources =
+      u7_vm0_operand_pair((int32_t)lhs.value.i64, (int32_t)rhs.value.i64);
+  return true;
+}
+
+// Checks the arguments of a vector instruction with two source arrays, and
+// packs their offsets into `sources`.
+static bool u7_vm0_vector_check(u7_error* error, const char* instruction_name,
+                                struct u7_vm0_arg dst, struct u7_vm0_arg lhs,
+                                struct u7_vm0_arg rhs, int64_t count,
+                                bool dst_is_array, int64_t* sources) {
+  if (count < 0) {
+    *error = u7_errnof(EINVAL, "%s: negative count: %" PRId64,
+                       instruction_name, count);
+    return false;
+  }
+  if (dst.kind != U7_VM0_ARG_KIND_F32_VARIABLE &&
+      dst.kind != U7_VM0_ARG_KIND_F64_VARIABLE) {
+    *error = u7_vm0_unsupported_arg_kind_error(instruction_name, "dst",
+                                               dst.kind);
+    return false;
+  }
+  return u7_vm0_array_pair_check(error, instruction_name, dst, lhs, rhs,
+                                 count, dst_is_array, sources);
+}
+
+#define U7_VM0_DEFINE_VECTOR_INSTRUCTION(fn_name)                             \
+  struct u7_vm0_instruction u7_vm0_vector_##fn_name(                          \
+      u7_error* error, struct u7_vm0_arg dst, struct u7_vm0_arg lhs,          \
+      struct u7_vm0_arg rhs, int64_t count) {                                 \
+    struct u7_vm0_instruction result = {                                      \
+        .arg1 = dst.value,                                                    \
+        .arg2.i64 = count,                                                    \
+    };                                                                        \
+    if (error->error_code != 0 ||                                             \
+        !u7_vm0_vector_check(error, "u7_vm0_vector_" #fn_name, dst, lhs, rhs, \
+                             count, true, &result.arg3.i64)) {                \
+      return result;                                                          \
+    }                                                                         \
+    result.base.execute_fn = (dst.kind == U7_VM0_ARG_KIND_F32_VARIABLE        \
+                                  ? vector_##fn_name##_f32_exec               \
+                                  : vector_##fn_name##_f64_exec);             \
+    return result;                                                            \
+  }
+
+U7_VM0_DEFINE_VECTOR_INSTRUCTION(add)
+U7_VM0_DEFINE_VECTOR_INSTRUCTION(multiply)
+U7_VM0_DEFINE_VECTOR_INSTRUCTION(multiply_add)
+
+struct u7_vm0_instruction u7_vm0_vector_dot(u7_error* error,
+                                            struct u7_vm0_arg dst,
+                                            struct u7_vm0_arg lhs,
+                                            struct u7_vm0_arg rhs,
+                                            int64_t count) {
+  struct u7_vm0_instruction result = {
+      .arg1 = dst.value,
+      .arg3.i64 = count,
+  };
+  if (error->error_code != 0 ||
+      !u7_vm0_vector_check(error, "u7_vm0_vector_dot", dst, lhs, rhs, count,
+                           false, &result.arg2.i64)) {
+    return result;
+  }
+  result.base.execute_fn =
+      (dst.kind == U7_VM0_ARG_KIND_F32_VARIABLE ? vector_dot_f32_exec
+                                                : vector_dot_f64_exec);
+  return result;
+}
+
+struct u7_vm0_instruction u7_vm0_vector_sum(u7_error* error,
+                                            struct u7_vm0_arg dst,
+                                            struct u7_vm0_arg src,
+                                            int64_t count) {
+  struct u7_vm0_instruction result = {
+      .arg1 = dst.value,
+      .arg2 = src.value,
+      .arg3.i64 = count,
+  };
+  if (error->error_code != 0) {
+    return result;
+  }
+  if (count < 0) {
+    *error = u7_errnof(EINVAL, "u7_vm0_vector_sum: negative count: %" PRId64,
+                       count);
+    return result;
+  }
+  if (dst.kind == U7_VM0_ARG_KIND_F32_VARIABLE &&
+      src.kind == U7_VM0_ARG_KIND_F32_VARIABLE) {
+    result.base.execute_fn = vector_sum_f32_exec;
+  } else if (dst.kind == U7_VM0_ARG_KIND_F64_VARIABLE &&
+             src.kind == U7_VM0_ARG_KIND_F64_VARIABLE) {
+    result.base.execute_fn = vector_sum_f64_exec;
+  } else if (dst.kind == U7_VM0_ARG_KIND_F32_VARIABLE ||
+             dst.kind == U7_VM0_ARG_KIND_F64_VARIABLE) {
+    *error =
+        u7_vm0_unsupported_arg_kind_error("u7_vm0_vector_sum", "src", src.kind);
+  } else {
+    *error =
+        u7_vm0_unsupported_arg_kind_error("u7_vm0_vector_sum", "dst", dst.kind);
+  }
+  return result;
+}
+
+struct u7_vm0_instruction u7_vm0_vector_broadcast(u7_error* error,
+                                                  struct u7_vm0_arg dst,
+                                                  struct u7_vm0_arg src,
+                                                  int64_t count) {
+  struct u7_vm0_instruction result = {
+      .arg1 = dst.value,
+      .arg2.i64 = count,
+      .arg3 = src.value,
+  };
+  if (error->error_code != 0) {
+    return result;
+  }
+  if (count < 0) {
+    *error = u7_errnof(
+        EINVAL, "u7_vm0_vector_broadcast: negative count: %" PRId64, count);
+    return result;
+  }
+  if (dst.kind == U7_VM0_ARG_KIND_F32_VARIABLE &&
+      src.kind == U7_VM0_ARG_KIND_F32_VARIABLE) {
+    result.base.execute_fn = vector_broadcast_f32_exec;
+  } else if (dst.kind == U7_VM0_ARG_KIND_F64_VARIABLE &&
+             src.kind == U7_VM0_ARG_KIND_F64_VARIABLE) {
+    result.base.execute_fn = vector_broadcast_f64_exec;
+  } else if (dst.kind == U7_VM0_ARG_KIND_F32_VARIABLE ||
+             dst.kind == U7_VM0_ARG_KIND_F64_VARIABLE) {
+    *error = u7_vm0_unsupported_arg_kind_error("u7_vm0_vector_broadcast",
+                                               "src", src.kind);
+  } else {
+    *error = u7_vm0_unsupported_arg_kind_error("u7_vm0_vector_broadcast",
+                                               "dst", dst.kind);
+  }
+  return result;
+}
+
+// The matrices are row-major arrays of n * n variables. The loops have
+// constant bounds, so the compiler unrolls them. The product is computed
+// into a temporary, so `dst` may coincide with a source, and it is not
+// written if an overflow occurs.
+#define U7_VM0_DEFINE_MATRIX_MULTIPLY_EXEC(n)                             \
+  U7_VM0_DEFINE_INSTRUCTION_EXEC(matrix_multiply_##n##x##n##_i64) {       \
+    int64_t const* lhs = u7_vm0_state_local_i64(                          \
+        state, u7_vm0_operand_pair_first(self->arg3.i64));                \
+    int64_t const* rhs = u7_vm0_state_local_i64(                          \
+        state, u7_vm0_operand_pair_second(self->arg3.i64));               \
+    int64_t result[n * n];                                                \
+    for (int i = 0; i < n; ++i) {                                         \
+      for (int j = 0; j < n; ++j) {                                       \
+        int64_t sum = 0;                                                  \
+        for (int k = 0; k < n; ++k) {                                     \
+          int64_t product;                                                \
+          if (__builtin_mul_overflow(lhs[i * n + k], rhs[k * n + j],      \
+                                     &product)) {                         \
+            return u7_vm0_fault(state, self, ERANGE,                      \
+                                U7_VM0_FAULT_INTEGER_OVERFLOW,            \
+                                "u7_vm0_matrix_multiply", lhs[i * n + k], \
+                                rhs[k * n + j]);                          \
+          }                                                               \
+          int64_t next;                                                   \
+          if (__builtin_add_overflow(sum, product, &next)) {              \
+            return u7_vm0_fault(state, self, ERANGE,                      \
+                                U7_VM0_FAULT_INTEGER_OVERFLOW,            \
+                                "u7_vm0_matrix_multiply", sum, product);  \
+          }                                                               \
+          sum = next;                                                     \
+        }                                                                 \
+        result[i * n + j] = sum;                                          \
+      }                                                                   \
+    }                                                                     \
+    memcpy(u7_vm0_state_local_i64(state, self->arg1.i64), result,         \
+           sizeof(result));                                               \
+    return true;                                                          \
+  }                                                                       \
+  U7_VM0_DEFINE_INSTRUCTION_EXEC(matrix_multiply_##n##x##n##_f64) {       \
+    double const* lhs = u7_vm0_state_local_f64(                           \
+        state, u7_vm0_operand_pair_first(self->arg3.i64));                \
+    double const* rhs = u7_vm0_state_local_f64(                           \
+        state, u7_vm0_operand_pair_second(self->arg3.i64));               \
+    double result[n * n];                                                 \
+    for (int i = 0; i < n; ++i) {                                         \
+      for (int j = 0; j < n; ++j) {                                       \
+        double sum = lhs[i * n] * rhs[j];                                 \
+        for (int k = 1; k < n; ++k) {                                     \
+          sum += lhs[i * n + k] * rhs[k * n + j];                         \
+        }                                                                 \
+        result[i * n + j] = sum;                                          \
+      }                                                                   \
+    }                                                                     \
+    memcpy(u7_vm0_state_local_f64(state, self->arg1.i64), result,         \
+           sizeof(result));                                               \
+    return true;                                                          \
+  }
+
+U7_VM0_DEFINE_MATRIX_MULTIPLY_EXEC(2)
+U7_VM0_DEFINE_MATRIX_MULTIPLY_EXEC(3)
+U7_VM0_DEFINE_MATRIX_MULTIPLY_EXEC(4)
+
+struct u7_vm0_instruction u7_vm0_matrix_multiply(u7_error* error,
+                                                 struct u7_vm0_arg dst,
+                                                 struct u7_vm0_arg lhs,
+                                                 struct u7_vm0_arg rhs,
+                                                 int64_t size) {
+  struct u7_vm0_instruction result = {
+      .arg1 = dst.value,
+      .arg2.i64 = size * size,
+  };
+  if (error->error_code != 0) {
+    return result;
+  }
+  if (size < 2 || size > 4) {
+    *error = u7_errnof(EINVAL,
+                       "u7_vm0_matrix_multiply: unsupported size: %" PRId64,
+                       size);
+    return result;
+  }
+  if (dst.kind != U7_VM0_ARG_KIND_I64_VARIABLE &&
+      dst.kind != U7_VM0_ARG_KIND_F64_VARIABLE) {
+    *error = u7_vm0_unsupported_arg_kind_error("u7_vm0_matrix_multiply", "dst",
+                                               dst.kind);
+    return result;
+  }
+  if (!u7_vm0_array_pair_check(error, "u7_vm0_matrix_multiply", dst, lhs, rhs,
+                               size * size, true, &result.arg3.i64)) {
+    return result;
+  }
+  const bool is_i64 = (dst.kind == U7_VM0_ARG_KIND_I64_VARIABLE);
+  switch (size) {
+    case 2:
+      result.base.execute_fn = (is_i64 ? matrix_multiply_2x2_i64_exec
+                                       : matrix_multiply_2x2_f64_exec);
+      break;
+    case 3:
+      result.base.execute_fn = (is_i64 ? matrix_multiply_3x3_i64_exec
+                                       : matrix_multiply_3x3_f64_exec);
+      break;
+    default:
+      result.base.execute_fn = (is_i64 ? matrix_multiply_4x4_i64_exec
+                                       : matrix_multiply_4x4_f64_exec);
+      break;
+  }
+  return result;
+}
+
+static const struct u7_vm0_opcode_info u7_vm0_opcode_infos[] = {
+#define U7_VM0_OPCODE_INFO_ITEM(opcode, exec_name, arg1_kind, arg2_kind, \
+                                arg3_kind)                               \
+  [U7_VM0_OPCODE_##opcode] = {                                           \
+      .base = {.execute_fn = exec_name##_exec},                          \
+      .name = #exec_name,                                                \
+      .operand_kinds = {U7_VM0_OPERAND_##arg1_kind,                      \
+                        U7_VM0_OPERAND_##arg2_kind,                      \
+                        U7_VM0_OPERAND_##arg3_kind},                     \
+  },
+    U7_VM0_OPCODES(U7_VM0_OPCODE_INFO_ITEM)
+#undef U7_VM0_OPCODE_INFO_ITEM
+};
+
+struct u7_vm0_opcode_info const* u7_vm0_opcode_info(enum u7_vm0_opcode opcode) {
+  assert(opcode >= 0 && opcode < U7_VM0_OPCODE_COUNT);
+  return &u7_vm0_opcode_infos[opcode];
+}
+
+// The opcodes ordered by the address of execute_fn, so that every pass can
+// look up the opcode of an instruction with a binary search.
+struct u7_vm0_opcode_by_address {
+  uintptr_t address;
+  enum u7_vm0_opcode opcode;
+};
+
+static struct u7_vm0_opcode_by_address
+    u7_vm0_opcodes_by_address[U7_VM0_OPCODE_COUNT];
+
+static pthread_once_t u7_vm0_opcodes_by_address_once = PTHREAD_ONCE_INIT;
+
+static int u7_vm0_opcode_by_address_compare(const void* lhs,
+                                            const void* rhs) {
+  struct u7_vm0_opcode_by_address const* const a = lhs;
+  struct u7_vm0_opcode_by_address const* const b = rhs;
+  if (a->address != b->address) {
+    return (a->address < b->address ? -1 : 1);
+  }
+  return (a->opcode < b->opcode ? -1 : a->opcode > b->opcode);
+}
+
+static void u7_vm0_opcodes_by_address_init(void) {
+  for (int i = 0; i < U7_VM0_OPCODE_COUNT; ++i) {
+    u7_vm0_opcodes_by_address[i].address =
+        (uintptr_t)u7_vm0_opcode_infos[i].base.execute_fn;
+    u7_vm0_opcodes_by_address[i].opcode = (enum u7_vm0_opcode)i;
+  }
+  qsort(u7_vm0_opcodes_by_address, U7_VM0_OPCODE_COUNT,
+        sizeof(u7_vm0_opcodes_by_address[0]),
+        &u7_vm0_opcode_by_address_compare);
+}
+
+enum u7_vm0_opcode u7_vm0_instruction_opcode(
+    struct u7_vm0_instruction const* instruction) {
+  pthread_once(&u7_vm0_opcodes_by_address_once,
+               &u7_vm0_opcodes_by_address_init);
+  const uintptr_t address = (uintptr_t)instruction->base.execute_fn;
+  // The first entry with the address, to return the lowest of the opcodes
+  // that share an execute_fn.
+  size_t begin = 0;
+  size_t end = U7_VM0_OPCODE_COUNT;
+  while (begin < end) {
+    const size_t middle = begin + (end - begin) / 2;
+    if (u7_vm0_opcodes_by_address[middle].address < address) {
+      begin = middle + 1;
+    } else {
+      end = middle;
+    }
+  }
+  if (begin == U7_VM0_OPCODE_COUNT ||
+      u7_vm0_opcodes_by_address[begin].address != address) {
+    return U7_VM0_OPCODE_UNKNOWN;
+  }
+  return u7_vm0_opcodes_by_address[begin].opcode;
+}
+
+enum u7_vm0_opcode u7_vm0_fault_opcode(struct u7_vm0_fault const* fault) {
+  const struct u7_vm0_instruction instruction = {
+      .base = {.execute_fn = fault->execute_fn}};
+  return u7_vm0_instruction_opcode(&instruction);
+}
+
+enum u7_vm0_opcode u7_vm0_opcode_by_name(const char* name, size_t name_size) {
+  for (int i = 0; i < U7_VM0_OPCODE_COUNT; ++i) {
+    const char* info_name = u7_vm0_opcode_infos[i].name;
+    if (strlen(info_name) == name_size &&
+        memcmp(info_name, name, name_size) == 0) {
+      return (enum u7_vm0_opcode)i;
+    }
+  }
+  return U7_VM0_OPCODE_UNKNOWN;
+}